@@ -1,3 +1,3 @@
-SET(CR_MAJOR "1")
-SET(CR_MINOR "2")
+SET(CR_MAJOR "2")
+SET(CR_MINOR "0")
 SET(CR_PATCH "0")
@@ -0,0 +1,677 @@
+/* createrepo_c - Library of routines for manipulation with repodata
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+/* Micro benchmarks of the library.
+ *
+ * Packages are synthesized in memory (see --shape), so the numbers don't
+ * depend on an rpm tree lying around. Only cr_package_from_rpm() needs
+ * real packages (--rpm-dir).
+ *
+ * Results are printed as JSON lines, one line per benchmark:
+ * {"name": ..., "shape": ..., "iterations": ..., "items": ...,
+ *  "seconds": ..., "items_per_second": ...}
+ * where seconds is the best time of all iterations. Compression benchmarks
+ * add "output_bytes", the size of the compressed file.
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "createrepo/checksum.h"
+#include "createrepo/compression_wrapper.h"
+#include "createrepo/error.h"
+#include "createrepo/misc.h"
+#include "createrepo/package.h"
+#include "createrepo/parsepkg.h"
+#include "createrepo/sqlite.h"
+#include "createrepo/xml_dump.h"
+#include "createrepo/xml_file.h"
+#include "createrepo/xml_parser.h"
+
+#define TMPDIR_TEMPLATE     "/tmp/createrepo_bench_XXXXXX"
+#define READ_BUFFER_SIZE    131072
+
+/** Shape of the synthesized repository.
+ */
+typedef struct {
+    const char *name;   // Name used by --shape
+    gint packages;      // Number of packages
+    gint files;         // Number of files per package
+    gint changelogs;    // Number of changelog entries per package
+} BenchShape;
+
+static BenchShape shapes[] = {
+    { "small",      5000,  10,    3 },  // Many small packages
+    { "filelists",    50,  20000, 3 },  // A few huge file lists
+    { "changelogs",  500,  10,  1000 }, // Deep changelogs
+    { NULL, 0, 0, 0 },
+};
+
+struct BenchOptions {
+    gchar *shape;
+    gint packages;
+    gint files;
+    gint changelogs;
+    gint iterations;
+    gchar *rpm_dir;
+    gchar *only;
+    gchar *output;
+};
+
+static struct BenchOptions opts = {
+    .shape = NULL,
+    .packages = -1,
+    .files = -1,
+    .changelogs = -1,
+    .iterations = 3,
+    .rpm_dir = NULL,
+    .only = NULL,
+    .output = NULL,
+};
+
+static GOptionEntry cmd_entries[] = {
+    { "shape", 's', 0, G_OPTION_ARG_STRING, &opts.shape,
+      "Shape of the synthesized repository: small (default), filelists "
+      "or changelogs.", "SHAPE" },
+    { "packages", 'p', 0, G_OPTION_ARG_INT, &opts.packages,
+      "Number of packages (overrides the shape).", "N" },
+    { "files", 'f', 0, G_OPTION_ARG_INT, &opts.files,
+      "Number of files per package (overrides the shape).", "N" },
+    { "changelogs", 'c', 0, G_OPTION_ARG_INT, &opts.changelogs,
+      "Number of changelog entries per package (overrides the shape).", "N" },
+    { "iterations", 'i', 0, G_OPTION_ARG_INT, &opts.iterations,
+      "Number of runs of each benchmark, the best one is reported "
+      "(default: 3).", "N" },
+    { "rpm-dir", 0, 0, G_OPTION_ARG_FILENAME, &opts.rpm_dir,
+      "Directory with rpm packages for the cr_package_from_rpm benchmark. "
+      "The benchmark is skipped without it.", "DIR" },
+    { "only", 0, 0, G_OPTION_ARG_STRING, &opts.only,
+      "Run only benchmarks whose name starts with the prefix.", "PREFIX" },
+    { "output", 'o', 0, G_OPTION_ARG_FILENAME, &opts.output,
+      "Append results to the file instead of stdout.", "FILE" },
+    { NULL, 0, 0, G_OPTION_ARG_NONE, NULL, NULL, NULL },
+};
+
+/** State shared by the benchmarks.
+ */
+typedef struct {
+    const BenchShape *shape;
+    GPtrArray *pkgs;        // Synthesized packages
+    GPtrArray *rpms;        // Paths to real rpm packages
+    gchar *tmpdir;
+    gchar *primary_path;    // Written by the xmlfile benchmark
+    gchar *filelists_path;
+    gchar *other_path;
+    long output_bytes;      // Size of the output or -1 (set by the benchmark)
+    FILE *out;
+} BenchData;
+
+typedef long (*BenchFunc)(BenchData *data);
+
+static void
+die(const char *what, GError *err)
+{
+    g_printerr("%s: %s\n", what, err ? err->message : "Unknown error");
+    exit(EXIT_FAILURE);
+}
+
+static gboolean
+selected(const char *name)
+{
+    return !opts.only || g_str_has_prefix(name, opts.only);
+}
+
+/** Run the benchmark opts.iterations times and report the best run.
+ * The function returns number of processed items (packages, bytes, ..).
+ */
+static void
+run(BenchData *data, const char *name, BenchFunc func)
+{
+    gint64 best = G_MAXINT64;
+    long items = 0;
+
+    if (!selected(name))
+        return;
+
+    data->output_bytes = -1;
+    for (int i = 0; i < opts.iterations; i++) {
+        gint64 start = g_get_monotonic_time();
+        items = func(data);
+        gint64 elapsed = g_get_monotonic_time() - start;
+        best = MIN(best, elapsed);
+    }
+
+    double seconds = best / (double) G_USEC_PER_SEC;
+    fprintf(data->out,
+            "{\"name\": \"%s\", \"shape\": \"%s\", \"iterations\": %d, "
+            "\"items\": %ld, \"seconds\": %.6f, \"items_per_second\": %.1f",
+            name, data->shape->name, opts.iterations, items, seconds,
+            seconds > 0 ? items / seconds : 0.0);
+    if (data->output_bytes >= 0)
+        fprintf(data->out, ", \"output_bytes\": %ld", data->output_bytes);
+    fprintf(data->out, "}\n");
+    fflush(data->out);
+}
+
+
+// Fixture generator
+
+
+static char *
+chunk_printf(GStringChunk *chunk, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    gchar *str = g_strdup_vprintf(format, args);
+    va_end(args);
+    char *ret = g_string_chunk_insert(chunk, str);
+    g_free(str);
+    return ret;
+}
+
+static GSList *
+gen_deps(cr_Package *pkg, const char *prefix, int count)
+{
+    GSList *deps = NULL;
+
+    for (int i = 0; i < count; i++) {
+        cr_Dependency *dep = cr_dependency_new();
+        dep->name = chunk_printf(pkg->chunk, "%s(%s-%d)", prefix, pkg->name, i);
+        dep->flags = g_string_chunk_insert(pkg->chunk, "GE");
+        dep->epoch = g_string_chunk_insert(pkg->chunk, "0");
+        dep->version = g_string_chunk_insert(pkg->chunk, "1.0");
+        dep->release = g_string_chunk_insert(pkg->chunk, "1");
+        deps = g_slist_prepend(deps, dep);
+    }
+
+    return g_slist_reverse(deps);
+}
+
+static cr_Package *
+gen_package(int idx, int files, int changelogs)
+{
+    cr_Package *pkg = cr_package_new();
+
+    pkg->name = chunk_printf(pkg->chunk, "bench-package-%d", idx);
+    gchar *pkgid = g_compute_checksum_for_string(G_CHECKSUM_SHA256, pkg->name, -1);
+    pkg->pkgId = g_string_chunk_insert(pkg->chunk, pkgid);
+    g_free(pkgid);
+    pkg->arch = g_string_chunk_insert(pkg->chunk, "x86_64");
+    pkg->epoch = g_string_chunk_insert(pkg->chunk, "0");
+    pkg->version = chunk_printf(pkg->chunk, "%d.%d", idx / 100, idx % 100);
+    pkg->release = g_string_chunk_insert(pkg->chunk, "1.fc99");
+    pkg->summary = chunk_printf(pkg->chunk, "Benchmark package number %d", idx);
+    pkg->description = chunk_printf(pkg->chunk,
+            "Synthesized package %d used by the createrepo_c benchmarks.\n"
+            "It exists only in memory & it has <no> content.", idx);
+    pkg->url = g_string_chunk_insert(pkg->chunk, "https://example.com/bench");
+    pkg->time_file = 1700000000 + idx;
+    pkg->time_build = 1700000000 + idx;
+    pkg->rpm_license = g_string_chunk_insert(pkg->chunk, "GPL-2.0-or-later");
+    pkg->rpm_vendor = g_string_chunk_insert(pkg->chunk, "Bench");
+    pkg->rpm_group = g_string_chunk_insert(pkg->chunk, "Unspecified");
+    pkg->rpm_buildhost = g_string_chunk_insert(pkg->chunk, "bench.example.com");
+    pkg->rpm_sourcerpm = chunk_printf(pkg->chunk, "%s-%s-%s.src.rpm",
+                                      pkg->name, pkg->version, pkg->release);
+    pkg->rpm_header_start = 4504;
+    pkg->rpm_header_end = 4504 + 200 * files + 100 * changelogs;
+    pkg->rpm_packager = g_string_chunk_insert(pkg->chunk, "Bench <bench@example.com>");
+    pkg->size_package = 10000 + 100 * files;
+    pkg->size_installed = 40000 + 400 * files;
+    pkg->size_archive = 40500 + 400 * files;
+    pkg->location_href = chunk_printf(pkg->chunk, "Packages/b/%s-%s-%s.%s.rpm",
+                                      pkg->name, pkg->version, pkg->release,
+                                      pkg->arch);
+    pkg->checksum_type = g_string_chunk_insert(pkg->chunk, "sha256");
+    pkg->files_checksum_type = g_string_chunk_insert(pkg->chunk, "sha256");
+
+    pkg->provides = gen_deps(pkg, "provide", 3);
+    pkg->requires = gen_deps(pkg, "require", 5);
+
+    for (int i = 0; i < files; i++) {
+        cr_PackageFile *file = cr_package_file_new();
+        file->type = g_string_chunk_insert(pkg->chunk, i % 20 ? "" : "dir");
+        // Every tenth file is in bin/ so it lands in primary as well
+        file->path = chunk_printf(pkg->chunk, i % 10 ? "/usr/share/%s/%d/"
+                                              : "/usr/bin/",
+                                  pkg->name, i / 100);
+        file->name = chunk_printf(pkg->chunk, "file-%d", i);
+        file->digest = pkg->pkgId;
+        pkg->files = g_slist_prepend(pkg->files, file);
+    }
+    pkg->files = g_slist_reverse(pkg->files);
+
+    for (int i = 0; i < changelogs; i++) {
+        cr_ChangelogEntry *entry = cr_changelog_entry_new();
+        entry->author = chunk_printf(pkg->chunk,
+                                     "Bench <bench@example.com> - %d.%d-%d",
+                                     idx / 100, idx % 100, i);
+        entry->date = 1700000000 - 86400 * (gint64) i;
+        entry->changelog = chunk_printf(pkg->chunk,
+                "- Change number %d of the package\n"
+                "- Fixed a bug (rhbz#%d)", i, 100000 + i);
+        pkg->changelogs = g_slist_prepend(pkg->changelogs, entry);
+    }
+
+    return pkg;
+}
+
+static void
+gen_packages(BenchData *data)
+{
+    const BenchShape *shape = data->shape;
+    int packages = opts.packages >= 0 ? opts.packages : shape->packages;
+    int files = opts.files >= 0 ? opts.files : shape->files;
+    int changelogs = opts.changelogs >= 0 ? opts.changelogs : shape->changelogs;
+
+    data->pkgs = g_ptr_array_new_with_free_func((GDestroyNotify) cr_package_free);
+    for (int i = 0; i < packages; i++)
+        g_ptr_array_add(data->pkgs, gen_package(i, files, changelogs));
+}
+
+static void
+find_rpms(BenchData *data)
+{
+    GError *err = NULL;
+    GDir *dir;
+    const gchar *fn;
+
+    data->rpms = g_ptr_array_new_with_free_func(g_free);
+    if (!opts.rpm_dir)
+        return;
+
+    dir = g_dir_open(opts.rpm_dir, 0, &err);
+    if (!dir)
+        die("Cannot open --rpm-dir", err);
+
+    while ((fn = g_dir_read_name(dir)))
+        if (g_str_has_suffix(fn, ".rpm"))
+            g_ptr_array_add(data->rpms, g_build_filename(opts.rpm_dir, fn, NULL));
+
+    g_dir_close(dir);
+}
+
+
+// Benchmarks
+
+
+static long
+bench_package_from_rpm(BenchData *data)
+{
+    for (guint i = 0; i < data->rpms->len; i++) {
+        GError *err = NULL;
+        const char *path = data->rpms->pdata[i];
+        cr_Package *pkg = cr_package_from_rpm(path, CR_CHECKSUM_SHA256,
+                                              cr_get_filename(path), NULL,
+                                              10, NULL, CR_HDRR_NONE, &err);
+        if (!pkg)
+            die(path, err);
+        cr_package_free(pkg);
+    }
+
+    return data->rpms->len;
+}
+
+static long
+bench_xml_dump(BenchData *data)
+{
+    for (guint i = 0; i < data->pkgs->len; i++) {
+        GError *err = NULL;
+        struct cr_XmlStruct res = cr_xml_dump(data->pkgs->pdata[i], &err);
+        if (err)
+            die("cr_xml_dump", err);
+        g_free(res.primary);
+        g_free(res.filelists);
+        g_free(res.filelists_ext);
+        g_free(res.other);
+    }
+
+    return data->pkgs->len;
+}
+
+static long
+bench_xmlfile_add_chunk(BenchData *data)
+{
+    GError *err = NULL;
+    cr_XmlFile *pri, *fil, *oth;
+    long len = data->pkgs->len;
+    struct cr_XmlStruct *res = g_new0(struct cr_XmlStruct, len);
+
+    // Chunks are dumped in advance, only writing is measured
+    // (the result still includes it, the files are needed by parsers)
+    for (long i = 0; i < len; i++) {
+        res[i] = cr_xml_dump(data->pkgs->pdata[i], &err);
+        if (err)
+            die("cr_xml_dump", err);
+    }
+
+    g_remove(data->primary_path);
+    g_remove(data->filelists_path);
+    g_remove(data->other_path);
+
+    pri = cr_xmlfile_open_primary(data->primary_path, CR_CW_NO_COMPRESSION, &err);
+    if (!pri)
+        die("Cannot open primary.xml", err);
+    fil = cr_xmlfile_open_filelists(data->filelists_path, CR_CW_NO_COMPRESSION, &err);
+    if (!fil)
+        die("Cannot open filelists.xml", err);
+    oth = cr_xmlfile_open_other(data->other_path, CR_CW_NO_COMPRESSION, &err);
+    if (!oth)
+        die("Cannot open other.xml", err);
+
+    cr_xmlfile_set_num_of_pkgs(pri, len, NULL);
+    cr_xmlfile_set_num_of_pkgs(fil, len, NULL);
+    cr_xmlfile_set_num_of_pkgs(oth, len, NULL);
+
+    for (long i = 0; i < len; i++) {
+        if (cr_xmlfile_add_chunk(pri, res[i].primary, &err) != CRE_OK
+            || cr_xmlfile_add_chunk(fil, res[i].filelists, &err) != CRE_OK
+            || cr_xmlfile_add_chunk(oth, res[i].other, &err) != CRE_OK)
+            die("cr_xmlfile_add_chunk", err);
+    }
+
+    cr_xmlfile_close(pri, NULL);
+    cr_xmlfile_close(fil, NULL);
+    cr_xmlfile_close(oth, NULL);
+
+    for (long i = 0; i < len; i++) {
+        g_free(res[i].primary);
+        g_free(res[i].filelists);
+        g_free(res[i].filelists_ext);
+        g_free(res[i].other);
+    }
+    g_free(res);
+
+    return len;
+}
+
+static long
+bench_db_add_pkg(BenchData *data)
+{
+    GError *err = NULL;
+    cr_SqliteDb *dbs[3];
+    const cr_DatabaseType types[3] = { CR_DB_PRIMARY, CR_DB_FILELISTS, CR_DB_OTHER };
+    const char *names[3] = { "primary.sqlite", "filelists.sqlite", "other.sqlite" };
+
+    for (int x = 0; x < 3; x++) {
+        gchar *path = g_build_filename(data->tmpdir, names[x], NULL);
+        g_remove(path);
+        dbs[x] = cr_db_open(path, types[x], &err);
+        if (!dbs[x])
+            die(path, err);
+        g_free(path);
+    }
+
+    for (guint i = 0; i < data->pkgs->len; i++)
+        for (int x = 0; x < 3; x++)
+            if (cr_db_add_pkg(dbs[x], data->pkgs->pdata[i], &err) != CRE_OK)
+                die("cr_db_add_pkg", err);
+
+    for (int x = 0; x < 3; x++)
+        cr_db_close(dbs[x], NULL);
+
+    return data->pkgs->len;
+}
+
+/** Compress and decompress the written filelists.xml (the biggest one).
+ * Every profile writes its own file, so the decompression reads the file
+ * of the same profile.
+ */
+static long
+bench_compression(BenchData *data,
+                  cr_CompressionType type,
+                  cr_CompressionProfile profile,
+                  gboolean decompress)
+{
+    GError *err = NULL;
+    GStatBuf st;
+    gchar *contents;
+    gsize len;
+    int readed;
+    cr_CompressionOptions options = { .profile = profile,
+                                      .level = CR_CW_LEVEL_DEFAULT };
+    const char *profile_suffix = profile == CR_CW_PROFILE_FAST ? ".fast"
+                               : profile == CR_CW_PROFILE_BEST ? ".best" : "";
+    gchar *path = g_strconcat(data->filelists_path, profile_suffix,
+                              cr_compression_suffix(type), NULL);
+
+    if (!g_file_get_contents(data->filelists_path, &contents, &len, &err))
+        die(data->filelists_path, err);
+
+    if (!decompress || !g_file_test(path, G_FILE_TEST_EXISTS)) {
+        g_remove(path);
+        CR_FILE *f = cr_sopen_with_options(path, CR_CW_MODE_WRITE, type,
+                                           NULL, &options, &err);
+        if (!f)
+            die(path, err);
+        if (cr_write(f, contents, len, &err) == CR_CW_ERR)
+            die(path, err);
+        cr_close(f, NULL);
+
+        if (!decompress && g_stat(path, &st) == 0)
+            data->output_bytes = st.st_size;
+    }
+
+    if (decompress) {
+        gchar *buf = g_malloc(READ_BUFFER_SIZE);
+        CR_FILE *f = cr_open(path, CR_CW_MODE_READ, type, &err);
+        if (!f)
+            die(path, err);
+        while ((readed = cr_read(f, buf, READ_BUFFER_SIZE, &err)) > 0)
+            ;
+        if (readed == CR_CW_ERR)
+            die(path, err);
+        cr_close(f, NULL);
+        g_free(buf);
+    }
+
+    g_free(contents);
+    g_free(path);
+
+    return len;
+}
+
+#define COMPRESSION_BENCH(NAME, TYPE, PROFILE) \
+    static long bench_compress_ ## NAME(BenchData *data) \
+    { return bench_compression(data, TYPE, PROFILE, FALSE); } \
+    static long bench_decompress_ ## NAME(BenchData *data) \
+    { return bench_compression(data, TYPE, PROFILE, TRUE); }
+
+#define COMPRESSION_BENCH_PROFILES(NAME, TYPE) \
+    COMPRESSION_BENCH(NAME,         TYPE, CR_CW_PROFILE_DEFAULT) \
+    COMPRESSION_BENCH(NAME ## _fast, TYPE, CR_CW_PROFILE_FAST) \
+    COMPRESSION_BENCH(NAME ## _best, TYPE, CR_CW_PROFILE_BEST)
+
+COMPRESSION_BENCH_PROFILES(gz,   CR_CW_GZ_COMPRESSION)
+COMPRESSION_BENCH_PROFILES(bz2,  CR_CW_BZ2_COMPRESSION)
+COMPRESSION_BENCH_PROFILES(xz,   CR_CW_XZ_COMPRESSION)
+COMPRESSION_BENCH_PROFILES(zstd, CR_CW_ZSTD_COMPRESSION)
+#ifdef WITH_ZCHUNK
+COMPRESSION_BENCH(zck,  CR_CW_ZCK_COMPRESSION, CR_CW_PROFILE_DEFAULT)
+#endif
+
+#define RUN_COMPRESSION(DATA, NAME) \
+    do { \
+        run(DATA, "compress_" #NAME, bench_compress_ ## NAME); \
+        run(DATA, "decompress_" #NAME, bench_decompress_ ## NAME); \
+    } while (0)
+
+#define RUN_COMPRESSION_PROFILES(DATA, NAME) \
+    do { \
+        RUN_COMPRESSION(DATA, NAME); \
+        RUN_COMPRESSION(DATA, NAME ## _fast); \
+        RUN_COMPRESSION(DATA, NAME ## _best); \
+    } while (0)
+
+static int
+free_pkg_cb(cr_Package *pkg, G_GNUC_UNUSED void *cbdata,
+            G_GNUC_UNUSED GError **err)
+{
+    cr_package_free(pkg);
+    return CR_CB_RET_OK;
+}
+
+static long
+bench_parse_primary(BenchData *data)
+{
+    GError *err = NULL;
+    if (cr_xml_parse_primary(data->primary_path, NULL, NULL, free_pkg_cb, NULL,
+                             NULL, NULL, 1, &err) != CRE_OK)
+        die("cr_xml_parse_primary", err);
+    return data->pkgs->len;
+}
+
+static long
+bench_parse_filelists(BenchData *data)
+{
+    GError *err = NULL;
+    if (cr_xml_parse_filelists(data->filelists_path, NULL, NULL, free_pkg_cb,
+                               NULL, NULL, NULL, &err) != CRE_OK)
+        die("cr_xml_parse_filelists", err);
+    return data->pkgs->len;
+}
+
+static long
+bench_parse_other(BenchData *data)
+{
+    GError *err = NULL;
+    if (cr_xml_parse_other(data->other_path, NULL, NULL, free_pkg_cb, NULL,
+                           NULL, NULL, &err) != CRE_OK)
+        die("cr_xml_parse_other", err);
+    return data->pkgs->len;
+}
+
+static long
+bench_parse_filelists_fast(BenchData *data)
+{
+    GError *err = NULL;
+    if (cr_xml_parse_filelists_fast(data->filelists_path, NULL, NULL,
+                                    free_pkg_cb, NULL, NULL, NULL, &err) != CRE_OK)
+        die("cr_xml_parse_filelists_fast", err);
+    return data->pkgs->len;
+}
+
+static long
+bench_parse_other_fast(BenchData *data)
+{
+    GError *err = NULL;
+    if (cr_xml_parse_other_fast(data->other_path, NULL, NULL, free_pkg_cb,
+                                NULL, NULL, NULL, &err) != CRE_OK)
+        die("cr_xml_parse_other_fast", err);
+    return data->pkgs->len;
+}
+
+int
+main(int argc, char *argv[])
+{
+    GError *err = NULL;
+    GOptionContext *context;
+    BenchData data = { 0 };
+
+    context = g_option_context_new(NULL);
+    g_option_context_set_summary(context, "Micro benchmarks of the "
+                                 "createrepo_c library. Results are printed "
+                                 "as JSON lines.");
+    g_option_context_add_main_entries(context, cmd_entries, NULL);
+    if (!g_option_context_parse(context, &argc, &argv, &err))
+        die("Option parsing failed", err);
+    g_option_context_free(context);
+
+    for (BenchShape *shape = shapes; shape->name; shape++)
+        if (!opts.shape || !g_strcmp0(opts.shape, shape->name)) {
+            data.shape = shape;
+            break;
+        }
+    if (!data.shape) {
+        g_printerr("Unknown shape \"%s\"\n", opts.shape);
+        return EXIT_FAILURE;
+    }
+    if (opts.iterations < 1)
+        opts.iterations = 1;
+
+    data.out = stdout;
+    if (opts.output && !(data.out = fopen(opts.output, "a"))) {
+        g_printerr("Cannot open %s: %s\n", opts.output, g_strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    gchar *template = g_strdup(TMPDIR_TEMPLATE);
+    data.tmpdir = mkdtemp(template);
+    if (!data.tmpdir) {
+        g_printerr("Cannot create temporary directory: %s\n", g_strerror(errno));
+        return EXIT_FAILURE;
+    }
+    data.primary_path = g_build_filename(data.tmpdir, "primary.xml", NULL);
+    data.filelists_path = g_build_filename(data.tmpdir, "filelists.xml", NULL);
+    data.other_path = g_build_filename(data.tmpdir, "other.xml", NULL);
+
+    cr_xml_dump_init();
+    cr_package_parser_init();
+
+    gen_packages(&data);
+    find_rpms(&data);
+
+    if (data.rpms->len)
+        run(&data, "package_from_rpm", bench_package_from_rpm);
+    run(&data, "xml_dump", bench_xml_dump);
+    run(&data, "db_add_pkg", bench_db_add_pkg);
+
+    // Following benchmarks need the xml files, write them always
+    if (!selected("xmlfile_add_chunk"))
+        bench_xmlfile_add_chunk(&data);
+    run(&data, "xmlfile_add_chunk", bench_xmlfile_add_chunk);
+
+    RUN_COMPRESSION_PROFILES(&data, gz);
+    RUN_COMPRESSION_PROFILES(&data, bz2);
+    RUN_COMPRESSION_PROFILES(&data, xz);
+    RUN_COMPRESSION_PROFILES(&data, zstd);
+#ifdef WITH_ZCHUNK
+    RUN_COMPRESSION(&data, zck);
+#endif
+
+    run(&data, "parse_primary", bench_parse_primary);
+    run(&data, "parse_filelists", bench_parse_filelists);
+    run(&data, "parse_other", bench_parse_other);
+    run(&data, "parse_filelists_fast", bench_parse_filelists_fast);
+    run(&data, "parse_other_fast", bench_parse_other_fast);
+
+    // Clean up
+
+    g_ptr_array_free(data.pkgs, TRUE);
+    g_ptr_array_free(data.rpms, TRUE);
+    cr_package_parser_cleanup();
+    cr_xml_dump_cleanup();
+
+    cr_remove_dir(data.tmpdir, NULL);
+    g_free(data.tmpdir);
+    g_free(data.primary_path);
+    g_free(data.filelists_path);
+    g_free(data.other_path);
+    if (data.out != stdout)
+        fclose(data.out);
+
+    return EXIT_SUCCESS;
+}
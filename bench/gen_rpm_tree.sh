@@ -0,0 +1,100 @@
+#!/bin/bash
+
+# Generate a tree of (empty) rpm packages for createrepo_c benchmarks.
+# Packages are built by rpmbuild from synthesized spec files.
+
+SHAPE="small"       # Shape of the tree
+PACKAGES=""         # Number of packages (default by shape)
+FILES=""            # Number of files per package (default by shape)
+CHANGELOGS=""       # Number of changelog entries per package (default by shape)
+DEST=""             # Output directory
+
+usage() {
+    echo "Usage: `basename $0` [options] <output_dir>"
+    echo "Options:"
+    echo "  -s, --shape SHAPE       small (default), filelists or changelogs"
+    echo "  -p, --packages N        Number of packages"
+    echo "  -f, --files N           Number of files per package"
+    echo "  -c, --changelogs N      Number of changelog entries per package"
+}
+
+while [ $# -gt 0 ]; do
+    case "$1" in
+        -s|--shape)      SHAPE="$2"; shift ;;
+        -p|--packages)   PACKAGES="$2"; shift ;;
+        -f|--files)      FILES="$2"; shift ;;
+        -c|--changelogs) CHANGELOGS="$2"; shift ;;
+        -h|--help)       usage; exit 0 ;;
+        -*)              echo "Unknown option $1"; usage; exit 1 ;;
+        *)               DEST="$1" ;;
+    esac
+    shift
+done
+
+if [ -z "$DEST" ]; then
+    usage
+    exit 1
+fi
+
+if ! command -v rpmbuild >/dev/null; then
+    echo "rpmbuild is required"
+    exit 1
+fi
+
+# Keep the shapes in sync with bench_createrepo.c
+case "$SHAPE" in
+    small)      DEF_PACKAGES=5000; DEF_FILES=10;    DEF_CHANGELOGS=3 ;;
+    filelists)  DEF_PACKAGES=50;   DEF_FILES=20000; DEF_CHANGELOGS=3 ;;
+    changelogs) DEF_PACKAGES=500;  DEF_FILES=10;    DEF_CHANGELOGS=1000 ;;
+    *)          echo "Unknown shape $SHAPE"; exit 1 ;;
+esac
+
+PACKAGES=${PACKAGES:-$DEF_PACKAGES}
+FILES=${FILES:-$DEF_FILES}
+CHANGELOGS=${CHANGELOGS:-$DEF_CHANGELOGS}
+
+TOPDIR=`mktemp -d /tmp/createrepo_bench_rpmbuild_XXXXXX`
+trap "rm -rf $TOPDIR" EXIT
+mkdir -p "$DEST"
+
+for ((i = 0; i < PACKAGES; i++)); do
+    NAME="bench-$SHAPE-$i"
+    SPEC="$TOPDIR/$NAME.spec"
+
+    cat > "$SPEC" <<SPEC
+Name:       $NAME
+Version:    1.$i
+Release:    1
+Summary:    Benchmark package $i
+License:    GPL-2.0-or-later
+BuildArch:  noarch
+Provides:   bench($i)
+Requires:   bash
+
+%description
+Synthesized package $i used by the createrepo_c benchmarks.
+
+%install
+mkdir -p %{buildroot}/usr/share/$NAME
+for ((f = 0; f < $FILES; f++)); do
+    touch %{buildroot}/usr/share/$NAME/file-\$f
+done
+
+%files
+/usr/share/$NAME
+
+%changelog
+SPEC
+
+    for ((c = 0; c < CHANGELOGS; c++)); do
+        DATE=`date -d "@$((1700000000 - c * 86400))" "+%a %b %d %Y"`
+        printf "* %s Bench <bench@example.com> - 1.%d-%d\n- Change number %d\n\n" \
+            "$DATE" "$i" "$c" "$c" >> "$SPEC"
+    done
+
+    rpmbuild --quiet -bb --define "_topdir $TOPDIR" \
+             --define "_rpmdir $DEST" --define "_build_name_fmt %%{NAME}-%%{VERSION}-%%{RELEASE}.%%{ARCH}.rpm" \
+             "$SPEC" || exit 1
+done
+
+echo "Generated $PACKAGES packages in $DEST"
@@ -106,7 +106,9 @@ _cr_mergerepo()
     if [[ $2 == -* ]] ; then
         COMPREPLY=( $( compgen -W '--version --help --repo --archlist --database
             --no-database --verbose --outputdir --nogroups --noupdateinfo
-            --compress-type --method --all --noarch-repo --unique-md-filenames
+            --compress-type --zstd-dict --method --all --noarch-repo --lazy-noarch-repo
+            --lazy-load --parser-threads
+            --unique-md-filenames
             --simple-md-filenames --omit-baseurl --koji --groupfile
             --blocked' -- "$2" ) )
     else
@@ -176,6 +178,36 @@ _cr_sqliterepo()
 } &&
 complete -F _cr_sqliterepo -o filenames sqliterepo_c
 
+_cr_repodiff()
+{
+    COMPREPLY=()
+
+    case $3 in
+        -h|--help|-V|--version)
+            return 0
+            ;;
+        -k|--key)
+            COMPREPLY=( $( compgen -W 'name filename href hash' -- "$2" ) )
+            return 0
+            ;;
+        --tmpdir)
+            COMPREPLY=( $( compgen -d -- "$2" ) )
+            return 0
+            ;;
+        --max-packages)
+            return 0
+            ;;
+    esac
+
+    if [[ $2 == -* ]] ; then
+        COMPREPLY=( $( compgen -W '--help --version --quiet --verbose
+            --key --output --max-packages --tmpdir' -- "$2" ) )
+    else
+        COMPREPLY=( $( compgen -f -- "$2" ) )
+    fi
+} &&
+complete -F _cr_repodiff -o filenames repodiff_c
+
 # Local variables:
 # mode: shell-script
 # sh-basic-offset: 4
@@ -35,7 +35,7 @@
 %if %{defined gitrev}
 %define package_version %{?gitrev}
 %else
-%define package_version 1.2.0
+%define package_version 2.0.0
 %endif
 
 Summary:        Creates a common metadata repository
@@ -185,11 +185,13 @@ ln -sr %{buildroot}%{_bindir}/modifyrepo_c %{buildroot}%{_bindir}/modifyrepo
 %{_mandir}/man8/mergerepo_c.8*
 %{_mandir}/man8/modifyrepo_c.8*
 %{_mandir}/man8/sqliterepo_c.8*
+%{_mandir}/man8/repodiff_c.8*
 %{bash_completion}
 %{_bindir}/createrepo_c
 %{_bindir}/mergerepo_c
 %{_bindir}/modifyrepo_c
 %{_bindir}/sqliterepo_c
+%{_bindir}/repodiff_c
 
 %if 0%{?fedora} || 0%{?rhel} > 7
 %{_bindir}/createrepo
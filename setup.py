@@ -54,7 +54,8 @@ setup(
             'createrepo_c=createrepo_c:createrepo_c',
             'mergerepo_c=createrepo_c:mergerepo_c',
             'modifyrepo_c=createrepo_c:modifyrepo_c',
-            'sqliterepo_c=createrepo_c:sqliterepo_c'
+            'sqliterepo_c=createrepo_c:sqliterepo_c',
+            'repodiff_c=createrepo_c:repodiff_c'
         ]
     },
 )
@@ -0,0 +1,494 @@
+/* createrepo_c - Library of routines for manipulation with repodata
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "checkpoint.h"
+#include "cleanup.h"
+#include "error.h"
+#include "locate_metadata.h"
+#include "misc.h"
+
+#define ERR_DOMAIN              CREATEREPO_C_ERROR
+
+#define CHECKPOINT_TASKS        "tasks"
+#define CHECKPOINT_STATE        "state"
+#define CHECKPOINT_PRI          "primary.xml"
+#define CHECKPOINT_FIL          "filelists.xml"
+#define CHECKPOINT_OTH          "other.xml"
+#define CHECKPOINT_GROUP        "checkpoint"
+#define CHECKPOINT_FILES        { CHECKPOINT_TASKS, CHECKPOINT_PRI, \
+                                  CHECKPOINT_FIL, CHECKPOINT_OTH }
+
+#define JOURNAL_XML_HEADER      "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+
+#define JOURNAL_PRI_HEADER      JOURNAL_XML_HEADER"<metadata xmlns=\"" \
+                                CR_XML_COMMON_NS"\" xmlns:rpm=\"" \
+                                CR_XML_RPM_NS"\">\n"
+#define JOURNAL_FIL_HEADER      JOURNAL_XML_HEADER"<filelists xmlns=\"" \
+                                CR_XML_FILELISTS_NS"\">\n"
+#define JOURNAL_FEX_HEADER      JOURNAL_XML_HEADER"<filelists-ext xmlns=\"" \
+                                CR_XML_FILELISTS_EXT_NS"\">\n"
+#define JOURNAL_OTH_HEADER      JOURNAL_XML_HEADER"<otherdata xmlns=\"" \
+                                CR_XML_OTHER_NS"\">\n"
+
+#define JOURNAL_PRI_FOOTER      "</metadata>"
+#define JOURNAL_FIL_FOOTER      "</filelists>"
+#define JOURNAL_FEX_FOOTER      "</filelists-ext>"
+#define JOURNAL_OTH_FOOTER      "</otherdata>"
+
+
+/** Path of the checkpoint file of the generation.
+ */
+static gchar *
+generation_path(const char *dir, const char *name, long generation)
+{
+    _cleanup_free_ gchar *filename = NULL;
+
+    filename = g_strdup_printf("%s.%ld", name, generation);
+    return g_build_filename(dir, filename, NULL);
+}
+
+
+/** Remove the task list and journals of the generation.
+ */
+static void
+remove_generation(const char *dir, long generation)
+{
+    const char *names[] = CHECKPOINT_FILES;
+
+    for (size_t i = 0; i < G_N_ELEMENTS(names); i++) {
+        _cleanup_free_ gchar *path = generation_path(dir, names[i], generation);
+        if (g_remove(path) && errno != ENOENT)
+            g_warning("Cannot remove %s: %s", path, g_strerror(errno));
+    }
+}
+
+
+cr_Checkpoint *
+cr_checkpoint_new(const char *dir,
+                  gboolean filelists_ext,
+                  long interval,
+                  GError **err)
+{
+    cr_Checkpoint *cp;
+    _cleanup_keyfile_free_ GKeyFile *keyfile = NULL;
+    _cleanup_free_ gchar *state_path = NULL;
+
+    assert(dir);
+    assert(!err || *err == NULL);
+
+    if (g_mkdir_with_parents(dir, S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH)) {
+        g_set_error(err, ERR_DOMAIN, CRE_IO,
+                    "Cannot create checkpoint directory %s: %s",
+                    dir, g_strerror(errno));
+        return NULL;
+    }
+
+    cp = g_new0(cr_Checkpoint, 1);
+    cp->dir             = g_strdup(dir);
+    cp->filelists_ext   = filelists_ext;
+    cp->interval        = (interval > 0) ? interval
+                                         : CR_CHECKPOINT_DEFAULT_INTERVAL;
+    cp->tasks           = g_string_new(NULL);
+
+    // Journals of this run must not overwrite the committed ones
+    state_path = g_build_filename(dir, CHECKPOINT_STATE, NULL);
+    keyfile = g_key_file_new();
+    if (g_key_file_load_from_file(keyfile, state_path, G_KEY_FILE_NONE, NULL))
+        cp->committed_generation = g_key_file_get_int64(keyfile,
+                                                        CHECKPOINT_GROUP,
+                                                        "generation", NULL);
+    cp->generation = cp->committed_generation + 1;
+
+    return cp;
+}
+
+
+void
+cr_checkpoint_add_task(cr_Checkpoint *cp, const char *full_path)
+{
+    if (!cp)
+        return;
+
+    g_string_append(cp->tasks, full_path);
+    g_string_append_c(cp->tasks, '\n');
+    cp->task_count++;
+}
+
+
+/** Return length (in bytes) of the first n lines of the str.
+ * If the str has less than n lines, -1 is returned.
+ */
+static gssize
+lines_prefix_len(const char *str, long n)
+{
+    const char *p = str;
+
+    for (long i = 0; i < n; i++) {
+        p = strchr(p, '\n');
+        if (!p)
+            return -1;
+        p++;
+    }
+
+    return p - str;
+}
+
+
+/** Cut the journal at the committed offset and close it by the footer,
+ * so it can be parsed as a regular metadata file.
+ * This is idempotent - if the process dies during resume, the next
+ * resume gets the same result.
+ */
+static gboolean
+seal_journal(const char *path, gint64 offset, const char *footer, GError **err)
+{
+    FILE *f;
+
+    if (truncate(path, (off_t) offset)) {
+        g_set_error(err, ERR_DOMAIN, CRE_IO,
+                    "Cannot truncate %s: %s", path, g_strerror(errno));
+        return FALSE;
+    }
+
+    f = fopen(path, "a");
+    if (!f) {
+        g_set_error(err, ERR_DOMAIN, CRE_IO,
+                    "Cannot open %s: %s", path, g_strerror(errno));
+        return FALSE;
+    }
+
+    fputs(footer, f);
+
+    if (fclose(f)) {
+        g_set_error(err, ERR_DOMAIN, CRE_IO,
+                    "Cannot write %s: %s", path, g_strerror(errno));
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+
+int
+cr_checkpoint_resume(cr_Checkpoint *cp, cr_Metadata *md, GError **err)
+{
+    int ret;
+    GError *tmp_err = NULL;
+    gint64 committed, pri_offset = 0, fil_offset = 0, oth_offset = 0;
+    gboolean filelists_ext = FALSE;
+    _cleanup_keyfile_free_ GKeyFile *keyfile = NULL;
+    _cleanup_free_ gchar *state_path = NULL;
+    _cleanup_free_ gchar *tasks_path = NULL;
+    _cleanup_free_ gchar *old_tasks = NULL;
+    _cleanup_free_ gchar *pri_path = NULL;
+    _cleanup_free_ gchar *fil_path = NULL;
+    _cleanup_free_ gchar *oth_path = NULL;
+
+    assert(cp);
+    assert(md);
+    assert(!err || *err == NULL);
+
+    state_path = g_build_filename(cp->dir, CHECKPOINT_STATE, NULL);
+    if (!cp->committed_generation
+        || !g_file_test(state_path, G_FILE_TEST_IS_REGULAR)) {
+        g_debug("%s: No checkpoint in %s", __func__, cp->dir);
+        return CRE_OK;
+    }
+
+    keyfile = g_key_file_new();
+    if (!g_key_file_load_from_file(keyfile, state_path, G_KEY_FILE_NONE, &tmp_err)) {
+        g_propagate_prefixed_error(err, tmp_err,
+                                   "Cannot load checkpoint state %s: ",
+                                   state_path);
+        return CRE_IO;
+    }
+
+    committed     = g_key_file_get_int64(keyfile, CHECKPOINT_GROUP, "committed", &tmp_err);
+    if (!tmp_err)
+        pri_offset = g_key_file_get_int64(keyfile, CHECKPOINT_GROUP, "primary", &tmp_err);
+    if (!tmp_err)
+        fil_offset = g_key_file_get_int64(keyfile, CHECKPOINT_GROUP, "filelists", &tmp_err);
+    if (!tmp_err)
+        oth_offset = g_key_file_get_int64(keyfile, CHECKPOINT_GROUP, "other", &tmp_err);
+    if (!tmp_err)
+        filelists_ext = g_key_file_get_boolean(keyfile, CHECKPOINT_GROUP, "filelists_ext", &tmp_err);
+    if (tmp_err) {
+        g_propagate_prefixed_error(err, tmp_err,
+                                   "Bad checkpoint state %s: ", state_path);
+        return CRE_BADARG;
+    }
+
+    if (filelists_ext != cp->filelists_ext) {
+        g_message("Checkpoint in %s was created %s --filelists-ext - ignoring it",
+                  cp->dir, filelists_ext ? "with" : "without");
+        return CRE_OK;
+    }
+
+    // Compare the task list of the interrupted run with the current one.
+    // A mismatch is not fatal - every loaded package is still validated
+    // by the dumper (mtime, size and checksum type) before it is used.
+    tasks_path = generation_path(cp->dir, CHECKPOINT_TASKS,
+                                 cp->committed_generation);
+    if (g_file_get_contents(tasks_path, &old_tasks, NULL, NULL)) {
+        gssize old_len = lines_prefix_len(old_tasks, committed);
+        gssize cur_len = lines_prefix_len(cp->tasks->str, committed);
+        if (old_len < 0 || old_len != cur_len
+            || memcmp(old_tasks, cp->tasks->str, old_len))
+            g_message("Package list changed since the checkpoint was made - "
+                      "only unchanged packages will be reused");
+    }
+
+    pri_path = generation_path(cp->dir, CHECKPOINT_PRI, cp->committed_generation);
+    fil_path = generation_path(cp->dir, CHECKPOINT_FIL, cp->committed_generation);
+    oth_path = generation_path(cp->dir, CHECKPOINT_OTH, cp->committed_generation);
+
+    if (!seal_journal(pri_path, pri_offset, JOURNAL_PRI_FOOTER, err)
+        || !seal_journal(fil_path, fil_offset,
+                         filelists_ext ? JOURNAL_FEX_FOOTER : JOURNAL_FIL_FOOTER,
+                         err)
+        || !seal_journal(oth_path, oth_offset, JOURNAL_OTH_FOOTER, err))
+        return CRE_IO;
+
+    struct cr_MetadataLocation ml = { 0 };
+    ml.pri_xml_href = pri_path;
+    if (filelists_ext)
+        ml.fex_xml_href = fil_path;
+    else
+        ml.fil_xml_href = fil_path;
+    ml.oth_xml_href = oth_path;
+
+    guint before = g_hash_table_size(cr_metadata_hashtable(md));
+
+    ret = cr_metadata_load_xml(md, &ml, &tmp_err);
+    if (ret != CRE_OK) {
+        g_propagate_prefixed_error(err, tmp_err,
+                                   "Cannot load checkpoint from %s: ", cp->dir);
+        return ret;
+    }
+
+    cp->resumed = g_hash_table_size(cr_metadata_hashtable(md)) - before;
+
+    g_message("Resuming from checkpoint: %"G_GINT64_FORMAT" of %ld "
+              "packages were already done (%ld loaded)",
+              committed, cp->task_count, cp->resumed);
+
+    return CRE_OK;
+}
+
+
+static FILE *
+open_journal(cr_Checkpoint *cp, const char *name, const char *header, GError **err)
+{
+    _cleanup_free_ gchar *path = generation_path(cp->dir, name, cp->generation);
+
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        g_set_error(err, ERR_DOMAIN, CRE_IO,
+                    "Cannot open %s: %s", path, g_strerror(errno));
+        return NULL;
+    }
+
+    if (fputs(header, f) == EOF) {
+        g_set_error(err, ERR_DOMAIN, CRE_IO,
+                    "Cannot write %s: %s", path, g_strerror(errno));
+        fclose(f);
+        return NULL;
+    }
+
+    return f;
+}
+
+
+int
+cr_checkpoint_start(cr_Checkpoint *cp, GError **err)
+{
+    GError *tmp_err = NULL;
+    _cleanup_free_ gchar *tasks_path = NULL;
+
+    assert(cp);
+    assert(!err || *err == NULL);
+
+    // The new journals are written next to the ones of the previous
+    // checkpoint, which stays valid until the first commit switches
+    // the state to the new generation. Packages restored from the old
+    // journals are journaled again (cheaply) as they pass through
+    // the dumper.
+    tasks_path = generation_path(cp->dir, CHECKPOINT_TASKS, cp->generation);
+    if (!g_file_set_contents(tasks_path, cp->tasks->str, cp->tasks->len, &tmp_err)) {
+        g_propagate_prefixed_error(err, tmp_err, "Cannot write task list: ");
+        return CRE_IO;
+    }
+
+    cp->pri = open_journal(cp, CHECKPOINT_PRI, JOURNAL_PRI_HEADER, err);
+    if (!cp->pri)
+        return CRE_IO;
+
+    cp->fil = open_journal(cp, CHECKPOINT_FIL,
+                           cp->filelists_ext ? JOURNAL_FEX_HEADER
+                                             : JOURNAL_FIL_HEADER,
+                           err);
+    if (!cp->fil)
+        return CRE_IO;
+
+    cp->oth = open_journal(cp, CHECKPOINT_OTH, JOURNAL_OTH_HEADER, err);
+    if (!cp->oth)
+        return CRE_IO;
+
+    cp->pending   = 0;
+    cp->committed = 0;
+
+    return CRE_OK;
+}
+
+
+int
+cr_checkpoint_add_pkg(cr_Checkpoint *cp,
+                      long id,
+                      struct cr_XmlStruct *res,
+                      GError **err)
+{
+    const char *fil;
+
+    assert(cp);
+    assert(res);
+    assert(!err || *err == NULL);
+
+    if (!cp->pri)
+        // Not started
+        return CRE_OK;
+
+    fil = cp->filelists_ext ? res->filelists_ext : res->filelists;
+
+    if (fputs(res->primary, cp->pri) == EOF
+        || fputs(fil, cp->fil) == EOF
+        || fputs(res->other, cp->oth) == EOF)
+    {
+        g_set_error(err, ERR_DOMAIN, CRE_IO,
+                    "Cannot write checkpoint journal: %s", g_strerror(errno));
+        return CRE_IO;
+    }
+
+    if (++cp->pending < cp->interval)
+        return CRE_OK;
+
+    return cr_checkpoint_commit(cp, id + 1, err);
+}
+
+
+static gboolean
+sync_journal(FILE *f, gint64 *offset, GError **err)
+{
+    if (fflush(f) || fsync(fileno(f))) {
+        g_set_error(err, ERR_DOMAIN, CRE_IO,
+                    "Cannot flush checkpoint journal: %s", g_strerror(errno));
+        return FALSE;
+    }
+
+    *offset = (gint64) ftello(f);
+    return TRUE;
+}
+
+
+int
+cr_checkpoint_commit(cr_Checkpoint *cp, long committed, GError **err)
+{
+    gint64 pri_offset, fil_offset, oth_offset;
+    gsize length;
+    GError *tmp_err = NULL;
+    _cleanup_keyfile_free_ GKeyFile *keyfile = NULL;
+    _cleanup_free_ gchar *data = NULL;
+    _cleanup_free_ gchar *state_path = NULL;
+
+    assert(cp);
+    assert(!err || *err == NULL);
+
+    if (!cp->pri)
+        return CRE_OK;
+
+    if (!sync_journal(cp->pri, &pri_offset, err)
+        || !sync_journal(cp->fil, &fil_offset, err)
+        || !sync_journal(cp->oth, &oth_offset, err))
+        return CRE_IO;
+
+    keyfile = g_key_file_new();
+    g_key_file_set_int64(keyfile, CHECKPOINT_GROUP, "generation", cp->generation);
+    g_key_file_set_int64(keyfile, CHECKPOINT_GROUP, "committed", committed);
+    g_key_file_set_int64(keyfile, CHECKPOINT_GROUP, "primary", pri_offset);
+    g_key_file_set_int64(keyfile, CHECKPOINT_GROUP, "filelists", fil_offset);
+    g_key_file_set_int64(keyfile, CHECKPOINT_GROUP, "other", oth_offset);
+    g_key_file_set_boolean(keyfile, CHECKPOINT_GROUP, "filelists_ext",
+                           cp->filelists_ext);
+    data = g_key_file_to_data(keyfile, &length, NULL);
+
+    // g_file_set_contents() writes a temporary file and renames it,
+    // so the state always refers either to the old or to the new journals
+    state_path = g_build_filename(cp->dir, CHECKPOINT_STATE, NULL);
+    if (!g_file_set_contents(state_path, data, length, &tmp_err)) {
+        g_propagate_prefixed_error(err, tmp_err,
+                                   "Cannot write checkpoint state: ");
+        return CRE_IO;
+    }
+
+    cp->committed = committed;
+    cp->pending   = 0;
+
+    // The first commit replaced the previous checkpoint
+    if (cp->committed_generation != cp->generation) {
+        if (cp->committed_generation)
+            remove_generation(cp->dir, cp->committed_generation);
+        cp->committed_generation = cp->generation;
+    }
+
+    g_debug("Checkpoint: %ld of %ld tasks committed", committed, cp->task_count);
+
+    return CRE_OK;
+}
+
+
+void
+cr_checkpoint_free(cr_Checkpoint *cp, gboolean remove)
+{
+    if (!cp)
+        return;
+
+    if (cp->pri)
+        fclose(cp->pri);
+    if (cp->fil)
+        fclose(cp->fil);
+    if (cp->oth)
+        fclose(cp->oth);
+
+    if (remove) {
+        g_debug("Removing checkpoint %s", cp->dir);
+        cr_remove_dir(cp->dir, NULL);
+    }
+
+    g_string_free(cp->tasks, TRUE);
+    g_free(cp->dir);
+    g_free(cp);
+}
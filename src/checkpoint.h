@@ -0,0 +1,159 @@
+/* createrepo_c - Library of routines for manipulation with repodata
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#ifndef __C_CREATEREPOLIB_CHECKPOINT_H__
+#define __C_CREATEREPOLIB_CHECKPOINT_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <glib.h>
+#include <stdio.h>
+#include "load_metadata.h"
+#include "xml_dump.h"
+
+/** \defgroup   checkpoint  Resumable createrepo_c runs
+ *  \addtogroup checkpoint
+ *  @{
+ *
+ * Checkpoint directory layout:
+ *  - tasks.N         - ordered list of tasks (full paths) as produced by
+ *                      fill_pool(), one per line
+ *  - primary.xml.N   - journal of rendered primary chunks
+ *  - filelists.xml.N - journal of rendered filelists (or filelists-ext)
+ *                      chunks
+ *  - other.xml.N     - journal of rendered other chunks
+ *  - state           - key file with the generation N of the files above,
+ *                      the number of committed tasks and the journal
+ *                      offsets that belong to them
+ *
+ * Journals are plain (uncompressed) XML without the footer. Everything
+ * past the offsets stored in the state file is considered garbage.
+ * Every run writes a new generation of the files, the previous one is
+ * removed only after the state refers to the new one.
+ */
+
+/** Default number of packages between two checkpoints.
+ */
+#define CR_CHECKPOINT_DEFAULT_INTERVAL  500
+
+/** Checkpoint of a createrepo_c run.
+ */
+typedef struct {
+    gchar *dir;             /*!< Checkpoint directory */
+    gboolean filelists_ext; /*!< Journal filelists-ext instead of filelists */
+    long interval;          /*!< Number of packages between checkpoints */
+    GString *tasks;         /*!< Ordered task list (full paths) */
+    long task_count;        /*!< Number of tasks in the list */
+    FILE *pri;              /*!< Primary journal */
+    FILE *fil;              /*!< Filelists (or filelists-ext) journal */
+    FILE *oth;              /*!< Other journal */
+    long pending;           /*!< Packages journaled since last commit */
+    long committed;         /*!< Number of tasks covered by the last commit */
+    long resumed;           /*!< Number of packages loaded from a previous
+                                 checkpoint */
+    long generation;        /*!< Generation of the files of this run */
+    long committed_generation; /*!< Generation referred by the state,
+                                    0 if there is no state */
+} cr_Checkpoint;
+
+/** Prepare a checkpoint. The checkpoint directory is created if it doesn't
+ * exist. Nothing is written until cr_checkpoint_start() is called.
+ * @param dir           Checkpoint directory
+ * @param filelists_ext Journal filelists-ext chunks (--filelists-ext)
+ * @param interval      Number of packages between two checkpoints
+ * @param err           GError **
+ * @return              New cr_Checkpoint or NULL
+ */
+cr_Checkpoint *
+cr_checkpoint_new(const char *dir,
+                  gboolean filelists_ext,
+                  long interval,
+                  GError **err);
+
+/** Append a task to the ordered task list. Tasks have to be added in
+ * the order of their ids.
+ * @param cp            Checkpoint (if NULL, nothing is done)
+ * @param full_path     Full path of the package
+ */
+void
+cr_checkpoint_add_task(cr_Checkpoint *cp, const char *full_path);
+
+/** Load packages committed by a previous (interrupted) run into the
+ * metadata. Loaded packages are used the same way as metadata loaded
+ * by --update, i.e. only when the package file is unchanged.
+ * If there is no usable checkpoint, CRE_OK is returned and nothing is
+ * loaded.
+ * @param cp            Checkpoint
+ * @param md            Metadata (with CR_HT_KEY_HREF key)
+ * @param err           GError **
+ * @return              cr_Error code
+ */
+int
+cr_checkpoint_resume(cr_Checkpoint *cp, cr_Metadata *md, GError **err);
+
+/** Write the task list and start new (empty) journals. The journals
+ * of the previous run stay valid until the first cr_checkpoint_commit().
+ * @param cp            Checkpoint
+ * @param err           GError **
+ * @return              cr_Error code
+ */
+int
+cr_checkpoint_start(cr_Checkpoint *cp, GError **err);
+
+/** Journal rendered XML chunks of the task with the id. Has to be called
+ * in the order of task ids (it is called from the last serialized stage
+ * of the dumper). Every cp->interval packages a checkpoint is committed.
+ * @param cp            Checkpoint
+ * @param id            Id of the task
+ * @param res           Rendered XML chunks
+ * @param err           GError **
+ * @return              cr_Error code
+ */
+int
+cr_checkpoint_add_pkg(cr_Checkpoint *cp,
+                      long id,
+                      struct cr_XmlStruct *res,
+                      GError **err);
+
+/** Flush the journals and atomically store a new state. The first commit
+ * after cr_checkpoint_start() removes journals of the previous run.
+ * @param cp            Checkpoint
+ * @param committed     Number of tasks whose chunks are all in journals
+ * @param err           GError **
+ * @return              cr_Error code
+ */
+int
+cr_checkpoint_commit(cr_Checkpoint *cp, long committed, GError **err);
+
+/** Close journals and free the checkpoint.
+ * @param cp            Checkpoint
+ * @param remove        Remove the checkpoint directory (the run finished)
+ */
+void
+cr_checkpoint_free(cr_Checkpoint *cp, gboolean remove);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __C_CREATEREPOLIB_CHECKPOINT_H__ */
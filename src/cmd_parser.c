@@ -23,9 +23,12 @@
 #include <assert.h>
 #include <errno.h>
 #include <locale.h>
+#include "checkpoint.h"
 #include "cmd_parser.h"
 #include "deltarpms.h"
 #include "error.h"
+#include "prefetch.h"
+#include "watch.h"
 #include "compression_wrapper.h"
 #include "misc.h"
 #include "cleanup.h"
@@ -70,6 +73,14 @@ struct CmdOptions _cmd_options = {
 
         .keep_all_metadata          = TRUE,
         .nevra_duplicates           = CR_ARG_DUP_NEVRA_KEEP_ALL,
+
+        .checkpoint                 = FALSE,
+        .checkpoint_interval        = CR_CHECKPOINT_DEFAULT_INTERVAL,
+
+        .watch                      = FALSE,
+        .watch_delay                = CR_WATCH_DEFAULT_DELAY,
+
+        .prefetch_depth             = CR_PREFETCH_DEFAULT_DEPTH,
     };
 
 
@@ -140,7 +151,9 @@ static GOptionEntry cmd_entries[] =
     { "split", 0, 0, G_OPTION_ARG_NONE, &(_cmd_options.split),
       "Run in split media mode. Rather than pass a single directory, take a set of"
       "directories corresponding to different volumes in a media set. "
-      "Meta data is created in the first given directory", NULL },
+      "Meta data is created in the first given directory. With --update, "
+      "old metadata of a package are reused only if they belong to "
+      "the same media.", NULL },
     { "pkglist", 'i', 0, G_OPTION_ARG_FILENAME, &(_cmd_options.pkglist),
       "Specify a text file which contains the complete list of files to "
       "include in the repository from the set found in the directory. File "
@@ -197,6 +210,33 @@ static GOptionEntry cmd_entries[] =
     { "general-compress-type", 0, 0, G_OPTION_ARG_STRING, &(_cmd_options.general_compress_type),
       "Which compression type to use (even for primary, filelists and other xml). Supported values are: bz2, gz, zstd, xz.", "COMPRESSION_TYPE" },
 #endif
+    { "compress-level", 0, 0, G_OPTION_ARG_STRING_ARRAY, &(_cmd_options.compress_levels),
+      "Compression level for metadata of the TYPE (e.g. primary, filelists, "
+      "other_db, updateinfo) or for all metadata if the TYPE is omitted. "
+      "Its range depends on the compression type. Can be used multiple times.",
+      "[TYPE=]LEVEL" },
+    { "compress-profile", 0, 0, G_OPTION_ARG_STRING_ARRAY, &(_cmd_options.compress_profiles),
+      "Compression profile (default, fast or best) for metadata of the TYPE "
+      "or for all metadata if the TYPE is omitted. Can be used multiple times.",
+      "[TYPE=]PROFILE" },
+    { "compress-strategy", 0, 0, G_OPTION_ARG_STRING_ARRAY, &(_cmd_options.compress_strategies),
+      "Compression strategy for metadata of the TYPE or for all metadata "
+      "if the TYPE is omitted: filtered, huffman, rle or fixed for gz, fast, "
+      "dfast, greedy, lazy, lazy2, btlazy2, btopt, btultra or btultra2 for "
+      "zstd. Other compression types ignore it. Can be used multiple times.",
+      "[TYPE=]STRATEGY" },
+    { "compress-buffer-size", 0, 0, G_OPTION_ARG_STRING_ARRAY, &(_cmd_options.compress_buffer_sizes),
+      "Size in bytes of the buffer of compressed data (gz, xz and zstd) "
+      "for metadata of the TYPE or for all metadata if the TYPE is omitted. "
+      "Can be used multiple times.", "[TYPE=]BYTES" },
+    { "zstd-dict", 0, 0, G_OPTION_ARG_NONE, &(_cmd_options.zstd_dict),
+      "Compress primary, filelists and other xml using zstd dictionaries "
+      "reused from (or trained on) the previous repodata. The dictionaries "
+      "are listed in repomd.xml, readers need them to decompress .zst "
+      "metadata. Zchunk files use them too, unless --zck-dict-dir is used. "
+      "WARNING: existing clients (e.g. dnf with librepo) don't download the "
+      "dictionaries and can't read dictionary compressed .zst metadata.",
+      NULL },
     { "keep-all-metadata", 0, 0, G_OPTION_ARG_NONE, &(_cmd_options.keep_all_metadata),
       "Keep all additional metadata (not primary, filelists and other xml or sqlite files, "
       "nor their compressed variants) from source repository during update (default).", NULL },
@@ -244,6 +284,39 @@ static GOptionEntry cmd_entries[] =
       NULL },
     { "duplicated-nevra", 0, 0, G_OPTION_ARG_CALLBACK, duplicated_nevra_option_parser,
       "What to do about duplicates.", NULL, },
+    { "checkpoint", 0, 0, G_OPTION_ARG_NONE, &(_cmd_options.checkpoint),
+      "Periodically save the progress into .repodata.checkpoint/ in the "
+      "outputdir. If the run is interrupted, the next run with this option "
+      "reuses metadata of already processed (and unchanged) packages "
+      "instead of reading them again.", NULL },
+    { "checkpoint-interval", 0, 0, G_OPTION_ARG_INT, &(_cmd_options.checkpoint_interval),
+      "Number of packages between two checkpoints (default: 500).", "NUM" },
+    { "metrics-file", 0, 0, G_OPTION_ARG_FILENAME, &(_cmd_options.metrics_file),
+      "Write a JSON report with per-stage timings, byte counters, cache "
+      "hit rates and queue depths of the run into FILE.", "FILE" },
+    { "snapshot", 0, 0, G_OPTION_ARG_NONE, &(_cmd_options.snapshot),
+      "Write a binary snapshot of the package metadata into repodata/ "
+      "(not listed in repomd.xml). Loading of the metadata (e.g. by --update "
+      "or mergerepo_c) uses the snapshot instead of parsing the xml files "
+      "while it matches the primary, filelists and other metadata.", NULL },
+    { "skip-unchanged", 0, 0, G_OPTION_ARG_NONE, &(_cmd_options.skip_unchanged),
+      "Store a fingerprint of the inputs (options, size, mtime and inode of "
+      "the input files) into repodata/ and don't regenerate the metadata "
+      "if the next run has the same fingerprint and repomd.xml was not "
+      "changed since.", NULL },
+    { "watch", 0, 0, G_OPTION_ARG_NONE, &(_cmd_options.watch),
+      "Don't exit after the metadata are generated, watch the input "
+      "directories and regenerate the metadata whenever they change. "
+      "Implies --update and --snapshot.", NULL },
+    { "watch-delay", 0, 0, G_OPTION_ARG_INT, &(_cmd_options.watch_delay),
+      "Number of milliseconds without any change in the input directories "
+      "after which the metadata are regenerated (default: 2000).", "MSEC" },
+    { "prefetch-depth", 0, 0, G_OPTION_ARG_INT, &(_cmd_options.prefetch_depth),
+      "Max number of packages whose reading is started ahead of the workers. "
+      "The window grows up to this value while the reads are slow and "
+      "shrinks when they are fast or the prefetched packages take too much "
+      "memory. "
+      "0 disables the prefetching (default: 64).", "NUM" },
     { NULL, 0, 0, G_OPTION_ARG_NONE, NULL, NULL, NULL },
 };
 
@@ -661,9 +734,65 @@ check_arguments(struct CmdOptions *options,
         return FALSE;
     }
 
+    // Compression levels, profiles, strategies and buffer sizes
+    options->compression_options = cr_compression_options_map_new();
+    for (x = 0; options->compress_levels && options->compress_levels[x]; x++)
+        if (!cr_compression_options_map_parse(options->compression_options,
+                                              options->compress_levels[x],
+                                              CR_CW_OPTION_LEVEL, err))
+            return FALSE;
+    for (x = 0; options->compress_profiles && options->compress_profiles[x]; x++)
+        if (!cr_compression_options_map_parse(options->compression_options,
+                                              options->compress_profiles[x],
+                                              CR_CW_OPTION_PROFILE, err))
+            return FALSE;
+    for (x = 0; options->compress_strategies && options->compress_strategies[x]; x++)
+        if (!cr_compression_options_map_parse(options->compression_options,
+                                              options->compress_strategies[x],
+                                              CR_CW_OPTION_STRATEGY, err))
+            return FALSE;
+    for (x = 0; options->compress_buffer_sizes && options->compress_buffer_sizes[x]; x++)
+        if (!cr_compression_options_map_parse(options->compression_options,
+                                              options->compress_buffer_sizes[x],
+                                              CR_CW_OPTION_BUFFER_SIZE, err))
+            return FALSE;
+
+    // Check checkpoint interval
+    if (options->checkpoint_interval < 1) {
+        g_set_error(err, ERR_DOMAIN, CRE_BADARG,
+                    "--checkpoint-interval value must be positive integer");
+        return FALSE;
+    }
+
     if (options->zck_dict_dir)
         options->zck_dict_dir = cr_normalize_dir_path(options->zck_dict_dir);
 
+    // Check watch delay
+    if (options->watch_delay < 0) {
+        g_set_error(err, ERR_DOMAIN, CRE_BADARG,
+                    "--watch-delay value must be positive integer or 0");
+        return FALSE;
+    }
+
+    // Check prefetch depth
+    if (options->prefetch_depth < 0) {
+        g_set_error(err, ERR_DOMAIN, CRE_BADARG,
+                    "--prefetch-depth value must be positive integer or 0");
+        return FALSE;
+    }
+
+    // Every regeneration reuses the unchanged packages from the previous one
+    if (options->watch) {
+        options->update = TRUE;
+        options->snapshot = TRUE;
+    }
+
+    // Content of the old package dirs is not part of the fingerprint
+    if (options->skip_unchanged && options->deltas) {
+        g_warning("--skip-unchanged has no effect with --deltas");
+        options->skip_unchanged = FALSE;
+    }
+
     return TRUE;
 }
 
@@ -684,6 +813,7 @@ free_options(struct CmdOptions *options)
     g_free(options->retain_old_md_by_age);
     g_free(options->cachedir);
     g_free(options->checksum_cachedir);
+    g_free(options->metrics_file);
 
     g_strfreev(options->excludes);
     g_strfreev(options->includepkg);
@@ -691,6 +821,10 @@ free_options(struct CmdOptions *options)
     g_strfreev(options->content_tags);
     g_strfreev(options->repo_tags);
     g_strfreev(options->oldpackagedirs);
+    g_strfreev(options->compress_levels);
+    g_strfreev(options->compress_profiles);
+    g_strfreev(options->compress_strategies);
+    g_strfreev(options->compress_buffer_sizes);
 
     cr_slist_free_full(options->include_pkgs, g_free);
     cr_slist_free_full(options->exclude_masks,
@@ -700,4 +834,5 @@ free_options(struct CmdOptions *options)
     cr_slist_free_full(options->distro_values, g_free);
     cr_slist_free_full(options->modulemd_metadata, g_free);
     g_slist_free(options->oldpackagedirs_paths);
+    cr_compression_options_map_free(options->compression_options);
 }
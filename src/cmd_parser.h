@@ -80,6 +80,7 @@ struct CmdOptions {
     gboolean xz_compression;    /*!< use xz for repodata compression */
     gboolean zck_compression;   /*!< generate zchunk files */
     char *zck_dict_dir;         /*!< directory with zchunk dictionaries */
+    gboolean zstd_dict;         /*!< use zstd dictionaries for xml metadata */
     gboolean keep_all_metadata; /*!< keep groupfile and updateinfo from source
                                      repo during update */
     gboolean discard_additional_metadata; /*!< Inverse option to keep_all_metadata */
@@ -118,6 +119,25 @@ struct CmdOptions {
                                      during repodata generation. */
     gchar *repomd_checksum;     /*!< Checksum type for entries in repomd.xml */
     gboolean error_exit_val;        /*!< exit 2 on processing errors */
+    gboolean checkpoint;        /*!< Periodically save progress into
+                                     a checkpoint dir and resume from it */
+    gint checkpoint_interval;   /*!< Number of packages between two
+                                     checkpoints */
+    char *metrics_file;         /*!< Path to the JSON metrics report */
+    gboolean snapshot;          /*!< Write a binary snapshot of the
+                                     metadata next to repomd.xml */
+    gboolean skip_unchanged;    /*!< Skip the run if the fingerprint of
+                                     the inputs is unchanged */
+    gboolean watch;             /*!< Watch the input directories and
+                                     regenerate the metadata on change */
+    gint watch_delay;           /*!< Quiet period in milliseconds before
+                                     the regeneration */
+    gint prefetch_depth;        /*!< Max number of packages prefetched
+                                     ahead of the workers */
+    char **compress_levels;     /*!< [TYPE=]LEVEL compression levels */
+    char **compress_profiles;   /*!< [TYPE=]PROFILE compression profiles */
+    char **compress_strategies; /*!< [TYPE=]STRATEGY compression strategies */
+    char **compress_buffer_sizes; /*!< [TYPE=]BYTES compression buffers */
 
     /* Items filled by check_arguments() */
 
@@ -134,6 +154,8 @@ struct CmdOptions {
     cr_ChecksumType repomd_checksum_type;   /*!< checksum type */
     cr_CompressionType compression_type;    /*!< compression type */
     cr_CompressionType general_compression_type; /*!< compression type */
+    cr_CompressionOptionsMap *compression_options; /*!< compression options
+                                     of metadata types */
     gint64 md_max_age;          /*!< Max age of files in repodata/.
                                      Older files will be removed
                                      during --update.
@@ -17,6 +17,10 @@
  * USA.
  */
 
+#if defined(HAVE_FOPENCOOKIE) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE     // fopencookie()
+#endif
+
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <stdio.h>
@@ -26,15 +30,18 @@
 #include <stdio.h>
 #include <ctype.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include <zlib.h>
 #include <bzlib.h>
 #include <lzma.h>
 #ifdef WITH_ZCHUNK
 #include <zck.h>
 #endif  // WITH_ZCHUNK
+#include "cleanup.h"
 #include "error.h"
 #include "compression_wrapper.h"
 #include <zstd.h>
+#include <zdict.h>
 
 
 #define ERR_DOMAIN                      CREATEREPO_C_ERROR
@@ -109,13 +116,123 @@ cr_contentstat_free(cr_ContentStat *cstat, GError **err)
 
     g_free(cstat->hdr_checksum);
     g_free(cstat->checksum);
+    g_free(cstat->compressed_checksum);
     g_free(cstat);
 }
 
+/** Output file that checksums the (compressed) data while they are written.
+ * This way the checksum and size of a compressed file are known right after
+ * cr_close() and the file doesn't have to be read again
+ * (see cr_repomd_record_fill()).
+ */
+typedef struct {
+    FILE *f;                    /*!< Real output file */
+    cr_ChecksumCtx *ctx;        /*!< Checksum of written data */
+    gint64 size;                /*!< Number of written bytes */
+    char *checksum;             /*!< Final checksum (set when closed) */
+} TeeFile;
+
+static void
+tee_free(TeeFile *tee)
+{
+    if (!tee)
+        return;
+    if (tee->ctx)
+        g_free(cr_checksum_final(tee->ctx, NULL));
+    g_free(tee->checksum);
+    g_free(tee);
+}
+
+#ifdef HAVE_FOPENCOOKIE
+static ssize_t
+tee_write(void *cookie, const char *buf, size_t size)
+{
+    TeeFile *tee = cookie;
+    size_t written = fwrite(buf, 1, size, tee->f);
+
+    if (written > 0) {
+        cr_checksum_update(tee->ctx, buf, written, NULL);
+        tee->size += written;
+    }
+
+    if (written == 0 && size > 0)
+        return -1;
+
+    return written;
+}
+
+static int
+tee_close(void *cookie)
+{
+    TeeFile *tee = cookie;
+    int ret = fclose(tee->f);
+
+    tee->f = NULL;
+    tee->checksum = cr_checksum_final(tee->ctx, NULL);
+    tee->ctx = NULL;
+
+    return ret;
+}
+#endif // HAVE_FOPENCOOKIE
+
+/** Open the output file of a CR_FILE. If stats are requested, the returned
+ * FILE is a wrapper that checksums all written data, otherwise it's
+ * a regular FILE.
+ */
+static FILE *
+cr_fopen_output(CR_FILE *file,
+                const char *filename,
+                const char *mode_str,
+                G_GNUC_UNUSED cr_ContentStat *stat)
+{
+#ifdef HAVE_FOPENCOOKIE
+    if (file->mode == CR_CW_MODE_WRITE
+        && stat
+        && stat->checksum_type != CR_CHECKSUM_UNKNOWN)
+    {
+        cookie_io_functions_t io_funcs = {
+            .read  = NULL,
+            .write = tee_write,
+            .seek  = NULL,
+            .close = tee_close,
+        };
+
+        cr_ChecksumCtx *ctx = cr_checksum_new(stat->checksum_type, NULL);
+        if (ctx) {
+            FILE *f = fopen(filename, mode_str);
+            if (!f) {
+                int saved_errno = errno;
+                g_free(cr_checksum_final(ctx, NULL));
+                errno = saved_errno;
+                return NULL;
+            }
+
+            TeeFile *tee = g_malloc0(sizeof(TeeFile));
+            tee->f = f;
+            tee->ctx = ctx;
+
+            FILE *tee_f = fopencookie(tee, mode_str, io_funcs);
+            if (tee_f) {
+                file->tee = tee;
+                return tee_f;
+            }
+
+            // Fallback to a regular file
+            g_free(cr_checksum_final(ctx, NULL));
+            g_free(tee);
+            return f;
+        }
+    }
+#endif // HAVE_FOPENCOOKIE
+
+    return fopen(filename, mode_str);
+}
+
 typedef struct {
     lzma_stream stream;
     FILE *file;
-    unsigned char buffer[XZ_BUFFER_SIZE];
+    unsigned char *buffer;
+    size_t buffer_size;
 } XzFile;
 
 
@@ -136,6 +253,152 @@ typedef struct {
     void * context;     //ZSTD_{C,D}Ctx
 } ZstdFile;
 
+#define ZSTD_DICT_READ_SIZE     (1024*128)
+
+/** Registered zstd dictionaries (dictionary ID -> GByteArray)
+ */
+static GHashTable *zstd_dicts = NULL;
+G_LOCK_DEFINE_STATIC(zstd_dicts);
+
+unsigned int
+cr_zstd_dict_register(const void *dict, size_t dict_size, GError **err)
+{
+    unsigned int dict_id;
+    GByteArray *copy;
+
+    assert(dict || dict_size == 0);
+    assert(!err || *err == NULL);
+
+    dict_id = ZSTD_getDictID_fromDict(dict, dict_size);
+    if (!dict_id) {
+        g_set_error(err, ERR_DOMAIN, CRE_ZSTD,
+                    "Not a zstd dictionary (no dictionary ID)");
+        return 0;
+    }
+
+    copy = g_byte_array_sized_new(dict_size);
+    g_byte_array_append(copy, dict, dict_size);
+
+    G_LOCK(zstd_dicts);
+    if (!zstd_dicts)
+        zstd_dicts = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                           NULL,
+                                           (GDestroyNotify) g_byte_array_unref);
+    g_hash_table_replace(zstd_dicts, GUINT_TO_POINTER(dict_id), copy);
+    G_UNLOCK(zstd_dicts);
+
+    g_debug("%s: Registered zstd dictionary %u (%zu bytes)",
+            __func__, dict_id, dict_size);
+
+    return dict_id;
+}
+
+void
+cr_zstd_dict_cleanup(void)
+{
+    G_LOCK(zstd_dicts);
+    g_clear_pointer(&zstd_dicts, g_hash_table_destroy);
+    G_UNLOCK(zstd_dicts);
+}
+
+/** Load a registered dictionary into the decompression context.
+ * If the dictionary is not registered, nothing is done and the error
+ * is reported by zstd once the frame is decompressed.
+ */
+static size_t
+cr_zstd_dict_load(ZSTD_DCtx *context, unsigned int dict_id)
+{
+    size_t ret = 0;
+    GByteArray *dict = NULL;
+
+    G_LOCK(zstd_dicts);
+    if (zstd_dicts)
+        dict = g_hash_table_lookup(zstd_dicts, GUINT_TO_POINTER(dict_id));
+    if (dict)
+        ret = ZSTD_DCtx_loadDictionary(context, dict->data, dict->len);
+    G_UNLOCK(zstd_dicts);
+
+    if (!dict)
+        g_debug("%s: zstd dictionary %u is not registered", __func__, dict_id);
+
+    return ret;
+}
+
+char *
+cr_zstd_dict_train(const char *filename,
+                   const char *separator,
+                   size_t capacity,
+                   size_t *dict_size,
+                   GError **err)
+{
+    CR_FILE *f;
+    int readed;
+    gsize len;
+    GString *content;
+    GArray *sizes;
+    const char *start, *next;
+    char *dict;
+    size_t ret;
+    GError *tmp_err = NULL;
+
+    assert(filename);
+    assert(separator && *separator);
+    assert(dict_size);
+    assert(!err || *err == NULL);
+
+    f = cr_open(filename, CR_CW_MODE_READ, CR_CW_AUTO_DETECT_COMPRESSION, &tmp_err);
+    if (!f) {
+        g_propagate_prefixed_error(err, tmp_err, "Cannot open %s: ", filename);
+        return NULL;
+    }
+
+    // ~100 times the dictionary size is a sufficient amount of samples
+    content = g_string_sized_new(ZSTD_DICT_READ_SIZE);
+    while (content->len < capacity * 100) {
+        len = content->len;
+        g_string_set_size(content, len + ZSTD_DICT_READ_SIZE);
+        readed = cr_read(f, content->str + len, ZSTD_DICT_READ_SIZE, &tmp_err);
+        if (readed == CR_CW_ERR) {
+            g_propagate_prefixed_error(err, tmp_err, "Cannot read %s: ", filename);
+            cr_close(f, NULL);
+            g_string_free(content, TRUE);
+            return NULL;
+        }
+        g_string_truncate(content, len + readed);
+        if (readed == 0)
+            break;
+    }
+    cr_close(f, NULL);
+
+    // One sample per separated chunk
+    sizes = g_array_new(FALSE, FALSE, sizeof(size_t));
+    start = content->str;
+    while (*start) {
+        size_t size;
+        next = strstr(start + 1, separator);
+        size = next ? (size_t) (next - start) : strlen(start);
+        g_array_append_val(sizes, size);
+        start += size;
+    }
+
+    dict = g_malloc(capacity);
+    ret = ZDICT_trainFromBuffer(dict, capacity, content->str,
+                                (size_t *) sizes->data, sizes->len);
+    g_array_free(sizes, TRUE);
+    g_string_free(content, TRUE);
+
+    if (ZDICT_isError(ret)) {
+        g_set_error(err, ERR_DOMAIN, CRE_ZSTD,
+                    "Cannot train zstd dictionary on %s: %s",
+                    filename, ZDICT_getErrorName(ret));
+        g_free(dict);
+        return NULL;
+    }
+
+    *dict_size = ret;
+    return dict;
+}
+
 cr_CompressionType
 cr_detect_compression(const char *filename, GError **err)
 {
@@ -255,6 +518,369 @@ cr_compression_type(const char *name)
     return type;
 }
 
+cr_CompressionProfile
+cr_compression_profile(const char *name)
+{
+    if (!name)
+        return CR_CW_PROFILE_SENTINEL;
+
+    if (!g_ascii_strcasecmp(name, "default"))
+        return CR_CW_PROFILE_DEFAULT;
+    if (!g_ascii_strcasecmp(name, "fast"))
+        return CR_CW_PROFILE_FAST;
+    if (!g_ascii_strcasecmp(name, "best"))
+        return CR_CW_PROFILE_BEST;
+
+    return CR_CW_PROFILE_SENTINEL;
+}
+
+static const char * const strategy_names[CR_CW_STRATEGY_SENTINEL] = {
+    [CR_CW_STRATEGY_DEFAULT]         = "default",
+    [CR_CW_STRATEGY_GZ_FILTERED]     = "filtered",
+    [CR_CW_STRATEGY_GZ_HUFFMAN_ONLY] = "huffman",
+    [CR_CW_STRATEGY_GZ_RLE]          = "rle",
+    [CR_CW_STRATEGY_GZ_FIXED]        = "fixed",
+    [CR_CW_STRATEGY_ZSTD_FAST]       = "fast",
+    [CR_CW_STRATEGY_ZSTD_DFAST]      = "dfast",
+    [CR_CW_STRATEGY_ZSTD_GREEDY]     = "greedy",
+    [CR_CW_STRATEGY_ZSTD_LAZY]       = "lazy",
+    [CR_CW_STRATEGY_ZSTD_LAZY2]      = "lazy2",
+    [CR_CW_STRATEGY_ZSTD_BTLAZY2]    = "btlazy2",
+    [CR_CW_STRATEGY_ZSTD_BTOPT]      = "btopt",
+    [CR_CW_STRATEGY_ZSTD_BTULTRA]    = "btultra",
+    [CR_CW_STRATEGY_ZSTD_BTULTRA2]   = "btultra2",
+};
+
+cr_CompressionStrategy
+cr_compression_strategy(const char *name)
+{
+    if (!name)
+        return CR_CW_STRATEGY_SENTINEL;
+
+    for (int x = 0; x < CR_CW_STRATEGY_SENTINEL; x++)
+        if (!g_ascii_strcasecmp(name, strategy_names[x]))
+            return x;
+
+    return CR_CW_STRATEGY_SENTINEL;
+}
+
+/** Options set for a metadata type (or for all of them) in
+ * cr_CompressionOptionsMap. Only the set items override the less
+ * specific ones.
+ */
+typedef struct {
+    gboolean profile_set;
+    cr_CompressionProfile profile;
+    gboolean level_set;
+    int level;
+    gboolean strategy_set;
+    cr_CompressionStrategy strategy;
+    gboolean buffer_size_set;
+    size_t buffer_size;
+} CompressionOptionsEntry;
+
+struct _cr_CompressionOptionsMap {
+    GHashTable *types;  /*!< Metadata type -> CompressionOptionsEntry,
+                             "" key is used for all types */
+};
+
+cr_CompressionOptionsMap *
+cr_compression_options_map_new(void)
+{
+    cr_CompressionOptionsMap *map = g_new0(cr_CompressionOptionsMap, 1);
+    map->types = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                       g_free, g_free);
+    return map;
+}
+
+void
+cr_compression_options_map_free(cr_CompressionOptionsMap *map)
+{
+    if (!map)
+        return;
+    g_hash_table_destroy(map->types);
+    g_free(map);
+}
+
+gboolean
+cr_compression_options_map_parse(cr_CompressionOptionsMap *map,
+                                 const char *arg,
+                                 cr_CompressionOption option,
+                                 GError **err)
+{
+    _cleanup_free_ gchar *type = NULL;
+    const char *value = arg;
+    const char *eq;
+    CompressionOptionsEntry *entry;
+
+    assert(map);
+    assert(arg);
+    assert(option < CR_CW_OPTION_SENTINEL);
+    assert(!err || *err == NULL);
+
+    eq = strchr(arg, '=');
+    if (eq) {
+        type = g_strndup(arg, eq - arg);
+        value = eq + 1;
+        if (!*type) {
+            g_set_error(err, ERR_DOMAIN, CRE_BADARG,
+                        "Missing metadata type in \"%s\"", arg);
+            return FALSE;
+        }
+    } else {
+        type = g_strdup("");
+    }
+
+    entry = g_hash_table_lookup(map->types, type);
+    if (!entry) {
+        entry = g_new0(CompressionOptionsEntry, 1);
+        g_hash_table_insert(map->types, g_strdup(type), entry);
+    }
+
+    switch (option) {
+        case CR_CW_OPTION_LEVEL: {
+            char *endptr = NULL;
+            long val;
+
+            errno = 0;
+            val = strtol(value, &endptr, 10);
+            if (!*value || *endptr || errno || val <= G_MININT || val > G_MAXINT) {
+                g_set_error(err, ERR_DOMAIN, CRE_BADARG,
+                            "Bad compression level \"%s\"", value);
+                return FALSE;
+            }
+            entry->level_set = TRUE;
+            entry->level = (int) val;
+            break;
+        }
+
+        case CR_CW_OPTION_PROFILE: {
+            cr_CompressionProfile profile = cr_compression_profile(value);
+            if (profile == CR_CW_PROFILE_SENTINEL) {
+                g_set_error(err, ERR_DOMAIN, CRE_BADARG,
+                            "Unknown compression profile \"%s\" "
+                            "(use default, fast or best)", value);
+                return FALSE;
+            }
+            entry->profile_set = TRUE;
+            entry->profile = profile;
+            break;
+        }
+
+        case CR_CW_OPTION_STRATEGY: {
+            cr_CompressionStrategy strategy = cr_compression_strategy(value);
+            if (strategy == CR_CW_STRATEGY_SENTINEL) {
+                g_set_error(err, ERR_DOMAIN, CRE_BADARG,
+                            "Unknown compression strategy \"%s\" "
+                            "(use default, filtered, huffman, rle or fixed "
+                            "for gz, fast, dfast, greedy, lazy, lazy2, "
+                            "btlazy2, btopt, btultra or btultra2 for zstd)",
+                            value);
+                return FALSE;
+            }
+            entry->strategy_set = TRUE;
+            entry->strategy = strategy;
+            break;
+        }
+
+        case CR_CW_OPTION_BUFFER_SIZE: {
+            char *endptr = NULL;
+            guint64 val;
+
+            errno = 0;
+            val = g_ascii_strtoull(value, &endptr, 10);
+            if (!g_ascii_isdigit(*value) || *endptr || errno
+                || val < CR_CW_MIN_BUFFER_SIZE || val > CR_CW_MAX_BUFFER_SIZE)
+            {
+                g_set_error(err, ERR_DOMAIN, CRE_BADARG,
+                            "Bad compression buffer size \"%s\" (use %d "
+                            "to %d bytes)", value, CR_CW_MIN_BUFFER_SIZE,
+                            CR_CW_MAX_BUFFER_SIZE);
+                return FALSE;
+            }
+            entry->buffer_size_set = TRUE;
+            entry->buffer_size = (size_t) val;
+            break;
+        }
+
+        default:
+            break;
+    }
+
+    return TRUE;
+}
+
+static void
+compression_options_apply(cr_CompressionOptions *options,
+                          GHashTable *types,
+                          const char *type)
+{
+    CompressionOptionsEntry *entry = g_hash_table_lookup(types, type);
+
+    if (!entry)
+        return;
+    if (entry->profile_set)
+        options->profile = entry->profile;
+    if (entry->level_set)
+        options->level = entry->level;
+    if (entry->strategy_set)
+        options->strategy = entry->strategy;
+    if (entry->buffer_size_set)
+        options->buffer_size = entry->buffer_size;
+}
+
+cr_CompressionOptions
+cr_compression_options_map_get(cr_CompressionOptionsMap *map,
+                               const char *type)
+{
+    cr_CompressionOptions options = {
+        .profile = CR_CW_PROFILE_DEFAULT,
+        .level = CR_CW_LEVEL_DEFAULT,
+        .strategy = CR_CW_STRATEGY_DEFAULT,
+        .buffer_size = 0,
+    };
+
+    if (!map)
+        return options;
+
+    // From the least to the most specific
+    compression_options_apply(&options, map->types, "");
+
+    if (type) {
+        _cleanup_free_ gchar *base = NULL;
+
+        if (g_str_has_suffix(type, "_db"))
+            base = g_strndup(type, strlen(type) - 3);
+        else if (g_str_has_suffix(type, "_zck"))
+            base = g_strndup(type, strlen(type) - 4);
+
+        if (base)
+            compression_options_apply(&options, map->types, base);
+        compression_options_apply(&options, map->types, type);
+    }
+
+    return options;
+}
+
+/** Compression level for the compression type. The level of the profile
+ * is used if the level is not set explicitly, explicit levels are clamped
+ * into the range supported by the compression type.
+ */
+static int
+cr_compression_level(const cr_CompressionOptions *options,
+                     cr_CompressionType type)
+{
+    cr_CompressionProfile profile = CR_CW_PROFILE_DEFAULT;
+    int level = CR_CW_LEVEL_DEFAULT;
+    int fast, best, def, min, max;
+
+    if (options) {
+        profile = options->profile;
+        level = options->level;
+    }
+
+    switch (type) {
+        case CR_CW_GZ_COMPRESSION:
+            fast = Z_BEST_SPEED;
+            best = Z_BEST_COMPRESSION;
+            def  = CR_CW_GZ_COMPRESSION_LEVEL;
+            min  = Z_BEST_SPEED;
+            max  = Z_BEST_COMPRESSION;
+            break;
+        case CR_CW_BZ2_COMPRESSION:
+            fast = 1;
+            best = 9;
+            def  = BZ2_BLOCKSIZE100K;
+            min  = 1;
+            max  = 9;
+            break;
+        case CR_CW_XZ_COMPRESSION:
+            fast = 0;
+            best = 9;
+            def  = CR_CW_XZ_COMPRESSION_LEVEL;
+            min  = 0;
+            max  = 9;
+            break;
+        case CR_CW_ZSTD_COMPRESSION:
+        case CR_CW_ZCK_COMPRESSION:
+            fast = 1;
+            best = 19;
+            def  = CR_CW_ZSTD_COMPRESSION_LEVEL;
+            min  = ZSTD_minCLevel();
+            max  = ZSTD_maxCLevel();
+            break;
+        default:
+            return 0;
+    }
+
+    if (level == CR_CW_LEVEL_DEFAULT) {
+        switch (profile) {
+            case CR_CW_PROFILE_FAST:
+                return fast;
+            case CR_CW_PROFILE_BEST:
+                return best;
+            default:
+                return def;
+        }
+    }
+
+    if (level < min || level > max) {
+        int clamped = CLAMP(level, min, max);
+        g_debug("%s: Compression level %d is out of range for %s, "
+                "%d is used", __func__, level,
+                cr_compression_suffix(type), clamped);
+        level = clamped;
+    }
+
+    return level;
+}
+
+/** Size of the buffer of compressed data, def if not set.
+ */
+static size_t
+cr_compression_buffer_size(const cr_CompressionOptions *options, size_t def)
+{
+    if (!options || !options->buffer_size)
+        return def;
+    return CLAMP(options->buffer_size, CR_CW_MIN_BUFFER_SIZE,
+                 CR_CW_MAX_BUFFER_SIZE);
+}
+
+/** zlib strategy (Z_DEFAULT_STRATEGY if a strategy of another
+ * compression type is set).
+ */
+static int
+cr_gz_strategy(const cr_CompressionOptions *options)
+{
+    switch (options ? options->strategy : CR_CW_STRATEGY_DEFAULT) {
+        case CR_CW_STRATEGY_GZ_FILTERED:        return Z_FILTERED;
+        case CR_CW_STRATEGY_GZ_HUFFMAN_ONLY:    return Z_HUFFMAN_ONLY;
+        case CR_CW_STRATEGY_GZ_RLE:             return Z_RLE;
+        case CR_CW_STRATEGY_GZ_FIXED:           return Z_FIXED;
+        default:                                return GZ_STRATEGY;
+    }
+}
+
+/** ZSTD_strategy or 0 (the strategy of the level) if no zstd strategy
+ * is set.
+ */
+static int
+cr_zstd_strategy(const cr_CompressionOptions *options)
+{
+    switch (options ? options->strategy : CR_CW_STRATEGY_DEFAULT) {
+        case CR_CW_STRATEGY_ZSTD_FAST:          return ZSTD_fast;
+        case CR_CW_STRATEGY_ZSTD_DFAST:         return ZSTD_dfast;
+        case CR_CW_STRATEGY_ZSTD_GREEDY:        return ZSTD_greedy;
+        case CR_CW_STRATEGY_ZSTD_LAZY:          return ZSTD_lazy;
+        case CR_CW_STRATEGY_ZSTD_LAZY2:         return ZSTD_lazy2;
+        case CR_CW_STRATEGY_ZSTD_BTLAZY2:       return ZSTD_btlazy2;
+        case CR_CW_STRATEGY_ZSTD_BTOPT:         return ZSTD_btopt;
+        case CR_CW_STRATEGY_ZSTD_BTULTRA:       return ZSTD_btultra;
+        case CR_CW_STRATEGY_ZSTD_BTULTRA2:      return ZSTD_btultra2;
+        default:                                return 0;
+    }
+}
+
 const char *
 cr_compression_suffix(cr_CompressionType comtype)
 {
@@ -318,10 +944,22 @@ cr_sopen(const char *filename,
          cr_CompressionType comtype,
          cr_ContentStat *stat,
          GError **err)
+{
+    return cr_sopen_with_options(filename, mode, comtype, stat, NULL, err);
+}
+
+CR_FILE *
+cr_sopen_with_options(const char *filename,
+                      cr_OpenMode mode,
+                      cr_CompressionType comtype,
+                      cr_ContentStat *stat,
+                      const cr_CompressionOptions *options,
+                      GError **err)
 {
     CR_FILE *file = NULL;
     cr_CompressionType type = comtype;
     GError *tmp_err = NULL;
+    gboolean best = (options && options->profile == CR_CW_PROFILE_BEST);
 
     assert(filename);
     assert(mode == CR_CW_MODE_READ || mode == CR_CW_MODE_WRITE);
@@ -384,7 +1022,8 @@ cr_sopen(const char *filename,
 
         case (CR_CW_NO_COMPRESSION): // ---------------------------------------
             mode_str = (mode == CR_CW_MODE_WRITE) ? "w" : "r";
-            file->FILE = (void *) fopen(filename, mode_str);
+            file->FILE = (void *) cr_fopen_output(file, filename,
+                                                  mode_str, stat);
             if (!file->FILE)
                 g_set_error(err, ERR_DOMAIN, CRE_IO,
                             "fopen(): %s", g_strerror(errno));
@@ -400,10 +1039,11 @@ cr_sopen(const char *filename,
 
             if (mode == CR_CW_MODE_WRITE)
                 gzsetparams((gzFile) file->FILE,
-                            CR_CW_GZ_COMPRESSION_LEVEL,
-                            GZ_STRATEGY);
+                            cr_compression_level(options, type),
+                            cr_gz_strategy(options));
 
-            if (gzbuffer((gzFile) file->FILE, GZ_BUFFER_SIZE) == -1) {
+            if (gzbuffer((gzFile) file->FILE,
+                         cr_compression_buffer_size(options, GZ_BUFFER_SIZE)) == -1) {
                 g_debug("%s: gzbuffer() call failed", __func__);
                 g_set_error(err, ERR_DOMAIN, CRE_GZ,
                             "gzbuffer() call failed");
@@ -411,7 +1051,7 @@ cr_sopen(const char *filename,
             break;
 
         case (CR_CW_ZSTD_COMPRESSION): { // ------------------------------------
-            FILE *f = fopen(filename, mode_str);
+            FILE *f = cr_fopen_output(file, filename, mode_str, stat);
 
             if (!f) {
                 g_set_error(err, ERR_DOMAIN, CRE_IO, "fopen(): %s", g_strerror(errno));
@@ -430,7 +1070,16 @@ cr_sopen(const char *filename,
                     fclose(f);
                     break;
                 }
-                size_t ret = ZSTD_CCtx_setParameter(zstd_file->context, ZSTD_c_compressionLevel, CR_CW_ZSTD_COMPRESSION_LEVEL);
+                size_t ret = ZSTD_CCtx_setParameter(zstd_file->context, ZSTD_c_compressionLevel, cr_compression_level(options, type));
+                // Long distance matching helps a lot with the repetitive
+                // content of filelists (the default 128 MiB window is
+                // still decompressible without any special options)
+                if (!ZSTD_isError(ret) && best)
+                    ret = ZSTD_CCtx_setParameter(zstd_file->context, ZSTD_c_enableLongDistanceMatching, 1);
+                if (!ZSTD_isError(ret) && cr_zstd_strategy(options))
+                    ret = ZSTD_CCtx_setParameter(zstd_file->context, ZSTD_c_strategy, cr_zstd_strategy(options));
+                if (!ZSTD_isError(ret) && options && options->dict)
+                    ret = ZSTD_CCtx_loadDictionary(zstd_file->context, options->dict, options->dict_size);
                 if (ZSTD_isError(ret)) {
                     g_set_error(err, ERR_DOMAIN, CRE_ZSTD, "%s",
                             ZSTD_getErrorName(ret));
@@ -438,7 +1087,7 @@ cr_sopen(const char *filename,
                     fclose(f);
                     break;
                 }
-                zstd_file->buffer_size = ZSTD_CStreamOutSize();
+                zstd_file->buffer_size = cr_compression_buffer_size(options, ZSTD_CStreamOutSize());
             } else {
                 if ((zstd_file->context = (void *) ZSTD_createDCtx()) == NULL) {
                     g_free(zstd_file);
@@ -447,16 +1096,42 @@ cr_sopen(const char *filename,
                             "Failed to create ZSTD context.");
                     break;
                 }
-                zstd_file->buffer_size = ZSTD_DStreamInSize();
+                zstd_file->buffer_size = cr_compression_buffer_size(options, ZSTD_DStreamInSize());
+                zstd_file->buffer = g_malloc(zstd_file->buffer_size);
+
+                // Prefill the input buffer to find out which dictionary
+                // (if any) the frame needs
+                zstd_file->zib.src = zstd_file->buffer;
+                zstd_file->zib.size = fread(zstd_file->buffer, 1, zstd_file->buffer_size, f);
+                zstd_file->zib.pos = 0;
+
+                size_t ret = 0;
+                if (options && options->dict) {
+                    ret = ZSTD_DCtx_loadDictionary(zstd_file->context, options->dict, options->dict_size);
+                } else {
+                    unsigned int dict_id = ZSTD_getDictID_fromFrame(zstd_file->zib.src, zstd_file->zib.size);
+                    if (dict_id)
+                        ret = cr_zstd_dict_load(zstd_file->context, dict_id);
+                }
+                if (ZSTD_isError(ret)) {
+                    g_set_error(err, ERR_DOMAIN, CRE_ZSTD, "%s",
+                            ZSTD_getErrorName(ret));
+                    ZSTD_freeDCtx(zstd_file->context);
+                    g_free(zstd_file->buffer);
+                    g_free(zstd_file);
+                    fclose(f);
+                    break;
+                }
             }
-            zstd_file->buffer = g_malloc(zstd_file->buffer_size);
+            if (!zstd_file->buffer)
+                zstd_file->buffer = g_malloc(zstd_file->buffer_size);
             file->FILE = (void *) zstd_file;
 
             break;
         }
 
         case (CR_CW_BZ2_COMPRESSION): { // ------------------------------------
-            FILE *f = fopen(filename, mode_str);
+            FILE *f = cr_fopen_output(file, filename, mode_str, stat);
             file->INNERFILE = f;
             int bzerror;
 
@@ -469,7 +1144,7 @@ cr_sopen(const char *filename,
             if (mode == CR_CW_MODE_WRITE) {
                 file->FILE = (void *) BZ2_bzWriteOpen(&bzerror,
                                                       f,
-                                                      BZ2_BLOCKSIZE100K,
+                                                      cr_compression_level(options, type),
                                                       BZ2_VERBOSITY,
                                                       BZ2_WORK_FACTOR);
             } else {
@@ -524,6 +1199,9 @@ cr_sopen(const char *filename,
             // Prepare coder/decoder
 
             if (mode == CR_CW_MODE_WRITE) {
+                uint32_t preset = cr_compression_level(options, type);
+                if (best)
+                    preset |= LZMA_PRESET_EXTREME;
 
 #ifdef ENABLE_THREADED_XZ_ENCODER
                 // The threaded encoder takes the options as pointer to
@@ -544,9 +1222,13 @@ cr_sopen(const char *filename,
                     // information how to choose a reasonable timeout.
                     .timeout = 0,
 
-                    // Use the default preset (6) for LZMA2.
+                    // Use the default preset (6) for LZMA2 unless
+                    // the options say otherwise.
                     // To use a preset, filters must be set to NULL.
-                    .preset = LZMA_PRESET_DEFAULT,
+                    .preset = (options
+                               && (options->profile != CR_CW_PROFILE_DEFAULT
+                                   || options->level != CR_CW_LEVEL_DEFAULT))
+                              ? preset : LZMA_PRESET_DEFAULT,
                     .filters = NULL,
 
                     // Integrity checking.
@@ -574,7 +1256,7 @@ cr_sopen(const char *filename,
 #endif
                     // Initialize the single-threaded encoder
                     ret = lzma_easy_encoder(stream,
-                                            CR_CW_XZ_COMPRESSION_LEVEL,
+                                            preset,
                                             XZ_CHECK);
 
             } else {
@@ -613,7 +1295,7 @@ cr_sopen(const char *filename,
 
             // Open input/output file
 
-            FILE *f = fopen(filename, mode_str);
+            FILE *f = cr_fopen_output(file, filename, mode_str, stat);
             if (!f) {
                 g_set_error(err, ERR_DOMAIN, CRE_XZ,
                             "fopen(): %s", g_strerror(errno));
@@ -623,6 +1305,8 @@ cr_sopen(const char *filename,
             }
 
             xz_file->file = f;
+            xz_file->buffer_size = cr_compression_buffer_size(options, XZ_BUFFER_SIZE);
+            xz_file->buffer = g_malloc(xz_file->buffer_size);
             file->FILE = (void *) xz_file;
             break;
         }
@@ -645,7 +1329,7 @@ cr_sopen(const char *filename,
                 if (!file->FILE || !zck_init_write(zck, fd) ||
                    !zck_set_ioption(zck, ZCK_MANUAL_CHUNK, 1) ||
                    !zck_set_ioption(zck, ZCK_COMP_TYPE, ZCK_COMP_ZSTD) ||
-                   !zck_set_ioption(zck, ZCK_ZSTD_COMP_LEVEL, CR_CW_ZSTD_COMPRESSION_LEVEL)) {
+                   !zck_set_ioption(zck, ZCK_ZSTD_COMP_LEVEL, cr_compression_level(options, type))) {
                     zck_set_log_fd(STDOUT_FILENO);
                     g_set_error(err, ERR_DOMAIN, CRE_IO, "%s",
                                 zck_get_error(zck));
@@ -675,6 +1359,7 @@ cr_sopen(const char *filename,
         if (err && *err == NULL)
             g_set_error(err, ERR_DOMAIN, CRE_XZ,
                         "Unknown error while opening: %s", filename);
+        tee_free(file->tee);
         g_free(file);
         return NULL;
     }
@@ -750,6 +1435,21 @@ cr_set_dict(CR_FILE *cr_file, const void *dict, unsigned int len, GError **err)
 #endif // WITH_ZCHUNK
         }
 
+        case (CR_CW_ZSTD_COMPRESSION): { // -----------------------------------
+            ZstdFile *zstd = (ZstdFile *) cr_file->FILE;
+            size_t rc;
+            if (cr_file->mode == CR_CW_MODE_WRITE)
+                rc = ZSTD_CCtx_loadDictionary(zstd->context, dict, len);
+            else
+                rc = ZSTD_DCtx_loadDictionary(zstd->context, dict, len);
+            if (ZSTD_isError(rc)) {
+                ret = CRE_ERROR;
+                g_set_error(err, ERR_DOMAIN, CRE_ZSTD,
+                            "Error setting dict: %s", ZSTD_getErrorName(rc));
+            }
+            break;
+        }
+
         default: { // ---------------------------------------------------------
             ret = CRE_ERROR;
             g_set_error(err, ERR_DOMAIN, CRE_ERROR,
@@ -885,7 +1585,7 @@ cr_close(CR_FILE *cr_file, GError **err)
                 // Write out rest of buffer
                 while (1) {
                     stream->next_out = (uint8_t*) xz_file->buffer;
-                    stream->avail_out = XZ_BUFFER_SIZE;
+                    stream->avail_out = xz_file->buffer_size;
 
                     rc = lzma_code(stream, LZMA_FINISH);
 
@@ -925,7 +1625,7 @@ cr_close(CR_FILE *cr_file, GError **err)
                         break;
                     }
 
-                    size_t olen = XZ_BUFFER_SIZE - stream->avail_out;
+                    size_t olen = xz_file->buffer_size - stream->avail_out;
                     if (fwrite(xz_file->buffer, 1, olen, xz_file->file) != olen) {
                         // Error while writing
                         ret = CRE_XZ;
@@ -946,6 +1646,7 @@ cr_close(CR_FILE *cr_file, GError **err)
 
             fclose(xz_file->file);
             lzma_end(stream);
+            g_free(xz_file->buffer);
             g_free(stream);
             break;
         }
@@ -1008,8 +1709,19 @@ cr_close(CR_FILE *cr_file, GError **err)
                                                         NULL);
         else
             cr_file->stat->checksum = NULL;
+
+        g_free(cr_file->stat->compressed_checksum);
+        cr_file->stat->compressed_checksum = NULL;
+        cr_file->stat->compressed_size = 0;
+        if (cr_file->tee && ret == CRE_OK) {
+            TeeFile *tee = cr_file->tee;
+            cr_file->stat->compressed_checksum = tee->checksum;
+            cr_file->stat->compressed_size = tee->size;
+            tee->checksum = NULL;
+        }
     }
 
+    tee_free(cr_file->tee);
     g_free(cr_file);
 
     assert(!err || (ret != CRE_OK && *err != NULL)
@@ -1147,7 +1859,7 @@ cr_read(CR_FILE *cr_file, void *buffer, unsigned int len, GError **err)
 
                 // Fill input buffer
                 if (stream->avail_in == 0) {
-                    if ((lret = fread(xz_file->buffer, 1, XZ_BUFFER_SIZE, xz_file->file)) < 0) {
+                    if ((lret = fread(xz_file->buffer, 1, xz_file->buffer_size, xz_file->file)) < 0) {
                         g_debug("%s: XZ: Error while fread", __func__);
                         g_set_error(err, ERR_DOMAIN, CRE_XZ,
                                     "XZ: fread(): %s", g_strerror(errno));
@@ -1396,7 +2108,7 @@ cr_write(CR_FILE *cr_file, const void *buffer, unsigned int len, GError **err)
             while (stream->avail_in) {
                 int lret;
                 stream->next_out = xz_file->buffer;
-                stream->avail_out = XZ_BUFFER_SIZE;
+                stream->avail_out = xz_file->buffer_size;
                 lret = lzma_code(stream, LZMA_RUN);
                 if (lret != LZMA_OK) {
                     const char *err_msg;
@@ -1433,7 +2145,7 @@ cr_write(CR_FILE *cr_file, const void *buffer, unsigned int len, GError **err)
                     break;   // Error while coding
                 }
 
-                size_t out_len = XZ_BUFFER_SIZE - stream->avail_out;
+                size_t out_len = xz_file->buffer_size - stream->avail_out;
                 if ((fwrite(xz_file->buffer, 1, out_len, xz_file->file)) != out_len) {
                     ret = CR_CW_ERR;
                     g_set_error(err, ERR_DOMAIN, CRE_XZ,
@@ -54,6 +54,90 @@ typedef enum {
     CR_CW_MODE_SENTINEL,        /*!< Sentinel of the list */
 } cr_OpenMode;
 
+/** Compression profile. Selects the compression level (if it is not
+ * set explicitly) and additional settings of the compression algorithm.
+ */
+typedef enum {
+    CR_CW_PROFILE_DEFAULT,      /*!< Built-in defaults */
+    CR_CW_PROFILE_FAST,         /*!< Fastest compression (e.g. gz -1,
+                                     xz -0, zstd -1) */
+    CR_CW_PROFILE_BEST,         /*!< Best ratio (e.g. gz -9, xz -9e,
+                                     zstd -19 --long) */
+    CR_CW_PROFILE_SENTINEL,     /*!< Sentinel of the list */
+} cr_CompressionProfile;
+
+/** Compression strategy. A strategy tunes the algorithm of one
+ * compression type, the other types ignore it.
+ */
+typedef enum {
+    CR_CW_STRATEGY_DEFAULT,         /*!< Default of the compression type */
+    CR_CW_STRATEGY_GZ_FILTERED,     /*!< gz: Z_FILTERED */
+    CR_CW_STRATEGY_GZ_HUFFMAN_ONLY, /*!< gz: Z_HUFFMAN_ONLY */
+    CR_CW_STRATEGY_GZ_RLE,          /*!< gz: Z_RLE */
+    CR_CW_STRATEGY_GZ_FIXED,        /*!< gz: Z_FIXED */
+    CR_CW_STRATEGY_ZSTD_FAST,       /*!< zstd: ZSTD_fast */
+    CR_CW_STRATEGY_ZSTD_DFAST,      /*!< zstd: ZSTD_dfast */
+    CR_CW_STRATEGY_ZSTD_GREEDY,     /*!< zstd: ZSTD_greedy */
+    CR_CW_STRATEGY_ZSTD_LAZY,       /*!< zstd: ZSTD_lazy */
+    CR_CW_STRATEGY_ZSTD_LAZY2,      /*!< zstd: ZSTD_lazy2 */
+    CR_CW_STRATEGY_ZSTD_BTLAZY2,    /*!< zstd: ZSTD_btlazy2 */
+    CR_CW_STRATEGY_ZSTD_BTOPT,      /*!< zstd: ZSTD_btopt */
+    CR_CW_STRATEGY_ZSTD_BTULTRA,    /*!< zstd: ZSTD_btultra */
+    CR_CW_STRATEGY_ZSTD_BTULTRA2,   /*!< zstd: ZSTD_btultra2 */
+    CR_CW_STRATEGY_SENTINEL,        /*!< Sentinel of the list */
+} cr_CompressionStrategy;
+
+/** Item of cr_CompressionOptions set by
+ * cr_compression_options_map_parse().
+ */
+typedef enum {
+    CR_CW_OPTION_PROFILE,           /*!< Compression profile */
+    CR_CW_OPTION_LEVEL,             /*!< Compression level */
+    CR_CW_OPTION_STRATEGY,          /*!< Compression strategy */
+    CR_CW_OPTION_BUFFER_SIZE,       /*!< Size of the compression buffer */
+    CR_CW_OPTION_SENTINEL,          /*!< Sentinel of the list */
+} cr_CompressionOption;
+
+/** Limits of the size of the compression buffer.
+ */
+#define CR_CW_MIN_BUFFER_SIZE   (4*1024)
+#define CR_CW_MAX_BUFFER_SIZE   (64*1024*1024)
+
+/** Compression level value which means "use the level of the profile".
+ */
+#define CR_CW_LEVEL_DEFAULT     G_MININT
+
+/** Compression options used when a file is opened for writing.
+ */
+typedef struct {
+    cr_CompressionProfile profile;  /*!< Compression profile */
+    int level;                      /*!< Compression level (its meaning
+                                         and range depend on the compression
+                                         type, out of range values are
+                                         clamped) or CR_CW_LEVEL_DEFAULT */
+    cr_CompressionStrategy strategy;/*!< Compression strategy */
+    size_t buffer_size;             /*!< Size of the buffer of compressed
+                                         data for gz, xz and zstd (between
+                                         CR_CW_MIN_BUFFER_SIZE and
+                                         CR_CW_MAX_BUFFER_SIZE) or 0 for
+                                         the default */
+    const void *dict;               /*!< zstd dictionary (not copied, has
+                                         to live until the file is closed)
+                                         or NULL */
+    size_t dict_size;               /*!< Size of the dict */
+} cr_CompressionOptions;
+
+/** Maximal size of a trained zstd dictionary.
+ */
+#define CR_CW_ZSTD_DICT_SIZE    (64*1024)
+
+/** Compression options for particular metadata types. Options of
+ * a type are looked up by its full name (e.g. "filelists_db"), then by
+ * the name without "_db" or "_zck" suffix ("filelists") and finally
+ * the options set for all types are used.
+ */
+typedef struct _cr_CompressionOptionsMap cr_CompressionOptionsMap;
+
 /** Stat build about open content during compression (writing).
  */
 typedef struct {
@@ -63,6 +147,11 @@ typedef struct {
     gint64          hdr_size;           /*!< Size of content */
     cr_ChecksumType hdr_checksum_type;  /*!< Checksum type */
     char            *hdr_checksum;      /*!< Checksum */
+    gint64          compressed_size;    /*!< Size of written (compressed)
+                                             file */
+    char            *compressed_checksum; /*!< Checksum (checksum_type) of
+                                             written (compressed) file or
+                                             NULL if it wasn't computed */
 } cr_ContentStat;
 
 /** Creates new cr_ContentStat object
@@ -88,6 +177,8 @@ typedef struct {
     cr_OpenMode         mode;           /*!< Mode */
     cr_ContentStat      *stat;          /*!< Content stats */
     cr_ChecksumCtx      *checksum_ctx;  /*!< Checksum context */
+    void                *tee;           /*!< Checksum of written compressed
+                                             data (only if stat is used) */
 } CR_FILE;
 
 #define CR_CW_ERR       -1      /*!< Return value - Error */
@@ -111,6 +202,56 @@ cr_CompressionType cr_detect_compression(const char* filename, GError **err);
  */
 cr_CompressionType cr_compression_type(const char *name);
 
+/** Return compression profile.
+ * @param name      profile name ("default", "fast" or "best")
+ * @return          compression profile or CR_CW_PROFILE_SENTINEL
+ */
+cr_CompressionProfile cr_compression_profile(const char *name);
+
+/** Return compression strategy.
+ * @param name      strategy name ("default", for gz "filtered", "huffman",
+ *                  "rle" and "fixed", for zstd "fast", "dfast", "greedy",
+ *                  "lazy", "lazy2", "btlazy2", "btopt", "btultra" and
+ *                  "btultra2")
+ * @return          compression strategy or CR_CW_STRATEGY_SENTINEL
+ */
+cr_CompressionStrategy cr_compression_strategy(const char *name);
+
+/** Creates new empty cr_CompressionOptionsMap.
+ * @return          cr_CompressionOptionsMap object
+ */
+cr_CompressionOptionsMap *cr_compression_options_map_new(void);
+
+/** Frees cr_CompressionOptionsMap.
+ * @param map       cr_CompressionOptionsMap object or NULL
+ */
+void cr_compression_options_map_free(cr_CompressionOptionsMap *map);
+
+/** Parse a value of a --compress-level, --compress-profile,
+ * --compress-strategy or --compress-buffer-size command line option and
+ * store it into the map. The format is "[TYPE=]VALUE", without the TYPE
+ * the value is used for all metadata types.
+ * @param map       cr_CompressionOptionsMap object
+ * @param arg       argument, e.g. "9", "filelists=19", "fast", "rle"
+ *                  or "other=1048576"
+ * @param option    which option the VALUE sets
+ * @param err       GError **
+ * @return          TRUE on success, FALSE otherwise
+ */
+gboolean cr_compression_options_map_parse(cr_CompressionOptionsMap *map,
+                                          const char *arg,
+                                          cr_CompressionOption option,
+                                          GError **err);
+
+/** Get compression options for the metadata type.
+ * @param map       cr_CompressionOptionsMap object or NULL
+ * @param type      metadata type (e.g. "primary", "other_db", ...)
+ * @return          compression options (defaults if nothing was set)
+ */
+cr_CompressionOptions cr_compression_options_map_get(
+                                        cr_CompressionOptionsMap *map,
+                                        const char *type);
+
 /** Open/Create the specified file.
  * @param FILENAME      filename
  * @param MODE          open mode
@@ -124,6 +265,12 @@ cr_CompressionType cr_compression_type(const char *name);
 /** Open/Create the specified file. If opened for writting, you can pass
  * a cr_ContentStat object and after cr_close() get stats of
  * an open content (stats of uncompressed content).
+ * Where the platform allows it, size and checksum of the written
+ * (compressed) file are computed as well (compressed_size and
+ * compressed_checksum). This is not supported for gz (zlib writes to
+ * the file descriptor by itself) and zck (its header is rewritten after
+ * the data), compressed_checksum stays NULL and cr_repomd_record_fill()
+ * reads such files again.
  * @param filename      filename
  * @param mode          open mode
  * @param comtype       type of compression
@@ -137,7 +284,25 @@ CR_FILE *cr_sopen(const char *filename,
                   cr_ContentStat *stat,
                   GError **err);
 
-/** Sets the compression dictionary for a file
+/** Same as cr_sopen() but with compression options.
+ * @param filename      filename
+ * @param mode          open mode
+ * @param comtype       type of compression
+ * @param stat          pointer to cr_ContentStat or NULL
+ * @param options       compression options (used only in the write mode)
+ *                      or NULL for defaults
+ * @param err           GError **
+ * @return              pointer to a CR_FILE or NULL
+ */
+CR_FILE *cr_sopen_with_options(const char *filename,
+                               cr_OpenMode mode,
+                               cr_CompressionType comtype,
+                               cr_ContentStat *stat,
+                               const cr_CompressionOptions *options,
+                               GError **err);
+
+/** Sets the compression dictionary for a file (zck or zstd). For zstd,
+ * it has to be called before the first read or write.
  * @param cr_file       CR_FILE pointer
  * @param dict          dictionary
  * @param len           length of dictionary
@@ -146,6 +311,41 @@ CR_FILE *cr_sopen(const char *filename,
  */
 int cr_set_dict(CR_FILE *cr_file, const void *dict, unsigned int len, GError **err);
 
+/** Register a zstd dictionary. Zstd files compressed with the dictionary
+ * (i.e. their frames reference its dictionary ID) are then read by
+ * cr_open() without any further setup. The dictionary is copied.
+ * @param dict          dictionary
+ * @param dict_size     size of the dictionary
+ * @param err           GError **
+ * @return              dictionary ID or 0 if the dict is not a zstd
+ *                      dictionary
+ */
+unsigned int cr_zstd_dict_register(const void *dict,
+                                   size_t dict_size,
+                                   GError **err);
+
+/** Free all the dictionaries registered by cr_zstd_dict_register().
+ * Call it once no zstd file is read anymore.
+ */
+void cr_zstd_dict_cleanup(void);
+
+/** Train a zstd dictionary on the content of a (possibly compressed)
+ * metadata file. The content is split into samples at every occurrence of
+ * the separator, e.g. "<package" gives one sample per package. Only
+ * the beginning of big files is used.
+ * @param filename      metadata file
+ * @param separator     sample separator
+ * @param capacity      maximal size of the dictionary
+ * @param dict_size     size of the trained dictionary
+ * @param err           GError **
+ * @return              newly allocated dictionary or NULL
+ */
+char *cr_zstd_dict_train(const char *filename,
+                         const char *separator,
+                         size_t capacity,
+                         size_t *dict_size,
+                         GError **err);
+
 /** Reads an array of len bytes from the CR_FILE.
  * @param cr_file       CR_FILE pointer
  * @param buffer        target buffer
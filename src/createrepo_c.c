@@ -30,6 +30,9 @@
 #include <fcntl.h>
 #include <stdint.h>
 #include <unistd.h>
+#include <sys/wait.h>
+#include "checkpoint.h"
+#include "fingerprint.h"
 #include "cmd_parser.h"
 #include "compression_wrapper.h"
 #include "createrepo_shared.h"
@@ -41,14 +44,18 @@
 #include "helpers.h"
 #include "load_metadata.h"
 #include "metadata_internal.h"
+#include "metrics.h"
 #include "locate_metadata.h"
 #include "misc.h"
 #include "parsepkg.h"
+#include "prefetch.h"
 #include "repomd.h"
 #include "repomd_internal.h"
+#include "snapshot.h"
 #include "sqlite.h"
 #include "threads.h"
 #include "version.h"
+#include "watch.h"
 #include "xml_dump.h"
 #include "xml_file.h"
 
@@ -142,6 +149,12 @@ task_cmp(gconstpointer a_p, gconstpointer b_p)
  * @param cmd_options       Options specified on command line
  * @param current_pkglist   Pointer to a list where basenames of files that
  *                          will be processed will be appended to.
+ * @param checkpoint        Checkpoint where the ordered list of tasks
+ *                          is recorded (or NULL)
+ * @param fingerprint       Fingerprint where the ordered list of input
+ *                          files is recorded (or NULL)
+ * @param prefetch          Prefetcher where the ordered list of tasks
+ *                          is registered (or NULL)
  * @return                  Number of packages that are going to be processed
  */
 static long
@@ -150,7 +163,10 @@ fill_pool(GThreadPool *pool,
           struct CmdOptions *cmd_options,
           GSList **current_pkglist,
           long *task_count,
-          int  media_id)
+          int  media_id,
+          cr_Checkpoint *checkpoint,
+          cr_Fingerprint *fingerprint,
+          cr_Prefetch *prefetch)
 {
     GArray *package_tasks = g_array_new(FALSE, FALSE, sizeof(struct PoolTask *));
     struct PoolTask *task;
@@ -320,6 +336,9 @@ fill_pool(GThreadPool *pool,
         task = g_array_index(package_tasks, struct PoolTask *, i);
         task->id = *task_count;
         task->media_id = media_id;
+        cr_checkpoint_add_task(checkpoint, task->full_path);
+        cr_fingerprint_add_file(fingerprint, task->full_path);
+        cr_prefetch_add(prefetch, task->full_path, media_id);
         g_thread_pool_push(pool, task, NULL);
         ++*task_count;
     }
@@ -505,6 +524,168 @@ load_old_metadata(cr_Metadata **md,
               g_hash_table_size(cr_metadata_hashtable(*md)));
 }
 
+/** Write the snapshot (--snapshot) of the packages of the new metadata
+ * into the repodata directory.
+ */
+static void
+write_snapshot(cr_SnapshotWriter *snapshot,
+               const char *repodata_dir,
+               cr_Repomd *repomd,
+               cr_Metrics *metrics)
+{
+    GError *tmp_err = NULL;
+    gint64 stage_start = g_get_monotonic_time();
+    _cleanup_free_ gchar *path = NULL;
+
+    path = g_build_filename(repodata_dir, CR_SNAPSHOT_FILENAME, NULL);
+    if (cr_snapshot_writer_write(snapshot, path, repomd, &tmp_err) != CRE_OK) {
+        g_warning("Cannot write snapshot %s: %s", path, tmp_err->message);
+        g_clear_error(&tmp_err);
+    }
+    cr_metrics_observe_since(metrics, "snapshot", stage_start);
+}
+
+/** Canonical absolute path of the path (see realpath(3)). If the path
+ * doesn't exist (yet), only its directory is resolved.
+ */
+static gchar *
+canonical_path(const char *path)
+{
+    _cleanup_free_ gchar *dirname = NULL;
+    _cleanup_free_ gchar *basename = NULL;
+    gchar *canonical;
+    char *resolved;
+
+    resolved = realpath(path, NULL);
+    if (resolved) {
+        canonical = g_strdup(resolved);
+        free(resolved);
+        return canonical;
+    }
+
+    dirname = g_path_get_dirname(path);
+    basename = g_path_get_basename(path);
+    resolved = realpath(dirname, NULL);
+    if (!resolved)
+        return g_strdup(path);
+
+    canonical = g_build_filename(resolved, basename, NULL);
+    free(resolved);
+    return canonical;
+}
+
+/** Keep the repodata up to date (--watch). Every regeneration is done
+ * by a forked child which continues with the regular run, so a failed
+ * regeneration doesn't stop the watching. The child reuses unchanged
+ * packages from the previous metadata (--update), loaded from their
+ * snapshot. Returns only in the child.
+ * @param cmd_options       Options specified on command line
+ * @param in_dir            The first input directory
+ * @param argc              Number of arguments (input directories + 1)
+ * @param argv              Arguments (other input directories with --split)
+ * @param out_dir           Output directory
+ */
+static void
+watch_and_regenerate(struct CmdOptions *cmd_options,
+                     const gchar *in_dir,
+                     int argc,
+                     char **argv,
+                     const gchar *out_dir)
+{
+    GError *tmp_err = NULL;
+    cr_Watch *watch;
+    _cleanup_free_ gchar *canonical_in_dir = NULL;
+    _cleanup_free_ gchar *canonical_out_dir = NULL;
+    _cleanup_free_ gchar *repodata_pattern = NULL;
+    _cleanup_free_ gchar *old_repodata_pattern = NULL;
+
+    watch = cr_watch_new(&tmp_err);
+    if (!watch) {
+        g_critical("%s", tmp_err->message);
+        g_clear_error(&tmp_err);
+        exit(EXIT_FAILURE);
+    }
+
+    // Paths of events are built from the watched dirs, the excludes must
+    // use the same (canonical) form, otherwise e.g. "-o $PWD ." or
+    // a symlink would regenerate the metadata after every regeneration
+    canonical_in_dir = canonical_path(in_dir);
+    canonical_out_dir = canonical_path(out_dir);
+
+    // Don't react to our own output (hidden .repodata* dirs are ignored)
+    repodata_pattern = g_build_filename(canonical_out_dir, "repodata", NULL);
+    old_repodata_pattern = g_build_filename(canonical_out_dir,
+                                            "repodata.old.*", NULL);
+    cr_watch_exclude(watch, repodata_pattern);
+    cr_watch_exclude(watch, old_repodata_pattern);
+    if (cmd_options->metrics_file) {
+        _cleanup_free_ gchar *path = canonical_path(cmd_options->metrics_file);
+        cr_watch_exclude(watch, path);
+    }
+    if (cmd_options->read_pkgs_list) {
+        _cleanup_free_ gchar *path = canonical_path(cmd_options->read_pkgs_list);
+        cr_watch_exclude(watch, path);
+    }
+
+    if (cr_watch_add_dir(watch, canonical_in_dir, &tmp_err) != CRE_OK) {
+        g_critical("%s", tmp_err->message);
+        g_clear_error(&tmp_err);
+        exit(EXIT_FAILURE);
+    }
+
+    for (int media_id = 2; media_id < argc; media_id++) {
+        _cleanup_free_ gchar *dir = canonical_path(argv[media_id]);
+        if (cr_watch_add_dir(watch, dir, &tmp_err) != CRE_OK) {
+            g_critical("%s", tmp_err->message);
+            g_clear_error(&tmp_err);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    while (1) {
+        GSList *changed = NULL;
+        int status;
+        pid_t pid;
+
+        pid = fork();
+        if (pid == -1) {
+            g_critical("Cannot fork: %s", g_strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+
+        if (pid == 0) {
+            cr_watch_free(watch);
+            return;
+        }
+
+        while (waitpid(pid, &status, 0) == -1 && errno == EINTR)
+            ;
+
+        if (WIFSIGNALED(status))
+            g_warning("Metadata generation killed by signal %d",
+                      WTERMSIG(status));
+        else if (WEXITSTATUS(status) != EXIT_SUCCESS)
+            g_warning("Metadata generation exited with status %d",
+                      WEXITSTATUS(status));
+
+        // Changes made during the generation are already queued
+        g_message("Watching for changes");
+        while (!changed) {
+            if (cr_watch_wait(watch, -1, cmd_options->watch_delay,
+                              &changed, &tmp_err) != CRE_OK) {
+                g_critical("%s", tmp_err->message);
+                g_clear_error(&tmp_err);
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        g_message("%u paths changed - Regenerating", g_slist_length(changed));
+        for (GSList *elem = changed; elem; elem = g_slist_next(elem))
+            g_debug("Changed: %s", (gchar *) elem->data);
+        g_slist_free_full(changed, g_free);
+    }
+}
+
 // Sorting function for location_href strings, by length.
 // Compatible with g_array_sort()
 static int strlensort(gconstpointer a, gconstpointer b)
@@ -599,6 +780,10 @@ main(int argc, char **argv)
     GError *tmp_err = NULL;
     int exit_val = EXIT_SUCCESS;
 
+    // Options are removed from argv by the parsing,
+    // keep them for the --skip-unchanged fingerprint
+    _cleanup_strv_free_ gchar **orig_argv = g_strdupv(argv);
+
     // Arguments parsing
     cmd_options = parse_arguments(&argc, &argv, &tmp_err);
     if (!cmd_options) {
@@ -697,6 +882,10 @@ main(int argc, char **argv)
         exit(EXIT_FAILURE);
     }
 
+    // Keep watching in the parent, the child continues with the generation
+    if (cmd_options->watch)
+        watch_and_regenerate(cmd_options, in_dir, argc, argv, out_dir);
+
     // Block signals that terminates the process
     if (!cr_block_terminating_signals(&tmp_err)) {
         g_printerr("%s\n", tmp_err->message);
@@ -740,6 +929,12 @@ main(int argc, char **argv)
 
     // Thread pool - Creation
     struct UserData user_data = {0};
+
+    // Per-stage timings and counters if --metrics-file
+    cr_Metrics *metrics = cmd_options->metrics_file ? cr_metrics_new() : NULL;
+    gint64 stage_start;
+    user_data.metrics = metrics;
+
     GThreadPool *pool = g_thread_pool_new(cr_dumper_thread,
                                           &user_data,
                                           0,
@@ -752,6 +947,28 @@ main(int argc, char **argv)
     GSList *current_pkglist = NULL;
     /* ^^^ List with basenames of files which will be processed */
 
+    // Prepare checkpoint if --checkpoint
+    cr_Checkpoint *checkpoint = NULL;
+    if (cmd_options->checkpoint) {
+        _cleanup_free_ gchar *checkpoint_dir = NULL;
+        checkpoint_dir = g_build_filename(out_dir, ".repodata.checkpoint/", NULL);
+        checkpoint = cr_checkpoint_new(checkpoint_dir,
+                                       cmd_options->filelists_ext,
+                                       cmd_options->checkpoint_interval,
+                                       &tmp_err);
+        if (!checkpoint) {
+            g_critical("%s", tmp_err->message);
+            g_clear_error(&tmp_err);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Prepare prefetcher unless --prefetch-depth 0
+    cr_Prefetch *prefetch = NULL;
+    if (cmd_options->prefetch_depth > 0)
+        prefetch = cr_prefetch_new(cmd_options->workers,
+                                   cmd_options->prefetch_depth);
+
     // Load old metadata if --update
     struct cr_MetadataLocation *old_metadata_location = NULL;
     cr_Metadata *old_metadata = NULL;
@@ -760,6 +977,7 @@ main(int argc, char **argv)
 
     if (cmd_options->recycle_pkglist) {
         // load the old metadata early, so we can read the list of RPMs
+        stage_start = g_get_monotonic_time();
         load_old_metadata(&old_metadata,
                           &old_metadata_location,
                           NULL /* no filter wanted in this case */,
@@ -767,6 +985,7 @@ main(int argc, char **argv)
                           old_metadata_dir,
                           pool,
                           tmp_err);
+        cr_metrics_observe_since(metrics, "load_old_metadata", stage_start);
 
         GHashTableIter iter;
         g_hash_table_iter_init(&iter, cr_metadata_hashtable(old_metadata));
@@ -779,6 +998,19 @@ main(int argc, char **argv)
         }
     }
 
+    // Prepare fingerprint of the inputs if --skip-unchanged
+    cr_Fingerprint *fingerprint = NULL;
+    if (cmd_options->skip_unchanged) {
+        _cleanup_free_ gchar *cwd = g_get_current_dir();
+        fingerprint = cr_fingerprint_new();
+        cr_fingerprint_add_string(fingerprint, "version",
+                                  cr_version_string_with_features());
+        cr_fingerprint_add_string(fingerprint, "cwd", cwd);
+        for (int x = 1; orig_argv[x]; x++)
+            cr_fingerprint_add_string(fingerprint, "arg", orig_argv[x]);
+    }
+
+    stage_start = g_get_monotonic_time();
     for (int media_id = 1; media_id < argc; media_id++ ) {
         gchar *tmp_in_dir = cr_normalize_dir_path(argv[media_id]);
         // Thread pool - Fill with tasks
@@ -787,13 +1019,43 @@ main(int argc, char **argv)
                   cmd_options,
                   &current_pkglist,
                   &task_count,
-                  media_id);
+                  media_id,
+                  checkpoint,
+                  fingerprint,
+                  prefetch);
         g_free(tmp_in_dir);
     }
+    cr_metrics_observe_since(metrics, "walk", stage_start);
 
     g_debug("Package count: %ld", task_count);
     g_message("Directory walk done - %ld packages", task_count);
 
+    if (fingerprint) {
+        // Other files the metadata are generated from
+        if (cmd_options->groupfile_fullpath)
+            cr_fingerprint_add_file(fingerprint, cmd_options->groupfile_fullpath);
+        if (cmd_options->pkglist)
+            cr_fingerprint_add_file(fingerprint, cmd_options->pkglist);
+        if (cmd_options->zck_dict_dir)
+            cr_fingerprint_add_file(fingerprint, cmd_options->zck_dict_dir);
+        for (GSList *elem = cmd_options->modulemd_metadata; elem; elem = g_slist_next(elem))
+            cr_fingerprint_add_file(fingerprint, elem->data);
+        for (GSList *elem = cmd_options->l_update_md_paths; elem; elem = g_slist_next(elem)) {
+            _cleanup_free_ gchar *repomd = NULL;
+            repomd = g_build_filename(elem->data, "repodata", "repomd.xml", NULL);
+            cr_fingerprint_add_file(fingerprint, repomd);
+        }
+
+        g_debug("Input fingerprint: %s", cr_fingerprint_finish(fingerprint));
+        if (cr_fingerprint_matches(fingerprint, out_repo)) {
+            // Lock and temporary repodata are removed by the exit handler
+            g_message("Inputs are unchanged since the last run, not updating.");
+            cr_checkpoint_free(checkpoint, TRUE);
+            cr_fingerprint_free(fingerprint);
+            exit(EXIT_SUCCESS);
+        }
+    }
+
     if (cmd_options->nevra_duplicates)
         // we need to construct the large table of cr_Packages to analyse
         // all the NEVRAs together.
@@ -809,7 +1071,8 @@ main(int argc, char **argv)
             g_debug("Old metadata already loaded.");
         else if (!task_count)
             g_debug("No packages found - skipping metadata loading");
-        else
+        else {
+            stage_start = g_get_monotonic_time();
             load_old_metadata(&old_metadata,
                               &old_metadata_location,
                               current_pkglist,
@@ -817,6 +1080,28 @@ main(int argc, char **argv)
                               old_metadata_dir,
                               pool,
                               tmp_err);
+            cr_metrics_observe_since(metrics, "load_old_metadata", stage_start);
+        }
+    }
+
+    if (checkpoint) {
+        // Packages committed by an interrupted run are reused exactly
+        // like the ones from --update (if the rpm is unchanged)
+        if (!old_metadata) {
+            old_metadata = cr_metadata_new(CR_HT_KEY_HREF, 1, current_pkglist);
+            cr_metadata_set_dupaction(old_metadata, CR_HT_DUPACT_REMOVEALL);
+        }
+
+        if (cr_checkpoint_resume(checkpoint, old_metadata, &tmp_err) != CRE_OK) {
+            g_warning("Cannot resume from checkpoint: %s", tmp_err->message);
+            g_clear_error(&tmp_err);
+        }
+
+        if (cr_checkpoint_start(checkpoint, &tmp_err) != CRE_OK) {
+            g_critical("Cannot start checkpoint: %s", tmp_err->message);
+            g_clear_error(&tmp_err);
+            exit(EXIT_FAILURE);
+        }
     }
 
     g_slist_free(current_pkglist);
@@ -1016,6 +1301,62 @@ main(int argc, char **argv)
         }
     }
 
+    // Zstd dictionaries
+    gchar *pri_zstd_dict = NULL;
+    gchar *fil_zstd_dict = NULL;
+    gchar *fex_zstd_dict = NULL;
+    gchar *oth_zstd_dict = NULL;
+    gsize pri_zstd_dict_size = 0;
+    gsize fil_zstd_dict_size = 0;
+    gsize fex_zstd_dict_size = 0;
+    gsize oth_zstd_dict_size = 0;
+    gchar *pri_zstd_dict_filename = NULL;
+    gchar *fil_zstd_dict_filename = NULL;
+    gchar *fex_zstd_dict_filename = NULL;
+    gchar *oth_zstd_dict_filename = NULL;
+
+    if (cmd_options->zstd_dict
+        && xml_compression != CR_CW_ZSTD_COMPRESSION
+        && !(cmd_options->zck_compression && !cmd_options->zck_dict_dir)) {
+        g_warning("--zstd-dict has no effect: neither xml metadata nor "
+                  "zchunk files are compressed by zstd without a dictionary");
+    } else if (cmd_options->zstd_dict) {
+        struct cr_MetadataLocation *dict_ml = old_metadata_location;
+        if (!dict_ml)
+            dict_ml = cr_locate_metadata_mask(old_metadata_dir, TRUE,
+                                              CR_MD_PACKAGES, NULL);
+
+        if (dict_ml) {
+            pri_zstd_dict = cr_prepare_zstd_dict(dict_ml->pri_zstd_dict_href,
+                                                 dict_ml->pri_xml_href,
+                                                 tmp_out_repo, "primary.xml",
+                                                 &pri_zstd_dict_size,
+                                                 &pri_zstd_dict_filename);
+            fil_zstd_dict = cr_prepare_zstd_dict(dict_ml->fil_zstd_dict_href,
+                                                 dict_ml->fil_xml_href,
+                                                 tmp_out_repo, "filelists.xml",
+                                                 &fil_zstd_dict_size,
+                                                 &fil_zstd_dict_filename);
+            if (cmd_options->filelists_ext)
+                fex_zstd_dict = cr_prepare_zstd_dict(dict_ml->fex_zstd_dict_href,
+                                                     dict_ml->fex_xml_href,
+                                                     tmp_out_repo, "filelists-ext.xml",
+                                                     &fex_zstd_dict_size,
+                                                     &fex_zstd_dict_filename);
+            oth_zstd_dict = cr_prepare_zstd_dict(dict_ml->oth_zstd_dict_href,
+                                                 dict_ml->oth_xml_href,
+                                                 tmp_out_repo, "other.xml",
+                                                 &oth_zstd_dict_size,
+                                                 &oth_zstd_dict_filename);
+        } else {
+            g_message("No previous repodata - zstd dictionaries will be "
+                      "trained during the next run");
+        }
+
+        if (dict_ml != old_metadata_location)
+            cr_metadatalocation_free(dict_ml);
+    }
+
     // Create and open new compressed files
     cr_XmlFile *pri_cr_file = NULL;
     cr_XmlFile *fil_cr_file = NULL;
@@ -1032,6 +1373,34 @@ main(int argc, char **argv)
     gchar *fex_xml_filename = NULL;
     gchar *oth_xml_filename = NULL;
 
+    cr_CompressionOptions pri_copts = cr_compression_options_map_get(
+                            cmd_options->compression_options, "primary");
+    cr_CompressionOptions fil_copts = cr_compression_options_map_get(
+                            cmd_options->compression_options, "filelists");
+    cr_CompressionOptions fex_copts = cr_compression_options_map_get(
+                            cmd_options->compression_options, "filelists-ext");
+    cr_CompressionOptions oth_copts = cr_compression_options_map_get(
+                            cmd_options->compression_options, "other");
+    cr_CompressionOptions pri_zck_copts = cr_compression_options_map_get(
+                            cmd_options->compression_options, "primary_zck");
+    cr_CompressionOptions fil_zck_copts = cr_compression_options_map_get(
+                            cmd_options->compression_options, "filelists_zck");
+    cr_CompressionOptions fex_zck_copts = cr_compression_options_map_get(
+                            cmd_options->compression_options, "filelists-ext_zck");
+    cr_CompressionOptions oth_zck_copts = cr_compression_options_map_get(
+                            cmd_options->compression_options, "other_zck");
+
+    if (xml_compression == CR_CW_ZSTD_COMPRESSION) {
+        pri_copts.dict = pri_zstd_dict;
+        pri_copts.dict_size = pri_zstd_dict_size;
+        fil_copts.dict = fil_zstd_dict;
+        fil_copts.dict_size = fil_zstd_dict_size;
+        fex_copts.dict = fex_zstd_dict;
+        fex_copts.dict_size = fex_zstd_dict_size;
+        oth_copts.dict = oth_zstd_dict;
+        oth_copts.dict_size = oth_zstd_dict_size;
+    }
+
     g_message("Temporary output repo path: %s", tmp_out_repo);
     g_debug("Creating .xml.%s files", xml_compression_suffix);
 
@@ -1042,10 +1411,12 @@ main(int argc, char **argv)
     oth_xml_filename = g_strconcat(tmp_out_repo, "/other.xml", xml_compression_suffix, NULL);
 
     pri_stat = cr_contentstat_new(cmd_options->repomd_checksum_type, NULL);
-    pri_cr_file = cr_xmlfile_sopen_primary(pri_xml_filename,
-                                           xml_compression,
-                                           pri_stat,
-                                           &tmp_err);
+    pri_cr_file = cr_xmlfile_sopen_with_options(pri_xml_filename,
+                                                CR_XMLFILE_PRIMARY,
+                                                xml_compression,
+                                                pri_stat,
+                                                &pri_copts,
+                                                &tmp_err);
     assert(pri_cr_file || tmp_err);
     if (!pri_cr_file) {
         g_critical("Cannot open file %s: %s",
@@ -1060,10 +1431,12 @@ main(int argc, char **argv)
     }
 
     fil_stat = cr_contentstat_new(cmd_options->repomd_checksum_type, NULL);
-    fil_cr_file = cr_xmlfile_sopen_filelists(fil_xml_filename,
-                                            xml_compression,
-                                            fil_stat,
-                                            &tmp_err);
+    fil_cr_file = cr_xmlfile_sopen_with_options(fil_xml_filename,
+                                                CR_XMLFILE_FILELISTS,
+                                                xml_compression,
+                                                fil_stat,
+                                                &fil_copts,
+                                                &tmp_err);
     assert(fil_cr_file || tmp_err);
     if (!fil_cr_file) {
         g_critical("Cannot open file %s: %s",
@@ -1081,9 +1454,11 @@ main(int argc, char **argv)
 
     if (cmd_options->filelists_ext) {
         fex_stat = cr_contentstat_new(cmd_options->repomd_checksum_type, NULL);
-        fex_cr_file = cr_xmlfile_sopen_filelists_ext(fex_xml_filename,
+        fex_cr_file = cr_xmlfile_sopen_with_options(fex_xml_filename,
+                                                    CR_XMLFILE_FILELISTS_EXT,
                                                     xml_compression,
                                                     fex_stat,
+                                                    &fex_copts,
                                                     &tmp_err);
         assert(fex_cr_file || tmp_err);
         if (!fex_cr_file) {
@@ -1104,10 +1479,12 @@ main(int argc, char **argv)
     }
 
     oth_stat = cr_contentstat_new(cmd_options->repomd_checksum_type, NULL);
-    oth_cr_file = cr_xmlfile_sopen_other(oth_xml_filename,
-                                        xml_compression,
-                                        oth_stat,
-                                        &tmp_err);
+    oth_cr_file = cr_xmlfile_sopen_with_options(oth_xml_filename,
+                                                CR_XMLFILE_OTHER,
+                                                xml_compression,
+                                                oth_stat,
+                                                &oth_copts,
+                                                &tmp_err);
     assert(oth_cr_file || tmp_err);
     if (!oth_cr_file) {
         g_critical("Cannot open file %s: %s",
@@ -1278,34 +1655,40 @@ main(int argc, char **argv)
                                              "filelists-ext.xml");
         oth_dict_file = cr_get_dict_file(cmd_options->zck_dict_dir,
                                          "other.xml");
-        if (pri_dict_file && !g_file_get_contents(pri_dict_file, &pri_dict,
-                                                 &pri_dict_size, &tmp_err)) {
-            g_critical("Error reading zchunk primary dict %s: %s",
-                       pri_dict_file, tmp_err->message);
-            g_clear_error(&tmp_err);
-            exit(EXIT_FAILURE);
-        }
-        if (fil_dict_file && !g_file_get_contents(fil_dict_file, &fil_dict,
-                                                 &fil_dict_size, &tmp_err)) {
-            g_critical("Error reading zchunk filelists dict %s: %s",
-                       fil_dict_file, tmp_err->message);
-            g_clear_error(&tmp_err);
-            exit(EXIT_FAILURE);
-        }
-        if (fex_dict_file && !g_file_get_contents(fex_dict_file, &fex_dict,
-                                                 &fex_dict_size, &tmp_err)) {
-            g_critical("Error reading zchunk filelists dict %s: %s",
-                       fex_dict_file, tmp_err->message);
-            g_clear_error(&tmp_err);
-            exit(EXIT_FAILURE);
+    } else if (cmd_options->zck_compression) {
+        // Chunks of zchunk files use --zstd-dict dictionaries as well
+        pri_dict_file = g_strdup(pri_zstd_dict_filename);
+        fil_dict_file = g_strdup(fil_zstd_dict_filename);
+        fex_dict_file = g_strdup(fex_zstd_dict_filename);
+        oth_dict_file = g_strdup(oth_zstd_dict_filename);
+    }
+    if (pri_dict_file && !g_file_get_contents(pri_dict_file, &pri_dict,
+                                             &pri_dict_size, &tmp_err)) {
+        g_critical("Error reading zchunk primary dict %s: %s",
+                   pri_dict_file, tmp_err->message);
+        g_clear_error(&tmp_err);
+        exit(EXIT_FAILURE);
+    }
+    if (fil_dict_file && !g_file_get_contents(fil_dict_file, &fil_dict,
+                                             &fil_dict_size, &tmp_err)) {
+        g_critical("Error reading zchunk filelists dict %s: %s",
+                   fil_dict_file, tmp_err->message);
+        g_clear_error(&tmp_err);
+        exit(EXIT_FAILURE);
+    }
+    if (fex_dict_file && !g_file_get_contents(fex_dict_file, &fex_dict,
+                                             &fex_dict_size, &tmp_err)) {
+        g_critical("Error reading zchunk filelists dict %s: %s",
+                   fex_dict_file, tmp_err->message);
+        g_clear_error(&tmp_err);
+        exit(EXIT_FAILURE);
 	}
-        if (oth_dict_file && !g_file_get_contents(oth_dict_file, &oth_dict,
-                                                 &oth_dict_size, &tmp_err)) {
-            g_critical("Error reading zchunk other dict %s: %s",
-                       oth_dict_file, tmp_err->message);
-            g_clear_error(&tmp_err);
-            exit(EXIT_FAILURE);
-        }
+    if (oth_dict_file && !g_file_get_contents(oth_dict_file, &oth_dict,
+                                             &oth_dict_size, &tmp_err)) {
+        g_critical("Error reading zchunk other dict %s: %s",
+                   oth_dict_file, tmp_err->message);
+        g_clear_error(&tmp_err);
+        exit(EXIT_FAILURE);
     }
     if (cmd_options->zck_compression) {
         g_debug("Creating .xml.zck files");
@@ -1317,10 +1700,12 @@ main(int argc, char **argv)
         oth_zck_filename = g_strconcat(tmp_out_repo, "/other.xml.zck", NULL);
 
         pri_zck_stat = cr_contentstat_new(cmd_options->repomd_checksum_type, NULL);
-        pri_cr_zck = cr_xmlfile_sopen_primary(pri_zck_filename,
-                                              CR_CW_ZCK_COMPRESSION,
-                                              pri_zck_stat,
-                                              &tmp_err);
+        pri_cr_zck = cr_xmlfile_sopen_with_options(pri_zck_filename,
+                                                   CR_XMLFILE_PRIMARY,
+                                                   CR_CW_ZCK_COMPRESSION,
+                                                   pri_zck_stat,
+                                                   &pri_zck_copts,
+                                                   &tmp_err);
         assert(pri_cr_zck || tmp_err);
         if (!pri_cr_zck) {
             g_critical("Cannot open file %s: %s",
@@ -1343,10 +1728,12 @@ main(int argc, char **argv)
         g_free(pri_dict);
 
         fil_zck_stat = cr_contentstat_new(cmd_options->repomd_checksum_type, NULL);
-        fil_cr_zck = cr_xmlfile_sopen_filelists(fil_zck_filename,
-                                                CR_CW_ZCK_COMPRESSION,
-                                                fil_zck_stat,
-                                                &tmp_err);
+        fil_cr_zck = cr_xmlfile_sopen_with_options(fil_zck_filename,
+                                                   CR_XMLFILE_FILELISTS,
+                                                   CR_CW_ZCK_COMPRESSION,
+                                                   fil_zck_stat,
+                                                   &fil_zck_copts,
+                                                   &tmp_err);
         assert(fil_cr_zck || tmp_err);
         if (!fil_cr_zck) {
             g_critical("Cannot open file %s: %s",
@@ -1372,10 +1759,12 @@ main(int argc, char **argv)
 
         if (cmd_options->filelists_ext) {
             fex_zck_stat = cr_contentstat_new(cmd_options->repomd_checksum_type, NULL);
-            fex_cr_zck = cr_xmlfile_sopen_filelists_ext(fex_zck_filename,
-                                                        CR_CW_ZCK_COMPRESSION,
-                                                        fex_zck_stat,
-                                                        &tmp_err);
+            fex_cr_zck = cr_xmlfile_sopen_with_options(fex_zck_filename,
+                                                       CR_XMLFILE_FILELISTS_EXT,
+                                                       CR_CW_ZCK_COMPRESSION,
+                                                       fex_zck_stat,
+                                                       &fex_zck_copts,
+                                                       &tmp_err);
             assert(fex_cr_zck || tmp_err);
             if (!fex_cr_zck) {
                 g_critical("Cannot open file %s: %s",
@@ -1402,10 +1791,12 @@ main(int argc, char **argv)
         }
 
         oth_zck_stat = cr_contentstat_new(cmd_options->repomd_checksum_type, NULL);
-        oth_cr_zck = cr_xmlfile_sopen_other(oth_zck_filename,
-                                            CR_CW_ZCK_COMPRESSION,
-                                            oth_zck_stat,
-                                            &tmp_err);
+        oth_cr_zck = cr_xmlfile_sopen_with_options(oth_zck_filename,
+                                                   CR_XMLFILE_OTHER,
+                                                   CR_CW_ZCK_COMPRESSION,
+                                                   oth_zck_stat,
+                                                   &oth_zck_copts,
+                                                   &tmp_err);
         assert(oth_cr_zck || tmp_err);
         if (!oth_cr_zck) {
             g_critical("Cannot open file %s: %s",
@@ -1481,6 +1872,17 @@ main(int argc, char **argv)
     user_data.location_prefix   = cmd_options->location_prefix;
     user_data.had_errors        = 0;
     user_data.output_pkg_list   = output_pkg_list;
+    user_data.checkpoint        = checkpoint;
+    user_data.snapshot          = cmd_options->snapshot ? cr_snapshot_writer_new() : NULL;
+    user_data.prefetch          = prefetch;
+
+    // Report how much of each media was reused in split mode
+    if (cmd_options->split) {
+        user_data.media_stats = g_array_sized_new(FALSE, TRUE,
+                                                  sizeof(struct MediaStats),
+                                                  argc);
+        g_array_set_size(user_data.media_stats, argc);
+    }
 
     g_mutex_init(&(user_data.mutex_nevra_table));
     g_mutex_init(&(user_data.mutex_output_pkg_list));
@@ -1496,6 +1898,10 @@ main(int argc, char **argv)
     g_mutex_init(&(user_data.mutex_old_md));
     g_mutex_init(&(user_data.mutex_deltatargetpackages));
 
+    if (prefetch)
+        cr_prefetch_set_needed_func(prefetch, cr_dumper_prefetch_needed,
+                                    &user_data);
+
     g_debug("Thread pool user data ready");
 
     // Start pool
@@ -1503,7 +1909,37 @@ main(int argc, char **argv)
     g_message("Pool started (with %d workers)", cmd_options->workers);
 
     // Wait until pool is finished
+    stage_start = g_get_monotonic_time();
     g_thread_pool_free(pool, FALSE, TRUE);
+    cr_metrics_observe_since(metrics, "dump", stage_start);
+
+    if (prefetch) {
+        cr_metrics_add(metrics, "prefetched", cr_prefetch_get_count(prefetch));
+        g_debug("Prefetched %u packages (%u ahead of the workers at the end)",
+                cr_prefetch_get_count(prefetch),
+                cr_prefetch_get_depth(prefetch));
+        cr_prefetch_free(prefetch);
+        prefetch = NULL;
+        user_data.prefetch = NULL;
+    }
+
+    if (user_data.media_stats) {
+        for (int media_id = 1; media_id < argc; media_id++) {
+            struct MediaStats *mstats = &g_array_index(user_data.media_stats,
+                                                       struct MediaStats,
+                                                       media_id);
+            if (old_metadata && mstats->packages
+                && mstats->reused == mstats->packages)
+                g_message("Media #%d (%s) unchanged - %d packages reused",
+                          media_id, argv[media_id], mstats->packages);
+            else
+                g_message("Media #%d (%s): %d packages, %d reused from old metadata",
+                          media_id, argv[media_id], mstats->packages,
+                          mstats->reused);
+        }
+        g_array_free(user_data.media_stats, TRUE);
+        user_data.media_stats = NULL;
+    }
 
     GHashTableIter iter;
     gpointer key, value;
@@ -1565,6 +2001,11 @@ main(int argc, char **argv)
 
     g_message("Pool finished%s", (user_data.had_errors ? " with errors" : ""));
 
+    if (checkpoint && cr_checkpoint_commit(checkpoint, task_count, &tmp_err) != CRE_OK) {
+        g_warning("Cannot commit checkpoint: %s", tmp_err->message);
+        g_clear_error(&tmp_err);
+    }
+
     cr_xml_dump_cleanup();
 
     if (output_pkg_list)
@@ -1634,73 +2075,73 @@ main(int argc, char **argv)
         cr_CompressionTask *fex_zck_rewrite_pkg_count_task = NULL;
         cr_CompressionTask *oth_zck_rewrite_pkg_count_task = NULL;
 
-        pri_rewrite_pkg_count_task = cr_compressiontask_new(pri_xml_filename,
-                                                            NULL,
-                                                            xml_compression,
-                                                            cmd_options->repomd_checksum_type,
-                                                            NULL, FALSE, 1,
-                                                            &tmp_err);
+        pri_rewrite_pkg_count_task = cr_compressiontask_new_with_options(pri_xml_filename,
+                                                                         NULL,
+                                                                         xml_compression,
+                                                                         cmd_options->repomd_checksum_type,
+                                                                         &pri_copts,
+                                                                         NULL, FALSE, 1, &tmp_err);
         g_thread_pool_push(rewrite_pkg_count_pool, pri_rewrite_pkg_count_task, NULL);
 
-        fil_rewrite_pkg_count_task = cr_compressiontask_new(fil_xml_filename,
-                                                            NULL,
-                                                            xml_compression,
-                                                            cmd_options->repomd_checksum_type,
-                                                            NULL, FALSE, 1,
-                                                            &tmp_err);
+        fil_rewrite_pkg_count_task = cr_compressiontask_new_with_options(fil_xml_filename,
+                                                                         NULL,
+                                                                         xml_compression,
+                                                                         cmd_options->repomd_checksum_type,
+                                                                         &fil_copts,
+                                                                         NULL, FALSE, 1, &tmp_err);
         g_thread_pool_push(rewrite_pkg_count_pool, fil_rewrite_pkg_count_task, NULL);
 
         if (cmd_options->filelists_ext) {
-            fex_rewrite_pkg_count_task = cr_compressiontask_new(fex_xml_filename,
-                                                                NULL,
-                                                                xml_compression,
-                                                                cmd_options->repomd_checksum_type,
-                                                                NULL, FALSE, 1,
-                                                                &tmp_err);
+            fex_rewrite_pkg_count_task = cr_compressiontask_new_with_options(fex_xml_filename,
+                                                                             NULL,
+                                                                             xml_compression,
+                                                                             cmd_options->repomd_checksum_type,
+                                                                             &fex_copts,
+                                                                             NULL, FALSE, 1, &tmp_err);
             g_thread_pool_push(rewrite_pkg_count_pool, fex_rewrite_pkg_count_task, NULL);
         }
 
-        oth_rewrite_pkg_count_task = cr_compressiontask_new(oth_xml_filename,
-                                                            NULL,
-                                                            xml_compression,
-                                                            cmd_options->repomd_checksum_type,
-                                                            NULL, FALSE, 1,
-                                                            &tmp_err);
+        oth_rewrite_pkg_count_task = cr_compressiontask_new_with_options(oth_xml_filename,
+                                                                         NULL,
+                                                                         xml_compression,
+                                                                         cmd_options->repomd_checksum_type,
+                                                                         &oth_copts,
+                                                                         NULL, FALSE, 1, &tmp_err);
         g_thread_pool_push(rewrite_pkg_count_pool, oth_rewrite_pkg_count_task, NULL);
 
         if (cmd_options->zck_compression) {
-            pri_zck_rewrite_pkg_count_task = cr_compressiontask_new(pri_zck_filename,
-                                                                NULL,
-                                                                CR_CW_ZCK_COMPRESSION,
-                                                                cmd_options->repomd_checksum_type,
-                                                                pri_dict_file,
-                                                                FALSE, 1, &tmp_err);
+            pri_zck_rewrite_pkg_count_task = cr_compressiontask_new_with_options(pri_zck_filename,
+                                                                                 NULL,
+                                                                                 CR_CW_ZCK_COMPRESSION,
+                                                                                 cmd_options->repomd_checksum_type,
+                                                                                 &pri_zck_copts,
+                                                                                 pri_dict_file, FALSE, 1, &tmp_err);
             g_thread_pool_push(rewrite_pkg_count_pool, pri_zck_rewrite_pkg_count_task, NULL);
 
-            fil_zck_rewrite_pkg_count_task = cr_compressiontask_new(fil_zck_filename,
-                                                                NULL,
-                                                                CR_CW_ZCK_COMPRESSION,
-                                                                cmd_options->repomd_checksum_type,
-                                                                fil_dict_file,
-                                                                FALSE, 1, &tmp_err);
+            fil_zck_rewrite_pkg_count_task = cr_compressiontask_new_with_options(fil_zck_filename,
+                                                                                 NULL,
+                                                                                 CR_CW_ZCK_COMPRESSION,
+                                                                                 cmd_options->repomd_checksum_type,
+                                                                                 &fil_zck_copts,
+                                                                                 fil_dict_file, FALSE, 1, &tmp_err);
             g_thread_pool_push(rewrite_pkg_count_pool, fil_zck_rewrite_pkg_count_task, NULL);
 
             if (cmd_options->filelists_ext) {
-                fex_zck_rewrite_pkg_count_task = cr_compressiontask_new(fex_zck_filename,
-                                                                    NULL,
-                                                                    CR_CW_ZCK_COMPRESSION,
-                                                                    cmd_options->repomd_checksum_type,
-                                                                    fex_dict_file,
-                                                                    FALSE, 1, &tmp_err);
+                fex_zck_rewrite_pkg_count_task = cr_compressiontask_new_with_options(fex_zck_filename,
+                                                                                     NULL,
+                                                                                     CR_CW_ZCK_COMPRESSION,
+                                                                                     cmd_options->repomd_checksum_type,
+                                                                                     &fex_zck_copts,
+                                                                                     fex_dict_file, FALSE, 1, &tmp_err);
                 g_thread_pool_push(rewrite_pkg_count_pool, fex_zck_rewrite_pkg_count_task, NULL);
 	    }
 
-            oth_zck_rewrite_pkg_count_task = cr_compressiontask_new(oth_zck_filename,
-                                                                NULL,
-                                                                CR_CW_ZCK_COMPRESSION,
-                                                                cmd_options->repomd_checksum_type,
-                                                                oth_dict_file,
-                                                                FALSE, 1, &tmp_err);
+            oth_zck_rewrite_pkg_count_task = cr_compressiontask_new_with_options(oth_zck_filename,
+                                                                                 NULL,
+                                                                                 CR_CW_ZCK_COMPRESSION,
+                                                                                 cmd_options->repomd_checksum_type,
+                                                                                 &oth_zck_copts,
+                                                                                 oth_dict_file, FALSE, 1, &tmp_err);
             g_thread_pool_push(rewrite_pkg_count_pool, oth_zck_rewrite_pkg_count_task, NULL);
         }
 
@@ -1737,6 +2178,10 @@ main(int argc, char **argv)
         g_free(fex_dict_file);
         g_free(oth_dict_file);
     }
+    g_free(pri_zstd_dict);
+    g_free(fil_zstd_dict);
+    g_free(fex_zstd_dict);
+    g_free(oth_zstd_dict);
 
     g_queue_free(user_data.buffer);
     g_mutex_clear(&(user_data.mutex_nevra_table));
@@ -1755,6 +2200,7 @@ main(int argc, char **argv)
 
     // Create repomd records for each file
     g_debug("Generating repomd.xml");
+    stage_start = g_get_monotonic_time();
 
     cr_Repomd *repomd_obj = cr_repomd_new();
 
@@ -1774,6 +2220,10 @@ main(int argc, char **argv)
     cr_RepomdRecord *oth_zck_rec              = NULL;
     cr_RepomdRecord *prestodelta_rec          = NULL;
     cr_RepomdRecord *prestodelta_zck_rec      = NULL;
+    cr_RepomdRecord *pri_zstd_dict_rec        = NULL;
+    cr_RepomdRecord *fil_zstd_dict_rec        = NULL;
+    cr_RepomdRecord *fex_zstd_dict_rec        = NULL;
+    cr_RepomdRecord *oth_zstd_dict_rec        = NULL;
 
     // List of cr_RepomdRecords
     GSList *additional_metadata_rec           = NULL;
@@ -1824,170 +2274,48 @@ main(int argc, char **argv)
     additional_metadata_rec = cr_create_repomd_records_for_additional_metadata(additional_metadata,
                                                                                cmd_options->repomd_checksum_type);
 
-    // Wait till repomd record fill task of xml files ends.
-    g_thread_pool_free(fill_pool, FALSE, TRUE);
-
-    cr_repomdrecordfilltask_free(pri_fill_task, NULL);
-    cr_repomdrecordfilltask_free(fil_fill_task, NULL);
-    cr_repomdrecordfilltask_free(fex_fill_task, NULL);
-    cr_repomdrecordfilltask_free(oth_fill_task, NULL);
-
-    // Sqlite db
-    if (should_create_databases) {
-        gchar *pri_db_name = g_strconcat(tmp_out_repo, "/primary.sqlite",
-                                         sqlite_compression_suffix, NULL);
-        gchar *fil_db_name = g_strconcat(tmp_out_repo, "/filelists.sqlite",
-                                         sqlite_compression_suffix, NULL);
-        gchar *fex_db_name = NULL;
-        if (cmd_options->filelists_ext)
-            fex_db_name = g_strconcat(tmp_out_repo, "/filelists-ext.sqlite",
-                                      sqlite_compression_suffix, NULL);
-        gchar *oth_db_name = g_strconcat(tmp_out_repo, "/other.sqlite",
-                                         sqlite_compression_suffix, NULL);
-
-        cr_db_dbinfo_update(pri_db, pri_xml_rec->checksum, &tmp_err);
-        if (!tmp_err)
-            cr_db_dbinfo_update(fil_db, fil_xml_rec->checksum, &tmp_err);
-        if (!tmp_err && cmd_options->filelists_ext)
-            cr_db_dbinfo_update(fex_db, fex_xml_rec->checksum, &tmp_err);
-        if (!tmp_err)
-            cr_db_dbinfo_update(oth_db, oth_xml_rec->checksum, &tmp_err);
-        if (tmp_err) {
-            g_critical("Error updating dbinfo: %s", tmp_err->message);
-            g_clear_error(&tmp_err);
-            exit(EXIT_FAILURE);
-        }
-
-        cr_db_close(pri_db, &tmp_err);
-        if (!tmp_err)
-            cr_db_close(fil_db, &tmp_err);
-        if (!tmp_err)
-            cr_db_close(fex_db, &tmp_err);
-        if (!tmp_err)
-            cr_db_close(oth_db, &tmp_err);
-        if (tmp_err) {
-            g_critical("Error while closing db: %s", tmp_err->message);
-            g_clear_error(&tmp_err);
-            exit(EXIT_FAILURE);
-        }
-
-
-        // Compress dbs
-        GThreadPool *compress_pool =  g_thread_pool_new(cr_compressing_thread,
-                                                        NULL, 3, FALSE, NULL);
-
-        cr_CompressionTask *pri_db_task = NULL;
-        cr_CompressionTask *fil_db_task = NULL;
-        cr_CompressionTask *fex_db_task = NULL;
-        cr_CompressionTask *oth_db_task = NULL;
-
-        pri_db_task = cr_compressiontask_new(pri_db_filename,
-                                             pri_db_name,
-                                             sqlite_compression,
-                                             cmd_options->repomd_checksum_type,
-                                             NULL, FALSE, 1, NULL);
-        g_thread_pool_push(compress_pool, pri_db_task, NULL);
-
-        fil_db_task = cr_compressiontask_new(fil_db_filename,
-                                             fil_db_name,
-                                             sqlite_compression,
-                                             cmd_options->repomd_checksum_type,
-                                             NULL, FALSE, 1, NULL);
-        g_thread_pool_push(compress_pool, fil_db_task, NULL);
-
-        if (cmd_options->filelists_ext) {
-            fex_db_task = cr_compressiontask_new(fex_db_filename,
-                                                 fex_db_name,
-                                                 sqlite_compression,
-                                                 cmd_options->repomd_checksum_type,
-                                                 NULL, FALSE, 1, NULL);
-            g_thread_pool_push(compress_pool, fex_db_task, NULL);
-        }
-
-        oth_db_task = cr_compressiontask_new(oth_db_filename,
-                                             oth_db_name,
-                                             sqlite_compression,
-                                             cmd_options->repomd_checksum_type,
-                                             NULL, FALSE, 1, NULL);
-        g_thread_pool_push(compress_pool, oth_db_task, NULL);
-
-        g_thread_pool_free(compress_pool, FALSE, TRUE);
-
-        if (!cmd_options->local_sqlite) {
-            cr_rm(pri_db_filename, CR_RM_FORCE, NULL, NULL);
-            cr_rm(fil_db_filename, CR_RM_FORCE, NULL, NULL);
-            if (cmd_options->filelists_ext)
-                cr_rm(fex_db_filename, CR_RM_FORCE, NULL, NULL);
-            cr_rm(oth_db_filename, CR_RM_FORCE, NULL, NULL);
-        }
-
-        // Prepare repomd records
-        pri_db_rec = cr_repomd_record_new("primary_db", pri_db_name);
-        fil_db_rec = cr_repomd_record_new("filelists_db", fil_db_name);
-        if (cmd_options->filelists_ext)
-            fex_db_rec = cr_repomd_record_new("filelists-ext_db", fex_db_name);
-        oth_db_rec = cr_repomd_record_new("other_db", oth_db_name);
-
-        // Set db version
-        pri_db_rec->db_ver = DEFAULT_DATABASE_VERSION;
-        fil_db_rec->db_ver = DEFAULT_DATABASE_VERSION;
-        if (cmd_options->filelists_ext)
-            fex_db_rec->db_ver = DEFAULT_DATABASE_VERSION;
-        oth_db_rec->db_ver = DEFAULT_DATABASE_VERSION;
-
-        g_free(pri_db_name);
-        g_free(fil_db_name);
-        g_free(fex_db_name);
-        g_free(oth_db_name);
-
-        cr_repomd_record_load_contentstat(pri_db_rec, pri_db_task->stat);
-        cr_repomd_record_load_contentstat(fil_db_rec, fil_db_task->stat);
-        if (cmd_options->filelists_ext)
-            cr_repomd_record_load_contentstat(fex_db_rec, fex_db_task->stat);
-        cr_repomd_record_load_contentstat(oth_db_rec, oth_db_task->stat);
-
-        cr_compressiontask_free(pri_db_task, NULL);
-        cr_compressiontask_free(fil_db_task, NULL);
-        cr_compressiontask_free(fex_db_task, NULL);
-        cr_compressiontask_free(oth_db_task, NULL);
-
-        fill_pool = g_thread_pool_new(cr_repomd_record_fill_thread,
-                                      NULL, 3, FALSE, NULL);
-
-        cr_RepomdRecordFillTask *pri_db_fill_task = NULL;
-        cr_RepomdRecordFillTask *fil_db_fill_task = NULL;
-        cr_RepomdRecordFillTask *fex_db_fill_task = NULL;
-        cr_RepomdRecordFillTask *oth_db_fill_task = NULL;
-
-        pri_db_fill_task = cr_repomdrecordfilltask_new(pri_db_rec,
-                                                       cmd_options->repomd_checksum_type,
-                                                       NULL);
-        g_thread_pool_push(fill_pool, pri_db_fill_task, NULL);
-
-        fil_db_fill_task = cr_repomdrecordfilltask_new(fil_db_rec,
-                                                       cmd_options->repomd_checksum_type,
-                                                       NULL);
-        g_thread_pool_push(fill_pool, fil_db_fill_task, NULL);
-
-        if (cmd_options->filelists_ext) {
-            fex_db_fill_task = cr_repomdrecordfilltask_new(fex_db_rec,
-                                                           cmd_options->repomd_checksum_type,
-                                                           NULL);
-            g_thread_pool_push(fill_pool, fex_db_fill_task, NULL);
-        }
-
-        oth_db_fill_task = cr_repomdrecordfilltask_new(oth_db_rec,
-                                                       cmd_options->repomd_checksum_type,
-                                                       NULL);
-        g_thread_pool_push(fill_pool, oth_db_fill_task, NULL);
-
-        g_thread_pool_free(fill_pool, FALSE, TRUE);
-
-        cr_repomdrecordfilltask_free(pri_db_fill_task, NULL);
-        cr_repomdrecordfilltask_free(fil_db_fill_task, NULL);
-        cr_repomdrecordfilltask_free(fex_db_fill_task, NULL);
-        cr_repomdrecordfilltask_free(oth_db_fill_task, NULL);
-    }
+    // Zstd dictionaries
+    if (pri_zstd_dict_filename) {
+        pri_zstd_dict_rec = cr_repomd_record_new("primary_zstd_dict",
+                                                 pri_zstd_dict_filename);
+        cr_repomd_record_fill(pri_zstd_dict_rec, cmd_options->repomd_checksum_type, NULL);
+    }
+    if (fil_zstd_dict_filename) {
+        fil_zstd_dict_rec = cr_repomd_record_new("filelists_zstd_dict",
+                                                 fil_zstd_dict_filename);
+        cr_repomd_record_fill(fil_zstd_dict_rec, cmd_options->repomd_checksum_type, NULL);
+    }
+    if (fex_zstd_dict_filename) {
+        fex_zstd_dict_rec = cr_repomd_record_new("filelists-ext_zstd_dict",
+                                                 fex_zstd_dict_filename);
+        cr_repomd_record_fill(fex_zstd_dict_rec, cmd_options->repomd_checksum_type, NULL);
+    }
+    if (oth_zstd_dict_filename) {
+        oth_zstd_dict_rec = cr_repomd_record_new("other_zstd_dict",
+                                                 oth_zstd_dict_filename);
+        cr_repomd_record_fill(oth_zstd_dict_rec, cmd_options->repomd_checksum_type, NULL);
+    }
+    g_free(pri_zstd_dict_filename);
+    g_free(fil_zstd_dict_filename);
+    g_free(fex_zstd_dict_filename);
+    g_free(oth_zstd_dict_filename);
+
+    // Pool for compress -> fill -> rename chains of dbs and zck files.
+    // The zck chains don't need the xml records, they run while the xml
+    // records are filled. The dbs need the xml checksums for their dbinfo,
+    // their chains are started after the fill.
+    gint64 chains_start = g_get_monotonic_time();
+    GThreadPool *rec_pool = g_thread_pool_new(cr_repomd_record_task_thread,
+                                              NULL, 3, FALSE, NULL);
+
+    cr_RepomdRecordTask *pri_db_rec_task  = NULL;
+    cr_RepomdRecordTask *fil_db_rec_task  = NULL;
+    cr_RepomdRecordTask *fex_db_rec_task  = NULL;
+    cr_RepomdRecordTask *oth_db_rec_task  = NULL;
+    cr_RepomdRecordTask *pri_zck_rec_task = NULL;
+    cr_RepomdRecordTask *fil_zck_rec_task = NULL;
+    cr_RepomdRecordTask *fex_zck_rec_task = NULL;
+    cr_RepomdRecordTask *oth_zck_rec_task = NULL;
 
     // Zchunk
     if (cmd_options->zck_compression) {
@@ -2004,42 +2332,32 @@ main(int argc, char **argv)
             cr_repomd_record_load_zck_contentstat(fex_zck_rec, fex_zck_stat);
         cr_repomd_record_load_zck_contentstat(oth_zck_rec, oth_zck_stat);
 
-        fill_pool = g_thread_pool_new(cr_repomd_record_fill_thread,
-                                      NULL, 3, FALSE, NULL);
-
-        cr_RepomdRecordFillTask *pri_zck_fill_task = NULL;
-        cr_RepomdRecordFillTask *fil_zck_fill_task = NULL;
-        cr_RepomdRecordFillTask *fex_zck_fill_task = NULL;
-        cr_RepomdRecordFillTask *oth_zck_fill_task = NULL;
-
-        pri_zck_fill_task = cr_repomdrecordfilltask_new(pri_zck_rec,
-                                                       cmd_options->repomd_checksum_type,
-                                                       NULL);
-        g_thread_pool_push(fill_pool, pri_zck_fill_task, NULL);
+        // The zck files are already written, their chains are fill -> rename
+        pri_zck_rec_task = cr_repomdrecordtask_new(pri_zck_rec, NULL,
+                                                   cmd_options->repomd_checksum_type,
+                                                   cmd_options->unique_md_filenames,
+                                                   NULL);
+        g_thread_pool_push(rec_pool, pri_zck_rec_task, NULL);
 
-        fil_zck_fill_task = cr_repomdrecordfilltask_new(fil_zck_rec,
-                                                       cmd_options->repomd_checksum_type,
-                                                       NULL);
-        g_thread_pool_push(fill_pool, fil_zck_fill_task, NULL);
+        fil_zck_rec_task = cr_repomdrecordtask_new(fil_zck_rec, NULL,
+                                                   cmd_options->repomd_checksum_type,
+                                                   cmd_options->unique_md_filenames,
+                                                   NULL);
+        g_thread_pool_push(rec_pool, fil_zck_rec_task, NULL);
 
         if (cmd_options->filelists_ext) {
-            fex_zck_fill_task = cr_repomdrecordfilltask_new(fex_zck_rec,
-                                                           cmd_options->repomd_checksum_type,
-                                                           NULL);
-            g_thread_pool_push(fill_pool, fex_zck_fill_task, NULL);
-        }
-
-        oth_zck_fill_task = cr_repomdrecordfilltask_new(oth_zck_rec,
+            fex_zck_rec_task = cr_repomdrecordtask_new(fex_zck_rec, NULL,
                                                        cmd_options->repomd_checksum_type,
+                                                       cmd_options->unique_md_filenames,
                                                        NULL);
-        g_thread_pool_push(fill_pool, oth_zck_fill_task, NULL);
-
-        g_thread_pool_free(fill_pool, FALSE, TRUE);
+            g_thread_pool_push(rec_pool, fex_zck_rec_task, NULL);
+        }
 
-        cr_repomdrecordfilltask_free(pri_zck_fill_task, NULL);
-        cr_repomdrecordfilltask_free(fil_zck_fill_task, NULL);
-        cr_repomdrecordfilltask_free(fex_zck_fill_task, NULL);
-        cr_repomdrecordfilltask_free(oth_zck_fill_task, NULL);
+        oth_zck_rec_task = cr_repomdrecordtask_new(oth_zck_rec, NULL,
+                                                   cmd_options->repomd_checksum_type,
+                                                   cmd_options->unique_md_filenames,
+                                                   NULL);
+        g_thread_pool_push(rec_pool, oth_zck_rec_task, NULL);
 
         //ZCK for additional metadata
         GSList *element = additional_metadata;
@@ -2108,11 +2426,217 @@ main(int argc, char **argv)
         }
     }
 
+    // Wait till repomd record fill task of xml files ends.
+    g_thread_pool_free(fill_pool, FALSE, TRUE);
+    cr_metrics_observe_since(metrics, "repomd_fill", stage_start);
+
+    cr_repomdrecordfilltask_free(pri_fill_task, NULL);
+    cr_repomdrecordfilltask_free(fil_fill_task, NULL);
+    cr_repomdrecordfilltask_free(fex_fill_task, NULL);
+    cr_repomdrecordfilltask_free(oth_fill_task, NULL);
+
+    // Sqlite db
+    if (should_create_databases) {
+        gchar *pri_db_name = g_strconcat(tmp_out_repo, "/primary.sqlite",
+                                         sqlite_compression_suffix, NULL);
+        gchar *fil_db_name = g_strconcat(tmp_out_repo, "/filelists.sqlite",
+                                         sqlite_compression_suffix, NULL);
+        gchar *fex_db_name = NULL;
+        if (cmd_options->filelists_ext)
+            fex_db_name = g_strconcat(tmp_out_repo, "/filelists-ext.sqlite",
+                                      sqlite_compression_suffix, NULL);
+        gchar *oth_db_name = g_strconcat(tmp_out_repo, "/other.sqlite",
+                                         sqlite_compression_suffix, NULL);
+
+        cr_db_dbinfo_update(pri_db, pri_xml_rec->checksum, &tmp_err);
+        if (!tmp_err)
+            cr_db_dbinfo_update(fil_db, fil_xml_rec->checksum, &tmp_err);
+        if (!tmp_err && cmd_options->filelists_ext)
+            cr_db_dbinfo_update(fex_db, fex_xml_rec->checksum, &tmp_err);
+        if (!tmp_err)
+            cr_db_dbinfo_update(oth_db, oth_xml_rec->checksum, &tmp_err);
+        if (tmp_err) {
+            g_critical("Error updating dbinfo: %s", tmp_err->message);
+            g_clear_error(&tmp_err);
+            exit(EXIT_FAILURE);
+        }
+
+        cr_db_close(pri_db, &tmp_err);
+        if (!tmp_err)
+            cr_db_close(fil_db, &tmp_err);
+        if (!tmp_err)
+            cr_db_close(fex_db, &tmp_err);
+        if (!tmp_err)
+            cr_db_close(oth_db, &tmp_err);
+        if (tmp_err) {
+            g_critical("Error while closing db: %s", tmp_err->message);
+            g_clear_error(&tmp_err);
+            exit(EXIT_FAILURE);
+        }
+
+
+        // Compress dbs and fill their records
+        // Every database has its own compress -> fill -> rename chain
+        // which runs as soon as there is a free thread in the pool.
+        pri_db_rec = cr_repomd_record_new("primary_db", pri_db_name);
+        fil_db_rec = cr_repomd_record_new("filelists_db", fil_db_name);
+        if (cmd_options->filelists_ext)
+            fex_db_rec = cr_repomd_record_new("filelists-ext_db", fex_db_name);
+        oth_db_rec = cr_repomd_record_new("other_db", oth_db_name);
+
+        // Set db version
+        pri_db_rec->db_ver = DEFAULT_DATABASE_VERSION;
+        fil_db_rec->db_ver = DEFAULT_DATABASE_VERSION;
+        if (cmd_options->filelists_ext)
+            fex_db_rec->db_ver = DEFAULT_DATABASE_VERSION;
+        oth_db_rec->db_ver = DEFAULT_DATABASE_VERSION;
+
+        cr_CompressionTask *pri_db_task = NULL;
+        cr_CompressionTask *fil_db_task = NULL;
+        cr_CompressionTask *fex_db_task = NULL;
+        cr_CompressionTask *oth_db_task = NULL;
+
+        cr_CompressionOptions pri_db_copts = cr_compression_options_map_get(
+                            cmd_options->compression_options, "primary_db");
+        pri_db_task = cr_compressiontask_new_with_options(pri_db_filename,
+                                                          pri_db_name,
+                                                          sqlite_compression,
+                                                          cmd_options->repomd_checksum_type,
+                                                          &pri_db_copts,
+                                                          NULL, FALSE, 1, NULL);
+        pri_db_rec_task = cr_repomdrecordtask_new(pri_db_rec,
+                                                  pri_db_task,
+                                                  cmd_options->repomd_checksum_type,
+                                                  cmd_options->unique_md_filenames,
+                                                  NULL);
+        g_thread_pool_push(rec_pool, pri_db_rec_task, NULL);
+
+        cr_CompressionOptions fil_db_copts = cr_compression_options_map_get(
+                            cmd_options->compression_options, "filelists_db");
+        fil_db_task = cr_compressiontask_new_with_options(fil_db_filename,
+                                                          fil_db_name,
+                                                          sqlite_compression,
+                                                          cmd_options->repomd_checksum_type,
+                                                          &fil_db_copts,
+                                                          NULL, FALSE, 1, NULL);
+        fil_db_rec_task = cr_repomdrecordtask_new(fil_db_rec,
+                                                  fil_db_task,
+                                                  cmd_options->repomd_checksum_type,
+                                                  cmd_options->unique_md_filenames,
+                                                  NULL);
+        g_thread_pool_push(rec_pool, fil_db_rec_task, NULL);
+
+        if (cmd_options->filelists_ext) {
+            cr_CompressionOptions fex_db_copts = cr_compression_options_map_get(
+                                cmd_options->compression_options, "filelists-ext_db");
+            fex_db_task = cr_compressiontask_new_with_options(fex_db_filename,
+                                                              fex_db_name,
+                                                              sqlite_compression,
+                                                              cmd_options->repomd_checksum_type,
+                                                              &fex_db_copts,
+                                                              NULL, FALSE, 1, NULL);
+            fex_db_rec_task = cr_repomdrecordtask_new(fex_db_rec,
+                                                      fex_db_task,
+                                                      cmd_options->repomd_checksum_type,
+                                                      cmd_options->unique_md_filenames,
+                                                      NULL);
+            g_thread_pool_push(rec_pool, fex_db_rec_task, NULL);
+        }
+
+        cr_CompressionOptions oth_db_copts = cr_compression_options_map_get(
+                            cmd_options->compression_options, "other_db");
+        oth_db_task = cr_compressiontask_new_with_options(oth_db_filename,
+                                                          oth_db_name,
+                                                          sqlite_compression,
+                                                          cmd_options->repomd_checksum_type,
+                                                          &oth_db_copts,
+                                                          NULL, FALSE, 1, NULL);
+        oth_db_rec_task = cr_repomdrecordtask_new(oth_db_rec,
+                                                  oth_db_task,
+                                                  cmd_options->repomd_checksum_type,
+                                                  cmd_options->unique_md_filenames,
+                                                  NULL);
+        g_thread_pool_push(rec_pool, oth_db_rec_task, NULL);
+
+        g_free(pri_db_name);
+        g_free(fil_db_name);
+        g_free(fex_db_name);
+        g_free(oth_db_name);
+    }
+
+    // Wait till all the chains end
+    g_thread_pool_free(rec_pool, FALSE, TRUE);
+    cr_metrics_observe_since(metrics, "compress_dbs_and_zck", chains_start);
+
+    // Record of a failed chain has no checksums, don't publish it
+    cr_RepomdRecordTask *rec_tasks[] = {
+        pri_db_rec_task, fil_db_rec_task, fex_db_rec_task, oth_db_rec_task,
+        pri_zck_rec_task, fil_zck_rec_task, fex_zck_rec_task, oth_zck_rec_task,
+    };
+    for (size_t x = 0; x < G_N_ELEMENTS(rec_tasks); x++) {
+        if (rec_tasks[x] && rec_tasks[x]->err && !tmp_err)
+            g_propagate_prefixed_error(&tmp_err,
+                                       g_error_copy(rec_tasks[x]->err),
+                                       "Cannot process %s: ",
+                                       rec_tasks[x]->record->type);
+    }
+
+    if (should_create_databases && !cmd_options->local_sqlite) {
+        cr_rm(pri_db_filename, CR_RM_FORCE, NULL, NULL);
+        cr_rm(fil_db_filename, CR_RM_FORCE, NULL, NULL);
+        if (cmd_options->filelists_ext)
+            cr_rm(fex_db_filename, CR_RM_FORCE, NULL, NULL);
+        cr_rm(oth_db_filename, CR_RM_FORCE, NULL, NULL);
+    }
+
+    cr_repomdrecordtask_free(pri_db_rec_task, NULL);
+    cr_repomdrecordtask_free(fil_db_rec_task, NULL);
+    cr_repomdrecordtask_free(fex_db_rec_task, NULL);
+    cr_repomdrecordtask_free(oth_db_rec_task, NULL);
+    cr_repomdrecordtask_free(pri_zck_rec_task, NULL);
+    cr_repomdrecordtask_free(fil_zck_rec_task, NULL);
+    cr_repomdrecordtask_free(fex_zck_rec_task, NULL);
+    cr_repomdrecordtask_free(oth_zck_rec_task, NULL);
+
     cr_contentstat_free(pri_zck_stat, NULL);
     cr_contentstat_free(fil_zck_stat, NULL);
     cr_contentstat_free(fex_zck_stat, NULL);
     cr_contentstat_free(oth_zck_stat, NULL);
 
+    if (tmp_err) {
+        g_critical("%s", tmp_err->message);
+        g_clear_error(&tmp_err);
+        exit_val = EXIT_FAILURE;
+
+        // None of the records is published
+        cr_repomd_record_free(pri_xml_rec);
+        cr_repomd_record_free(fil_xml_rec);
+        cr_repomd_record_free(fex_xml_rec);
+        cr_repomd_record_free(oth_xml_rec);
+        cr_repomd_record_free(pri_db_rec);
+        cr_repomd_record_free(fil_db_rec);
+        cr_repomd_record_free(fex_db_rec);
+        cr_repomd_record_free(oth_db_rec);
+        cr_repomd_record_free(pri_zck_rec);
+        cr_repomd_record_free(fil_zck_rec);
+        cr_repomd_record_free(fex_zck_rec);
+        cr_repomd_record_free(oth_zck_rec);
+        cr_repomd_record_free(pri_zstd_dict_rec);
+        cr_repomd_record_free(fil_zstd_dict_rec);
+        cr_repomd_record_free(fex_zstd_dict_rec);
+        cr_repomd_record_free(oth_zstd_dict_rec);
+        g_slist_free_full(additional_metadata_rec,
+                          (GDestroyNotify) cr_repomd_record_free);
+        additional_metadata_rec = NULL;
+
+        if (!cr_rm(tmp_out_repo, CR_RM_RECURSIVE, NULL, &tmp_err)) {
+            g_warning("Cannot remove %s: %s", tmp_out_repo, tmp_err->message);
+            g_clear_error(&tmp_err);
+        }
+
+        goto cleanup;
+    }
+
 #ifdef CR_DELTA_RPM_SUPPORT
     // Delta generation
     if (cmd_options->deltas) {
@@ -2125,6 +2649,10 @@ main(int argc, char **argv)
         cr_XmlFile *prestodelta_cr_zck_file = NULL;
         cr_ContentStat *prestodelta_stat = NULL;
         cr_ContentStat *prestodelta_zck_stat = NULL;
+        cr_CompressionOptions prestodelta_copts = cr_compression_options_map_get(
+                            cmd_options->compression_options, "prestodelta");
+        cr_CompressionOptions prestodelta_zck_copts = cr_compression_options_map_get(
+                            cmd_options->compression_options, "prestodelta_zck");
 
         filename = g_strconcat("prestodelta.xml",
                                compression_suffix,
@@ -2174,10 +2702,12 @@ main(int argc, char **argv)
 
         // 3) Generate prestodelta.xml file
         prestodelta_stat = cr_contentstat_new(cmd_options->repomd_checksum_type, NULL);
-        prestodelta_cr_file = cr_xmlfile_sopen_prestodelta(prestodelta_xml_filename,
-                                                           compression,
-                                                           prestodelta_stat,
-                                                           &tmp_err);
+        prestodelta_cr_file = cr_xmlfile_sopen_with_options(prestodelta_xml_filename,
+                                                            CR_XMLFILE_PRESTODELTA,
+                                                            compression,
+                                                            prestodelta_stat,
+                                                            &prestodelta_copts,
+                                                            &tmp_err);
         if (!prestodelta_cr_file) {
             g_critical("Cannot open %s: %s", prestodelta_xml_filename, tmp_err->message);
             g_clear_error(&tmp_err);
@@ -2193,10 +2723,12 @@ main(int argc, char **argv)
             g_free(filename);
 
             prestodelta_zck_stat = cr_contentstat_new(cmd_options->repomd_checksum_type, NULL);
-            prestodelta_cr_zck_file = cr_xmlfile_sopen_prestodelta(prestodelta_zck_filename,
-                                                                   CR_CW_ZCK_COMPRESSION,
-                                                                   prestodelta_zck_stat,
-                                                                   &tmp_err);
+            prestodelta_cr_zck_file = cr_xmlfile_sopen_with_options(prestodelta_zck_filename,
+                                                                    CR_XMLFILE_PRESTODELTA,
+                                                                    CR_CW_ZCK_COMPRESSION,
+                                                                    prestodelta_zck_stat,
+                                                                    &prestodelta_zck_copts,
+                                                                    &tmp_err);
             if (!prestodelta_cr_zck_file) {
                 g_critical("Cannot open %s: %s", prestodelta_zck_filename, tmp_err->message);
                 g_clear_error(&tmp_err);
@@ -2257,18 +2789,13 @@ deltaerror:
         if (cmd_options->filelists_ext)
             cr_repomd_record_rename_file(fex_xml_rec, NULL);
         cr_repomd_record_rename_file(oth_xml_rec, NULL);
-        cr_repomd_record_rename_file(pri_db_rec, NULL);
-        cr_repomd_record_rename_file(fil_db_rec, NULL);
-        if (cmd_options->filelists_ext)
-            cr_repomd_record_rename_file(fex_db_rec, NULL);
-        cr_repomd_record_rename_file(oth_db_rec, NULL);
-        cr_repomd_record_rename_file(pri_zck_rec, NULL);
-        cr_repomd_record_rename_file(fil_zck_rec, NULL);
-        if (cmd_options->filelists_ext)
-            cr_repomd_record_rename_file(fex_zck_rec, NULL);
-        cr_repomd_record_rename_file(oth_zck_rec, NULL);
+        // dbs and zck files are renamed by their cr_RepomdRecordTask
         cr_repomd_record_rename_file(prestodelta_rec, NULL);
         cr_repomd_record_rename_file(prestodelta_zck_rec, NULL);
+        cr_repomd_record_rename_file(pri_zstd_dict_rec, NULL);
+        cr_repomd_record_rename_file(fil_zstd_dict_rec, NULL);
+        cr_repomd_record_rename_file(fex_zstd_dict_rec, NULL);
+        cr_repomd_record_rename_file(oth_zstd_dict_rec, NULL);
         GSList *element = additional_metadata_rec;
         for (; element; element=g_slist_next(element)) {
             cr_repomd_record_rename_file(element->data, NULL);
@@ -2289,6 +2816,10 @@ deltaerror:
             cr_repomd_record_set_timestamp(fex_db_rec, revision);
         cr_repomd_record_set_timestamp(oth_db_rec, revision);
         cr_repomd_record_set_timestamp(prestodelta_rec, revision);
+        cr_repomd_record_set_timestamp(pri_zstd_dict_rec, revision);
+        cr_repomd_record_set_timestamp(fil_zstd_dict_rec, revision);
+        cr_repomd_record_set_timestamp(fex_zstd_dict_rec, revision);
+        cr_repomd_record_set_timestamp(oth_zstd_dict_rec, revision);
         GSList *element = additional_metadata_rec;
         for (; element; element=g_slist_next(element)) {
             cr_repomd_record_set_timestamp(element->data, revision);
@@ -2313,6 +2844,10 @@ deltaerror:
     cr_repomd_set_record(repomd_obj, oth_zck_rec);
     cr_repomd_set_record(repomd_obj, prestodelta_rec);
     cr_repomd_set_record(repomd_obj, prestodelta_zck_rec);
+    cr_repomd_set_record(repomd_obj, pri_zstd_dict_rec);
+    cr_repomd_set_record(repomd_obj, fil_zstd_dict_rec);
+    cr_repomd_set_record(repomd_obj, fex_zstd_dict_rec);
+    cr_repomd_set_record(repomd_obj, oth_zstd_dict_rec);
     GSList *elem = additional_metadata_rec;
     for (; elem; elem=g_slist_next(elem)) {
         cr_repomd_set_record(repomd_obj, elem->data);
@@ -2347,6 +2882,17 @@ deltaerror:
     if (old_metadata_location && cr_repomd_compare(repomd_obj, old_metadata_location->repomd_data) &&
         !cmd_options->retain_old && !cmd_options->retain_old_md_by_age) {
         g_message("New and old repodata match, not updating.");
+        if (fingerprint && !user_data.had_errors
+            && cr_fingerprint_write(fingerprint, out_repo, &tmp_err) != CRE_OK) {
+            g_warning("%s", tmp_err->message);
+            g_clear_error(&tmp_err);
+        }
+        if (user_data.snapshot) {
+            _cleanup_free_ gchar *old_snapshot = NULL;
+            old_snapshot = g_build_filename(out_repo, CR_SNAPSHOT_FILENAME, NULL);
+            if (!g_file_test(old_snapshot, G_FILE_TEST_EXISTS))
+                write_snapshot(user_data.snapshot, out_repo, repomd_obj, metrics);
+        }
         if (cr_rm(tmp_out_repo, CR_RM_RECURSIVE, NULL, &tmp_err)) {
             g_debug("tmp_out_repo %s removed", tmp_out_repo);
         } else {
@@ -2366,6 +2912,9 @@ deltaerror:
         exit(EXIT_FAILURE);
     }
 
+    if (user_data.snapshot)
+        write_snapshot(user_data.snapshot, tmp_out_repo, repomd_obj, metrics);
+
     // Write repomd.xml
     gchar *repomd_path = g_strconcat(tmp_out_repo, "repomd.xml", NULL);
     FILE *frepomd = fopen(repomd_path, "w");
@@ -2378,6 +2927,13 @@ deltaerror:
     g_free(repomd_xml);
     g_free(repomd_path);
 
+    // Runs with errors have to be repeated, don't store their fingerprint
+    if (fingerprint && !user_data.had_errors
+        && cr_fingerprint_write(fingerprint, tmp_out_repo, &tmp_err) != CRE_OK) {
+        g_warning("%s", tmp_err->message);
+        g_clear_error(&tmp_err);
+    }
+
 
     // Final move
     // Copy selected metadata from the old repository
@@ -2457,7 +3013,28 @@ cleanup:
     // Clean up
     g_debug("Memory cleanup");
 
+    if (metrics) {
+        for (GSList *elem = repomd_obj->records; elem; elem = g_slist_next(elem)) {
+            cr_RepomdRecord *rec = elem->data;
+            _cleanup_free_ gchar *written = g_strconcat("bytes_written_", rec->type, NULL);
+            cr_metrics_add(metrics, written, rec->size);
+            if (rec->size_open > 0) {
+                _cleanup_free_ gchar *open = g_strconcat("bytes_open_", rec->type, NULL);
+                cr_metrics_add(metrics, open, rec->size_open);
+            }
+        }
+
+        if (!cr_metrics_write(metrics, cmd_options->metrics_file, &tmp_err)) {
+            g_warning("Cannot write metrics to %s: %s",
+                      cmd_options->metrics_file, tmp_err->message);
+            g_clear_error(&tmp_err);
+        }
+        cr_metrics_free(metrics);
+    }
+
     cr_repomd_free(repomd_obj);
+    cr_snapshot_writer_free(user_data.snapshot);
+    cr_fingerprint_free(fingerprint);
 
     // Remove lock
     if (g_strcmp0(lock_dir, tmp_out_repo))
@@ -2472,6 +3049,10 @@ cleanup:
     if (old_metadata)
         cr_metadata_free(old_metadata);
 
+    // The run is done, the checkpoint is not needed anymore, unless some
+    // packages failed - a rerun can still skip the ones that passed
+    cr_checkpoint_free(checkpoint, !user_data.had_errors);
+
     g_free(user_data.prev_srpm);
     g_free(user_data.cur_srpm);
     g_free(in_repo);
@@ -2497,6 +3078,7 @@ cleanup:
 
     free_options(cmd_options);
     cr_package_parser_cleanup();
+    cr_zstd_dict_cleanup();
 
     g_debug("All done");
     exit(exit_val);
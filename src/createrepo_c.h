@@ -43,17 +43,22 @@ extern "C" {
 #include "compression_wrapper.h"
 #include "deltarpms.h"
 #include "error.h"
+#include "fingerprint.h"
 #include "load_metadata.h"
 #include "locate_metadata.h"
 #include "misc.h"
 #include "package.h"
 #include "parsehdr.h"
 #include "parsepkg.h"
+#include "prefetch.h"
+#include "repodiff.h"
 #include "repomd.h"
+#include "snapshot.h"
 #include "sqlite.h"
 #include "threads.h"
 #include "updateinfo.h"
 #include "version.h"
+#include "watch.h"
 #include "xml_dump.h"
 #include "xml_file.h"
 #include "xml_parser.h"
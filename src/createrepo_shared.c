@@ -287,3 +287,53 @@ cr_setup_logging(gboolean quiet, gboolean verbose)
         g_log_set_default_handler (cr_log_fn, GINT_TO_POINTER(hidden_levels));
     }
 }
+
+gchar *
+cr_prepare_zstd_dict(const char *old_dict_href,
+                     const char *old_xml_href,
+                     const char *tmp_out_repo,
+                     const char *name,
+                     gsize *dict_size,
+                     gchar **dict_filename)
+{
+    gchar *dict = NULL;
+    _cleanup_free_ gchar *filename = NULL;
+    _cleanup_error_free_ GError *tmp_err = NULL;
+
+    if (old_dict_href) {
+        if (!g_file_get_contents(old_dict_href, &dict, dict_size, &tmp_err)) {
+            g_warning("Cannot read zstd dictionary: %s", tmp_err->message);
+            return NULL;
+        }
+        g_debug("Reusing zstd dictionary %s", old_dict_href);
+    } else if (old_xml_href) {
+        dict = cr_zstd_dict_train(old_xml_href, "<package",
+                                  CR_CW_ZSTD_DICT_SIZE, dict_size, &tmp_err);
+        if (!dict) {
+            g_warning("%s", tmp_err->message);
+            return NULL;
+        }
+        g_debug("Trained zstd dictionary (%zu bytes) on %s",
+                (size_t) *dict_size, old_xml_href);
+    } else {
+        g_debug("No previous %s for zstd dictionary training", name);
+        return NULL;
+    }
+
+    if (!cr_zstd_dict_register(dict, *dict_size, &tmp_err)) {
+        g_warning("Cannot use zstd dictionary for %s: %s",
+                  name, tmp_err->message);
+        g_free(dict);
+        return NULL;
+    }
+
+    filename = g_strconcat(tmp_out_repo, "/", name, ".zdict", NULL);
+    if (!g_file_set_contents(filename, dict, *dict_size, &tmp_err)) {
+        g_warning("Cannot write zstd dictionary: %s", tmp_err->message);
+        g_free(dict);
+        return NULL;
+    }
+
+    *dict_filename = g_steal_pointer(&filename);
+    return dict;
+}
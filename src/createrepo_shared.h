@@ -120,6 +120,28 @@ cr_unset_cleanup_handler(GError **err);
 void
 cr_setup_logging(gboolean quiet, gboolean verbose);
 
+/**
+ * Prepare a zstd dictionary for xml metadata. The dictionary advertised
+ * by the previous repodata is reused (so clients can keep it cached),
+ * otherwise a new one is trained on the previous metadata. The dictionary
+ * is registered (see cr_zstd_dict_register()) and stored as
+ * tmp_out_repo/<name>.zdict.
+ * @param old_dict_href     Path to the previous dictionary or NULL
+ * @param old_xml_href      Path to the previous metadata or NULL
+ * @param tmp_out_repo      Dir with the new repodata
+ * @param name              Name of the metadata (e.g. "primary.xml")
+ * @param dict_size         Size of the returned dictionary
+ * @param dict_filename     Path to the stored dictionary
+ * @return                  Dictionary or NULL if there is no usable one
+ */
+gchar *
+cr_prepare_zstd_dict(const char *old_dict_href,
+                     const char *old_xml_href,
+                     const char *tmp_out_repo,
+                     const char *name,
+                     gsize *dict_size,
+                     gchar **dict_filename);
+
 /** @} */
 
 #ifdef __cplusplus
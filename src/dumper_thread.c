@@ -45,6 +45,13 @@ struct BufferedTask {
     cr_Package *pkg;                // Package structure
 };
 
+static void
+add_chunk_metrics(cr_Metrics *metrics, const char *counter, const char *chunk)
+{
+    if (metrics && chunk)
+        cr_metrics_add(metrics, counter, strlen(chunk));
+}
+
 
 static gint
 buf_task_sort_func(gconstpointer a, gconstpointer b, G_GNUC_UNUSED gpointer data)
@@ -101,9 +108,12 @@ write_pkg(long id,
     GError *tmp_err = NULL;
 
     // Write primary data
+    gint64 stage_start = g_get_monotonic_time();
     g_mutex_lock(&(udata->mutex_pri));
     while (udata->id_pri != id)
         g_cond_wait (&(udata->cond_pri), &(udata->mutex_pri));
+    cr_metrics_observe_since(udata->metrics, "wait_primary", stage_start);
+    stage_start = g_get_monotonic_time();
 
     udata->package_count++;
     g_free(udata->prev_srpm);
@@ -114,6 +124,7 @@ write_pkg(long id,
         new_pkg = TRUE;
 
     ++udata->id_pri;
+    add_chunk_metrics(udata->metrics, "xml_bytes_primary", res.primary);
     cr_xmlfile_add_chunk(udata->pri_f, (const char *) res.primary, &tmp_err);
     if (tmp_err) {
         g_critical("Cannot add primary chunk:\n%s\nError: %s",
@@ -123,7 +134,9 @@ write_pkg(long id,
     }
 
     if (udata->pri_db) {
+        gint64 db_start = g_get_monotonic_time();
         cr_db_add_pkg(udata->pri_db, pkg, &tmp_err);
+        cr_metrics_observe_since(udata->metrics, "sqlite", db_start);
         if (tmp_err) {
             g_critical("Cannot add record of %s (%s) to primary db: %s",
                        pkg->name, pkg->pkgId, tmp_err->message);
@@ -149,14 +162,19 @@ write_pkg(long id,
         }
     }
 
+    cr_metrics_observe_since(udata->metrics, "write_primary", stage_start);
     g_cond_broadcast(&(udata->cond_pri));
     g_mutex_unlock(&(udata->mutex_pri));
 
     // Write fielists data
+    stage_start = g_get_monotonic_time();
     g_mutex_lock(&(udata->mutex_fil));
     while (udata->id_fil != id)
         g_cond_wait (&(udata->cond_fil), &(udata->mutex_fil));
+    cr_metrics_observe_since(udata->metrics, "wait_filelists", stage_start);
+    stage_start = g_get_monotonic_time();
     ++udata->id_fil;
+    add_chunk_metrics(udata->metrics, "xml_bytes_filelists", res.filelists);
     cr_xmlfile_add_chunk(udata->fil_f, (const char *) res.filelists, &tmp_err);
     if (tmp_err) {
         g_critical("Cannot add filelists chunk:\n%s\nError: %s",
@@ -166,7 +184,9 @@ write_pkg(long id,
     }
 
     if (udata->fil_db) {
+        gint64 db_start = g_get_monotonic_time();
         cr_db_add_pkg(udata->fil_db, pkg, &tmp_err);
+        cr_metrics_observe_since(udata->metrics, "sqlite", db_start);
         if (tmp_err) {
             g_critical("Cannot add record of %s (%s) to filelists db: %s",
                        pkg->name, pkg->pkgId, tmp_err->message);
@@ -192,15 +212,20 @@ write_pkg(long id,
         }
     }
 
+    cr_metrics_observe_since(udata->metrics, "write_filelists", stage_start);
     g_cond_broadcast(&(udata->cond_fil));
     g_mutex_unlock(&(udata->mutex_fil));
 
     // Write filelists-ext data
     if (udata->filelists_ext) {
+        stage_start = g_get_monotonic_time();
         g_mutex_lock(&(udata->mutex_fex));
         while (udata->id_fex != id)
             g_cond_wait (&(udata->cond_fex), &(udata->mutex_fex));
+        cr_metrics_observe_since(udata->metrics, "wait_filelists_ext", stage_start);
+        stage_start = g_get_monotonic_time();
         ++udata->id_fex;
+        add_chunk_metrics(udata->metrics, "xml_bytes_filelists_ext", res.filelists_ext);
         cr_xmlfile_add_chunk(udata->fex_f, (const char *) res.filelists_ext, &tmp_err);
         if (tmp_err) {
             g_critical("Cannot add filelists-ext chunk:\n%s\nError: %s",
@@ -210,7 +235,9 @@ write_pkg(long id,
         }
 
         if (udata->fex_db) {
+            gint64 db_start = g_get_monotonic_time();
             cr_db_add_pkg(udata->fex_db, pkg, &tmp_err);
+            cr_metrics_observe_since(udata->metrics, "sqlite", db_start);
             if (tmp_err) {
                 g_critical("Cannot add record of %s (%s) to filelists-ext db: %s",
                            pkg->name, pkg->pkgId, tmp_err->message);
@@ -236,15 +263,20 @@ write_pkg(long id,
             }
         }
 
+        cr_metrics_observe_since(udata->metrics, "write_filelists_ext", stage_start);
         g_cond_broadcast(&(udata->cond_fex));
         g_mutex_unlock(&(udata->mutex_fex));
     }
 
     // Write other data
+    stage_start = g_get_monotonic_time();
     g_mutex_lock(&(udata->mutex_oth));
     while (udata->id_oth != id)
         g_cond_wait (&(udata->cond_oth), &(udata->mutex_oth));
+    cr_metrics_observe_since(udata->metrics, "wait_other", stage_start);
+    stage_start = g_get_monotonic_time();
     ++udata->id_oth;
+    add_chunk_metrics(udata->metrics, "xml_bytes_other", res.other);
     cr_xmlfile_add_chunk(udata->oth_f, (const char *) res.other, &tmp_err);
     if (tmp_err) {
         g_critical("Cannot add other chunk:\n%s\nError: %s",
@@ -254,7 +286,9 @@ write_pkg(long id,
     }
 
     if (udata->oth_db) {
+        gint64 db_start = g_get_monotonic_time();
         cr_db_add_pkg(udata->oth_db, pkg, NULL);
+        cr_metrics_observe_since(udata->metrics, "sqlite", db_start);
         if (tmp_err) {
             g_critical("Cannot add record of %s (%s) to other db: %s",
                        pkg->name, pkg->pkgId, tmp_err->message);
@@ -279,6 +313,21 @@ write_pkg(long id,
             g_clear_error(&tmp_err);
         }
     }
+    cr_metrics_observe_since(udata->metrics, "write_other", stage_start);
+
+    if (udata->snapshot)
+        cr_snapshot_writer_add_pkg(udata->snapshot, pkg);
+
+    // Other is the last serialized stream, all packages with lower id
+    // are completely written at this point
+    if (udata->checkpoint) {
+        cr_checkpoint_add_pkg(udata->checkpoint, id, &res, &tmp_err);
+        if (tmp_err) {
+            g_warning("Cannot checkpoint %s (%s): %s",
+                      pkg->name, pkg->pkgId, tmp_err->message);
+            g_clear_error(&tmp_err);
+        }
+    }
     g_cond_broadcast(&(udata->cond_oth));
     g_mutex_unlock(&(udata->mutex_oth));
 }
@@ -344,6 +393,7 @@ get_checksum(const char *filename,
              cr_ChecksumType type,
              cr_Package *pkg,
              const char *cachedir,
+             cr_Metrics *metrics,
              GError **err)
 {
     GError *tmp_err = NULL;
@@ -384,12 +434,17 @@ get_checksum(const char *filename,
 
         if (checksum) {
             g_debug("Cached checksum used: %s: \"%s\"", cachefn, checksum);
+            cr_metrics_add(metrics, "checksum_cache_hits", 1);
             goto exit;
         }
+        cr_metrics_add(metrics, "checksum_cache_misses", 1);
     }
 
     // Calculate checksum
+    gint64 stage_start = g_get_monotonic_time();
     checksum = cr_checksum_file(filename, type, &tmp_err);
+    cr_metrics_observe_since(metrics, "checksum", stage_start);
+    cr_metrics_add(metrics, "rpm_bytes_read", pkg->size_package);
     if (!checksum) {
         g_propagate_prefixed_error(err, tmp_err,
                                    "Error while checksum calculation: ");
@@ -448,6 +503,8 @@ load_rpm(const char *fullpath,
          int changelog_limit,
          struct stat *stat_buf,
          cr_HeaderReadingFlags hdrrflags,
+         cr_Metrics *metrics,
+         cr_Prefetch *prefetch,
          GError **err)
 {
     cr_Package *pkg = NULL;
@@ -457,7 +514,10 @@ load_rpm(const char *fullpath,
     assert(!err || *err == NULL);
 
     // Get a package object
+    gint64 stage_start = g_get_monotonic_time();
     pkg = cr_package_from_rpm_base(fullpath, changelog_limit, hdrrflags, err);
+    cr_metrics_observe_since(metrics, "header_read", stage_start);
+    cr_prefetch_observe(prefetch, g_get_monotonic_time() - stage_start);
     if (!pkg)
         goto errexit;
 
@@ -489,7 +549,7 @@ load_rpm(const char *fullpath,
 
     // Compute checksum
     char *checksum = get_checksum(fullpath, checksum_type, pkg,
-                                  checksum_cachedir, &tmp_err);
+                                  checksum_cachedir, metrics, &tmp_err);
     if (!checksum) {
         g_propagate_error(err, tmp_err);
         goto errexit;
@@ -516,6 +576,106 @@ errexit:
     return NULL;
 }
 
+/** Location href and location base of the package as they are written
+ * into the metadata.
+ */
+static void
+task_locations(struct UserData *udata,
+               const char *full_path,
+               long media_id,
+               gchar **location_href,
+               gchar **location_base)
+{
+    // get location_href without leading part of path (path to repo)
+    // including '/' char
+    *location_href = g_strdup(full_path + udata->repodir_name_len);
+    *location_base = g_strdup(udata->location_base);
+
+    // User requested modification of the location href
+    if (udata->cut_dirs) {
+        gchar *tmp = *location_href;
+        *location_href = g_strdup(cr_cut_dirs(tmp, udata->cut_dirs));
+        g_free(tmp);
+    }
+
+    if (udata->location_prefix) {
+        gchar *tmp = *location_href;
+        *location_href = g_build_filename(udata->location_prefix, tmp, NULL);
+        g_free(tmp);
+    }
+
+    // Prepare location base (if split option is used)
+    if (media_id) {
+        gchar *tmp = *location_base;
+        *location_base = prepare_split_media_baseurl(media_id, tmp);
+        g_free(tmp);
+    }
+}
+
+/** Decide whether the old metadata of the package can be used instead
+ * of reading the package.
+ * @param reason        Why they cannot be used (for a debug message)
+ */
+static gboolean
+old_metadata_usable(struct UserData *udata,
+                    cr_Package *md,
+                    long media_id,
+                    const char *location_base,
+                    const struct stat *stat_buf,
+                    const char **reason)
+{
+    if (media_id && g_strcmp0(md->location_base, location_base)) {
+        // In split mode the cache is per media, a package with
+        // the same href from another media is a different package
+        *reason = "belong to another media";
+        return FALSE;
+    }
+
+    if (udata->skip_stat)
+        return TRUE;
+
+    if (stat_buf->st_mtime == md->time_file
+        && stat_buf->st_size == md->size_package
+        && !strcmp(udata->checksum_type_str, md->checksum_type))
+        return TRUE;
+
+    *reason = "are obsolete";
+    return FALSE;
+}
+
+gboolean
+cr_dumper_prefetch_needed(const char *path, long media_id, void *user_data)
+{
+    struct UserData *udata = (struct UserData *) user_data;
+    _cleanup_free_ gchar *location_href = NULL;
+    _cleanup_free_ gchar *location_base = NULL;
+    const char *reason;
+    cr_Package *md;
+    struct stat stat_buf;
+    gboolean usable = FALSE;
+
+    if (!udata->old_metadata)
+        return TRUE;
+
+    if (!udata->skip_stat && stat(path, &stat_buf) == -1)
+        return FALSE;
+
+    task_locations(udata, path, media_id, &location_href, &location_base);
+
+    // Only a lookup, the package is stolen (and modified) by the worker,
+    // so it is compared under the lock
+    g_mutex_lock(&(udata->mutex_old_md));
+    md = (cr_Package *) g_hash_table_lookup(
+                            cr_metadata_hashtable(udata->old_metadata),
+                            cr_get_cleaned_href(location_href));
+    if (md)
+        usable = old_metadata_usable(udata, md, media_id, location_base,
+                                     &stat_buf, &reason);
+    g_mutex_unlock(&(udata->mutex_old_md));
+
+    return !usable;
+}
+
 void
 cr_dumper_thread(gpointer data, gpointer user_data)
 {
@@ -530,6 +690,9 @@ cr_dumper_thread(gpointer data, gpointer user_data)
     struct UserData *udata = (struct UserData *) user_data;
     struct PoolTask *task  = (struct PoolTask *) data;
 
+    // Start reading of the packages the workers take next
+    cr_prefetch_advance(udata->prefetch, task->id);
+
     struct DelayedTask *dtask = NULL;
     if (udata->delayed_write) {
         // even if we might found out that this is an invalid package,
@@ -542,34 +705,10 @@ cr_dumper_thread(gpointer data, gpointer user_data)
         dtask->pkg = NULL;
     }
 
-    // get location_href without leading part of path (path to repo)
-    // including '/' char
     _cleanup_free_ gchar *location_href = NULL;
-    location_href = g_strdup(task->full_path + udata->repodir_name_len);
-
     _cleanup_free_ gchar *location_base = NULL;
-    location_base = g_strdup(udata->location_base);
-
-    // User requested modification of the location href
-    if (udata->cut_dirs) {
-        gchar *tmp = location_href;
-        location_href = g_strdup(cr_cut_dirs(location_href, udata->cut_dirs));
-        g_free(tmp);
-    }
-
-    if (udata->location_prefix) {
-        gchar *tmp = location_href;
-        location_href = g_build_filename(udata->location_prefix, tmp, NULL);
-        g_free(tmp);
-    }
-
-    // Prepare location base (if split option is used)
-    if (task->media_id) {
-        gchar *new_location_base = prepare_split_media_baseurl(task->media_id,
-                                                               location_base);
-        g_free(location_base);
-        location_base = new_location_base;
-    }
+    task_locations(udata, task->full_path, task->media_id,
+                   &location_href, &location_base);
 
     // If --cachedir is used, load signatures and hdrid from packages too
     if (udata->checksum_cachedir)
@@ -599,19 +738,15 @@ cr_dumper_thread(gpointer data, gpointer user_data)
         g_mutex_unlock(&(udata->mutex_old_md));
 
         if (md) {
+            const char *reason;
+
             g_debug("CACHE HIT %s", task->filename);
 
-            if (udata->skip_stat) {
-                old_used = TRUE;
-            } else if (stat_buf.st_mtime == md->time_file
-                       && stat_buf.st_size == md->size_package
-                       && !strcmp(udata->checksum_type_str, md->checksum_type))
-            {
-                old_used = TRUE;
-            } else {
-                g_debug("%s metadata are obsolete -> generating new",
-                        task->filename);
-            }
+            old_used = old_metadata_usable(udata, md, task->media_id,
+                                           location_base, &stat_buf, &reason);
+            if (!old_used)
+                g_debug("%s metadata %s -> generating new",
+                        task->filename, reason);
 
             if (old_used) {
                 // CR_PACKAGE_SINGLE_CHUNK used with the preloaded (old)
@@ -634,13 +769,19 @@ cr_dumper_thread(gpointer data, gpointer user_data)
         }
     }
 
+    if (udata->old_metadata)
+        cr_metrics_add(udata->metrics,
+                       old_used ? "update_cache_hits" : "update_cache_misses",
+                       1);
+
     // Load package and gen XML metadata
     if (!old_used) {
         // Load package from file
         pkg = load_rpm(task->full_path, udata->checksum_type,
                        udata->checksum_cachedir, location_href,
                        location_base, udata->changelog_limit,
-                       NULL, hdrrflags, &tmp_err);
+                       NULL, hdrrflags, udata->metrics, udata->prefetch,
+                       &tmp_err);
         assert(pkg || tmp_err);
 
         if (!pkg) {
@@ -684,6 +825,15 @@ cr_dumper_thread(gpointer data, gpointer user_data)
     }
 #endif
 
+    if (udata->media_stats && task->media_id) {
+        struct MediaStats *mstats = &g_array_index(udata->media_stats,
+                                                   struct MediaStats,
+                                                   task->media_id);
+        g_atomic_int_inc(&mstats->packages);
+        if (old_used)
+            g_atomic_int_inc(&mstats->reused);
+    }
+
     // Allow checking that the same package (NEVRA) isn't present multiple times in the metadata
     // Keep a hashtable of NEVRA mapped to an array-list of location_href values
     g_mutex_lock(&(udata->mutex_nevra_table));
@@ -718,11 +868,13 @@ cr_dumper_thread(gpointer data, gpointer user_data)
     // Pre-calculate the XML data aside any critical section, and early enough
     // so we can put it into the buffer (so buffered single-threaded write later
     // is faster).
+    gint64 stage_start = g_get_monotonic_time();
     if (udata->filelists_ext) {
         res = cr_xml_dump_ext(pkg,  &tmp_err);
     } else {
         res = cr_xml_dump(pkg, &tmp_err);
     }
+    cr_metrics_observe_since(udata->metrics, "xml_dump", stage_start);
     if (tmp_err) {
         g_critical("Cannot dump XML for %s (%s): %s",
                    pkg->name, pkg->pkgId, tmp_err->message);
@@ -750,6 +902,8 @@ cr_dumper_thread(gpointer data, gpointer user_data)
         buf_task->pkg = pkg;
 
         g_queue_insert_sorted(udata->buffer, buf_task, buf_task_sort_func, NULL);
+        cr_metrics_peak(udata->metrics, "buffered_tasks",
+                        g_queue_get_length(udata->buffer));
         g_mutex_unlock(&(udata->mutex_buffer));
 
         g_free(task->full_path);
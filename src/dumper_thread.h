@@ -26,10 +26,14 @@ extern "C" {
 
 #include <glib.h>
 #include <rpm/rpmlib.h>
+#include "checkpoint.h"
 #include "load_metadata.h"
 #include "locate_metadata.h"
+#include "metrics.h"
 #include "misc.h"
 #include "package.h"
+#include "prefetch.h"
+#include "snapshot.h"
 #include "sqlite.h"
 #include "xml_file.h"
 
@@ -46,6 +50,13 @@ struct PoolTask {
     char* path;                     // Just path     - /foo/bar/packages
 };
 
+/** Per media statistics in split mode (--split).
+ */
+struct MediaStats {
+    gint packages;                  // Number of processed packages
+    gint reused;                    // Packages reused from old metadata
+};
+
 struct DuplicateLocation {
     gchar *location;
     cr_Package *pkg;
@@ -87,6 +98,8 @@ struct UserData {
     gboolean skip_stat;             // Skip stat() while updating
     cr_Metadata *old_metadata;      // Loaded metadata
     GMutex mutex_old_md;            // Mutex for accessing old metadata
+    GArray *media_stats;            // struct MediaStats indexed by media_id
+                                    // (split mode only, NULL otherwise)
 
     // Thread serialization
     GMutex mutex_pri;               // Mutex for primary metadata
@@ -123,9 +136,31 @@ struct UserData {
     FILE *output_pkg_list;          // File where a list of read packages is written
     GMutex mutex_output_pkg_list;   // Mutex for output_pkg_list file
     GArray *delayed_write;          // Dump these files once all packages are loaded
+
+    // Checkpointing
+    cr_Checkpoint *checkpoint;      // Journal of written packages (--checkpoint)
+
+    // Instrumentation
+    cr_Metrics *metrics;            // Run metrics (--metrics-file) or NULL
+
+    // Snapshot
+    cr_SnapshotWriter *snapshot;    // Snapshot writer (--snapshot) or NULL
+
+    // Readahead
+    cr_Prefetch *prefetch;          // Prefetcher of packages or NULL
 };
 
 
+/** Prefetch only packages that will be read - not the ones whose
+ * metadata will be reused from the old metadata (cr_PrefetchNeededFunc).
+ * @param path          Path to the package
+ * @param media_id      ID of media in split mode, 0 otherwise
+ * @param user_data     struct UserData
+ * @return              TRUE if the package will be read
+ */
+gboolean
+cr_dumper_prefetch_needed(const char *path, long media_id, void *user_data);
+
 void
 cr_dumper_thread(gpointer data, gpointer user_data);
 
@@ -85,6 +85,8 @@ cr_strerror(cr_Error rc)
             return "Child process exited abnormally";
         case CRE_DELTARPM:
             return "Deltarpm error";
+        case CRE_SNAPSHOT:
+            return "Repodata snapshot error";
         default:
             return "Unknown error";
     }
@@ -100,6 +100,8 @@ typedef enum {
         (35) modulemd related error */
     CRE_ZSTD, /*!<
         (36) Zstd library related error */
+    CRE_SNAPSHOT, /*!<
+        (37) Missing, stale or invalid repodata snapshot */
     CRE_SENTINEL, /*!<
         (XX) Sentinel */
 } cr_Error;
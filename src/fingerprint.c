@@ -0,0 +1,214 @@
+/* createrepo_c - Library of routines for manipulation with repodata
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#include <glib.h>
+#include <assert.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "cleanup.h"
+#include "error.h"
+#include "fingerprint.h"
+
+#define ERR_DOMAIN              CREATEREPO_C_ERROR
+#define FINGERPRINT_GROUP       "fingerprint"
+
+struct _cr_Fingerprint {
+    GChecksum *checksum;        // NULL once finished
+    gchar *result;              // Hex fingerprint once finished
+};
+
+cr_Fingerprint *
+cr_fingerprint_new(void)
+{
+    cr_Fingerprint *fp = g_new0(cr_Fingerprint, 1);
+    fp->checksum = g_checksum_new(G_CHECKSUM_SHA256);
+    return fp;
+}
+
+/** Feed a NUL terminated field, so adjacent fields cannot be confused.
+ */
+static void
+fingerprint_field(cr_Fingerprint *fp, const char *str)
+{
+    g_checksum_update(fp->checksum, (const guchar *) str, strlen(str) + 1);
+}
+
+void
+cr_fingerprint_add_string(cr_Fingerprint *fp,
+                          const char *key,
+                          const char *value)
+{
+    if (!fp)
+        return;
+
+    assert(fp->checksum);
+    assert(key);
+
+    fingerprint_field(fp, value ? "S" : "N");
+    fingerprint_field(fp, key);
+    if (value)
+        fingerprint_field(fp, value);
+}
+
+void
+cr_fingerprint_add_file(cr_Fingerprint *fp, const char *path)
+{
+    struct stat st;
+    _cleanup_free_ gchar *attrs = NULL;
+
+    if (!fp)
+        return;
+
+    assert(fp->checksum);
+    assert(path);
+
+    if (stat(path, &st) == 0)
+        attrs = g_strdup_printf("%lld %lld.%09ld %llu",
+                                (long long) st.st_size,
+                                (long long) st.st_mtim.tv_sec,
+                                (long) st.st_mtim.tv_nsec,
+                                (unsigned long long) st.st_ino);
+
+    fingerprint_field(fp, "F");
+    fingerprint_field(fp, path);
+    fingerprint_field(fp, attrs ? attrs : "-");
+}
+
+const char *
+cr_fingerprint_finish(cr_Fingerprint *fp)
+{
+    assert(fp);
+
+    if (!fp->result) {
+        fp->result = g_strdup(g_checksum_get_string(fp->checksum));
+        g_checksum_free(fp->checksum);
+        fp->checksum = NULL;
+    }
+
+    return fp->result;
+}
+
+/** Checksum of repomd.xml in the repodata directory or NULL.
+ */
+static gchar *
+repomd_checksum(const char *repodata_dir, GError **err)
+{
+    _cleanup_free_ gchar *path = NULL;
+    _cleanup_free_ gchar *content = NULL;
+    gsize length;
+
+    path = g_build_filename(repodata_dir, "repomd.xml", NULL);
+    if (!g_file_get_contents(path, &content, &length, err))
+        return NULL;
+
+    return g_compute_checksum_for_data(G_CHECKSUM_SHA256,
+                                       (const guchar *) content, length);
+}
+
+gboolean
+cr_fingerprint_matches(cr_Fingerprint *fp, const char *repodata_dir)
+{
+    GKeyFile *keyfile;
+    gboolean match = FALSE;
+    _cleanup_free_ gchar *path = NULL;
+    _cleanup_free_ gchar *inputs = NULL;
+    _cleanup_free_ gchar *stored_repomd = NULL;
+    _cleanup_free_ gchar *repomd = NULL;
+
+    assert(fp);
+    assert(repodata_dir);
+
+    path = g_build_filename(repodata_dir, CR_FINGERPRINT_FILENAME, NULL);
+    keyfile = g_key_file_new();
+    if (!g_key_file_load_from_file(keyfile, path, G_KEY_FILE_NONE, NULL)) {
+        g_key_file_free(keyfile);
+        return FALSE;
+    }
+
+    inputs = g_key_file_get_string(keyfile, FINGERPRINT_GROUP, "inputs", NULL);
+    stored_repomd = g_key_file_get_string(keyfile, FINGERPRINT_GROUP,
+                                          "repomd", NULL);
+    g_key_file_free(keyfile);
+
+    if (!inputs || !stored_repomd
+        || g_strcmp0(inputs, cr_fingerprint_finish(fp))) {
+        g_debug("%s: Input fingerprint doesn't match", __func__);
+        return FALSE;
+    }
+
+    // Metadata could be modified or replaced by something else
+    repomd = repomd_checksum(repodata_dir, NULL);
+    match = !g_strcmp0(repomd, stored_repomd);
+    if (!match)
+        g_debug("%s: repomd.xml was changed", __func__);
+
+    return match;
+}
+
+int
+cr_fingerprint_write(cr_Fingerprint *fp,
+                     const char *repodata_dir,
+                     GError **err)
+{
+    GKeyFile *keyfile;
+    GError *tmp_err = NULL;
+    _cleanup_free_ gchar *path = NULL;
+    _cleanup_free_ gchar *repomd = NULL;
+    _cleanup_free_ gchar *data = NULL;
+    gsize length;
+
+    assert(fp);
+    assert(repodata_dir);
+    assert(!err || *err == NULL);
+
+    repomd = repomd_checksum(repodata_dir, &tmp_err);
+    if (!repomd) {
+        g_propagate_prefixed_error(err, tmp_err, "Cannot read repomd.xml: ");
+        return CRE_IO;
+    }
+
+    keyfile = g_key_file_new();
+    g_key_file_set_string(keyfile, FINGERPRINT_GROUP, "inputs",
+                          cr_fingerprint_finish(fp));
+    g_key_file_set_string(keyfile, FINGERPRINT_GROUP, "repomd", repomd);
+    data = g_key_file_to_data(keyfile, &length, NULL);
+    g_key_file_free(keyfile);
+
+    path = g_build_filename(repodata_dir, CR_FINGERPRINT_FILENAME, NULL);
+    if (!g_file_set_contents(path, data, length, &tmp_err)) {
+        g_propagate_prefixed_error(err, tmp_err,
+                                   "Cannot write input fingerprint: ");
+        return CRE_IO;
+    }
+
+    return CRE_OK;
+}
+
+void
+cr_fingerprint_free(cr_Fingerprint *fp)
+{
+    if (!fp)
+        return;
+
+    if (fp->checksum)
+        g_checksum_free(fp->checksum);
+    g_free(fp->result);
+    g_free(fp);
+}
@@ -0,0 +1,114 @@
+/* createrepo_c - Library of routines for manipulation with repodata
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#ifndef __C_CREATEREPOLIB_FINGERPRINT_H__
+#define __C_CREATEREPOLIB_FINGERPRINT_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <glib.h>
+
+/** \defgroup   fingerprint     Fingerprint of createrepo_c inputs
+ *  \addtogroup fingerprint
+ *  @{
+ *
+ * The fingerprint is a sha256 of everything a createrepo_c run depends
+ * on: the options, the ordered list of input files with their size,
+ * mtime and inode, and the version of createrepo_c. It is stored in
+ * a key file in the repodata directory (it is not listed in repomd.xml)
+ * together with the checksum of the repomd.xml it belongs to. A run with
+ * the same fingerprint as the stored one, whose repomd.xml wasn't
+ * changed since, would produce the same metadata.
+ */
+
+/** Name of the fingerprint file in the repodata directory.
+ */
+#define CR_FINGERPRINT_FILENAME     "input.fingerprint"
+
+/** Fingerprint being computed.
+ */
+typedef struct _cr_Fingerprint cr_Fingerprint;
+
+/** Create a new fingerprint.
+ * @return              New cr_Fingerprint
+ */
+cr_Fingerprint *
+cr_fingerprint_new(void);
+
+/** Add a named value (an option, a version, ...).
+ * @param fp            Fingerprint (if NULL, nothing is done)
+ * @param key           Name of the value
+ * @param value         Value or NULL
+ */
+void
+cr_fingerprint_add_string(cr_Fingerprint *fp,
+                          const char *key,
+                          const char *value);
+
+/** Add a file identified by its path, size, mtime and inode. Content of
+ * the file is not read. A file which doesn't exist is added as such.
+ * @param fp            Fingerprint (if NULL, nothing is done)
+ * @param path          Path to the file (or a directory)
+ */
+void
+cr_fingerprint_add_file(cr_Fingerprint *fp, const char *path);
+
+/** Finish the fingerprint. Nothing can be added then.
+ * @param fp            Fingerprint
+ * @return              Fingerprint string owned by the fp
+ */
+const char *
+cr_fingerprint_finish(cr_Fingerprint *fp);
+
+/** Check the fingerprint stored in the repodata directory.
+ * @param fp            Finished fingerprint
+ * @param repodata_dir  Repodata directory (with repomd.xml)
+ * @return              TRUE if the stored fingerprint is the same and
+ *                      repomd.xml wasn't changed since it was stored
+ */
+gboolean
+cr_fingerprint_matches(cr_Fingerprint *fp, const char *repodata_dir);
+
+/** Store the fingerprint into the repodata directory. The repomd.xml
+ * in the directory has to be already written.
+ * @param fp            Finished fingerprint
+ * @param repodata_dir  Repodata directory (with repomd.xml)
+ * @param err           GError **
+ * @return              cr_Error code
+ */
+int
+cr_fingerprint_write(cr_Fingerprint *fp,
+                     const char *repodata_dir,
+                     GError **err);
+
+/** Free the fingerprint.
+ * @param fp            Fingerprint or NULL
+ */
+void
+cr_fingerprint_free(cr_Fingerprint *fp);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __C_CREATEREPOLIB_FINGERPRINT_H__ */
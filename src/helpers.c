@@ -33,6 +33,8 @@
 #include "threads.h"
 #include "xml_dump.h"
 #include "locate_metadata.h"
+#include "fingerprint.h"
+#include "snapshot.h"
 
 #define ERR_DOMAIN      CREATEREPO_C_ERROR
 
@@ -414,8 +416,10 @@ cr_old_metadata_retention(const char *old_repo,
     if (!ret)
         return FALSE;
 
-    // Never copy old repomd.xml to the new repository
+    // Never copy old repomd.xml, snapshot and fingerprint to the new repository
     excludelist = g_slist_prepend(excludelist, g_strdup("repomd.xml"));
+    excludelist = g_slist_prepend(excludelist, g_strdup(CR_SNAPSHOT_FILENAME));
+    excludelist = g_slist_prepend(excludelist, g_strdup(CR_FINGERPRINT_FILENAME));
 
     // Open directory with old repo
     dirp = g_dir_open (old_repo, 0, &tmp_err);
@@ -449,11 +453,17 @@ cr_old_metadata_retention(const char *old_repo,
             continue;
         }
 
-        cr_gio_cp(g_file_new_for_path(full_path),
-              g_file_new_for_path(new_full_path),
-              G_FILE_COPY_ALL_METADATA,
-              NULL,
-              &tmp_err);
+        if (g_file_test(full_path, G_FILE_TEST_IS_REGULAR)) {
+            // Old files are never modified, so they can be shared
+            cr_carry_over_file(full_path, new_full_path,
+                               CR_CARRY_OVER_COPY, &tmp_err);
+        } else {
+            cr_gio_cp(g_file_new_for_path(full_path),
+                  g_file_new_for_path(new_full_path),
+                  G_FILE_COPY_ALL_METADATA,
+                  NULL,
+                  &tmp_err);
+        }
 
         if (tmp_err) {
             g_warning("Cannot copy %s -> %s: %s",
@@ -19,9 +19,11 @@
  */
 
 #include "koji.h"
+#include "compression_wrapper.h"
 #include "error.h"
 #include "load_metadata.h"
 #include "misc.h"
+#include "xml_parser.h"
 
 void
 cr_srpm_val_destroy(gpointer data)
@@ -95,6 +97,93 @@ pkgorigins_prepare(struct KojiMergedReposStuff **koji_stuff_ptr,
 }
 
 
+struct KojiSrpmsCbData {
+    GHashTable *include_srpms;  // koji_stuff->include_srpms
+    int repoid;                 // id of the currently parsed repository
+    const char *repo_url;       // ml->original_url of the repository
+};
+
+
+/* Package callback of the primary.xml pass that fills include_srpms.
+ * Packages are not kept, every one is freed right after it is processed. */
+static int
+koji_srpms_pkgcb(cr_Package *pkg, void *cbdata, G_GNUC_UNUSED GError **err)
+{
+    struct KojiSrpmsCbData *cb_data = cbdata;
+    GHashTable *include_srpms = cb_data->include_srpms;
+    cr_NEVRA *nevra;
+    gpointer data;
+    struct srpm_val *srpm_value_new;
+
+    // Check what "builds" we're allowing into the repo
+
+    if (!pkg->rpm_sourcerpm) {
+        g_warning("Package '%s' from '%s' doesn't have specified source srpm",
+                  pkg->location_href, cb_data->repo_url);
+        cr_package_free(pkg);
+        return CR_CB_RET_OK;
+    }
+
+    nevra = cr_split_rpm_filename(pkg->rpm_sourcerpm);
+
+    if (!nevra) {
+        g_debug("Srpm name is invalid: %s", pkg->rpm_sourcerpm);
+        cr_package_free(pkg);
+        return CR_CB_RET_OK;
+    }
+
+    data = g_hash_table_lookup(include_srpms, nevra->name);
+    if (data) {
+        // We have already seen build with the same name
+
+        int cmp;
+        cr_NEVRA *nevra_existing;
+        struct srpm_val *srpm_value_existing = data;
+
+        if (srpm_value_existing->repo_id != cb_data->repoid) {
+            // We found a rpm built from an srpm with the same name in
+            // a previous repo. The previous repo takes precendence,
+            // so ignore the srpm found here.
+            cr_nevra_free(nevra);
+            g_debug("Srpm already loaded from previous repo %s",
+                    pkg->rpm_sourcerpm);
+            cr_package_free(pkg);
+            return CR_CB_RET_OK;
+        }
+
+        // We're in the same repo, so compare srpm NVRs
+        nevra_existing = cr_split_rpm_filename(srpm_value_existing->sourcerpm);
+        cmp = cr_cmp_nevra(nevra, nevra_existing);
+        cr_nevra_free(nevra_existing);
+        if (cmp < 1) {
+            // Existing package is from the newer srpm
+            cr_nevra_free(nevra);
+            g_debug("Srpm already exists in newer version %s",
+                    pkg->rpm_sourcerpm);
+            cr_package_free(pkg);
+            return CR_CB_RET_OK;
+        }
+    }
+
+    // The current package we're processing is from a newer srpm
+    // than the existing srpm in the dict, so update the dict
+    // OR
+    // We found a new build so we add it to the dict
+
+    g_debug("Adding srpm: %s", pkg->rpm_sourcerpm);
+    srpm_value_new = g_malloc0(sizeof(struct srpm_val));
+    srpm_value_new->repo_id = cb_data->repoid;
+    srpm_value_new->sourcerpm = g_strdup(pkg->rpm_sourcerpm);
+    g_hash_table_replace(include_srpms,
+                         g_strdup(nevra->name),
+                         srpm_value_new);
+    cr_nevra_free(nevra);
+    cr_package_free(pkg);
+
+    return CR_CB_RET_OK;
+}
+
+
 int
 koji_stuff_prepare(struct KojiMergedReposStuff **koji_stuff_ptr,
                    struct CmdOptions *cmd_options,
@@ -174,96 +263,42 @@ koji_stuff_prepare(struct KojiMergedReposStuff **koji_stuff_ptr,
     repoid = 0;
     for (element = repos; element; element = g_slist_next(element)) {
         struct cr_MetadataLocation *ml;
-        cr_Metadata *metadata;
-        GHashTableIter iter;
-        gpointer key, void_pkg;
+        struct KojiSrpmsCbData cb_data;
+        GError *tmp_err = NULL;
 
         ml = (struct cr_MetadataLocation *) element->data;
-        if (!ml) {
+        if (!ml || !ml->pri_xml_href) {
             g_critical("Bad repo location");
             repoid++;
             break;
         }
 
-        metadata = cr_metadata_new(CR_HT_KEY_HASH, 0, NULL);
+        // Only primary.xml carries the sourcerpm, so filelists and other
+        // are not needed and no package is kept in memory
+        cr_metadatalocation_register_zstd_dicts(ml);
+
+        cb_data.include_srpms = include_srpms;
+        cb_data.repoid = repoid;
+        cb_data.repo_url = ml->original_url;
 
         g_debug("Loading srpms from: %s", ml->original_url);
-        if (cr_metadata_load_xml(metadata, ml, NULL) != CRE_OK) {
-            cr_metadata_free(metadata);
-            g_critical("Cannot load repo: \"%s\"", ml->original_url);
+        cr_xml_parse_primary(ml->pri_xml_href,
+                             NULL,
+                             NULL,
+                             koji_srpms_pkgcb,
+                             &cb_data,
+                             cr_warning_cb,
+                             "Primary XML parser",
+                             0,
+                             &tmp_err);
+        if (tmp_err) {
+            g_critical("Cannot load repo: \"%s\": %s",
+                       ml->original_url, tmp_err->message);
+            g_error_free(tmp_err);
             repoid++;
             break;
         }
 
-        // Iterate over every package in repo and what "builds"
-        // we're allowing into the repo
-        g_hash_table_iter_init(&iter, cr_metadata_hashtable(metadata));
-        while (g_hash_table_iter_next(&iter, &key, &void_pkg)) {
-            cr_Package *pkg = (cr_Package *) void_pkg;
-            cr_NEVRA *nevra;
-            gpointer data;
-            struct srpm_val *srpm_value_new;
-
-            if (!pkg->rpm_sourcerpm) {
-                g_warning("Package '%s' from '%s' doesn't have specified source srpm",
-                          pkg->location_href, ml->original_url);
-                continue;
-            }
-
-            nevra = cr_split_rpm_filename(pkg->rpm_sourcerpm);
-
-            if (!nevra) {
-                g_debug("Srpm name is invalid: %s", pkg->rpm_sourcerpm);
-                continue;
-            }
-
-            data = g_hash_table_lookup(include_srpms, nevra->name);
-            if (data) {
-                // We have already seen build with the same name
-
-                int cmp;
-                cr_NEVRA *nevra_existing;
-                struct srpm_val *srpm_value_existing = data;
-
-                if (srpm_value_existing->repo_id != repoid) {
-                    // We found a rpm built from an srpm with the same name in
-                    // a previous repo. The previous repo takes precendence,
-                    // so ignore the srpm found here.
-                    cr_nevra_free(nevra);
-                    g_debug("Srpm already loaded from previous repo %s",
-                            pkg->rpm_sourcerpm);
-                    continue;
-                }
-
-                // We're in the same repo, so compare srpm NVRs
-                nevra_existing = cr_split_rpm_filename(srpm_value_existing->sourcerpm);
-                cmp = cr_cmp_nevra(nevra, nevra_existing);
-                cr_nevra_free(nevra_existing);
-                if (cmp < 1) {
-                    // Existing package is from the newer srpm
-                    cr_nevra_free(nevra);
-                    g_debug("Srpm already exists in newer version %s",
-                            pkg->rpm_sourcerpm);
-                    continue;
-                }
-            }
-
-            // The current package we're processing is from a newer srpm
-            // than the existing srpm in the dict, so update the dict
-            // OR
-            // We found a new build so we add it to the dict
-
-            g_debug("Adding srpm: %s", pkg->rpm_sourcerpm);
-            srpm_value_new = g_malloc0(sizeof(struct srpm_val));
-            srpm_value_new->repo_id = repoid;
-            srpm_value_new->sourcerpm = g_strdup(pkg->rpm_sourcerpm);
-            g_hash_table_replace(include_srpms,
-                                 g_strdup(nevra->name),
-                                 srpm_value_new);
-            cr_nevra_free(nevra);
-        }
-
-        cr_metadata_free(metadata);
         repoid++;
     }
 
@@ -28,11 +28,14 @@
 #include <modulemd.h>
 #endif /* WITH_LIBMODULEMD */
 
+#include "cleanup.h"
 #include "error.h"
 #include "package.h"
+#include "package_internal.h"
 #include "misc.h"
 #include "load_metadata.h"
 #include "locate_metadata.h"
+#include "snapshot.h"
 #include "xml_parser.h"
 
 #define ERR_DOMAIN              CREATEREPO_C_ERROR
@@ -44,9 +47,11 @@ struct _cr_Metadata {
     cr_HashTableKey key;    /*!< key used in hashtable */
     GHashTable *ht;         /*!< hashtable with packages */
     GStringChunk *chunk;    /*!< NULL or string chunk with strings from htn */
-    GHashTable *pkglist_ht; /*!< list of allowed package basenames to load */
+    cr_XmlFilter *filter;   /*!< NULL or filter of packages to load */
     cr_HashTableKeyDupAction dupaction; /*!<
         How to behave in case of duplicated items */
+    gboolean lazy;          /*!< load files and changelogs on demand */
+    int parser_threads;     /*!< threads parsing filelists and other */
 
 #ifdef WITH_LIBMODULEMD
     ModulemdModuleIndex *moduleindex; /*!< Module metadata */
@@ -111,21 +116,14 @@ cr_metadata_new(cr_HashTableKey key, int use_single_chunk, GSList *pkglist)
         md->chunk = g_string_chunk_new(STRINGCHUNK_SIZE);
 
     if (pkglist) {
-        // Create hashtable from pkglist
-        // This hashtable is used for checking if the metadata of the package
-        // should be included.
+        // Filter packages by the pkglist
         // Purpose is to save memory - We load only metadata about
-        // packages which we will probably use.
-        // This hashtable is modified "on the fly" - If we found and load
-        // a metadata about the package, we remove its record from the hashtable.
-        // So if we met the metadata for this package again we will ignore it.
-        md->pkglist_ht = g_hash_table_new_full(g_str_hash,
-                                               g_str_equal,
-                                               g_free,
-                                               NULL);
-
-       for (GSList *elem = pkglist; elem; elem = g_slist_next(elem))
-            g_hash_table_insert(md->pkglist_ht, g_strdup(elem->data), NULL);
+        // packages which we will probably use. Packages which are not
+        // in the list are skipped by the primary parser before they
+        // are allocated.
+        md->filter = cr_xml_filter_new();
+        for (GSList *elem = pkglist; elem; elem = g_slist_next(elem))
+            cr_xml_filter_add_href(md->filter, elem->data);
     }
 
     md->dupaction = CR_HT_DUPACT_KEEPFIRST;
@@ -146,11 +144,20 @@ cr_metadata_free(cr_Metadata *md)
     cr_destroy_metadata_hashtable(md->ht);
     if (md->chunk)
         g_string_chunk_free(md->chunk);
-    if (md->pkglist_ht)
-        g_hash_table_destroy(md->pkglist_ht);
+    cr_xml_filter_free(md->filter);
     g_free(md);
 }
 
+cr_XmlFilter *
+cr_metadata_filter(cr_Metadata *md)
+{
+    assert(md);
+
+    if (!md->filter)
+        md->filter = cr_xml_filter_new();
+    return md->filter;
+}
+
 gboolean
 cr_metadata_set_dupaction(cr_Metadata *md, cr_HashTableKeyDupAction dupaction)
 {
@@ -160,6 +167,24 @@ cr_metadata_set_dupaction(cr_Metadata *md, cr_HashTableKeyDupAction dupaction)
     return TRUE;
 }
 
+gboolean
+cr_metadata_set_lazy(cr_Metadata *md, gboolean lazy)
+{
+    if (!md)
+        return FALSE;
+    md->lazy = lazy;
+    return TRUE;
+}
+
+gboolean
+cr_metadata_set_parser_threads(cr_Metadata *md, int threads)
+{
+    if (!md)
+        return FALSE;
+    md->parser_threads = threads;
+    return TRUE;
+}
+
 // Callbacks for XML parsers
 
 typedef enum {
@@ -171,7 +196,6 @@ typedef enum {
 typedef struct {
     GHashTable      *ht;
     GStringChunk    *chunk;
-    GHashTable      *pkglist_ht;
     GHashTable      *ignored_pkgIds; /*!< If there are multiple packages
         which have the same checksum (pkgId) but they are in fact different
         (they have different basenames, mtimes or sizes),
@@ -225,20 +249,11 @@ primary_pkgcb(cr_Package *pkg, void *cbdata, G_GNUC_UNUSED GError **err)
         pkg->chunk = NULL;
     }
 
-    if (cb_data->pkglist_ht && basename) {
-        // If a pkglist was specified,
-        // check if the package should be loaded or not
-        store_pkg = g_hash_table_lookup_extended(cb_data->pkglist_ht,
-                                                 basename, NULL, NULL);
-    }
-
-    if (store_pkg) {
-        // Check if pkgId is not on the list of blocked Ids
-        if (g_hash_table_lookup_extended(cb_data->ignored_pkgIds, pkg->pkgId,
-                                         NULL, NULL))
-            // We should ignore this pkgId (package's hash)
-            store_pkg = FALSE;
-    }
+    // Check if pkgId is not on the list of blocked Ids
+    if (g_hash_table_lookup_extended(cb_data->ignored_pkgIds, pkg->pkgId,
+                                     NULL, NULL))
+        // We should ignore this pkgId (package's hash)
+        store_pkg = FALSE;
 
     if (!store_pkg) {
         // Drop the currently loaded package
@@ -351,13 +366,81 @@ pkgcb(cr_Package *pkg, void *cbdata, G_GNUC_UNUSED GError **err)
     return CR_CB_RET_OK;
 }
 
+static int
+snapshot_pkgcb(cr_Package *pkg, void *cbdata, GError **err)
+{
+    // Snapshot contains data from all of primary, filelists and other
+    pkg->loadingflags |= CR_PACKAGE_LOADED_FIL;
+    pkg->loadingflags |= CR_PACKAGE_LOADED_OTH;
+    return primary_pkgcb(pkg, cbdata, err);
+}
+
+typedef struct {
+    GHashTable *ht;
+    cr_PackageLoadingFlags flag;    /*!< CR_PACKAGE_LOADED_FIL or _OTH */
+} cr_LazyCbData;
+
+static int
+lazy_pkgcb(cr_LazySource *source,
+           const char *pkgId,
+           gint64 offset,
+           gint64 length,
+           void *cbdata,
+           G_GNUC_UNUSED GError **err)
+{
+    cr_LazyCbData *lazy_data = cbdata;
+    cr_Package *pkg;
+
+    pkg = g_hash_table_lookup(lazy_data->ht, pkgId);
+    if (!pkg || pkg->loadingflags & lazy_data->flag)
+        // Not from primary.xml or already found (the first one is used)
+        return CR_CB_RET_OK;
+
+    pkg->loadingflags |= lazy_data->flag;
+    cr_package_set_lazy(pkg, source, offset, length);
+
+    return CR_CB_RET_OK;
+}
+
+/** Instead of parsing the files or changelogs of the packages, only
+ * remember where they are. They are loaded by cr_package_load_lazy().
+ */
+static int
+cr_load_lazy_xml_file(GHashTable *hashtable,
+                      const char *path,
+                      cr_LazyType type,
+                      GError **err)
+{
+    cr_LazyCbData lazy_data;
+    cr_LazySource *source;
+    GError *tmp_err = NULL;
+
+    lazy_data.ht = hashtable;
+    lazy_data.flag = (type == CR_LAZY_FILELISTS) ? CR_PACKAGE_LOADED_FIL
+                                                 : CR_PACKAGE_LOADED_OTH;
+
+    source = cr_lazy_source_new(path, type, lazy_pkgcb, &lazy_data, &tmp_err);
+    if (!source) {
+        int code = tmp_err->code;
+        g_propagate_error(err, tmp_err);
+        return code;
+    }
+
+    // Packages keep their own references
+    cr_lazy_source_unref(source);
+
+    return CRE_OK;
+}
+
 static int
 cr_load_xml_files(GHashTable *hashtable,
                   const char *primary_xml_path,
                   const char *filelists_xml_path,
                   const char *other_xml_path,
                   GStringChunk *chunk,
-                  GHashTable *pkglist_ht,
+                  const cr_XmlFilter *filter,
+                  gboolean lazy,
+                  int threads,
                   GError **err)
 {
     cr_CbData cb_data;
@@ -369,20 +452,34 @@ cr_load_xml_files(GHashTable *hashtable,
     cb_data.state           = PARSING_PRI;
     cb_data.ht              = hashtable;
     cb_data.chunk           = chunk;
-    cb_data.pkglist_ht      = pkglist_ht;
     cb_data.ignored_pkgIds  = g_hash_table_new_full(g_str_hash, g_str_equal,
                                                     g_free, NULL);
     cb_data.pkgKey          = G_GINT64_CONSTANT(0);
 
-    cr_xml_parse_primary(primary_xml_path,
-                         primary_newpkgcb,
-                         &cb_data,
-                         primary_pkgcb,
-                         &cb_data,
-                         cr_warning_cb,
-                         "Primary XML parser",
-                         (filelists_xml_path) ? 0 : 1,
-                         &tmp_err);
+    // Without a filter, the regular (libxml2) parsers are used, filelists
+    // and other by a pool of threads if requested. The filtered ones
+    // tokenize filelists and other with the fast parser.
+    if (filter)
+        cr_xml_parse_primary_filtered(primary_xml_path,
+                                      filter,
+                                      primary_newpkgcb,
+                                      &cb_data,
+                                      primary_pkgcb,
+                                      &cb_data,
+                                      cr_warning_cb,
+                                      "Primary XML parser",
+                                      (filelists_xml_path) ? 0 : 1,
+                                      &tmp_err);
+    else
+        cr_xml_parse_primary(primary_xml_path,
+                             primary_newpkgcb,
+                             &cb_data,
+                             primary_pkgcb,
+                             &cb_data,
+                             cr_warning_cb,
+                             "Primary XML parser",
+                             (filelists_xml_path) ? 0 : 1,
+                             &tmp_err);
 
     g_hash_table_destroy(cb_data.ignored_pkgIds);
     cb_data.ignored_pkgIds = NULL;
@@ -396,15 +493,45 @@ cr_load_xml_files(GHashTable *hashtable,
 
     cb_data.state = PARSING_FIL;
 
-    if (filelists_xml_path) {
-        cr_xml_parse_filelists(filelists_xml_path,
-                               newpkgcb,
-                               &cb_data,
-                               pkgcb,
-                               &cb_data,
-                               cr_warning_cb,
-                               "Filelists XML parser",
-                               &tmp_err);
+    if (filelists_xml_path && lazy) {
+        cr_load_lazy_xml_file(hashtable, filelists_xml_path,
+                              CR_LAZY_FILELISTS, &tmp_err);
+        if (tmp_err) {
+            int code = tmp_err->code;
+            g_debug("filelists.xml indexing error: %s", tmp_err->message);
+            g_propagate_prefixed_error(err, tmp_err, "filelists.xml parsing: ");
+            return code;
+        }
+    } else if (filelists_xml_path) {
+        if (filter)
+            cr_xml_parse_filelists_filtered(filelists_xml_path,
+                                            filter,
+                                            newpkgcb,
+                                            &cb_data,
+                                            pkgcb,
+                                            &cb_data,
+                                            cr_warning_cb,
+                                            "Filelists XML parser",
+                                            &tmp_err);
+        else if (threads > 1)
+            cr_xml_parse_filelists_parallel(filelists_xml_path,
+                                            newpkgcb,
+                                            &cb_data,
+                                            pkgcb,
+                                            &cb_data,
+                                            cr_warning_cb,
+                                            "Filelists XML parser",
+                                            threads,
+                                            &tmp_err);
+        else
+            cr_xml_parse_filelists(filelists_xml_path,
+                                   newpkgcb,
+                                   &cb_data,
+                                   pkgcb,
+                                   &cb_data,
+                                   cr_warning_cb,
+                                   "Filelists XML parser",
+                                   &tmp_err);
         if (tmp_err) {
             int code = tmp_err->code;
             g_debug("filelists.xml parsing error: %s", tmp_err->message);
@@ -415,15 +542,45 @@ cr_load_xml_files(GHashTable *hashtable,
 
     cb_data.state = PARSING_OTH;
 
-    if (other_xml_path) {
-        cr_xml_parse_other(other_xml_path,
-                           newpkgcb,
-                           &cb_data,
-                           pkgcb,
-                           &cb_data,
-                           cr_warning_cb,
-                           "Other XML parser",
-                           &tmp_err);
+    if (other_xml_path && lazy) {
+        cr_load_lazy_xml_file(hashtable, other_xml_path, CR_LAZY_OTHER,
+                              &tmp_err);
+        if (tmp_err) {
+            int code = tmp_err->code;
+            g_debug("other.xml indexing error: %s", tmp_err->message);
+            g_propagate_prefixed_error(err, tmp_err, "other.xml parsing: ");
+            return code;
+        }
+    } else if (other_xml_path) {
+        if (filter)
+            cr_xml_parse_other_filtered(other_xml_path,
+                                        filter,
+                                        newpkgcb,
+                                        &cb_data,
+                                        pkgcb,
+                                        &cb_data,
+                                        cr_warning_cb,
+                                        "Other XML parser",
+                                        &tmp_err);
+        else if (threads > 1)
+            cr_xml_parse_other_parallel(other_xml_path,
+                                        newpkgcb,
+                                        &cb_data,
+                                        pkgcb,
+                                        &cb_data,
+                                        cr_warning_cb,
+                                        "Other XML parser",
+                                        threads,
+                                        &tmp_err);
+        else
+            cr_xml_parse_other(other_xml_path,
+                               newpkgcb,
+                               &cb_data,
+                               pkgcb,
+                               &cb_data,
+                               cr_warning_cb,
+                               "Other XML parser",
+                               &tmp_err);
         if (tmp_err) {
             int code = tmp_err->code;
             g_debug("other.xml parsing error: %s", tmp_err->message);
@@ -435,6 +592,56 @@ cr_load_xml_files(GHashTable *hashtable,
     return CRE_OK;
 }
 
+/** Load packages from the snapshot stored next to repomd.xml instead of
+ * parsing the xml files. Fails if there is no snapshot for the current
+ * metadata, the hashtable is left empty then.
+ */
+static int
+cr_load_snapshot(GHashTable *hashtable,
+                 struct cr_MetadataLocation *ml,
+                 GStringChunk *chunk,
+                 const cr_XmlFilter *filter,
+                 GError **err)
+{
+    cr_CbData cb_data;
+    _cleanup_free_ gchar *repodata_dir = NULL;
+    _cleanup_free_ gchar *path = NULL;
+    int ret;
+
+    assert(hashtable);
+
+    if (!ml->repomd || !ml->repomd_data)
+        return CRE_SNAPSHOT;
+
+    repodata_dir = g_path_get_dirname(ml->repomd);
+    path = g_build_filename(repodata_dir, CR_SNAPSHOT_FILENAME, NULL);
+    if (!g_file_test(path, G_FILE_TEST_IS_REGULAR))
+        return CRE_SNAPSHOT;
+
+    cb_data.state           = PARSING_PRI;
+    cb_data.ht              = hashtable;
+    cb_data.chunk           = chunk;
+    cb_data.ignored_pkgIds  = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                                    g_free, NULL);
+    cb_data.pkgKey          = G_GINT64_CONSTANT(0);
+
+    ret = cr_snapshot_load(path,
+                           ml->repomd_data,
+                           filter,
+                           primary_newpkgcb,
+                           &cb_data,
+                           snapshot_pkgcb,
+                           &cb_data,
+                           err);
+
+    g_hash_table_destroy(cb_data.ignored_pkgIds);
+
+    if (ret != CRE_OK)
+        g_hash_table_remove_all(hashtable);
+
+    return ret;
+}
+
 static gint
 module_read_fn (void *data,
                 unsigned char *buffer,
@@ -549,15 +756,33 @@ cr_metadata_load_xml(cr_Metadata *md,
         return CRE_BADARG;
     }
 
-    // Load metadata
+    // Register zstd dictionaries the metadata may be compressed with
+    cr_metadatalocation_register_zstd_dicts(ml);
+
+    // Load metadata, from the snapshot if there is a valid one
     intern_hashtable = cr_new_metadata_hashtable();
-    result = cr_load_xml_files(intern_hashtable,
-                               ml->pri_xml_href,
-                               ml->fex_xml_href ? ml->fex_xml_href : ml->fil_xml_href,
-                               ml->oth_xml_href,
-                               md->chunk,
-                               md->pkglist_ht,
-                               &tmp_err);
+    result = CRE_SNAPSHOT;
+    if (!md->lazy) {
+        result = cr_load_snapshot(intern_hashtable, ml, md->chunk,
+                                  md->filter, &tmp_err);
+        if (tmp_err) {
+            g_debug("%s: Snapshot not used: %s", __func__, tmp_err->message);
+            g_clear_error(&tmp_err);
+        } else if (result == CRE_OK) {
+            g_debug("%s: Loaded from snapshot", __func__);
+        }
+    }
+
+    if (result != CRE_OK)
+        result = cr_load_xml_files(intern_hashtable,
+                                   ml->pri_xml_href,
+                                   ml->fex_xml_href ? ml->fex_xml_href : ml->fil_xml_href,
+                                   ml->oth_xml_href,
+                                   md->chunk,
+                                   md->filter,
+                                   md->lazy,
+                                   md->parser_threads,
+                                   &tmp_err);
 
     if (result != CRE_OK) {
         g_critical("%s: Error encountered while parsing", __func__);
@@ -686,7 +911,8 @@ cr_metadata_locate_and_load_xml(cr_Metadata *md,
     assert(md);
     assert(repopath);
 
-    ml = cr_locate_metadata(repopath, TRUE, &tmp_err);
+    ml = cr_locate_metadata_mask(repopath, TRUE, CR_MD_PACKAGES | CR_MD_MODULES,
+                                 &tmp_err);
     if (tmp_err) {
         g_clear_pointer(&ml, cr_metadatalocation_free);
         int code = tmp_err->code;
@@ -22,6 +22,7 @@
 
 #include <glib.h>
 #include "locate_metadata.h"
+#include "xml_parser.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -120,12 +121,52 @@ cr_Metadata *cr_metadata_new(cr_HashTableKey key,
 gboolean
 cr_metadata_set_dupaction(cr_Metadata *md, cr_HashTableKeyDupAction dupaction);
 
+/** Load files and changelogs lazily. The filelists and other xml are only
+ * scanned for the positions of the package elements (a compressed xml is
+ * decompressed into an unlinked temporary file) and files and changelogs
+ * of a package are loaded by cr_package_load_lazy(), which is called by
+ * cr_xml_dump() and cr_db_add_pkg(). Errors in filelists and other xml
+ * are reported by cr_package_load_lazy() then.
+ * @param md            cr_Metadata object.
+ * @param lazy          TRUE to load files and changelogs on demand.
+ * @return              FALSE if md is NULL.
+ */
+gboolean
+cr_metadata_set_lazy(cr_Metadata *md, gboolean lazy);
+
+/** Parse filelists and other xml by a pool of threads (see
+ * cr_xml_parse_filelists_parallel()). Used only for metadata loaded
+ * without a filter and not in the lazy mode.
+ * @param md            cr_Metadata object.
+ * @param threads       Number of parser threads, 0 or 1 parses the files
+ *                      in the calling thread (default).
+ * @return              FALSE if md is NULL.
+ */
+gboolean
+cr_metadata_set_parser_threads(cr_Metadata *md, int threads);
+
 /** Destroy metadata.
  * @param md            cr_Metadata object
  */
 void cr_metadata_free(cr_Metadata *md);
 
+/** Filter of packages to load. Packages rejected by the filter are skipped
+ * by the xml parsers before they are allocated. The filter is created on
+ * the first call and it already contains the pkglist passed to
+ * cr_metadata_new(), if any. Metadata with a filter are loaded by the
+ * filtered parsers, which use the fast tokenizer for filelists and other
+ * (cr_xml_parse_filelists_fast()); without a filter, the libxml2 parsers
+ * are used.
+ * @param md            cr_Metadata object
+ * @return              Filter owned by the md
+ */
+cr_XmlFilter *cr_metadata_filter(cr_Metadata *md);
+
 /** Load metadata from the specified location.
+ * If the repodata directory contains a snapshot (see cr_snapshot_load())
+ * which belongs to the primary.xml from repomd.xml, the packages are
+ * loaded from it instead of the xml files. The snapshot is not used in
+ * the lazy mode (see cr_metadata_set_lazy()).
  * @param md            metadata object
  * @param ml            metadata location
  * @param err           GError **
@@ -30,11 +30,14 @@
 #include "repomd.h"
 #include "xml_parser.h"
 #include "cleanup.h"
+#include "compression_wrapper.h"
 
 #define ERR_DOMAIN      CREATEREPO_C_ERROR
 
 #define TMPDIR_PATTERN  "createrepo_c_tmp_repo_XXXXXX"
 
+#define MAX_PARALLEL_DOWNLOADS  6   // Connections used for remote metadata
+
 #define FORMAT_XML      1
 #define FORMAT_LEVEL    0
 
@@ -71,6 +74,10 @@ cr_metadatalocation_free(struct cr_MetadataLocation *ml)
     g_free(ml->pri_sqlite_href);
     g_free(ml->fil_sqlite_href);
     g_free(ml->oth_sqlite_href);
+    g_free(ml->pri_zstd_dict_href);
+    g_free(ml->fil_zstd_dict_href);
+    g_free(ml->fex_zstd_dict_href);
+    g_free(ml->oth_zstd_dict_href);
     g_free(ml->repomd);
     g_free(ml->original_url);
     g_free(ml->local_path);
@@ -78,6 +85,33 @@ cr_metadatalocation_free(struct cr_MetadataLocation *ml)
     g_free(ml);
 }
 
+void
+cr_metadatalocation_register_zstd_dicts(struct cr_MetadataLocation *ml)
+{
+    const char *dict_hrefs[] = { ml->pri_zstd_dict_href,
+                                 ml->fil_zstd_dict_href,
+                                 ml->fex_zstd_dict_href,
+                                 ml->oth_zstd_dict_href };
+
+    assert(ml);
+
+    for (size_t x = 0; x < sizeof(dict_hrefs) / sizeof(dict_hrefs[0]); x++) {
+        _cleanup_free_ gchar *dict = NULL;
+        gsize dict_size = 0;
+        GError *tmp_err = NULL;
+
+        if (!dict_hrefs[x])
+            continue;
+
+        if (!g_file_get_contents(dict_hrefs[x], &dict, &dict_size, &tmp_err)
+            || !cr_zstd_dict_register(dict, dict_size, &tmp_err)) {
+            g_warning("%s: Cannot use zstd dictionary %s: %s",
+                      __func__, dict_hrefs[x], tmp_err->message);
+            g_clear_error(&tmp_err);
+        }
+    }
+}
+
 gint cr_cmp_metadatum_type(gconstpointer metadatum, gconstpointer type){
     return g_strcmp0(((cr_Metadatum *) metadatum)->type, type);
 }
@@ -99,7 +133,17 @@ cr_copy_metadatum(const gchar *src,
 
     g_debug("Copy metadatum %s -> %s", src, metadatum);
 
-    if (!cr_better_copy_file(src, metadatum, err)) {
+    gboolean ret;
+    if (strstr(src, "://")) {
+        ret = cr_better_copy_file(src, metadatum, err);
+    } else {
+        // A file from the old repodata is never modified, so it can be
+        // shared. Like a copy, it replaces an existing file.
+        g_remove(metadatum);
+        ret = cr_carry_over_file(src, metadatum, CR_CARRY_OVER_COPY, err) != 0;
+    }
+
+    if (!ret) {
         g_critical("Error while copy %s -> %s: %s",
                 src, metadatum, (*err)->message);
         g_clear_error(err);
@@ -128,10 +172,53 @@ cr_insert_additional_metadatum(const gchar *path,
     return additional_metadata;
 }
 
-struct cr_MetadataLocation *
-cr_parse_repomd(const char *repomd_path,
-                const char *repopath,
-                int ignore_sqlite)
+/** Check if a repomd record of the type is located with the mask.
+ * Records which are never part of cr_MetadataLocation (e.g. primary_zck)
+ * are not wanted.
+ */
+static gboolean
+cr_metadata_type_wanted(const char *type, int mask, gboolean ignore_sqlite)
+{
+    static const struct {
+        const char *name;
+        int flag;
+    } types[] = {
+        { "primary",        CR_MD_PRIMARY },
+        { "filelists",      CR_MD_FILELISTS },
+        { "filelists-ext",  CR_MD_FILELISTS_EXT },
+        { "other",          CR_MD_OTHER },
+    };
+
+    if (!type)
+        return FALSE;
+
+    for (size_t x = 0; x < sizeof(types) / sizeof(types[0]); x++) {
+        size_t len = strlen(types[x].name);
+        const char *suffix = type + len;
+
+        if (strncmp(type, types[x].name, len))
+            continue;
+
+        if (*suffix == '\0' || !strcmp(suffix, "_zstd_dict"))
+            return (mask & types[x].flag) != 0;
+        if (!strcmp(suffix, "_db"))
+            return !ignore_sqlite && (mask & types[x].flag);
+        if (*suffix == '_')
+            return FALSE;
+        // "filelists" prefix of "filelists-ext"
+    }
+
+    if (!strcmp(type, "modules") && (mask & CR_MD_MODULES))
+        return TRUE;
+
+    return (mask & CR_MD_ADDITIONAL) != 0;
+}
+
+static struct cr_MetadataLocation *
+cr_parse_repomd_mask(const char *repomd_path,
+                     const char *repopath,
+                     int ignore_sqlite,
+                     int mask)
 {
     assert(repomd_path);
 
@@ -156,6 +243,9 @@ cr_parse_repomd(const char *repomd_path,
     for (GSList *elem = repomd->records; elem; elem = g_slist_next(elem)) {
         cr_RepomdRecord *record = elem->data;
 
+        if (!cr_metadata_type_wanted(record->type, mask, ignore_sqlite))
+            continue;
+
         gchar *full_location_href = g_build_filename(
                                         repopath,
                                         (char *) record->location_href,
@@ -177,6 +267,14 @@ cr_parse_repomd(const char *repomd_path,
             mdloc->oth_xml_href = full_location_href;
         else if (!g_strcmp0(record->type, "other_db") && !ignore_sqlite)
             mdloc->oth_sqlite_href = full_location_href;
+        else if (!g_strcmp0(record->type, "primary_zstd_dict"))
+            mdloc->pri_zstd_dict_href = full_location_href;
+        else if (!g_strcmp0(record->type, "filelists_zstd_dict"))
+            mdloc->fil_zstd_dict_href = full_location_href;
+        else if (!g_strcmp0(record->type, "filelists-ext_zstd_dict"))
+            mdloc->fex_zstd_dict_href = full_location_href;
+        else if (!g_strcmp0(record->type, "other_zstd_dict"))
+            mdloc->oth_zstd_dict_href = full_location_href;
         else if ( !g_str_has_prefix(record->type, "primary_"   ) &&
                   !g_str_has_prefix(record->type, "filelists_" ) && 
                   !g_str_has_prefix(record->type, "filelists-ext_" ) && 
@@ -193,8 +291,16 @@ cr_parse_repomd(const char *repomd_path,
     return mdloc;
 }
 
+struct cr_MetadataLocation *
+cr_parse_repomd(const char *repomd_path,
+                const char *repopath,
+                int ignore_sqlite)
+{
+    return cr_parse_repomd_mask(repomd_path, repopath, ignore_sqlite, CR_MD_ALL);
+}
+
 static struct cr_MetadataLocation *
-cr_get_local_metadata(const char *repopath, gboolean ignore_sqlite)
+cr_get_local_metadata(const char *repopath, gboolean ignore_sqlite, int mask)
 {
     _cleanup_free_ gchar *repomd = NULL;
     struct cr_MetadataLocation *ret = NULL;
@@ -214,14 +320,14 @@ cr_get_local_metadata(const char *repopath, gboolean ignore_sqlite)
         return ret;
     }
 
-    ret = cr_parse_repomd(repomd, repopath, ignore_sqlite);
+    ret = cr_parse_repomd_mask(repomd, repopath, ignore_sqlite, mask);
 
     return ret;
 }
 
 
 static struct cr_MetadataLocation *
-cr_get_remote_metadata(const char *repopath, gboolean ignore_sqlite)
+cr_get_remote_metadata(const char *repopath, gboolean ignore_sqlite, int mask)
 {
     CURL *handle = NULL;
     _cleanup_free_ gchar *tmp_dir = NULL;
@@ -290,35 +396,51 @@ cr_get_remote_metadata(const char *repopath, gboolean ignore_sqlite)
     }
 
     // Parse downloaded repomd.xml
-    r_location = cr_parse_repomd(tmp_repomd, repopath, ignore_sqlite);
+    r_location = cr_parse_repomd_mask(tmp_repomd, repopath, ignore_sqlite, mask);
     if (!r_location) {
         g_critical("%s: repomd.xml parser failed on %s", __func__, tmp_repomd);
         goto get_remote_metadata_cleanup;
     }
 
-    // Download all other repofiles
-    if (r_location->pri_xml_href)
-        cr_download(handle, r_location->pri_xml_href, tmp_repodata, &tmp_err);
-    if (!tmp_err && r_location->fil_xml_href)
-        cr_download(handle, r_location->fil_xml_href, tmp_repodata, &tmp_err);
-    if (!tmp_err && r_location->fex_xml_href)
-        cr_download(handle, r_location->fex_xml_href, tmp_repodata, &tmp_err);
-    if (!tmp_err && r_location->oth_xml_href)
-        cr_download(handle, r_location->oth_xml_href, tmp_repodata, &tmp_err);
-    if (!tmp_err && r_location->pri_sqlite_href)
-        cr_download(handle, r_location->pri_sqlite_href, tmp_repodata, &tmp_err);
-    if (!tmp_err && r_location->fil_sqlite_href)
-        cr_download(handle, r_location->fil_sqlite_href, tmp_repodata, &tmp_err);
-    if (!tmp_err && r_location->oth_sqlite_href)
-        cr_download(handle, r_location->oth_sqlite_href, tmp_repodata, &tmp_err);
-
-    if (!tmp_err && r_location->additional_metadata){
-        GSList *element = r_location->additional_metadata;
-        for (; element; element=g_slist_next(element)) {
-            cr_download(handle, ((cr_Metadatum *)element->data)->name, tmp_repodata, &tmp_err);
-            if (tmp_err) break;
+    // Download the wanted repofiles, location_hrefs are kept relative
+    // to the tmp dir, so files with the same basename don't collide
+    GPtrArray *urls = g_ptr_array_new_with_free_func(g_free);
+    GPtrArray *paths = g_ptr_array_new();
+    for (GSList *elem = r_location->repomd_data->records; elem; elem = g_slist_next(elem)) {
+        cr_RepomdRecord *record = elem->data;
+        _cleanup_strv_free_ gchar **parts = NULL;
+
+        if (!record->location_href
+            || !cr_metadata_type_wanted(record->type, mask, ignore_sqlite))
+            continue;
+
+        parts = g_strsplit(record->location_href, "/", -1);
+        if (g_path_is_absolute(record->location_href)
+            || g_strv_contains((const gchar * const *) parts, ".."))
+        {
+            g_set_error(&tmp_err, ERR_DOMAIN, CRE_BADARG,
+                        "Unsupported location_href \"%s\" of %s",
+                        record->location_href, record->type);
+            break;
         }
+
+        g_ptr_array_add(urls, g_build_filename(repopath,
+                                               record->location_href,
+                                               NULL));
+        g_ptr_array_add(paths, record->location_href);
     }
+    g_ptr_array_add(urls, NULL);
+    g_ptr_array_add(paths, NULL);
+
+    if (!tmp_err)
+        cr_download_multi(handle,
+                          (const char * const *) urls->pdata,
+                          (const char * const *) paths->pdata,
+                          tmp_dir,
+                          MAX_PARALLEL_DOWNLOADS,
+                          &tmp_err);
+    g_ptr_array_free(urls, TRUE);
+    g_ptr_array_free(paths, TRUE);
 
     cr_metadatalocation_free(r_location);
 
@@ -331,7 +453,7 @@ cr_get_remote_metadata(const char *repopath, gboolean ignore_sqlite)
     g_debug("%s: Remote metadata was successfully downloaded", __func__);
 
     // Parse downloaded data
-    ret = cr_get_local_metadata(tmp_dir, ignore_sqlite);
+    ret = cr_get_local_metadata(tmp_dir, ignore_sqlite, mask);
     if (ret)
         ret->tmp = 1;
 
@@ -347,6 +469,15 @@ get_remote_metadata_cleanup:
 
 struct cr_MetadataLocation *
 cr_locate_metadata(const char *repopath, gboolean ignore_sqlite, GError **err)
+{
+    return cr_locate_metadata_mask(repopath, ignore_sqlite, CR_MD_ALL, err);
+}
+
+struct cr_MetadataLocation *
+cr_locate_metadata_mask(const char *repopath,
+                        gboolean ignore_sqlite,
+                        int mask,
+                        GError **err)
 {
     struct cr_MetadataLocation *ret = NULL;
 
@@ -358,12 +489,12 @@ cr_locate_metadata(const char *repopath, gboolean ignore_sqlite, GError **err)
         g_str_has_prefix(repopath, "https://"))
     {
         // Remote metadata - Download them via curl
-        ret = cr_get_remote_metadata(repopath, ignore_sqlite);
+        ret = cr_get_remote_metadata(repopath, ignore_sqlite, mask);
     } else {
         // Local metadata
         if (g_str_has_prefix(repopath, "file:///"))
             repopath += 7;
-        ret = cr_get_local_metadata(repopath, ignore_sqlite);
+        ret = cr_get_local_metadata(repopath, ignore_sqlite, mask);
     }
 
     if (ret) {
@@ -32,6 +32,27 @@ extern "C" {
  *  @{
  */
 
+/** Metadata types to locate (see cr_locate_metadata_mask()).
+ * The sqlite databases and the zstd dictionaries of a selected type
+ * are located together with it.
+ */
+typedef enum {
+    CR_MD_PRIMARY       = (1<<0),   /*!< primary */
+    CR_MD_FILELISTS     = (1<<1),   /*!< filelists */
+    CR_MD_FILELISTS_EXT = (1<<2),   /*!< filelists-ext */
+    CR_MD_OTHER         = (1<<3),   /*!< other */
+    CR_MD_MODULES       = (1<<4),   /*!< modules */
+    CR_MD_ADDITIONAL    = (1<<5),   /*!< all additional metadata
+                                         (group, updateinfo, modules, ..) */
+} cr_MetadataMask;
+
+/** Primary, filelists, filelists-ext and other metadata */
+#define CR_MD_PACKAGES  (CR_MD_PRIMARY | CR_MD_FILELISTS | \
+                         CR_MD_FILELISTS_EXT | CR_MD_OTHER)
+
+/** All metadata types */
+#define CR_MD_ALL       (CR_MD_PACKAGES | CR_MD_ADDITIONAL)
+
 /** Structure representing metadata location.
  */
 struct cr_MetadataLocation {
@@ -43,6 +64,10 @@ struct cr_MetadataLocation {
     char *fil_sqlite_href;      /*!< path to filelists.sqlite */
     char *fex_sqlite_href;      /*!< path to filelists-ext.sqlite */
     char *oth_sqlite_href;      /*!< path to other.sqlite */
+    char *pri_zstd_dict_href;   /*!< path to zstd dict of primary.xml */
+    char *fil_zstd_dict_href;   /*!< path to zstd dict of filelists.xml */
+    char *fex_zstd_dict_href;   /*!< path to zstd dict of filelists-ext.xml */
+    char *oth_zstd_dict_href;   /*!< path to zstd dict of other.xml */
     GSList *additional_metadata; /*!< list of cr_Metadatum: paths 
                                       to additional metadata such 
                                       as updateinfo, modulemd, .. */
@@ -115,12 +140,35 @@ struct cr_MetadataLocation *cr_locate_metadata(const char *repopath,
                                                gboolean ignore_sqlite,
                                                GError **err);
 
+/** Same as cr_locate_metadata(), but only the metadata types selected
+ * by the mask are located. Hrefs of the other types are left NULL and
+ * remote repodata of the other types are not downloaded. Downloaded files
+ * keep their location_href relative to the temporary directory.
+ * @param repopath      path to directory with repodata/ subdirectory
+ * @param ignore_sqlite if ignore_sqlite != 0 sqlite dbs are ignored
+ * @param mask          cr_MetadataMask flags of the needed types
+ * @param err           GError **
+ * @return              filled cr_MetadataLocation structure or NULL
+ */
+struct cr_MetadataLocation *cr_locate_metadata_mask(const char *repopath,
+                                                    gboolean ignore_sqlite,
+                                                    int mask,
+                                                    GError **err);
+
 /** Free cr_MetadataLocation. If repodata were downloaded remove
  * a temporary directory with repodata.
  * @param ml            MeatadaLocation
  */
 void cr_metadatalocation_free(struct cr_MetadataLocation *ml);
 
+/** Register the zstd dictionaries listed in the repomd.xml
+ * (see cr_zstd_dict_register()), so the metadata compressed with them
+ * can be read. A dictionary which cannot be used is reported by a warning,
+ * reading of the files compressed with it fails later.
+ * @param ml            MetadataLocation
+ */
+void cr_metadatalocation_register_zstd_dicts(struct cr_MetadataLocation *ml);
+
 /** Free cr_Metadatum. 
  * @param m            Meatadatum
  */
@@ -34,6 +34,7 @@
 #include "helpers.h"
 #include "metadata_internal.h"
 #include "misc.h"
+#include "compression_wrapper.h"
 #include "locate_metadata.h"
 #include "load_metadata.h"
 #include "package.h"
@@ -42,6 +43,7 @@
 #include "sqlite.h"
 #include "threads.h"
 #include "xml_file.h"
+#include "xml_parser.h"
 #include "cleanup.h"
 #include "koji.h"
 
@@ -91,12 +93,38 @@ static GOptionEntry cmd_entries[] =
       "Do not merge updateinfo metadata", NULL },
     { "compress-type", 0, 0, G_OPTION_ARG_STRING, &(_cmd_options.compress_type),
       "Which compression type to use", "COMPRESS_TYPE" },
+    { "compress-level", 0, 0, G_OPTION_ARG_STRING_ARRAY, &(_cmd_options.compress_levels),
+      "Compression level for metadata of the TYPE (e.g. primary, other_db) "
+      "or for all metadata if the TYPE is omitted. Can be used multiple times.",
+      "[TYPE=]LEVEL" },
+    { "compress-profile", 0, 0, G_OPTION_ARG_STRING_ARRAY, &(_cmd_options.compress_profiles),
+      "Compression profile (default, fast or best) for metadata of the TYPE "
+      "or for all metadata if the TYPE is omitted. Can be used multiple times.",
+      "[TYPE=]PROFILE" },
+    { "compress-strategy", 0, 0, G_OPTION_ARG_STRING_ARRAY, &(_cmd_options.compress_strategies),
+      "Compression strategy for metadata of the TYPE or for all metadata "
+      "if the TYPE is omitted: filtered, huffman, rle or fixed for gz, fast, "
+      "dfast, greedy, lazy, lazy2, btlazy2, btopt, btultra or btultra2 for "
+      "zstd. Other compression types ignore it. Can be used multiple times.",
+      "[TYPE=]STRATEGY" },
+    { "compress-buffer-size", 0, 0, G_OPTION_ARG_STRING_ARRAY, &(_cmd_options.compress_buffer_sizes),
+      "Size in bytes of the buffer of compressed data (gz, xz and zstd) "
+      "for metadata of the TYPE or for all metadata if the TYPE is omitted. "
+      "Can be used multiple times.", "[TYPE=]BYTES" },
 #ifdef WITH_ZCHUNK
     { "zck", 0, 0, G_OPTION_ARG_NONE, &(_cmd_options.zck_compression),
       "Generate zchunk files as well as the standard repodata.", NULL },
     { "zck-dict-dir", 0, 0, G_OPTION_ARG_FILENAME, &(_cmd_options.zck_dict_dir),
       "Directory containing compression dictionaries for use by zchunk", "ZCK_DICT_DIR" },
 #endif
+    { "zstd-dict", 0, 0, G_OPTION_ARG_NONE, &(_cmd_options.zstd_dict),
+      "Compress primary, filelists and other xml using zstd dictionaries "
+      "reused from (or trained on) the previous repodata in the output "
+      "directory. The dictionaries are listed in repomd.xml, readers need "
+      "them to decompress .zst metadata. Zchunk files use them too, unless "
+      "--zck-dict-dir is used. WARNING: existing clients (e.g. dnf with "
+      "librepo) don't download the dictionaries and can't read dictionary "
+      "compressed .zst metadata.", NULL },
     { "method", 0, 0, G_OPTION_ARG_STRING, &(_cmd_options.merge_method_str),
       "Specify merge method for packages with the same name and arch (available"
       " merge methods: repo (default), ts, nvr)", "MERGE_METHOD" },
@@ -106,6 +134,18 @@ static GOptionEntry cmd_entries[] =
     { "noarch-repo", 0, 0, G_OPTION_ARG_FILENAME, &(_cmd_options.noarch_repo_url),
       "Packages with noarch architecture will be replaced by package from this "
       "repo if exists in it.", "URL" },
+    { "lazy-noarch-repo", 0, 0, G_OPTION_ARG_NONE, &(_cmd_options.lazy_noarch_repo),
+      "Load only those packages from --noarch-repo which can replace a package "
+      "of the merged repos. Lowers memory usage for the price of reading "
+      "primary metadata of the merged repos twice.", NULL },
+    { "lazy-load", 0, 0, G_OPTION_ARG_NONE, &(_cmd_options.lazy_load),
+      "Load files and changelogs of packages only when the merged metadata "
+      "are written. Lowers memory usage for the price of a temporary copy "
+      "of decompressed filelists and other metadata.", NULL },
+    { "parser-threads", 0, 0, G_OPTION_ARG_INT, &(_cmd_options.parser_threads),
+      "Number of threads parsing filelists and other metadata of each "
+      "repo. Not used with --lazy-load and for repos loaded with a filter "
+      "(--archlist, --koji with --blocked). Default: 1.", "NUM" },
     { "unique-md-filenames", 0, 0, G_OPTION_ARG_NONE, &(_cmd_options.unique_md_filenames),
       "Include the file's checksum in the metadata filename, helps HTTP caching (default).",
       NULL },
@@ -220,6 +260,7 @@ check_arguments(struct CmdOptions *options)
 {
     int x;
     gboolean ret = TRUE;
+    GError *tmp_err = NULL;
 
     if (options->outputdir){
         options->out_dir = cr_normalize_dir_path(options->outputdir);
@@ -289,6 +330,45 @@ check_arguments(struct CmdOptions *options)
         }
     }
 
+    // Compression levels, profiles, strategies and buffer sizes
+    options->compression_options = cr_compression_options_map_new();
+    for (x = 0; options->compress_levels && options->compress_levels[x]; x++) {
+        if (!cr_compression_options_map_parse(options->compression_options,
+                                              options->compress_levels[x],
+                                              CR_CW_OPTION_LEVEL, &tmp_err)) {
+            g_critical("%s", tmp_err->message);
+            g_clear_error(&tmp_err);
+            ret = FALSE;
+        }
+    }
+    for (x = 0; options->compress_profiles && options->compress_profiles[x]; x++) {
+        if (!cr_compression_options_map_parse(options->compression_options,
+                                              options->compress_profiles[x],
+                                              CR_CW_OPTION_PROFILE, &tmp_err)) {
+            g_critical("%s", tmp_err->message);
+            g_clear_error(&tmp_err);
+            ret = FALSE;
+        }
+    }
+    for (x = 0; options->compress_strategies && options->compress_strategies[x]; x++) {
+        if (!cr_compression_options_map_parse(options->compression_options,
+                                              options->compress_strategies[x],
+                                              CR_CW_OPTION_STRATEGY, &tmp_err)) {
+            g_critical("%s", tmp_err->message);
+            g_clear_error(&tmp_err);
+            ret = FALSE;
+        }
+    }
+    for (x = 0; options->compress_buffer_sizes && options->compress_buffer_sizes[x]; x++) {
+        if (!cr_compression_options_map_parse(options->compression_options,
+                                              options->compress_buffer_sizes[x],
+                                              CR_CW_OPTION_BUFFER_SIZE, &tmp_err)) {
+            g_critical("%s", tmp_err->message);
+            g_clear_error(&tmp_err);
+            ret = FALSE;
+        }
+    }
+
     // Merge method
     if (options->merge_method_str) {
         if (options->koji) {
@@ -398,6 +478,11 @@ free_options(struct CmdOptions *options)
     g_free(options->outputdir);
     g_free(options->archlist);
     g_free(options->compress_type);
+    g_strfreev(options->compress_levels);
+    g_strfreev(options->compress_profiles);
+    g_strfreev(options->compress_strategies);
+    g_strfreev(options->compress_buffer_sizes);
+    cr_compression_options_map_free(options->compression_options);
     g_free(options->merge_method_str);
     g_free(options->noarch_repo_url);
 
@@ -653,6 +738,31 @@ add_package:
 }
 
 
+/** Let the parsers skip the packages which add_package() would reject
+ * anyway, they are never allocated then. Blocked srpms are not pushed down
+ * when a noarch repo is used, a package could be replaced by a noarch
+ * package with a different srpm.
+ */
+static void
+filter_metadata(cr_Metadata *metadata,
+                GSList *arch_list,
+                GHashTable *noarch_hashtable,
+                struct KojiMergedReposStuff *koji_stuff)
+{
+    for (GSList *elem = arch_list; elem; elem = g_slist_next(elem))
+        cr_xml_filter_add_arch(cr_metadata_filter(metadata), elem->data);
+
+    if (koji_stuff && koji_stuff->blocked_srpms && !noarch_hashtable) {
+        GHashTableIter iter;
+        gpointer srpm;
+
+        g_hash_table_iter_init(&iter, koji_stuff->blocked_srpms);
+        while (g_hash_table_iter_next(&iter, &srpm, NULL))
+            cr_xml_filter_add_blocked_srpm(cr_metadata_filter(metadata), srpm);
+    }
+}
+
+
 /**
  * @return Number of loaded packages or -1 on error
  */
@@ -668,7 +778,9 @@ merge_repos(GHashTable *merged,
             struct KojiMergedReposStuff *koji_stuff,
             gboolean omit_baseurl,
             gchar *repo_prefix_search,
-            gchar *repo_prefix_replace)
+            gchar *repo_prefix_replace,
+            gboolean lazy_load,
+            int parser_threads)
 {
     long loaded_packages = 0;
     GSList *used_noarch_keys = NULL;
@@ -696,6 +808,9 @@ merge_repos(GHashTable *merged,
         }
 
         metadata = cr_metadata_new(CR_HT_KEY_HASH, 0, NULL);
+        cr_metadata_set_lazy(metadata, lazy_load);
+        cr_metadata_set_parser_threads(metadata, parser_threads);
+        filter_metadata(metadata, arch_list, noarch_hashtable, koji_stuff);
         repopath = cr_normalize_dir_path(ml->original_url);
 
         // Base paths in output of original createrepo doesn't have trailing '/'
@@ -832,6 +947,58 @@ merge_repos(GHashTable *merged,
 
 
 
+static int
+noarch_href_pkgcb(cr_Package *pkg,
+                  void *cbdata,
+                  G_GNUC_UNUSED GError **err)
+{
+    GHashTable *hrefs = cbdata;
+
+    if (!g_strcmp0(pkg->arch, "noarch") && pkg->location_href)
+        g_hash_table_add(hrefs, g_strdup(pkg->location_href));
+
+    cr_package_free(pkg);
+    return CR_CB_RET_OK;
+}
+
+
+/** Collect location_href of all noarch packages in the repos.
+ * Only the primary files are streamed, no package is kept in memory.
+ * These are the only packages from --noarch-repo which merge_repos()
+ * may look up.
+ * @param repo_list         List of cr_MetadataLocation of the merged repos
+ * @return                  Table of location_hrefs (a set) or NULL on error
+ */
+static GHashTable *
+noarch_hrefs(GSList *repo_list)
+{
+    GHashTable *hrefs = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                              g_free, NULL);
+
+    for (GSList *elem = repo_list; elem; elem = g_slist_next(elem)) {
+        struct cr_MetadataLocation *ml = elem->data;
+        GError *tmp_err = NULL;
+
+        if (!ml || !ml->pri_xml_href)
+            continue;
+
+        cr_xml_parse_primary(ml->pri_xml_href, NULL, NULL,
+                             noarch_href_pkgcb, hrefs, NULL, NULL,
+                             FALSE, &tmp_err);
+        if (tmp_err) {
+            g_critical("Cannot read primary of repo \"%s\": %s",
+                       ml->original_url, tmp_err->message);
+            g_error_free(tmp_err);
+            g_hash_table_destroy(hrefs);
+            return NULL;
+        }
+    }
+
+    return hrefs;
+}
+
+
+
 int
 package_cmp(gconstpointer a_p, gconstpointer b_p)
 {
@@ -919,6 +1086,71 @@ dump_merged_metadata(GHashTable *merged_hashtable,
     gchar *fil_dict_file = NULL;
     gchar *fex_dict_file = NULL;
     gchar *oth_dict_file = NULL;
+    gboolean dict_failed = FALSE;
+    gboolean dump_failed = FALSE;
+    cr_SqliteDb *pri_db = NULL;
+    cr_SqliteDb *fil_db = NULL;
+    cr_SqliteDb *fex_db = NULL;
+    cr_SqliteDb *oth_db = NULL;
+
+    // Zstd dictionaries
+    _cleanup_free_ gchar *pri_zstd_dict = NULL;
+    _cleanup_free_ gchar *fil_zstd_dict = NULL;
+    _cleanup_free_ gchar *fex_zstd_dict = NULL;
+    _cleanup_free_ gchar *oth_zstd_dict = NULL;
+    gsize pri_zstd_dict_size = 0;
+    gsize fil_zstd_dict_size = 0;
+    gsize fex_zstd_dict_size = 0;
+    gsize oth_zstd_dict_size = 0;
+    _cleanup_free_ gchar *pri_zstd_dict_filename = NULL;
+    _cleanup_free_ gchar *fil_zstd_dict_filename = NULL;
+    _cleanup_free_ gchar *fex_zstd_dict_filename = NULL;
+    _cleanup_free_ gchar *oth_zstd_dict_filename = NULL;
+
+    if (cmd_options->zstd_dict
+        && cmd_options->compression_type != CR_CW_ZSTD_COMPRESSION
+        && !(cmd_options->zck_compression && !cmd_options->zck_dict_dir)) {
+        g_warning("--zstd-dict has no effect: neither xml metadata nor "
+                  "zchunk files are compressed by zstd without a dictionary");
+    } else if (cmd_options->zstd_dict) {
+        // The merged repo has no previous metadata of its own in the
+        // input repos, only the output dir can provide them
+        struct cr_MetadataLocation *dict_ml;
+        dict_ml = cr_locate_metadata_mask(cmd_options->out_dir, TRUE,
+                                          CR_MD_PACKAGES, NULL);
+
+        if (dict_ml) {
+            pri_zstd_dict = cr_prepare_zstd_dict(dict_ml->pri_zstd_dict_href,
+                                                 dict_ml->pri_xml_href,
+                                                 cmd_options->tmp_out_repo,
+                                                 "primary.xml",
+                                                 &pri_zstd_dict_size,
+                                                 &pri_zstd_dict_filename);
+            fil_zstd_dict = cr_prepare_zstd_dict(dict_ml->fil_zstd_dict_href,
+                                                 dict_ml->fil_xml_href,
+                                                 cmd_options->tmp_out_repo,
+                                                 "filelists.xml",
+                                                 &fil_zstd_dict_size,
+                                                 &fil_zstd_dict_filename);
+            if (cmd_options->filelists_ext)
+                fex_zstd_dict = cr_prepare_zstd_dict(dict_ml->fex_zstd_dict_href,
+                                                     dict_ml->fex_xml_href,
+                                                     cmd_options->tmp_out_repo,
+                                                     "filelists-ext.xml",
+                                                     &fex_zstd_dict_size,
+                                                     &fex_zstd_dict_filename);
+            oth_zstd_dict = cr_prepare_zstd_dict(dict_ml->oth_zstd_dict_href,
+                                                 dict_ml->oth_xml_href,
+                                                 cmd_options->tmp_out_repo,
+                                                 "other.xml",
+                                                 &oth_zstd_dict_size,
+                                                 &oth_zstd_dict_filename);
+            cr_metadatalocation_free(dict_ml);
+        } else {
+            g_message("No previous repodata in %s - zstd dictionaries will "
+                      "be trained during the next run", cmd_options->out_dir);
+        }
+    }
 
     if (cmd_options->zck_dict_dir) {
         pri_dict_file = cr_get_dict_file(cmd_options->zck_dict_dir,
@@ -930,39 +1162,87 @@ dump_merged_metadata(GHashTable *merged_hashtable,
                                              "filelists-ext.xml");
         oth_dict_file = cr_get_dict_file(cmd_options->zck_dict_dir,
                                          "other.xml");
-        if (pri_dict_file && !g_file_get_contents(pri_dict_file, &pri_dict,
-                                                 &pri_dict_size, &tmp_err)) {
-            g_critical("Error reading zchunk primary dict %s: %s",
-                       pri_dict_file, tmp_err->message);
-            g_clear_error(&tmp_err);
-            exit(EXIT_FAILURE);
-        }
-        if (fil_dict_file && !g_file_get_contents(fil_dict_file, &fil_dict,
-                                                 &fil_dict_size, &tmp_err)) {
-            g_critical("Error reading zchunk filelists dict %s: %s",
-                       fil_dict_file, tmp_err->message);
-            g_clear_error(&tmp_err);
-            exit(EXIT_FAILURE);
-        }
-        if (fex_dict_file && !g_file_get_contents(fex_dict_file, &fex_dict,
-                                                 &fex_dict_size, &tmp_err)) {
-            g_critical("Error reading zchunk filelists-ext dict %s: %s",
-                       fex_dict_file, tmp_err->message);
-            g_clear_error(&tmp_err);
-            exit(EXIT_FAILURE);
-        }
-        if (oth_dict_file && !g_file_get_contents(oth_dict_file, &oth_dict,
-                                                 &oth_dict_size, &tmp_err)) {
-            g_critical("Error reading zchunk other dict %s: %s",
-                       oth_dict_file, tmp_err->message);
-            g_clear_error(&tmp_err);
-            exit(EXIT_FAILURE);
-        }
+    } else if (cmd_options->zck_compression) {
+        // Chunks of zchunk files use --zstd-dict dictionaries as well
+        pri_dict_file = g_strdup(pri_zstd_dict_filename);
+        fil_dict_file = g_strdup(fil_zstd_dict_filename);
+        fex_dict_file = g_strdup(fex_zstd_dict_filename);
+        oth_dict_file = g_strdup(oth_zstd_dict_filename);
+    }
+
+    if (pri_dict_file && !g_file_get_contents(pri_dict_file, &pri_dict,
+                                             &pri_dict_size, &tmp_err)) {
+        g_critical("Error reading zchunk primary dict %s: %s",
+                   pri_dict_file, tmp_err->message);
+        g_clear_error(&tmp_err);
+        dict_failed = TRUE;
+    } else if (fil_dict_file && !g_file_get_contents(fil_dict_file, &fil_dict,
+                                                    &fil_dict_size, &tmp_err)) {
+        g_critical("Error reading zchunk filelists dict %s: %s",
+                   fil_dict_file, tmp_err->message);
+        g_clear_error(&tmp_err);
+        dict_failed = TRUE;
+    } else if (fex_dict_file && !g_file_get_contents(fex_dict_file, &fex_dict,
+                                                    &fex_dict_size, &tmp_err)) {
+        g_critical("Error reading zchunk filelists-ext dict %s: %s",
+                   fex_dict_file, tmp_err->message);
+        g_clear_error(&tmp_err);
+        dict_failed = TRUE;
+    } else if (oth_dict_file && !g_file_get_contents(oth_dict_file, &oth_dict,
+                                                    &oth_dict_size, &tmp_err)) {
+        g_critical("Error reading zchunk other dict %s: %s",
+                   oth_dict_file, tmp_err->message);
+        g_clear_error(&tmp_err);
+        dict_failed = TRUE;
+    }
+
+    if (dict_failed) {
+        cr_contentstat_free(pri_stat, NULL);
+        cr_contentstat_free(fil_stat, NULL);
+        cr_contentstat_free(fex_stat, NULL);
+        cr_contentstat_free(oth_stat, NULL);
+        cr_contentstat_free(pri_zck_stat, NULL);
+        cr_contentstat_free(fil_zck_stat, NULL);
+        cr_contentstat_free(fex_zck_stat, NULL);
+        cr_contentstat_free(oth_zck_stat, NULL);
+        g_free(pri_dict);
+        g_free(fil_dict);
+        g_free(fex_dict);
+        g_free(oth_dict);
+        return 0;
     }
 
     const char *compression_suffix = cr_compression_suffix(
                                     cmd_options->compression_type);
 
+    cr_CompressionOptions pri_copts = cr_compression_options_map_get(
+                            cmd_options->compression_options, "primary");
+    cr_CompressionOptions fil_copts = cr_compression_options_map_get(
+                            cmd_options->compression_options, "filelists");
+    cr_CompressionOptions fex_copts = cr_compression_options_map_get(
+                            cmd_options->compression_options, "filelists-ext");
+    cr_CompressionOptions oth_copts = cr_compression_options_map_get(
+                            cmd_options->compression_options, "other");
+    cr_CompressionOptions pri_zck_copts = cr_compression_options_map_get(
+                            cmd_options->compression_options, "primary_zck");
+    cr_CompressionOptions fil_zck_copts = cr_compression_options_map_get(
+                            cmd_options->compression_options, "filelists_zck");
+    cr_CompressionOptions fex_zck_copts = cr_compression_options_map_get(
+                            cmd_options->compression_options, "filelists-ext_zck");
+    cr_CompressionOptions oth_zck_copts = cr_compression_options_map_get(
+                            cmd_options->compression_options, "other_zck");
+
+    if (cmd_options->compression_type == CR_CW_ZSTD_COMPRESSION) {
+        pri_copts.dict = pri_zstd_dict;
+        pri_copts.dict_size = pri_zstd_dict_size;
+        fil_copts.dict = fil_zstd_dict;
+        fil_copts.dict_size = fil_zstd_dict_size;
+        fex_copts.dict = fex_zstd_dict;
+        fex_copts.dict_size = fex_zstd_dict_size;
+        oth_copts.dict = oth_zstd_dict;
+        oth_copts.dict_size = oth_zstd_dict_size;
+    }
+
     gchar *pri_xml_filename = g_strconcat(cmd_options->tmp_out_repo,
                                           "/primary.xml",
                                           compression_suffix, NULL);
@@ -984,10 +1264,12 @@ dump_merged_metadata(GHashTable *merged_hashtable,
                                             "/updateinfo.xml",
                                             compression_suffix, NULL);
 
-    pri_f = cr_xmlfile_sopen_primary(pri_xml_filename,
-                                     cmd_options->compression_type,
-                                     pri_stat,
-                                     &tmp_err);
+    pri_f = cr_xmlfile_sopen_with_options(pri_xml_filename,
+                                          CR_XMLFILE_PRIMARY,
+                                          cmd_options->compression_type,
+                                          pri_stat,
+                                          &pri_copts,
+                                          &tmp_err);
     if (tmp_err) {
         g_critical("Cannot open %s: %s", pri_xml_filename, tmp_err->message);
         cr_contentstat_free(pri_stat, NULL);
@@ -1012,10 +1294,12 @@ dump_merged_metadata(GHashTable *merged_hashtable,
         return 0;
     }
 
-    fil_f = cr_xmlfile_sopen_filelists(fil_xml_filename,
-                                       cmd_options->compression_type,
-                                       fil_stat,
-                                       &tmp_err);
+    fil_f = cr_xmlfile_sopen_with_options(fil_xml_filename,
+                                          CR_XMLFILE_FILELISTS,
+                                          cmd_options->compression_type,
+                                          fil_stat,
+                                          &fil_copts,
+                                          &tmp_err);
     if (tmp_err) {
         g_critical("Cannot open %s: %s", fil_xml_filename, tmp_err->message);
         cr_contentstat_free(pri_stat, NULL);
@@ -1041,10 +1325,12 @@ dump_merged_metadata(GHashTable *merged_hashtable,
     }
 
     if (cmd_options->filelists_ext) {
-        fex_f = cr_xmlfile_sopen_filelists(fex_xml_filename,
-                                           cmd_options->compression_type,
-                                           fex_stat,
-                                           &tmp_err);
+        fex_f = cr_xmlfile_sopen_with_options(fex_xml_filename,
+                                              CR_XMLFILE_FILELISTS,
+                                              cmd_options->compression_type,
+                                              fex_stat,
+                                              &fex_copts,
+                                              &tmp_err);
         if (tmp_err) {
             g_critical("Cannot open %s: %s", fil_xml_filename, tmp_err->message);
             cr_contentstat_free(pri_stat, NULL);
@@ -1071,10 +1357,12 @@ dump_merged_metadata(GHashTable *merged_hashtable,
         }
     }
 
-    oth_f = cr_xmlfile_sopen_other(oth_xml_filename,
-                                   cmd_options->compression_type,
-                                   oth_stat,
-                                   &tmp_err);
+    oth_f = cr_xmlfile_sopen_with_options(oth_xml_filename,
+                                          CR_XMLFILE_OTHER,
+                                          cmd_options->compression_type,
+                                          oth_stat,
+                                          &oth_copts,
+                                          &tmp_err);
     if (tmp_err) {
         g_critical("Cannot open %s: %s", oth_xml_filename, tmp_err->message);
         cr_contentstat_free(pri_stat, NULL);
@@ -1121,118 +1409,103 @@ dump_merged_metadata(GHashTable *merged_hashtable,
         oth_zck_filename = g_strconcat(cmd_options->tmp_out_repo,
                                        "/other.xml.zck", NULL);
 
-        pri_cr_zck = cr_xmlfile_sopen_primary(pri_zck_filename,
-                                              CR_CW_ZCK_COMPRESSION,
-                                              pri_zck_stat,
-                                              &tmp_err);
+        pri_cr_zck = cr_xmlfile_sopen_with_options(pri_zck_filename,
+                                                   CR_XMLFILE_PRIMARY,
+                                                   CR_CW_ZCK_COMPRESSION,
+                                                   pri_zck_stat,
+                                                   &pri_zck_copts,
+                                                   &tmp_err);
         assert(pri_cr_zck || tmp_err);
         if (!pri_cr_zck) {
             g_critical("Cannot open file %s: %s",
                        pri_zck_filename, tmp_err->message);
             g_clear_error(&tmp_err);
-            cr_contentstat_free(pri_zck_stat, NULL);
-            g_free(pri_zck_filename);
-            g_free(fil_zck_filename);
-            g_free(fex_zck_filename);
-            g_free(oth_zck_filename);
-            exit(EXIT_FAILURE);
+            dump_failed = TRUE;
+            goto dump_error;
         }
         cr_set_dict(pri_cr_zck->f, pri_dict, pri_dict_size, &tmp_err);
         if (tmp_err) {
             g_critical("Error reading setting primary dict %s: %s",
                        pri_dict_file, tmp_err->message);
             g_clear_error(&tmp_err);
-            exit(EXIT_FAILURE);
+            dump_failed = TRUE;
+            goto dump_error;
         }
-        g_free(pri_dict);
-
-        fil_cr_zck = cr_xmlfile_sopen_filelists(fil_zck_filename,
-                                                CR_CW_ZCK_COMPRESSION,
-                                                fil_zck_stat,
-                                                &tmp_err);
+        g_clear_pointer(&pri_dict, g_free);
+
+        fil_cr_zck = cr_xmlfile_sopen_with_options(fil_zck_filename,
+                                                   CR_XMLFILE_FILELISTS,
+                                                   CR_CW_ZCK_COMPRESSION,
+                                                   fil_zck_stat,
+                                                   &fil_zck_copts,
+                                                   &tmp_err);
         assert(fil_cr_zck || tmp_err);
         if (!fil_cr_zck) {
             g_critical("Cannot open file %s: %s",
                        fil_zck_filename, tmp_err->message);
             g_clear_error(&tmp_err);
-            cr_contentstat_free(pri_zck_stat, NULL);
-            cr_contentstat_free(fil_zck_stat, NULL);
-            g_free(pri_zck_filename);
-            g_free(fil_zck_filename);
-            g_free(fex_zck_filename);
-            g_free(oth_zck_filename);
-            cr_xmlfile_close(pri_cr_zck, NULL);
-            exit(EXIT_FAILURE);
+            dump_failed = TRUE;
+            goto dump_error;
         }
         cr_set_dict(fil_cr_zck->f, fil_dict, fil_dict_size, &tmp_err);
         if (tmp_err) {
             g_critical("Error reading setting filelists dict %s: %s",
                        fil_dict_file, tmp_err->message);
             g_clear_error(&tmp_err);
-            exit(EXIT_FAILURE);
+            dump_failed = TRUE;
+            goto dump_error;
         }
-        g_free(fil_dict);
+        g_clear_pointer(&fil_dict, g_free);
 
         if (cmd_options->filelists_ext) {
-            fex_cr_zck = cr_xmlfile_sopen_filelists(fex_zck_filename,
-                                                    CR_CW_ZCK_COMPRESSION,
-                                                    fex_zck_stat,
-                                                    &tmp_err);
+            fex_cr_zck = cr_xmlfile_sopen_with_options(fex_zck_filename,
+                                                       CR_XMLFILE_FILELISTS,
+                                                       CR_CW_ZCK_COMPRESSION,
+                                                       fex_zck_stat,
+                                                       &fex_zck_copts,
+                                                       &tmp_err);
             assert(fex_cr_zck || tmp_err);
             if (!fex_cr_zck) {
                 g_critical("Cannot open file %s: %s",
                            fex_zck_filename, tmp_err->message);
                 g_clear_error(&tmp_err);
-                cr_contentstat_free(pri_zck_stat, NULL);
-                cr_contentstat_free(fil_zck_stat, NULL);
-                cr_contentstat_free(fex_zck_stat, NULL);
-                g_free(pri_zck_filename);
-                g_free(fil_zck_filename);
-                g_free(fex_zck_filename);
-                g_free(oth_zck_filename);
-                cr_xmlfile_close(fil_cr_zck, NULL);
-                cr_xmlfile_close(pri_cr_zck, NULL);
-                exit(EXIT_FAILURE);
+                dump_failed = TRUE;
+                goto dump_error;
             }
             cr_set_dict(fex_cr_zck->f, fex_dict, fex_dict_size, &tmp_err);
             if (tmp_err) {
                 g_critical("Error reading setting filelists-ext dict %s: %s",
                            fex_dict_file, tmp_err->message);
                 g_clear_error(&tmp_err);
-                exit(EXIT_FAILURE);
+                dump_failed = TRUE;
+                goto dump_error;
             }
-            g_free(fex_dict);
+            g_clear_pointer(&fex_dict, g_free);
         }
 
-        oth_cr_zck = cr_xmlfile_sopen_other(oth_zck_filename,
-                                            CR_CW_ZCK_COMPRESSION,
-                                            oth_zck_stat,
-                                            &tmp_err);
+        oth_cr_zck = cr_xmlfile_sopen_with_options(oth_zck_filename,
+                                                   CR_XMLFILE_OTHER,
+                                                   CR_CW_ZCK_COMPRESSION,
+                                                   oth_zck_stat,
+                                                   &oth_zck_copts,
+                                                   &tmp_err);
         assert(oth_cr_zck || tmp_err);
         if (!oth_cr_zck) {
             g_critical("Cannot open file %s: %s",
                        oth_zck_filename, tmp_err->message);
             g_clear_error(&tmp_err);
-            cr_contentstat_free(pri_zck_stat, NULL);
-            cr_contentstat_free(fil_zck_stat, NULL);
-            cr_contentstat_free(fex_zck_stat, NULL);
-            cr_contentstat_free(oth_zck_stat, NULL);
-            g_free(pri_zck_filename);
-            g_free(fil_zck_filename);
-            g_free(oth_zck_filename);
-            cr_xmlfile_close(fex_cr_zck, NULL);
-            cr_xmlfile_close(fil_cr_zck, NULL);
-            cr_xmlfile_close(pri_cr_zck, NULL);
-            exit(EXIT_FAILURE);
+            dump_failed = TRUE;
+            goto dump_error;
         }
         cr_set_dict(oth_cr_zck->f, oth_dict, oth_dict_size, &tmp_err);
         if (tmp_err) {
             g_critical("Error reading setting other dict %s: %s",
                        oth_dict_file, tmp_err->message);
             g_clear_error(&tmp_err);
-            exit(EXIT_FAILURE);
+            dump_failed = TRUE;
+            goto dump_error;
         }
-        g_free(oth_dict);
+        g_clear_pointer(&oth_dict, g_free);
 
         // Set number of packages
         g_debug("Setting number of packages");
@@ -1245,11 +1518,6 @@ dump_merged_metadata(GHashTable *merged_hashtable,
 
     // Prepare sqlite if needed
 
-    cr_SqliteDb *pri_db = NULL;
-    cr_SqliteDb *fil_db = NULL;
-    cr_SqliteDb *fex_db = NULL;
-    cr_SqliteDb *oth_db = NULL;
-
     if (cmd_options->database) {
         gchar *pri_db_filename = NULL;
         gchar *fil_db_filename = NULL;
@@ -1291,7 +1559,7 @@ dump_merged_metadata(GHashTable *merged_hashtable,
 
     char *prev_srpm = NULL;
 
-    for (key = keys; key; key = g_list_next(key)) {
+    for (key = keys; key && !dump_failed; key = g_list_next(key)) {
         gpointer value = g_hash_table_lookup(merged_hashtable, key->data);
         GSList *element = (GSList *) value;
         element = g_slist_sort(element, package_cmp);
@@ -1300,6 +1568,17 @@ dump_merged_metadata(GHashTable *merged_hashtable,
             cr_Package *pkg;
 
             pkg = (cr_Package *) element->data;
+
+            // With --lazy-load this is the first time files and changelogs
+            // are needed, report their errors instead of dumping nothing
+            if (cr_package_load_lazy(pkg, &tmp_err) != CRE_OK) {
+                g_critical("Cannot load metadata of %s: %s",
+                           pkg->location_href, tmp_err->message);
+                g_clear_error(&tmp_err);
+                dump_failed = TRUE;
+                break;
+            }
+
             if (cmd_options->filelists_ext) {
                 res = cr_xml_dump_ext(pkg, NULL);
             } else {
@@ -1349,12 +1628,17 @@ dump_merged_metadata(GHashTable *merged_hashtable,
             free(res.filelists);
             free(res.filelists_ext);
             free(res.other);
+
+            // Files and changelogs loaded by --lazy-load are not needed
+            // anymore, don't keep them all in memory till the end
+            cr_package_unload_lazy(pkg);
         }
     }
     g_free(prev_srpm);
     g_list_free(keys);
 
 
+dump_error:
     // Close files
 
     cr_xmlfile_close(pri_f, NULL);
@@ -1368,6 +1652,35 @@ dump_merged_metadata(GHashTable *merged_hashtable,
         cr_xmlfile_close(oth_cr_zck, NULL);
     }
 
+    if (dump_failed) {
+        cr_db_close(pri_db, NULL);
+        cr_db_close(fil_db, NULL);
+        cr_db_close(fex_db, NULL);
+        cr_db_close(oth_db, NULL);
+        cr_contentstat_free(pri_stat, NULL);
+        cr_contentstat_free(fil_stat, NULL);
+        cr_contentstat_free(fex_stat, NULL);
+        cr_contentstat_free(oth_stat, NULL);
+        cr_contentstat_free(pri_zck_stat, NULL);
+        cr_contentstat_free(fil_zck_stat, NULL);
+        cr_contentstat_free(fex_zck_stat, NULL);
+        cr_contentstat_free(oth_zck_stat, NULL);
+        g_free(pri_zck_filename);
+        g_free(fil_zck_filename);
+        g_free(fex_zck_filename);
+        g_free(oth_zck_filename);
+        g_free(pri_xml_filename);
+        g_free(fil_xml_filename);
+        g_free(fex_xml_filename);
+        g_free(oth_xml_filename);
+        g_free(update_info_filename);
+        g_free(pri_dict);
+        g_free(fil_dict);
+        g_free(fex_dict);
+        g_free(oth_dict);
+        return 0;
+    }
+
 
     // Write updateinfo.xml
     // TODO
@@ -1446,6 +1759,10 @@ dump_merged_metadata(GHashTable *merged_hashtable,
     cr_RepomdRecord *update_info_zck_rec      = NULL;
     cr_RepomdRecord *pkgorigins_rec           = NULL;
     cr_RepomdRecord *pkgorigins_zck_rec       = NULL;
+    cr_RepomdRecord *pri_zstd_dict_rec        = NULL;
+    cr_RepomdRecord *fil_zstd_dict_rec        = NULL;
+    cr_RepomdRecord *fex_zstd_dict_rec        = NULL;
+    cr_RepomdRecord *oth_zstd_dict_rec        = NULL;
 
 #ifdef WITH_LIBMODULEMD
     cr_RepomdRecord *modulemd_rec = NULL;
@@ -1556,6 +1873,30 @@ dump_merged_metadata(GHashTable *merged_hashtable,
     }
 
 
+    // Zstd dictionaries
+
+    if (pri_zstd_dict_filename) {
+        pri_zstd_dict_rec = cr_repomd_record_new("primary_zstd_dict",
+                                                 pri_zstd_dict_filename);
+        cr_repomd_record_fill(pri_zstd_dict_rec, CR_CHECKSUM_SHA256, NULL);
+    }
+    if (fil_zstd_dict_filename) {
+        fil_zstd_dict_rec = cr_repomd_record_new("filelists_zstd_dict",
+                                                 fil_zstd_dict_filename);
+        cr_repomd_record_fill(fil_zstd_dict_rec, CR_CHECKSUM_SHA256, NULL);
+    }
+    if (fex_zstd_dict_filename) {
+        fex_zstd_dict_rec = cr_repomd_record_new("filelists-ext_zstd_dict",
+                                                 fex_zstd_dict_filename);
+        cr_repomd_record_fill(fex_zstd_dict_rec, CR_CHECKSUM_SHA256, NULL);
+    }
+    if (oth_zstd_dict_filename) {
+        oth_zstd_dict_rec = cr_repomd_record_new("other_zstd_dict",
+                                                 oth_zstd_dict_filename);
+        cr_repomd_record_fill(oth_zstd_dict_rec, CR_CHECKSUM_SHA256, NULL);
+    }
+
+
     // Pkgorigins
 
     if (cmd_options->koji || cmd_options->pkgorigins) {
@@ -1588,6 +1929,19 @@ dump_merged_metadata(GHashTable *merged_hashtable,
 #endif
 
 
+    // Pool for compress -> fill -> rename chains of dbs and zck files
+    GThreadPool *rec_pool = g_thread_pool_new(cr_repomd_record_task_thread,
+                                              NULL, 3, FALSE, NULL);
+
+    cr_RepomdRecordTask *pri_db_rec_task  = NULL;
+    cr_RepomdRecordTask *fil_db_rec_task  = NULL;
+    cr_RepomdRecordTask *fex_db_rec_task  = NULL;
+    cr_RepomdRecordTask *oth_db_rec_task  = NULL;
+    cr_RepomdRecordTask *pri_zck_rec_task = NULL;
+    cr_RepomdRecordTask *fil_zck_rec_task = NULL;
+    cr_RepomdRecordTask *fex_zck_rec_task = NULL;
+    cr_RepomdRecordTask *oth_zck_rec_task = NULL;
+
     // Sqlite db
 
     if (cmd_options->database) {
@@ -1624,52 +1978,80 @@ dump_merged_metadata(GHashTable *merged_hashtable,
             fex_db_c_filename = g_strconcat(fex_db_filename, db_suffix, NULL);
         gchar *oth_db_c_filename = g_strconcat(oth_db_filename, db_suffix, NULL);
 
-        GThreadPool *compress_pool =  g_thread_pool_new(cr_compressing_thread,
-                                                        NULL, 3, FALSE, NULL);
+        // Every database has its own compress -> fill -> rename chain
+        // which runs as soon as there is a free thread in the pool.
+        pri_db_rec = cr_repomd_record_new("primary_db", pri_db_c_filename);
+        fil_db_rec = cr_repomd_record_new("filelists_db", fil_db_c_filename);
+        if (cmd_options->filelists_ext)
+            fex_db_rec = cr_repomd_record_new("filelists-ext_db", fex_db_c_filename);
+        oth_db_rec = cr_repomd_record_new("other_db", oth_db_c_filename);
 
         cr_CompressionTask *pri_db_task = NULL;
         cr_CompressionTask *fil_db_task = NULL;
         cr_CompressionTask *fex_db_task = NULL;
         cr_CompressionTask *oth_db_task = NULL;
 
-        pri_db_task = cr_compressiontask_new(pri_db_filename,
-                                             pri_db_c_filename,
-                                             cmd_options->db_compression_type,
-                                             CR_CHECKSUM_SHA256,
-                                             NULL, FALSE, 1, NULL);
-        g_thread_pool_push(compress_pool, pri_db_task, NULL);
-
-        fil_db_task = cr_compressiontask_new(fil_db_filename,
-                                             fil_db_c_filename,
-                                             cmd_options->db_compression_type,
-                                             CR_CHECKSUM_SHA256,
-                                             NULL, FALSE, 1, NULL);
-        g_thread_pool_push(compress_pool, fil_db_task, NULL);
+        cr_CompressionOptions pri_db_copts = cr_compression_options_map_get(
+                            cmd_options->compression_options, "primary_db");
+        pri_db_task = cr_compressiontask_new_with_options(pri_db_filename,
+                                                          pri_db_c_filename,
+                                                          cmd_options->db_compression_type,
+                                                          CR_CHECKSUM_SHA256,
+                                                          &pri_db_copts,
+                                                          NULL, FALSE, 1, NULL);
+        pri_db_rec_task = cr_repomdrecordtask_new(pri_db_rec,
+                                                  pri_db_task,
+                                                  CR_CHECKSUM_SHA256,
+                                                  cmd_options->unique_md_filenames,
+                                                  NULL);
+        g_thread_pool_push(rec_pool, pri_db_rec_task, NULL);
+
+        cr_CompressionOptions fil_db_copts = cr_compression_options_map_get(
+                            cmd_options->compression_options, "filelists_db");
+        fil_db_task = cr_compressiontask_new_with_options(fil_db_filename,
+                                                          fil_db_c_filename,
+                                                          cmd_options->db_compression_type,
+                                                          CR_CHECKSUM_SHA256,
+                                                          &fil_db_copts,
+                                                          NULL, FALSE, 1, NULL);
+        fil_db_rec_task = cr_repomdrecordtask_new(fil_db_rec,
+                                                  fil_db_task,
+                                                  CR_CHECKSUM_SHA256,
+                                                  cmd_options->unique_md_filenames,
+                                                  NULL);
+        g_thread_pool_push(rec_pool, fil_db_rec_task, NULL);
 
         if (cmd_options->filelists_ext) {
-            fex_db_task = cr_compressiontask_new(fex_db_filename,
-                                                 fex_db_c_filename,
-                                                 cmd_options->db_compression_type,
-                                                 CR_CHECKSUM_SHA256,
-                                                 NULL, FALSE, 1, NULL);
-            g_thread_pool_push(compress_pool, fex_db_task, NULL);
+            cr_CompressionOptions fex_db_copts = cr_compression_options_map_get(
+                                cmd_options->compression_options, "filelists-ext_db");
+            fex_db_task = cr_compressiontask_new_with_options(fex_db_filename,
+                                                              fex_db_c_filename,
+                                                              cmd_options->db_compression_type,
+                                                              CR_CHECKSUM_SHA256,
+                                                              &fex_db_copts,
+                                                              NULL, FALSE, 1, NULL);
+            fex_db_rec_task = cr_repomdrecordtask_new(fex_db_rec,
+                                                      fex_db_task,
+                                                      CR_CHECKSUM_SHA256,
+                                                      cmd_options->unique_md_filenames,
+                                                      NULL);
+            g_thread_pool_push(rec_pool, fex_db_rec_task, NULL);
         }
 
-        oth_db_task = cr_compressiontask_new(oth_db_filename,
-                                             oth_db_c_filename,
-                                             cmd_options->db_compression_type,
-                                             CR_CHECKSUM_SHA256,
-                                             NULL, FALSE, 1, NULL);
-        g_thread_pool_push(compress_pool, oth_db_task, NULL);
-
-        g_thread_pool_free(compress_pool, FALSE, TRUE);
-
-        // Prepare repomd records
-        pri_db_rec = cr_repomd_record_new("primary_db", pri_db_c_filename);
-        fil_db_rec = cr_repomd_record_new("filelists_db", fil_db_c_filename);
-        if (cmd_options->filelists_ext)
-            fex_db_rec = cr_repomd_record_new("filelists-ext_db", fil_db_c_filename);
-        oth_db_rec = cr_repomd_record_new("other_db", oth_db_c_filename);
+        cr_CompressionOptions oth_db_copts = cr_compression_options_map_get(
+                            cmd_options->compression_options, "other_db");
+        oth_db_task = cr_compressiontask_new_with_options(oth_db_filename,
+                                                          oth_db_c_filename,
+                                                          cmd_options->db_compression_type,
+                                                          CR_CHECKSUM_SHA256,
+                                                          &oth_db_copts,
+                                                          NULL, FALSE, 1, NULL);
+        oth_db_rec_task = cr_repomdrecordtask_new(oth_db_rec,
+                                                  oth_db_task,
+                                                  CR_CHECKSUM_SHA256,
+                                                  cmd_options->unique_md_filenames,
+                                                  NULL);
+        g_thread_pool_push(rec_pool, oth_db_rec_task, NULL);
 
         g_free(pri_db_filename);
         g_free(fil_db_filename);
@@ -1680,55 +2062,6 @@ dump_merged_metadata(GHashTable *merged_hashtable,
         g_free(fil_db_c_filename);
         g_free(fex_db_c_filename);
         g_free(oth_db_c_filename);
-
-        cr_repomd_record_load_contentstat(pri_db_rec, pri_db_task->stat);
-        cr_repomd_record_load_contentstat(fil_db_rec, fil_db_task->stat);
-        if (cmd_options->filelists_ext)
-            cr_repomd_record_load_contentstat(fex_db_rec, fex_db_task->stat);
-        cr_repomd_record_load_contentstat(oth_db_rec, oth_db_task->stat);
-
-        cr_compressiontask_free(pri_db_task, NULL);
-        cr_compressiontask_free(fil_db_task, NULL);
-        cr_compressiontask_free(fex_db_task, NULL);
-        cr_compressiontask_free(oth_db_task, NULL);
-
-        fill_pool = g_thread_pool_new(cr_repomd_record_fill_thread,
-                                      NULL, 3, FALSE, NULL);
-
-        cr_RepomdRecordFillTask *pri_db_fill_task = NULL;
-        cr_RepomdRecordFillTask *fil_db_fill_task = NULL;
-        cr_RepomdRecordFillTask *fex_db_fill_task = NULL;
-        cr_RepomdRecordFillTask *oth_db_fill_task = NULL;
-
-        pri_db_fill_task = cr_repomdrecordfilltask_new(pri_db_rec,
-                                                       CR_CHECKSUM_SHA256,
-                                                       NULL);
-        g_thread_pool_push(fill_pool, pri_db_fill_task, NULL);
-
-        fil_db_fill_task = cr_repomdrecordfilltask_new(fil_db_rec,
-                                                       CR_CHECKSUM_SHA256,
-                                                       NULL);
-        g_thread_pool_push(fill_pool, fil_db_fill_task, NULL);
-
-        if (cmd_options->filelists_ext) {
-            fex_db_fill_task = cr_repomdrecordfilltask_new(fex_db_rec,
-                                                           CR_CHECKSUM_SHA256,
-                                                           NULL);
-            g_thread_pool_push(fill_pool, fex_db_fill_task, NULL);
-        }
-
-        oth_db_fill_task = cr_repomdrecordfilltask_new(oth_db_rec,
-                                                       CR_CHECKSUM_SHA256,
-                                                       NULL);
-        g_thread_pool_push(fill_pool, oth_db_fill_task, NULL);
-
-        g_thread_pool_free(fill_pool, FALSE, TRUE);
-
-        cr_repomdrecordfilltask_free(pri_db_fill_task, NULL);
-        cr_repomdrecordfilltask_free(fil_db_fill_task, NULL);
-        cr_repomdrecordfilltask_free(fex_db_fill_task, NULL);
-        cr_repomdrecordfilltask_free(oth_db_fill_task, NULL);
-
     }
 
     // Zchunk
@@ -1751,48 +2084,73 @@ dump_merged_metadata(GHashTable *merged_hashtable,
             cr_repomd_record_load_zck_contentstat(fex_zck_rec, fex_zck_stat);
         cr_repomd_record_load_zck_contentstat(oth_zck_rec, oth_zck_stat);
 
-        fill_pool = g_thread_pool_new(cr_repomd_record_fill_thread,
-                                      NULL, 3, FALSE, NULL);
-
-        cr_RepomdRecordFillTask *pri_zck_fill_task = NULL;
-        cr_RepomdRecordFillTask *fil_zck_fill_task = NULL;
-        cr_RepomdRecordFillTask *fex_zck_fill_task = NULL;
-        cr_RepomdRecordFillTask *oth_zck_fill_task = NULL;
-
-        pri_zck_fill_task = cr_repomdrecordfilltask_new(pri_zck_rec,
-                                                        CR_CHECKSUM_SHA256,
-                                                        NULL);
-        g_thread_pool_push(fill_pool, pri_zck_fill_task, NULL);
+        // The zck files are already written, their chains are fill -> rename
+        pri_zck_rec_task = cr_repomdrecordtask_new(pri_zck_rec, NULL,
+                                                   CR_CHECKSUM_SHA256,
+                                                   cmd_options->unique_md_filenames,
+                                                   NULL);
+        g_thread_pool_push(rec_pool, pri_zck_rec_task, NULL);
 
-        fil_zck_fill_task = cr_repomdrecordfilltask_new(fil_zck_rec,
-                                                        CR_CHECKSUM_SHA256,
-                                                        NULL);
-        g_thread_pool_push(fill_pool, fil_zck_fill_task, NULL);
+        fil_zck_rec_task = cr_repomdrecordtask_new(fil_zck_rec, NULL,
+                                                   CR_CHECKSUM_SHA256,
+                                                   cmd_options->unique_md_filenames,
+                                                   NULL);
+        g_thread_pool_push(rec_pool, fil_zck_rec_task, NULL);
 
         if (cmd_options->filelists_ext) {
-            fex_zck_fill_task = cr_repomdrecordfilltask_new(fex_zck_rec,
-                                                            CR_CHECKSUM_SHA256,
-                                                            NULL);
-            g_thread_pool_push(fill_pool, fex_zck_fill_task, NULL);
+            fex_zck_rec_task = cr_repomdrecordtask_new(fex_zck_rec, NULL,
+                                                       CR_CHECKSUM_SHA256,
+                                                       cmd_options->unique_md_filenames,
+                                                       NULL);
+            g_thread_pool_push(rec_pool, fex_zck_rec_task, NULL);
         }
 
-        oth_zck_fill_task = cr_repomdrecordfilltask_new(oth_zck_rec,
-                                                        CR_CHECKSUM_SHA256,
-                                                        NULL);
-        g_thread_pool_push(fill_pool, oth_zck_fill_task, NULL);
+        oth_zck_rec_task = cr_repomdrecordtask_new(oth_zck_rec, NULL,
+                                                   CR_CHECKSUM_SHA256,
+                                                   cmd_options->unique_md_filenames,
+                                                   NULL);
+        g_thread_pool_push(rec_pool, oth_zck_rec_task, NULL);
+    }
 
-        g_thread_pool_free(fill_pool, FALSE, TRUE);
+    // Wait till all the chains end
+    g_thread_pool_free(rec_pool, FALSE, TRUE);
 
-        cr_repomdrecordfilltask_free(pri_zck_fill_task, NULL);
-        cr_repomdrecordfilltask_free(fil_zck_fill_task, NULL);
-        cr_repomdrecordfilltask_free(fex_zck_fill_task, NULL);
-        cr_repomdrecordfilltask_free(oth_zck_fill_task, NULL);
+    // Record of a failed chain has no checksums, don't publish it
+    gboolean rec_failed = FALSE;
+    cr_RepomdRecordTask *rec_tasks[] = {
+        pri_db_rec_task, fil_db_rec_task, fex_db_rec_task, oth_db_rec_task,
+        pri_zck_rec_task, fil_zck_rec_task, fex_zck_rec_task, oth_zck_rec_task,
+    };
+    for (size_t x = 0; x < G_N_ELEMENTS(rec_tasks); x++) {
+        if (rec_tasks[x] && rec_tasks[x]->err) {
+            g_critical("Cannot process %s: %s",
+                       rec_tasks[x]->record->type, rec_tasks[x]->err->message);
+            rec_failed = TRUE;
+        }
     }
+
+    cr_repomdrecordtask_free(pri_db_rec_task, NULL);
+    cr_repomdrecordtask_free(fil_db_rec_task, NULL);
+    cr_repomdrecordtask_free(fex_db_rec_task, NULL);
+    cr_repomdrecordtask_free(oth_db_rec_task, NULL);
+    cr_repomdrecordtask_free(pri_zck_rec_task, NULL);
+    cr_repomdrecordtask_free(fil_zck_rec_task, NULL);
+    cr_repomdrecordtask_free(fex_zck_rec_task, NULL);
+    cr_repomdrecordtask_free(oth_zck_rec_task, NULL);
     cr_contentstat_free(pri_zck_stat, NULL);
     cr_contentstat_free(fil_zck_stat, NULL);
     cr_contentstat_free(fex_zck_stat, NULL);
     cr_contentstat_free(oth_zck_stat, NULL);
 
+    if (rec_failed) {
+        g_free(pri_xml_filename);
+        g_free(fil_xml_filename);
+        g_free(fex_xml_filename);
+        g_free(oth_xml_filename);
+        g_free(update_info_filename);
+        return 0;
+    }
+
     // Add checksums into files names
 
     if (cmd_options->unique_md_filenames) {
@@ -1801,22 +2159,17 @@ dump_merged_metadata(GHashTable *merged_hashtable,
         if (cmd_options->filelists_ext)
             cr_repomd_record_rename_file(fex_xml_rec, NULL);
         cr_repomd_record_rename_file(oth_xml_rec, NULL);
-        cr_repomd_record_rename_file(pri_db_rec, NULL);
-        cr_repomd_record_rename_file(fil_db_rec, NULL);
-        if (cmd_options->filelists_ext)
-            cr_repomd_record_rename_file(fex_db_rec, NULL);
-        cr_repomd_record_rename_file(oth_db_rec, NULL);
-        cr_repomd_record_rename_file(pri_zck_rec, NULL);
-        cr_repomd_record_rename_file(fil_zck_rec, NULL);
-        if (cmd_options->filelists_ext)
-            cr_repomd_record_rename_file(fex_zck_rec, NULL);
-        cr_repomd_record_rename_file(oth_zck_rec, NULL);
+        // dbs and zck files are renamed by their cr_RepomdRecordTask
         cr_repomd_record_rename_file(groupfile_rec, NULL);
         cr_repomd_record_rename_file(groupfile_zck_rec, NULL);
         cr_repomd_record_rename_file(update_info_rec, NULL);
         cr_repomd_record_rename_file(update_info_zck_rec, NULL);
         cr_repomd_record_rename_file(pkgorigins_rec, NULL);
         cr_repomd_record_rename_file(pkgorigins_zck_rec, NULL);
+        cr_repomd_record_rename_file(pri_zstd_dict_rec, NULL);
+        cr_repomd_record_rename_file(fil_zstd_dict_rec, NULL);
+        cr_repomd_record_rename_file(fex_zstd_dict_rec, NULL);
+        cr_repomd_record_rename_file(oth_zstd_dict_rec, NULL);
 
 #ifdef WITH_LIBMODULEMD
         cr_repomd_record_rename_file(modulemd_rec, NULL);
@@ -1849,6 +2202,10 @@ dump_merged_metadata(GHashTable *merged_hashtable,
     cr_repomd_set_record(repomd_obj, update_info_zck_rec);
     cr_repomd_set_record(repomd_obj, pkgorigins_rec);
     cr_repomd_set_record(repomd_obj, pkgorigins_zck_rec);
+    cr_repomd_set_record(repomd_obj, pri_zstd_dict_rec);
+    cr_repomd_set_record(repomd_obj, fil_zstd_dict_rec);
+    cr_repomd_set_record(repomd_obj, fex_zstd_dict_rec);
+    cr_repomd_set_record(repomd_obj, oth_zstd_dict_rec);
 
 #ifdef WITH_LIBMODULEMD
     cr_repomd_set_record(repomd_obj, modulemd_rec);
@@ -1888,7 +2245,13 @@ dump_merged_metadata(GHashTable *merged_hashtable,
         dirp = g_dir_open (cmd_options->out_repo, 0, NULL);
         if (!dirp) {
             g_critical("Cannot open directory: %s", cmd_options->out_repo);
-            exit(1);
+            g_free(repomd_xml);
+            g_free(pri_xml_filename);
+            g_free(fil_xml_filename);
+            g_free(fex_xml_filename);
+            g_free(oth_xml_filename);
+            g_free(update_info_filename);
+            return 0;
         }
 
         const gchar *filename;
@@ -2074,13 +2437,40 @@ main(int argc, char **argv)
     if (cmd_options->noarch_repo_url) {
         struct cr_MetadataLocation *noarch_ml;
 
-        noarch_ml = cr_locate_metadata(cmd_options->noarch_repo_url, TRUE, NULL);
+        noarch_ml = cr_locate_metadata_mask(cmd_options->noarch_repo_url, TRUE,
+                                            CR_MD_PACKAGES | CR_MD_MODULES,
+                                            NULL);
         if (!noarch_ml) {
             g_critical("Cannot locate noarch repo: %s", cmd_options->noarch_repo_url);
             return 1;
         }
 
-        noarch_metadata = cr_metadata_new(CR_HT_KEY_FILENAME, 0, NULL);
+        // With --lazy-noarch-repo only the packages which can be looked up
+        // later are loaded.  Note: the table is keyed by filename but
+        // looked up by location_href (pkglist items are filenames as well)
+        GHashTable *hrefs = NULL;
+        GSList *pkglist = NULL;
+
+        if (cmd_options->lazy_noarch_repo) {
+            hrefs = noarch_hrefs(local_repos);
+            if (!hrefs) {
+                cr_metadatalocation_free(noarch_ml);
+                return 1;
+            }
+            GHashTableIter iter;
+            gpointer href;
+            g_hash_table_iter_init(&iter, hrefs);
+            while (g_hash_table_iter_next(&iter, &href, NULL))
+                pkglist = g_slist_prepend(pkglist, href);
+            g_debug("Noarch packages in merged repos: %u",
+                    g_hash_table_size(hrefs));
+        }
+
+        noarch_metadata = cr_metadata_new(CR_HT_KEY_FILENAME, 0, pkglist);
+        cr_metadata_set_lazy(noarch_metadata, cmd_options->lazy_load);
+        // Only noarch packages are looked up in the noarch repo
+        cr_xml_filter_add_arch(cr_metadata_filter(noarch_metadata), "noarch");
+        g_slist_free(pkglist);
 
         // Base paths in output of original createrepo doesn't have trailing '/'
         gchar *noarch_repopath = cr_normalize_dir_path(noarch_ml->original_url);
@@ -2090,7 +2480,10 @@ main(int argc, char **argv)
 
         g_debug("Loading noarch_repo: %s", noarch_repopath);
 
-        if (cr_metadata_load_xml(noarch_metadata, noarch_ml, NULL) != CRE_OK) {
+        if (hrefs && !g_hash_table_size(hrefs)) {
+            // No noarch package to replace, empty pkglist would mean no filter
+            g_debug("No noarch packages in merged repos - noarch_repo not loaded");
+        } else if (cr_metadata_load_xml(noarch_metadata, noarch_ml, NULL) != CRE_OK) {
             g_critical("Cannot load noarch repo: \"%s\"", noarch_ml->repomd);
             cr_metadata_free(noarch_metadata);
             // TODO cleanup
@@ -2110,6 +2503,8 @@ main(int argc, char **argv)
                                                            noarch_repopath);
         }
 
+        if (hrefs)
+            g_hash_table_destroy(hrefs);
         g_free(noarch_repopath);
         cr_metadatalocation_free(noarch_ml);
     }
@@ -2148,7 +2543,9 @@ main(int argc, char **argv)
                                   koji_stuff,
                                   cmd_options->omit_baseurl,
                                   cmd_options->repo_prefix_search,
-                                  cmd_options->repo_prefix_replace
+                                  cmd_options->repo_prefix_replace,
+                                  cmd_options->lazy_load,
+                                  cmd_options->parser_threads
                                  );
 
 
@@ -2158,15 +2555,24 @@ main(int argc, char **argv)
         koji_stuff_destroy(&koji_stuff);
 
 
+    int ret = 0;
+
     if(loaded_packages >= 0) {
         // Dump metadata
-        dump_merged_metadata(merged_hashtable,
+        if (!dump_merged_metadata(merged_hashtable,
                 loaded_packages,
                 groupfile,
 #ifdef WITH_LIBMODULEMD
                 merged_index,
 #endif
-                cmd_options);
+                cmd_options))
+        {
+            // Don't leave the unfinished repodata behind
+            cr_remove_dir(cmd_options->tmp_out_repo, NULL);
+            ret = 1;
+        }
+    } else {
+        ret = 1;
     }
 
 
@@ -2185,5 +2591,6 @@ main(int argc, char **argv)
     cr_metadata_free(noarch_metadata);
     destroy_merged_metadata_hashtable(merged_hashtable);
     free_options(cmd_options);
-    return loaded_packages >= 0 ? 0 : 1;
+    cr_zstd_dict_cleanup();
+    return ret;
 }
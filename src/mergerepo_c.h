@@ -58,11 +58,19 @@ struct CmdOptions {
     gboolean nogroups;
     gboolean noupdateinfo;
     char *compress_type;
+    char **compress_levels;
+    char **compress_profiles;
+    char **compress_strategies;
+    char **compress_buffer_sizes;
     gboolean zck_compression;
     char *zck_dict_dir;
+    gboolean zstd_dict;
     char *merge_method_str;
     gboolean all;
     char *noarch_repo_url;
+    gboolean lazy_noarch_repo;
+    gboolean lazy_load;
+    gint parser_threads;
     gboolean unique_md_filenames;
     gboolean simple_md_filenames;
     gboolean omit_baseurl;
@@ -84,6 +92,7 @@ struct CmdOptions {
     GSList *arch_list;
     cr_CompressionType db_compression_type;
     cr_CompressionType compression_type;
+    cr_CompressionOptionsMap *compression_options;
     MergeMethod merge_method;
 };
 
@@ -0,0 +1,297 @@
+/* createrepo_c - Library of routines for manipulation with repodata
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#include <glib.h>
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include "error.h"
+#include "metrics.h"
+#include "misc.h"
+
+#define ERR_DOMAIN      CREATEREPO_C_ERROR
+
+#define HITS_SUFFIX     "_hits"
+#define MISSES_SUFFIX   "_misses"
+
+typedef struct {
+    gint64 count;
+    gint64 total;
+    gint64 min;
+    gint64 max;
+    gint64 buckets[CR_METRICS_BUCKETS];
+} cr_MetricsStage;
+
+struct _cr_Metrics {
+    GMutex mutex;
+    gint64 start;           // Monotonic time of creation
+    GHashTable *stages;     // name -> cr_MetricsStage
+    GHashTable *counters;   // name -> gint64 *
+    GHashTable *peaks;      // name -> gint64 *
+};
+
+cr_Metrics *
+cr_metrics_new(void)
+{
+    cr_Metrics *metrics = g_new0(cr_Metrics, 1);
+    g_mutex_init(&metrics->mutex);
+    metrics->start = g_get_monotonic_time();
+    metrics->stages = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                            g_free, g_free);
+    metrics->counters = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                              g_free, g_free);
+    metrics->peaks = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                           g_free, g_free);
+    return metrics;
+}
+
+/** Value of the name in the table, created with zero value if needed.
+ * Must be called with the mutex locked.
+ */
+static gpointer
+lookup_or_insert(GHashTable *table, const char *name, gsize size)
+{
+    gpointer value = g_hash_table_lookup(table, name);
+    if (!value) {
+        value = g_malloc0(size);
+        g_hash_table_insert(table, g_strdup(name), value);
+    }
+    return value;
+}
+
+void
+cr_metrics_observe(cr_Metrics *metrics, const char *stage, gint64 usec)
+{
+    int bucket = 0;
+
+    if (!metrics)
+        return;
+
+    if (usec < 0)
+        usec = 0;
+
+    // Index of the smallest power of two greater than usec
+    while (bucket < CR_METRICS_BUCKETS - 1 && (G_GINT64_CONSTANT(1) << bucket) <= usec)
+        bucket++;
+
+    g_mutex_lock(&metrics->mutex);
+    cr_MetricsStage *s = lookup_or_insert(metrics->stages, stage,
+                                          sizeof(cr_MetricsStage));
+    if (s->count == 0 || usec < s->min)
+        s->min = usec;
+    if (usec > s->max)
+        s->max = usec;
+    s->count++;
+    s->total += usec;
+    s->buckets[bucket]++;
+    g_mutex_unlock(&metrics->mutex);
+}
+
+void
+cr_metrics_observe_since(cr_Metrics *metrics, const char *stage, gint64 start)
+{
+    if (!metrics)
+        return;
+
+    cr_metrics_observe(metrics, stage, g_get_monotonic_time() - start);
+}
+
+void
+cr_metrics_add(cr_Metrics *metrics, const char *counter, gint64 value)
+{
+    if (!metrics)
+        return;
+
+    g_mutex_lock(&metrics->mutex);
+    gint64 *c = lookup_or_insert(metrics->counters, counter, sizeof(gint64));
+    *c += value;
+    g_mutex_unlock(&metrics->mutex);
+}
+
+void
+cr_metrics_peak(cr_Metrics *metrics, const char *peak, gint64 value)
+{
+    if (!metrics)
+        return;
+
+    g_mutex_lock(&metrics->mutex);
+    gint64 *p = lookup_or_insert(metrics->peaks, peak, sizeof(gint64));
+    if (value > *p)
+        *p = value;
+    g_mutex_unlock(&metrics->mutex);
+}
+
+static gint
+cmp_names(gconstpointer a, gconstpointer b)
+{
+    return g_strcmp0(*(const char **) a, *(const char **) b);
+}
+
+/** Keys of the table in alphabetical order (stable reports are easier
+ * to diff).
+ */
+static GPtrArray *
+sorted_keys(GHashTable *table)
+{
+    GPtrArray *keys = g_ptr_array_new();
+    GHashTableIter iter;
+    gpointer key;
+
+    g_hash_table_iter_init(&iter, table);
+    while (g_hash_table_iter_next(&iter, &key, NULL))
+        g_ptr_array_add(keys, key);
+    g_ptr_array_sort(keys, cmp_names);
+
+    return keys;
+}
+
+static void
+append_stages(GString *json, GHashTable *stages)
+{
+    GPtrArray *keys = sorted_keys(stages);
+
+    g_string_append(json, "  \"stages\": {");
+    for (guint i = 0; i < keys->len; i++) {
+        const char *name = keys->pdata[i];
+        cr_MetricsStage *s = g_hash_table_lookup(stages, name);
+        gboolean first_bucket = TRUE;
+
+        g_string_append_printf(json,
+            "%s\n    \"%s\": {\"count\": %" G_GINT64_FORMAT
+            ", \"total_seconds\": %.6f, \"mean_us\": %.1f"
+            ", \"min_us\": %" G_GINT64_FORMAT ", \"max_us\": %" G_GINT64_FORMAT
+            ", \"histogram_us\": {",
+            i ? "," : "", name, s->count,
+            s->total / (double) G_USEC_PER_SEC,
+            s->count ? s->total / (double) s->count : 0.0,
+            s->min, s->max);
+
+        // Only non-empty buckets, keyed by their (exclusive) upper bound
+        for (int b = 0; b < CR_METRICS_BUCKETS; b++) {
+            if (!s->buckets[b])
+                continue;
+            if (b == CR_METRICS_BUCKETS - 1)
+                g_string_append_printf(json, "%s\"inf\": %" G_GINT64_FORMAT,
+                                       first_bucket ? "" : ", ", s->buckets[b]);
+            else
+                g_string_append_printf(json, "%s\"%" G_GINT64_FORMAT "\": %"
+                                       G_GINT64_FORMAT,
+                                       first_bucket ? "" : ", ",
+                                       G_GINT64_CONSTANT(1) << b,
+                                       s->buckets[b]);
+            first_bucket = FALSE;
+        }
+        g_string_append(json, "}}");
+    }
+    g_string_append(json, keys->len ? "\n  }" : "}");
+
+    g_ptr_array_free(keys, TRUE);
+}
+
+static void
+append_values(GString *json, const char *title, GHashTable *values)
+{
+    GPtrArray *keys = sorted_keys(values);
+
+    g_string_append_printf(json, "  \"%s\": {", title);
+    for (guint i = 0; i < keys->len; i++) {
+        const char *name = keys->pdata[i];
+        gint64 *value = g_hash_table_lookup(values, name);
+        g_string_append_printf(json, "%s\n    \"%s\": %" G_GINT64_FORMAT,
+                               i ? "," : "", name, *value);
+    }
+    g_string_append(json, keys->len ? "\n  }" : "}");
+
+    g_ptr_array_free(keys, TRUE);
+}
+
+static void
+append_hit_rates(GString *json, GHashTable *counters)
+{
+    GPtrArray *keys = sorted_keys(counters);
+    gboolean first = TRUE;
+
+    g_string_append(json, "  \"hit_rates\": {");
+    for (guint i = 0; i < keys->len; i++) {
+        const char *name = keys->pdata[i];
+        if (!g_str_has_suffix(name, HITS_SUFFIX))
+            continue;
+
+        gchar *prefix = g_strndup(name, strlen(name) - strlen(HITS_SUFFIX));
+        gchar *misses_name = g_strconcat(prefix, MISSES_SUFFIX, NULL);
+        gint64 *hits = g_hash_table_lookup(counters, name);
+        gint64 *misses = g_hash_table_lookup(counters, misses_name);
+        gint64 total = *hits + (misses ? *misses : 0);
+
+        g_string_append_printf(json, "%s\n    \"%s_hit_rate\": %.4f",
+                               first ? "" : ",", prefix,
+                               total ? *hits / (double) total : 0.0);
+        first = FALSE;
+        g_free(prefix);
+        g_free(misses_name);
+    }
+    g_string_append(json, first ? "}" : "\n  }");
+
+    g_ptr_array_free(keys, TRUE);
+}
+
+gboolean
+cr_metrics_write(cr_Metrics *metrics, const char *path, GError **err)
+{
+    gboolean ret;
+
+    assert(metrics);
+    assert(path);
+    assert(!err || *err == NULL);
+
+    g_mutex_lock(&metrics->mutex);
+
+    GString *json = g_string_new("{\n");
+    g_string_append_printf(json, "  \"wall_seconds\": %.6f,\n",
+                           (g_get_monotonic_time() - metrics->start)
+                           / (double) G_USEC_PER_SEC);
+    append_stages(json, metrics->stages);
+    g_string_append(json, ",\n");
+    append_values(json, "counters", metrics->counters);
+    g_string_append(json, ",\n");
+    append_values(json, "peaks", metrics->peaks);
+    g_string_append(json, ",\n");
+    append_hit_rates(json, metrics->counters);
+    g_string_append(json, "\n}\n");
+
+    g_mutex_unlock(&metrics->mutex);
+
+    ret = cr_write_to_file(err, (gchar *) path, "%s", json->str);
+    g_string_free(json, TRUE);
+
+    return ret;
+}
+
+void
+cr_metrics_free(cr_Metrics *metrics)
+{
+    if (!metrics)
+        return;
+
+    g_hash_table_destroy(metrics->stages);
+    g_hash_table_destroy(metrics->counters);
+    g_hash_table_destroy(metrics->peaks);
+    g_mutex_clear(&metrics->mutex);
+    g_free(metrics);
+}
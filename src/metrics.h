@@ -0,0 +1,114 @@
+/* createrepo_c - Library of routines for manipulation with repodata
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#ifndef __C_CREATEREPOLIB_METRICS_H__
+#define __C_CREATEREPOLIB_METRICS_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <glib.h>
+
+/** \defgroup   metrics     Run metrics (--metrics-file)
+ *  \addtogroup metrics
+ *  @{
+ *
+ * Three kinds of metrics are collected:
+ *  - stages    - durations of runs of a stage, as a histogram with
+ *                power of two buckets (in microseconds)
+ *  - counters  - summed values (bytes, cache hits, ..)
+ *  - peaks     - maximal observed values (queue lengths, ..)
+ *
+ * All functions are thread safe and do nothing if the metrics object
+ * is NULL, so the instrumentation can stay in place when metrics
+ * are not requested.
+ *
+ * Counters named "<name>_hits" and "<name>_misses" are reported together
+ * with the "<name>_hit_rate".
+ */
+
+/** Number of histogram buckets. The last one is for durations
+ * longer than 2^(CR_METRICS_BUCKETS-2) microseconds.
+ */
+#define CR_METRICS_BUCKETS  32
+
+typedef struct _cr_Metrics cr_Metrics;
+
+/** Create a new metrics object. The wall clock of the run starts now.
+ * @return              New cr_Metrics
+ */
+cr_Metrics *
+cr_metrics_new(void);
+
+/** Record one run of a stage.
+ * @param metrics       cr_Metrics or NULL
+ * @param stage         Name of the stage
+ * @param usec          Duration of the run in microseconds
+ */
+void
+cr_metrics_observe(cr_Metrics *metrics, const char *stage, gint64 usec);
+
+/** Record one run of a stage which started at the start time
+ * (a g_get_monotonic_time() value) and ends now.
+ * @param metrics       cr_Metrics or NULL
+ * @param stage         Name of the stage
+ * @param start         Start of the run
+ */
+void
+cr_metrics_observe_since(cr_Metrics *metrics, const char *stage, gint64 start);
+
+/** Add value to a counter.
+ * @param metrics       cr_Metrics or NULL
+ * @param counter       Name of the counter
+ * @param value         Value to add
+ */
+void
+cr_metrics_add(cr_Metrics *metrics, const char *counter, gint64 value);
+
+/** Update a peak value.
+ * @param metrics       cr_Metrics or NULL
+ * @param peak          Name of the peak
+ * @param value         Current value
+ */
+void
+cr_metrics_peak(cr_Metrics *metrics, const char *peak, gint64 value);
+
+/** Write the metrics as a JSON report.
+ * @param metrics       cr_Metrics
+ * @param path          Path to the report
+ * @param err           GError **
+ * @return              TRUE on success
+ */
+gboolean
+cr_metrics_write(cr_Metrics *metrics, const char *path, GError **err);
+
+/** Free the metrics object.
+ * @param metrics       cr_Metrics or NULL
+ */
+void
+cr_metrics_free(cr_Metrics *metrics);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __C_CREATEREPOLIB_METRICS_H__ */
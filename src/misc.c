@@ -17,6 +17,10 @@
  * USA.
  */
 
+#if defined(HAVE_COPY_FILE_RANGE) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE     // copy_file_range()
+#endif
+
 #include <glib/gstdio.h>
 #include <glib.h>
 #include <gio/gio.h>
@@ -24,11 +28,14 @@
 #include <assert.h>
 #include <curl/curl.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <ftw.h>
 #include <rpm/rpmlib.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/types.h>
 #include <sys/wait.h>
@@ -39,8 +46,13 @@
 #include "misc.h"
 #include "version.h"
 
+#ifdef HAVE_FICLONE
+#include <linux/fs.h>
+#endif
+
 #define ERR_DOMAIN      CREATEREPO_C_ERROR
 #define BUFFER_SIZE     4096
+#define CARRY_OVER_BUFFER_SIZE  (1024*128)
 
 #define xstr(s) str(s)
 #define str(s) #s
@@ -469,6 +481,21 @@ cr_compress_file_with_stat(const char *src,
                            const char *zck_dict_dir,
                            gboolean zck_auto_chunk,
                            GError **err)
+{
+    return cr_compress_file_with_options(src, in_dst, compression, stat,
+                                         NULL, zck_dict_dir, zck_auto_chunk,
+                                         err);
+}
+
+int
+cr_compress_file_with_options(const char *src,
+                              const char *in_dst,
+                              cr_CompressionType compression,
+                              cr_ContentStat *stat,
+                              const cr_CompressionOptions *options,
+                              const char *zck_dict_dir,
+                              gboolean zck_auto_chunk,
+                              GError **err)
 {
     int ret = CRE_OK;
     int readed;
@@ -554,7 +581,8 @@ cr_compress_file_with_stat(const char *src,
         }
     }
 
-    new = cr_sopen(dst, CR_CW_MODE_WRITE, compression, stat, &tmp_err);
+    new = cr_sopen_with_options(dst, CR_CW_MODE_WRITE, compression, stat,
+                                options, &tmp_err);
     if (tmp_err) {
         g_debug("%s: Cannot open destination file %s", __func__, dst);
         g_propagate_prefixed_error(err, tmp_err, "Cannot open %s: ", dst);
@@ -807,6 +835,152 @@ cr_download(CURL *in_handle,
     return CRE_OK;
 }
 
+struct cr_Transfer {
+    const char *url;
+    gchar *dst;
+    FILE *file;
+    CURL *handle;
+    char errorbuf[CURL_ERROR_SIZE];
+};
+
+int
+cr_download_multi(CURL *in_handle,
+                  const char * const *urls,
+                  const char * const *paths,
+                  const char *in_dst,
+                  int max_parallel,
+                  GError **err)
+{
+    CURLM *multi;
+    CURLMcode mcode;
+    CURLMsg *msg;
+    struct cr_Transfer *transfers;
+    guint count;
+    int running = 0, left;
+    int ret = CRE_OK;
+
+    assert(in_handle);
+    assert(in_dst);
+    assert(!err || *err == NULL);
+
+    count = urls ? g_strv_length((gchar **) urls) : 0;
+    if (!count)
+        return CRE_OK;
+
+    multi = curl_multi_init();
+    if (!multi) {
+        g_set_error(err, ERR_DOMAIN, CRE_CURL, "curl_multi_init failed");
+        return CRE_CURL;
+    }
+
+    // Transfers over the limit are queued by curl and reuse the connections
+    curl_multi_setopt(multi, CURLMOPT_MAX_TOTAL_CONNECTIONS,
+                      (long) MAX(max_parallel, 1));
+    curl_multi_setopt(multi, CURLMOPT_PIPELINING, (long) CURLPIPE_MULTIPLEX);
+
+    transfers = g_new0(struct cr_Transfer, count);
+    for (guint x = 0; x < count; x++) {
+        struct cr_Transfer *t = &transfers[x];
+
+        t->url = urls[x];
+        if (paths) {
+            _cleanup_free_ gchar *dir = NULL;
+
+            t->dst = g_build_filename(in_dst, paths[x], NULL);
+            dir = g_path_get_dirname(t->dst);
+            if (g_mkdir_with_parents(dir, 0755)) {
+                g_set_error(err, ERR_DOMAIN, CRE_IO,
+                            "Cannot create %s: %s", dir, g_strerror(errno));
+                ret = CRE_IO;
+                goto download_multi_cleanup;
+            }
+        } else {
+            t->dst = g_build_filename(in_dst, cr_get_filename(t->url), NULL);
+        }
+        t->file = fopen(t->dst, "wb");
+        if (!t->file) {
+            g_set_error(err, ERR_DOMAIN, CRE_IO,
+                        "Cannot open %s: %s", t->dst, g_strerror(errno));
+            ret = CRE_IO;
+            goto download_multi_cleanup;
+        }
+
+        t->handle = curl_easy_duphandle(in_handle);
+        if (!t->handle
+            || curl_easy_setopt(t->handle, CURLOPT_ERRORBUFFER, t->errorbuf) != CURLE_OK
+            || curl_easy_setopt(t->handle, CURLOPT_URL, t->url) != CURLE_OK
+            || curl_easy_setopt(t->handle, CURLOPT_WRITEDATA, t->file) != CURLE_OK
+            || curl_easy_setopt(t->handle, CURLOPT_PRIVATE, t) != CURLE_OK)
+        {
+            g_set_error(err, ERR_DOMAIN, CRE_CURL,
+                        "Cannot prepare curl handle for %s", t->url);
+            ret = CRE_CURL;
+            goto download_multi_cleanup;
+        }
+
+        mcode = curl_multi_add_handle(multi, t->handle);
+        if (mcode != CURLM_OK) {
+            g_set_error(err, ERR_DOMAIN, CRE_CURL,
+                        "curl_multi_add_handle failed: %s",
+                        curl_multi_strerror(mcode));
+            ret = CRE_CURL;
+            goto download_multi_cleanup;
+        }
+    }
+
+    do {
+        mcode = curl_multi_perform(multi, &running);
+        if (mcode == CURLM_OK && running)
+            mcode = curl_multi_wait(multi, NULL, 0, 1000, NULL);
+        if (mcode != CURLM_OK) {
+            g_set_error(err, ERR_DOMAIN, CRE_CURL,
+                        "curl_multi_perform failed: %s",
+                        curl_multi_strerror(mcode));
+            ret = CRE_CURL;
+            break;
+        }
+
+        while ((msg = curl_multi_info_read(multi, &left))) {
+            struct cr_Transfer *t = NULL;
+
+            if (msg->msg != CURLMSG_DONE)
+                continue;
+
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **) &t);
+            if (msg->data.result != CURLE_OK) {
+                g_set_error(err, ERR_DOMAIN, CRE_CURL,
+                            "Cannot download %s: %s: %s", t->url,
+                            curl_easy_strerror(msg->data.result),
+                            t->errorbuf);
+                ret = CRE_CURL;
+                break;
+            }
+
+            g_debug("%s: Successfully downloaded: %s", __func__, t->dst);
+        }
+    } while (running && ret == CRE_OK);
+
+download_multi_cleanup:
+
+    for (guint x = 0; x < count; x++) {
+        struct cr_Transfer *t = &transfers[x];
+
+        if (t->handle) {
+            curl_multi_remove_handle(multi, t->handle);
+            curl_easy_cleanup(t->handle);
+        }
+        if (t->file)
+            fclose(t->file);
+        if (t->dst && ret != CRE_OK)
+            remove(t->dst);
+        g_free(t->dst);
+    }
+    g_free(transfers);
+    curl_multi_cleanup(multi);
+
+    return ret;
+}
+
 gboolean
 cr_better_copy_file(const char *src, const char *in_dst, GError **err)
 {
@@ -831,6 +1005,189 @@ cr_better_copy_file(const char *src, const char *in_dst, GError **err)
     return TRUE;
 }
 
+static const char *
+carry_over_method_str(cr_CarryOverMethod method)
+{
+    switch (method) {
+        case CR_CARRY_OVER_RENAME:      return "rename";
+        case CR_CARRY_OVER_HARDLINK:    return "hardlink";
+        case CR_CARRY_OVER_REFLINK:     return "reflink";
+        case CR_CARRY_OVER_COPY_RANGE:  return "copy_file_range";
+        case CR_CARRY_OVER_STREAM:      return "stream";
+    }
+    return "unknown";
+}
+
+/** Copy the content of src_fd into the empty dst_fd by the first
+ * of the allowed copy methods that works.
+ */
+static cr_CarryOverMethod
+carry_over_data(int src_fd,
+                int dst_fd,
+                off_t size,
+                const char *src,
+                const char *dst,
+                int methods,
+                GError **err)
+{
+#ifdef HAVE_FICLONE
+    if ((methods & CR_CARRY_OVER_REFLINK) && ioctl(dst_fd, FICLONE, src_fd) == 0)
+        return CR_CARRY_OVER_REFLINK;
+#endif
+
+#ifdef HAVE_COPY_FILE_RANGE
+    if (methods & CR_CARRY_OVER_COPY_RANGE) {
+        off_t remaining = size;
+        gboolean unsupported = FALSE;
+
+        while (remaining > 0) {
+            ssize_t copied = copy_file_range(src_fd, NULL, dst_fd, NULL,
+                                             remaining, 0);
+            if (copied == -1 && errno == EINTR)
+                continue;
+            if (copied == -1 && remaining == size
+                && (errno == EXDEV || errno == EINVAL
+                    || errno == ENOSYS || errno == EOPNOTSUPP)) {
+                // Unsupported by the kernel or the filesystem(s)
+                unsupported = TRUE;
+                break;
+            }
+            if (copied == -1) {
+                g_set_error(err, ERR_DOMAIN, CRE_IO,
+                            "Error while copy %s -> %s: %s",
+                            src, dst, g_strerror(errno));
+                return 0;
+            }
+            if (copied == 0)    // The source was truncated meanwhile
+                break;
+            remaining -= copied;
+        }
+
+        if (!unsupported)
+            return CR_CARRY_OVER_COPY_RANGE;
+    }
+#else
+    (void) size;
+#endif
+
+    if (methods & CR_CARRY_OVER_STREAM) {
+        _cleanup_free_ char *buf = g_malloc(CARRY_OVER_BUFFER_SIZE);
+        ssize_t readed;
+
+        while ((readed = read(src_fd, buf, CARRY_OVER_BUFFER_SIZE)) != 0) {
+            if (readed == -1 && errno == EINTR)
+                continue;
+            if (readed == -1) {
+                g_set_error(err, ERR_DOMAIN, CRE_IO,
+                            "Error while read %s: %s", src, g_strerror(errno));
+                return 0;
+            }
+
+            for (ssize_t written = 0; written < readed; ) {
+                ssize_t ret = write(dst_fd, buf + written, readed - written);
+                if (ret == -1 && errno == EINTR)
+                    continue;
+                if (ret == -1) {
+                    g_set_error(err, ERR_DOMAIN, CRE_IO,
+                                "Error while write %s: %s", dst, g_strerror(errno));
+                    return 0;
+                }
+                written += ret;
+            }
+        }
+
+        return CR_CARRY_OVER_STREAM;
+    }
+
+    g_set_error(err, ERR_DOMAIN, CRE_IO,
+                "Cannot carry over %s -> %s: None of the allowed methods works",
+                src, dst);
+    return 0;
+}
+
+cr_CarryOverMethod
+cr_carry_over_file(const char *src,
+                   const char *in_dst,
+                   int methods,
+                   GError **err)
+{
+    struct stat st;
+    cr_CarryOverMethod method;
+    _cleanup_free_ gchar *dst = NULL;
+    _cleanup_file_close_ int src_fd = -1;
+    _cleanup_file_close_ int dst_fd = -1;
+
+    assert(src);
+    assert(in_dst);
+    assert(!err || *err == NULL);
+
+    // If destination is dir use filename from src
+    if (g_str_has_suffix(in_dst, "/"))
+        dst = g_strconcat(in_dst, cr_get_filename(src), NULL);
+    else
+        dst = g_strdup(in_dst);
+
+    if (stat(src, &st) == -1) {
+        g_set_error(err, ERR_DOMAIN, CRE_IO,
+                    "Cannot stat %s: %s", src, g_strerror(errno));
+        return 0;
+    }
+
+    if (!S_ISREG(st.st_mode)) {
+        g_set_error(err, ERR_DOMAIN, CRE_IO,
+                    "Cannot carry over %s: Not a regular file", src);
+        return 0;
+    }
+
+    if (g_file_test(dst, G_FILE_TEST_EXISTS)) {
+        g_set_error(err, ERR_DOMAIN, CRE_IO,
+                    "Cannot carry over %s -> %s: Destination exists", src, dst);
+        return 0;
+    }
+
+    if ((methods & CR_CARRY_OVER_RENAME) && rename(src, dst) == 0) {
+        method = CR_CARRY_OVER_RENAME;
+        goto done;
+    }
+
+    // Fails across filesystems (EXDEV) or where links are not supported
+    if ((methods & CR_CARRY_OVER_HARDLINK) && link(src, dst) == 0) {
+        method = CR_CARRY_OVER_HARDLINK;
+        goto done;
+    }
+
+    if ((src_fd = open(src, O_RDONLY | O_CLOEXEC)) == -1) {
+        g_set_error(err, ERR_DOMAIN, CRE_IO,
+                    "Cannot open file %s: %s", src, g_strerror(errno));
+        return 0;
+    }
+
+    if ((dst_fd = open(dst, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+                       st.st_mode & 07777)) == -1) {
+        g_set_error(err, ERR_DOMAIN, CRE_IO,
+                    "Cannot open file %s: %s", dst, g_strerror(errno));
+        return 0;
+    }
+
+    method = carry_over_data(src_fd, dst_fd, st.st_size, src, dst, methods, err);
+    if (!method) {
+        unlink(dst);
+        return 0;
+    }
+
+    // Like the old copy (G_FILE_COPY_ALL_METADATA), keep the mode and
+    // timestamps (--retain-old-md-by-age uses the mtime)
+    struct timespec times[2] = { st.st_atim, st.st_mtim };
+    if (fchmod(dst_fd, st.st_mode & 07777) == -1 || futimens(dst_fd, times) == -1)
+        g_debug("%s: Cannot set attributes of %s: %s", __func__, dst,
+                g_strerror(errno));
+
+done:
+    g_debug("%s: %s -> %s (%s)", __func__, src, dst,
+            carry_over_method_str(method));
+    return method;
+}
+
 int
 cr_remove_dir_cb(const char *fpath,
                  G_GNUC_UNUSED const struct stat *sb,
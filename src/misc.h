@@ -160,6 +160,27 @@ int cr_download(CURL *handle,
                 const char *destination,
                 GError **err);
 
+/** Download files from the URLs into the destination directory in
+ * parallel. All transfers share one curl multi handle, so connections
+ * to the same host are kept alive and reused (or multiplexed if HTTP/2
+ * is available). If any download fails, all downloaded files are removed.
+ * @param handle        CURL handle used as a template for every transfer
+ * @param urls          NULL terminated array of source urls
+ * @param paths         NULL or array of paths relative to the destination,
+ *                      one per url (missing subdirectories are created).
+ *                      If NULL, filenames from the urls are used.
+ * @param destination   destination directory
+ * @param max_parallel  maximal number of simultaneous connections
+ * @param err           GError **
+ * @return              cr_Error
+ */
+int cr_download_multi(CURL *handle,
+                      const char * const *urls,
+                      const char * const *paths,
+                      const char *destination,
+                      int max_parallel,
+                      GError **err);
+
 /** Copy file.
  * @param src           source filename
  * @param dst           destination (if dst is dir, filename of src is used)
@@ -205,6 +226,26 @@ int cr_compress_file_with_stat(const char *src,
                                gboolean zck_auto_chunk,
                                GError **err);
 
+/** Compress file with compression options.
+ * @param src           source filename
+ * @param dst           destination (see cr_compress_file_with_stat())
+ * @param comtype       type of compression
+ * @param stat          pointer to cr_ContentStat or NULL
+ * @param options       compression options or NULL for defaults
+ * @param zck_dict_dir  Location of zchunk zdicts (if zchunk is enabled)
+ * @param zck_auto_chunk Whether zchunk file should be auto-chunked
+ * @param err           GError **
+ * @return              cr_Error return code
+ */
+int cr_compress_file_with_options(const char *src,
+                                  const char *dst,
+                                  cr_CompressionType comtype,
+                                  cr_ContentStat *stat,
+                                  const cr_CompressionOptions *options,
+                                  const char *zck_dict_dir,
+                                  gboolean zck_auto_chunk,
+                                  GError **err);
+
 /** Decompress file.
  * @param SRC           source filename
  * @param DST           destination (If dst is dir, filename of src without
@@ -245,6 +286,43 @@ gboolean cr_better_copy_file(const char *src,
                              const char *dst,
                              GError **err);
 
+/** Methods of cr_carry_over_file(). They are tried in this order.
+ */
+typedef enum {
+    CR_CARRY_OVER_RENAME        = (1<<0), /*!<
+        Rename (the source is moved) */
+    CR_CARRY_OVER_HARDLINK      = (1<<1), /*!<
+        Hard link (the source and the destination share the inode) */
+    CR_CARRY_OVER_REFLINK       = (1<<2), /*!<
+        Reflink - FICLONE (the data extents are shared) */
+    CR_CARRY_OVER_COPY_RANGE    = (1<<3), /*!<
+        Copy by copy_file_range() (in the kernel) */
+    CR_CARRY_OVER_STREAM        = (1<<4), /*!<
+        Copy by read() and write() */
+} cr_CarryOverMethod;
+
+/** All methods which keep the source in place.
+ */
+#define CR_CARRY_OVER_COPY  (CR_CARRY_OVER_HARDLINK | CR_CARRY_OVER_REFLINK | \
+                             CR_CARRY_OVER_COPY_RANGE | CR_CARRY_OVER_STREAM)
+
+/** Carry a file over into another location by the cheapest of the allowed
+ * methods. The content of a copy is never modified in place, so it may
+ * share the data or even the inode with the source. Mode and timestamps
+ * of the source are preserved.
+ * @param src           Source filename
+ * @param dst           Destination (if dst is dir, filename of src is used),
+ *                      it must not exist
+ * @param methods       Allowed methods (cr_CarryOverMethod flags)
+ * @param err           GError **
+ * @return              Method that was used or 0 if an error occurred
+ */
+cr_CarryOverMethod
+cr_carry_over_file(const char *src,
+                   const char *dst,
+                   int methods,
+                   GError **err);
+
 /** Recursively remove directory.
  * @param path          filepath
  * @param err           GError **
@@ -48,6 +48,10 @@ typedef struct {
     gboolean compress;
     gboolean no_compress;
     gchar *compress_type;
+    gchar **compress_levels;
+    gchar **compress_profiles;
+    gchar **compress_strategies;
+    gchar **compress_buffer_sizes;
     gchar *checksum;
     gboolean unique_md_filenames;
     gboolean simple_md_filenames;
@@ -57,6 +61,9 @@ typedef struct {
     gboolean zck;
     gchar *zck_dict_dir;
 
+    // Items filled by check_arguments()
+    cr_CompressionOptionsMap *compression_options;
+
 } RawCmdOptions;
 
 static gboolean
@@ -79,6 +86,24 @@ parse_arguments(int *argc, char ***argv, RawCmdOptions *options, GError **err)
           NULL },
         { "compress-type", 0, 0, G_OPTION_ARG_STRING, &(options->compress_type),
           "Compression format to use.", "COMPRESS_TYPE" },
+        { "compress-level", 0, 0, G_OPTION_ARG_STRING_ARRAY, &(options->compress_levels),
+          "Compression level for metadata of the TYPE or for all metadata "
+          "if the TYPE is omitted. Can be used multiple times.",
+          "[TYPE=]LEVEL" },
+        { "compress-profile", 0, 0, G_OPTION_ARG_STRING_ARRAY, &(options->compress_profiles),
+          "Compression profile (default, fast or best) for metadata of the TYPE "
+          "or for all metadata if the TYPE is omitted. Can be used multiple times.",
+          "[TYPE=]PROFILE" },
+        { "compress-strategy", 0, 0, G_OPTION_ARG_STRING_ARRAY, &(options->compress_strategies),
+          "Compression strategy for metadata of the TYPE or for all metadata "
+          "if the TYPE is omitted: filtered, huffman, rle or fixed for gz, fast, "
+          "dfast, greedy, lazy, lazy2, btlazy2, btopt, btultra or btultra2 for "
+          "zstd. Other compression types ignore it. Can be used multiple times.",
+          "[TYPE=]STRATEGY" },
+        { "compress-buffer-size", 0, 0, G_OPTION_ARG_STRING_ARRAY, &(options->compress_buffer_sizes),
+          "Size in bytes of the buffer of compressed data (gz, xz and zstd) "
+          "for metadata of the TYPE or for all metadata if the TYPE is omitted. "
+          "Can be used multiple times.", "[TYPE=]BYTES" },
         { "checksum", 's', 0, G_OPTION_ARG_STRING, &(options->checksum),
           "Specify the checksum type to use. (default: sha256)", "SUMTYPE" },
         { "unique-md-filenames", 0, 0, G_OPTION_ARG_NONE,
@@ -111,6 +136,10 @@ parse_arguments(int *argc, char ***argv, RawCmdOptions *options, GError **err)
     options->compress = TRUE;
     options->no_compress = FALSE;
     options->compress_type = NULL;
+    options->compress_levels = NULL;
+    options->compress_profiles = NULL;
+    options->compress_strategies = NULL;
+    options->compress_buffer_sizes = NULL;
     options->checksum = NULL;
     options->unique_md_filenames = TRUE;
     options->simple_md_filenames = FALSE;
@@ -119,6 +148,7 @@ parse_arguments(int *argc, char ***argv, RawCmdOptions *options, GError **err)
     options->new_name = NULL;
     options->zck = FALSE;
     options->zck_dict_dir = NULL;
+    options->compression_options = NULL;
 
     GOptionContext *context;
     context = g_option_context_new("<input metadata> <output repodata>\n"
@@ -175,6 +205,30 @@ check_arguments(RawCmdOptions *options, GError **err)
         return FALSE;
     }
 
+    // --compress-level, --compress-profile, --compress-strategy
+    // and --compress-buffer-size
+    options->compression_options = cr_compression_options_map_new();
+    for (int x = 0; options->compress_levels && options->compress_levels[x]; x++)
+        if (!cr_compression_options_map_parse(options->compression_options,
+                                              options->compress_levels[x],
+                                              CR_CW_OPTION_LEVEL, err))
+            return FALSE;
+    for (int x = 0; options->compress_profiles && options->compress_profiles[x]; x++)
+        if (!cr_compression_options_map_parse(options->compression_options,
+                                              options->compress_profiles[x],
+                                              CR_CW_OPTION_PROFILE, err))
+            return FALSE;
+    for (int x = 0; options->compress_strategies && options->compress_strategies[x]; x++)
+        if (!cr_compression_options_map_parse(options->compression_options,
+                                              options->compress_strategies[x],
+                                              CR_CW_OPTION_STRATEGY, err))
+            return FALSE;
+    for (int x = 0; options->compress_buffer_sizes && options->compress_buffer_sizes[x]; x++)
+        if (!cr_compression_options_map_parse(options->compression_options,
+                                              options->compress_buffer_sizes[x],
+                                              CR_CW_OPTION_BUFFER_SIZE, err))
+            return FALSE;
+
     // Zchunk options
     if (options->zck_dict_dir && !options->zck) {
         g_set_error(err, ERR_DOMAIN, CRE_ERROR,
@@ -238,6 +292,7 @@ cmd_options_to_task(GSList **modifyrepotasks,
                                                       options->new_name);
     task->zck = options->zck;
     task->zck_dict_dir = options->zck_dict_dir;
+    task->compression_options = options->compression_options;
 
     *modifyrepotasks = g_slist_append(*modifyrepotasks, task);
 
@@ -332,10 +387,18 @@ main(int argc, char **argv)
         exit(EXIT_FAILURE);
     }
 
+    // Batch file tasks use compression levels and profiles from cmd line
+
+    for (GSList *elem = modifyrepotasks; elem; elem = g_slist_next(elem)) {
+        cr_ModifyRepoTask *task = elem->data;
+        task->compression_options = options.compression_options;
+    }
+
     // Process the tasks
 
     ret = cr_modifyrepo(modifyrepotasks, repodatadir, &err);
     cr_slist_free_full(modifyrepotasks, (GDestroyNotify)cr_modifyrepotask_free);
+    cr_compression_options_map_free(options.compression_options);
 
     if (!ret) {
         g_printerr("%s\n", err->message);
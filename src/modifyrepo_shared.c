@@ -18,6 +18,7 @@
  */
 
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <errno.h>
 #include <string.h>
 #include <assert.h>
@@ -46,6 +47,9 @@ void
 cr_modifyrepotask_free(cr_ModifyRepoTask *task)
 {
     if (!task) return;
+    cr_contentstat_free(task->stat, NULL);
+    cr_contentstat_free(task->zck_stat, NULL);
+    g_clear_error(&task->err);
     g_string_chunk_free(task->chunk);
     g_free(task);
 }
@@ -70,6 +74,14 @@ cr_remove_compression_suffix_if_present(gchar* name, GError **err)
 gchar *
 cr_write_file(gchar *repopath, cr_ModifyRepoTask *task,
            cr_CompressionType compress_type, GError **err)
+{
+    return cr_write_file_with_stat(repopath, task, compress_type, NULL, err);
+}
+
+gchar *
+cr_write_file_with_stat(gchar *repopath, cr_ModifyRepoTask *task,
+                        cr_CompressionType compress_type,
+                        cr_ContentStat *stat, GError **err)
 {
     const gchar *suffix = NULL;
 
@@ -120,8 +132,17 @@ cr_write_file(gchar *repopath, cr_ModifyRepoTask *task,
         g_debug("%s: Copy & compress operation %s -> %s",
                  __func__, src_fn, dst_fn);
 
-        if (cr_compress_file(src_fn, dst_fn, compress_type,
-                             task->zck_dict_dir, TRUE, err) != CRE_OK) {
+        _cleanup_free_ gchar *type = NULL;
+        if (compress_type == CR_CW_ZCK_COMPRESSION)
+            type = g_strconcat(task->type, "_zck", NULL);
+        else
+            type = g_strdup(task->type);
+        cr_CompressionOptions options = cr_compression_options_map_get(
+                                            task->compression_options, type);
+
+        if (cr_compress_file_with_options(src_fn, dst_fn, compress_type,
+                                          stat, &options, task->zck_dict_dir,
+                                          TRUE, err) != CRE_OK) {
             g_debug("%s: Copy & compress operation failed", __func__);
             return NULL;
         }
@@ -129,6 +150,58 @@ cr_write_file(gchar *repopath, cr_ModifyRepoTask *task,
     return dst_fn;
 }
 
+/** Write (copy & compress) metadata of one task, zck variant included.
+ * Runs in a thread pool, errors are stored into the task.
+ */
+static void
+cr_modifyrepo_write_thread(gpointer data, gpointer user_data)
+{
+    cr_ModifyRepoTask *task = data;
+    gchar *repopath = user_data;
+    _cleanup_free_ gchar *dst_fn = NULL;
+    cr_CompressionType compress_type = CR_CW_NO_COMPRESSION;
+
+    if (task->compress)
+        compress_type = task->compress_type;
+
+    // Checksums are computed while the file is written, so filling
+    // the repomd record doesn't have to read the file again
+    if (compress_type != CR_CW_NO_COMPRESSION)
+        task->stat = cr_contentstat_new(task->checksum_type, NULL);
+
+    dst_fn = cr_write_file_with_stat(repopath, task, compress_type,
+                                     task->stat, &task->err);
+    if (dst_fn == NULL)
+        return;
+
+    task->repopath = cr_safe_string_chunk_insert_null(task->chunk, dst_fn);
+#ifdef WITH_ZCHUNK
+    if (task->zck) {
+        g_free(dst_fn);
+        task->zck_stat = cr_contentstat_new(task->checksum_type, NULL);
+        dst_fn = cr_write_file_with_stat(repopath, task, CR_CW_ZCK_COMPRESSION,
+                                         task->zck_stat, &task->err);
+        if (dst_fn == NULL)
+            return;
+        task->zck_repopath = cr_safe_string_chunk_insert_null(task->chunk, dst_fn);
+    }
+#endif
+}
+
+/** Load stats computed while writing into the record (if any).
+ */
+static void
+load_task_stat(cr_RepomdRecord *rec, cr_ContentStat *stat)
+{
+    if (!stat || !stat->checksum)
+        // Nothing was written (the file was already in place)
+        return;
+
+    cr_repomd_record_load_contentstat(rec, stat);
+    if (stat->hdr_checksum)
+        cr_repomd_record_load_zck_contentstat(rec, stat);
+}
+
 gboolean
 cr_modifyrepo(GSList *modifyrepotasks, gchar *repopath, GError **err)
 {
@@ -260,39 +333,32 @@ cr_modifyrepo(GSList *modifyrepotasks, gchar *repopath, GError **err)
     //
 
     // Add (copy) new metadata to repodata/ directory
+    GThreadPool *write_pool = g_thread_pool_new(cr_modifyrepo_write_thread,
+                                                repopath,
+                                                g_get_num_processors(),
+                                                FALSE, NULL);
+
     for (GSList *elem = modifyrepotasks; elem; elem = g_slist_next(elem)) {
         cr_ModifyRepoTask *task = elem->data;
-        _cleanup_free_ gchar *dst_fn = NULL;
 
         if (task->remove)
             // Skip removing task
             continue;
 
-        cr_CompressionType compress_type = CR_CW_NO_COMPRESSION;
+        g_thread_pool_push(write_pool, task, NULL);
+    }
 
-        if (task->compress)
-            compress_type = task->compress_type;
+    g_thread_pool_free(write_pool, FALSE, TRUE); // Wait
 
-        dst_fn = cr_write_file(repopath, task, compress_type, err);
-        if (dst_fn == NULL) {
+    for (GSList *elem = modifyrepotasks; elem; elem = g_slist_next(elem)) {
+        cr_ModifyRepoTask *task = elem->data;
+
+        if (task->err) {
+            g_propagate_error(err, g_steal_pointer(&task->err));
             cr_repomd_free(repomd);
             g_free(repomd_path);
             return FALSE;
         }
-        
-        task->repopath = cr_safe_string_chunk_insert_null(task->chunk, dst_fn);
-#ifdef WITH_ZCHUNK
-        if (task->zck) {
-            free(dst_fn);
-            dst_fn = cr_write_file(repopath, task, CR_CW_ZCK_COMPRESSION, err);
-            if (dst_fn == NULL) {
-                cr_repomd_free(repomd);
-                g_free(repomd_path);
-                return FALSE;
-            }
-            task->zck_repopath = cr_safe_string_chunk_insert_null(task->chunk, dst_fn);
-        }
-#endif
     }
 
     // Prepare new repomd records
@@ -311,6 +377,7 @@ cr_modifyrepo(GSList *modifyrepotasks, gchar *repopath, GError **err)
 
         cr_RepomdRecord *rec = cr_repomd_record_new(task->type,
                                                     task->repopath);
+        load_task_stat(rec, task->stat);
         cr_RepomdRecordFillTask *filltask = cr_repomdrecordfilltask_new(rec,
                                             task->checksum_type, NULL);
         g_thread_pool_push(fill_pool, filltask, NULL);
@@ -324,6 +391,7 @@ cr_modifyrepo(GSList *modifyrepotasks, gchar *repopath, GError **err)
         if (task->zck) {
             _cleanup_free_ gchar *type = g_strconcat(task->type, "_zck", NULL);
             rec = cr_repomd_record_new(type, task->zck_repopath);
+            load_task_stat(rec, task->zck_stat);
             filltask = cr_repomdrecordfilltask_new(rec, task->checksum_type, NULL);
             g_thread_pool_push(fill_pool, filltask, NULL);
 
@@ -394,8 +462,17 @@ cr_modifyrepo(GSList *modifyrepotasks, gchar *repopath, GError **err)
     gchar *repomd_xml = cr_xml_dump_repomd(repomd, NULL);
     g_debug("Generated repomd.xml:\n%s", repomd_xml);
 
+    // Write it next to the original and rename it over, so readers never
+    // see a partially written repomd.xml
     g_debug("%s: Writing modified %s", __func__, repomd_path);
-    gboolean ret = cr_write_to_file(err, repomd_path, "%s", repomd_xml);
+    _cleanup_free_ gchar *tmp_repomd_path = g_strconcat(repomd_path, ".tmp", NULL);
+    gboolean ret = cr_write_to_file(err, tmp_repomd_path, "%s", repomd_xml);
+    if (ret && g_rename(tmp_repomd_path, repomd_path) == -1) {
+        g_set_error(err, ERR_DOMAIN, CRE_IO, "Cannot rename %s to %s: %s",
+                    tmp_repomd_path, repomd_path, g_strerror(errno));
+        remove(tmp_repomd_path);
+        ret = FALSE;
+    }
 
     g_free(repomd_xml);
     g_free(repomd_path);
@@ -49,11 +49,16 @@ typedef struct {
     gchar *new_name;
     gboolean zck;
     gchar *zck_dict_dir;
+    cr_CompressionOptionsMap *compression_options; /*!< Not owned, NULL
+                                                        means defaults */
 
     // Internal use
     gchar *repopath;
     gchar *zck_repopath;
     gchar *dst_fn;
+    cr_ContentStat *stat;       /*!< Stats computed while writing */
+    cr_ContentStat *zck_stat;   /*!< Stats computed while writing zck */
+    GError *err;                /*!< Error of the write */
     GStringChunk *chunk;
 
 } cr_ModifyRepoTask;
@@ -68,6 +73,15 @@ gchar *
 cr_write_file(gchar *repopath, cr_ModifyRepoTask *task,
            cr_CompressionType compress_type, GError **err);
 
+/** Same as cr_write_file(), but the content stats (checksums of the
+ * uncompressed and of the written file) are computed in the same pass.
+ * If the source is already the destination, stat is left untouched.
+ */
+gchar *
+cr_write_file_with_stat(gchar *repopath, cr_ModifyRepoTask *task,
+                        cr_CompressionType compress_type,
+                        cr_ContentStat *stat, GError **err);
+
 gboolean
 cr_modifyrepo(GSList *modifyrepotasks, gchar *repopath, GError **err);
 
@@ -130,6 +130,8 @@ cr_package_free(cr_Package *package)
     g_free(package->siggpg);
     g_free(package->sigpgp);
 
+    cr_package_lazydata_free(package->lazydata);
+
     g_free (package);
 }
 
@@ -239,4 +241,8 @@ cr_package_copy_into(cr_Package *orig, cr_Package *pkg)
         log->changelog = cr_safe_string_chunk_insert(pkg->chunk, orig_log->changelog);
         pkg->changelogs = g_slist_prepend(pkg->changelogs, log);
     }
+
+    // Files and changelogs not loaded yet are loaded by the copy on its own
+    if (!pkg->lazydata)
+        pkg->lazydata = cr_package_lazydata_copy(orig->lazydata);
 }
@@ -72,6 +72,11 @@ typedef struct {
     char *changelog;            /*!< text of changelog */
 } cr_ChangelogEntry;
 
+/** Not yet loaded filelists and changelogs of a package,
+ * see cr_package_load_lazy().
+ */
+typedef struct _cr_PackageLazyData cr_PackageLazyData;
+
 /** Binary data.
  */
 typedef struct {
@@ -139,6 +144,8 @@ typedef struct {
     cr_PackageLoadingFlags loadingflags; /*!<
         Bitfield flags with information about package loading  */
     gboolean skip_dump;         /*!<  Don't dump this package to metadata. */
+    cr_PackageLazyData *lazydata; /*!< NULL or location of files and
+                                     changelogs which are not loaded yet */
 } cr_Package;
 
 /** Create new (empty) dependency structure.
@@ -194,6 +201,23 @@ gchar *cr_package_nevra(cr_Package *package);
  */
 cr_Package *cr_package_copy(cr_Package *package);
 
+/** Load files and changelogs of a package loaded by cr_Metadata in the lazy
+ * mode (see cr_metadata_set_lazy()). Until then, package->files and
+ * package->changelogs are empty. Does nothing if the package has nothing
+ * to load. cr_xml_dump() and cr_db_add_pkg() call it on their own.
+ * @param package       cr_Package
+ * @param err           GError **
+ * @return              cr_Error code
+ */
+int cr_package_load_lazy(cr_Package *package, GError **err);
+
+/** Free files and changelogs loaded by cr_package_load_lazy() and return
+ * the package to the not yet loaded state. They can be loaded again
+ * later. Does nothing if the package wasn't loaded lazily.
+ * @param package       cr_Package
+ */
+void cr_package_unload_lazy(cr_Package *package);
+
 /** @} */
 
 #ifdef __cplusplus
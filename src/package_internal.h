@@ -33,6 +33,79 @@ extern "C" {
  */
 void cr_package_copy_into(cr_Package *source, cr_Package *target);
 
+/** Kind of metadata the files and changelogs are lazily loaded from.
+ */
+typedef enum {
+    CR_LAZY_FILELISTS,      /*!< filelists[_ext].xml - files */
+    CR_LAZY_OTHER,          /*!< other.xml - changelogs */
+    CR_LAZY_SENTINEL,
+} cr_LazyType;
+
+/** Uncompressed metadata file the package elements are read from.
+ * Reference counted, shared by all packages loaded from it.
+ */
+typedef struct _cr_LazySource cr_LazySource;
+
+/** Callback called for every package element found in a lazy source.
+ * @param source        cr_LazySource the element is in
+ * @param pkgId         pkgid attribute of the package
+ * @param offset        offset of the package element in the source
+ * @param length        length of the package element
+ * @param cbdata        user data
+ * @param err           GError **
+ * @return              CR_CB_RET_OK or CR_CB_RET_ERR
+ */
+typedef int (*cr_LazyPackageCb)(cr_LazySource *source,
+                                const char *pkgId,
+                                gint64 offset,
+                                gint64 length,
+                                void *cbdata,
+                                GError **err);
+
+/** Open (and decompress into an unlinked temporary file, if compressed)
+ * filelists or other xml and call pkgcb for every package element in it.
+ * @param path          Path to the (compressed) xml
+ * @param type          What kind of metadata the xml contains
+ * @param pkgcb         Callback for every package element
+ * @param cbdata        User data for the pkgcb
+ * @param err           GError **
+ * @return              New source (with a single reference) or NULL
+ */
+cr_LazySource *cr_lazy_source_new(const char *path,
+                                  cr_LazyType type,
+                                  cr_LazyPackageCb pkgcb,
+                                  void *cbdata,
+                                  GError **err);
+
+/** Drop a reference to the source.
+ * @param source        cr_LazySource
+ */
+void cr_lazy_source_unref(cr_LazySource *source);
+
+/** Remember where the files or changelogs of the package are, they are
+ * loaded by cr_package_load_lazy(). The package takes its own reference
+ * to the source.
+ * @param pkg           cr_Package
+ * @param source        cr_LazySource
+ * @param offset        offset of the package element in the source
+ * @param length        length of the package element
+ */
+void cr_package_set_lazy(cr_Package *pkg,
+                         cr_LazySource *source,
+                         gint64 offset,
+                         gint64 length);
+
+/** Copy of the lazy data (the sources are shared).
+ * @param lazydata      cr_PackageLazyData or NULL
+ * @return              copy or NULL
+ */
+cr_PackageLazyData *cr_package_lazydata_copy(cr_PackageLazyData *lazydata);
+
+/** Free lazy data of a package.
+ * @param lazydata      cr_PackageLazyData or NULL
+ */
+void cr_package_lazydata_free(cr_PackageLazyData *lazydata);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,571 @@
+/* createrepo_c - Library of routines for manipulation with repodata
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include "error.h"
+#include "compression_wrapper.h"
+#include "package_internal.h"
+#include "package.h"
+#include "xml_parser.h"
+
+#define ERR_DOMAIN          CREATEREPO_C_ERROR
+#define READ_SIZE           (128 * 1024)
+#define PACKAGE_START       "<package"
+#define PACKAGE_END         "</package>"
+
+struct _cr_LazySource {
+    gint refcount;
+    int fd;                 /*!< uncompressed xml */
+    cr_LazyType type;
+};
+
+typedef struct {
+    cr_LazySource *source;  /*!< NULL if there is nothing to load */
+    gint64 offset;          /*!< offset of the package element */
+    gint64 length;          /*!< length of the package element */
+} cr_LazyPart;
+
+struct _cr_PackageLazyData {
+    cr_LazyPart parts[CR_LAZY_SENTINEL];
+    gboolean loaded;        /*!< files and changelogs are loaded */
+    GStringChunk *chunk;    /*!< chunk created for the loaded strings
+                                 (owned by the package) or NULL */
+    gboolean single_chunk;  /*!< CR_PACKAGE_SINGLE_CHUNK was set before
+                                 the load */
+};
+
+static cr_LazySource *
+lazy_source_ref(cr_LazySource *source)
+{
+    g_atomic_int_inc(&source->refcount);
+    return source;
+}
+
+void
+cr_lazy_source_unref(cr_LazySource *source)
+{
+    if (!source || !g_atomic_int_dec_and_test(&source->refcount))
+        return;
+
+    close(source->fd);
+    g_free(source);
+}
+
+static gboolean
+write_all(int fd, const char *buf, gsize len, GError **err)
+{
+    while (len > 0) {
+        gssize written = write(fd, buf, len);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            g_set_error(err, ERR_DOMAIN, CRE_IO,
+                        "Cannot write a temporary file: %s",
+                        g_strerror(errno));
+            return FALSE;
+        }
+        buf += written;
+        len -= written;
+    }
+
+    return TRUE;
+}
+
+/** Offset of the first package element in the data since pos or -1.
+ */
+static gssize
+package_start(GString *data, gsize pos)
+{
+    const char *start = data->str + pos;
+    const char *end = data->str + data->len;
+
+    while ((start = g_strstr_len(start, end - start, PACKAGE_START))) {
+        const char *c = start + strlen(PACKAGE_START);
+        if (c >= end)
+            return -1;  // Could be continued in the next read
+        if (*c == ' ' || *c == '\t' || *c == '\r' || *c == '\n' || *c == '>')
+            return start - data->str;
+        start++;
+    }
+
+    return -1;
+}
+
+/** Offset of the '>' which ends the start tag at the offset or -1.
+ */
+static gssize
+start_tag_end(GString *data, gsize offset)
+{
+    char quote = 0;
+
+    for (gsize x = offset; x < data->len; x++) {
+        char c = data->str[x];
+        if (quote) {
+            if (c == quote)
+                quote = 0;
+        } else if (c == '"' || c == '\'') {
+            quote = c;
+        } else if (c == '>') {
+            return x;
+        }
+    }
+
+    return -1;
+}
+
+/** Value of the pkgid attribute of the start tag or NULL.
+ */
+static gchar *
+tag_pkgid(const char *tag, gsize len)
+{
+    const char *end = tag + len;
+    const char *p = tag + strlen(PACKAGE_START);
+
+    while (p < end) {
+        const char *name, *value;
+        gsize name_len;
+        char quote;
+
+        while (p < end && g_ascii_isspace(*p))
+            p++;
+        name = p;
+        while (p < end && *p != '=' && !g_ascii_isspace(*p) && *p != '>')
+            p++;
+        name_len = p - name;
+        while (p < end && g_ascii_isspace(*p))
+            p++;
+        if (p >= end || *p != '=')
+            return NULL;
+        p++;
+        while (p < end && g_ascii_isspace(*p))
+            p++;
+        if (p >= end || (*p != '"' && *p != '\''))
+            return NULL;
+        quote = *p++;
+        value = p;
+        while (p < end && *p != quote)
+            p++;
+        if (p >= end)
+            return NULL;
+        if (name_len == strlen("pkgid") && !strncmp(name, "pkgid", name_len))
+            return g_strndup(value, p - value);
+        p++;
+    }
+
+    return NULL;
+}
+
+/** Track the element depth over the markup between packages. Packages
+ * nested in an unknown element are ignored by the parsers, only the ones
+ * at depth 1 (right in the root element) are indexed.
+ */
+static void
+markup_depth(GString *data, gsize from, gsize to, int *depth)
+{
+    const char *p = data->str + from;
+    const char *end = data->str + to;
+
+    while ((p = memchr(p, '<', end - p))) {
+        if (p + 1 >= end)
+            break;
+        if (p[1] == '!' || p[1] == '?') {
+            // Comment, declaration or processing instruction
+            const char *close = g_strstr_len(p, end - p,
+                                             p[2] == '-' ? "-->" : ">");
+            if (!close)
+                break;
+            p = close + 1;
+        } else if (p[1] == '/') {
+            (*depth)--;
+            p++;
+        } else {
+            gssize tag_end = start_tag_end(data, p - data->str);
+            if (tag_end < 0 || tag_end >= (gssize) to)
+                break;
+            if (data->str[tag_end - 1] != '/')
+                (*depth)++;
+            p = data->str + tag_end + 1;
+        }
+    }
+}
+
+/** Call pkgcb for all complete package elements in the data and drop
+ * everything before the first incomplete one. *base is the offset of
+ * the data in the file, *depth the element depth at its start, err_code
+ * is used for a package without pkgid.
+ */
+static gboolean
+index_packages(cr_LazySource *source,
+               GString *data,
+               gint64 *base,
+               int *depth,
+               int err_code,
+               cr_LazyPackageCb pkgcb,
+               void *cbdata,
+               GError **err)
+{
+    gsize pos = 0, keep;
+
+    while (TRUE) {
+        gssize start = package_start(data, pos);
+        gssize tag_end;
+        gsize end;
+        gchar *pkgid;
+        int ret;
+
+        if (start < 0) {
+            // Keep the markup after the last package, its depth is not
+            // known until the next package start is found
+            keep = pos;
+            break;
+        }
+
+        tag_end = start_tag_end(data, start);
+        if (tag_end < 0) {
+            keep = pos;
+            break;
+        }
+
+        if (data->str[tag_end - 1] == '/') {
+            // <package ... />
+            end = tag_end + 1;
+        } else {
+            const char *pkg_end = g_strstr_len(data->str + tag_end,
+                                               data->len - tag_end,
+                                               PACKAGE_END);
+            if (!pkg_end) {
+                keep = pos;
+                break;
+            }
+            end = pkg_end - data->str + strlen(PACKAGE_END);
+        }
+
+        markup_depth(data, pos, start, depth);
+        pos = end;
+        if (*depth != 1)
+            continue;
+
+        pkgid = tag_pkgid(data->str + start, tag_end - start);
+        if (!pkgid) {
+            g_set_error(err, ERR_DOMAIN, err_code,
+                        "Package pkgid attribute is missing!");
+            return FALSE;
+        }
+
+        ret = pkgcb(source, pkgid, *base + start, end - start, cbdata, err);
+        g_free(pkgid);
+        if (ret != CR_CB_RET_OK) {
+            if (err && !*err)
+                g_set_error(err, ERR_DOMAIN, CRE_CBINTERRUPTED,
+                            "Interrupted by callback");
+            return FALSE;
+        }
+    }
+
+    g_string_erase(data, 0, keep);
+    *base += keep;
+
+    return TRUE;
+}
+
+cr_LazySource *
+cr_lazy_source_new(const char *path,
+                   cr_LazyType type,
+                   cr_LazyPackageCb pkgcb,
+                   void *cbdata,
+                   GError **err)
+{
+    cr_CompressionType compression;
+    cr_LazySource *source;
+    CR_FILE *f;
+    GString *data;
+    gint64 base = 0;
+    int depth = 0;
+    gboolean spool, ok = TRUE;
+    int err_code = (type == CR_LAZY_FILELISTS) ? CRE_BADXMLFILELISTS
+                                               : CRE_BADXMLOTHER;
+    GError *tmp_err = NULL;
+
+    assert(path);
+    assert(type < CR_LAZY_SENTINEL);
+    assert(pkgcb);
+    assert(!err || *err == NULL);
+
+    compression = cr_detect_compression(path, &tmp_err);
+    if (tmp_err) {
+        g_propagate_prefixed_error(err, tmp_err, "Cannot detect compression "
+                                   "of %s: ", path);
+        return NULL;
+    }
+
+    source = g_new0(cr_LazySource, 1);
+    source->refcount = 1;
+    source->type = type;
+
+    // An uncompressed xml is read directly, a compressed one is decompressed
+    // into a temporary file which disappears together with its descriptor
+    spool = compression != CR_CW_NO_COMPRESSION;
+    if (spool) {
+        gchar *tmp_path = NULL;
+        source->fd = g_file_open_tmp("createrepo_c_lazy_XXXXXX", &tmp_path,
+                                     &tmp_err);
+        if (source->fd != -1)
+            g_unlink(tmp_path);
+        g_free(tmp_path);
+    } else {
+        source->fd = g_open(path, O_RDONLY | O_CLOEXEC, 0);
+        if (source->fd == -1)
+            g_set_error(&tmp_err, ERR_DOMAIN, CRE_IO, "%s",
+                        g_strerror(errno));
+    }
+
+    if (source->fd == -1) {
+        g_propagate_prefixed_error(err, tmp_err, "Cannot open %s: ", path);
+        g_free(source);
+        return NULL;
+    }
+
+    f = cr_open(path, CR_CW_MODE_READ, compression, &tmp_err);
+    if (!f) {
+        g_propagate_prefixed_error(err, tmp_err, "Cannot open %s: ", path);
+        cr_lazy_source_unref(source);
+        return NULL;
+    }
+
+    data = g_string_sized_new(2 * READ_SIZE);
+
+    while (TRUE) {
+        gsize len = data->len;
+        int read;
+
+        g_string_set_size(data, len + READ_SIZE);
+        read = cr_read(f, data->str + len, READ_SIZE, &tmp_err);
+        if (tmp_err) {
+            ok = FALSE;
+            g_propagate_prefixed_error(err, tmp_err, "Read error: ");
+            break;
+        }
+        g_string_set_size(data, len + read);
+        if (read == 0)
+            break;
+
+        if (spool && !write_all(source->fd, data->str + len, read, &tmp_err)) {
+            ok = FALSE;
+            g_propagate_error(err, tmp_err);
+            break;
+        }
+
+        if (!index_packages(source, data, &base, &depth, err_code,
+                            pkgcb, cbdata, &tmp_err)) {
+            ok = FALSE;
+            g_propagate_prefixed_error(err, tmp_err, "%s: ", path);
+            break;
+        }
+    }
+
+    g_string_free(data, TRUE);
+
+    if (!ok) {
+        cr_close(f, NULL);
+        cr_lazy_source_unref(source);
+        return NULL;
+    }
+
+    if (cr_close(f, &tmp_err) != CRE_OK) {
+        g_propagate_prefixed_error(err, tmp_err, "Error while closing: ");
+        cr_lazy_source_unref(source);
+        return NULL;
+    }
+
+    return source;
+}
+
+void
+cr_package_set_lazy(cr_Package *pkg,
+                    cr_LazySource *source,
+                    gint64 offset,
+                    gint64 length)
+{
+    cr_LazyPart *part;
+
+    assert(pkg);
+    assert(source);
+
+    if (!pkg->lazydata)
+        pkg->lazydata = g_new0(cr_PackageLazyData, 1);
+
+    part = &pkg->lazydata->parts[source->type];
+    cr_lazy_source_unref(part->source);
+    part->source = lazy_source_ref(source);
+    part->offset = offset;
+    part->length = length;
+}
+
+cr_PackageLazyData *
+cr_package_lazydata_copy(cr_PackageLazyData *lazydata)
+{
+    cr_PackageLazyData *copy;
+
+    if (!lazydata)
+        return NULL;
+
+    copy = g_new(cr_PackageLazyData, 1);
+    *copy = *lazydata;
+    copy->chunk = NULL;
+    for (int x = 0; x < CR_LAZY_SENTINEL; x++)
+        if (copy->parts[x].source)
+            lazy_source_ref(copy->parts[x].source);
+
+    return copy;
+}
+
+void
+cr_package_lazydata_free(cr_PackageLazyData *lazydata)
+{
+    if (!lazydata)
+        return;
+
+    for (int x = 0; x < CR_LAZY_SENTINEL; x++)
+        cr_lazy_source_unref(lazydata->parts[x].source);
+    g_free(lazydata);
+}
+
+static int
+lazy_newpkgcb(cr_Package **pkg,
+              const char *pkgId,
+              G_GNUC_UNUSED const char *name,
+              G_GNUC_UNUSED const char *arch,
+              void *cbdata,
+              G_GNUC_UNUSED GError **err)
+{
+    cr_Package *lazy_pkg = cbdata;
+
+    // The element was paired with the package by its pkgid
+    if (!g_strcmp0(pkgId, lazy_pkg->pkgId))
+        *pkg = lazy_pkg;
+
+    return CR_CB_RET_OK;
+}
+
+static int
+load_part(cr_Package *pkg, cr_LazyPart *part, GError **err)
+{
+    gchar *xml = g_malloc(part->length + 1);
+    gsize done = 0;
+    int ret;
+
+    while (done < (gsize) part->length) {
+        gssize read = pread(part->source->fd, xml + done,
+                            part->length - done, part->offset + done);
+        if (read <= 0) {
+            if (read < 0 && errno == EINTR)
+                continue;
+            g_set_error(err, ERR_DOMAIN, CRE_IO,
+                        "Cannot read metadata of %s: %s", pkg->pkgId,
+                        read < 0 ? g_strerror(errno) : "Unexpected end of file");
+            g_free(xml);
+            return CRE_IO;
+        }
+        done += read;
+    }
+    xml[done] = '\0';
+
+    if (part->source->type == CR_LAZY_FILELISTS)
+        ret = cr_xml_parse_filelists_snippet(xml, lazy_newpkgcb, pkg, NULL,
+                                             NULL, NULL, NULL, err);
+    else
+        ret = cr_xml_parse_other_snippet(xml, lazy_newpkgcb, pkg, NULL,
+                                         NULL, NULL, NULL, err);
+
+    g_free(xml);
+    return ret;
+}
+
+int
+cr_package_load_lazy(cr_Package *pkg, GError **err)
+{
+    assert(pkg);
+    assert(!err || *err == NULL);
+
+    if (!pkg->lazydata || pkg->lazydata->loaded)
+        return CRE_OK;
+
+    if (!pkg->chunk) {
+        // Strings of the package are in a chunk shared by all packages
+        // of a cr_Metadata. Create a per-package chunk for the new ones,
+        // so they can be freed again by cr_package_unload_lazy().
+        pkg->lazydata->single_chunk = !!(pkg->loadingflags
+                                         & CR_PACKAGE_SINGLE_CHUNK);
+        pkg->chunk = g_string_chunk_new(1024);
+        pkg->loadingflags &= ~CR_PACKAGE_SINGLE_CHUNK;
+        pkg->lazydata->chunk = pkg->chunk;
+    }
+
+    for (int x = 0; x < CR_LAZY_SENTINEL; x++) {
+        cr_LazyPart *part = &pkg->lazydata->parts[x];
+        int ret;
+
+        if (!part->source)
+            continue;
+
+        ret = load_part(pkg, part, err);
+        if (ret != CRE_OK)
+            return ret;
+    }
+
+    // Sources are kept, so the package can be unloaded and loaded again
+    pkg->lazydata->loaded = TRUE;
+
+    return CRE_OK;
+}
+
+void
+cr_package_unload_lazy(cr_Package *pkg)
+{
+    assert(pkg);
+
+    if (!pkg->lazydata || !pkg->lazydata->loaded)
+        return;
+
+    if (pkg->lazydata->parts[CR_LAZY_FILELISTS].source) {
+        g_slist_free_full(pkg->files, g_free);
+        pkg->files = NULL;
+    }
+
+    if (pkg->lazydata->parts[CR_LAZY_OTHER].source) {
+        g_slist_free_full(pkg->changelogs, g_free);
+        pkg->changelogs = NULL;
+    }
+
+    // Back to the chunk shared with the other packages
+    if (pkg->lazydata->chunk && pkg->lazydata->chunk == pkg->chunk) {
+        g_string_chunk_free(pkg->chunk);
+        pkg->chunk = NULL;
+        if (pkg->lazydata->single_chunk)
+            pkg->loadingflags |= CR_PACKAGE_SINGLE_CHUNK;
+    }
+    pkg->lazydata->chunk = NULL;
+    pkg->lazydata->loaded = FALSE;
+}
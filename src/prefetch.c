@@ -0,0 +1,275 @@
+/* createrepo_c - Library of routines for manipulation with repodata
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#include <glib.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "cleanup.h"
+#include "prefetch.h"
+
+#define PREFETCH_SLOW_USEC          10000   // Read of a cached header is
+                                            // much faster than 10 ms
+#define PREFETCH_FAST_USEC          1000    // Reads are served from the cache
+#define PREFETCH_ADAPT_INTERVAL     16      // Observations between two
+                                            // changes of the depth
+#define PREFETCH_FALLBACK_MAX_BYTES (256*1024*1024)
+
+typedef struct {
+    gchar *path;
+    long tag;               // Passed to the needed func
+    gint64 size;            // Size of the prefetched file
+    gboolean advised;       // Prefetching was started
+} PrefetchEntry;
+
+struct _cr_Prefetch {
+    GMutex mutex;
+    GArray *entries;        // PrefetchEntry per task (indexed by id)
+    guint min_depth;
+    guint max_depth;
+    guint depth;            // Current size of the window
+    long started;           // The highest started task
+    long next;              // The first task not claimed for prefetching
+    long released;          // Tasks before this were taken by workers
+    gint64 inflight;        // Prefetched bytes not taken by workers yet
+    gint64 max_bytes;       // Limit of the inflight
+    gboolean over_budget;   // The limit stopped prefetching since
+                            // the last change of the depth
+    gint64 avg_usec;        // Moving average of read times
+    guint observed;         // Number of observed reads
+    guint count;            // Number of prefetched files
+    cr_PrefetchNeededFunc needed;
+    void *needed_data;
+};
+
+cr_Prefetch *
+cr_prefetch_new(guint min_depth, guint max_depth)
+{
+    cr_Prefetch *pf = g_new0(cr_Prefetch, 1);
+    long pages = sysconf(_SC_PHYS_PAGES);
+    long page_size = sysconf(_SC_PAGESIZE);
+
+    g_mutex_init(&pf->mutex);
+    pf->entries = g_array_new(FALSE, TRUE, sizeof(PrefetchEntry));
+    pf->min_depth = MAX(1, MIN(min_depth, max_depth));
+    pf->max_depth = MAX(1, max_depth);
+    pf->depth = pf->min_depth;
+    pf->started = -1;
+
+    if (pages > 0 && page_size > 0)
+        pf->max_bytes = (gint64) pages * page_size / 16;
+    else
+        pf->max_bytes = PREFETCH_FALLBACK_MAX_BYTES;
+
+    return pf;
+}
+
+void
+cr_prefetch_add(cr_Prefetch *pf, const char *path, long tag)
+{
+    PrefetchEntry entry = { 0 };
+
+    if (!pf)
+        return;
+
+    assert(path);
+
+    entry.path = g_strdup(path);
+    entry.tag = tag;
+    g_array_append_val(pf->entries, entry);
+}
+
+void
+cr_prefetch_set_needed_func(cr_Prefetch *pf,
+                            cr_PrefetchNeededFunc func,
+                            void *data)
+{
+    assert(pf);
+
+    pf->needed = func;
+    pf->needed_data = data;
+}
+
+void
+cr_prefetch_set_max_bytes(cr_Prefetch *pf, gint64 max_bytes)
+{
+    assert(pf);
+
+    g_mutex_lock(&pf->mutex);
+    pf->max_bytes = max_bytes;
+    g_mutex_unlock(&pf->mutex);
+}
+
+/** Start reading of the file in the background.
+ * @return              Size of the file or -1
+ */
+static gint64
+prefetch_file(const char *path)
+{
+    struct stat st;
+    _cleanup_file_close_ int fd = -1;
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return -1;
+
+    if (fstat(fd, &st) == -1
+        || posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED) != 0)
+        return -1;
+
+    return (gint64) st.st_size;
+}
+
+void
+cr_prefetch_advance(cr_Prefetch *pf, long id)
+{
+    long start, end;
+    cr_PrefetchNeededFunc needed;
+    void *needed_data;
+
+    if (!pf)
+        return;
+
+    g_mutex_lock(&pf->mutex);
+
+    if (id > pf->started)
+        pf->started = id;
+
+    // Files taken by workers don't occupy the budget anymore
+    for (; pf->released <= pf->started && pf->released < (long) pf->entries->len;
+         pf->released++) {
+        PrefetchEntry *entry = &g_array_index(pf->entries, PrefetchEntry,
+                                              pf->released);
+        if (entry->advised)
+            pf->inflight -= entry->size;
+    }
+
+    start = MAX(pf->next, pf->started + 1);
+    end = MIN(pf->started + 1 + (long) pf->depth, (long) pf->entries->len);
+    if (pf->inflight >= pf->max_bytes && end > start) {
+        pf->over_budget = TRUE;
+        end = start;
+    }
+    if (end > start)
+        pf->next = end;
+
+    needed = pf->needed;
+    needed_data = pf->needed_data;
+
+    g_mutex_unlock(&pf->mutex);
+
+    // The claimed range belongs to this thread only, the syscalls
+    // are done without the lock
+    for (long i = start; i < end; i++) {
+        PrefetchEntry *entry = &g_array_index(pf->entries, PrefetchEntry, i);
+        gint64 size;
+
+        if (needed && !needed(entry->path, entry->tag, needed_data))
+            continue;
+
+        size = prefetch_file(entry->path);
+        if (size < 0)
+            continue;
+
+        g_mutex_lock(&pf->mutex);
+        pf->count++;
+        if (i >= pf->released) {
+            entry->advised = TRUE;
+            entry->size = size;
+            pf->inflight += size;
+        }
+        g_mutex_unlock(&pf->mutex);
+    }
+}
+
+void
+cr_prefetch_observe(cr_Prefetch *pf, gint64 usec)
+{
+    if (!pf)
+        return;
+
+    g_mutex_lock(&pf->mutex);
+
+    pf->avg_usec = pf->observed ? (pf->avg_usec * 7 + usec) / 8 : usec;
+    pf->observed++;
+
+    if (pf->observed % PREFETCH_ADAPT_INTERVAL == 0) {
+        guint depth = pf->depth;
+
+        if (pf->over_budget || pf->avg_usec < PREFETCH_FAST_USEC) {
+            // Prefetched packages don't fit into the memory or the reads
+            // are served from the cache anyway - a big window only
+            // pushes other data out of the cache
+            depth = MAX(pf->depth / 2, pf->min_depth);
+        } else if (pf->avg_usec > PREFETCH_SLOW_USEC) {
+            // Reads are still slow - the window doesn't cover the latency
+            depth = MIN(pf->depth * 2, pf->max_depth);
+        }
+        pf->over_budget = FALSE;
+
+        if (depth != pf->depth) {
+            pf->depth = depth;
+            g_debug("%s: Reads take %" G_GINT64_FORMAT " us - prefetching "
+                    "%u packages ahead", __func__, pf->avg_usec, pf->depth);
+        }
+    }
+
+    g_mutex_unlock(&pf->mutex);
+}
+
+guint
+cr_prefetch_get_depth(cr_Prefetch *pf)
+{
+    guint depth;
+
+    assert(pf);
+
+    g_mutex_lock(&pf->mutex);
+    depth = pf->depth;
+    g_mutex_unlock(&pf->mutex);
+    return depth;
+}
+
+guint
+cr_prefetch_get_count(cr_Prefetch *pf)
+{
+    guint count;
+
+    assert(pf);
+
+    g_mutex_lock(&pf->mutex);
+    count = pf->count;
+    g_mutex_unlock(&pf->mutex);
+    return count;
+}
+
+void
+cr_prefetch_free(cr_Prefetch *pf)
+{
+    if (!pf)
+        return;
+
+    for (guint i = 0; i < pf->entries->len; i++)
+        g_free(g_array_index(pf->entries, PrefetchEntry, i).path);
+    g_array_free(pf->entries, TRUE);
+    g_mutex_clear(&pf->mutex);
+    g_free(pf);
+}
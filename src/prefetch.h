@@ -0,0 +1,143 @@
+/* createrepo_c - Library of routines for manipulation with repodata
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#ifndef __C_CREATEREPOLIB_PREFETCH_H__
+#define __C_CREATEREPOLIB_PREFETCH_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <glib.h>
+
+/** \defgroup   prefetch    Readahead of packages ahead of the workers
+ *  \addtogroup prefetch
+ *  @{
+ *
+ * Tasks are registered in the order in which the workers take them.
+ * When a worker starts a task, reading of the following tasks (the
+ * window) is started in the background by posix_fadvise(WILLNEED), so
+ * the workers don't block on cold reads one package after another.
+ *
+ * The window starts as big as the number of workers and doubles while
+ * package reads are still slow (spinning disks, NFS), up to the max depth.
+ * Packages being prefetched (not yet taken by a worker) never take more
+ * than 1/16 of the physical memory, so they are not evicted from
+ * the page cache before they are read. The window is halved, down to
+ * the initial size, when the reads are served from the cache or when
+ * the memory limit stopped prefetching.
+ */
+
+/** Default max number of packages prefetched ahead of the workers.
+ */
+#define CR_PREFETCH_DEFAULT_DEPTH   64
+
+/** Prefetcher of packages.
+ */
+typedef struct _cr_Prefetch cr_Prefetch;
+
+/** Decide if the file will be read by the task (e.g. package which
+ * metadata are reused from the old metadata is not).
+ * @param path          Path to the file
+ * @param tag           Tag of the task given to cr_prefetch_add()
+ * @param data          User data
+ * @return              TRUE if the file should be prefetched
+ */
+typedef gboolean (*cr_PrefetchNeededFunc)(const char *path,
+                                          long tag,
+                                          void *data);
+
+/** Create a new prefetcher.
+ * @param min_depth     Initial size of the window (number of workers)
+ * @param max_depth     Max size of the window
+ * @return              New cr_Prefetch
+ */
+cr_Prefetch *
+cr_prefetch_new(guint min_depth, guint max_depth);
+
+/** Register the next task. Tasks have to be added in the order of their
+ * ids (starting from 0).
+ * @param pf            Prefetcher (if NULL, nothing is done)
+ * @param path          Path to the file
+ * @param tag           Tag passed to the needed func (e.g. ID of the media)
+ */
+void
+cr_prefetch_add(cr_Prefetch *pf, const char *path, long tag);
+
+/** Set the function which decides whether a file is worth prefetching.
+ * @param pf            Prefetcher
+ * @param func          Function or NULL (everything is prefetched)
+ * @param data          User data for the function
+ */
+void
+cr_prefetch_set_needed_func(cr_Prefetch *pf,
+                            cr_PrefetchNeededFunc func,
+                            void *data);
+
+/** Set the limit of bytes being prefetched (1/16 of the physical memory
+ * by default).
+ * @param pf            Prefetcher
+ * @param max_bytes     Max size of files prefetched and not yet taken
+ *                      by the workers
+ */
+void
+cr_prefetch_set_max_bytes(cr_Prefetch *pf, gint64 max_bytes);
+
+/** A worker started the task, start prefetching of the window after it.
+ * Thread safe.
+ * @param pf            Prefetcher (if NULL, nothing is done)
+ * @param id            ID of the task
+ */
+void
+cr_prefetch_advance(cr_Prefetch *pf, long id);
+
+/** Report the time a worker spent reading a package. Thread safe.
+ * @param pf            Prefetcher (if NULL, nothing is done)
+ * @param usec          Time in microseconds
+ */
+void
+cr_prefetch_observe(cr_Prefetch *pf, gint64 usec);
+
+/** Current size of the window.
+ * @param pf            Prefetcher
+ * @return              Number of packages prefetched ahead of the workers
+ */
+guint
+cr_prefetch_get_depth(cr_Prefetch *pf);
+
+/** Number of packages the reading was started for.
+ * @param pf            Prefetcher
+ * @return              Number of prefetched packages
+ */
+guint
+cr_prefetch_get_count(cr_Prefetch *pf);
+
+/** Free the prefetcher.
+ * @param pf            Prefetcher or NULL
+ */
+void
+cr_prefetch_free(cr_Prefetch *pf);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __C_CREATEREPOLIB_PREFETCH_H__ */
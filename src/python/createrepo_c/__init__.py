@@ -70,6 +70,7 @@ HT_KEY_DEFAULT  = _createrepo_c.HT_KEY_DEFAULT  #: Default key (hash)
 HT_KEY_HASH     = _createrepo_c.HT_KEY_HASH     #: Package hash as a key
 HT_KEY_NAME     = _createrepo_c.HT_KEY_NAME     #: Package name as a key
 HT_KEY_FILENAME = _createrepo_c.HT_KEY_FILENAME #: Package filename as a key
+HT_KEY_HREF     = _createrepo_c.HT_KEY_HREF     #: Package location as a key
 
 HT_DUPACT_KEEPFIRST = _createrepo_c.HT_DUPACT_KEEPFIRST #: If an key is duplicated, keep only the first occurrence
 HT_DUPACT_REMOVEALL = _createrepo_c.HT_DUPACT_REMOVEALL #: If an key is duplicated, discard all occurrences
@@ -328,18 +329,32 @@ xml_dump_updaterecord   = _createrepo_c.xml_dump_updaterecord
 xml_dump                = _createrepo_c.xml_dump
 
 def xml_parse_primary(path, newpkgcb=None, pkgcb=None,
-                      warningcb=None, do_files=1):
-    """Parse primary.xml"""
+                      warningcb=None, do_files=1, filter=None):
+    """Parse primary.xml
+
+    filter is a dict with "arch", "name" (globs), "href" and
+    "blocked_srpm" (srpm names) lists, rejected packages are skipped
+    by the parser before the callbacks are called."""
     return _createrepo_c.xml_parse_primary(path, newpkgcb, pkgcb,
-                                           warningcb, do_files)
+                                           warningcb, do_files, filter)
+
+def xml_parse_filelists(path, newpkgcb=None, pkgcb=None, warningcb=None,
+                        filter=None):
+    """Parse filelists[_ext].xml
+
+    See xml_parse_primary() for the filter, only "arch" and "name"
+    are evaluated."""
+    return _createrepo_c.xml_parse_filelists(path, newpkgcb, pkgcb, warningcb,
+                                             filter)
 
-def xml_parse_filelists(path, newpkgcb=None, pkgcb=None, warningcb=None):
-    """Parse filelists[_ext].xml"""
-    return _createrepo_c.xml_parse_filelists(path, newpkgcb, pkgcb, warningcb)
+def xml_parse_other(path, newpkgcb=None, pkgcb=None, warningcb=None,
+                    filter=None):
+    """Parse other.xml
 
-def xml_parse_other(path, newpkgcb=None, pkgcb=None, warningcb=None):
-    """Parse other.xml"""
-    return _createrepo_c.xml_parse_other(path, newpkgcb, pkgcb, warningcb)
+    See xml_parse_primary() for the filter, only "arch" and "name"
+    are evaluated."""
+    return _createrepo_c.xml_parse_other(path, newpkgcb, pkgcb, warningcb,
+                                         filter)
 
 def xml_parse_primary_snippet(xml_string, newpkgcb=None, pkgcb=None,
                               warningcb=None, do_files=1):
@@ -380,6 +395,11 @@ compression_suffix  = _createrepo_c.compression_suffix
 detect_compression  = _createrepo_c.detect_compression
 compression_type    = _createrepo_c.compression_type
 
+def repodiff(old_primary, new_primary, key=HT_KEY_NAME):
+    """Added, removed and changed packages between two primary.xml files.
+    Changed packages are removed and added ones with the same key."""
+    return _createrepo_c.repodiff(old_primary, new_primary, key)
+
 class PackageIterator(_createrepo_c.PkgIterator):
     def __init__(self, primary_path, filelists_path, other_path, newpkgcb=None, warningcb=None):
         """Parse completed packages one at a time."""
@@ -777,3 +797,7 @@ def modifyrepo_c():
 
 def sqliterepo_c():
     raise SystemExit(_program('sqliterepo_c', sys.argv[1:]))
+
+
+def repodiff_c():
+    raise SystemExit(_program('repodiff_c', sys.argv[1:]))
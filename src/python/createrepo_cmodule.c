@@ -31,6 +31,7 @@
 #include "misc-py.h"
 #include "package-py.h"
 #include "parsepkg-py.h"
+#include "repodiff-py.h"
 #include "repomd-py.h"
 #include "repomdrecord-py.h"
 #include "sqlite-py.h"
@@ -95,6 +96,8 @@ static struct PyMethodDef createrepo_c_methods[] = {
         METH_VARARGS, detect_compression__doc__},
     {"compression_type",        (PyCFunction)py_compression_type,
         METH_VARARGS, compression_type__doc__},
+    {"repodiff",                (PyCFunction)py_repodiff,
+        METH_VARARGS, repodiff__doc__},
     {NULL, NULL, 0, NULL} /* sentinel */
 };
 
@@ -280,6 +283,7 @@ PyInit__createrepo_c(void)
     PyModule_AddIntConstant(m, "HT_KEY_HASH", CR_HT_KEY_HASH);
     PyModule_AddIntConstant(m, "HT_KEY_NAME", CR_HT_KEY_NAME);
     PyModule_AddIntConstant(m, "HT_KEY_FILENAME", CR_HT_KEY_FILENAME);
+    PyModule_AddIntConstant(m, "HT_KEY_HREF", CR_HT_KEY_HREF);
 
     /* Load Metadata key dup action */
     PyModule_AddIntConstant(m, "HT_DUPACT_KEEPFIRST", CR_HT_DUPACT_KEEPFIRST);
@@ -0,0 +1,139 @@
+/* createrepo_c - Library of routines for manipulation with repodata
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#include <Python.h>
+#include <assert.h>
+#include <stddef.h>
+
+#include "src/createrepo_c.h"
+
+#include "typeconversion.h"
+#include "exception-py.h"
+#include "repodiff-py.h"
+
+static int
+set_item_str(PyObject *dict, const char *key, const char *value)
+{
+    PyObject *pyvalue = PyUnicodeOrNone_FromString(value);
+    if (!pyvalue)
+        return -1;
+    int ret = PyDict_SetItemString(dict, key, pyvalue);
+    Py_DECREF(pyvalue);
+    return ret;
+}
+
+static PyObject *
+PyObject_FromRepoDiffPackage(cr_RepoDiffPackage *dpkg)
+{
+    PyObject *dict = PyDict_New();
+    if (!dict)
+        return NULL;
+
+    if (set_item_str(dict, "name", dpkg->name)
+        || set_item_str(dict, "arch", dpkg->arch)
+        || set_item_str(dict, "epoch", dpkg->epoch)
+        || set_item_str(dict, "version", dpkg->version)
+        || set_item_str(dict, "release", dpkg->release)
+        || set_item_str(dict, "pkgid", dpkg->pkgId)
+        || set_item_str(dict, "location_href", dpkg->location_href))
+    {
+        Py_DECREF(dict);
+        return NULL;
+    }
+
+    return dict;
+}
+
+static PyObject *
+PyObject_FromRepoDiffItem(cr_RepoDiffItem *item)
+{
+    if (item->type != CR_REPODIFF_CHANGED)
+        return PyObject_FromRepoDiffPackage(item->new_pkg ? item->new_pkg
+                                                          : item->old_pkg);
+
+    PyObject *old_pkg = PyObject_FromRepoDiffPackage(item->old_pkg);
+    PyObject *new_pkg = PyObject_FromRepoDiffPackage(item->new_pkg);
+    PyObject *tuple = NULL;
+
+    if (old_pkg && new_pkg)
+        tuple = PyTuple_Pack(2, old_pkg, new_pkg);
+
+    Py_XDECREF(old_pkg);
+    Py_XDECREF(new_pkg);
+    return tuple;
+}
+
+PyObject *
+py_repodiff(G_GNUC_UNUSED PyObject *self, PyObject *args)
+{
+    int key;
+    char *old_primary, *new_primary;
+    cr_RepoDiff *diff;
+    PyObject *result, *lists[CR_REPODIFF_SENTINEL];
+    GError *tmp_err = NULL;
+
+    if (!PyArg_ParseTuple(args, "ssi:py_repodiff", &old_primary,
+                          &new_primary, &key))
+        return NULL;
+
+    if (key < 0 || key >= CR_HT_KEY_SENTINEL) {
+        PyErr_SetString(PyExc_ValueError, "Unknown hashtable key");
+        return NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    diff = cr_repodiff(old_primary, new_primary, key, &tmp_err);
+    Py_END_ALLOW_THREADS
+    if (tmp_err) {
+        nice_exception(&tmp_err, NULL);
+        return NULL;
+    }
+
+    result = PyDict_New();
+    for (int i = 0; i < CR_REPODIFF_SENTINEL; i++)
+        lists[i] = PyList_New(0);
+
+    for (GSList *elem = diff->items; elem; elem = g_slist_next(elem)) {
+        cr_RepoDiffItem *item = elem->data;
+        PyObject *pyitem = PyObject_FromRepoDiffItem(item);
+        if (!pyitem || PyList_Append(lists[item->type], pyitem) == -1) {
+            Py_XDECREF(pyitem);
+            goto error;
+        }
+        Py_DECREF(pyitem);
+    }
+
+    PyObject *unchanged = PyLong_FromLong(diff->unchanged);
+    PyDict_SetItemString(result, "unchanged", unchanged);
+    Py_DECREF(unchanged);
+    for (int i = 0; i < CR_REPODIFF_SENTINEL; i++) {
+        PyDict_SetItemString(result, cr_repodiff_type_name(i), lists[i]);
+        Py_DECREF(lists[i]);
+    }
+
+    cr_repodiff_free(diff);
+    return result;
+
+error:
+    for (int i = 0; i < CR_REPODIFF_SENTINEL; i++)
+        Py_XDECREF(lists[i]);
+    Py_XDECREF(result);
+    cr_repodiff_free(diff);
+    return NULL;
+}
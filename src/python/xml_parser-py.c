@@ -144,21 +144,94 @@ c_warningcb(cr_XmlParserWarningType type,
     return CR_CB_RET_OK;
 }
 
+/** Convert the filter dict ({"arch": [...], "name": [...], "href": [...],
+ * "blocked_srpm": [...]}) of xml_parse_* functions into a cr_XmlFilter.
+ * @return      FALSE (with an exception set) on error
+ */
+static gboolean
+filter_from_py(PyObject *py_filter, cr_XmlFilter **filter)
+{
+    PyObject *py_key, *py_values;
+    Py_ssize_t pos = 0;
+
+    *filter = NULL;
+    if (!py_filter || py_filter == Py_None)
+        return TRUE;
+
+    if (!PyDict_Check(py_filter)) {
+        PyErr_SetString(PyExc_TypeError, "filter must be a dict or None");
+        return FALSE;
+    }
+
+    *filter = cr_xml_filter_new();
+    while (PyDict_Next(py_filter, &pos, &py_key, &py_values)) {
+        void (*add)(cr_XmlFilter *, const char *) = NULL;
+        const char *key = PyUnicode_Check(py_key) ? PyUnicode_AsUTF8(py_key)
+                                                  : NULL;
+        PyObject *py_iter, *py_value;
+
+        if (!g_strcmp0(key, "arch"))
+            add = cr_xml_filter_add_arch;
+        else if (!g_strcmp0(key, "name"))
+            add = cr_xml_filter_add_name_glob;
+        else if (!g_strcmp0(key, "href"))
+            add = cr_xml_filter_add_href;
+        else if (!g_strcmp0(key, "blocked_srpm"))
+            add = cr_xml_filter_add_blocked_srpm;
+
+        if (!add) {
+            PyErr_Format(PyExc_ValueError, "unknown filter key: %R", py_key);
+            goto error;
+        }
+
+        py_iter = PyObject_GetIter(py_values);
+        if (!py_iter)
+            goto error;
+
+        while ((py_value = PyIter_Next(py_iter))) {
+            const char *value = PyUnicode_Check(py_value)
+                                ? PyUnicode_AsUTF8(py_value) : NULL;
+            if (!value) {
+                if (!PyErr_Occurred())
+                    PyErr_Format(PyExc_TypeError,
+                                 "filter values of %s must be strings", key);
+                Py_DECREF(py_value);
+                Py_DECREF(py_iter);
+                goto error;
+            }
+            add(*filter, value);
+            Py_DECREF(py_value);
+        }
+        Py_DECREF(py_iter);
+        if (PyErr_Occurred())
+            goto error;
+    }
+
+    return TRUE;
+
+error:
+    cr_xml_filter_free(*filter);
+    *filter = NULL;
+    return FALSE;
+}
+
 PyObject *
 py_xml_parse_primary(G_GNUC_UNUSED PyObject *self, PyObject *args)
 {
     char *filename;
     int do_files;
-    PyObject *py_newpkgcb, *py_pkgcb, *py_warningcb;
+    PyObject *py_newpkgcb, *py_pkgcb, *py_warningcb, *py_filter = NULL;
+    cr_XmlFilter *filter;
     CbData cbdata;
     GError *tmp_err = NULL;
 
-    if (!PyArg_ParseTuple(args, "sOOOi:py_xml_parse_primary",
+    if (!PyArg_ParseTuple(args, "sOOOi|O:py_xml_parse_primary",
                                          &filename,
                                          &py_newpkgcb,
                                          &py_pkgcb,
                                          &py_warningcb,
-                                         &do_files)) {
+                                         &do_files,
+                                         &py_filter)) {
         return NULL;
     }
 
@@ -182,6 +255,9 @@ py_xml_parse_primary(G_GNUC_UNUSED PyObject *self, PyObject *args)
         return NULL;
     }
 
+    if (!filter_from_py(py_filter, &filter))
+        return NULL;
+
     Py_XINCREF(py_newpkgcb);
     Py_XINCREF(py_pkgcb);
     Py_XINCREF(py_warningcb);
@@ -202,15 +278,28 @@ py_xml_parse_primary(G_GNUC_UNUSED PyObject *self, PyObject *args)
     cbdata.py_warningcb = py_warningcb;
     cbdata.py_pkgs      = PyDict_New();
 
-    cr_xml_parse_primary(filename,
-                         ptr_c_newpkgcb,
-                         &cbdata,
-                         ptr_c_pkgcb,
-                         &cbdata,
-                         ptr_c_warningcb,
-                         &cbdata,
-                         do_files,
-                         &tmp_err);
+    if (filter)
+        cr_xml_parse_primary_filtered(filename,
+                                      filter,
+                                      ptr_c_newpkgcb,
+                                      &cbdata,
+                                      ptr_c_pkgcb,
+                                      &cbdata,
+                                      ptr_c_warningcb,
+                                      &cbdata,
+                                      do_files,
+                                      &tmp_err);
+    else
+        cr_xml_parse_primary(filename,
+                             ptr_c_newpkgcb,
+                             &cbdata,
+                             ptr_c_pkgcb,
+                             &cbdata,
+                             ptr_c_warningcb,
+                             &cbdata,
+                             do_files,
+                             &tmp_err);
+    cr_xml_filter_free(filter);
 
     Py_XDECREF(py_newpkgcb);
     Py_XDECREF(py_pkgcb);
@@ -304,15 +393,17 @@ PyObject *
 py_xml_parse_filelists(G_GNUC_UNUSED PyObject *self, PyObject *args)
 {
     char *filename;
-    PyObject *py_newpkgcb, *py_pkgcb, *py_warningcb;
+    PyObject *py_newpkgcb, *py_pkgcb, *py_warningcb, *py_filter = NULL;
+    cr_XmlFilter *filter;
     CbData cbdata;
     GError *tmp_err = NULL;
 
-    if (!PyArg_ParseTuple(args, "sOOO:py_xml_parse_filelists",
+    if (!PyArg_ParseTuple(args, "sOOO|O:py_xml_parse_filelists",
                                          &filename,
                                          &py_newpkgcb,
                                          &py_pkgcb,
-                                         &py_warningcb)) {
+                                         &py_warningcb,
+                                         &py_filter)) {
         return NULL;
     }
 
@@ -336,6 +427,9 @@ py_xml_parse_filelists(G_GNUC_UNUSED PyObject *self, PyObject *args)
         return NULL;
     }
 
+    if (!filter_from_py(py_filter, &filter))
+        return NULL;
+
     Py_XINCREF(py_newpkgcb);
     Py_XINCREF(py_pkgcb);
     Py_XINCREF(py_warningcb);
@@ -356,14 +450,26 @@ py_xml_parse_filelists(G_GNUC_UNUSED PyObject *self, PyObject *args)
     cbdata.py_warningcb = py_warningcb;
     cbdata.py_pkgs      = PyDict_New();
 
-    cr_xml_parse_filelists(filename,
-                           ptr_c_newpkgcb,
-                           &cbdata,
-                           ptr_c_pkgcb,
-                           &cbdata,
-                           ptr_c_warningcb,
-                           &cbdata,
-                           &tmp_err);
+    if (filter)
+        cr_xml_parse_filelists_filtered(filename,
+                                        filter,
+                                        ptr_c_newpkgcb,
+                                        &cbdata,
+                                        ptr_c_pkgcb,
+                                        &cbdata,
+                                        ptr_c_warningcb,
+                                        &cbdata,
+                                        &tmp_err);
+    else
+        cr_xml_parse_filelists(filename,
+                               ptr_c_newpkgcb,
+                               &cbdata,
+                               ptr_c_pkgcb,
+                               &cbdata,
+                               ptr_c_warningcb,
+                               &cbdata,
+                               &tmp_err);
+    cr_xml_filter_free(filter);
 
     Py_XDECREF(py_newpkgcb);
     Py_XDECREF(py_pkgcb);
@@ -454,15 +560,17 @@ PyObject *
 py_xml_parse_other(G_GNUC_UNUSED PyObject *self, PyObject *args)
 {
     char *filename;
-    PyObject *py_newpkgcb, *py_pkgcb, *py_warningcb;
+    PyObject *py_newpkgcb, *py_pkgcb, *py_warningcb, *py_filter = NULL;
+    cr_XmlFilter *filter;
     CbData cbdata;
     GError *tmp_err = NULL;
 
-    if (!PyArg_ParseTuple(args, "sOOO:py_xml_parse_other",
+    if (!PyArg_ParseTuple(args, "sOOO|O:py_xml_parse_other",
                                          &filename,
                                          &py_newpkgcb,
                                          &py_pkgcb,
-                                         &py_warningcb)) {
+                                         &py_warningcb,
+                                         &py_filter)) {
         return NULL;
     }
 
@@ -486,6 +594,9 @@ py_xml_parse_other(G_GNUC_UNUSED PyObject *self, PyObject *args)
         return NULL;
     }
 
+    if (!filter_from_py(py_filter, &filter))
+        return NULL;
+
     Py_XINCREF(py_newpkgcb);
     Py_XINCREF(py_pkgcb);
     Py_XINCREF(py_warningcb);
@@ -506,14 +617,26 @@ py_xml_parse_other(G_GNUC_UNUSED PyObject *self, PyObject *args)
     cbdata.py_warningcb = py_warningcb;
     cbdata.py_pkgs      = PyDict_New();
 
-    cr_xml_parse_other(filename,
-                       ptr_c_newpkgcb,
-                       &cbdata,
-                       ptr_c_pkgcb,
-                       &cbdata,
-                       ptr_c_warningcb,
-                       &cbdata,
-                       &tmp_err);
+    if (filter)
+        cr_xml_parse_other_filtered(filename,
+                                    filter,
+                                    ptr_c_newpkgcb,
+                                    &cbdata,
+                                    ptr_c_pkgcb,
+                                    &cbdata,
+                                    ptr_c_warningcb,
+                                    &cbdata,
+                                    &tmp_err);
+    else
+        cr_xml_parse_other(filename,
+                           ptr_c_newpkgcb,
+                           &cbdata,
+                           ptr_c_pkgcb,
+                           &cbdata,
+                           ptr_c_warningcb,
+                           &cbdata,
+                           &tmp_err);
+    cr_xml_filter_free(filter);
 
     Py_XDECREF(py_newpkgcb);
     Py_XDECREF(py_pkgcb);
@@ -868,7 +991,14 @@ pkg_iterator_next_package(PyObject *PyObject_self)
     if (check_PkgIteratorStatus(self)) {
         return NULL;
     }
-    pkg = cr_PkgIterator_parse_next(self->pkg_iterator, &tmp_err);
+    if (self->cbdata->py_newpkgcb == Py_None && self->cbdata->py_warningcb == Py_None) {
+        // No python callbacks, the iterator may wait for its parser threads
+        Py_BEGIN_ALLOW_THREADS
+        pkg = cr_PkgIterator_parse_next(self->pkg_iterator, &tmp_err);
+        Py_END_ALLOW_THREADS
+    } else {
+        pkg = cr_PkgIterator_parse_next(self->pkg_iterator, &tmp_err);
+    }
     if (tmp_err) {
         cr_package_free(pkg);
         nice_exception(&tmp_err, NULL);
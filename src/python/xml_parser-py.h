@@ -23,8 +23,9 @@
 #include "src/createrepo_c.h"
 
 PyDoc_STRVAR(xml_parse_primary__doc__,
-"xml_parse_primary(filename, newpkgcb, pkgcb, warningcb, do_files) -> None\n\n"
-"Parse primary.xml");
+"xml_parse_primary(filename, newpkgcb, pkgcb, warningcb, do_files[, filter]) -> None\n\n"
+"Parse primary.xml, packages rejected by the filter dict (keys: arch, name,\n"
+"href, blocked_srpm) are skipped");
 PyDoc_STRVAR(xml_parse_primary_snippet__doc__,
 "xml_parse_primary_snippet(snippet, newpkgcb, pkgcb, warningcb, do_files) -> None\n\n"
 "Parse primary xml snippet");
@@ -33,8 +34,9 @@ PyObject *py_xml_parse_primary(PyObject *self, PyObject *args);
 PyObject *py_xml_parse_primary_snippet(PyObject *self, PyObject *args);
 
 PyDoc_STRVAR(xml_parse_filelists__doc__,
-"xml_parse_filelists(filename, newpkgcb, pkgcb, warningcb) -> None\n\n"
-"Parse filelists.xml");
+"xml_parse_filelists(filename, newpkgcb, pkgcb, warningcb[, filter]) -> None\n\n"
+"Parse filelists.xml, packages rejected by the filter dict (keys: arch,\n"
+"name) are skipped");
 PyDoc_STRVAR(xml_parse_filelists_snippet__doc__,
 "xml_parse_filelists_snippet(snippet, newpkgcb, pkgcb, warningcb) -> None\n\n"
 "Parse filelists xml snippet");
@@ -53,8 +55,9 @@ PyObject *py_xml_parse_filelists_ext(PyObject *self, PyObject *args);
 PyObject *py_xml_parse_filelists_ext_snippet(PyObject *self, PyObject *args);
 
 PyDoc_STRVAR(xml_parse_other__doc__,
-"xml_parse_other(filename, newpkgcb, pkgcb, warningcb) -> None\n\n"
-"Parse other.xml");
+"xml_parse_other(filename, newpkgcb, pkgcb, warningcb[, filter]) -> None\n\n"
+"Parse other.xml, packages rejected by the filter dict (keys: arch,\n"
+"name) are skipped");
 PyDoc_STRVAR(xml_parse_other_snippet__doc__,
 "xml_parse_other_snippet(snippet, newpkgcb, pkgcb, warningcb) -> None\n\n"
 "Parse other xml snippet");
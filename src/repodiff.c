@@ -0,0 +1,798 @@
+/* createrepo_c - Library of routines for manipulation with repodata
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#include <glib.h>
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include "error.h"
+#include "misc.h"
+#include "package.h"
+#include "repodiff.h"
+#include "xml_parser.h"
+
+#define ERR_DOMAIN      CREATEREPO_C_ERROR
+
+#define NO_STRING       G_MAXUINT32     // Length of a NULL string in a run
+
+/** Summaries of all packages of one primary.xml, sorted by pkgId.
+ * At most max_packages summaries are kept in memory, every full batch
+ * is sorted and written into a temporary file (a run). The runs are
+ * merged afterwards.
+ */
+typedef struct {
+    const char *name;           // Prefix of the run files
+    long max_packages;          // Max size of the batch
+    const char *tmpdir;         // Where to create the dir for runs
+    gchar **rundir;             // Dir for runs (shared by both repos,
+                                // created with the first run)
+    GStringChunk *chunk;        // Strings of the batch
+    GPtrArray *batch;           // cr_RepoDiffPackage not written yet
+    GPtrArray *runs;            // Paths to the runs
+} cr_RepoDiffSorter;
+
+/** Reader of one sorted run (or of the last batch kept in memory).
+ */
+typedef struct {
+    FILE *f;                    // Run file or NULL
+    GPtrArray *batch;           // Batch if f is NULL
+    guint idx;                  // Next package of the batch
+    cr_RepoDiffPackage pkg;     // Current package read from the file
+    cr_RepoDiffPackage *cur;    // Current package or NULL at the end
+} cr_RepoDiffRun;
+
+/** Packages of all runs of one repo merged by pkgId, duplicates skipped.
+ */
+typedef struct {
+    GPtrArray *runs;            // cr_RepoDiffRun
+    const char *path;           // primary.xml (for error messages)
+    gchar *last_pkgid;          // pkgId of the previous package
+} cr_RepoDiffStream;
+
+static cr_RepoDiffPackage *
+repodiff_package_new(GStringChunk *chunk, cr_Package *pkg)
+{
+    cr_RepoDiffPackage *dpkg = g_new0(cr_RepoDiffPackage, 1);
+    dpkg->pkgId         = cr_safe_string_chunk_insert(chunk, pkg->pkgId);
+    dpkg->name          = cr_safe_string_chunk_insert(chunk, pkg->name);
+    dpkg->arch          = cr_safe_string_chunk_insert(chunk, pkg->arch);
+    dpkg->epoch         = cr_safe_string_chunk_insert(chunk, pkg->epoch);
+    dpkg->version       = cr_safe_string_chunk_insert(chunk, pkg->version);
+    dpkg->release       = cr_safe_string_chunk_insert(chunk, pkg->release);
+    dpkg->location_href = cr_safe_string_chunk_insert(chunk, pkg->location_href);
+    return dpkg;
+}
+
+/** Copy the package and its strings into the chunk, e.g. from a run
+ * into the chunk of the diff.
+ */
+static cr_RepoDiffPackage *
+repodiff_package_copy(GStringChunk *chunk, cr_RepoDiffPackage *orig)
+{
+    cr_RepoDiffPackage *dpkg = g_new0(cr_RepoDiffPackage, 1);
+    dpkg->pkgId         = cr_safe_string_chunk_insert(chunk, orig->pkgId);
+    dpkg->name          = cr_safe_string_chunk_insert(chunk, orig->name);
+    dpkg->arch          = cr_safe_string_chunk_insert(chunk, orig->arch);
+    dpkg->epoch         = cr_safe_string_chunk_insert(chunk, orig->epoch);
+    dpkg->version       = cr_safe_string_chunk_insert(chunk, orig->version);
+    dpkg->release       = cr_safe_string_chunk_insert(chunk, orig->release);
+    dpkg->location_href = cr_safe_string_chunk_insert(chunk, orig->location_href);
+    return dpkg;
+}
+
+static gint
+cmp_packages(gconstpointer a_p, gconstpointer b_p)
+{
+    const cr_RepoDiffPackage *a = a_p;
+    const cr_RepoDiffPackage *b = b_p;
+    gint ret;
+
+    if ((ret = g_strcmp0(a->name, b->name)))
+        return ret;
+    if ((ret = g_strcmp0(a->arch, b->arch)))
+        return ret;
+    if ((ret = g_strcmp0(a->epoch, b->epoch)))
+        return ret;
+    if ((ret = g_strcmp0(a->version, b->version)))
+        return ret;
+    if ((ret = g_strcmp0(a->release, b->release)))
+        return ret;
+    return g_strcmp0(a->pkgId, b->pkgId);
+}
+
+/** Order of the runs. Packages with the same pkgId are ordered
+ * by NEVRA, so the same one of the duplicates is always kept.
+ */
+static gint
+cmp_pkgids(gconstpointer a_p, gconstpointer b_p)
+{
+    const cr_RepoDiffPackage *a = *((cr_RepoDiffPackage * const *) a_p);
+    const cr_RepoDiffPackage *b = *((cr_RepoDiffPackage * const *) b_p);
+    gint ret;
+
+    if ((ret = strcmp(a->pkgId, b->pkgId)))
+        return ret;
+    return cmp_packages(a, b);
+}
+
+static void
+repodiff_sorter_init(cr_RepoDiffSorter *sorter,
+                     const char *name,
+                     long max_packages,
+                     const char *tmpdir,
+                     gchar **rundir)
+{
+    sorter->name    = name;
+    sorter->max_packages = max_packages;
+    sorter->tmpdir  = tmpdir;
+    sorter->rundir  = rundir;
+    sorter->chunk   = g_string_chunk_new(16384);
+    sorter->batch   = g_ptr_array_new_with_free_func(g_free);
+    sorter->runs    = g_ptr_array_new_with_free_func(g_free);
+}
+
+static void
+repodiff_sorter_clear(cr_RepoDiffSorter *sorter)
+{
+    g_ptr_array_free(sorter->batch, TRUE);
+    g_ptr_array_free(sorter->runs, TRUE);
+    g_string_chunk_free(sorter->chunk);
+}
+
+static gboolean
+write_string(FILE *f, const char *str)
+{
+    guint32 len = str ? (guint32) strlen(str) : NO_STRING;
+
+    if (fwrite(&len, sizeof(len), 1, f) != 1)
+        return FALSE;
+    return !str || fwrite(str, 1, len, f) == len;
+}
+
+/** Sort the batch, write it into a new run and empty the batch.
+ */
+static gboolean
+repodiff_sorter_flush(cr_RepoDiffSorter *sorter, GError **err)
+{
+    gchar *path;
+    FILE *f;
+    gboolean ok = TRUE;
+
+    if (!*sorter->rundir) {
+        gchar *template = g_build_filename(sorter->tmpdir
+                                                ? sorter->tmpdir
+                                                : g_get_tmp_dir(),
+                                           "repodiff-XXXXXX", NULL);
+        if (!g_mkdtemp(template)) {
+            g_set_error(err, ERR_DOMAIN, CRE_IO,
+                        "Cannot create a temporary directory %s: %s",
+                        template, g_strerror(errno));
+            g_free(template);
+            return FALSE;
+        }
+        *sorter->rundir = template;
+    }
+
+    path = g_strdup_printf("%s/%s-%u", *sorter->rundir, sorter->name,
+                           sorter->runs->len);
+    f = fopen(path, "wb");
+    if (!f) {
+        g_set_error(err, ERR_DOMAIN, CRE_IO, "Cannot open %s: %s",
+                    path, g_strerror(errno));
+        g_free(path);
+        return FALSE;
+    }
+
+    g_ptr_array_sort(sorter->batch, cmp_pkgids);
+    for (guint i = 0; ok && i < sorter->batch->len; i++) {
+        cr_RepoDiffPackage *dpkg = g_ptr_array_index(sorter->batch, i);
+        ok = write_string(f, dpkg->pkgId)
+             && write_string(f, dpkg->name)
+             && write_string(f, dpkg->arch)
+             && write_string(f, dpkg->epoch)
+             && write_string(f, dpkg->version)
+             && write_string(f, dpkg->release)
+             && write_string(f, dpkg->location_href);
+    }
+
+    if (fclose(f) != 0)
+        ok = FALSE;
+
+    if (!ok) {
+        g_set_error(err, ERR_DOMAIN, CRE_IO, "Cannot write %s: %s",
+                    path, g_strerror(errno));
+        g_free(path);
+        return FALSE;
+    }
+
+    g_debug("%s: %u packages sorted into %s", __func__,
+            sorter->batch->len, path);
+    g_ptr_array_add(sorter->runs, path);
+    g_ptr_array_set_size(sorter->batch, 0);
+    g_string_chunk_clear(sorter->chunk);
+    return TRUE;
+}
+
+static int
+pkgcb(cr_Package *pkg, void *cbdata, GError **err)
+{
+    cr_RepoDiffSorter *sorter = cbdata;
+
+    if (pkg->pkgId)
+        g_ptr_array_add(sorter->batch,
+                        repodiff_package_new(sorter->chunk, pkg));
+    cr_package_free(pkg);
+
+    if ((long) sorter->batch->len >= sorter->max_packages
+        && !repodiff_sorter_flush(sorter, err))
+        return CR_CB_RET_ERR;
+
+    return CR_CB_RET_OK;
+}
+
+static gboolean
+read_string(FILE *f, char **str, gboolean *eof)
+{
+    guint32 len;
+
+    *str = NULL;
+    if (fread(&len, sizeof(len), 1, f) != 1) {
+        if (eof)
+            *eof = feof(f) && !ferror(f);
+        return FALSE;
+    }
+    if (len == NO_STRING)
+        return TRUE;
+
+    *str = g_malloc(len + 1);
+    if (fread(*str, 1, len, f) != len) {
+        g_free(*str);
+        *str = NULL;
+        return FALSE;
+    }
+    (*str)[len] = '\0';
+    return TRUE;
+}
+
+static void
+repodiff_run_clear_pkg(cr_RepoDiffRun *run)
+{
+    g_free(run->pkg.pkgId);
+    g_free(run->pkg.name);
+    g_free(run->pkg.arch);
+    g_free(run->pkg.epoch);
+    g_free(run->pkg.version);
+    g_free(run->pkg.release);
+    g_free(run->pkg.location_href);
+    memset(&run->pkg, 0, sizeof(run->pkg));
+}
+
+/** Move the run to its next package.
+ */
+static gboolean
+repodiff_run_next(cr_RepoDiffRun *run, GError **err)
+{
+    gboolean eof = FALSE;
+
+    run->cur = NULL;
+
+    if (!run->f) {
+        if (run->idx < run->batch->len)
+            run->cur = g_ptr_array_index(run->batch, run->idx++);
+        return TRUE;
+    }
+
+    repodiff_run_clear_pkg(run);
+    if (!read_string(run->f, &run->pkg.pkgId, &eof)) {
+        if (eof)
+            return TRUE;
+    } else if (run->pkg.pkgId
+               && read_string(run->f, &run->pkg.name, NULL)
+               && read_string(run->f, &run->pkg.arch, NULL)
+               && read_string(run->f, &run->pkg.epoch, NULL)
+               && read_string(run->f, &run->pkg.version, NULL)
+               && read_string(run->f, &run->pkg.release, NULL)
+               && read_string(run->f, &run->pkg.location_href, NULL))
+    {
+        run->cur = &run->pkg;
+        return TRUE;
+    }
+
+    g_set_error(err, ERR_DOMAIN, CRE_IO,
+                "Cannot read a temporary file of sorted packages");
+    return FALSE;
+}
+
+static void
+repodiff_run_free(cr_RepoDiffRun *run)
+{
+    if (run->f)
+        fclose(run->f);
+    repodiff_run_clear_pkg(run);
+    g_free(run);
+}
+
+/** Open all runs of the sorter. The last batch is not written,
+ * it is read from the memory.
+ */
+static gboolean
+repodiff_stream_open(cr_RepoDiffStream *stream,
+                     cr_RepoDiffSorter *sorter,
+                     const char *path,
+                     GError **err)
+{
+    cr_RepoDiffRun *run;
+
+    stream->runs = g_ptr_array_new_with_free_func(
+                                        (GDestroyNotify) repodiff_run_free);
+    stream->path = path;
+    stream->last_pkgid = NULL;
+
+    for (guint i = 0; i < sorter->runs->len; i++) {
+        const char *run_path = g_ptr_array_index(sorter->runs, i);
+
+        run = g_new0(cr_RepoDiffRun, 1);
+        g_ptr_array_add(stream->runs, run);
+        run->f = fopen(run_path, "rb");
+        if (!run->f) {
+            g_set_error(err, ERR_DOMAIN, CRE_IO, "Cannot open %s: %s",
+                        run_path, g_strerror(errno));
+            return FALSE;
+        }
+        if (!repodiff_run_next(run, err))
+            return FALSE;
+    }
+
+    g_ptr_array_sort(sorter->batch, cmp_pkgids);
+    run = g_new0(cr_RepoDiffRun, 1);
+    run->batch = sorter->batch;
+    repodiff_run_next(run, NULL);
+    g_ptr_array_add(stream->runs, run);
+
+    return TRUE;
+}
+
+static void
+repodiff_stream_clear(cr_RepoDiffStream *stream)
+{
+    if (stream->runs)
+        g_ptr_array_free(stream->runs, TRUE);
+    stream->runs = NULL;
+    g_free(stream->last_pkgid);
+    stream->last_pkgid = NULL;
+}
+
+/** Current package with the lowest pkgId, without duplicates of
+ * the previously returned one.
+ * @return      Package (valid until the next call) or NULL at the end
+ *              or on error
+ */
+static cr_RepoDiffRun *
+repodiff_stream_peek(cr_RepoDiffStream *stream, GError **err)
+{
+    while (TRUE) {
+        cr_RepoDiffRun *min = NULL;
+
+        for (guint i = 0; i < stream->runs->len; i++) {
+            cr_RepoDiffRun *run = g_ptr_array_index(stream->runs, i);
+            if (run->cur && (!min || cmp_pkgids(&run->cur, &min->cur) < 0))
+                min = run;
+        }
+
+        if (!min || g_strcmp0(min->cur->pkgId, stream->last_pkgid))
+            return min;
+
+        // Duplicated pkgIds are reported only once
+        if (!repodiff_run_next(min, err)) {
+            g_prefix_error(err, "%s: ", stream->path);
+            return NULL;
+        }
+    }
+}
+
+static gboolean
+repodiff_stream_pop(cr_RepoDiffStream *stream,
+                    cr_RepoDiffRun *run,
+                    GError **err)
+{
+    g_free(stream->last_pkgid);
+    stream->last_pkgid = g_strdup(run->cur->pkgId);
+    if (!repodiff_run_next(run, err)) {
+        g_prefix_error(err, "%s: ", stream->path);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/** Key used to pair packages which are not in both repos.
+ * @return      Newly allocated string or NULL if the packages
+ *              shouldn't be paired
+ */
+static gchar *
+pair_key(cr_RepoDiffPackage *dpkg, cr_HashTableKey key)
+{
+    switch (key) {
+        case CR_HT_KEY_NAME:
+            // Packages of different archs are different packages
+            return g_strconcat(dpkg->name ? dpkg->name : "", ".",
+                               dpkg->arch ? dpkg->arch : "", NULL);
+        case CR_HT_KEY_FILENAME:
+            return g_strdup(cr_get_filename(dpkg->location_href));
+        case CR_HT_KEY_HREF:
+            return g_strdup(cr_get_cleaned_href(dpkg->location_href));
+        default:
+            return NULL;
+    }
+}
+
+static gint
+cmp_items(gconstpointer a_p, gconstpointer b_p)
+{
+    const cr_RepoDiffItem *a = a_p;
+    const cr_RepoDiffItem *b = b_p;
+
+    if (a->type != b->type)
+        return a->type < b->type ? -1 : 1;
+
+    return cmp_packages(a->new_pkg ? a->new_pkg : a->old_pkg,
+                        b->new_pkg ? b->new_pkg : b->old_pkg);
+}
+
+static cr_RepoDiffItem *
+repodiff_item_new(cr_RepoDiffType type,
+                  cr_RepoDiffPackage *old_pkg,
+                  cr_RepoDiffPackage *new_pkg)
+{
+    cr_RepoDiffItem *item = g_new0(cr_RepoDiffItem, 1);
+    item->type    = type;
+    item->old_pkg = old_pkg;
+    item->new_pkg = new_pkg;
+    return item;
+}
+
+static void
+repodiff_item_free(cr_RepoDiffItem *item)
+{
+    g_free(item->old_pkg);
+    g_free(item->new_pkg);
+    g_free(item);
+}
+
+/** Pair the removed packages with the added ones and build the list
+ * of changes. Takes the ownership of the packages.
+ */
+static GSList *
+repodiff_items(GSList *removed, GSList *added, cr_HashTableKey key)
+{
+    GSList *items = NULL;
+    GHashTable *paired = g_hash_table_new(g_direct_hash, g_direct_equal);
+    GHashTable *by_key = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                               g_free,
+                                               (GDestroyNotify) g_queue_free);
+
+    // Deterministic pairing if more packages have the same key
+    removed = g_slist_sort(removed, cmp_packages);
+    added = g_slist_sort(added, cmp_packages);
+
+    for (GSList *elem = removed; elem; elem = g_slist_next(elem)) {
+        gchar *k = pair_key(elem->data, key);
+        if (!k)
+            continue;
+
+        GQueue *queue = g_hash_table_lookup(by_key, k);
+        if (!queue) {
+            queue = g_queue_new();
+            g_hash_table_insert(by_key, k, queue);
+        } else {
+            g_free(k);
+        }
+        g_queue_push_tail(queue, elem->data);
+    }
+
+    for (GSList *elem = added; elem; elem = g_slist_next(elem)) {
+        cr_RepoDiffPackage *new_pkg = elem->data;
+        cr_RepoDiffPackage *old_pkg = NULL;
+        gchar *k = pair_key(new_pkg, key);
+
+        if (k) {
+            GQueue *queue = g_hash_table_lookup(by_key, k);
+            if (queue)
+                old_pkg = g_queue_pop_head(queue);
+            g_free(k);
+        }
+
+        if (old_pkg) {
+            g_hash_table_add(paired, old_pkg);
+            items = g_slist_prepend(items,
+                        repodiff_item_new(CR_REPODIFF_CHANGED, old_pkg, new_pkg));
+        } else {
+            items = g_slist_prepend(items,
+                        repodiff_item_new(CR_REPODIFF_ADDED, NULL, new_pkg));
+        }
+    }
+
+    // Whatever is left in the old repo was removed
+    for (GSList *elem = removed; elem; elem = g_slist_next(elem)) {
+        cr_RepoDiffPackage *old_pkg = elem->data;
+        if (!g_hash_table_contains(paired, old_pkg))
+            items = g_slist_prepend(items,
+                        repodiff_item_new(CR_REPODIFF_REMOVED, old_pkg, NULL));
+    }
+
+    g_slist_free(removed);
+    g_slist_free(added);
+    g_hash_table_destroy(by_key);
+    g_hash_table_destroy(paired);
+
+    return g_slist_sort(items, cmp_items);
+}
+
+/** Merge the sorted packages of both repos.
+ */
+static gboolean
+repodiff_merge(cr_RepoDiff *diff,
+               cr_RepoDiffStream *old_stream,
+               cr_RepoDiffStream *new_stream,
+               GSList **removed,
+               GSList **added,
+               GError **err)
+{
+    GError *tmp_err = NULL;
+
+    while (TRUE) {
+        cr_RepoDiffRun *old_run = repodiff_stream_peek(old_stream, &tmp_err);
+        if (tmp_err)
+            break;
+        cr_RepoDiffRun *new_run = repodiff_stream_peek(new_stream, &tmp_err);
+        if (tmp_err)
+            break;
+
+        if (!old_run && !new_run)
+            return TRUE;
+
+        int cmp;
+        if (!old_run)
+            cmp = 1;
+        else if (!new_run)
+            cmp = -1;
+        else
+            cmp = strcmp(old_run->cur->pkgId, new_run->cur->pkgId);
+
+        if (cmp == 0) {
+            // The same package is in both repos
+            diff->unchanged++;
+        } else if (cmp < 0) {
+            *removed = g_slist_prepend(*removed,
+                    repodiff_package_copy(diff->chunk, old_run->cur));
+        } else {
+            *added = g_slist_prepend(*added,
+                    repodiff_package_copy(diff->chunk, new_run->cur));
+        }
+
+        if (cmp <= 0 && !repodiff_stream_pop(old_stream, old_run, &tmp_err))
+            break;
+        if (cmp >= 0 && !repodiff_stream_pop(new_stream, new_run, &tmp_err))
+            break;
+    }
+
+    g_propagate_error(err, tmp_err);
+    return FALSE;
+}
+
+cr_RepoDiff *
+cr_repodiff(const char *old_primary,
+            const char *new_primary,
+            cr_HashTableKey key,
+            GError **err)
+{
+    return cr_repodiff_with_limit(old_primary, new_primary, key,
+                                  CR_REPODIFF_MAX_PACKAGES, NULL, err);
+}
+
+cr_RepoDiff *
+cr_repodiff_with_limit(const char *old_primary,
+                       const char *new_primary,
+                       cr_HashTableKey key,
+                       long max_packages,
+                       const char *tmpdir,
+                       GError **err)
+{
+    int ret;
+    GError *tmp_err = NULL;
+    cr_RepoDiff *diff = NULL;
+    gchar *rundir = NULL;
+    cr_RepoDiffSorter old_sorter, new_sorter;
+    cr_RepoDiffStream old_stream = { NULL, NULL, NULL };
+    cr_RepoDiffStream new_stream = { NULL, NULL, NULL };
+    GSList *removed = NULL, *added = NULL;
+
+    assert(old_primary);
+    assert(new_primary);
+    assert(!err || *err == NULL);
+
+    if (key >= CR_HT_KEY_SENTINEL) {
+        g_set_error(err, ERR_DOMAIN, CRE_BADARG, "Bad key type: %d", key);
+        return NULL;
+    }
+
+    if (max_packages < 1) {
+        g_set_error(err, ERR_DOMAIN, CRE_BADARG,
+                    "Bad max number of packages: %ld", max_packages);
+        return NULL;
+    }
+
+    repodiff_sorter_init(&old_sorter, "old", max_packages, tmpdir, &rundir);
+    repodiff_sorter_init(&new_sorter, "new", max_packages, tmpdir, &rundir);
+
+    ret = cr_xml_parse_primary(old_primary, NULL, NULL, pkgcb, &old_sorter,
+                               NULL, NULL, FALSE, &tmp_err);
+    if (ret != CRE_OK) {
+        g_propagate_prefixed_error(err, tmp_err, "Cannot parse %s: ",
+                                   old_primary);
+        goto cleanup;
+    }
+
+    ret = cr_xml_parse_primary(new_primary, NULL, NULL, pkgcb, &new_sorter,
+                               NULL, NULL, FALSE, &tmp_err);
+    if (ret != CRE_OK) {
+        g_propagate_prefixed_error(err, tmp_err, "Cannot parse %s: ",
+                                   new_primary);
+        goto cleanup;
+    }
+
+    if (!repodiff_stream_open(&old_stream, &old_sorter, old_primary, err)
+        || !repodiff_stream_open(&new_stream, &new_sorter, new_primary, err))
+        goto cleanup;
+
+    diff = g_new0(cr_RepoDiff, 1);
+    diff->chunk = g_string_chunk_new(16384);
+
+    if (!repodiff_merge(diff, &old_stream, &new_stream,
+                        &removed, &added, err))
+    {
+        g_slist_free_full(removed, g_free);
+        g_slist_free_full(added, g_free);
+        cr_repodiff_free(diff);
+        diff = NULL;
+        goto cleanup;
+    }
+
+    diff->items = repodiff_items(removed, added, key);
+
+cleanup:
+    repodiff_stream_clear(&old_stream);
+    repodiff_stream_clear(&new_stream);
+    repodiff_sorter_clear(&old_sorter);
+    repodiff_sorter_clear(&new_sorter);
+    if (rundir) {
+        cr_remove_dir(rundir, NULL);
+        g_free(rundir);
+    }
+
+    return diff;
+}
+
+const char *
+cr_repodiff_type_name(cr_RepoDiffType type)
+{
+    switch (type) {
+        case CR_REPODIFF_ADDED:     return "added";
+        case CR_REPODIFF_REMOVED:   return "removed";
+        case CR_REPODIFF_CHANGED:   return "changed";
+        default:                    return NULL;
+    }
+}
+
+static void
+append_json_string(GString *json, const char *str)
+{
+    if (!str) {
+        g_string_append(json, "null");
+        return;
+    }
+
+    g_string_append_c(json, '"');
+    for (const char *c = str; *c; c++) {
+        switch (*c) {
+            case '"':   g_string_append(json, "\\\""); break;
+            case '\\':  g_string_append(json, "\\\\"); break;
+            case '\n':  g_string_append(json, "\\n"); break;
+            case '\t':  g_string_append(json, "\\t"); break;
+            default:
+                if ((unsigned char) *c < 0x20)
+                    g_string_append_printf(json, "\\u%04x", (unsigned char) *c);
+                else
+                    g_string_append_c(json, *c);
+        }
+    }
+    g_string_append_c(json, '"');
+}
+
+static void
+append_json_package(GString *json, cr_RepoDiffPackage *dpkg)
+{
+    g_string_append(json, "{\"name\": ");
+    append_json_string(json, dpkg->name);
+    g_string_append(json, ", \"arch\": ");
+    append_json_string(json, dpkg->arch);
+    g_string_append(json, ", \"epoch\": ");
+    append_json_string(json, dpkg->epoch);
+    g_string_append(json, ", \"version\": ");
+    append_json_string(json, dpkg->version);
+    g_string_append(json, ", \"release\": ");
+    append_json_string(json, dpkg->release);
+    g_string_append(json, ", \"pkgid\": ");
+    append_json_string(json, dpkg->pkgId);
+    g_string_append(json, ", \"location_href\": ");
+    append_json_string(json, dpkg->location_href);
+    g_string_append_c(json, '}');
+}
+
+gchar *
+cr_repodiff_to_json(cr_RepoDiff *diff)
+{
+    GString *json;
+
+    assert(diff);
+
+    json = g_string_new("{\n");
+    g_string_append_printf(json, "  \"unchanged\": %ld", diff->unchanged);
+
+    for (cr_RepoDiffType type = 0; type < CR_REPODIFF_SENTINEL; type++) {
+        gboolean first = TRUE;
+
+        g_string_append_printf(json, ",\n  \"%s\": [",
+                               cr_repodiff_type_name(type));
+        for (GSList *elem = diff->items; elem; elem = g_slist_next(elem)) {
+            cr_RepoDiffItem *item = elem->data;
+            if (item->type != type)
+                continue;
+
+            g_string_append(json, first ? "\n    " : ",\n    ");
+            if (type == CR_REPODIFF_CHANGED) {
+                g_string_append(json, "{\"old\": ");
+                append_json_package(json, item->old_pkg);
+                g_string_append(json, ", \"new\": ");
+                append_json_package(json, item->new_pkg);
+                g_string_append_c(json, '}');
+            } else {
+                append_json_package(json, item->new_pkg ? item->new_pkg
+                                                        : item->old_pkg);
+            }
+            first = FALSE;
+        }
+        g_string_append(json, first ? "]" : "\n  ]");
+    }
+
+    g_string_append(json, "\n}\n");
+    return g_string_free(json, FALSE);
+}
+
+void
+cr_repodiff_free(cr_RepoDiff *diff)
+{
+    if (!diff)
+        return;
+
+    g_slist_free_full(diff->items, (GDestroyNotify) repodiff_item_free);
+    if (diff->chunk)
+        g_string_chunk_free(diff->chunk);
+    g_free(diff);
+}
@@ -0,0 +1,156 @@
+/* createrepo_c - Library of routines for manipulation with repodata
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#ifndef __C_CREATEREPOLIB_REPODIFF_H__
+#define __C_CREATEREPOLIB_REPODIFF_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <glib.h>
+#include "load_metadata.h"
+
+/** \defgroup   repodiff    Differences between two repodata
+ *  \addtogroup repodiff
+ *  @{
+ *
+ * Both primary.xml files are streamed by the primary xml parser and
+ * only a small summary (NEVRA, pkgId and location) of each package
+ * is kept, the input files don't have to be sorted. At most
+ * max_packages summaries of each repo are kept in memory, every full
+ * batch is sorted by pkgId and written into a temporary file. The sorted
+ * files of both repos are then merged. Only the changed packages are
+ * kept in memory for the returned changeset.
+ *
+ * Packages with the same pkgId are unchanged. The rest is paired by
+ * the selected cr_HashTableKey:
+ *  - CR_HT_KEY_HASH        - no pairing, only added and removed packages
+ *  - CR_HT_KEY_NAME        - packages with the same name and arch
+ *  - CR_HT_KEY_FILENAME    - packages with the same filename
+ *  - CR_HT_KEY_HREF        - packages with the same location_href
+ *
+ * A paired couple is reported as changed.
+ */
+
+/** Type of a change.
+ */
+typedef enum {
+    CR_REPODIFF_ADDED,          /*!< Package is only in the new repo */
+    CR_REPODIFF_REMOVED,        /*!< Package is only in the old repo */
+    CR_REPODIFF_CHANGED,        /*!< Package was replaced by another one */
+    CR_REPODIFF_SENTINEL,       /*!< last element, terminator, .. */
+} cr_RepoDiffType;
+
+/** Summary of a package.
+ */
+typedef struct {
+    char *pkgId;                /*!< checksum of the package */
+    char *name;                 /*!< name */
+    char *arch;                 /*!< architecture */
+    char *epoch;                /*!< epoch */
+    char *version;              /*!< version */
+    char *release;              /*!< release */
+    char *location_href;        /*!< location of the package */
+} cr_RepoDiffPackage;
+
+/** One change.
+ */
+typedef struct {
+    cr_RepoDiffType type;       /*!< type of the change */
+    cr_RepoDiffPackage *old_pkg;/*!< package from the old repo or NULL
+                                     if added */
+    cr_RepoDiffPackage *new_pkg;/*!< package from the new repo or NULL
+                                     if removed */
+} cr_RepoDiffItem;
+
+/** Changeset between two repos.
+ */
+typedef struct {
+    GSList *items;              /*!< list of cr_RepoDiffItem sorted by
+                                     type and NEVRA */
+    long unchanged;             /*!< number of unchanged packages */
+    GStringChunk *chunk;        /*!< string chunk */
+} cr_RepoDiff;
+
+/** Compute differences between two primary.xml files.
+ * @param old_primary   Path to the old primary.xml (may be compressed)
+ * @param new_primary   Path to the new primary.xml (may be compressed)
+ * @param key           Key used to pair changed packages
+ * @param err           GError **
+ * @return              cr_RepoDiff or NULL on error
+ */
+cr_RepoDiff *
+cr_repodiff(const char *old_primary,
+            const char *new_primary,
+            cr_HashTableKey key,
+            GError **err);
+
+/** Default number of package summaries of one repo kept in memory
+ * by cr_repodiff().
+ */
+#define CR_REPODIFF_MAX_PACKAGES    100000
+
+/** Compute differences between two primary.xml files. Like cr_repodiff(),
+ * but with a custom memory limit.
+ * @param old_primary   Path to the old primary.xml (may be compressed)
+ * @param new_primary   Path to the new primary.xml (may be compressed)
+ * @param key           Key used to pair changed packages
+ * @param max_packages  Max number of package summaries of one repo kept
+ *                      in memory, the rest is sorted in temporary files
+ * @param tmpdir        Directory for the temporary files or NULL for
+ *                      the default temporary directory
+ * @param err           GError **
+ * @return              cr_RepoDiff or NULL on error
+ */
+cr_RepoDiff *
+cr_repodiff_with_limit(const char *old_primary,
+                       const char *new_primary,
+                       cr_HashTableKey key,
+                       long max_packages,
+                       const char *tmpdir,
+                       GError **err);
+
+/** Name of a type of change ("added", "removed", "changed").
+ * @param type          Type of change
+ * @return              Constant string or NULL for unknown type
+ */
+const char *
+cr_repodiff_type_name(cr_RepoDiffType type);
+
+/** JSON representation of the changeset.
+ * @param diff          cr_RepoDiff
+ * @return              Newly allocated string
+ */
+gchar *
+cr_repodiff_to_json(cr_RepoDiff *diff);
+
+/** Free the changeset.
+ * @param diff          cr_RepoDiff or NULL
+ */
+void
+cr_repodiff_free(cr_RepoDiff *diff);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __C_CREATEREPOLIB_REPODIFF_H__ */
@@ -0,0 +1,270 @@
+/* createrepo_c - Library of routines for manipulation with repodata
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "error.h"
+#include "cleanup.h"
+#include "compression_wrapper.h"
+#include "version.h"
+#include "createrepo_shared.h"
+#include "locate_metadata.h"
+#include "repodiff.h"
+
+/**
+ * Command line options
+ */
+typedef struct {
+
+    /* Items filled by cmd option parser */
+
+    gboolean version;           /*!< print program version */
+    gboolean quiet;             /*!< quiet mode */
+    gboolean verbose;           /*!< verbose mode */
+    gchar *key_str;             /*!< key used to pair changed packages */
+    gchar *output;              /*!< output file (stdout by default) */
+    gint64 max_packages;        /*!< packages of a repo kept in memory */
+    gchar *tmpdir;              /*!< dir for temporary files */
+
+    /* Items filled by check_arguments() */
+
+    cr_HashTableKey key;        /*!< key used to pair changed packages */
+
+} RepodiffCmdOptions;
+
+static void
+repodiffcmdoptions_free(RepodiffCmdOptions *options)
+{
+    g_free(options->key_str);
+    g_free(options->output);
+    g_free(options->tmpdir);
+    g_free(options);
+}
+
+CR_DEFINE_CLEANUP_FUNCTION0(RepodiffCmdOptions*, cr_local_repodiffcmdoptions_free, repodiffcmdoptions_free)
+#define _cleanup_repodiffcmdoptions_free_ __attribute__ ((cleanup(cr_local_repodiffcmdoptions_free)))
+
+/**
+ * Parse commandline arguments for repodiff utility
+ */
+static gboolean
+parse_repodiff_arguments(int *argc,
+                         char ***argv,
+                         RepodiffCmdOptions *options,
+                         GError **err)
+{
+    const GOptionEntry cmd_entries[] = {
+
+        { "version", 'V', 0, G_OPTION_ARG_NONE, &(options->version),
+          "Show program's version number and exit.", NULL},
+        { "quiet", 'q', 0, G_OPTION_ARG_NONE, &(options->quiet),
+          "Run quietly.", NULL },
+        { "verbose", 'v', 0, G_OPTION_ARG_NONE, &(options->verbose),
+          "Run verbosely.", NULL },
+        { "key", 'k', 0, G_OPTION_ARG_STRING, &(options->key_str),
+          "Attribute used to pair a removed and an added package into "
+          "a changed one (name, filename, href or hash). Name pairs packages "
+          "with the same name and arch, hash reports only added and removed "
+          "packages. Default is name.", "<key>" },
+        { "output", 'o', 0, G_OPTION_ARG_FILENAME, &(options->output),
+          "Write the changeset into the file instead of stdout.", "<file>" },
+        { "max-packages", 0, 0, G_OPTION_ARG_INT64, &(options->max_packages),
+          "Max number of packages of a repo kept in memory. More packages "
+          "are sorted in temporary files. Default is 100000.", "<num>" },
+        { "tmpdir", 0, 0, G_OPTION_ARG_FILENAME, &(options->tmpdir),
+          "Directory for the temporary files. Default is the system "
+          "temporary directory.", "<dir>" },
+        { NULL, 0, 0, G_OPTION_ARG_NONE, NULL, NULL, NULL },
+    };
+
+    // Parse cmd arguments
+    GOptionContext *context;
+    context = g_option_context_new("<old_repo> <new_repo>");
+    g_option_context_set_summary(context, "Compute added, removed and changed "
+            "packages between two repodata. A repo is a directory with "
+            "repodata or a path to its primary.xml. The changeset is "
+            "written in JSON.");
+    g_option_context_add_main_entries(context, cmd_entries, NULL);
+    gboolean ret = g_option_context_parse(context, argc, argv, err);
+    g_option_context_free(context);
+    return ret;
+}
+
+/**
+ * Check parsed arguments and fill some other attributes
+ * of option struct accordingly.
+ */
+static gboolean
+check_arguments(RepodiffCmdOptions *options, GError **err)
+{
+    // --key
+    options->key = CR_HT_KEY_NAME;
+    if (options->key_str) {
+        if (!g_strcmp0(options->key_str, "name"))
+            options->key = CR_HT_KEY_NAME;
+        else if (!g_strcmp0(options->key_str, "filename"))
+            options->key = CR_HT_KEY_FILENAME;
+        else if (!g_strcmp0(options->key_str, "href"))
+            options->key = CR_HT_KEY_HREF;
+        else if (!g_strcmp0(options->key_str, "hash"))
+            options->key = CR_HT_KEY_HASH;
+        else {
+            g_set_error(err, CREATEREPO_C_ERROR, CRE_BADARG,
+                        "Unknown key \"%s\"", options->key_str);
+            return FALSE;
+        }
+    }
+
+    // --max-packages
+    if (options->max_packages == 0) {
+        options->max_packages = CR_REPODIFF_MAX_PACKAGES;
+    } else if (options->max_packages < 0 || options->max_packages > G_MAXLONG) {
+        g_set_error(err, CREATEREPO_C_ERROR, CRE_BADARG,
+                    "Bad --max-packages %" G_GINT64_FORMAT,
+                    options->max_packages);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ * Path to the primary.xml of a repo (a repo dir or the primary.xml itself).
+ * The location of a remote repo is kept in *ml, its downloaded files are
+ * removed by cr_metadatalocation_free().
+ */
+static const char *
+primary_path(const char *repo,
+             struct cr_MetadataLocation **ml,
+             GError **err)
+{
+    GError *tmp_err = NULL;
+
+    *ml = NULL;
+
+    if (g_file_test(repo, G_FILE_TEST_IS_REGULAR))
+        return repo;
+
+    *ml = cr_locate_metadata_mask(repo, TRUE, CR_MD_PRIMARY, &tmp_err);
+    if (!*ml) {
+        if (tmp_err)
+            g_propagate_prefixed_error(err, tmp_err,
+                                       "Cannot locate repodata in %s: ", repo);
+        else
+            g_set_error(err, CREATEREPO_C_ERROR, CRE_NOFILE,
+                        "Cannot locate repodata in %s", repo);
+        return NULL;
+    }
+
+    if (!(*ml)->pri_xml_href) {
+        g_set_error(err, CREATEREPO_C_ERROR, CRE_NOFILE,
+                    "Repo %s has no primary metadata", repo);
+        return NULL;
+    }
+
+    cr_metadatalocation_register_zstd_dicts(*ml);
+
+    return (*ml)->pri_xml_href;
+}
+
+int
+main(int argc, char **argv)
+{
+    int ret = EXIT_FAILURE;
+    _cleanup_repodiffcmdoptions_free_ RepodiffCmdOptions *options = NULL;
+    _cleanup_error_free_ GError *tmp_err = NULL;
+    struct cr_MetadataLocation *old_ml = NULL;
+    struct cr_MetadataLocation *new_ml = NULL;
+    const char *old_primary = NULL;
+    const char *new_primary = NULL;
+    gchar *json = NULL;
+    cr_RepoDiff *diff;
+
+    // Parse arguments
+    options = g_new0(RepodiffCmdOptions, 1);
+    if (!parse_repodiff_arguments(&argc, &argv, options, &tmp_err)) {
+        g_printerr("%s\n", tmp_err->message);
+        exit(EXIT_FAILURE);
+    }
+
+    // Set logging
+    cr_setup_logging(options->quiet, options->verbose);
+
+    // Print version if required
+    if (options->version) {
+        printf("Version: %s\n", cr_version_string_with_features());
+        exit(EXIT_SUCCESS);
+    }
+
+    // Check arguments
+    if (!check_arguments(options, &tmp_err)) {
+        g_printerr("%s\n", tmp_err->message);
+        exit(EXIT_FAILURE);
+    }
+
+    if (argc != 3) {
+        g_printerr("Must specify exactly two repos to compare\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Emit debug message with version
+    g_debug("Version: %s", cr_version_string_with_features());
+
+    old_primary = primary_path(argv[1], &old_ml, &tmp_err);
+    if (old_primary)
+        new_primary = primary_path(argv[2], &new_ml, &tmp_err);
+    if (!new_primary) {
+        g_printerr("%s\n", tmp_err->message);
+        goto cleanup;
+    }
+
+    g_debug("Comparing %s and %s", old_primary, new_primary);
+
+    diff = cr_repodiff_with_limit(old_primary, new_primary, options->key,
+                                  (long) options->max_packages,
+                                  options->tmpdir, &tmp_err);
+    if (!diff) {
+        g_printerr("%s\n", tmp_err->message);
+        goto cleanup;
+    }
+
+    json = cr_repodiff_to_json(diff);
+    cr_repodiff_free(diff);
+
+    if (options->output) {
+        if (!g_file_set_contents(options->output, json, -1, &tmp_err)) {
+            g_printerr("Cannot write %s: %s\n", options->output,
+                       tmp_err->message);
+            goto cleanup;
+        }
+    } else {
+        fputs(json, stdout);
+    }
+
+    ret = EXIT_SUCCESS;
+
+cleanup:
+    g_free(json);
+    cr_metadatalocation_free(old_ml);
+    cr_metadatalocation_free(new_ml);
+    cr_zstd_dict_cleanup();
+
+    return ret;
+}
@@ -239,8 +239,11 @@ cr_repomd_record_fill(cr_RepomdRecord *md,
     }
 
     // Compute checksum of compressed file
+    // (if it wasn't computed while the file was written)
 
-    if (!md->checksum_type || !md->checksum) {
+    if (!md->checksum_type || !md->checksum
+        || g_strcmp0(md->checksum_type, checksum_str))
+    {
         gchar *chksum;
 
         chksum = cr_checksum_file(path, checksum_t, &tmp_err);
@@ -728,6 +731,16 @@ cr_repomd_record_load_contentstat(cr_RepomdRecord *record,
     record->checksum_open_type = cr_safe_string_chunk_insert(record->chunk,
                                 cr_checksum_name_str(stats->checksum_type));
     record->size_open = stats->size;
+
+    if (stats->compressed_checksum) {
+        // Checksum and size of the compressed file itself were computed
+        // while the file was written - cr_repomd_record_fill() can use them
+        record->checksum = cr_safe_string_chunk_insert(record->chunk,
+                                            stats->compressed_checksum);
+        record->checksum_type = cr_safe_string_chunk_insert(record->chunk,
+                                cr_checksum_name_str(stats->checksum_type));
+        record->size = stats->compressed_size;
+    }
 }
 
 void
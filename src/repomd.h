@@ -142,6 +142,8 @@ cr_RepomdRecord *cr_repomd_record_copy(const cr_RepomdRecord *orig);
  * directly on our own or use function for load them from a cr_ContentStat.
  * If no open stats are supplied, then this function has to decompress
  * the file for the open checksum calculation.
+ * Similarly, if checksum and checksum_type (of the requested type) are
+ * already filled, the file isn't read again.
  * @param record                cr_RepomdRecord object
  * @param checksum_type         type of checksum to use
  * @param err                   GError **
@@ -184,7 +186,9 @@ int cr_repomd_record_rename_file(cr_RepomdRecord *record, GError **err);
 void cr_repomd_record_set_timestamp(cr_RepomdRecord *record, gint64 timestamp);
 
 /** Load the open stats (checksum_open, checksum_open_type and size_open)
- * from the cr_ContentStat object.
+ * from the cr_ContentStat object. If the cr_ContentStat contains also
+ * checksum of the written (compressed) file, checksum, checksum_type and
+ * size are loaded as well.
  * @param record                cr_RepomdRecord
  * @param stats                 cr_ContentStat
  */
@@ -0,0 +1,794 @@
+/* createrepo_c - Library of routines for manipulation with repodata
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include "cleanup.h"
+#include "error.h"
+#include "misc.h"
+#include "package.h"
+#include "repomd.h"
+#include "snapshot.h"
+#include "xml_parser.h"
+#include "xml_parser_internal.h"
+
+#define ERR_DOMAIN              CREATEREPO_C_ERROR
+#define SNAPSHOT_MAGIC          "CRSNAPv\0"
+#define SNAPSHOT_VERSION        2
+#define SNAPSHOT_BYTEORDER      0x01020304
+#define SNAPSHOT_CHECKSUM_LEN   136     // Hex sha512 + NUL, padded
+#define SNAPSHOT_ALIGN          8
+#define SNAPSHOT_NULL           0       // String offset of NULL
+
+/** String values of a package, in the order of snapshot_pkg->strings.
+ */
+static const gsize pkg_strings[] = {
+    G_STRUCT_OFFSET(cr_Package, pkgId),
+    G_STRUCT_OFFSET(cr_Package, name),
+    G_STRUCT_OFFSET(cr_Package, arch),
+    G_STRUCT_OFFSET(cr_Package, version),
+    G_STRUCT_OFFSET(cr_Package, epoch),
+    G_STRUCT_OFFSET(cr_Package, release),
+    G_STRUCT_OFFSET(cr_Package, summary),
+    G_STRUCT_OFFSET(cr_Package, description),
+    G_STRUCT_OFFSET(cr_Package, url),
+    G_STRUCT_OFFSET(cr_Package, rpm_license),
+    G_STRUCT_OFFSET(cr_Package, rpm_vendor),
+    G_STRUCT_OFFSET(cr_Package, rpm_group),
+    G_STRUCT_OFFSET(cr_Package, rpm_buildhost),
+    G_STRUCT_OFFSET(cr_Package, rpm_sourcerpm),
+    G_STRUCT_OFFSET(cr_Package, rpm_packager),
+    G_STRUCT_OFFSET(cr_Package, location_href),
+    G_STRUCT_OFFSET(cr_Package, location_base),
+    G_STRUCT_OFFSET(cr_Package, checksum_type),
+    G_STRUCT_OFFSET(cr_Package, files_checksum_type),
+};
+#define PKG_STRINGS     G_N_ELEMENTS(pkg_strings)
+
+/** Indexes of strings used before the package is created.
+ */
+enum {
+    PKG_STR_PKGID       = 0,
+    PKG_STR_NAME        = 1,
+    PKG_STR_ARCH        = 2,
+    PKG_STR_SOURCERPM   = 13,
+    PKG_STR_HREF        = 15,
+};
+
+/** Integer values of a package, in the order of snapshot_pkg->numbers.
+ */
+static const gsize pkg_numbers[] = {
+    G_STRUCT_OFFSET(cr_Package, time_file),
+    G_STRUCT_OFFSET(cr_Package, time_build),
+    G_STRUCT_OFFSET(cr_Package, rpm_header_start),
+    G_STRUCT_OFFSET(cr_Package, rpm_header_end),
+    G_STRUCT_OFFSET(cr_Package, size_package),
+    G_STRUCT_OFFSET(cr_Package, size_installed),
+    G_STRUCT_OFFSET(cr_Package, size_archive),
+};
+#define PKG_NUMBERS     G_N_ELEMENTS(pkg_numbers)
+
+/** Dependency lists of a package, in the order they are stored.
+ */
+static const gsize pkg_deps[] = {
+    G_STRUCT_OFFSET(cr_Package, requires),
+    G_STRUCT_OFFSET(cr_Package, provides),
+    G_STRUCT_OFFSET(cr_Package, conflicts),
+    G_STRUCT_OFFSET(cr_Package, obsoletes),
+    G_STRUCT_OFFSET(cr_Package, suggests),
+    G_STRUCT_OFFSET(cr_Package, enhances),
+    G_STRUCT_OFFSET(cr_Package, recommends),
+    G_STRUCT_OFFSET(cr_Package, supplements),
+};
+#define PKG_DEPS        G_N_ELEMENTS(pkg_deps)
+
+/** Records of repomd.xml the snapshot is keyed by, the second type is
+ * used if there is no record of the first one.
+ */
+static const char *snapshot_key_types[][2] = {
+    { "primary",        NULL },
+    { "filelists-ext",  "filelists" },
+    { "other",          NULL },
+};
+#define SNAPSHOT_KEYS   G_N_ELEMENTS(snapshot_key_types)
+
+typedef struct {
+    guint64 offset;
+    guint64 count;              // Bytes for strings, records otherwise
+} snapshot_section;
+
+typedef struct {
+    char magic[8];
+    guint32 version;
+    guint32 byteorder;
+    char checksums[SNAPSHOT_KEYS][SNAPSHOT_CHECKSUM_LEN];
+    snapshot_section strings;
+    snapshot_section packages;
+    snapshot_section deps;
+    snapshot_section files;
+    snapshot_section changelogs;
+} snapshot_header;
+
+typedef struct {
+    gint64 numbers[PKG_NUMBERS];
+    guint32 strings[PKG_STRINGS];
+    guint32 deps_start;
+    guint32 deps_count[PKG_DEPS];
+    guint32 files_start;
+    guint32 files_count;
+    guint32 changelogs_start;
+    guint32 changelogs_count;
+} snapshot_pkg;
+
+typedef struct {
+    guint32 name;
+    guint32 flags;
+    guint32 epoch;
+    guint32 version;
+    guint32 release;
+    guint32 pre;
+} snapshot_dep;
+
+typedef struct {
+    guint32 type;
+    guint32 path;
+    guint32 name;
+    guint32 digest;
+} snapshot_file;
+
+typedef struct {
+    gint64 date;
+    guint32 author;
+    guint32 changelog;
+} snapshot_changelog;
+
+struct _cr_SnapshotWriter {
+    GStringChunk *chunk;        // Unique strings
+    GHashTable *offsets;        // String (in chunk) -> its offset
+    GPtrArray *strings;         // Unique strings in the order of offsets
+    guint64 strings_size;       // Size of the strings section
+    GArray *packages;           // snapshot_pkg
+    GArray *deps;               // snapshot_dep
+    GArray *files;              // snapshot_file
+    GArray *changelogs;         // snapshot_changelog
+};
+
+
+// Writer
+
+cr_SnapshotWriter *
+cr_snapshot_writer_new(void)
+{
+    cr_SnapshotWriter *sw = g_new0(cr_SnapshotWriter, 1);
+    sw->chunk       = g_string_chunk_new(65536);
+    sw->offsets     = g_hash_table_new(g_str_hash, g_str_equal);
+    sw->strings     = g_ptr_array_new();
+    sw->packages    = g_array_new(FALSE, TRUE, sizeof(snapshot_pkg));
+    sw->deps        = g_array_new(FALSE, TRUE, sizeof(snapshot_dep));
+    sw->files       = g_array_new(FALSE, TRUE, sizeof(snapshot_file));
+    sw->changelogs  = g_array_new(FALSE, TRUE, sizeof(snapshot_changelog));
+    // Offset 0 is reserved for NULL
+    sw->strings_size = 1;
+    return sw;
+}
+
+/** Offset of the string in the strings section, the string is added
+ * if it is not there yet.
+ */
+static guint32
+writer_string(cr_SnapshotWriter *sw, const char *str)
+{
+    gpointer value;
+    char *copy;
+    guint64 offset;
+
+    if (!str)
+        return SNAPSHOT_NULL;
+
+    if (g_hash_table_lookup_extended(sw->offsets, str, NULL, &value))
+        return GPOINTER_TO_UINT(value);
+
+    // Offsets which don't fit are detected by cr_snapshot_writer_write()
+    offset = sw->strings_size;
+    copy = g_string_chunk_insert(sw->chunk, str);
+    g_ptr_array_add(sw->strings, copy);
+    g_hash_table_insert(sw->offsets, copy, GUINT_TO_POINTER((guint32) offset));
+    sw->strings_size += strlen(str) + 1;
+    return (guint32) offset;
+}
+
+void
+cr_snapshot_writer_add_pkg(cr_SnapshotWriter *sw, cr_Package *pkg)
+{
+    snapshot_pkg rec;
+
+    assert(sw);
+    assert(pkg);
+
+    memset(&rec, 0, sizeof(rec));
+
+    for (gsize x = 0; x < PKG_STRINGS; x++)
+        rec.strings[x] = writer_string(sw,
+                            G_STRUCT_MEMBER(char *, pkg, pkg_strings[x]));
+    for (gsize x = 0; x < PKG_NUMBERS; x++)
+        rec.numbers[x] = G_STRUCT_MEMBER(gint64, pkg, pkg_numbers[x]);
+
+    rec.deps_start = sw->deps->len;
+    for (gsize x = 0; x < PKG_DEPS; x++) {
+        GSList *list = G_STRUCT_MEMBER(GSList *, pkg, pkg_deps[x]);
+        for (GSList *elem = list; elem; elem = g_slist_next(elem)) {
+            cr_Dependency *dep = elem->data;
+            snapshot_dep drec;
+            drec.name    = writer_string(sw, dep->name);
+            drec.flags   = writer_string(sw, dep->flags);
+            drec.epoch   = writer_string(sw, dep->epoch);
+            drec.version = writer_string(sw, dep->version);
+            drec.release = writer_string(sw, dep->release);
+            drec.pre     = dep->pre ? 1 : 0;
+            g_array_append_val(sw->deps, drec);
+            rec.deps_count[x]++;
+        }
+    }
+
+    rec.files_start = sw->files->len;
+    for (GSList *elem = pkg->files; elem; elem = g_slist_next(elem)) {
+        cr_PackageFile *file = elem->data;
+        snapshot_file frec;
+        frec.type   = writer_string(sw, file->type);
+        frec.path   = writer_string(sw, file->path);
+        frec.name   = writer_string(sw, file->name);
+        frec.digest = writer_string(sw, file->digest);
+        g_array_append_val(sw->files, frec);
+        rec.files_count++;
+    }
+
+    rec.changelogs_start = sw->changelogs->len;
+    for (GSList *elem = pkg->changelogs; elem; elem = g_slist_next(elem)) {
+        cr_ChangelogEntry *entry = elem->data;
+        snapshot_changelog crec;
+        memset(&crec, 0, sizeof(crec));
+        crec.date      = entry->date;
+        crec.author    = writer_string(sw, entry->author);
+        crec.changelog = writer_string(sw, entry->changelog);
+        g_array_append_val(sw->changelogs, crec);
+        rec.changelogs_count++;
+    }
+
+    g_array_append_val(sw->packages, rec);
+}
+
+guint
+cr_snapshot_writer_count(cr_SnapshotWriter *sw)
+{
+    assert(sw);
+    return sw->packages->len;
+}
+
+static guint64
+align_offset(guint64 offset)
+{
+    return (offset + SNAPSHOT_ALIGN - 1) & ~((guint64) SNAPSHOT_ALIGN - 1);
+}
+
+/** Write zero bytes up to the aligned offset.
+ */
+static gboolean
+write_padding(FILE *f, guint64 *offset)
+{
+    static const char zeros[SNAPSHOT_ALIGN] = { 0 };
+    guint64 aligned = align_offset(*offset);
+
+    if (aligned != *offset && fwrite(zeros, aligned - *offset, 1, f) != 1)
+        return FALSE;
+    *offset = aligned;
+    return TRUE;
+}
+
+static gboolean
+write_array(FILE *f, GArray *array, gsize elem_size,
+            snapshot_section *section, guint64 *offset)
+{
+    if (!write_padding(f, offset))
+        return FALSE;
+
+    section->offset = *offset;
+    section->count  = array->len;
+    if (array->len && fwrite(array->data, elem_size, array->len, f) != array->len)
+        return FALSE;
+    *offset += (guint64) elem_size * array->len;
+    return TRUE;
+}
+
+/** Get the checksums of the records the snapshot is keyed by.
+ * A missing record has an empty checksum, only the primary is required.
+ */
+static int
+snapshot_keys(cr_Repomd *repomd,
+              const char *checksums[SNAPSHOT_KEYS],
+              GError **err)
+{
+    for (guint x = 0; x < SNAPSHOT_KEYS; x++) {
+        cr_RepomdRecord *rec;
+
+        rec = cr_repomd_get_record(repomd, snapshot_key_types[x][0]);
+        if (!rec && snapshot_key_types[x][1])
+            rec = cr_repomd_get_record(repomd, snapshot_key_types[x][1]);
+
+        checksums[x] = (rec && rec->checksum) ? rec->checksum : "";
+        if (strlen(checksums[x]) >= SNAPSHOT_CHECKSUM_LEN) {
+            g_set_error(err, ERR_DOMAIN, CRE_BADARG,
+                        "Checksum \"%s\" is too long", checksums[x]);
+            return CRE_BADARG;
+        }
+    }
+
+    if (!*checksums[0]) {
+        g_set_error(err, ERR_DOMAIN, CRE_BADARG,
+                    "Repomd has no checksum of primary metadata");
+        return CRE_BADARG;
+    }
+
+    return CRE_OK;
+}
+
+int
+cr_snapshot_writer_write(cr_SnapshotWriter *sw,
+                         const char *path,
+                         cr_Repomd *repomd,
+                         GError **err)
+{
+    snapshot_header header;
+    const char *checksums[SNAPSHOT_KEYS];
+    guint64 offset;
+    gboolean ok = TRUE;
+    FILE *f;
+    _cleanup_free_ gchar *tmp_path = NULL;
+    int ret;
+
+    assert(sw);
+    assert(path);
+    assert(repomd);
+    assert(!err || *err == NULL);
+
+    ret = snapshot_keys(repomd, checksums, err);
+    if (ret != CRE_OK)
+        return ret;
+
+    if (sw->strings_size > G_MAXUINT32) {
+        g_set_error(err, ERR_DOMAIN, CRE_SNAPSHOT,
+                    "Strings of the snapshot exceed 4 GiB");
+        return CRE_SNAPSHOT;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version   = SNAPSHOT_VERSION;
+    header.byteorder = SNAPSHOT_BYTEORDER;
+    for (guint x = 0; x < SNAPSHOT_KEYS; x++)
+        g_strlcpy(header.checksums[x], checksums[x],
+                  sizeof(header.checksums[x]));
+
+    tmp_path = g_strconcat(path, ".tmp", NULL);
+    f = fopen(tmp_path, "wb");
+    if (!f) {
+        g_set_error(err, ERR_DOMAIN, CRE_IO,
+                    "Cannot open %s: %s", tmp_path, g_strerror(errno));
+        return CRE_IO;
+    }
+
+    // The header is written again once the sections are known
+    ok = fwrite(&header, sizeof(header), 1, f) == 1;
+    offset = sizeof(header);
+
+    if (ok)
+        ok = write_padding(f, &offset);
+    header.strings.offset = offset;
+    header.strings.count  = sw->strings_size;
+    if (ok)
+        ok = fputc('\0', f) != EOF;
+    for (guint x = 0; ok && x < sw->strings->len; x++) {
+        const char *str = g_ptr_array_index(sw->strings, x);
+        ok = fwrite(str, strlen(str) + 1, 1, f) == 1;
+    }
+    offset += sw->strings_size;
+
+    if (ok)
+        ok = write_array(f, sw->packages, sizeof(snapshot_pkg),
+                         &header.packages, &offset);
+    if (ok)
+        ok = write_array(f, sw->deps, sizeof(snapshot_dep),
+                         &header.deps, &offset);
+    if (ok)
+        ok = write_array(f, sw->files, sizeof(snapshot_file),
+                         &header.files, &offset);
+    if (ok)
+        ok = write_array(f, sw->changelogs, sizeof(snapshot_changelog),
+                         &header.changelogs, &offset);
+
+    if (ok)
+        ok = fseek(f, 0, SEEK_SET) == 0
+             && fwrite(&header, sizeof(header), 1, f) == 1;
+
+    if (fclose(f) != 0)
+        ok = FALSE;
+
+    if (!ok) {
+        g_set_error(err, ERR_DOMAIN, CRE_IO,
+                    "Cannot write %s: %s", tmp_path, g_strerror(errno));
+        g_remove(tmp_path);
+        return CRE_IO;
+    }
+
+    if (g_rename(tmp_path, path) != 0) {
+        g_set_error(err, ERR_DOMAIN, CRE_IO,
+                    "Cannot rename %s -> %s: %s",
+                    tmp_path, path, g_strerror(errno));
+        g_remove(tmp_path);
+        return CRE_IO;
+    }
+
+    g_debug("%s: %u packages written to %s", __func__,
+            sw->packages->len, path);
+
+    return CRE_OK;
+}
+
+void
+cr_snapshot_writer_free(cr_SnapshotWriter *sw)
+{
+    if (!sw)
+        return;
+
+    g_hash_table_destroy(sw->offsets);
+    g_ptr_array_free(sw->strings, TRUE);
+    g_string_chunk_free(sw->chunk);
+    g_array_free(sw->packages, TRUE);
+    g_array_free(sw->deps, TRUE);
+    g_array_free(sw->files, TRUE);
+    g_array_free(sw->changelogs, TRUE);
+    g_free(sw);
+}
+
+
+// Loader
+
+typedef struct {
+    const char *strings;
+    guint64 strings_size;
+    const snapshot_pkg *packages;
+    const snapshot_dep *deps;
+    const snapshot_file *files;
+    const snapshot_changelog *changelogs;
+    const snapshot_header *header;
+} cr_SnapshotData;
+
+/** Check that the section is inside of the mapping and aligned.
+ */
+static gboolean
+section_valid(const snapshot_section *section,
+              gsize elem_size,
+              gsize map_size)
+{
+    if (section->offset % SNAPSHOT_ALIGN || section->offset > map_size)
+        return FALSE;
+    if (section->count > (map_size - section->offset) / elem_size)
+        return FALSE;
+    return TRUE;
+}
+
+static inline gboolean
+string_valid(const cr_SnapshotData *sd, guint32 offset)
+{
+    return offset < sd->strings_size;
+}
+
+static inline gboolean
+range_valid(guint32 start, guint64 count, guint64 total)
+{
+    return start <= total && count <= total - start;
+}
+
+/** Check every record, so the packages can be loaded without checks.
+ */
+static gboolean
+snapshot_records_valid(const cr_SnapshotData *sd)
+{
+    const snapshot_header *header = sd->header;
+
+    for (guint64 x = 0; x < header->packages.count; x++) {
+        const snapshot_pkg *rec = &sd->packages[x];
+        guint64 deps_count = 0;
+
+        for (gsize y = 0; y < PKG_STRINGS; y++)
+            if (!string_valid(sd, rec->strings[y]))
+                return FALSE;
+        for (gsize y = 0; y < PKG_DEPS; y++)
+            deps_count += rec->deps_count[y];
+
+        if (!range_valid(rec->deps_start, deps_count, header->deps.count)
+            || !range_valid(rec->files_start, rec->files_count,
+                            header->files.count)
+            || !range_valid(rec->changelogs_start, rec->changelogs_count,
+                            header->changelogs.count))
+            return FALSE;
+    }
+
+    for (guint64 x = 0; x < header->deps.count; x++) {
+        const snapshot_dep *rec = &sd->deps[x];
+        if (!string_valid(sd, rec->name)
+            || !string_valid(sd, rec->flags)
+            || !string_valid(sd, rec->epoch)
+            || !string_valid(sd, rec->version)
+            || !string_valid(sd, rec->release))
+            return FALSE;
+    }
+
+    for (guint64 x = 0; x < header->files.count; x++) {
+        const snapshot_file *rec = &sd->files[x];
+        if (!string_valid(sd, rec->type)
+            || !string_valid(sd, rec->path)
+            || !string_valid(sd, rec->name)
+            || !string_valid(sd, rec->digest))
+            return FALSE;
+    }
+
+    for (guint64 x = 0; x < header->changelogs.count; x++) {
+        const snapshot_changelog *rec = &sd->changelogs[x];
+        if (!string_valid(sd, rec->author)
+            || !string_valid(sd, rec->changelog))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+/** Map the sections of the snapshot and validate them.
+ */
+static int
+snapshot_open(GMappedFile *mapped,
+              const char *path,
+              const char *checksums[SNAPSHOT_KEYS],
+              cr_SnapshotData *sd,
+              GError **err)
+{
+    const char *map = g_mapped_file_get_contents(mapped);
+    gsize map_size = g_mapped_file_get_length(mapped);
+    const snapshot_header *header = (const snapshot_header *) map;
+
+    if (map_size < sizeof(*header)
+        || memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic))) {
+        g_set_error(err, ERR_DOMAIN, CRE_SNAPSHOT,
+                    "%s is not a snapshot", path);
+        return CRE_SNAPSHOT;
+    }
+
+    if (header->version != SNAPSHOT_VERSION
+        || header->byteorder != SNAPSHOT_BYTEORDER) {
+        g_set_error(err, ERR_DOMAIN, CRE_SNAPSHOT,
+                    "Snapshot %s has an incompatible format", path);
+        return CRE_SNAPSHOT;
+    }
+
+    for (guint x = 0; x < SNAPSHOT_KEYS; x++) {
+        if (strncmp(header->checksums[x], checksums[x],
+                    sizeof(header->checksums[x]))) {
+            g_set_error(err, ERR_DOMAIN, CRE_SNAPSHOT,
+                        "Snapshot %s is stale (%s changed)",
+                        path, snapshot_key_types[x][0]);
+            return CRE_SNAPSHOT;
+        }
+    }
+
+    if (!section_valid(&header->strings, 1, map_size)
+        || !section_valid(&header->packages, sizeof(snapshot_pkg), map_size)
+        || !section_valid(&header->deps, sizeof(snapshot_dep), map_size)
+        || !section_valid(&header->files, sizeof(snapshot_file), map_size)
+        || !section_valid(&header->changelogs, sizeof(snapshot_changelog), map_size)
+        || header->strings.count == 0
+        || header->strings.count > G_MAXUINT32
+        || map[header->strings.offset + header->strings.count - 1] != '\0')
+    {
+        g_set_error(err, ERR_DOMAIN, CRE_SNAPSHOT,
+                    "Snapshot %s is corrupted", path);
+        return CRE_SNAPSHOT;
+    }
+
+    sd->header       = header;
+    sd->strings      = map + header->strings.offset;
+    sd->strings_size = header->strings.count;
+    sd->packages     = (const snapshot_pkg *) (map + header->packages.offset);
+    sd->deps         = (const snapshot_dep *) (map + header->deps.offset);
+    sd->files        = (const snapshot_file *) (map + header->files.offset);
+    sd->changelogs   = (const snapshot_changelog *) (map + header->changelogs.offset);
+
+    if (!snapshot_records_valid(sd)) {
+        g_set_error(err, ERR_DOMAIN, CRE_SNAPSHOT,
+                    "Snapshot %s is corrupted", path);
+        return CRE_SNAPSHOT;
+    }
+
+    return CRE_OK;
+}
+
+static inline const char *
+snapshot_string(const cr_SnapshotData *sd, guint32 offset)
+{
+    return offset == SNAPSHOT_NULL ? NULL : sd->strings + offset;
+}
+
+static inline char *
+snapshot_string_copy(const cr_SnapshotData *sd,
+                     GStringChunk *chunk,
+                     guint32 offset)
+{
+    return cr_safe_string_chunk_insert(chunk, snapshot_string(sd, offset));
+}
+
+/** Fill the package from the record. Lists are built from the end,
+ * so g_slist_prepend() keeps the original order.
+ */
+static void
+snapshot_fill_pkg(const cr_SnapshotData *sd,
+                  const snapshot_pkg *rec,
+                  cr_Package *pkg)
+{
+    GStringChunk *chunk = pkg->chunk;
+    guint32 dep_end = rec->deps_start;
+
+    for (gsize x = 0; x < PKG_STRINGS; x++)
+        G_STRUCT_MEMBER(char *, pkg, pkg_strings[x]) =
+                snapshot_string_copy(sd, chunk, rec->strings[x]);
+    for (gsize x = 0; x < PKG_NUMBERS; x++)
+        G_STRUCT_MEMBER(gint64, pkg, pkg_numbers[x]) = rec->numbers[x];
+
+    for (gsize x = 0; x < PKG_DEPS; x++) {
+        GSList **list = &G_STRUCT_MEMBER(GSList *, pkg, pkg_deps[x]);
+        guint32 dep_start = dep_end;
+        dep_end += rec->deps_count[x];
+        for (guint32 y = dep_end; y > dep_start; y--) {
+            const snapshot_dep *drec = &sd->deps[y - 1];
+            cr_Dependency *dep = cr_dependency_new();
+            dep->name    = snapshot_string_copy(sd, chunk, drec->name);
+            dep->flags   = snapshot_string_copy(sd, chunk, drec->flags);
+            dep->epoch   = snapshot_string_copy(sd, chunk, drec->epoch);
+            dep->version = snapshot_string_copy(sd, chunk, drec->version);
+            dep->release = snapshot_string_copy(sd, chunk, drec->release);
+            dep->pre     = drec->pre ? TRUE : FALSE;
+            *list = g_slist_prepend(*list, dep);
+        }
+    }
+
+    for (guint32 y = rec->files_count; y > 0; y--) {
+        const snapshot_file *frec = &sd->files[rec->files_start + y - 1];
+        cr_PackageFile *file = cr_package_file_new();
+        file->type   = snapshot_string_copy(sd, chunk, frec->type);
+        file->path   = snapshot_string_copy(sd, chunk, frec->path);
+        file->name   = snapshot_string_copy(sd, chunk, frec->name);
+        file->digest = snapshot_string_copy(sd, chunk, frec->digest);
+        pkg->files = g_slist_prepend(pkg->files, file);
+    }
+
+    for (guint32 y = rec->changelogs_count; y > 0; y--) {
+        const snapshot_changelog *crec =
+                &sd->changelogs[rec->changelogs_start + y - 1];
+        cr_ChangelogEntry *entry = cr_changelog_entry_new();
+        entry->date      = crec->date;
+        entry->author    = snapshot_string_copy(sd, chunk, crec->author);
+        entry->changelog = snapshot_string_copy(sd, chunk, crec->changelog);
+        pkg->changelogs = g_slist_prepend(pkg->changelogs, entry);
+    }
+}
+
+int
+cr_snapshot_load(const char *path,
+                 cr_Repomd *repomd,
+                 const cr_XmlFilter *filter,
+                 cr_XmlParserNewPkgCb newpkgcb,
+                 void *newpkgcb_data,
+                 cr_XmlParserPkgCb pkgcb,
+                 void *pkgcb_data,
+                 GError **err)
+{
+    int ret = CRE_OK;
+    GMappedFile *mapped;
+    cr_SnapshotData sd;
+    const char *checksums[SNAPSHOT_KEYS];
+    GError *tmp_err = NULL;
+
+    assert(path);
+    assert(repomd);
+    assert(pkgcb);
+    assert(!err || *err == NULL);
+
+    if (!newpkgcb)
+        newpkgcb = cr_newpkgcb;
+
+    if (snapshot_keys(repomd, checksums, &tmp_err) != CRE_OK) {
+        g_set_error(err, ERR_DOMAIN, CRE_SNAPSHOT,
+                    "Cannot use snapshot %s: %s", path, tmp_err->message);
+        g_error_free(tmp_err);
+        return CRE_SNAPSHOT;
+    }
+
+    mapped = g_mapped_file_new(path, FALSE, &tmp_err);
+    if (!mapped) {
+        g_set_error(err, ERR_DOMAIN, CRE_SNAPSHOT,
+                    "Cannot map snapshot %s: %s", path, tmp_err->message);
+        g_error_free(tmp_err);
+        return CRE_SNAPSHOT;
+    }
+
+    ret = snapshot_open(mapped, path, checksums, &sd, err);
+    if (ret != CRE_OK) {
+        g_mapped_file_unref(mapped);
+        return ret;
+    }
+
+    for (guint64 x = 0; x < sd.header->packages.count; x++) {
+        const snapshot_pkg *rec = &sd.packages[x];
+        const char *name = snapshot_string(&sd, rec->strings[PKG_STR_NAME]);
+        const char *arch = snapshot_string(&sd, rec->strings[PKG_STR_ARCH]);
+        cr_Package *pkg = NULL;
+
+        if (!cr_xml_filter_match(filter, name, arch,
+                    snapshot_string(&sd, rec->strings[PKG_STR_HREF]),
+                    snapshot_string(&sd, rec->strings[PKG_STR_SOURCERPM])))
+            continue;
+
+        if (newpkgcb(&pkg,
+                     snapshot_string(&sd, rec->strings[PKG_STR_PKGID]),
+                     name,
+                     arch,
+                     newpkgcb_data,
+                     &tmp_err))
+        {
+            ret = CRE_CBINTERRUPTED;
+            break;
+        }
+
+        if (!pkg)
+            continue;
+
+        assert(pkg->chunk);
+        snapshot_fill_pkg(&sd, rec, pkg);
+
+        if (pkgcb(pkg, pkgcb_data, &tmp_err)) {
+            if (newpkgcb == cr_newpkgcb)
+                cr_package_free(pkg);
+            ret = CRE_CBINTERRUPTED;
+            break;
+        }
+    }
+
+    if (ret == CRE_CBINTERRUPTED) {
+        if (tmp_err)
+            g_propagate_prefixed_error(err, tmp_err, "Parsing interrupted: ");
+        else
+            g_set_error(err, ERR_DOMAIN, CRE_CBINTERRUPTED,
+                        "Parsing interrupted");
+    }
+
+    g_mapped_file_unref(mapped);
+
+    return ret;
+}
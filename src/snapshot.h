@@ -0,0 +1,142 @@
+/* createrepo_c - Library of routines for manipulation with repodata
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#ifndef __C_CREATEREPOLIB_SNAPSHOT_H__
+#define __C_CREATEREPOLIB_SNAPSHOT_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <glib.h>
+#include "package.h"
+#include "repomd.h"
+#include "xml_parser.h"
+
+/** \defgroup   snapshot    Binary snapshot of parsed repodata
+ *  \addtogroup snapshot
+ *  @{
+ *
+ * The snapshot is an alternative, mmap-able representation of packages
+ * from primary, filelists (or filelists-ext) and other xml. It is stored
+ * next to repomd.xml (it is not listed in it) and it is keyed by
+ * the checksums of the primary, filelists (or filelists-ext if there is
+ * one) and other records from repomd.xml, so a snapshot left behind by
+ * a different version of any of the metadata is never used.
+ *
+ * Snapshot layout (all numbers are in the native byte order, a snapshot
+ * written on a machine with a different byte order is rejected):
+ *  - header        - magic, version, checksums of the records and
+ *                    offsets and sizes of the following sections
+ *  - strings       - deduplicated NUL terminated strings, all other
+ *                    sections refer to them by offset
+ *  - packages      - fixed size records, one per package
+ *  - dependencies  - records of all packages, every package refers to
+ *                    a continuous range ordered by the dependency type
+ *  - files         - records of all packages, continuous range per package
+ *  - changelogs    - records of all packages, continuous range per package
+ */
+
+/** Name of the snapshot file in the repodata directory.
+ */
+#define CR_SNAPSHOT_FILENAME    "metadata.snapshot"
+
+/** Snapshot writer.
+ */
+typedef struct _cr_SnapshotWriter cr_SnapshotWriter;
+
+/** Create a new (empty) snapshot writer.
+ * @return              New cr_SnapshotWriter
+ */
+cr_SnapshotWriter *
+cr_snapshot_writer_new(void);
+
+/** Add a package to the snapshot. All the package data are copied.
+ * Packages are stored in the order they are added. The writer is not
+ * thread safe.
+ * @param sw            Snapshot writer
+ * @param pkg           Package with files and changelogs loaded
+ */
+void
+cr_snapshot_writer_add_pkg(cr_SnapshotWriter *sw, cr_Package *pkg);
+
+/** Number of packages added to the writer.
+ * @param sw            Snapshot writer
+ * @return              Number of packages
+ */
+guint
+cr_snapshot_writer_count(cr_SnapshotWriter *sw);
+
+/** Write the snapshot. The file is written into a temporary file
+ * first and then atomically renamed to the path.
+ * @param sw            Snapshot writer
+ * @param path          Path of the snapshot file
+ * @param repomd        Repomd the snapshot belongs to, the checksums of
+ *                      its records are stored in the snapshot
+ * @param err           GError **
+ * @return              cr_Error code
+ */
+int
+cr_snapshot_writer_write(cr_SnapshotWriter *sw,
+                         const char *path,
+                         cr_Repomd *repomd,
+                         GError **err);
+
+/** Free the snapshot writer.
+ * @param sw            Snapshot writer
+ */
+void
+cr_snapshot_writer_free(cr_SnapshotWriter *sw);
+
+/** Load packages from a snapshot. The snapshot is mapped into memory
+ * and validated before the first callback is called, a missing, stale
+ * (a checksum of the records differs), incompatible or corrupted snapshot is
+ * reported by CRE_SNAPSHOT error and no callback is called then.
+ * newpkgcb and pkgcb are called the same way as by the primary xml parser
+ * (newpkgcb has to return an empty package with a string chunk), all
+ * strings of the package are copied into the chunk of the package, so
+ * the package doesn't refer to the mapping.
+ * Packages rejected by the filter are skipped before newpkgcb is called.
+ * @param path          Path of the snapshot file
+ * @param repomd        Repomd with the expected checksums of the records
+ * @param filter        cr_XmlFilter or NULL
+ * @param newpkgcb      Callback for a new package (or NULL)
+ * @param newpkgcb_data User data for the newpkgcb
+ * @param pkgcb         Callback for a complete package
+ * @param pkgcb_data    User data for the pkgcb
+ * @param err           GError **
+ * @return              cr_Error code
+ */
+int
+cr_snapshot_load(const char *path,
+                 cr_Repomd *repomd,
+                 const cr_XmlFilter *filter,
+                 cr_XmlParserNewPkgCb newpkgcb,
+                 void *newpkgcb_data,
+                 cr_XmlParserPkgCb pkgcb,
+                 void *pkgcb_data,
+                 GError **err);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __C_CREATEREPOLIB_SNAPSHOT_H__ */
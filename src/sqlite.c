@@ -1695,6 +1695,12 @@ cr_db_add_pkg(cr_SqliteDb *sqlitedb, cr_Package *pkg, GError **err)
     if (!pkg)
         return CRE_OK;
 
+    if (cr_package_load_lazy(pkg, &tmp_err) != CRE_OK) {
+        int code = tmp_err->code;
+        g_propagate_error(err, tmp_err);
+        return code;
+    }
+
     switch (sqlitedb->type) {
     case CR_DB_PRIMARY:
         cr_db_add_primary_pkg(sqlitedb->statements.pri, pkg, &tmp_err);
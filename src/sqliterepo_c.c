@@ -58,6 +58,10 @@ typedef struct {
     gboolean keep_old;          /*!< keep old DBs around */
     gboolean xz_compression;    /*!< use xz for DBs compression */
     gchar *compress_type;       /*!< which compression type to use */
+    gchar **compress_levels;    /*!< [TYPE=]LEVEL compression levels */
+    gchar **compress_profiles;  /*!< [TYPE=]PROFILE compression profiles */
+    gchar **compress_strategies; /*!< [TYPE=]STRATEGY compression strategies */
+    gchar **compress_buffer_sizes; /*!< [TYPE=]BYTES compression buffers */
     gboolean local_sqlite;      /*!< gen sqlite locally into a directory
                                      temporary files. (For situations when
                                      sqlite has a trouble to gen DBs
@@ -68,6 +72,7 @@ typedef struct {
 
     cr_CompressionType compression_type;    /*!< compression type */
     cr_ChecksumType checksum_type;          /*!< checksum type */
+    cr_CompressionOptionsMap *compression_options; /*!< levels and profiles */
 
 } SqliterepoCmdOptions;
 
@@ -84,10 +89,15 @@ sqliterepocmdoptions_new(void)
     options->keep_old = FALSE;
     options->xz_compression = FALSE;
     options->compress_type = NULL;
+    options->compress_levels = NULL;
+    options->compress_profiles = NULL;
+    options->compress_strategies = NULL;
+    options->compress_buffer_sizes = NULL;
     options->chcksum_type = NULL;
     options->local_sqlite = FALSE;
     options->compression_type = CR_CW_BZ2_COMPRESSION;
     options->checksum_type = CR_CHECKSUM_UNKNOWN;
+    options->compression_options = NULL;
 
     return options;
 }
@@ -96,6 +106,11 @@ static void
 sqliterepocmdoptions_free(SqliterepoCmdOptions *options)
 {
     g_free(options->compress_type);
+    g_strfreev(options->compress_levels);
+    g_strfreev(options->compress_profiles);
+    g_strfreev(options->compress_strategies);
+    g_strfreev(options->compress_buffer_sizes);
+    cr_compression_options_map_free(options->compression_options);
     g_free(options);
 }
 
@@ -130,6 +145,24 @@ parse_sqliterepo_arguments(int *argc,
           "Use xz for repodata compression.", NULL },
         { "compress-type", '\0', 0, G_OPTION_ARG_STRING, &(options->compress_type),
           "Which compression type to use.", "<compress_type>" },
+        { "compress-level", '\0', 0, G_OPTION_ARG_STRING_ARRAY, &(options->compress_levels),
+          "Compression level for DBs of the TYPE (primary_db, filelists_db, "
+          "other_db) or for all DBs if the TYPE is omitted. "
+          "Can be used multiple times.", "[TYPE=]LEVEL" },
+        { "compress-profile", '\0', 0, G_OPTION_ARG_STRING_ARRAY, &(options->compress_profiles),
+          "Compression profile (default, fast or best) for DBs of the TYPE "
+          "or for all DBs if the TYPE is omitted. "
+          "Can be used multiple times.", "[TYPE=]PROFILE" },
+        { "compress-strategy", '\0', 0, G_OPTION_ARG_STRING_ARRAY, &(options->compress_strategies),
+          "Compression strategy for DBs of the TYPE or for all DBs if the TYPE "
+          "is omitted: filtered, huffman, rle or fixed for gz, fast, dfast, "
+          "greedy, lazy, lazy2, btlazy2, btopt, btultra or btultra2 for zstd. "
+          "Other compression types ignore it. Can be used multiple times.",
+          "[TYPE=]STRATEGY" },
+        { "compress-buffer-size", '\0', 0, G_OPTION_ARG_STRING_ARRAY, &(options->compress_buffer_sizes),
+          "Size in bytes of the buffer of compressed data (gz, xz and zstd) "
+          "for DBs of the TYPE or for all DBs if the TYPE is omitted. "
+          "Can be used multiple times.", "[TYPE=]BYTES" },
         { "checksum", '\0', 0, G_OPTION_ARG_STRING, &(options->chcksum_type),
           "Which checksum type to use in repomd.xml for sqlite DBs.", "<checksum_type>" },
         { "local-sqlite", '\0', 0, G_OPTION_ARG_NONE, &(options->local_sqlite),
@@ -169,6 +202,30 @@ check_arguments(SqliterepoCmdOptions *options, GError **err)
         }
     }
 
+    // --compress-level, --compress-profile, --compress-strategy
+    // and --compress-buffer-size
+    options->compression_options = cr_compression_options_map_new();
+    for (int x = 0; options->compress_levels && options->compress_levels[x]; x++)
+        if (!cr_compression_options_map_parse(options->compression_options,
+                                              options->compress_levels[x],
+                                              CR_CW_OPTION_LEVEL, err))
+            return FALSE;
+    for (int x = 0; options->compress_profiles && options->compress_profiles[x]; x++)
+        if (!cr_compression_options_map_parse(options->compression_options,
+                                              options->compress_profiles[x],
+                                              CR_CW_OPTION_PROFILE, err))
+            return FALSE;
+    for (int x = 0; options->compress_strategies && options->compress_strategies[x]; x++)
+        if (!cr_compression_options_map_parse(options->compression_options,
+                                              options->compress_strategies[x],
+                                              CR_CW_OPTION_STRATEGY, err))
+            return FALSE;
+    for (int x = 0; options->compress_buffer_sizes && options->compress_buffer_sizes[x]; x++)
+        if (!cr_compression_options_map_parse(options->compression_options,
+                                              options->compress_buffer_sizes[x],
+                                              CR_CW_OPTION_BUFFER_SIZE, err))
+            return FALSE;
+
     // --checksum
     if (options->chcksum_type) {
         cr_ChecksumType type;
@@ -365,19 +422,26 @@ compress_sqlite_dbs(const gchar *tmp_out_repo,
                     const gchar *oth_db_filename,
                     cr_RepomdRecord **in_oth_db_rec,
                     cr_CompressionType compression_type,
-                    cr_ChecksumType checksum_type)
+                    cr_CompressionOptionsMap *compression_options,
+                    cr_ChecksumType checksum_type,
+                    GError **err)
 {
+    gboolean ret = TRUE;
     cr_CompressionTask *pri_db_task;
     cr_CompressionTask *fil_db_task;
     cr_CompressionTask *oth_db_task;
+    cr_RepomdRecordTask *pri_db_rec_task;
+    cr_RepomdRecordTask *fil_db_rec_task;
+    cr_RepomdRecordTask *oth_db_rec_task;
     const char *sqlite_compression_suffix;
     cr_RepomdRecord *pri_db_rec = NULL;
     cr_RepomdRecord *fil_db_rec = NULL;
     cr_RepomdRecord *oth_db_rec = NULL;
 
-    // Prepare thread pool for compression tasks
-    GThreadPool *compress_pool =  g_thread_pool_new(cr_compressing_thread,
-                                                    NULL, 3, FALSE, NULL);
+    // Prepare thread pool for compress -> fill chains
+    // (each db is filled as soon as its compression ends)
+    GThreadPool *rec_pool = g_thread_pool_new(cr_repomd_record_task_thread,
+                                              NULL, 3, FALSE, NULL);
 
     // Prepare output filenames
     sqlite_compression_suffix = cr_compression_suffix(compression_type);
@@ -388,36 +452,6 @@ compress_sqlite_dbs(const gchar *tmp_out_repo,
     gchar *oth_db_name = g_strconcat(tmp_out_repo, "/other.sqlite",
                                      sqlite_compression_suffix, NULL);
 
-    // Prepare compression tasks
-    pri_db_task = cr_compressiontask_new(pri_db_filename,
-                                         pri_db_name,
-                                         compression_type,
-                                         checksum_type,
-                                         NULL, FALSE, 1, NULL);
-    g_thread_pool_push(compress_pool, pri_db_task, NULL);
-
-    fil_db_task = cr_compressiontask_new(fil_db_filename,
-                                         fil_db_name,
-                                         compression_type,
-                                         checksum_type,
-                                         NULL, FALSE, 1, NULL);
-    g_thread_pool_push(compress_pool, fil_db_task, NULL);
-
-    oth_db_task = cr_compressiontask_new(oth_db_filename,
-                                         oth_db_name,
-                                         compression_type,
-                                         checksum_type,
-                                         NULL, FALSE, 1, NULL);
-    g_thread_pool_push(compress_pool, oth_db_task, NULL);
-
-    // Wait till all tasks are complete and free the thread pool
-    g_thread_pool_free(compress_pool, FALSE, TRUE);
-
-    // Remove uncompressed DBs
-    cr_rm(pri_db_filename, CR_RM_FORCE, NULL, NULL);
-    cr_rm(fil_db_filename, CR_RM_FORCE, NULL, NULL);
-    cr_rm(oth_db_filename, CR_RM_FORCE, NULL, NULL);
-
     // Prepare repomd records
     pri_db_rec = cr_repomd_record_new("primary_db", pri_db_name);
     fil_db_rec = cr_repomd_record_new("filelists_db", fil_db_name);
@@ -427,54 +461,76 @@ compress_sqlite_dbs(const gchar *tmp_out_repo,
     *in_fil_db_rec = fil_db_rec;
     *in_oth_db_rec = oth_db_rec;
 
-    // Free paths to compressed files
-    g_free(pri_db_name);
-    g_free(fil_db_name);
-    g_free(oth_db_name);
-
-    // Fill repomd records from stats gathered during compression
-    cr_repomd_record_load_contentstat(pri_db_rec, pri_db_task->stat);
-    cr_repomd_record_load_contentstat(fil_db_rec, fil_db_task->stat);
-    cr_repomd_record_load_contentstat(oth_db_rec, oth_db_task->stat);
-
-    // Free the compression tasks
-    cr_compressiontask_free(pri_db_task, NULL);
-    cr_compressiontask_free(fil_db_task, NULL);
-    cr_compressiontask_free(oth_db_task, NULL);
-
-    // Prepare thread pool for repomd record filling tasks
-    GThreadPool *fill_pool = g_thread_pool_new(cr_repomd_record_fill_thread,
-                                               NULL, 3, FALSE, NULL);
+    // Prepare the tasks (renaming is done later, if needed)
+    cr_CompressionOptions pri_db_copts = cr_compression_options_map_get(
+                                    compression_options, "primary_db");
+    pri_db_task = cr_compressiontask_new_with_options(pri_db_filename,
+                                                      pri_db_name,
+                                                      compression_type,
+                                                      checksum_type,
+                                                      &pri_db_copts,
+                                                      NULL, FALSE, 1, NULL);
+    pri_db_rec_task = cr_repomdrecordtask_new(pri_db_rec, pri_db_task,
+                                              checksum_type, FALSE, NULL);
+    g_thread_pool_push(rec_pool, pri_db_rec_task, NULL);
+
+    cr_CompressionOptions fil_db_copts = cr_compression_options_map_get(
+                                    compression_options, "filelists_db");
+    fil_db_task = cr_compressiontask_new_with_options(fil_db_filename,
+                                                      fil_db_name,
+                                                      compression_type,
+                                                      checksum_type,
+                                                      &fil_db_copts,
+                                                      NULL, FALSE, 1, NULL);
+    fil_db_rec_task = cr_repomdrecordtask_new(fil_db_rec, fil_db_task,
+                                              checksum_type, FALSE, NULL);
+    g_thread_pool_push(rec_pool, fil_db_rec_task, NULL);
+
+    cr_CompressionOptions oth_db_copts = cr_compression_options_map_get(
+                                    compression_options, "other_db");
+    oth_db_task = cr_compressiontask_new_with_options(oth_db_filename,
+                                                      oth_db_name,
+                                                      compression_type,
+                                                      checksum_type,
+                                                      &oth_db_copts,
+                                                      NULL, FALSE, 1, NULL);
+    oth_db_rec_task = cr_repomdrecordtask_new(oth_db_rec, oth_db_task,
+                                              checksum_type, FALSE, NULL);
+    g_thread_pool_push(rec_pool, oth_db_rec_task, NULL);
 
-    // Prepare the tasks themselves
-    cr_RepomdRecordFillTask *pri_db_fill_task;
-    cr_RepomdRecordFillTask *fil_db_fill_task;
-    cr_RepomdRecordFillTask *oth_db_fill_task;
-
-    pri_db_fill_task = cr_repomdrecordfilltask_new(pri_db_rec,
-                                                   checksum_type,
-                                                   NULL);
-    g_thread_pool_push(fill_pool, pri_db_fill_task, NULL);
+    // Wait till all tasks are complete and free the thread pool
+    g_thread_pool_free(rec_pool, FALSE, TRUE);
 
-    fil_db_fill_task = cr_repomdrecordfilltask_new(fil_db_rec,
-                                                   checksum_type,
-                                                   NULL);
-    g_thread_pool_push(fill_pool, fil_db_fill_task, NULL);
+    // Report the first failed chain, its record has no checksums
+    cr_RepomdRecordTask *rec_tasks[] = {
+        pri_db_rec_task, fil_db_rec_task, oth_db_rec_task,
+    };
+    for (size_t x = 0; ret && x < G_N_ELEMENTS(rec_tasks); x++) {
+        if (rec_tasks[x]->err) {
+            g_propagate_prefixed_error(err, rec_tasks[x]->err,
+                                       "Cannot process %s: ",
+                                       rec_tasks[x]->record->type);
+            rec_tasks[x]->err = NULL;
+            ret = FALSE;
+        }
+    }
 
-    oth_db_fill_task = cr_repomdrecordfilltask_new(oth_db_rec,
-                                                   checksum_type,
-                                                   NULL);
-    g_thread_pool_push(fill_pool, oth_db_fill_task, NULL);
+    // Remove uncompressed DBs
+    cr_rm(pri_db_filename, CR_RM_FORCE, NULL, NULL);
+    cr_rm(fil_db_filename, CR_RM_FORCE, NULL, NULL);
+    cr_rm(oth_db_filename, CR_RM_FORCE, NULL, NULL);
 
-    // Wait till the all tasks are finished and free the pool
-    g_thread_pool_free(fill_pool, FALSE, TRUE);
+    // Free paths to compressed files
+    g_free(pri_db_name);
+    g_free(fil_db_name);
+    g_free(oth_db_name);
 
     // Clear the tasks
-    cr_repomdrecordfilltask_free(pri_db_fill_task, NULL);
-    cr_repomdrecordfilltask_free(fil_db_fill_task, NULL);
-    cr_repomdrecordfilltask_free(oth_db_fill_task, NULL);
+    cr_repomdrecordtask_free(pri_db_rec_task, NULL);
+    cr_repomdrecordtask_free(fil_db_rec_task, NULL);
+    cr_repomdrecordtask_free(oth_db_rec_task, NULL);
 
-    return TRUE;
+    return ret;
 }
 
 static gboolean
@@ -704,6 +760,7 @@ remove_old_if_different(const gchar *repo_path,
 static gboolean
 generate_sqlite_from_xml(const gchar *path,
                          cr_CompressionType compression_type,
+                         cr_CompressionOptionsMap *compression_options,
                          cr_ChecksumType checksum_type,
                          gboolean local_sqlite,
                          gboolean force,
@@ -768,6 +825,7 @@ generate_sqlite_from_xml(const gchar *path,
         fil_xml_path = g_build_filename(md_loc->fil_xml_href, NULL);
     if (md_loc->oth_xml_href)
         oth_xml_path = g_build_filename(md_loc->oth_xml_href, NULL);
+    cr_metadatalocation_register_zstd_dicts(md_loc);
     cr_metadatalocation_free(md_loc);
 
     // Parse repomd.xml
@@ -926,7 +984,9 @@ generate_sqlite_from_xml(const gchar *path,
                               oth_db_filename,
                               &oth_db_rec,
                               compression_type,
-                              checksum_type);
+                              compression_options,
+                              checksum_type,
+                              err);
     if (!ret)
         return FALSE;
 
@@ -1020,11 +1080,13 @@ main(int argc, char **argv)
     // Gen the databases
     ret = generate_sqlite_from_xml(argv[1],
                                    options->compression_type,
+                                   options->compression_options,
                                    options->checksum_type,
                                    options->local_sqlite,
                                    options->force,
                                    options->keep_old,
                                    &tmp_err);
+    cr_zstd_dict_cleanup();
     if (!ret) {
         g_printerr("%s\n", tmp_err->message);
         exit(EXIT_FAILURE);
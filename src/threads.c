@@ -37,6 +37,23 @@ cr_compressiontask_new(const char *src,
                        gboolean zck_auto_chunk,
                        int delsrc,
                        GError **err)
+{
+    return cr_compressiontask_new_with_options(src, dst, compression_type,
+                                               checksum_type, NULL,
+                                               zck_dict_dir, zck_auto_chunk,
+                                               delsrc, err);
+}
+
+cr_CompressionTask *
+cr_compressiontask_new_with_options(const char *src,
+                                    const char *dst,
+                                    cr_CompressionType compression_type,
+                                    cr_ChecksumType checksum_type,
+                                    const cr_CompressionOptions *options,
+                                    const char *zck_dict_dir,
+                                    gboolean zck_auto_chunk,
+                                    int delsrc,
+                                    GError **err)
 {
     cr_ContentStat *stat;
     cr_CompressionTask *task;
@@ -66,6 +83,10 @@ cr_compressiontask_new(const char *src,
         task->zck_dict_dir = g_strdup(zck_dict_dir);
     task->zck_auto_chunk = zck_auto_chunk;
     task->delsrc = delsrc;
+    if (options)
+        task->options = *options;
+    else
+        task->options = cr_compression_options_map_get(NULL, NULL);
 
     return task;
 }
@@ -101,13 +122,14 @@ cr_compressing_thread(gpointer data, G_GNUC_UNUSED gpointer user_data)
                                 cr_compression_suffix(task->type),
                                 NULL);
 
-    cr_compress_file_with_stat(task->src,
-                               task->dst,
-                               task->type,
-                               task->stat,
-                               task->zck_dict_dir,
-                               task->zck_auto_chunk,
-                               &tmp_err);
+    cr_compress_file_with_options(task->src,
+                                  task->dst,
+                                  task->type,
+                                  task->stat,
+                                  &task->options,
+                                  task->zck_dict_dir,
+                                  task->zck_auto_chunk,
+                                  &tmp_err);
 
     if (tmp_err) {
         // Error encountered
@@ -119,6 +141,72 @@ cr_compressing_thread(gpointer data, G_GNUC_UNUSED gpointer user_data)
     }
 }
 
+/** Parallel Compression, Repomd Record Fill and Rename */
+
+cr_RepomdRecordTask *
+cr_repomdrecordtask_new(cr_RepomdRecord *record,
+                        cr_CompressionTask *compression,
+                        cr_ChecksumType checksum_type,
+                        gboolean rename,
+                        GError **err)
+{
+    cr_RepomdRecordTask *task;
+
+    assert(record);
+    assert(!err || *err == NULL);
+
+    task = g_malloc0(sizeof(cr_RepomdRecordTask));
+    task->compression = compression;
+    task->record = record;
+    task->checksum_type = checksum_type;
+    task->rename = rename;
+
+    return task;
+}
+
+void
+cr_repomdrecordtask_free(cr_RepomdRecordTask *task, GError **err)
+{
+    assert(!err || *err == NULL);
+
+    if (!task)
+        return;
+
+    cr_compressiontask_free(task->compression, NULL);
+    if (task->err)
+        g_error_free(task->err);
+    g_free(task);
+}
+
+void
+cr_repomd_record_task_thread(gpointer data, gpointer user_data)
+{
+    cr_RepomdRecordTask *task = data;
+    GError *tmp_err = NULL;
+
+    assert(task);
+
+    if (task->compression) {
+        cr_compressing_thread(task->compression, user_data);
+        if (task->compression->err) {
+            g_propagate_error(&task->err, task->compression->err);
+            task->compression->err = NULL;
+            return;
+        }
+        cr_repomd_record_load_contentstat(task->record,
+                                          task->compression->stat);
+    }
+
+    cr_repomd_record_fill(task->record, task->checksum_type, &tmp_err);
+    if (!tmp_err && task->rename)
+        cr_repomd_record_rename_file(task->record, &tmp_err);
+
+    if (tmp_err) {
+        // Error encountered
+        g_propagate_error(&task->err, tmp_err);
+    }
+}
+
 void
 cr_rewrite_pkg_count_thread(gpointer data, gpointer user_data)
 {
@@ -128,13 +216,14 @@ cr_rewrite_pkg_count_thread(gpointer data, gpointer user_data)
 
     assert(task);
 
-    cr_rewrite_header_package_count(task->src,
-                                    task->type,
-                                    ud->package_count,
-                                    ud->task_count - ud->skipped_count,
-                                    task->stat,
-                                    task->zck_dict_dir,
-                                    &tmp_err);
+    cr_rewrite_header_package_count_with_options(task->src,
+                                                 task->type,
+                                                 ud->package_count,
+                                                 ud->task_count - ud->skipped_count,
+                                                 task->stat,
+                                                 &task->options,
+                                                 task->zck_dict_dir,
+                                                 &tmp_err);
 
     if (tmp_err) {
         // Error encountered
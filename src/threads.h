@@ -82,11 +82,15 @@ typedef struct {
         Whether zchunk file should be auto-chunked */
     int delsrc; /*!<
         Indicate if delete source file after successful compression. */
+    cr_CompressionOptions options; /*!<
+        Compression options (see cr_compressiontask_new_with_options) */
     GError *err; /*!<
         If error was encountered, it will be stored here, if no, then NULL*/
 } cr_CompressionTask;
 
 /** Function to prepare a new cr_CompressionTask.
+ * Default compression options are used, see
+ * cr_compressiontask_new_with_options().
  * @param src               Source filename.
  * @param dst               Destination filename or NULL (then src+compression
  *                          suffix will be used).
@@ -115,6 +119,25 @@ cr_compressiontask_new(const char *src,
                        int delsrc,
                        GError **err);
 
+/** Function to prepare a new cr_CompressionTask which compresses
+ * with the given options. See cr_compressiontask_new() for the other
+ * parameters.
+ * @param options           Compression options (copied, a dictionary
+ *                          has to live until the task is done) or NULL
+ *                          for the defaults.
+ * @return                  New cr_CompressionTask.
+ */
+cr_CompressionTask *
+cr_compressiontask_new_with_options(const char *src,
+                                    const char *dst,
+                                    cr_CompressionType compression_type,
+                                    cr_ChecksumType checksum_type,
+                                    const cr_CompressionOptions *options,
+                                    const char *zck_dict_dir,
+                                    gboolean zck_auto_chunk,
+                                    int delsrc,
+                                    GError **err);
+
 /** Frees cr_CompressionTask and all its components.
  * @param task      cr_CompressionTask task
  * @param err       GError **
@@ -161,6 +184,55 @@ cr_repomd_record_fill_thread(gpointer data, gpointer user_data);
 void
 cr_rewrite_pkg_count_thread(gpointer data, gpointer user_data);
 
+/** Object representing the whole chain of tasks for a single metadata file:
+ * compression (optional), fill of its repomd record and rename of the file
+ * to the unique (checksum prefixed) name (optional).
+ * Stages of one chain run one after another in a single worker, chains
+ * of different files run in parallel. So a fill of one record doesn't
+ * have to wait until all the other files are compressed.
+ */
+typedef struct {
+    cr_CompressionTask *compression; /*!< Compression task or NULL */
+    cr_RepomdRecord *record;        /*!< Repomd record of the resulting
+                                         (compressed) file */
+    cr_ChecksumType checksum_type;  /*!< Type of checksum to be used */
+    gboolean rename;                /*!< Rename the file to the unique
+                                         filename after the fill */
+    GError *err;                    /*!< Error of the first failed stage */
+} cr_RepomdRecordTask;
+
+/** Function to prepare a new cr_RepomdRecordTask.
+ * @param record            cr_RepomdRecord of the resulting file.
+ * @param compression       cr_CompressionTask which produces the file or
+ *                          NULL if the file already exists. The task
+ *                          is owned by the cr_RepomdRecordTask since now.
+ *                          Stats of the compression are loaded into
+ *                          the record (see
+ *                          cr_repomd_record_load_contentstat()).
+ * @param checksum_type     Type of checksum.
+ * @param rename            Rename the file (see
+ *                          cr_repomd_record_rename_file()).
+ * @param err               GError **
+ * @return                  New cr_RepomdRecordTask.
+ */
+cr_RepomdRecordTask *
+cr_repomdrecordtask_new(cr_RepomdRecord *record,
+                        cr_CompressionTask *compression,
+                        cr_ChecksumType checksum_type,
+                        gboolean rename,
+                        GError **err);
+
+/** Frees cr_RepomdRecordTask and its compression task (the record
+ * is not freed).
+ */
+void
+cr_repomdrecordtask_free(cr_RepomdRecordTask *task, GError **err);
+
+/** Function for GThread Pool.
+ */
+void
+cr_repomd_record_task_thread(gpointer data, gpointer user_data);
+
 /** @} */
 
 #ifdef __cplusplus
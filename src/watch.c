@@ -0,0 +1,291 @@
+/* createrepo_c - Library of routines for manipulation with repodata
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#include <glib.h>
+#include <assert.h>
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include "cleanup.h"
+#include "error.h"
+#include "watch.h"
+
+#define ERR_DOMAIN      CREATEREPO_C_ERROR
+#define WATCH_MASK      (IN_CLOSE_WRITE | IN_ATTRIB | IN_CREATE | IN_DELETE \
+                         | IN_MOVED_FROM | IN_MOVED_TO \
+                         | IN_DELETE_SELF | IN_MOVE_SELF)
+
+struct _cr_Watch {
+    int fd;                 // inotify file descriptor
+    GHashTable *dirs;       // Watch descriptor -> path of the directory
+    GSList *roots;          // Directories added by cr_watch_add_dir()
+    GSList *excludes;       // Patterns of excluded paths
+};
+
+cr_Watch *
+cr_watch_new(GError **err)
+{
+    cr_Watch *watch;
+    int fd;
+
+    assert(!err || *err == NULL);
+
+    fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd == -1) {
+        g_set_error(err, ERR_DOMAIN, CRE_IO,
+                    "Cannot initialize inotify: %s", g_strerror(errno));
+        return NULL;
+    }
+
+    watch = g_new0(cr_Watch, 1);
+    watch->fd = fd;
+    watch->dirs = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                        NULL, g_free);
+    return watch;
+}
+
+void
+cr_watch_exclude(cr_Watch *watch, const char *pattern)
+{
+    assert(watch);
+    assert(pattern);
+
+    watch->excludes = g_slist_prepend(watch->excludes, g_strdup(pattern));
+}
+
+static gboolean
+watch_excluded(cr_Watch *watch, const char *path)
+{
+    for (GSList *elem = watch->excludes; elem; elem = g_slist_next(elem))
+        if (g_pattern_match_simple(elem->data, path))
+            return TRUE;
+    return FALSE;
+}
+
+/** Watch the directory and (recursively) its subdirectories.
+ */
+static int
+watch_dir(cr_Watch *watch, const char *path, GError **err)
+{
+    GDir *dirp;
+    const gchar *name;
+    int wd, ret = CRE_OK;
+
+    if (watch_excluded(watch, path))
+        return CRE_OK;
+
+    wd = inotify_add_watch(watch->fd, path, WATCH_MASK | IN_ONLYDIR);
+    if (wd == -1) {
+        if (errno == ENOENT || errno == ENOTDIR)
+            // Removed (or replaced) in the meantime
+            return CRE_OK;
+        g_set_error(err, ERR_DOMAIN, CRE_IO,
+                    "Cannot watch %s: %s%s", path, g_strerror(errno),
+                    errno == ENOSPC ? " (see fs.inotify.max_user_watches)" : "");
+        return CRE_IO;
+    }
+
+    // The same directory reachable by a symlink is watched only once
+    if (g_hash_table_contains(watch->dirs, GINT_TO_POINTER(wd)))
+        return CRE_OK;
+    g_hash_table_insert(watch->dirs, GINT_TO_POINTER(wd), g_strdup(path));
+
+    dirp = g_dir_open(path, 0, NULL);
+    if (!dirp)
+        return CRE_OK;
+
+    while (ret == CRE_OK && (name = g_dir_read_name(dirp))) {
+        _cleanup_free_ gchar *full_path = NULL;
+
+        if (name[0] == '.')
+            continue;
+
+        full_path = g_build_filename(path, name, NULL);
+        if (g_file_test(full_path, G_FILE_TEST_IS_DIR))
+            ret = watch_dir(watch, full_path, err);
+    }
+
+    g_dir_close(dirp);
+    return ret;
+}
+
+int
+cr_watch_add_dir(cr_Watch *watch, const char *dir, GError **err)
+{
+    assert(watch);
+    assert(dir);
+    assert(!err || *err == NULL);
+
+    if (!g_file_test(dir, G_FILE_TEST_IS_DIR)) {
+        g_set_error(err, ERR_DOMAIN, CRE_NODIR,
+                    "Cannot watch %s: Not a directory", dir);
+        return CRE_NODIR;
+    }
+
+    watch->roots = g_slist_prepend(watch->roots, g_strdup(dir));
+    return watch_dir(watch, dir, err);
+}
+
+/** Read all pending events and add the changed paths into the set.
+ */
+static int
+watch_read_events(cr_Watch *watch, GHashTable *changed, GError **err)
+{
+    char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    GError *tmp_err = NULL;
+
+    while (1) {
+        ssize_t len = read(watch->fd, buf, sizeof(buf));
+        if (len == -1) {
+            if (errno == EAGAIN)
+                return CRE_OK;
+            if (errno == EINTR)
+                continue;
+            g_set_error(err, ERR_DOMAIN, CRE_IO,
+                        "Cannot read inotify events: %s", g_strerror(errno));
+            return CRE_IO;
+        }
+
+        for (char *ptr = buf; ptr < buf + len; ) {
+            const struct inotify_event *ev = (const struct inotify_event *) ptr;
+            const char *dir;
+            gchar *path;
+
+            ptr += sizeof(struct inotify_event) + ev->len;
+
+            if (ev->mask & IN_Q_OVERFLOW) {
+                // Some events were lost, everything could be changed and
+                // new directories could be missed
+                g_debug("%s: inotify queue overflow", __func__);
+                for (GSList *elem = watch->roots; elem; elem = g_slist_next(elem)) {
+                    g_hash_table_add(changed, g_strdup(elem->data));
+                    if (watch_dir(watch, elem->data, &tmp_err) != CRE_OK) {
+                        g_warning("%s", tmp_err->message);
+                        g_clear_error(&tmp_err);
+                    }
+                }
+                continue;
+            }
+
+            dir = g_hash_table_lookup(watch->dirs, GINT_TO_POINTER(ev->wd));
+            if (!dir)
+                continue;
+
+            if (ev->mask & IN_IGNORED) {
+                // The directory was removed
+                g_hash_table_remove(watch->dirs, GINT_TO_POINTER(ev->wd));
+                continue;
+            }
+
+            if (ev->len == 0) {
+                // Event of the watched directory itself
+                if (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF))
+                    g_hash_table_add(changed, g_strdup(dir));
+                continue;
+            }
+
+            if (ev->name[0] == '.')
+                continue;
+
+            path = g_build_filename(dir, ev->name, NULL);
+            if (watch_excluded(watch, path)) {
+                g_free(path);
+                continue;
+            }
+
+            if ((ev->mask & IN_ISDIR) && (ev->mask & (IN_CREATE | IN_MOVED_TO))
+                && watch_dir(watch, path, &tmp_err) != CRE_OK) {
+                g_warning("%s", tmp_err->message);
+                g_clear_error(&tmp_err);
+            }
+
+            g_hash_table_add(changed, path);
+        }
+    }
+}
+
+int
+cr_watch_wait(cr_Watch *watch,
+              gint timeout,
+              guint quiet,
+              GSList **changed,
+              GError **err)
+{
+    GHashTable *paths;
+    GHashTableIter iter;
+    gpointer key;
+    int ret = CRE_OK;
+
+    assert(watch);
+    assert(changed);
+    assert(!err || *err == NULL);
+
+    *changed = NULL;
+    paths = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+    while (1) {
+        struct pollfd pfd = { .fd = watch->fd, .events = POLLIN };
+        int rc;
+
+        // Once something changed, wait only until the burst is over
+        rc = poll(&pfd, 1, g_hash_table_size(paths) ? (int) quiet : timeout);
+        if (rc == -1) {
+            if (errno == EINTR)
+                continue;
+            g_set_error(err, ERR_DOMAIN, CRE_IO,
+                        "Cannot poll inotify: %s", g_strerror(errno));
+            ret = CRE_IO;
+            break;
+        }
+
+        if (rc == 0)
+            break;
+
+        ret = watch_read_events(watch, paths, err);
+        if (ret != CRE_OK)
+            break;
+    }
+
+    if (ret == CRE_OK) {
+        g_hash_table_iter_init(&iter, paths);
+        while (g_hash_table_iter_next(&iter, &key, NULL)) {
+            *changed = g_slist_prepend(*changed, key);
+            g_hash_table_iter_steal(&iter);
+        }
+        *changed = g_slist_sort(*changed, (GCompareFunc) g_strcmp0);
+    }
+
+    g_hash_table_destroy(paths);
+    return ret;
+}
+
+void
+cr_watch_free(cr_Watch *watch)
+{
+    if (!watch)
+        return;
+
+    close(watch->fd);
+    g_hash_table_destroy(watch->dirs);
+    g_slist_free_full(watch->roots, g_free);
+    g_slist_free_full(watch->excludes, g_free);
+    g_free(watch);
+}
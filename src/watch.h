@@ -0,0 +1,106 @@
+/* createrepo_c - Library of routines for manipulation with repodata
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#ifndef __C_CREATEREPOLIB_WATCH_H__
+#define __C_CREATEREPOLIB_WATCH_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <glib.h>
+
+/** \defgroup   watch       Watching of input directories
+ *  \addtogroup watch
+ *  @{
+ *
+ * Directory trees are watched by inotify. New subdirectories are watched
+ * as soon as they appear. Hidden entries (names starting with a dot, e.g.
+ * .repodata/ or temporary files of uploads) are ignored, a file uploaded
+ * under a hidden name is reported when it is renamed to its final name.
+ */
+
+/** Default quiet period (in milliseconds) that ends a burst of changes.
+ */
+#define CR_WATCH_DEFAULT_DELAY  2000
+
+/** Watcher of directory trees.
+ */
+typedef struct _cr_Watch cr_Watch;
+
+/** Create a new watcher without any watched directory.
+ * @param err           GError **
+ * @return              New cr_Watch or NULL
+ */
+cr_Watch *
+cr_watch_new(GError **err);
+
+/** Exclude paths matching the pattern. Excluded directories are not
+ * watched and changes of excluded paths are not reported. Has to be
+ * called before cr_watch_add_dir().
+ * @param watch         Watcher
+ * @param pattern       Glob pattern (see g_pattern_match_simple()) matched
+ *                      against the full path
+ */
+void
+cr_watch_exclude(cr_Watch *watch, const char *pattern);
+
+/** Watch the directory and all its subdirectories.
+ * @param watch         Watcher
+ * @param dir           Directory
+ * @param err           GError **
+ * @return              cr_Error code
+ */
+int
+cr_watch_add_dir(cr_Watch *watch, const char *dir, GError **err);
+
+/** Wait for changes. When the first change comes, changes are collected
+ * until there is none for the quiet period, so a burst of changes
+ * (e.g. an upload of many packages) is reported at once.
+ * @param watch         Watcher
+ * @param timeout       Max time (in milliseconds) to wait for the first
+ *                      change, -1 waits forever
+ * @param quiet         Quiet period in milliseconds
+ * @param changed       Sorted list of changed paths (without duplicates),
+ *                      empty if the timeout expired. If a directory is
+ *                      reported, anything inside it could be changed.
+ *                      Free it with g_slist_free_full(changed, g_free).
+ * @param err           GError **
+ * @return              cr_Error code
+ */
+int
+cr_watch_wait(cr_Watch *watch,
+              gint timeout,
+              guint quiet,
+              GSList **changed,
+              GError **err);
+
+/** Stop watching and free the watcher.
+ * @param watch         Watcher or NULL
+ */
+void
+cr_watch_free(cr_Watch *watch);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __C_CREATEREPOLIB_WATCH_H__ */
@@ -415,6 +415,9 @@ cr_xml_dump_int(cr_Package *pkg, gboolean filelists_ext, GError **err)
     if (!pkg)
         return result;
 
+    if (cr_package_load_lazy(pkg, err) != CRE_OK)
+        return result;
+
     if (cr_Package_contains_forbidden_control_chars(pkg)) {
         g_set_error(err, CREATEREPO_C_ERROR, CRE_XMLDATA,
                     "Forbidden control chars found (ASCII values <32 except 9, 10 and 13).");
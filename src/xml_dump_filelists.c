@@ -92,6 +92,9 @@ cr_xml_dump_filelists_chunk(cr_Package *package, gboolean filelists_ext, GError
         return NULL;
     }
 
+    if (cr_package_load_lazy(package, err) != CRE_OK)
+        return NULL;
+
 
     // Dump IT!
 
@@ -127,6 +127,9 @@ cr_xml_dump_other(cr_Package *package, GError **err)
         return NULL;
     }
 
+    if (cr_package_load_lazy(package, err) != CRE_OK)
+        return NULL;
+
 
     // Dump IT!
 
@@ -392,6 +392,9 @@ cr_xml_dump_primary(cr_Package *package, GError **err)
         return NULL;
     }
 
+    if (cr_package_load_lazy(package, err) != CRE_OK)
+        return NULL;
+
     // Dump IT!
 
     xmlBufferPtr buf = xmlBufferCreate();
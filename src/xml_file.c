@@ -20,6 +20,7 @@
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <assert.h>
+#include <string.h>
 #include <rpm/rpmstring.h>
 #include "xml_file.h"
 #include <errno.h>
@@ -28,6 +29,7 @@
 #include "compression_wrapper.h"
 #include "xml_dump_internal.h"
 #include "misc.h"
+#include "cleanup.h"
 
 #define ERR_DOMAIN               CREATEREPO_C_ERROR
 
@@ -56,12 +58,29 @@
 #define XML_PRESTODELTA_FOOTER   "</prestodelta>"
 #define XML_UPDATEINFO_FOOTER    "</updates>"
 
+#define XML_UPDATE_START         "<update"
+#define XML_UPDATE_END           "</update>"
+#define XML_UPDATE_ID_START      "<id>"
+#define XML_UPDATE_ID_END        "</id>"
+
 cr_XmlFile *
 cr_xmlfile_sopen(const char *filename,
                  cr_XmlFileType type,
                  cr_CompressionType comtype,
                  cr_ContentStat *stat,
                  GError **err)
+{
+    return cr_xmlfile_sopen_with_options(filename, type, comtype, stat,
+                                         NULL, err);
+}
+
+cr_XmlFile *
+cr_xmlfile_sopen_with_options(const char *filename,
+                              cr_XmlFileType type,
+                              cr_CompressionType comtype,
+                              cr_ContentStat *stat,
+                              const cr_CompressionOptions *options,
+                              GError **err)
 {
     cr_XmlFile *f;
     GError *tmp_err = NULL;
@@ -77,11 +96,12 @@ cr_xmlfile_sopen(const char *filename,
         return NULL;
     }
 
-    CR_FILE *cr_f = cr_sopen(filename,
-                             CR_CW_MODE_WRITE,
-                             comtype,
-                             stat,
-                             &tmp_err);
+    CR_FILE *cr_f = cr_sopen_with_options(filename,
+                                          CR_CW_MODE_WRITE,
+                                          comtype,
+                                          stat,
+                                          options,
+                                          &tmp_err);
     if (!cr_f) {
         g_propagate_prefixed_error(err, tmp_err, "Cannot open %s: ", filename);
         return NULL;
@@ -298,6 +318,213 @@ cr_xmlfile_add_chunk(cr_XmlFile *f, const char* chunk, GError **err)
     return CRE_OK;
 }
 
+int
+cr_xmlfile_add_updaterecord(cr_XmlFile *f, cr_UpdateRecord *rec, GError **err)
+{
+    char *xml;
+    GError *tmp_err = NULL;
+
+    assert(f);
+    assert(rec);
+    assert(!err || *err == NULL);
+    assert(f->footer == 0);
+
+    if (f->type != CR_XMLFILE_UPDATEINFO) {
+        g_critical("%s: Bad file type", __func__);
+        assert(0);
+        g_set_error(err, ERR_DOMAIN, CRE_ASSERT, "Bad file type");
+        return CRE_ASSERT;
+    }
+
+    xml = cr_xml_dump_updaterecord(rec, &tmp_err);
+    if (tmp_err) {
+        int code = tmp_err->code;
+        g_propagate_error(err, tmp_err);
+        g_free(xml);
+        return code;
+    }
+
+    cr_xmlfile_add_chunk(f, xml, &tmp_err);
+    g_free(xml);
+    if (tmp_err) {
+        int code = tmp_err->code;
+        g_propagate_error(err, tmp_err);
+        return code;
+    }
+
+    return CRE_OK;
+}
+
+/** Find start of the next update element in the buffer.
+ */
+static const char *
+find_raw_update_start(const char *buf, const char *buf_end)
+{
+    const char *start = buf;
+    size_t start_len = strlen(XML_UPDATE_START);
+
+    while ((start = g_strstr_len(start, buf_end - start, XML_UPDATE_START))) {
+        const char *next = start + start_len;
+        if (next >= buf_end)
+            // Don't know yet if it is <update> or <updates>
+            return NULL;
+        if (*next == '>' || g_ascii_isspace(*next))
+            return start;
+        start = next;
+    }
+
+    return NULL;
+}
+
+/** Return (escaped) id of a raw update element or NULL.
+ */
+static gchar *
+raw_update_id(const char *start, const char *end)
+{
+    const char *id, *id_end;
+
+    id = g_strstr_len(start, end - start, XML_UPDATE_ID_START);
+    if (!id)
+        return NULL;
+    id += strlen(XML_UPDATE_ID_START);
+    id_end = g_strstr_len(id, end - id, XML_UPDATE_ID_END);
+    if (!id_end)
+        return NULL;
+
+    return g_strndup(id, id_end - id);
+}
+
+/** Copy a raw update element from the old file, or write the record
+ * which replaces it.
+ */
+static int
+merge_raw_update(cr_XmlFile *f,
+                 const char *start,
+                 const char *end,
+                 GHashTable *new_ids,
+                 GError **err)
+{
+    _cleanup_free_ gchar *id = raw_update_id(start, end);
+    gpointer key, rec;
+
+    if (id && g_hash_table_lookup_extended(new_ids, id, &key, &rec)) {
+        if (!rec)
+            // Duplicate of an already replaced advisory
+            return CRE_OK;
+        // Write the new version in place of the old one
+        g_hash_table_insert(new_ids, g_strdup(id), NULL);
+        return cr_xmlfile_add_updaterecord(f, rec, err);
+    }
+
+    _cleanup_free_ gchar *chunk = g_strdup_printf("  %.*s\n",
+                                                  (int) (end - start), start);
+    return cr_xmlfile_add_chunk(f, chunk, err);
+}
+
+int
+cr_xmlfile_merge_updateinfo(cr_XmlFile *f,
+                            const char *old_path,
+                            cr_UpdateInfo *uinfo,
+                            GError **err)
+{
+    int ret = CRE_OK;
+    GError *tmp_err = NULL;
+    GHashTable *new_ids;
+
+    assert(f);
+    assert(f->type == CR_XMLFILE_UPDATEINFO);
+    assert(uinfo);
+    assert(!err || *err == NULL);
+
+    // Ids of the new records (escaped the same way as in the raw xml)
+    new_ids = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    for (GSList *elem = uinfo->updates; elem; elem = g_slist_next(elem)) {
+        cr_UpdateRecord *rec = elem->data;
+        if (rec->id)
+            g_hash_table_insert(new_ids,
+                                g_markup_escape_text(rec->id, -1),
+                                rec);
+    }
+
+    if (old_path) {
+        CR_FILE *old;
+        char readbuf[XML_RECOMPRESS_BUFFER_SIZE];
+        GString *buf = g_string_sized_new(2 * XML_RECOMPRESS_BUFFER_SIZE);
+        int readed;
+
+        old = cr_open(old_path, CR_CW_MODE_READ,
+                      CR_CW_AUTO_DETECT_COMPRESSION, &tmp_err);
+        if (!old) {
+            ret = tmp_err->code;
+            g_propagate_prefixed_error(err, tmp_err,
+                                       "Cannot open %s: ", old_path);
+            g_string_free(buf, TRUE);
+            g_hash_table_destroy(new_ids);
+            return ret;
+        }
+
+        // Untouched advisories are copied as they are, without parsing
+        do {
+            readed = cr_read(old, readbuf, sizeof(readbuf), &tmp_err);
+            if (readed == CR_CW_ERR) {
+                ret = tmp_err->code;
+                g_propagate_prefixed_error(err, tmp_err,
+                                           "Error while reading %s: ",
+                                           old_path);
+                break;
+            }
+            g_string_append_len(buf, readbuf, readed);
+
+            while (ret == CRE_OK) {
+                const char *buf_end = buf->str + buf->len;
+                const char *start = find_raw_update_start(buf->str, buf_end);
+                const char *end;
+
+                if (!start) {
+                    // Keep only a possible beginning of the next element
+                    gsize keep = MIN(buf->len, strlen(XML_UPDATE_START));
+                    g_string_erase(buf, 0, buf->len - keep);
+                    break;
+                }
+
+                end = g_strstr_len(start, buf_end - start, XML_UPDATE_END);
+                if (!end) {
+                    // Incomplete element, read more data
+                    g_string_erase(buf, 0, start - buf->str);
+                    break;
+                }
+                end += strlen(XML_UPDATE_END);
+
+                ret = merge_raw_update(f, start, end, new_ids, err);
+                g_string_erase(buf, 0, end - buf->str);
+            }
+        } while (readed > 0 && ret == CRE_OK);
+
+        g_string_free(buf, TRUE);
+        cr_close(old, NULL);
+    }
+
+    // Append the new advisories which didn't replace an old one
+    for (GSList *elem = uinfo->updates;
+         elem && ret == CRE_OK;
+         elem = g_slist_next(elem))
+    {
+        cr_UpdateRecord *rec = elem->data;
+
+        if (rec->id) {
+            _cleanup_free_ gchar *id = g_markup_escape_text(rec->id, -1);
+            if (g_hash_table_lookup(new_ids, id) != rec)
+                continue;
+        }
+
+        ret = cr_xmlfile_add_updaterecord(f, rec, err);
+    }
+
+    g_hash_table_destroy(new_ids);
+
+    return ret;
+}
+
 int
 cr_xmlfile_close(cr_XmlFile *f, GError **err)
 {
@@ -386,6 +613,26 @@ cr_rewrite_header_package_count(gchar *original_filename,
                                 cr_ContentStat *file_stat,
                                 gchar *zck_dict_file,
                                 GError **err)
+{
+    cr_rewrite_header_package_count_with_options(original_filename,
+                                                 xml_compression,
+                                                 package_count,
+                                                 task_count,
+                                                 file_stat,
+                                                 NULL,
+                                                 zck_dict_file,
+                                                 err);
+}
+
+void
+cr_rewrite_header_package_count_with_options(gchar *original_filename,
+                                             cr_CompressionType xml_compression,
+                                             int package_count,
+                                             int task_count,
+                                             cr_ContentStat *file_stat,
+                                             const cr_CompressionOptions *options,
+                                             gchar *zck_dict_file,
+                                             GError **err)
 {
     GError *tmp_err = NULL;
     CR_FILE *original_file = cr_open(original_filename, CR_CW_MODE_READ, CR_CW_AUTO_DETECT_COMPRESSION, &tmp_err);
@@ -395,10 +642,12 @@ cr_rewrite_header_package_count(gchar *original_filename,
     }
 
     gchar *tmp_xml_filename = g_strconcat(original_filename, ".tmp", NULL);
-    cr_XmlFile *new_file = cr_xmlfile_sopen_primary(tmp_xml_filename,
-                                                    xml_compression,
-                                                    file_stat,
-                                                    &tmp_err);
+    cr_XmlFile *new_file = cr_xmlfile_sopen_with_options(tmp_xml_filename,
+                                                         CR_XMLFILE_PRIMARY,
+                                                         xml_compression,
+                                                         file_stat,
+                                                         options,
+                                                         &tmp_err);
     if (tmp_err) {
         g_propagate_prefixed_error(err, tmp_err, "Error encountered while opening for writing:");
         cr_close(original_file, NULL); 
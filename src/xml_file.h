@@ -27,6 +27,7 @@ extern "C" {
 #include <glib.h>
 #include "compression_wrapper.h"
 #include "package.h"
+#include "updateinfo.h"
 
 /** \defgroup   xml_file        XML file API.
  *  \addtogroup xml_file
@@ -202,6 +203,22 @@ cr_XmlFile *cr_xmlfile_sopen(const char *filename,
                              cr_ContentStat *stat,
                              GError **err);
 
+/** Same as cr_xmlfile_sopen() but with compression options.
+ * @param filename      Filename.
+ * @param type          Type of XML file.
+ * @param comtype       Type of used compression.
+ * @param stat          pointer to cr_ContentStat or NULL
+ * @param options       compression options or NULL for defaults
+ * @param err           **GError
+ * @return              Opened cr_XmlFile or NULL on error
+ */
+cr_XmlFile *cr_xmlfile_sopen_with_options(const char *filename,
+                                          cr_XmlFileType type,
+                                          cr_CompressionType comtype,
+                                          cr_ContentStat *stat,
+                                          const cr_CompressionOptions *options,
+                                          GError **err);
+
 /** Set total number of packages that will be in the file.
  * This number must be set before any write operation
  * (cr_xml_add_pkg, cr_xml_file_add_chunk, ..).
@@ -234,6 +251,36 @@ int cr_xmlfile_add_pkg(cr_XmlFile *f, cr_Package *pkg, GError **err);
  */
 int cr_xmlfile_add_chunk(cr_XmlFile *f, const char *chunk, GError **err);
 
+/** Add update record to the updateinfo xml file. Together with
+ * cr_xml_parse_updateinfo_with_cb() it allows to process updateinfo
+ * one record at a time.
+ * @param f             An opened cr_XmlFile (CR_XMLFILE_UPDATEINFO)
+ * @param rec           Update record.
+ * @param err           **GError
+ * @return              cr_Error code
+ */
+int cr_xmlfile_add_updaterecord(cr_XmlFile *f,
+                                cr_UpdateRecord *rec,
+                                GError **err);
+
+/** Write update records from the old updateinfo.xml merged with
+ * the new ones into the updateinfo xml file.
+ * Advisories of the old file whose id doesn't match any new record are
+ * copied through as raw XML (they are not parsed nor serialized again).
+ * A new record with the id of an old advisory replaces it in place,
+ * the remaining new records are appended at the end.
+ * @param f             An opened cr_XmlFile (CR_XMLFILE_UPDATEINFO)
+ * @param old_path      Path to the old updateinfo.xml (could be compressed)
+ *                      or NULL
+ * @param uinfo         New and changed update records
+ * @param err           **GError
+ * @return              cr_Error code
+ */
+int cr_xmlfile_merge_updateinfo(cr_XmlFile *f,
+                                const char *old_path,
+                                cr_UpdateInfo *uinfo,
+                                GError **err);
+
 /** Close an opened cr_XmlFile.
  * @param f             An opened cr_XmlFile
  * @param err           **GError
@@ -258,6 +305,26 @@ void cr_rewrite_header_package_count(gchar *original_filename,
                                      cr_ContentStat *file_stat,
                                      gchar *zck_dict_file,
                                      GError **err);
+
+/** Same as cr_rewrite_header_package_count() but the new file is
+ * compressed with the compression options.
+ * @param original_filename     Current file with wrong value in header
+ * @param xml_compression       Compression of the file
+ * @param package_count         Actual package count (desired value in header)
+ * @param task_count            Task count (current value in header)
+ * @param file_stat             cr_ContentStat for stats of the new file, it will be modified
+ * @param options               Compression options or NULL for defaults
+ * @param zck_dict_file         Optional path to zck dictionary
+ * @param err                   **GError
+ */
+void cr_rewrite_header_package_count_with_options(gchar *original_filename,
+                                                  cr_CompressionType xml_compression,
+                                                  int package_count,
+                                                  int task_count,
+                                                  cr_ContentStat *file_stat,
+                                                  const cr_CompressionOptions *options,
+                                                  gchar *zck_dict_file,
+                                                  GError **err);
  
 
 /** @} */
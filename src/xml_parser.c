@@ -50,6 +50,7 @@ cr_xml_parser_data_free(cr_ParserData *pd)
     if (pd->parser) {
         xmlFreeParserCtxt(pd->parser);
     }
+    cr_package_free(pd->filter_pkg);
     g_free(pd->content);
     g_free(pd->swtab);
     g_free(pd->sbtab);
@@ -163,6 +164,47 @@ cr_newpkgcb(cr_Package **pkg,
     return CR_CB_RET_OK;
 }
 
+void
+cr_xml_parser_move_package_data(cr_Package *source, cr_Package *target)
+{
+    assert(source);
+    assert(target);
+
+    if (!target->pkgId)
+        target->pkgId = cr_safe_string_chunk_insert(target->chunk, source->pkgId);
+    if (!target->name)
+        target->name = cr_safe_string_chunk_insert(target->chunk, source->name);
+    if (!target->arch)
+        target->arch = cr_safe_string_chunk_insert(target->chunk, source->arch);
+    if (!target->epoch)
+        target->epoch = cr_safe_string_chunk_insert(target->chunk, source->epoch);
+    if (!target->version)
+        target->version = cr_safe_string_chunk_insert(target->chunk, source->version);
+    if (!target->release)
+        target->release = cr_safe_string_chunk_insert(target->chunk, source->release);
+    if (source->files_checksum_type)
+        target->files_checksum_type = cr_safe_string_chunk_insert(target->chunk,
+                                                source->files_checksum_type);
+
+    // file->type is a static string
+    for (GSList *elem = source->files; elem; elem = g_slist_next(elem)) {
+        cr_PackageFile *file = elem->data;
+        file->path   = cr_safe_string_chunk_insert_const(target->chunk, file->path);
+        file->name   = cr_safe_string_chunk_insert(target->chunk, file->name);
+        file->digest = cr_safe_string_chunk_insert(target->chunk, file->digest);
+    }
+    target->files = g_slist_concat(target->files, source->files);
+    source->files = NULL;
+
+    for (GSList *elem = source->changelogs; elem; elem = g_slist_next(elem)) {
+        cr_ChangelogEntry *log = elem->data;
+        log->author    = cr_safe_string_chunk_insert(target->chunk, log->author);
+        log->changelog = cr_safe_string_chunk_insert(target->chunk, log->changelog);
+    }
+    target->changelogs = g_slist_concat(target->changelogs, source->changelogs);
+    source->changelogs = NULL;
+}
+
 int
 cr_xml_parser_generic(xmlParserCtxtPtr parser,
                       cr_ParserData *pd,
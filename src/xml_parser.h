@@ -82,6 +82,18 @@ typedef int (*cr_XmlParserPkgCb)(cr_Package *pkg,
                                  void *cbdata,
                                  GError **err);
 
+/** Callback for XML parser which is called when an update element of
+ * updateinfo.xml is parsed. The record is handed over to the callback,
+ * which is responsible for freeing it (also when it returns an error).
+ * @param rec       Currently parsed update record.
+ * @param cbdata    User data.
+ * @param err       GError **
+ * @return          CR_CB_RET_OK (0) or CR_CB_RET_ERR (1) - stops the parsing
+ */
+typedef int (*cr_XmlParserUpdateRecordCb)(cr_UpdateRecord *rec,
+                                          void *cbdata,
+                                          GError **err);
+
 /** Callback for XML parser warnings. All reported warnings are non-fatal,
  * and ignored by default. But if callback return CR_CB_RET_ERR instead of
  * CR_CB_RET_OK then parsing is immediately interrupted.
@@ -97,6 +109,74 @@ typedef int (*cr_XmlParserWarningCb)(cr_XmlParserWarningType type,
                                      void *cbdata,
                                      GError **err);
 
+/** Declarative filter of packages. It is evaluated by the parsers as soon
+ * as the values it looks at are parsed, a rejected package is skipped
+ * without calling the newpkgcb for it (the same way as if the newpkgcb
+ * returned NULL) and the rest of its element is not processed.
+ * A package has to match all rules, a rule without any values matches
+ * every package. Filelists and other xml contain only name and arch
+ * of a package, so only these rules are applied to them.
+ */
+typedef struct _cr_XmlFilter cr_XmlFilter;
+
+/** Create a new filter which matches all packages.
+ * @return              New cr_XmlFilter
+ */
+cr_XmlFilter *cr_xml_filter_new(void);
+
+/** Allow packages with the architecture.
+ * @param filter        cr_XmlFilter
+ * @param arch          Architecture (e.g. "x86_64", "noarch")
+ */
+void cr_xml_filter_add_arch(cr_XmlFilter *filter, const char *arch);
+
+/** Allow packages which name matches the glob.
+ * @param filter        cr_XmlFilter
+ * @param glob          Glob pattern (e.g. "kernel*")
+ */
+void cr_xml_filter_add_name_glob(cr_XmlFilter *filter, const char *glob);
+
+/** Allow packages with the location. Only base filenames are compared.
+ * @param filter        cr_XmlFilter
+ * @param href          Location href or base filename of the rpm
+ */
+void cr_xml_filter_add_href(cr_XmlFilter *filter, const char *href);
+
+/** Reject packages built from the source package.
+ * @param filter        cr_XmlFilter
+ * @param srpm_name     Name of the source package (not a filename)
+ */
+void cr_xml_filter_add_blocked_srpm(cr_XmlFilter *filter,
+                                    const char *srpm_name);
+
+/** Check values of a package against the filter. Rules for values which
+ * are NULL (not known) are not evaluated.
+ * @param filter        cr_XmlFilter or NULL (matches all)
+ * @param name          Package name or NULL
+ * @param arch          Package arch or NULL
+ * @param location_href Package location or NULL
+ * @param sourcerpm     Package sourcerpm or NULL
+ * @return              FALSE if the package is rejected
+ */
+gboolean cr_xml_filter_match(const cr_XmlFilter *filter,
+                             const char *name,
+                             const char *arch,
+                             const char *location_href,
+                             const char *sourcerpm);
+
+/** Check a package against the filter, see cr_xml_filter_match().
+ * @param filter        cr_XmlFilter or NULL (matches all)
+ * @param pkg           cr_Package
+ * @return              FALSE if the package is rejected
+ */
+gboolean cr_xml_filter_match_package(const cr_XmlFilter *filter,
+                                     cr_Package *pkg);
+
+/** Free the filter.
+ * @param filter        cr_XmlFilter or NULL
+ */
+void cr_xml_filter_free(cr_XmlFilter *filter);
+
 /** Parse primary.xml. File could be compressed.
  * @param path           Path to filelists.xml
  * @param newpkgcb       Callback for new package (Called when new package
@@ -123,6 +203,38 @@ int cr_xml_parse_primary(const char *path,
                          int do_files,
                          GError **err);
 
+/** Parse primary.xml like cr_xml_parse_primary(), but skip packages
+ * rejected by the filter. Until the filter can decide about a package
+ * (all the values it looks at are parsed), the package is parsed into
+ * a package owned by the parser, so the newpkgcb is called with name and
+ * arch of the package (pkgId is the type of the package, like by
+ * cr_xml_parse_primary()) and only for the packages which are accepted.
+ * Errors and warnings inside of rejected packages are not reported.
+ * @param path           Path to primary.xml
+ * @param filter         cr_XmlFilter or NULL
+ * @param newpkgcb       Callback for new package. If NULL cr_newpkgcb
+ *                       is used.
+ * @param newpkgcb_data  User data for the newpkgcb.
+ * @param pkgcb          Package callback. Could be NULL if newpkgcb is
+ *                       not NULL.
+ * @param pkgcb_data     User data for the pkgcb.
+ * @param warningcb      Callback for warning messages.
+ * @param warningcb_data User data for the warningcb.
+ * @param do_files       0 - Ignore file tags in primary.xml.
+ * @param err            GError **
+ * @return               cr_Error code.
+ */
+int cr_xml_parse_primary_filtered(const char *path,
+                                  const cr_XmlFilter *filter,
+                                  cr_XmlParserNewPkgCb newpkgcb,
+                                  void *newpkgcb_data,
+                                  cr_XmlParserPkgCb pkgcb,
+                                  void *pkgcb_data,
+                                  cr_XmlParserWarningCb warningcb,
+                                  void *warningcb_data,
+                                  int do_files,
+                                  GError **err);
+
 /** Parse string snippet of primary xml repodata. Snippet cannot contain
  * root xml element <metadata>. It contains only <package> elemetns.
  * @param xml_string     String containg primary xml data
@@ -174,6 +286,90 @@ int cr_xml_parse_filelists(const char *path,
                            void *warningcb_data,
                            GError **err);
 
+/** Parse filelists[_ext].xml by a pool of threads. File could be
+ * compressed. The decompressed file is split into large blocks of whole
+ * package elements which are parsed in parallel. The callbacks are called
+ * from the caller thread with the same arguments and in the same order as
+ * by cr_xml_parse_filelists(), the only difference is that a package is
+ * already parsed when the newpkgcb is called for it, its data are then
+ * moved into the package returned by the newpkgcb.
+ * @param path           Path to filelists[_ext].xml
+ * @param newpkgcb       Callback for new package. If NULL cr_newpkgcb
+ *                       is used.
+ * @param newpkgcb_data  User data for the newpkgcb.
+ * @param pkgcb          Package callback. Could be NULL if newpkgcb is
+ *                       not NULL.
+ * @param pkgcb_data     User data for the pkgcb.
+ * @param warningcb      Callback for warning messages.
+ * @param warningcb_data User data for the warningcb.
+ * @param threads        Number of parser threads, if < 1 the number
+ *                       of processors is used.
+ * @param err            GError **
+ * @return               cr_Error code.
+ */
+int cr_xml_parse_filelists_parallel(const char *path,
+                                    cr_XmlParserNewPkgCb newpkgcb,
+                                    void *newpkgcb_data,
+                                    cr_XmlParserPkgCb pkgcb,
+                                    void *pkgcb_data,
+                                    cr_XmlParserWarningCb warningcb,
+                                    void *warningcb_data,
+                                    int threads,
+                                    GError **err);
+
+/** Parse filelists[_ext].xml by a tokenizer specialized for the repodata
+ * schema. File could be compressed. Callbacks are called with the same
+ * arguments and in the same order as by cr_xml_parse_filelists(). Input
+ * which is not handled by the tokenizer (comments, unknown elements,
+ * other encodings, ...) is parsed by libxml2 since that place.
+ * @param path           Path to filelists[_ext].xml
+ * @param newpkgcb       Callback for new package. If NULL cr_newpkgcb
+ *                       is used.
+ * @param newpkgcb_data  User data for the newpkgcb.
+ * @param pkgcb          Package callback. Could be NULL if newpkgcb is
+ *                       not NULL.
+ * @param pkgcb_data     User data for the pkgcb.
+ * @param warningcb      Callback for warning messages.
+ * @param warningcb_data User data for the warningcb.
+ * @param err            GError **
+ * @return               cr_Error code.
+ */
+int cr_xml_parse_filelists_fast(const char *path,
+                                cr_XmlParserNewPkgCb newpkgcb,
+                                void *newpkgcb_data,
+                                cr_XmlParserPkgCb pkgcb,
+                                void *pkgcb_data,
+                                cr_XmlParserWarningCb warningcb,
+                                void *warningcb_data,
+                                GError **err);
+
+/** Parse filelists[_ext].xml like cr_xml_parse_filelists_fast(), but skip
+ * packages rejected by the filter. Elements of rejected packages are
+ * skipped by the tokenizer without being parsed, so errors inside them
+ * are not reported.
+ * @param path           Path to filelists[_ext].xml
+ * @param filter         cr_XmlFilter or NULL
+ * @param newpkgcb       Callback for new package. If NULL cr_newpkgcb
+ *                       is used.
+ * @param newpkgcb_data  User data for the newpkgcb.
+ * @param pkgcb          Package callback. Could be NULL if newpkgcb is
+ *                       not NULL.
+ * @param pkgcb_data     User data for the pkgcb.
+ * @param warningcb      Callback for warning messages.
+ * @param warningcb_data User data for the warningcb.
+ * @param err            GError **
+ * @return               cr_Error code.
+ */
+int cr_xml_parse_filelists_filtered(const char *path,
+                                    const cr_XmlFilter *filter,
+                                    cr_XmlParserNewPkgCb newpkgcb,
+                                    void *newpkgcb_data,
+                                    cr_XmlParserPkgCb pkgcb,
+                                    void *pkgcb_data,
+                                    cr_XmlParserWarningCb warningcb,
+                                    void *warningcb_data,
+                                    GError **err);
+
 /** Parse string snippet of filelists[_ext] xml repodata. Snippet cannot contain
  * root xml element <filelists[_ext]>. It contains only <package> elemetns.
  * @param xml_string     String containg filelists[_ext] xml data
@@ -223,6 +419,84 @@ int cr_xml_parse_other(const char *path,
                        void *warningcb_data,
                        GError **err);
 
+/** Parse other.xml by a pool of threads. File could be compressed.
+ * Callbacks are called the same way as by cr_xml_parse_other(),
+ * see cr_xml_parse_filelists_parallel() for details.
+ * @param path           Path to other.xml
+ * @param newpkgcb       Callback for new package. If NULL cr_newpkgcb
+ *                       is used.
+ * @param newpkgcb_data  User data for the newpkgcb.
+ * @param pkgcb          Package callback. Could be NULL if newpkgcb is
+ *                       not NULL.
+ * @param pkgcb_data     User data for the pkgcb.
+ * @param warningcb      Callback for warning messages.
+ * @param warningcb_data User data for the warningcb.
+ * @param threads        Number of parser threads, if < 1 the number
+ *                       of processors is used.
+ * @param err            GError **
+ * @return               cr_Error code.
+ */
+int cr_xml_parse_other_parallel(const char *path,
+                                cr_XmlParserNewPkgCb newpkgcb,
+                                void *newpkgcb_data,
+                                cr_XmlParserPkgCb pkgcb,
+                                void *pkgcb_data,
+                                cr_XmlParserWarningCb warningcb,
+                                void *warningcb_data,
+                                int threads,
+                                GError **err);
+
+/** Parse other.xml by a tokenizer specialized for the repodata schema.
+ * File could be compressed. Callbacks are called the same way as by
+ * cr_xml_parse_other(), see cr_xml_parse_filelists_fast() for details.
+ * @param path           Path to other.xml
+ * @param newpkgcb       Callback for new package. If NULL cr_newpkgcb
+ *                       is used.
+ * @param newpkgcb_data  User data for the newpkgcb.
+ * @param pkgcb          Package callback. Could be NULL if newpkgcb is
+ *                       not NULL.
+ * @param pkgcb_data     User data for the pkgcb.
+ * @param warningcb      Callback for warning messages.
+ * @param warningcb_data User data for the warningcb.
+ * @param err            GError **
+ * @return               cr_Error code.
+ */
+int cr_xml_parse_other_fast(const char *path,
+                            cr_XmlParserNewPkgCb newpkgcb,
+                            void *newpkgcb_data,
+                            cr_XmlParserPkgCb pkgcb,
+                            void *pkgcb_data,
+                            cr_XmlParserWarningCb warningcb,
+                            void *warningcb_data,
+                            GError **err);
+
+/** Parse other.xml like cr_xml_parse_other_fast(), but skip
+ * packages rejected by the filter. Elements of rejected packages are
+ * skipped by the tokenizer without being parsed, so errors inside them
+ * are not reported.
+ * @param path           Path to other.xml
+ * @param filter         cr_XmlFilter or NULL
+ * @param newpkgcb       Callback for new package. If NULL cr_newpkgcb
+ *                       is used.
+ * @param newpkgcb_data  User data for the newpkgcb.
+ * @param pkgcb          Package callback. Could be NULL if newpkgcb is
+ *                       not NULL.
+ * @param pkgcb_data     User data for the pkgcb.
+ * @param warningcb      Callback for warning messages.
+ * @param warningcb_data User data for the warningcb.
+ * @param err            GError **
+ * @return               cr_Error code.
+ */
+int cr_xml_parse_other_filtered(const char *path,
+                                const cr_XmlFilter *filter,
+                                cr_XmlParserNewPkgCb newpkgcb,
+                                void *newpkgcb_data,
+                                cr_XmlParserPkgCb pkgcb,
+                                void *pkgcb_data,
+                                cr_XmlParserWarningCb warningcb,
+                                void *warningcb_data,
+                                GError **err);
+
 /** Parse string snippet of other xml repodata. Snippet cannot contain
  * root xml element <otherdata>. It contains only <package> elemetns.
  * @param xml_string     String containg other xml data
@@ -278,8 +552,45 @@ cr_xml_parse_updateinfo(const char *path,
                         void *warningcb_data,
                         GError **err);
 
+/** Parse updateinfo.xml one update record at a time. File could be
+ * compressed. Unlike cr_xml_parse_updateinfo() no cr_UpdateInfo is built,
+ * every parsed record is passed to the updaterecordcb instead, so memory
+ * usage doesn't grow with the number of advisories.
+ * @param path                  Path to updateinfo.xml
+ * @param updaterecordcb        Update record callback.
+ * @param updaterecordcb_data   User data for the updaterecordcb.
+ * @param warningcb             Callback for warning messages.
+ * @param warningcb_data        User data for the warningcb.
+ * @param err                   GError **
+ * @return                      cr_Error code.
+ */
+int
+cr_xml_parse_updateinfo_with_cb(const char *path,
+                                cr_XmlParserUpdateRecordCb updaterecordcb,
+                                void *updaterecordcb_data,
+                                cr_XmlParserWarningCb warningcb,
+                                void *warningcb_data,
+                                GError **err);
+
 typedef struct _cr_PkgIterator cr_PkgIterator;
 
+/** Iterator over packages parsed from primary, filelists and other xml
+ * files at once. Files could be compressed. Filelists and other are
+ * optional.
+ * When neither newpkgcb nor warningcb is specified, every file is parsed
+ * by its own background thread (at most a few dozens of packages ahead)
+ * and cr_PkgIterator_parse_next() only joins parts of a package.
+ * Otherwise the files are parsed in the caller thread.
+ * @param primary_path      Path to a primary xml file
+ * @param filelists_path    Path to a filelists xml file or NULL
+ * @param other_path        Path to an other xml file or NULL
+ * @param newpkgcb          Callback for a new package or NULL.
+ * @param newpkgcb_data     User data for the newpkgcb.
+ * @param warningcb         Callback for warning messages or NULL.
+ * @param warningcb_data    User data for the warningcb.
+ * @param err               GError **
+ * @return                  cr_PkgIterator or NULL on error
+ */
 cr_PkgIterator *
 cr_PkgIterator_new(const char *primary_path,
                    const char *filelists_path,
@@ -0,0 +1,1310 @@
+/* createrepo_c - Library of routines for manipulation with repodata
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#include <glib.h>
+#include <assert.h>
+#include <string.h>
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define FAST_X86_SIMD   1   // SSE2/AVX2 selected at runtime
+#include <immintrin.h>
+#endif
+#include "error.h"
+#include "xml_parser.h"
+#include "xml_parser_internal.h"
+#include "misc.h"
+
+#define ERR_DOMAIN      CREATEREPO_C_ERROR
+#define READ_SIZE       (256 * 1024)
+#define MAX_ATTRS       3   // Max known attributes of an element
+#define MAX_SEEN_ATTRS  16  // Max attributes of an element
+
+/* Fast parsing of filelists[_ext].xml and other.xml
+ * ==================================================
+ * The tokenizer knows only the elements and attributes of the repodata
+ * schema and works directly on the decompressed buffer: it looks for
+ * the interesting bytes ('<', '&', quotes...) with SIMD instructions
+ * (AVX2 or SSE2 on x86, picked by the running CPU; byte by byte on other
+ * architectures),
+ * matches element and attribute names against static tables and
+ * remembers just pointers into the buffer. A package is tokenized
+ * whole at first, then its values are decoded and terminated in place
+ * and passed to the callbacks.
+ *
+ * Everything what would make the libxml2 parser emit a warning or an
+ * error, or what could be interpreted differently by it (comments,
+ * CDATA, unknown elements, other encodings, CR characters, "&amp;"
+ * in attributes, ...) is "unexpected". When an unexpected input is
+ * found, the rest of the file starting by the current package is
+ * parsed by the regular libxml2 parser, fed by the prolog of the file
+ * first, so the results and callbacks are always the same.
+ */
+
+typedef enum {
+    FAST_OK,
+    FAST_MORE,          // Data ended, more input is needed
+    FAST_UNEXPECTED,    // Input which has to be parsed by libxml2
+} cr_FastResult;
+
+typedef enum {
+    FAST_STATE_PROLOG,
+    FAST_STATE_BODY,
+    FAST_STATE_EPILOG,
+    FAST_STATE_DONE,
+    FAST_STATE_FALLBACK,
+} cr_FastState;
+
+typedef enum {
+    ELEM_OTHER,
+    ELEM_VERSION,
+    ELEM_CHECKSUM,
+    ELEM_FILE,
+    ELEM_CHANGELOG,
+} cr_FastElementId;
+
+/** Element of the schema.
+ */
+typedef struct {
+    const char          *name;
+    cr_FastElementId    id;
+    const char          *attrs[MAX_ATTRS];  // Known attributes
+    gboolean            text;               // Has a text content
+} cr_FastElement;
+
+/** Part of the buffer. str == NULL for a missing value.
+ */
+typedef struct {
+    const char  *str;
+    gsize       len;
+    gboolean    refs;   // Contains entity or character references
+} cr_Slice;
+
+typedef struct {
+    const cr_FastElement    *element;
+    cr_Slice                attrs[MAX_ATTRS];
+    int                     unknown_attrs;
+    cr_Slice                text;
+} cr_FastToken;
+
+typedef struct {
+    cr_XmlFastSchema        type;
+    const char              *roots[3];      // Names of the root element
+    const cr_FastElement    *elements;      // Sub elements of a package
+    cr_ParserData *(*parser_data_new)(cr_XmlParserNewPkgCb, void *,
+                                      cr_XmlParserPkgCb, void *,
+                                      cr_XmlParserWarningCb, void *);
+} cr_FastSchema;
+
+static const cr_FastElement xml_declaration =
+    { "xml", ELEM_OTHER, { "version", "encoding", "standalone" }, FALSE };
+
+static const cr_FastElement package_element =
+    { "package", ELEM_OTHER, { "pkgid", "name", "arch" }, FALSE };
+
+/* Performance tip: More frequent elements are listed first */
+static const cr_FastElement filelists_elements[] = {
+    { "file",       ELEM_FILE,      { "type", "cpeid", NULL },      TRUE },
+    { "version",    ELEM_VERSION,   { "epoch", "ver", "rel" },      FALSE },
+    { "checksum",   ELEM_CHECKSUM,  { "type", NULL, NULL },         FALSE },
+    { NULL,         ELEM_OTHER,     { NULL, NULL, NULL },           FALSE },
+};
+
+static const cr_FastElement other_elements[] = {
+    { "changelog",  ELEM_CHANGELOG, { "author", "date", NULL },     TRUE },
+    { "version",    ELEM_VERSION,   { "epoch", "ver", "rel" },      FALSE },
+    { NULL,         ELEM_OTHER,     { NULL, NULL, NULL },           FALSE },
+};
+
+static const cr_FastSchema schemas[] = {
+    { CR_XML_FAST_FILELISTS, { "filelists", "filelists-ext", NULL },
+      filelists_elements, filelists_parser_data_new },
+    { CR_XML_FAST_OTHER, { "otherdata", NULL, NULL },
+      other_elements, other_parser_data_new },
+};
+
+typedef struct {
+    const char              *path;
+    const cr_FastSchema     *schema;
+    cr_XmlParserNewPkgCb    newpkgcb;
+    void                    *newpkgcb_data;
+    cr_XmlParserPkgCb       pkgcb;
+    void                    *pkgcb_data;
+    cr_XmlParserWarningCb   warningcb;
+    void                    *warningcb_data;
+    const cr_XmlFilter      *filter;
+
+    CR_FILE     *f;
+    GString     *data;          // Decompressed data
+    gsize       pos;            // Parsed part of the data
+    gint64      offset;         // Offset of the data in the file
+    gboolean    eof;
+    gint64      newlines;       // Newlines before pos
+    gchar       *prolog;        // Everything up to the root start tag
+    gint64      prolog_newlines;
+    const char  *root;          // Name of the root element
+    gboolean    main_tag_found;
+
+    cr_FastToken    package;    // Currently parsed package
+    GArray          *tokens;    // cr_FastToken of its sub elements
+} cr_FastParser;
+
+/** Bytes which end a text or an attribute value or which need
+ * a closer look.
+ */
+static const guint8 special_chars[256] = {
+    [0x00 ... 0x1f] = 1,
+    ['"'] = 1,
+    ['&'] = 1,
+    ['<'] = 1,
+    ['>'] = 1,
+    [0x80 ... 0xff] = 1,
+};
+
+static inline const char *
+scan_special_bytes(const char *p, const char *end)
+{
+    while (p < end && !special_chars[(guint8) *p])
+        p++;
+
+    return p;
+}
+
+#ifdef FAST_X86_SIMD
+__attribute__((target("avx2")))
+static const char *
+scan_special_avx2(const char *p, const char *end)
+{
+    const __m256i lt   = _mm256_set1_epi8('<');
+    const __m256i amp  = _mm256_set1_epi8('&');
+    const __m256i quot = _mm256_set1_epi8('"');
+    const __m256i gt   = _mm256_set1_epi8('>');
+    const __m256i sp   = _mm256_set1_epi8(' ');
+
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *) p);
+        __m256i m = _mm256_or_si256(
+                        _mm256_or_si256(_mm256_cmpeq_epi8(v, lt),
+                                        _mm256_cmpeq_epi8(v, amp)),
+                        _mm256_or_si256(_mm256_cmpeq_epi8(v, quot),
+                                        _mm256_cmpeq_epi8(v, gt)));
+        // Signed comparison, bytes >= 0x80 are negative
+        m = _mm256_or_si256(m, _mm256_cmpgt_epi8(sp, v));
+        unsigned int mask = (unsigned int) _mm256_movemask_epi8(m);
+        if (mask)
+            return p + __builtin_ctz(mask);
+        p += 32;
+    }
+
+    return scan_special_bytes(p, end);
+}
+
+__attribute__((target("sse2")))
+static const char *
+scan_special_sse2(const char *p, const char *end)
+{
+    const __m128i lt   = _mm_set1_epi8('<');
+    const __m128i amp  = _mm_set1_epi8('&');
+    const __m128i quot = _mm_set1_epi8('"');
+    const __m128i gt   = _mm_set1_epi8('>');
+    const __m128i sp   = _mm_set1_epi8(' ');
+
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *) p);
+        __m128i m = _mm_or_si128(
+                        _mm_or_si128(_mm_cmpeq_epi8(v, lt),
+                                     _mm_cmpeq_epi8(v, amp)),
+                        _mm_or_si128(_mm_cmpeq_epi8(v, quot),
+                                     _mm_cmpeq_epi8(v, gt)));
+        // Signed comparison, bytes >= 0x80 are negative
+        m = _mm_or_si128(m, _mm_cmplt_epi8(v, sp));
+        unsigned int mask = (unsigned int) _mm_movemask_epi8(m);
+        if (mask)
+            return p + __builtin_ctz(mask);
+        p += 16;
+    }
+
+    return scan_special_bytes(p, end);
+}
+#endif /* FAST_X86_SIMD */
+
+static cr_XmlFastSimd fast_simd = CR_XML_FAST_SIMD_NONE;
+static gsize fast_simd_initialized = 0;
+
+/** Best SIMD instructions supported by the running CPU.
+ */
+static cr_XmlFastSimd
+detect_simd(void)
+{
+#ifdef FAST_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return CR_XML_FAST_SIMD_AVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return CR_XML_FAST_SIMD_SSE2;
+#endif
+    return CR_XML_FAST_SIMD_NONE;
+}
+
+static void
+init_simd(void)
+{
+    if (g_once_init_enter(&fast_simd_initialized)) {
+        fast_simd = detect_simd();
+        g_debug("%s: Using SIMD level %d", __func__, fast_simd);
+        g_once_init_leave(&fast_simd_initialized, 1);
+    }
+}
+
+gboolean
+cr_xml_parser_fast_set_simd(cr_XmlFastSimd simd)
+{
+    init_simd();
+    if (simd > detect_simd())
+        return FALSE;
+    fast_simd = simd;
+    return TRUE;
+}
+
+cr_XmlFastSimd
+cr_xml_parser_fast_get_simd(void)
+{
+    init_simd();
+    return fast_simd;
+}
+
+/** Find the first special byte ('<', '&', '"', '>', control characters
+ * and non-ASCII bytes).
+ * @return      Pointer to the byte or end.
+ */
+static inline const char *
+scan_special(const char *p, const char *end)
+{
+#ifdef FAST_X86_SIMD
+    if (fast_simd == CR_XML_FAST_SIMD_AVX2)
+        return scan_special_avx2(p, end);
+    if (fast_simd == CR_XML_FAST_SIMD_SSE2)
+        return scan_special_sse2(p, end);
+#endif
+    return scan_special_bytes(p, end);
+}
+
+static inline gboolean
+is_space(char c)
+{
+    // '\r' is unexpected, libxml2 normalizes line ends
+    return c == ' ' || c == '\n' || c == '\t';
+}
+
+static inline const char *
+skip_spaces(const char *p, const char *end)
+{
+    while (p < end && is_space(*p))
+        p++;
+    return p;
+}
+
+static inline gboolean
+is_name_char(char c)
+{
+    return g_ascii_isalnum(c) || c == '_' || c == ':' || c == '.' || c == '-';
+}
+
+static inline gboolean
+slice_is(const cr_Slice *slice, const char *str)
+{
+    gsize len = strlen(str);
+    return slice->len == len && !memcmp(slice->str, str, len);
+}
+
+static inline gboolean
+is_xml_char(gunichar c)
+{
+    return c == 0x9 || c == 0xA || c == 0xD
+           || (c >= 0x20 && c <= 0xD7FF)
+           || (c >= 0xE000 && c <= 0xFFFD)
+           || (c >= 0x10000 && c <= 0x10FFFF);
+}
+
+/** Check that a non-ASCII text is a valid UTF-8 made of XML characters.
+ */
+static gboolean
+valid_xml_chars(const char *str, gsize len)
+{
+    const char *end = str + len;
+
+    if (!g_utf8_validate(str, len, NULL))
+        return FALSE;
+
+    for (const char *p = str; p < end; p = g_utf8_next_char(p))
+        if ((guint8) *p >= 0x80 && !is_xml_char(g_utf8_get_char(p)))
+            return FALSE;
+
+    return TRUE;
+}
+
+static const struct {
+    const char  *name;
+    char        c;
+} predefined_entities[] = {
+    { "&lt;",   '<' },
+    { "&gt;",   '>' },
+    { "&amp;",  '&' },
+    { "&quot;", '"' },
+    { "&apos;", '\'' },
+};
+
+/** Parse an entity or a character reference starting at p ('&').
+ * @param c     Referenced character
+ * @param len   Length of the reference
+ */
+static cr_FastResult
+parse_reference(const char *p, const char *end, gunichar *c, gsize *len)
+{
+    const char *s = p + 1;
+    gunichar val = 0;
+    int base = 10, digits = 0;
+
+    if (s >= end)
+        return FAST_MORE;
+
+    if (*s != '#') {
+        for (gsize i = 0; i < G_N_ELEMENTS(predefined_entities); i++) {
+            const char *name = predefined_entities[i].name;
+            gsize name_len = strlen(name);
+            if ((gsize) (end - p) < name_len) {
+                if (!memcmp(p, name, end - p))
+                    return FAST_MORE;
+                continue;
+            }
+            if (!memcmp(p, name, name_len)) {
+                *c = predefined_entities[i].c;
+                *len = name_len;
+                return FAST_OK;
+            }
+        }
+        return FAST_UNEXPECTED;  // Other entities
+    }
+
+    s++;
+    if (s < end && *s == 'x') {
+        base = 16;
+        s++;
+    }
+
+    for (; s < end && g_ascii_isxdigit(*s); s++) {
+        int digit = (base == 16) ? g_ascii_xdigit_value(*s)
+                                 : g_ascii_digit_value(*s);
+        if (digit < 0 || ++digits > 8)
+            return FAST_UNEXPECTED;
+        val = val * base + digit;
+    }
+
+    if (s >= end)
+        return FAST_MORE;
+    if (*s != ';' || !digits || !is_xml_char(val))
+        return FAST_UNEXPECTED;
+
+    *c = val;
+    *len = s + 1 - p;
+    return FAST_OK;
+}
+
+/** Scan a text content (stop == '<') or an attribute value (stop == '"').
+ * On success *p points to the stop character.
+ */
+static cr_FastResult
+scan_text(const char **p, const char *end, char stop, cr_Slice *slice)
+{
+    const char *start = *p;
+    const char *s = start;
+    gboolean non_ascii = FALSE;
+
+    slice->refs = FALSE;
+
+    while (1) {
+        guint8 c;
+
+        s = scan_special(s, end);
+        if (s >= end)
+            return FAST_MORE;
+
+        c = (guint8) *s;
+        if (c == stop)
+            break;
+
+        if (c >= 0x80) {
+            non_ascii = TRUE;
+        } else if (c == '&') {
+            gunichar ref;
+            gsize len;
+            cr_FastResult res = parse_reference(s, end, &ref, &len);
+            if (res != FAST_OK)
+                return res;
+            // libxml2 keeps "&#38;" in attribute values, see
+            // unescape_ampersand_from_values()
+            if (ref == '&' && stop == '"')
+                return FAST_UNEXPECTED;
+            slice->refs = TRUE;
+            s += len;
+            continue;
+        } else if (stop == '"') {
+            // Whitespace in attribute values is normalized by libxml2
+            if (c != '>')
+                return FAST_UNEXPECTED;
+        } else {
+            // "]]>" is not allowed in a text
+            if (c == '>' && s - start >= 2 && s[-1] == ']' && s[-2] == ']')
+                return FAST_UNEXPECTED;
+            if (c != '>' && c != '"' && c != '\n' && c != '\t')
+                return FAST_UNEXPECTED;
+        }
+        s++;
+    }
+
+    if (non_ascii && !valid_xml_chars(start, s - start))
+        return FAST_UNEXPECTED;
+
+    slice->str = start;
+    slice->len = s - start;
+    *p = s;
+    return FAST_OK;
+}
+
+static cr_FastResult
+parse_name(const char **p, const char *end, cr_Slice *name)
+{
+    const char *s = *p;
+    const char *e;
+
+    if (s >= end)
+        return FAST_MORE;
+    if (!g_ascii_isalpha(*s) && *s != '_' && *s != ':')
+        return FAST_UNEXPECTED;
+
+    for (e = s + 1; e < end && is_name_char(*e); e++)
+        ;
+    if (e >= end)
+        return FAST_MORE;
+    if (!is_space(*e) && *e != '>' && *e != '/' && *e != '=' && *e != '?')
+        return FAST_UNEXPECTED;
+
+    name->str = s;
+    name->len = e - s;
+    name->refs = FALSE;
+    *p = e;
+    return FAST_OK;
+}
+
+/** Parse attributes of an element up to the end of its start tag.
+ * @param element       Element with known attributes or NULL
+ * @param terminator    '>', '/' for "/>" or '?' for "?>"
+ */
+static cr_FastResult
+parse_attrs(const char **p,
+            const char *end,
+            const cr_FastElement *element,
+            cr_FastToken *token,
+            char *terminator)
+{
+    cr_Slice seen[MAX_SEEN_ATTRS];
+    int nseen = 0;
+    const char *s = *p;
+    cr_FastResult res;
+
+    memset(token, 0, sizeof(*token));
+    token->element = element;
+
+    while (1) {
+        cr_Slice name, value;
+        const char *attr_start = s;
+        int slot = -1;
+
+        s = skip_spaces(s, end);
+        if (s >= end)
+            return FAST_MORE;
+
+        if (*s == '>') {
+            *terminator = '>';
+            s++;
+            break;
+        }
+
+        if (*s == '/' || *s == '?') {
+            if (s + 1 >= end)
+                return FAST_MORE;
+            if (s[1] != '>')
+                return FAST_UNEXPECTED;
+            *terminator = *s;
+            s += 2;
+            break;
+        }
+
+        // Attributes have to be separated by whitespace
+        if (s == attr_start)
+            return FAST_UNEXPECTED;
+
+        if ((res = parse_name(&s, end, &name)) != FAST_OK)
+            return res;
+
+        s = skip_spaces(s, end);
+        if (s >= end)
+            return FAST_MORE;
+        if (*s != '=')
+            return FAST_UNEXPECTED;
+        s = skip_spaces(s + 1, end);
+        if (s >= end)
+            return FAST_MORE;
+        if (*s != '"')
+            return FAST_UNEXPECTED;
+        s++;
+
+        if ((res = scan_text(&s, end, '"', &value)) != FAST_OK)
+            return res;
+        s++;    // Closing quote
+
+        // Redefined attribute is an error
+        if (nseen == MAX_SEEN_ATTRS)
+            return FAST_UNEXPECTED;
+        for (int i = 0; i < nseen; i++)
+            if (seen[i].len == name.len && !memcmp(seen[i].str, name.str, name.len))
+                return FAST_UNEXPECTED;
+        seen[nseen++] = name;
+
+        for (int i = 0; element && i < MAX_ATTRS && element->attrs[i]; i++)
+            if (slice_is(&name, element->attrs[i])) {
+                slot = i;
+                break;
+            }
+
+        if (slot < 0)
+            token->unknown_attrs++;
+        else
+            token->attrs[slot] = value;
+    }
+
+    *p = s;
+    return FAST_OK;
+}
+
+/** Parse the rest of an end tag after "</".
+ */
+static cr_FastResult
+parse_end_tag(const char **p, const char *end, const char *name)
+{
+    const char *s = *p;
+    gsize len = strlen(name);
+
+    if ((gsize) (end - s) < len)
+        return FAST_MORE;
+    if (memcmp(s, name, len))
+        return FAST_UNEXPECTED;
+
+    s = skip_spaces(s + len, end);
+    if (s >= end)
+        return FAST_MORE;
+    if (*s != '>')
+        return FAST_UNEXPECTED;
+
+    *p = s + 1;
+    return FAST_OK;
+}
+
+/** Parse the XML declaration and the start tag of the root element.
+ */
+static cr_FastResult
+parse_prolog(cr_FastParser *fp, const char **p, const char *end)
+{
+    const char *s = *p;
+    cr_FastToken token;
+    cr_Slice name;
+    char terminator;
+    cr_FastResult res;
+
+    if (end - s < 6)
+        return FAST_MORE;
+
+    if (!memcmp(s, "<?xml", 5) && is_space(s[5])) {
+        s += 5;
+        if ((res = parse_attrs(&s, end, &xml_declaration, &token, &terminator)) != FAST_OK)
+            return res;
+
+        const cr_Slice *version    = &token.attrs[0];
+        const cr_Slice *encoding   = &token.attrs[1];
+        const cr_Slice *standalone = &token.attrs[2];
+
+        if (terminator != '?' || token.unknown_attrs)
+            return FAST_UNEXPECTED;
+        if (!version->str || !slice_is(version, "1.0"))
+            return FAST_UNEXPECTED;
+        if (encoding->str && (encoding->refs || encoding->len != 5
+                              || g_ascii_strncasecmp(encoding->str, "UTF-8", 5)))
+            return FAST_UNEXPECTED;
+        if (standalone->str && !slice_is(standalone, "yes")
+                            && !slice_is(standalone, "no"))
+            return FAST_UNEXPECTED;
+        // Order of the pseudo attributes is fixed
+        if ((encoding->str && encoding->str < version->str)
+            || (standalone->str && standalone->str < version->str)
+            || (standalone->str && encoding->str && standalone->str < encoding->str))
+            return FAST_UNEXPECTED;
+    }
+
+    s = skip_spaces(s, end);
+    if (s >= end)
+        return FAST_MORE;
+    if (*s != '<')
+        return FAST_UNEXPECTED;     // Comments, doctype, BOM, ...
+    s++;
+
+    if ((res = parse_name(&s, end, &name)) != FAST_OK)
+        return res;
+
+    fp->root = NULL;
+    for (int i = 0; fp->schema->roots[i]; i++)
+        if (slice_is(&name, fp->schema->roots[i]))
+            fp->root = fp->schema->roots[i];
+    if (!fp->root)
+        return FAST_UNEXPECTED;     // Probably another type of metadata
+
+    if ((res = parse_attrs(&s, end, NULL, &token, &terminator)) != FAST_OK)
+        return res;
+    if (terminator != '>')
+        return FAST_UNEXPECTED;
+
+    *p = s;
+    return FAST_OK;
+}
+
+/** Check values which make the libxml2 parser emit a warning.
+ */
+static gboolean
+token_is_regular(const cr_FastToken *token)
+{
+    const cr_Slice *type, *date;
+
+    switch (token->element->id) {
+    case ELEM_FILE:
+        type = &token->attrs[0];
+        return !type->str || (!type->refs && (slice_is(type, "dir")
+                                              || slice_is(type, "ghost")));
+
+    case ELEM_CHANGELOG:
+        date = &token->attrs[1];
+        if (!token->attrs[0].str || !date->str || date->refs
+            || !date->len || date->len > 18)
+            return FALSE;
+        for (gsize i = 0; i < date->len; i++)
+            if (!g_ascii_isdigit(date->str[i]))
+                return FALSE;
+        return TRUE;
+
+    default:
+        return TRUE;
+    }
+}
+
+/** Check the start tag of the package against the filter before its
+ * element is tokenized. Values with references (and unusually long ones)
+ * are checked by emit_package() once they are decoded.
+ */
+static gboolean
+package_rejected(cr_FastParser *fp)
+{
+    char name[256], arch[64];
+    const cr_Slice *name_slice = &fp->package.attrs[1];
+    const cr_Slice *arch_slice = &fp->package.attrs[2];
+
+    if (name_slice->refs || name_slice->len >= sizeof(name)
+        || arch_slice->refs || arch_slice->len >= sizeof(arch))
+        return FALSE;
+
+    memcpy(name, name_slice->str, name_slice->len);
+    name[name_slice->len] = '\0';
+    memcpy(arch, arch_slice->str, arch_slice->len);
+    arch[arch_slice->len] = '\0';
+
+    return !cr_xml_filter_match(fp->filter, name, arch, NULL, NULL);
+}
+
+/** Tokenize a whole <package> element starting at *p. The element of
+ * a package rejected by the filter is only skipped.
+ */
+static cr_FastResult
+tokenize_package(cr_FastParser *fp, const char **p, const char *end)
+{
+    const char *s = *p + 1;
+    cr_Slice name;
+    char terminator;
+    cr_FastResult res;
+
+    if ((res = parse_name(&s, end, &name)) != FAST_OK)
+        return res;
+    if (!slice_is(&name, package_element.name))
+        return FAST_UNEXPECTED;
+    if ((res = parse_attrs(&s, end, &package_element, &fp->package, &terminator)) != FAST_OK)
+        return res;
+    if (terminator == '?')
+        return FAST_UNEXPECTED;
+
+    // Missing attributes are reported by libxml2 parser
+    for (int i = 0; i < MAX_ATTRS; i++)
+        if (!fp->package.attrs[i].str)
+            return FAST_UNEXPECTED;
+
+    g_array_set_size(fp->tokens, 0);
+
+    if (fp->filter && package_rejected(fp)) {
+        if (terminator != '/') {
+            const char *close = g_strstr_len(s, end - s, "</package>");
+            if (!close)
+                return FAST_MORE;
+            s = close + strlen("</package>");
+        }
+        *p = s;
+        return FAST_OK;
+    }
+
+    while (terminator != '/') {
+        const cr_FastElement *element = NULL;
+        cr_FastToken *token;
+
+        s = skip_spaces(s, end);
+        if (end - s < 2)
+            return FAST_MORE;
+        if (*s != '<')
+            return FAST_UNEXPECTED;     // Text, libxml2 ignores it
+
+        if (s[1] == '/') {
+            s += 2;
+            if ((res = parse_end_tag(&s, end, package_element.name)) != FAST_OK)
+                return res;
+            break;
+        }
+
+        s++;
+        if ((res = parse_name(&s, end, &name)) != FAST_OK)
+            return res;
+
+        for (const cr_FastElement *e = fp->schema->elements; e->name; e++)
+            if (slice_is(&name, e->name)) {
+                element = e;
+                break;
+            }
+        if (!element)
+            return FAST_UNEXPECTED;     // Unknown elements are reported by libxml2
+
+        g_array_set_size(fp->tokens, fp->tokens->len + 1);
+        token = &g_array_index(fp->tokens, cr_FastToken, fp->tokens->len - 1);
+        if ((res = parse_attrs(&s, end, element, token, &terminator)) != FAST_OK)
+            return res;
+        if (terminator == '?')
+            return FAST_UNEXPECTED;
+
+        if (terminator == '>') {
+            if (element->text) {
+                if ((res = scan_text(&s, end, '<', &token->text)) != FAST_OK)
+                    return res;
+            } else {
+                s = skip_spaces(s, end);
+            }
+
+            if (end - s < 2)
+                return FAST_MORE;
+            if (s[0] != '<' || s[1] != '/')
+                return FAST_UNEXPECTED;
+            s += 2;
+            if ((res = parse_end_tag(&s, end, element->name)) != FAST_OK)
+                return res;
+        }
+
+        if (!token_is_regular(token))
+            return FAST_UNEXPECTED;
+
+        terminator = '>';
+    }
+
+    *p = s;
+    return FAST_OK;
+}
+
+/** Decode references and terminate a value by '\0' in place.
+ * The buffer is not parsed again, so the closing quote or '<'
+ * could be overwritten.
+ * @return      The value or NULL if it's missing.
+ */
+static char *
+slice_terminate(cr_Slice *slice)
+{
+    char *str = (char *) slice->str;
+
+    if (!str)
+        return NULL;
+
+    if (slice->refs) {
+        const char *in = str;
+        const char *end = str + slice->len;
+        char *out = str;
+
+        // A reference is always longer than its UTF-8 encoding
+        while (in < end) {
+            if (*in == '&') {
+                gunichar c;
+                gsize len;
+                parse_reference(in, end, &c, &len);
+                in += len;
+                out += g_unichar_to_utf8(c, out);
+            } else {
+                *out++ = *in++;
+            }
+        }
+
+        slice->len = out - str;
+        slice->refs = FALSE;
+    }
+
+    str[slice->len] = '\0';
+    return str;
+}
+
+static void
+add_file(cr_Package *pkg, cr_FastToken *token)
+{
+    char empty[] = "";
+    char *content = slice_terminate(&token->text);
+    const char *type = slice_terminate(&token->attrs[0]);
+    gsize len = token->text.len;
+    cr_PackageFile *pkg_file = cr_package_file_new();
+
+    if (!content) {
+        content = empty;    // <file/>
+        len = 0;
+    }
+
+    pkg_file->name = cr_safe_string_chunk_insert(pkg->chunk,
+                                                 cr_get_filename(content));
+    content[len - strlen(pkg_file->name)] = '\0';
+    pkg_file->path = cr_safe_string_chunk_insert_const(pkg->chunk, content);
+    if (!type)
+        pkg_file->type = NULL;  // NULL => "file"
+    else if (!strcmp(type, "dir"))
+        pkg_file->type = "dir";
+    else
+        pkg_file->type = "ghost";
+    pkg_file->digest = cr_safe_string_chunk_insert(pkg->chunk,
+                                        slice_terminate(&token->attrs[1]));
+
+    pkg->files = g_slist_prepend(pkg->files, pkg_file);
+}
+
+static void
+add_changelog(cr_Package *pkg, cr_FastToken *token)
+{
+    const char *text = slice_terminate(&token->text);
+    cr_ChangelogEntry *changelog = cr_changelog_entry_new();
+
+    changelog->author = g_string_chunk_insert(pkg->chunk,
+                                        slice_terminate(&token->attrs[0]));
+    changelog->date = g_ascii_strtoll(slice_terminate(&token->attrs[1]), NULL, 10);
+    changelog->changelog = g_string_chunk_insert(pkg->chunk, text ? text : "");
+
+    pkg->changelogs = g_slist_prepend(pkg->changelogs, changelog);
+}
+
+/** Pass the tokenized package to the callbacks. Fills the package
+ * exactly like the libxml2 parsers do.
+ */
+static gboolean
+emit_package(cr_FastParser *fp, GError **err)
+{
+    cr_Package *pkg = NULL;
+    GError *tmp_err = NULL;
+    const char *pkgId = slice_terminate(&fp->package.attrs[0]);
+    const char *name  = slice_terminate(&fp->package.attrs[1]);
+    const char *arch  = slice_terminate(&fp->package.attrs[2]);
+
+    if (!cr_xml_filter_match(fp->filter, name, arch, NULL, NULL))
+        return TRUE;    // Rejected by the filter, the package is skipped
+
+    if (fp->newpkgcb(&pkg, pkgId, name, arch, fp->newpkgcb_data, &tmp_err)) {
+        if (tmp_err)
+            g_propagate_prefixed_error(err, tmp_err, "Parsing interrupted: ");
+        else
+            g_set_error(err, ERR_DOMAIN, CRE_CBINTERRUPTED,
+                        "Parsing interrupted");
+        return FALSE;
+    } else {
+        // If callback return CRE_OK but it simultaneously set
+        // the tmp_err then it's a programming error.
+        assert(tmp_err == NULL);
+    }
+
+    if (!pkg)
+        return TRUE;    // Package is skipped
+
+    if (!pkg->pkgId)
+        pkg->pkgId = g_string_chunk_insert(pkg->chunk, pkgId);
+    if (!pkg->name)
+        pkg->name = g_string_chunk_insert(pkg->chunk, name);
+    if (!pkg->arch)
+        pkg->arch = g_string_chunk_insert(pkg->chunk, arch);
+
+    for (guint i = 0; i < fp->tokens->len; i++) {
+        cr_FastToken *token = &g_array_index(fp->tokens, cr_FastToken, i);
+
+        switch (token->element->id) {
+        case ELEM_VERSION:
+            // Version string insert only if them don't already exists
+            if (!pkg->epoch)
+                pkg->epoch = cr_safe_string_chunk_insert(pkg->chunk,
+                                        slice_terminate(&token->attrs[0]));
+            if (!pkg->version)
+                pkg->version = cr_safe_string_chunk_insert(pkg->chunk,
+                                        slice_terminate(&token->attrs[1]));
+            if (!pkg->release)
+                pkg->release = cr_safe_string_chunk_insert(pkg->chunk,
+                                        slice_terminate(&token->attrs[2]));
+            break;
+
+        case ELEM_CHECKSUM:
+            if (!pkg->files_checksum_type)
+                pkg->files_checksum_type = cr_safe_string_chunk_insert(pkg->chunk,
+                                        slice_terminate(&token->attrs[0]));
+            break;
+
+        case ELEM_FILE:
+            add_file(pkg, token);
+            break;
+
+        case ELEM_CHANGELOG:
+            add_changelog(pkg, token);
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    if (fp->schema->type == CR_XML_FAST_FILELISTS)
+        pkg->files = g_slist_reverse(pkg->files);
+    else
+        pkg->changelogs = g_slist_reverse(pkg->changelogs);
+
+    if (fp->pkgcb && fp->pkgcb(pkg, fp->pkgcb_data, &tmp_err)) {
+        if (tmp_err)
+            g_propagate_prefixed_error(err, tmp_err, "Parsing interrupted: ");
+        else
+            g_set_error(err, ERR_DOMAIN, CRE_CBINTERRUPTED,
+                        "Parsing interrupted");
+        return FALSE;
+    } else {
+        // If callback return CRE_OK but it simultaneously set
+        // the tmp_err then it's a programming error.
+        assert(tmp_err == NULL);
+    }
+
+    return TRUE;
+}
+
+static gint64
+count_newlines(const char *data, gsize len)
+{
+    gint64 count = 0;
+    const char *end = data + len;
+
+    while ((data = memchr(data, '\n', end - data))) {
+        count++;
+        data++;
+    }
+
+    return count;
+}
+
+/** Mark the data up to p as parsed.
+ */
+static void
+advance(cr_FastParser *fp, const char *p)
+{
+    gsize pos = p - fp->data->str;
+
+    fp->newlines += count_newlines(fp->data->str + fp->pos, pos - fp->pos);
+    fp->pos = pos;
+}
+
+/** Drop the parsed data and read more.
+ */
+static gboolean
+fill_buffer(cr_FastParser *fp, GError **err)
+{
+    GError *tmp_err = NULL;
+    gsize len, size;
+    int read;
+
+    if (fp->pos) {
+        g_string_erase(fp->data, 0, fp->pos);
+        fp->offset += fp->pos;
+        fp->pos = 0;
+    }
+
+    // Read at least as much as is buffered, so a huge package
+    // is tokenized in a linear time
+    len = fp->data->len;
+    size = MAX(READ_SIZE, len);
+    g_string_set_size(fp->data, len + size);
+    read = cr_read(fp->f, fp->data->str + len, size, &tmp_err);
+    if (tmp_err) {
+        g_string_set_size(fp->data, len);
+        g_critical("%s: Error while reading xml '%s': %s",
+                   __func__, fp->path, tmp_err->message);
+        g_propagate_prefixed_error(err, tmp_err, "Read error: ");
+        return FALSE;
+    }
+    g_string_set_size(fp->data, len + read);
+    fp->eof = read == 0;
+
+    return TRUE;
+}
+
+/** Parse the rest of the file by the libxml2 parser.
+ */
+static int
+parse_rest(cr_FastParser *fp, GError **err)
+{
+    int ret = CRE_OK;
+    GError *tmp_err = NULL;
+    cr_ParserData *pd;
+    // Lines of the parsed document -> lines of the file
+    gint64 line_offset = fp->newlines - fp->prolog_newlines;
+
+    pd = fp->schema->parser_data_new(fp->newpkgcb, fp->newpkgcb_data,
+                                     fp->pkgcb, fp->pkgcb_data,
+                                     fp->warningcb, fp->warningcb_data);
+    pd->filter = fp->filter;
+
+    if (fp->prolog)
+        xmlParseChunk(pd->parser, fp->prolog, strlen(fp->prolog), 0);
+
+    while (1) {
+        gsize len = fp->data->len - fp->pos;
+        gboolean terminate = FALSE;
+
+        if (len == 0) {
+            if (!fp->eof) {
+                if (!fill_buffer(fp, &tmp_err)) {
+                    ret = tmp_err->code;
+                    g_propagate_error(err, tmp_err);
+                    break;
+                }
+                continue;
+            }
+            terminate = TRUE;
+        } else {
+            // Feed libxml2 by the same chunks as cr_xml_parser_generic(),
+            // which error is reported first could depend on them
+            gsize offset = (fp->offset + fp->pos) % XML_BUFFER_SIZE;
+            len = MIN(len, XML_BUFFER_SIZE - offset);
+        }
+
+        if (xmlParseChunk(pd->parser, fp->data->str + fp->pos, len, terminate)) {
+            const xmlError *xml_err = xmlCtxtGetLastError(pd->parser);
+            int line = (int) xml_err->line;
+            if (line > fp->prolog_newlines)
+                line += line_offset;
+            ret = CRE_XMLPARSER;
+            g_critical("%s: parsing error '%s': %s",
+                       __func__, fp->path, xml_err->message);
+            g_set_error(err, ERR_DOMAIN, CRE_XMLPARSER,
+                        "Parse error '%s' at line: %d (%s)",
+                        fp->path, line, (char *) xml_err->message);
+            break;
+        }
+
+        if (pd->err) {
+            ret = pd->err->code;
+            g_propagate_error(err, pd->err);
+            pd->err = NULL;
+            break;
+        }
+
+        if (terminate)
+            break;
+
+        fp->pos += len;
+    }
+
+    if (pd->main_tag_found)
+        fp->main_tag_found = TRUE;
+
+    if (ret != CRE_OK && pd->newpkgcb == cr_newpkgcb) {
+        // Prevent memory leak when the parsing is interrupted by an error
+        cr_package_free(pd->pkg);
+    }
+
+    cr_xml_parser_data_free(pd);
+
+    return ret;
+}
+
+int
+cr_xml_parser_fast(const char *path,
+                   cr_XmlFastSchema schema,
+                   const cr_XmlFilter *filter,
+                   const char *main_tag_warning,
+                   cr_XmlParserNewPkgCb newpkgcb,
+                   void *newpkgcb_data,
+                   cr_XmlParserPkgCb pkgcb,
+                   void *pkgcb_data,
+                   cr_XmlParserWarningCb warningcb,
+                   void *warningcb_data,
+                   GError **err)
+{
+    int ret = CRE_OK;
+    GError *tmp_err = NULL;
+    cr_FastParser fp;
+    cr_FastState state = FAST_STATE_PROLOG;
+
+    assert(path);
+    assert(schema == CR_XML_FAST_FILELISTS || schema == CR_XML_FAST_OTHER);
+    assert(newpkgcb || pkgcb);
+
+    init_simd();
+    assert(!err || *err == NULL);
+
+    memset(&fp, 0, sizeof(fp));
+    fp.f = cr_open(path, CR_CW_MODE_READ, CR_CW_AUTO_DETECT_COMPRESSION, &tmp_err);
+    if (tmp_err) {
+        int code = tmp_err->code;
+        g_propagate_prefixed_error(err, tmp_err, "Cannot open %s: ", path);
+        return code;
+    }
+
+    fp.path = path;
+    fp.schema = &schemas[schema];
+    fp.newpkgcb = newpkgcb ? newpkgcb : cr_newpkgcb;
+    fp.newpkgcb_data = newpkgcb_data;
+    fp.pkgcb = pkgcb;
+    fp.pkgcb_data = pkgcb_data;
+    fp.warningcb = warningcb;
+    fp.warningcb_data = warningcb_data;
+    fp.filter = filter;
+    fp.data = g_string_sized_new(READ_SIZE);
+    fp.tokens = g_array_new(FALSE, FALSE, sizeof(cr_FastToken));
+
+    while (state != FAST_STATE_DONE && state != FAST_STATE_FALLBACK) {
+        const char *p = fp.data->str + fp.pos;
+        const char *end = fp.data->str + fp.data->len;
+        cr_FastResult res = FAST_MORE;
+
+        switch (state) {
+        case FAST_STATE_PROLOG:
+            res = parse_prolog(&fp, &p, end);
+            if (res == FAST_OK) {
+                fp.prolog = g_strndup(fp.data->str, p - fp.data->str);
+                fp.prolog_newlines = count_newlines(fp.prolog, p - fp.data->str);
+                fp.main_tag_found = TRUE;
+                state = FAST_STATE_BODY;
+            }
+            break;
+
+        case FAST_STATE_BODY:
+            p = skip_spaces(p, end);
+            if (end - p < 2)
+                break;
+            if (*p != '<') {
+                res = FAST_UNEXPECTED;
+            } else if (p[1] == '/') {
+                // Keep the end tag unparsed, libxml2 needs it if
+                // something unexpected follows
+                res = FAST_OK;
+                state = FAST_STATE_EPILOG;
+            } else {
+                res = tokenize_package(&fp, &p, end);
+                if (res == FAST_OK) {
+                    // The emitted package is decoded in place
+                    advance(&fp, p);
+                    if (!emit_package(&fp, &tmp_err)) {
+                        ret = tmp_err->code;
+                        g_propagate_error(err, tmp_err);
+                        state = FAST_STATE_DONE;
+                    }
+                    continue;
+                }
+            }
+            break;
+
+        case FAST_STATE_EPILOG: {
+            const char *s = p + 2;  // "</"
+            res = parse_end_tag(&s, end, fp.root);
+            if (res != FAST_OK)
+                break;
+            s = skip_spaces(s, end);
+            if (s < end) {
+                res = FAST_UNEXPECTED;  // Comments or garbage
+            } else if (!fp.eof) {
+                res = FAST_MORE;
+            } else {
+                p = s;
+                state = FAST_STATE_DONE;
+            }
+            break;
+        }
+
+        default:
+            assert(0);
+        }
+
+        if (res == FAST_OK) {
+            advance(&fp, p);
+        } else if (res == FAST_UNEXPECTED || fp.eof) {
+            state = FAST_STATE_FALLBACK;
+        } else if (!fill_buffer(&fp, &tmp_err)) {
+            ret = tmp_err->code;
+            g_propagate_error(err, tmp_err);
+            break;
+        }
+    }
+
+    if (state == FAST_STATE_FALLBACK) {
+        g_debug("%s: Parsing of %s continues by libxml2 at line %"G_GINT64_FORMAT,
+                __func__, path, fp.newlines + 1);
+        ret = parse_rest(&fp, err);
+    }
+
+    if (ret != CRE_OK) {
+        cr_close(fp.f, NULL);
+    } else {
+        cr_close(fp.f, &tmp_err);
+        if (tmp_err) {
+            ret = tmp_err->code;
+            g_propagate_prefixed_error(err, tmp_err, "Error while closing: ");
+        }
+    }
+
+    // Warning if file was probably a different type than expected
+    // (like in the sequential parsers its result is ignored)
+    if (ret == CRE_OK && !fp.main_tag_found && warningcb) {
+        warningcb(CR_XML_WARNING_BADMDTYPE, (char *) main_tag_warning,
+                  warningcb_data, &tmp_err);
+        g_clear_error(&tmp_err);
+    }
+
+    g_string_free(fp.data, TRUE);
+    g_array_free(fp.tokens, TRUE);
+    g_free(fp.prolog);
+
+    return ret;
+}
@@ -0,0 +1,190 @@
+/* createrepo_c - Library of routines for manipulation with repodata
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#include <glib.h>
+#include <assert.h>
+#include <string.h>
+#include "misc.h"
+#include "package.h"
+#include "xml_parser.h"
+#include "xml_parser_internal.h"
+
+/*
+ * Starting with glib 2.70.0, g_pattern_spec_match() replaces
+ * g_pattern_match().
+ */
+#if GLIB_CHECK_VERSION(2, 70, 0)
+#define PATTERN_MATCH g_pattern_spec_match
+#else
+#define PATTERN_MATCH g_pattern_match
+#endif
+
+struct _cr_XmlFilter {
+    GHashTable  *arches;        /*!< allowed architectures */
+    GSList      *name_globs;    /*!< GPatternSpec of allowed names */
+    GHashTable  *hrefs;         /*!< allowed basenames of location_href */
+    GHashTable  *blocked_srpms; /*!< names of blocked source packages */
+};
+
+static GHashTable *
+string_set_new(void)
+{
+    return g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+}
+
+cr_XmlFilter *
+cr_xml_filter_new(void)
+{
+    return g_new0(cr_XmlFilter, 1);
+}
+
+void
+cr_xml_filter_add_arch(cr_XmlFilter *filter, const char *arch)
+{
+    assert(filter);
+    assert(arch);
+
+    if (!filter->arches)
+        filter->arches = string_set_new();
+    g_hash_table_add(filter->arches, g_strdup(arch));
+}
+
+void
+cr_xml_filter_add_name_glob(cr_XmlFilter *filter, const char *glob)
+{
+    assert(filter);
+    assert(glob);
+
+    filter->name_globs = g_slist_prepend(filter->name_globs,
+                                         g_pattern_spec_new(glob));
+}
+
+void
+cr_xml_filter_add_href(cr_XmlFilter *filter, const char *href)
+{
+    assert(filter);
+    assert(href);
+
+    if (!filter->hrefs)
+        filter->hrefs = string_set_new();
+    g_hash_table_add(filter->hrefs, g_strdup(cr_get_filename(href)));
+}
+
+void
+cr_xml_filter_add_blocked_srpm(cr_XmlFilter *filter, const char *srpm_name)
+{
+    assert(filter);
+    assert(srpm_name);
+
+    if (!filter->blocked_srpms)
+        filter->blocked_srpms = string_set_new();
+    g_hash_table_add(filter->blocked_srpms, g_strdup(srpm_name));
+}
+
+static gboolean
+name_matches(const cr_XmlFilter *filter, const char *name)
+{
+    guint len = strlen(name);
+
+    for (GSList *elem = filter->name_globs; elem; elem = g_slist_next(elem))
+        if (PATTERN_MATCH(elem->data, len, name, NULL))
+            return TRUE;
+
+    return FALSE;
+}
+
+static gboolean
+srpm_blocked(const cr_XmlFilter *filter, const char *sourcerpm)
+{
+    cr_NEVRA *nevra = cr_split_rpm_filename(sourcerpm);
+    gboolean blocked;
+
+    if (!nevra)
+        // Invalid source rpms are left to the caller
+        return FALSE;
+
+    blocked = g_hash_table_contains(filter->blocked_srpms, nevra->name);
+    cr_nevra_free(nevra);
+    return blocked;
+}
+
+gboolean
+cr_xml_filter_match(const cr_XmlFilter *filter,
+                    const char *name,
+                    const char *arch,
+                    const char *location_href,
+                    const char *sourcerpm)
+{
+    if (!filter)
+        return TRUE;
+
+    if (arch && filter->arches && !g_hash_table_contains(filter->arches, arch))
+        return FALSE;
+
+    if (name && filter->name_globs && !name_matches(filter, name))
+        return FALSE;
+
+    if (location_href && filter->hrefs
+        && !g_hash_table_contains(filter->hrefs, cr_get_filename(location_href)))
+        return FALSE;
+
+    if (sourcerpm && filter->blocked_srpms && srpm_blocked(filter, sourcerpm))
+        return FALSE;
+
+    return TRUE;
+}
+
+gboolean
+cr_xml_filter_match_package(const cr_XmlFilter *filter, cr_Package *pkg)
+{
+    assert(pkg);
+
+    return cr_xml_filter_match(filter, pkg->name, pkg->arch,
+                               pkg->location_href, pkg->rpm_sourcerpm);
+}
+
+gboolean
+cr_xml_filter_decided(const cr_XmlFilter *filter, cr_Package *pkg)
+{
+    assert(pkg);
+
+    if (!filter)
+        return TRUE;
+
+    return (!filter->arches || pkg->arch)
+           && (!filter->name_globs || pkg->name)
+           && (!filter->hrefs || pkg->location_href)
+           && (!filter->blocked_srpms || pkg->rpm_sourcerpm);
+}
+
+void
+cr_xml_filter_free(cr_XmlFilter *filter)
+{
+    if (!filter)
+        return;
+
+    if (filter->arches)
+        g_hash_table_destroy(filter->arches);
+    g_slist_free_full(filter->name_globs, (GDestroyNotify) g_pattern_spec_free);
+    if (filter->hrefs)
+        g_hash_table_destroy(filter->hrefs);
+    if (filter->blocked_srpms)
+        g_hash_table_destroy(filter->blocked_srpms);
+    g_free(filter);
+}
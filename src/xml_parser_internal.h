@@ -113,9 +113,19 @@ typedef struct _cr_ParserData {
         Warning callback */
     cr_Package              *pkg;               /*!<
         The package which is currently loaded. */
+    const cr_XmlFilter      *filter;            /*!<
+        Filter of packages or NULL. */
 
     /* Primary related stuff */
 
+    cr_Package *filter_pkg; /*!<
+        Package owned by the parser. If a filter is used, the current
+        package is parsed into it until the filter can decide about it.
+        Then the newpkgcb is called and the parsed values are copied
+        into the package returned by it. */
+    const char *filter_pkg_type; /*!<
+        Type of the package in filter_pkg (in its chunk) */
+
     int do_files;   /*!<
         If == 0 then parser will ignore files elements in the primary.xml.
         This is useful when you are intending to parse primary.xml as well as
@@ -150,6 +160,10 @@ typedef struct _cr_ParserData {
 
     cr_UpdateInfo *updateinfo; /*!<
         Update info object */
+    cr_XmlParserUpdateRecordCb updaterecordcb; /*!<
+        Update record callback (records are not appended to updateinfo) */
+    void *updaterecordcb_data; /*!<
+        User data for the updaterecordcb. */
     cr_UpdateRecord *updaterecord; /*!<
         Update record object */
     cr_UpdateCollection *updatecollection; /*!<
@@ -214,6 +228,22 @@ int cr_newpkgcb(cr_Package **pkg,
                 void *cbdata,
                 GError **err);
 
+/** Move data parsed from filelists[_ext] or other xml (files and changelogs)
+ * from one package into another. The lists are reused, only their strings
+ * are copied into the chunk of the target. pkgId, name, arch and
+ * epoch-version-release are set only if missing in the target, like
+ * when the parsers fill a package returned by a newpkgcb.
+ */
+void cr_xml_parser_move_package_data(cr_Package *source, cr_Package *target);
+
+/** Check whether all values of the package which the filter looks at
+ * are already known.
+ * @param filter        cr_XmlFilter or NULL
+ * @param pkg           cr_Package
+ * @return              TRUE if the filter can decide about the package
+ */
+gboolean cr_xml_filter_decided(const cr_XmlFilter *filter, cr_Package *pkg);
+
 /** Generic parser.
  */
 int
@@ -227,6 +257,81 @@ cr_xml_parser_generic_from_string(xmlParserCtxtPtr parser,
                                   const char *xml_string,
                                   GError **err);
 
+/** Parse filelists[_ext].xml or other.xml by blocks of packages in
+ * a pool of threads. The user callbacks are called from the caller
+ * thread in the same order as by cr_xml_parser_generic().
+ * @param path              Path to the xml file
+ * @param parser_data_new   filelists_parser_data_new or other_parser_data_new
+ * @param main_tag_warning  Warning used if the main element is missing
+ * @param threads           Number of threads (< 1 - number of processors)
+ */
+int
+cr_xml_parser_parallel(const char *path,
+                       cr_ParserData *(*parser_data_new)(cr_XmlParserNewPkgCb, void *,
+                                                         cr_XmlParserPkgCb, void *,
+                                                         cr_XmlParserWarningCb, void *),
+                       const char *main_tag_warning,
+                       cr_XmlParserNewPkgCb newpkgcb,
+                       void *newpkgcb_data,
+                       cr_XmlParserPkgCb pkgcb,
+                       void *pkgcb_data,
+                       cr_XmlParserWarningCb warningcb,
+                       void *warningcb_data,
+                       int threads,
+                       GError **err);
+
+/** Schemas known by cr_xml_parser_fast().
+ */
+typedef enum {
+    CR_XML_FAST_FILELISTS,  /*!< filelists[_ext].xml */
+    CR_XML_FAST_OTHER,      /*!< other.xml */
+} cr_XmlFastSchema;
+
+/** SIMD instructions used by cr_xml_parser_fast() to scan the input.
+ */
+typedef enum {
+    CR_XML_FAST_SIMD_NONE,  /*!< Byte by byte scan */
+    CR_XML_FAST_SIMD_SSE2,  /*!< SSE2 (x86) */
+    CR_XML_FAST_SIMD_AVX2,  /*!< AVX2 (x86) */
+} cr_XmlFastSimd;
+
+/** Select the SIMD instructions used by cr_xml_parser_fast(). By default
+ * the best ones supported by the running CPU are used. Not thread safe,
+ * meant for tests and benchmarks.
+ * @param simd              Instructions to use
+ * @return                  FALSE (and nothing changes) if the CPU or the
+ *                          build doesn't support them
+ */
+gboolean
+cr_xml_parser_fast_set_simd(cr_XmlFastSimd simd);
+
+/** SIMD instructions used by cr_xml_parser_fast().
+ */
+cr_XmlFastSimd
+cr_xml_parser_fast_get_simd(void);
+
+/** Parse filelists[_ext].xml or other.xml by a tokenizer specialized
+ * for the repodata schema. Input which is not handled by the tokenizer
+ * is parsed by the libxml2 parser, the results and the callbacks are
+ * always the same as by cr_xml_parser_generic().
+ * @param path              Path to the xml file
+ * @param schema            Type of the xml file
+ * @param filter            Filter of packages or NULL
+ * @param main_tag_warning  Warning used if the main element is missing
+ */
+int
+cr_xml_parser_fast(const char *path,
+                   cr_XmlFastSchema schema,
+                   const cr_XmlFilter *filter,
+                   const char *main_tag_warning,
+                   cr_XmlParserNewPkgCb newpkgcb,
+                   void *newpkgcb_data,
+                   cr_XmlParserPkgCb pkgcb,
+                   void *pkgcb_data,
+                   cr_XmlParserWarningCb warningcb,
+                   void *warningcb_data,
+                   GError **err);
+
 cr_ParserData *
 primary_parser_data_new(cr_XmlParserNewPkgCb newpkgcb,
                         void *newpkgcb_data,
@@ -30,8 +30,108 @@
 
 #define ERR_DOMAIN      CREATEREPO_C_ERROR
 
+#define PKG_RING_MIN_CAPACITY   16      // Initial capacity of a package ring
+#define PARSED_RING_CAPACITY    64      // Max number of packages a parser
+                                        // thread can be ahead of the caller
+
+/** Ring of packages addressed by their position.
+ * The capacity is always a power of two, so a position maps to its slot
+ * by masking and pushing, popping and looking up a package are O(1).
+ */
 typedef struct {
-    GSList                 *in_progress_pkgs_list;
+    cr_Package  **slots;
+    guint64     capacity;
+    guint64     head;       // Position of the oldest package
+    guint64     tail;       // Position after the newest package
+} cr_PkgRing;
+
+static void
+pkg_ring_init(cr_PkgRing *ring, guint64 capacity)
+{
+    ring->slots = g_new0(cr_Package *, capacity);
+    ring->capacity = capacity;
+    ring->head = 0;
+    ring->tail = 0;
+}
+
+static guint64
+pkg_ring_length(cr_PkgRing *ring)
+{
+    return ring->tail - ring->head;
+}
+
+static void
+pkg_ring_push(cr_PkgRing *ring, cr_Package *pkg)
+{
+    if (pkg_ring_length(ring) == ring->capacity) {
+        // Full - double the capacity, keeping every package in the slot
+        // of its position
+        guint64 capacity = ring->capacity * 2;
+        cr_Package **slots = g_new0(cr_Package *, capacity);
+        for (guint64 pos = ring->head; pos < ring->tail; pos++)
+            slots[pos & (capacity - 1)] = ring->slots[pos & (ring->capacity - 1)];
+        g_free(ring->slots);
+        ring->slots = slots;
+        ring->capacity = capacity;
+    }
+
+    ring->slots[ring->tail & (ring->capacity - 1)] = pkg;
+    ring->tail++;
+}
+
+/** Package at the index (counted from the oldest one) or NULL.
+ */
+static cr_Package *
+pkg_ring_nth(cr_PkgRing *ring, guint64 index)
+{
+    if (index >= pkg_ring_length(ring))
+        return NULL;
+    return ring->slots[(ring->head + index) & (ring->capacity - 1)];
+}
+
+static cr_Package *
+pkg_ring_pop(cr_PkgRing *ring)
+{
+    cr_Package *pkg;
+
+    if (ring->head == ring->tail)
+        return NULL;
+
+    pkg = ring->slots[ring->head & (ring->capacity - 1)];
+    ring->slots[ring->head & (ring->capacity - 1)] = NULL;
+    ring->head++;
+    return pkg;
+}
+
+/** Forget the package without freeing it (slot is left empty).
+ */
+static void
+pkg_ring_forget(cr_PkgRing *ring, cr_Package *pkg)
+{
+    for (guint64 pos = ring->head; pos < ring->tail; pos++)
+        if (ring->slots[pos & (ring->capacity - 1)] == pkg)
+            ring->slots[pos & (ring->capacity - 1)] = NULL;
+}
+
+static void
+pkg_ring_clear(cr_PkgRing *ring, gboolean free_pkgs)
+{
+    if (!ring->slots)
+        return;
+
+    for (guint64 pos = ring->head; pos < ring->tail; pos++) {
+        cr_Package *pkg = ring->slots[pos & (ring->capacity - 1)];
+        if (pkg && free_pkgs)
+            cr_package_free(pkg);
+    }
+
+    g_free(ring->slots);
+    ring->slots = NULL;
+    ring->head = ring->tail = 0;
+}
+
+typedef struct {
+    cr_PkgRing             in_progress_pkgs;
     int                    in_progress_count_primary;
     int                    in_progress_count_filelists;
     int                    in_progress_count_other;
@@ -43,6 +143,24 @@ typedef struct {
     cr_PackageLoadingFlags loadingflags;  // which callbacks need to be called before the package is considered "finished" loading
 } cr_CbData;
 
+/** One metadata file parsed by a background thread.
+ * Every package is parsed into its own cr_Package and queued in the
+ * parsed ring, the caller joins the packages with the same position
+ * from all the streams. Everything but the thread private parser state
+ * is protected by the iterator mutex.
+ */
+typedef struct {
+    struct _cr_PkgIterator  *iter;
+    CR_FILE                 *f;
+    const char              *path;
+    cr_ParserData           *pd;
+    cr_PackageLoadingFlags  loadingflag;    // Flag of the parsed metadata
+    GThread                 *thread;
+    cr_PkgRing              parsed;         // Parsed packages to be joined
+    gboolean                is_done;        // Parsing ended (or failed)
+    GError                  *err;           // Parsing error
+} cr_PkgStream;
+
 struct _cr_PkgIterator {
     CR_FILE *primary_f;
     CR_FILE *filelists_f;
@@ -63,6 +181,16 @@ struct _cr_PkgIterator {
     gboolean other_is_done;
 
     void *cbdata;
+
+    // Parsing in background threads (used when there are no user
+    // callbacks, because those expect to be called from the caller thread)
+    gboolean threaded;
+    gboolean threaded_is_done;      // All joined packages were handed out
+    GMutex mutex;
+    GCond cond;                     // Signalled on every change of a stream
+    gboolean cancelled;             // Iterator is being freed
+    cr_PkgStream streams[3];        // Primary, filelists and other
+    int streams_count;
 };
 
 static int
@@ -70,8 +198,8 @@ queue_package_if_finished(cr_Package *pkg, cr_CbData *cb_data)
 {
     if (pkg && ((pkg->loadingflags & cb_data->loadingflags) == cb_data->loadingflags))
     {
-        //remove first element in the list
-        cb_data->in_progress_pkgs_list = g_slist_delete_link(cb_data->in_progress_pkgs_list, cb_data->in_progress_pkgs_list);
+        // Packages are finished in order, so it is the oldest one
+        pkg_ring_pop(&cb_data->in_progress_pkgs);
 
         // One package was fully finished
         cb_data->in_progress_count_primary--;
@@ -89,7 +217,7 @@ queue_package_if_finished(cr_Package *pkg, cr_CbData *cb_data)
 static cr_Package*
 find_in_progress_pkg(cr_CbData *cb_data, const char *pkgId, int in_progress_pkg_index, GError **err)
 {
-    gpointer pval = g_slist_nth_data(cb_data->in_progress_pkgs_list, in_progress_pkg_index);
+    gpointer pval = pkg_ring_nth(&cb_data->in_progress_pkgs, in_progress_pkg_index);
     // This is checking out of order pkgs
     if (pval && g_strcmp0(((cr_Package *) pval)->pkgId, pkgId)) {
         g_set_error(err, ERR_DOMAIN, CRE_XMLPARSER,
@@ -106,7 +234,7 @@ store_in_progress_pkg(cr_CbData *cb_data, cr_Package *pkg)
     if (!pkg) {
         return;
     }
-    cb_data->in_progress_pkgs_list = g_slist_append(cb_data->in_progress_pkgs_list, pkg);
+    pkg_ring_push(&cb_data->in_progress_pkgs, pkg);
 }
 
 static int
@@ -320,6 +448,177 @@ parse_next_section(CR_FILE *target_file, const char *path, cr_ParserData *pd, GE
     return done;
 }
 
+static int
+pkgcb_parsed(cr_Package *pkg, void *cbdata, GError **err)
+{
+    cr_PkgStream *stream = cbdata;
+    cr_PkgIterator *iter = stream->iter;
+
+    pkg->loadingflags |= stream->loadingflag;
+    if (stream->loadingflag == CR_PACKAGE_LOADED_PRI)
+        pkg->loadingflags |= CR_PACKAGE_FROM_XML;
+
+    // Don't get too far ahead of the caller
+    g_mutex_lock(&iter->mutex);
+    while (pkg_ring_length(&stream->parsed) >= PARSED_RING_CAPACITY && !iter->cancelled)
+        g_cond_wait(&iter->cond, &iter->mutex);
+
+    if (iter->cancelled) {
+        g_mutex_unlock(&iter->mutex);
+        cr_package_free(pkg);
+        g_set_error(err, ERR_DOMAIN, CRE_CBINTERRUPTED, "Iterator was freed");
+        return CR_CB_RET_ERR;
+    }
+
+    pkg_ring_push(&stream->parsed, pkg);
+    g_cond_broadcast(&iter->cond);
+    g_mutex_unlock(&iter->mutex);
+
+    return CR_CB_RET_OK;
+}
+
+static gpointer
+parse_stream_thread(gpointer data)
+{
+    cr_PkgStream *stream = data;
+    cr_PkgIterator *iter = stream->iter;
+    GError *tmp_err = NULL;
+    gboolean done = FALSE;
+    gboolean cancelled = FALSE;
+
+    while (!done && !cancelled) {
+        done = parse_next_section(stream->f, stream->path, stream->pd, &tmp_err);
+        if (tmp_err)
+            break;
+
+        g_mutex_lock(&iter->mutex);
+        cancelled = iter->cancelled;
+        g_mutex_unlock(&iter->mutex);
+    }
+
+    g_mutex_lock(&iter->mutex);
+    stream->is_done = TRUE;
+    if (tmp_err && !iter->cancelled)
+        stream->err = tmp_err;
+    else
+        g_clear_error(&tmp_err);
+    g_cond_broadcast(&iter->cond);
+    g_mutex_unlock(&iter->mutex);
+
+    return NULL;
+}
+
+static cr_PkgStream *
+add_stream(cr_PkgIterator *iter,
+           CR_FILE *f,
+           const char *path,
+           cr_PackageLoadingFlags loadingflag)
+{
+    cr_PkgStream *stream = &iter->streams[iter->streams_count++];
+    stream->iter = iter;
+    stream->f = f;
+    stream->path = path;
+    stream->loadingflag = loadingflag;
+    pkg_ring_init(&stream->parsed, PARSED_RING_CAPACITY);
+    return stream;
+}
+
+static gboolean
+join_package(cr_Package *pkg, cr_Package *part, GError **err)
+{
+    if (g_strcmp0(pkg->pkgId, part->pkgId)) {
+        g_set_error(err, ERR_DOMAIN, CRE_XMLPARSER,
+                    "Out of order metadata: %s vs %s.", pkg->pkgId, part->pkgId);
+        return FALSE;
+    }
+
+    cr_xml_parser_move_package_data(part, pkg);
+    pkg->loadingflags |= part->loadingflags;
+    return TRUE;
+}
+
+/** Check that all the streams ended together with the ended one.
+ * A stream which still has packages means the metadata files don't list
+ * the same packages. Must be called with the iter->mutex locked.
+ */
+static gboolean
+check_streams_ended(cr_PkgIterator *iter, cr_PkgStream *ended, GError **err)
+{
+    for (int i = 0; i < iter->streams_count; i++) {
+        cr_PkgStream *stream = &iter->streams[i];
+
+        if (stream == ended)
+            continue;
+
+        while (!pkg_ring_length(&stream->parsed) && !stream->is_done)
+            g_cond_wait(&iter->cond, &iter->mutex);
+
+        if (pkg_ring_length(&stream->parsed)) {
+            cr_Package *pkg = pkg_ring_nth(&stream->parsed, 0);
+            g_set_error(err, ERR_DOMAIN, CRE_XMLPARSER,
+                        "Metadata %s ended, but %s has more packages (%s).",
+                        ended->path, stream->path, pkg->pkgId);
+            return FALSE;
+        }
+
+        if (stream->err) {
+            g_propagate_error(err, stream->err);
+            stream->err = NULL;
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/** Join the oldest parsed packages of all the streams.
+ */
+static cr_Package *
+parse_next_threaded(cr_PkgIterator *iter, GError **err)
+{
+    cr_Package *parts[3] = { NULL, NULL, NULL };
+    cr_Package *pkg;
+
+    if (iter->threaded_is_done)
+        return NULL;
+
+    g_mutex_lock(&iter->mutex);
+    for (int i = 0; i < iter->streams_count; i++) {
+        cr_PkgStream *stream = &iter->streams[i];
+
+        while (!pkg_ring_length(&stream->parsed) && !stream->is_done)
+            g_cond_wait(&iter->cond, &iter->mutex);
+
+        if (!pkg_ring_length(&stream->parsed)) {
+            // The stream ended, packages missing in it will never be complete
+            if (stream->err) {
+                g_propagate_error(err, stream->err);
+                stream->err = NULL;
+            } else if (check_streams_ended(iter, stream, err)) {
+                iter->threaded_is_done = TRUE;
+            }
+            g_mutex_unlock(&iter->mutex);
+            return NULL;
+        }
+    }
+
+    for (int i = 0; i < iter->streams_count; i++)
+        parts[i] = pkg_ring_pop(&iter->streams[i].parsed);
+    g_cond_broadcast(&iter->cond);
+    g_mutex_unlock(&iter->mutex);
+
+    pkg = parts[0];
+    for (int i = 1; i < iter->streams_count; i++) {
+        if (pkg && !join_package(pkg, parts[i], err)) {
+            cr_package_free(pkg);
+            pkg = NULL;
+        }
+        cr_package_free(parts[i]);
+    }
+
+    return pkg;
+}
+
 //TODO(amatej): there is quite some overlap with this and cr_load_xml_files,
 //              consider using this api to implement cr_load_xml_files?
 cr_PkgIterator *
@@ -358,7 +657,7 @@ cr_PkgIterator_new(const char *primary_path,
 
     cr_CbData *cbdata = g_new0(cr_CbData, 1);
     new_iter->cbdata = cbdata;
-    cbdata->in_progress_pkgs_list = NULL;
+    pkg_ring_init(&cbdata->in_progress_pkgs, PKG_RING_MIN_CAPACITY);
     cbdata->finished_pkgs_queue = g_queue_new();
 
     cbdata->in_progress_count_primary = 0;
@@ -403,6 +702,33 @@ cr_PkgIterator_new(const char *primary_path,
         new_iter->other_is_done = 1;
     }
 
+    if (!newpkgcb && !warningcb) {
+        // Nothing has to be called from the caller thread, parse
+        // every file in its own thread and only join the packages
+        // in cr_PkgIterator_parse_next()
+        cr_PkgStream *stream;
+
+        new_iter->threaded = TRUE;
+        g_mutex_init(&new_iter->mutex);
+        g_cond_init(&new_iter->cond);
+
+        stream = add_stream(new_iter, new_iter->primary_f, primary_path, CR_PACKAGE_LOADED_PRI);
+        stream->pd = new_iter->primary_pd = primary_parser_data_new(NULL, NULL, pkgcb_parsed, stream, NULL, NULL, parse_files_in_primary);
+        if (new_iter->filelists_f) {
+            stream = add_stream(new_iter, new_iter->filelists_f, filelists_path, CR_PACKAGE_LOADED_FIL);
+            stream->pd = new_iter->filelists_pd = filelists_parser_data_new(NULL, NULL, pkgcb_parsed, stream, NULL, NULL);
+        }
+        if (new_iter->other_f) {
+            stream = add_stream(new_iter, new_iter->other_f, other_path, CR_PACKAGE_LOADED_OTH);
+            stream->pd = new_iter->other_pd = other_parser_data_new(NULL, NULL, pkgcb_parsed, stream, NULL, NULL);
+        }
+
+        for (int i = 0; i < new_iter->streams_count; i++)
+            new_iter->streams[i].thread = g_thread_new("cr_PkgIterator", parse_stream_thread,
+                                                       &new_iter->streams[i]);
+        return new_iter;
+    }
+
     new_iter->primary_pd = primary_parser_data_new(newpkgcb_primary, cbdata, pkgcb_primary, cbdata, warningcb, warningcb_data, parse_files_in_primary);
     new_iter->filelists_pd = filelists_parser_data_new(newpkgcb_filelists, cbdata, pkgcb_filelists, cbdata, warningcb, warningcb_data);
     new_iter->other_pd = other_parser_data_new(newpkgcb_other, cbdata, pkgcb_other, cbdata, warningcb, warningcb_data);
@@ -413,6 +739,10 @@ cr_Package *
 cr_PkgIterator_parse_next(cr_PkgIterator *iter, GError **err) {
     cr_CbData *cbdata = (cr_CbData*) iter->cbdata;
 
+    if (iter->threaded) {
+        return parse_next_threaded(iter, err);
+    }
+
     while (!cr_PkgIterator_is_finished(iter) && g_queue_is_empty(cbdata->finished_pkgs_queue)) {
         if (!iter->primary_is_done)
         {
@@ -443,6 +773,9 @@ cr_PkgIterator_parse_next(cr_PkgIterator *iter, GError **err) {
 }
 
 gboolean cr_PkgIterator_is_finished(cr_PkgIterator *iter) {
+    if (iter->threaded) {
+        return iter->threaded_is_done;
+    }
     return iter->primary_is_done && iter->filelists_is_done && iter->other_is_done;
 }
 
@@ -450,6 +783,27 @@ void cr_PkgIterator_free(cr_PkgIterator *iter, GError **err) {
     assert(iter);
     cr_CbData *cbdata = (cr_CbData*) iter->cbdata;
 
+    if (iter->threaded) {
+        // Stop the parser threads before closing their files
+        g_mutex_lock(&iter->mutex);
+        iter->cancelled = TRUE;
+        g_cond_broadcast(&iter->cond);
+        g_mutex_unlock(&iter->mutex);
+
+        for (int i = 0; i < iter->streams_count; i++) {
+            cr_PkgStream *stream = &iter->streams[i];
+            g_thread_join(stream->thread);
+            g_clear_error(&stream->err);
+            pkg_ring_clear(&stream->parsed, TRUE);
+            // Package the thread was in the middle of
+            cr_package_free(stream->pd->pkg);
+            stream->pd->pkg = NULL;
+        }
+
+        g_mutex_clear(&iter->mutex);
+        g_cond_clear(&iter->cond);
+    }
+
     if (iter->tmp_err) {
         // An error already encountered
         // just close the file without error checking
@@ -473,13 +827,13 @@ void cr_PkgIterator_free(cr_PkgIterator *iter, GError **err) {
 
     if (iter->primary_pd) {
         // When interrupted at the right time primary_pd->pkg can either be:
-        //  - referenced in both primary_pd->pkg and cbdata.in_progress_pkgs_list or
+        //  - referenced in both primary_pd->pkg and cbdata.in_progress_pkgs or
         //  - referenced only in primary_pd->pkg (we have started parsing the pkg but didn't finish it yet)
         // in order to avoid a crash remove it from the list if present
         // primary_pd->pkg is a special case because of newpkgcb_primary
         cr_ParserData* primary_pd = iter->primary_pd;
-        if (cbdata->in_progress_pkgs_list) {
-            cbdata->in_progress_pkgs_list = g_slist_remove(cbdata->in_progress_pkgs_list, primary_pd->pkg);
+        if (primary_pd->pkg) {
+            pkg_ring_forget(&cbdata->in_progress_pkgs, primary_pd->pkg);
         }
 
         cr_package_free(primary_pd->pkg);
@@ -491,10 +845,10 @@ void cr_PkgIterator_free(cr_PkgIterator *iter, GError **err) {
 
 
     if (cbdata->newpkgcb) {
-        g_slist_free(cbdata->in_progress_pkgs_list);
+        pkg_ring_clear(&cbdata->in_progress_pkgs, FALSE);
         g_queue_free(cbdata->finished_pkgs_queue);
     } else {
-        g_slist_free_full(cbdata->in_progress_pkgs_list, (GDestroyNotify) cr_package_free);
+        pkg_ring_clear(&cbdata->in_progress_pkgs, TRUE);
         g_queue_free_full(cbdata->finished_pkgs_queue, (GDestroyNotify) cr_package_free);
     }
 
@@ -130,6 +130,9 @@ cr_start_handler(void *pdata, const xmlChar *element, const xmlChar **attr)
             cr_xml_parser_warning(pd, CR_XML_WARNING_MISSINGATTR,
                            "Missing attribute \"arch\" of a package element");
 
+        if (!cr_xml_filter_match(pd->filter, name, arch, NULL, NULL))
+            break;  // Rejected by the filter, the package is skipped
+
         // Get package object to store current package or NULL if
         // current XML package element should be skipped/ignored.
         if (pd->newpkgcb(&pd->pkg,
@@ -391,6 +394,62 @@ cr_xml_parse_other(const char *path,
                                        warningcb, warningcb_data, &cr_xml_parser_generic, err);
 }
 
+int
+cr_xml_parse_other_parallel(const char *path,
+                            cr_XmlParserNewPkgCb newpkgcb,
+                            void *newpkgcb_data,
+                            cr_XmlParserPkgCb pkgcb,
+                            void *pkgcb_data,
+                            cr_XmlParserWarningCb warningcb,
+                            void *warningcb_data,
+                            int threads,
+                            GError **err)
+{
+    return cr_xml_parser_parallel(path, other_parser_data_new,
+                                  "The target doesn't contain the expected element "
+                                  "\"<otherdata>\" - The target probably isn't "
+                                  "a valid other xml",
+                                  newpkgcb, newpkgcb_data, pkgcb, pkgcb_data,
+                                  warningcb, warningcb_data, threads, err);
+}
+
+int
+cr_xml_parse_other_fast(const char *path,
+                        cr_XmlParserNewPkgCb newpkgcb,
+                        void *newpkgcb_data,
+                        cr_XmlParserPkgCb pkgcb,
+                        void *pkgcb_data,
+                        cr_XmlParserWarningCb warningcb,
+                        void *warningcb_data,
+                        GError **err)
+{
+    return cr_xml_parser_fast(path, CR_XML_FAST_OTHER, NULL,
+                              "The target doesn't contain the expected element "
+                              "\"<otherdata>\" - The target probably isn't "
+                              "a valid other xml",
+                              newpkgcb, newpkgcb_data, pkgcb, pkgcb_data,
+                              warningcb, warningcb_data, err);
+}
+
+int
+cr_xml_parse_other_filtered(const char *path,
+                            const cr_XmlFilter *filter,
+                            cr_XmlParserNewPkgCb newpkgcb,
+                            void *newpkgcb_data,
+                            cr_XmlParserPkgCb pkgcb,
+                            void *pkgcb_data,
+                            cr_XmlParserWarningCb warningcb,
+                            void *warningcb_data,
+                            GError **err)
+{
+    return cr_xml_parser_fast(path, CR_XML_FAST_OTHER, filter,
+                              "The target doesn't contain the expected element "
+                              "\"<otherdata>\" - The target probably isn't "
+                              "a valid other xml",
+                              newpkgcb, newpkgcb_data, pkgcb, pkgcb_data,
+                              warningcb, warningcb_data, err);
+}
+
 int
 cr_xml_parse_other_snippet(const char *xml_string,
                            cr_XmlParserNewPkgCb newpkgcb,
@@ -0,0 +1,581 @@
+/* createrepo_c - Library of routines for manipulation with repodata
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#include <glib.h>
+#include <assert.h>
+#include <string.h>
+#include "error.h"
+#include "xml_parser.h"
+#include "xml_parser_internal.h"
+#include "misc.h"
+
+#define ERR_DOMAIN          CREATEREPO_C_ERROR
+#define READ_SIZE           (128 * 1024)
+#define BLOCK_SIZE          (4 * 1024 * 1024)   // Min size of a block
+#define BLOCKS_PER_THREAD   2                   // Max blocks in flight
+
+/* Parallel parsing of filelists[_ext].xml and other.xml
+ * ======================================================
+ * The caller thread decompresses the file and splits it into blocks
+ * of whole <package> elements. Every block is wrapped into the prolog
+ * of the file (everything before the first package) and the closing
+ * tag of the root element, and parsed by a thread from a pool with
+ * its own cr_ParserData. Parsed packages and warnings are kept in the
+ * block and the caller thread passes them to the user callbacks in
+ * the original order.
+ */
+
+/** Warning emitted while parsing a block.
+ */
+typedef struct {
+    guint                   pkg_index;  // Index of the package it belongs to
+    gboolean                in_pkg;     // Emitted inside the package element
+    gboolean                root_level; // Emitted by the root element
+    cr_XmlParserWarningType type;
+    char                    *msg;
+} cr_BlockWarning;
+
+/** Block of <package> elements.
+ */
+typedef struct {
+    GString             *data;      // Freed after parsing
+    gboolean            first;      // Contains the start of the file
+    gboolean            last;       // Contains the end of the file
+    cr_ParserData       *pd;        // Used only while parsing
+    GPtrArray           *pkgs;      // Parsed packages
+    GArray              *warnings;  // cr_BlockWarning
+    gboolean            main_tag_found;
+    gint64              newlines;   // Number of newlines in data
+    GError              *err;       // Error raised by the parser
+    int                 xml_err_line; // Line of a libxml2 error in the block
+    gboolean            done;       // Parsing finished
+} cr_Block;
+
+typedef struct {
+    const char              *path;
+    cr_XmlParserNewPkgCb    newpkgcb;
+    void                    *newpkgcb_data;
+    cr_XmlParserPkgCb       pkgcb;
+    void                    *pkgcb_data;
+    cr_XmlParserWarningCb   warningcb;
+    void                    *warningcb_data;
+    cr_ParserData *(*parser_data_new)(cr_XmlParserNewPkgCb, void *,
+                                      cr_XmlParserPkgCb, void *,
+                                      cr_XmlParserWarningCb, void *);
+
+    gchar       *prolog;        // Everything before the first package
+    gchar       *epilog;        // Closing tag of the root element
+    gint64      prolog_newlines;
+    gint64      newlines;       // Newlines before the next delivered block
+    gboolean    main_tag_found;
+
+    GThreadPool *pool;
+    GQueue      *blocks;        // Blocks in the order of the file
+    guint       submitted;      // Number of submitted blocks
+    GMutex      mutex;
+    GCond       cond;           // Signalled when a block is parsed
+    gint        cancelled;      // Skip parsing of the remaining blocks
+} cr_ParallelParser;
+
+static void
+block_free(cr_Block *block)
+{
+    if (!block)
+        return;
+
+    if (block->data)
+        g_string_free(block->data, TRUE);
+    g_ptr_array_free(block->pkgs, TRUE);
+    for (guint i = 0; i < block->warnings->len; i++)
+        g_free(g_array_index(block->warnings, cr_BlockWarning, i).msg);
+    g_array_free(block->warnings, TRUE);
+    g_clear_error(&block->err);
+    g_free(block);
+}
+
+static int
+block_pkgcb(cr_Package *pkg, void *cbdata, G_GNUC_UNUSED GError **err)
+{
+    cr_Block *block = cbdata;
+    g_ptr_array_add(block->pkgs, pkg);
+    return CR_CB_RET_OK;
+}
+
+static int
+block_warningcb(cr_XmlParserWarningType type,
+                char *msg,
+                void *cbdata,
+                G_GNUC_UNUSED GError **err)
+{
+    cr_Block *block = cbdata;
+    cr_BlockWarning warning;
+
+    warning.pkg_index = block->pkgs->len;
+    warning.in_pkg = block->pd->pkg != NULL;
+    warning.root_level = block->pd->depth <= 1;
+    warning.type = type;
+    warning.msg = g_strdup(msg);
+    g_array_append_val(block->warnings, warning);
+
+    return CR_CB_RET_OK;
+}
+
+static gint64
+count_newlines(const char *data, gsize len)
+{
+    gint64 count = 0;
+    const char *end = data + len;
+
+    while ((data = memchr(data, '\n', end - data))) {
+        count++;
+        data++;
+    }
+
+    return count;
+}
+
+static void
+parse_block(cr_ParallelParser *par, cr_Block *block)
+{
+    cr_ParserData *pd;
+
+    pd = par->parser_data_new(NULL, NULL, block_pkgcb, block,
+                              par->warningcb ? block_warningcb : NULL, block);
+    block->pd = pd;
+
+    // Parse the block wrapped into the prolog and the epilog of the file
+    const char *parts[3] = { par->prolog, block->data->str, par->epilog };
+    gsize lens[3] = { strlen(par->prolog), block->data->len, strlen(par->epilog) };
+    int nparts = block->last ? 2 : 3;
+
+    for (int i = 0; i < nparts && !pd->err; i++) {
+        if (xmlParseChunk(pd->parser, parts[i], lens[i], i == nparts - 1)) {
+            const xmlError *xml_err = xmlCtxtGetLastError(pd->parser);
+            block->xml_err_line = (xml_err) ? xml_err->line : 0;
+            g_set_error(&block->err, ERR_DOMAIN, CRE_XMLPARSER, "%s",
+                        (xml_err) ? xml_err->message : "UNKNOWN_ERROR");
+            break;
+        }
+    }
+
+    if (pd->err) {
+        g_clear_error(&block->err);
+        block->err = pd->err;
+        pd->err = NULL;
+    }
+
+    // Package which wasn't finished because of an error
+    cr_package_free(pd->pkg);
+    pd->pkg = NULL;
+
+    block->main_tag_found = pd->main_tag_found;
+    block->newlines = count_newlines(block->data->str, block->data->len);
+    block->pd = NULL;
+    cr_xml_parser_data_free(pd);
+
+    g_string_free(block->data, TRUE);
+    block->data = NULL;
+}
+
+static void
+parse_block_thread(gpointer data, gpointer user_data)
+{
+    cr_Block *block = data;
+    cr_ParallelParser *par = user_data;
+
+    if (!g_atomic_int_get(&par->cancelled))
+        parse_block(par, block);
+
+    g_mutex_lock(&par->mutex);
+    block->done = TRUE;
+    g_cond_broadcast(&par->cond);
+    g_mutex_unlock(&par->mutex);
+}
+
+/** Call the user warningcb the same way as cr_xml_parser_warning() does.
+ */
+static gboolean
+deliver_warning(cr_ParallelParser *par, cr_BlockWarning *warning, GError **err)
+{
+    GError *tmp_err = NULL;
+
+    if (par->warningcb(warning->type, warning->msg, par->warningcb_data,
+                       &tmp_err) == CR_CB_RET_OK)
+        return TRUE;
+
+    if (tmp_err)
+        g_propagate_prefixed_error(err, tmp_err, "Parsing interrupted: ");
+    else
+        g_set_error(err, ERR_DOMAIN, CRE_CBINTERRUPTED, "Parsing interrupted");
+    return FALSE;
+}
+
+/** Pass the content of a parsed block to the user callbacks in the order
+ * in which a sequential parser would call them.
+ */
+static gboolean
+deliver_block(cr_ParallelParser *par, cr_Block *block, GError **err)
+{
+    GError *tmp_err = NULL;
+    guint w = 0;
+
+    for (guint i = 0; i <= block->pkgs->len; i++) {
+        cr_Package *parsed, *pkg = NULL;
+
+        // Warnings raised before the package element was opened,
+        // the prolog and epilog are parsed with every block but the
+        // sequential parser sees them only once
+        while (w < block->warnings->len) {
+            cr_BlockWarning *warning = &g_array_index(block->warnings, cr_BlockWarning, w);
+            if (warning->pkg_index != i || warning->in_pkg)
+                break;
+            w++;
+            if (warning->root_level && !(i == 0 ? block->first : block->last))
+                continue;
+            if (!deliver_warning(par, warning, err))
+                return FALSE;
+        }
+
+        if (i == block->pkgs->len)
+            break;
+
+        parsed = block->pkgs->pdata[i];
+        block->pkgs->pdata[i] = NULL;
+
+        if (par->newpkgcb) {
+            if (par->newpkgcb(&pkg, parsed->pkgId, parsed->name, parsed->arch,
+                              par->newpkgcb_data, &tmp_err)) {
+                cr_package_free(parsed);
+                if (tmp_err)
+                    g_propagate_prefixed_error(err, tmp_err, "Parsing interrupted: ");
+                else
+                    g_set_error(err, ERR_DOMAIN, CRE_CBINTERRUPTED, "Parsing interrupted");
+                return FALSE;
+            }
+            if (pkg)
+                cr_xml_parser_move_package_data(parsed, pkg);
+            cr_package_free(parsed);
+        } else {
+            pkg = parsed;
+        }
+
+        // Warnings raised inside of the package element, a sequential
+        // parser doesn't see them when the package is skipped
+        while (w < block->warnings->len) {
+            cr_BlockWarning *warning = &g_array_index(block->warnings, cr_BlockWarning, w);
+            if (warning->pkg_index != i)
+                break;
+            w++;
+            if (pkg && !deliver_warning(par, warning, err))
+                return FALSE;
+        }
+
+        if (pkg && par->pkgcb && par->pkgcb(pkg, par->pkgcb_data, &tmp_err)) {
+            if (tmp_err)
+                g_propagate_prefixed_error(err, tmp_err, "Parsing interrupted: ");
+            else
+                g_set_error(err, ERR_DOMAIN, CRE_CBINTERRUPTED, "Parsing interrupted");
+            return FALSE;
+        }
+    }
+
+    if (block->err) {
+        if (block->err->code == CRE_XMLPARSER && block->err->domain == ERR_DOMAIN) {
+            // Line in the block -> line in the file
+            int line = block->xml_err_line;
+            if (line > par->prolog_newlines)
+                line += par->newlines - par->prolog_newlines;
+            g_critical("%s: parsing error '%s': %s",
+                       __func__, par->path, block->err->message);
+            g_set_error(err, ERR_DOMAIN, CRE_XMLPARSER,
+                        "Parse error '%s' at line: %d (%s)",
+                        par->path, line, block->err->message);
+        } else {
+            g_propagate_error(err, block->err);
+            block->err = NULL;
+        }
+        return FALSE;
+    }
+
+    par->newlines += block->newlines;
+    if (block->main_tag_found)
+        par->main_tag_found = TRUE;
+
+    return TRUE;
+}
+
+/** Wait for the oldest block and deliver it.
+ */
+static gboolean
+deliver_oldest_block(cr_ParallelParser *par, GError **err)
+{
+    gboolean ret;
+    cr_Block *block = g_queue_pop_head(par->blocks);
+
+    g_mutex_lock(&par->mutex);
+    while (!block->done)
+        g_cond_wait(&par->cond, &par->mutex);
+    g_mutex_unlock(&par->mutex);
+
+    ret = deliver_block(par, block, err);
+    block_free(block);
+    return ret;
+}
+
+static gboolean
+submit_block(cr_ParallelParser *par, GString *data, gboolean last, GError **err)
+{
+    cr_Block *block;
+    guint max_blocks = g_thread_pool_get_max_threads(par->pool) * BLOCKS_PER_THREAD;
+
+    // Keep the memory bounded
+    while (g_queue_get_length(par->blocks) >= max_blocks)
+        if (!deliver_oldest_block(par, err)) {
+            g_string_free(data, TRUE);
+            return FALSE;
+        }
+
+    block = g_new0(cr_Block, 1);
+    block->data = data;
+    block->first = !par->submitted++;
+    block->last = last;
+    block->pkgs = g_ptr_array_new_with_free_func((GDestroyNotify) cr_package_free);
+    block->warnings = g_array_new(FALSE, FALSE, sizeof(cr_BlockWarning));
+    g_queue_push_tail(par->blocks, block);
+    g_thread_pool_push(par->pool, block, NULL);
+
+    return TRUE;
+}
+
+/** Offset of the first (or the last) package element in the data or -1.
+ * Markup inside of comments, CDATA sections and processing instructions
+ * is skipped, the data must not start inside of them. (Text content and
+ * attribute values cannot contain a '<'.)
+ */
+static gssize
+package_offset(GString *data, gboolean last)
+{
+    const char *p = data->str;
+    const char *end = data->str + data->len;
+    gssize found = -1;
+
+    while ((p = memchr(p, '<', end - p))) {
+        gsize left = end - p;
+        const char *skip_to = NULL;
+
+        if (left >= 9 && !memcmp(p, "<![CDATA[", 9))
+            skip_to = "]]>";
+        else if (left >= 4 && !memcmp(p, "<!--", 4))
+            skip_to = "-->";
+        else if (left >= 2 && p[1] == '?')
+            skip_to = "?>";
+
+        if (skip_to) {
+            p = g_strstr_len(p, left, skip_to);
+            if (!p)
+                break;  // The rest of the data is inside of it
+            p += strlen(skip_to);
+            continue;
+        }
+
+        if (left > strlen("<package") && !memcmp(p, "<package", strlen("<package"))) {
+            char c = p[strlen("<package")];
+            if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '>') {
+                found = p - data->str;
+                if (!last)
+                    break;
+            }
+        }
+
+        p++;
+    }
+
+    return found;
+}
+
+/** Closing tag of the last opened element in the prolog.
+ */
+static gchar *
+closing_tag(const char *prolog)
+{
+    const char *tag = NULL;
+
+    for (const char *p = strchr(prolog, '<'); p; p = strchr(p + 1, '<'))
+        if (p[1] != '?' && p[1] != '!' && p[1] != '/')
+            tag = p + 1;
+
+    if (!tag)
+        return g_strdup("");
+
+    return g_strdup_printf("</%.*s>", (int) strcspn(tag, " \t\r\n/>"), tag);
+}
+
+int
+cr_xml_parser_parallel(const char *path,
+                       cr_ParserData *(*parser_data_new)(cr_XmlParserNewPkgCb, void *,
+                                                         cr_XmlParserPkgCb, void *,
+                                                         cr_XmlParserWarningCb, void *),
+                       const char *main_tag_warning,
+                       cr_XmlParserNewPkgCb newpkgcb,
+                       void *newpkgcb_data,
+                       cr_XmlParserPkgCb pkgcb,
+                       void *pkgcb_data,
+                       cr_XmlParserWarningCb warningcb,
+                       void *warningcb_data,
+                       int threads,
+                       GError **err)
+{
+    int ret = CRE_OK;
+    CR_FILE *f;
+    GString *data;
+    GError *tmp_err = NULL;
+    cr_ParallelParser par;
+    gboolean eof = FALSE;
+
+    assert(path);
+    assert(parser_data_new);
+    assert(newpkgcb || pkgcb);
+    assert(!err || *err == NULL);
+
+    if (threads < 1)
+        threads = g_get_num_processors();
+
+    f = cr_open(path, CR_CW_MODE_READ, CR_CW_AUTO_DETECT_COMPRESSION, &tmp_err);
+    if (tmp_err) {
+        int code = tmp_err->code;
+        g_propagate_prefixed_error(err, tmp_err, "Cannot open %s: ", path);
+        return code;
+    }
+
+    memset(&par, 0, sizeof(par));
+    par.path = path;
+    par.newpkgcb = newpkgcb;
+    par.newpkgcb_data = newpkgcb_data;
+    par.pkgcb = pkgcb;
+    par.pkgcb_data = pkgcb_data;
+    par.warningcb = warningcb;
+    par.warningcb_data = warningcb_data;
+    par.parser_data_new = parser_data_new;
+    par.blocks = g_queue_new();
+    g_mutex_init(&par.mutex);
+    g_cond_init(&par.cond);
+    par.pool = g_thread_pool_new(parse_block_thread, &par, threads, FALSE, NULL);
+
+    data = g_string_sized_new(BLOCK_SIZE + READ_SIZE);
+
+    while (!eof) {
+        gsize len = data->len;
+        int read;
+
+        g_string_set_size(data, len + READ_SIZE);
+        read = cr_read(f, data->str + len, READ_SIZE, &tmp_err);
+        if (tmp_err) {
+            ret = tmp_err->code;
+            g_critical("%s: Error while reading xml '%s': %s",
+                       __func__, path, tmp_err->message);
+            g_propagate_prefixed_error(err, tmp_err, "Read error: ");
+            break;
+        }
+        g_string_set_size(data, len + read);
+        eof = read == 0;
+
+        if (!par.prolog) {
+            gssize offset = package_offset(data, FALSE);
+            if (offset < 0)
+                continue;   // Keep reading, whole file is used if not found
+
+            par.prolog = g_strndup(data->str, offset);
+            par.epilog = closing_tag(par.prolog);
+            par.prolog_newlines = count_newlines(par.prolog, offset);
+            par.newlines = par.prolog_newlines;
+            g_string_erase(data, 0, offset);
+        }
+
+        if (data->len >= BLOCK_SIZE && !eof) {
+            // Cut before the last (probably incomplete) package
+            gssize offset = package_offset(data, TRUE);
+            if (offset <= 0)
+                continue;   // One huge package
+
+            GString *rest = g_string_sized_new(BLOCK_SIZE + READ_SIZE);
+            g_string_append_len(rest, data->str + offset, data->len - offset);
+            g_string_truncate(data, offset);
+            if (!submit_block(&par, data, FALSE, &tmp_err)) {
+                ret = tmp_err->code;
+                g_propagate_error(err, tmp_err);
+                data = rest;
+                break;
+            }
+            data = rest;
+        }
+    }
+
+    if (ret == CRE_OK) {
+        if (!par.prolog) {
+            // No package at all
+            par.prolog = g_strdup("");
+            par.epilog = g_strdup("");
+        }
+
+        if (submit_block(&par, data, TRUE, &tmp_err)) {
+            data = NULL;
+            while (!g_queue_is_empty(par.blocks) && ret == CRE_OK)
+                if (!deliver_oldest_block(&par, &tmp_err)) {
+                    ret = tmp_err->code;
+                    g_propagate_error(err, tmp_err);
+                }
+        } else {
+            data = NULL;
+            ret = tmp_err->code;
+            g_propagate_error(err, tmp_err);
+        }
+    }
+
+    // Stop parsing of the blocks nobody is going to deliver
+    g_atomic_int_set(&par.cancelled, TRUE);
+    g_thread_pool_free(par.pool, FALSE, TRUE);
+    g_queue_free_full(par.blocks, (GDestroyNotify) block_free);
+    if (data)
+        g_string_free(data, TRUE);
+
+    if (ret != CRE_OK) {
+        cr_close(f, NULL);
+    } else {
+        cr_close(f, &tmp_err);
+        if (tmp_err) {
+            ret = tmp_err->code;
+            g_propagate_prefixed_error(err, tmp_err, "Error while closing: ");
+        }
+    }
+
+    // Warning if file was probably a different type than expected
+    // (like in the sequential parsers its result is ignored)
+    if (ret == CRE_OK && !par.main_tag_found && warningcb) {
+        warningcb(CR_XML_WARNING_BADMDTYPE, (char *) main_tag_warning,
+                  warningcb_data, &tmp_err);
+        g_clear_error(&tmp_err);
+    }
+
+    g_free(par.prolog);
+    g_free(par.epilog);
+    g_mutex_clear(&par.mutex);
+    g_cond_clear(&par.cond);
+
+    return ret;
+}
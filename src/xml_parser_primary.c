@@ -120,6 +120,135 @@ static cr_StatesSwitch stateswitches[] = {
     { NUMSTATES,            NULL,               NUMSTATES,              0 },
 };
 
+/** Copy values parsed into the package owned by the parser into the
+ * package returned by the newpkgcb. Like the parser does, pkgId, name,
+ * arch and version strings are set only if they are missing.
+ */
+static void
+copy_filtered_package(cr_Package *parsed, cr_Package *pkg)
+{
+#define COPY_MISSING(member) \
+    if (!pkg->member) \
+        pkg->member = cr_safe_string_chunk_insert(pkg->chunk, parsed->member)
+#define COPY_STR(member) \
+    if (parsed->member) \
+        pkg->member = g_string_chunk_insert(pkg->chunk, parsed->member)
+#define COPY_NUM(member) \
+    if (parsed->member) \
+        pkg->member = parsed->member
+
+    COPY_MISSING(pkgId);
+    COPY_MISSING(name);
+    COPY_MISSING(arch);
+    COPY_MISSING(epoch);
+    COPY_MISSING(version);
+    COPY_MISSING(release);
+    COPY_STR(checksum_type);
+    COPY_STR(summary);
+    COPY_STR(description);
+    COPY_STR(rpm_packager);
+    COPY_STR(url);
+    COPY_NUM(time_file);
+    COPY_NUM(time_build);
+    COPY_NUM(size_package);
+    COPY_NUM(size_installed);
+    COPY_NUM(size_archive);
+    COPY_STR(location_href);
+    COPY_STR(location_base);
+    COPY_STR(rpm_license);
+    COPY_STR(rpm_vendor);
+    COPY_STR(rpm_group);
+    COPY_STR(rpm_buildhost);
+    COPY_STR(rpm_sourcerpm);
+    COPY_NUM(rpm_header_start);
+    COPY_NUM(rpm_header_end);
+
+#undef COPY_MISSING
+#undef COPY_STR
+#undef COPY_NUM
+}
+
+/** Start parsing a package into the package owned by the parser.
+ */
+static void
+filter_package_start(cr_ParserData *pd, const char *type)
+{
+    cr_Package *parsed = pd->filter_pkg;
+
+    if (!parsed) {
+        parsed = pd->filter_pkg = cr_package_new();
+    } else {
+        // Reuse the package and its chunk. Only scalar values are parsed
+        // into it, so there is nothing else to free.
+        GStringChunk *chunk = parsed->chunk;
+        g_string_chunk_clear(chunk);
+        memset(parsed, 0, sizeof(*parsed));
+        parsed->chunk = chunk;
+    }
+
+    pd->filter_pkg_type = cr_safe_string_chunk_insert(parsed->chunk, type);
+    pd->pkg = parsed;
+}
+
+/** Decide about the package parsed into pd->filter_pkg. A package rejected
+ * by the filter is skipped. An accepted one is passed to the newpkgcb once
+ * all the values the filter looks at are known (or if force is TRUE,
+ * because values which are not stored in the package owned by the parser
+ * follow).
+ */
+static void
+filter_package_decide(cr_ParserData *pd, gboolean force)
+{
+    GError *tmp_err = NULL;
+    cr_Package *parsed = pd->filter_pkg;
+
+    if (!pd->pkg || pd->pkg != parsed)
+        return;  // No package is waiting for the filter
+
+    if (!cr_xml_filter_match_package(pd->filter, parsed)) {
+        pd->pkg = NULL;
+        return;
+    }
+
+    if (!force && !cr_xml_filter_decided(pd->filter, parsed))
+        return;
+
+    pd->pkg = NULL;
+    if (pd->newpkgcb(&pd->pkg,
+                     pd->filter_pkg_type,
+                     parsed->name,
+                     parsed->arch,
+                     pd->newpkgcb_data,
+                     &tmp_err))
+    {
+        if (tmp_err)
+            g_propagate_prefixed_error(&pd->err,
+                                       tmp_err,
+                                       "Parsing interrupted: ");
+        else
+            g_set_error(&pd->err, ERR_DOMAIN, CRE_CBINTERRUPTED,
+                        "Parsing interrupted");
+        return;
+    } else {
+        // If callback return CRE_OK but it simultaneously set
+        // the tmp_err then it's a programming error.
+        assert(tmp_err == NULL);
+    }
+
+    if (pd->pkg)
+        copy_filtered_package(parsed, pd->pkg);
+}
+
+/** Only scalar values of a package are parsed before the lists of
+ * dependencies and files, these can be parsed into the package owned
+ * by the parser.
+ */
+static inline gboolean
+filter_pending_state(unsigned int state)
+{
+    return state <= STATE_RPM_HEADER_RANGE;
+}
+
 static void XMLCALL
 cr_start_handler(void *pdata, const xmlChar *element, const xmlChar **attr)
 {
@@ -156,6 +285,12 @@ cr_start_handler(void *pdata, const xmlChar *element, const xmlChar **attr)
         return;
     }
 
+    if (pd->pkg && pd->pkg == pd->filter_pkg && !filter_pending_state(sw->to)) {
+        filter_package_decide(pd, TRUE);
+        if (!pd->pkg || pd->err)
+            return;  // Package was rejected, skipped or an error occurred
+    }
+
     gboolean free_attr = FALSE;
     attr = unescape_ampersand_from_values(attr, &free_attr);
 
@@ -185,6 +320,12 @@ cr_start_handler(void *pdata, const xmlChar *element, const xmlChar **attr)
             cr_xml_parser_warning(pd, CR_XML_WARNING_MISSINGATTR,
                            "Missing attribute \"type\" of a package element");
 
+        if (pd->filter) {
+            // The newpkgcb is called when the filter decides
+            filter_package_start(pd, val);
+            break;
+        }
+
         // Get package object to store current package or NULL if
         // current XML package element should be skipped/ignored.
         if (pd->newpkgcb(&pd->pkg,
@@ -306,6 +447,7 @@ cr_start_handler(void *pdata, const xmlChar *element, const xmlChar **attr)
         if (val)
             pd->pkg->location_base = g_string_chunk_insert(pd->pkg->chunk, val);
 
+        filter_package_decide(pd, FALSE);
         break;
 
     case STATE_FORMAT:
@@ -480,7 +622,8 @@ cr_end_handler(void *pdata, G_GNUC_UNUSED const xmlChar *element)
         break;
 
     case STATE_PACKAGE:
-        if (!pd->pkg)
+        filter_package_decide(pd, TRUE);
+        if (!pd->pkg || pd->err)
             return;
 
         if (!pd->pkg->pkgId) {
@@ -524,6 +667,7 @@ cr_end_handler(void *pdata, G_GNUC_UNUSED const xmlChar *element)
             // name could be already filled by filelists or other xml parser
             pd->pkg->name = cr_safe_string_chunk_insert_null(pd->pkg->chunk,
                                                              pd->content);
+        filter_package_decide(pd, FALSE);
         break;
 
     case STATE_ARCH:
@@ -532,6 +676,7 @@ cr_end_handler(void *pdata, G_GNUC_UNUSED const xmlChar *element)
             // arch could be already filled by filelists or other xml parser
             pd->pkg->arch = cr_safe_string_chunk_insert_null(pd->pkg->chunk,
                                                              pd->content);
+        filter_package_decide(pd, FALSE);
         break;
 
     case STATE_CHECKSUM:
@@ -594,6 +739,7 @@ cr_end_handler(void *pdata, G_GNUC_UNUSED const xmlChar *element)
         assert(pd->pkg);
         pd->pkg->rpm_sourcerpm = cr_safe_string_chunk_insert_null(pd->pkg->chunk,
                                                                   pd->content);
+        filter_package_decide(pd, FALSE);
         break;
 
     case STATE_RPM_PROVIDES:
@@ -710,6 +856,7 @@ primary_parser_data_new(cr_XmlParserNewPkgCb newpkgcb,
 
 int
 cr_xml_parse_primary_internal(const char *target,
+                              const cr_XmlFilter *filter,
                               cr_XmlParserNewPkgCb newpkgcb,
                               void *newpkgcb_data,
                               cr_XmlParserPkgCb pkgcb,
@@ -728,6 +875,7 @@ cr_xml_parse_primary_internal(const char *target,
 
     cr_ParserData *pd;
     pd = primary_parser_data_new(newpkgcb, newpkgcb_data, pkgcb, pkgcb_data, warningcb, warningcb_data, do_files);
+    pd->filter = filter;
 
     // Parsing
     ret = parser_func(pd->parser, pd, target, &tmp_err);
@@ -745,13 +893,14 @@ cr_xml_parse_primary_internal(const char *target,
 
     // Clean up
 
-    if (ret != CRE_OK && newpkgcb == cr_newpkgcb) {
+    if (ret != CRE_OK && newpkgcb == cr_newpkgcb && pd->pkg != pd->filter_pkg) {
         // Prevent memory leak when the parsing is interrupted by an error.
         // If a new package object was created by the cr_newpkgcb then
         // is obvious that there is no other reference to the package
         // except of the parser reference in pd->pkg.
         // If a caller supplied its own newpkgcb, then the freeing
         // of the currently parsed package is the caller responsibility.
+        // The package owned by the parser is freed with the parser data.
         cr_package_free(pd->pkg);
     }
 
@@ -772,7 +921,23 @@ cr_xml_parse_primary(const char *path,
                      GError **err)
 {
 
-    return cr_xml_parse_primary_internal(path, newpkgcb, newpkgcb_data, pkgcb, pkgcb_data,
+    return cr_xml_parse_primary_internal(path, NULL, newpkgcb, newpkgcb_data, pkgcb, pkgcb_data,
+                                         warningcb, warningcb_data, do_files, &cr_xml_parser_generic, err);
+}
+
+int
+cr_xml_parse_primary_filtered(const char *path,
+                              const cr_XmlFilter *filter,
+                              cr_XmlParserNewPkgCb newpkgcb,
+                              void *newpkgcb_data,
+                              cr_XmlParserPkgCb pkgcb,
+                              void *pkgcb_data,
+                              cr_XmlParserWarningCb warningcb,
+                              void *warningcb_data,
+                              int do_files,
+                              GError **err)
+{
+    return cr_xml_parse_primary_internal(path, filter, newpkgcb, newpkgcb_data, pkgcb, pkgcb_data,
                                          warningcb, warningcb_data, do_files, &cr_xml_parser_generic, err);
 }
 
@@ -788,7 +953,7 @@ cr_xml_parse_primary_snippet(const char *xml_string,
                              GError **err)
 {
     gchar* wrapped_xml_string = g_strconcat("<metadata>", xml_string, "</metadata>", NULL);
-    int ret =  cr_xml_parse_primary_internal(wrapped_xml_string, newpkgcb, newpkgcb_data, pkgcb, pkgcb_data,
+    int ret =  cr_xml_parse_primary_internal(wrapped_xml_string, NULL, newpkgcb, newpkgcb_data, pkgcb, pkgcb_data,
                                              warningcb, warningcb_data, do_files, &cr_xml_parser_generic_from_string, err);
     g_free(wrapped_xml_string);
     return ret;
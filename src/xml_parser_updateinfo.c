@@ -176,14 +176,15 @@ cr_start_handler(void *pdata, const xmlChar *element, const xmlChar **attr)
         break;
 
     case STATE_UPDATE:
-        assert(pd->updateinfo);
+        assert(pd->updateinfo || pd->updaterecordcb);
         assert(!pd->updaterecord);
         assert(!pd->updatecollection);
         assert(!pd->updatecollectionmodule);
         assert(!pd->updatecollectionpackage);
 
         rec = cr_updaterecord_new();
-        cr_updateinfo_apped_record(pd->updateinfo, rec);
+        if (!pd->updaterecordcb)
+            cr_updateinfo_apped_record(pd->updateinfo, rec);
         pd->updaterecord = rec;
 
         val = cr_find_attr("from", attr);
@@ -205,7 +206,6 @@ cr_start_handler(void *pdata, const xmlChar *element, const xmlChar **attr)
         break;
 
     case STATE_ISSUED:
-        assert(pd->updateinfo);
         assert(pd->updaterecord);
         assert(!pd->updatecollection);
         assert(!pd->updatecollectionmodule);
@@ -216,7 +216,6 @@ cr_start_handler(void *pdata, const xmlChar *element, const xmlChar **attr)
         break;
 
     case STATE_UPDATED:
-        assert(pd->updateinfo);
         assert(pd->updaterecord);
         assert(!pd->updatecollection);
         assert(!pd->updatecollectionmodule);
@@ -229,7 +228,6 @@ cr_start_handler(void *pdata, const xmlChar *element, const xmlChar **attr)
     case STATE_REFERENCE: {
         cr_UpdateReference *ref;
 
-        assert(pd->updateinfo);
         assert(pd->updaterecord);
         assert(!pd->updatecollection);
         assert(!pd->updatecollectionmodule);
@@ -258,7 +256,6 @@ cr_start_handler(void *pdata, const xmlChar *element, const xmlChar **attr)
     }
 
     case STATE_COLLECTION:
-        assert(pd->updateinfo);
         assert(pd->updaterecord);
         assert(!pd->updatecollection);
         assert(!pd->updatecollectionmodule);
@@ -275,7 +272,6 @@ cr_start_handler(void *pdata, const xmlChar *element, const xmlChar **attr)
         break;
 
     case STATE_MODULE:
-        assert(pd->updateinfo);
         assert(pd->updaterecord);
         assert(pd->updatecollection);
         assert(!pd->updatecollectionmodule);
@@ -320,7 +316,6 @@ cr_start_handler(void *pdata, const xmlChar *element, const xmlChar **attr)
         break;
 
     case STATE_PACKAGE:
-        assert(pd->updateinfo);
         assert(pd->updaterecord);
         assert(pd->updatecollection);
         assert(!pd->updatecollectionpackage);
@@ -358,7 +353,6 @@ cr_start_handler(void *pdata, const xmlChar *element, const xmlChar **attr)
         break;
 
     case STATE_SUM:
-        assert(pd->updateinfo);
         assert(pd->updaterecord);
         assert(pd->updatecollection);
         assert(pd->updatecollectionpackage);
@@ -368,13 +362,11 @@ cr_start_handler(void *pdata, const xmlChar *element, const xmlChar **attr)
         break;
 
     case STATE_UPDATERECORD_REBOOTSUGGESTED:
-        assert(pd->updateinfo);
         assert(pd->updaterecord);
         rec->reboot_suggested = TRUE;
         break;
 
     case STATE_REBOOTSUGGESTED:
-        assert(pd->updateinfo);
         assert(pd->updaterecord);
         assert(pd->updatecollection);
         assert(pd->updatecollectionpackage);
@@ -382,7 +374,6 @@ cr_start_handler(void *pdata, const xmlChar *element, const xmlChar **attr)
         break;
 
     case STATE_RESTARTSUGGESTED:
-        assert(pd->updateinfo);
         assert(pd->updaterecord);
         assert(pd->updatecollection);
         assert(pd->updatecollectionpackage);
@@ -390,7 +381,6 @@ cr_start_handler(void *pdata, const xmlChar *element, const xmlChar **attr)
         break;
 
     case STATE_RELOGINSUGGESTED:
-        assert(pd->updateinfo);
         assert(pd->updaterecord);
         assert(pd->updatecollection);
         assert(pd->updatecollectionpackage);
@@ -447,7 +437,6 @@ cr_end_handler(void *pdata, G_GNUC_UNUSED const xmlChar *element)
         break;
 
     case STATE_ID:
-        assert(pd->updateinfo);
         assert(pd->updaterecord);
         assert(!pd->updatecollection);
         assert(!pd->updatecollectionpackage);
@@ -455,7 +444,6 @@ cr_end_handler(void *pdata, G_GNUC_UNUSED const xmlChar *element)
         break;
 
     case STATE_TITLE:
-        assert(pd->updateinfo);
         assert(pd->updaterecord);
         assert(!pd->updatecollection);
         assert(!pd->updatecollectionpackage);
@@ -463,7 +451,6 @@ cr_end_handler(void *pdata, G_GNUC_UNUSED const xmlChar *element)
         break;
 
     case STATE_RIGHTS:
-        assert(pd->updateinfo);
         assert(pd->updaterecord);
         assert(!pd->updatecollection);
         assert(!pd->updatecollectionpackage);
@@ -471,7 +458,6 @@ cr_end_handler(void *pdata, G_GNUC_UNUSED const xmlChar *element)
         break;
 
     case STATE_RELEASE:
-        assert(pd->updateinfo);
         assert(pd->updaterecord);
         assert(!pd->updatecollection);
         assert(!pd->updatecollectionpackage);
@@ -479,7 +465,6 @@ cr_end_handler(void *pdata, G_GNUC_UNUSED const xmlChar *element)
         break;
 
     case STATE_PUSHCOUNT:
-        assert(pd->updateinfo);
         assert(pd->updaterecord);
         assert(!pd->updatecollection);
         assert(!pd->updatecollectionpackage);
@@ -487,7 +472,6 @@ cr_end_handler(void *pdata, G_GNUC_UNUSED const xmlChar *element)
         break;
 
     case STATE_SEVERITY:
-        assert(pd->updateinfo);
         assert(pd->updaterecord);
         assert(!pd->updatecollection);
         assert(!pd->updatecollectionpackage);
@@ -495,7 +479,6 @@ cr_end_handler(void *pdata, G_GNUC_UNUSED const xmlChar *element)
         break;
 
     case STATE_SUMMARY:
-        assert(pd->updateinfo);
         assert(pd->updaterecord);
         assert(!pd->updatecollection);
         assert(!pd->updatecollectionpackage);
@@ -503,7 +486,6 @@ cr_end_handler(void *pdata, G_GNUC_UNUSED const xmlChar *element)
         break;
 
     case STATE_DESCRIPTION:
-        assert(pd->updateinfo);
         assert(pd->updaterecord);
         assert(!pd->updatecollection);
         assert(!pd->updatecollectionpackage);
@@ -511,7 +493,6 @@ cr_end_handler(void *pdata, G_GNUC_UNUSED const xmlChar *element)
         break;
 
     case STATE_SOLUTION:
-        assert(pd->updateinfo);
         assert(pd->updaterecord);
         assert(!pd->updatecollection);
         assert(!pd->updatecollectionpackage);
@@ -519,7 +500,6 @@ cr_end_handler(void *pdata, G_GNUC_UNUSED const xmlChar *element)
         break;
 
     case STATE_NAME:
-        assert(pd->updateinfo);
         assert(pd->updaterecord);
         assert(pd->updatecollection);
         assert(!pd->updatecollectionpackage);
@@ -527,7 +507,6 @@ cr_end_handler(void *pdata, G_GNUC_UNUSED const xmlChar *element)
         break;
 
     case STATE_FILENAME:
-        assert(pd->updateinfo);
         assert(pd->updaterecord);
         assert(pd->updatecollection);
         assert(pd->updatecollectionpackage);
@@ -536,7 +515,6 @@ cr_end_handler(void *pdata, G_GNUC_UNUSED const xmlChar *element)
         break;
 
     case STATE_SUM:
-        assert(pd->updateinfo);
         assert(pd->updaterecord);
         assert(pd->updatecollection);
         assert(pd->updatecollectionpackage);
@@ -544,7 +522,6 @@ cr_end_handler(void *pdata, G_GNUC_UNUSED const xmlChar *element)
         break;
 
     case STATE_PACKAGE:
-        assert(pd->updateinfo);
         assert(pd->updaterecord);
         assert(pd->updatecollection);
         assert(pd->updatecollectionpackage);
@@ -552,7 +529,6 @@ cr_end_handler(void *pdata, G_GNUC_UNUSED const xmlChar *element)
         break;
 
     case STATE_COLLECTION:
-        assert(pd->updateinfo);
         assert(pd->updaterecord);
         assert(pd->updatecollection);
         assert(!pd->updatecollectionpackage);
@@ -560,10 +536,29 @@ cr_end_handler(void *pdata, G_GNUC_UNUSED const xmlChar *element)
         break;
 
     case STATE_UPDATE:
-        assert(pd->updateinfo);
         assert(pd->updaterecord);
         assert(!pd->updatecollection);
         assert(!pd->updatecollectionpackage);
+
+        if (pd->updaterecordcb) {
+            GError *tmp_err = NULL;
+
+            // The record is owned by the callback from now on
+            if (pd->updaterecordcb(rec, pd->updaterecordcb_data, &tmp_err)) {
+                if (tmp_err)
+                    g_propagate_prefixed_error(&pd->err,
+                                               tmp_err,
+                                               "Parsing interrupted: ");
+                else
+                    g_set_error(&pd->err, ERR_DOMAIN, CRE_CBINTERRUPTED,
+                                "Parsing interrupted");
+            } else {
+                // If callback return CRE_OK but it simultaneously set
+                // the tmp_err then it's a programming error.
+                assert(tmp_err == NULL);
+            }
+        }
+
         pd->updaterecord = NULL;
         break;
 
@@ -572,19 +567,21 @@ cr_end_handler(void *pdata, G_GNUC_UNUSED const xmlChar *element)
     }
 }
 
-int
-cr_xml_parse_updateinfo(const char *path,
-                        cr_UpdateInfo *updateinfo,
-                        cr_XmlParserWarningCb warningcb,
-                        void *warningcb_data,
-                        GError **err)
+static int
+xml_parse_updateinfo(const char *path,
+                     cr_UpdateInfo *updateinfo,
+                     cr_XmlParserUpdateRecordCb updaterecordcb,
+                     void *updaterecordcb_data,
+                     cr_XmlParserWarningCb warningcb,
+                     void *warningcb_data,
+                     GError **err)
 {
     int ret = CRE_OK;
     cr_ParserData *pd;
     GError *tmp_err = NULL;
 
     assert(path);
-    assert(updateinfo);
+    assert(updateinfo || updaterecordcb);
     assert(!err || *err == NULL);
 
     // Init
@@ -602,6 +599,8 @@ cr_xml_parse_updateinfo(const char *path,
     pd->parser = parser;
     pd->state = STATE_START;
     pd->updateinfo = updateinfo;
+    pd->updaterecordcb = updaterecordcb;
+    pd->updaterecordcb_data = updaterecordcb_data;
     pd->warningcb = warningcb;
     pd->warningcb_data = warningcb_data;
     for (cr_StatesSwitch *sw = stateswitches; sw->from != NUMSTATES; sw++) {
@@ -626,7 +625,38 @@ cr_xml_parse_updateinfo(const char *path,
 
     // Clean up
 
+    if (pd->updaterecordcb && pd->updaterecord)
+        // Parsing was interrupted inside of an update element
+        cr_updaterecord_free(pd->updaterecord);
     cr_xml_parser_data_free(pd);
 
     return ret;
 }
+
+int
+cr_xml_parse_updateinfo(const char *path,
+                        cr_UpdateInfo *updateinfo,
+                        cr_XmlParserWarningCb warningcb,
+                        void *warningcb_data,
+                        GError **err)
+{
+    assert(updateinfo);
+
+    return xml_parse_updateinfo(path, updateinfo, NULL, NULL,
+                                warningcb, warningcb_data, err);
+}
+
+int
+cr_xml_parse_updateinfo_with_cb(const char *path,
+                                cr_XmlParserUpdateRecordCb updaterecordcb,
+                                void *updaterecordcb_data,
+                                cr_XmlParserWarningCb warningcb,
+                                void *warningcb_data,
+                                GError **err)
+{
+    assert(updaterecordcb);
+
+    return xml_parse_updateinfo(path, NULL, updaterecordcb,
+                                updaterecordcb_data, warningcb,
+                                warningcb_data, err);
+}
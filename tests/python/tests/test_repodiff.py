@@ -0,0 +1,34 @@
+import unittest
+import createrepo_c as cr
+
+from .fixtures import *
+
+class TestCaseRepodiff(unittest.TestCase):
+
+    def test_repodiff_same(self):
+        diff = cr.repodiff(REPO_02_PRIXML, REPO_02_PRIXML)
+        self.assertEqual(diff["unchanged"], 2)
+        self.assertEqual(diff["added"], [])
+        self.assertEqual(diff["removed"], [])
+        self.assertEqual(diff["changed"], [])
+
+    def test_repodiff_name(self):
+        diff = cr.repodiff(REPO_01_PRIXML, REPO_02_PRIXML, cr.HT_KEY_NAME)
+        self.assertEqual(diff["unchanged"], 0)
+        self.assertEqual([p["name"] for p in diff["added"]], ["fake_bash"])
+        self.assertEqual(diff["removed"], [])
+        self.assertEqual(len(diff["changed"]), 1)
+        old, new = diff["changed"][0]
+        self.assertEqual(old["name"], "super_kernel")
+        self.assertEqual(new["pkgid"], "6d43a638af70ef899933b1fd86a866f1"
+                                       "8f65b0e0e17dcbf2e42bfd0cdd7c63c3")
+
+    def test_repodiff_hash(self):
+        diff = cr.repodiff(REPO_01_PRIXML, REPO_02_PRIXML, cr.HT_KEY_HASH)
+        self.assertEqual(len(diff["added"]), 2)
+        self.assertEqual(len(diff["removed"]), 1)
+        self.assertEqual(diff["changed"], [])
+
+    def test_repodiff_nonexistent(self):
+        self.assertRaises((IOError, cr.CreaterepoCError), cr.repodiff,
+                          REPO_01_PRIXML, "/nonexistent/primary.xml")
@@ -295,6 +295,31 @@ class TestCaseXmlParserPrimary(unittest.TestCase):
         self.assertEqual([pkg.name for pkg in pkgs],
             ['fake_bash', 'super_kernel'])
 
+    def test_xml_parser_primary_repo02_filter(self):
+
+        pkgs = []
+
+        def pkgcb(pkg):
+            pkgs.append(pkg)
+
+        cr.xml_parse_primary(REPO_02_PRIXML, None, pkgcb, None, 1,
+                             filter={"arch": ["x86_64"],
+                                     "blocked_srpm": ["fake_bash"]})
+
+        self.assertEqual([pkg.name for pkg in pkgs], ['super_kernel'])
+
+        pkgs = []
+        cr.xml_parse_filelists(REPO_02_FILXML, None, pkgcb, None,
+                               filter={"name": ["fake_*"]})
+        cr.xml_parse_other(REPO_02_OTHXML, None, pkgcb, None,
+                           filter={"arch": ("noarch",)})
+
+        self.assertEqual([pkg.name for pkg in pkgs], ['fake_bash'])
+
+        self.assertRaises(ValueError, cr.xml_parse_primary,
+                          REPO_02_PRIXML, None, pkgcb, None, 1,
+                          filter={"unknown": []})
+
     def test_xml_parser_primary_repo02_no_cbs(self):
         self.assertRaises(ValueError,
                           cr.xml_parse_primary,
@@ -0,0 +1,236 @@
+/* createrepo_c - Library of routines for manipulation with repodata
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include "fixtures.h"
+#include "createrepo/checkpoint.h"
+#include "createrepo/error.h"
+#include "createrepo/load_metadata.h"
+#include "createrepo/misc.h"
+#include "createrepo/parsepkg.h"
+#include "createrepo/xml_dump.h"
+
+#define PKG_01  TEST_PACKAGES_PATH"Archer-3.4.5-6.x86_64.rpm"
+#define PKG_02  TEST_PACKAGES_PATH"fake_bash-1.1.1-1.x86_64.rpm"
+
+typedef struct {
+    gchar *tmpdir;
+} TestFixtures;
+
+
+static void
+fixtures_setup(TestFixtures *fixtures,
+               G_GNUC_UNUSED gconstpointer test_data)
+{
+    gchar *template = g_strdup(TMPDIR_TEMPLATE);
+    fixtures->tmpdir = mkdtemp(template);
+    g_assert(fixtures->tmpdir);
+}
+
+
+static void
+fixtures_teardown(TestFixtures *fixtures,
+                  G_GNUC_UNUSED gconstpointer test_data)
+{
+    if (!fixtures->tmpdir)
+        return;
+
+    cr_remove_dir(fixtures->tmpdir, NULL);
+    g_free(fixtures->tmpdir);
+}
+
+
+static void
+add_pkg(cr_Checkpoint *cp, long id, const char *path)
+{
+    GError *err = NULL;
+    cr_Package *pkg;
+    struct cr_XmlStruct res;
+
+    pkg = cr_package_from_rpm(path, CR_CHECKSUM_SHA256,
+                              cr_get_filename(path), NULL,
+                              5, NULL, CR_HDRR_NONE, &err);
+    g_assert(pkg);
+    g_assert(!err);
+
+    res = cr_xml_dump(pkg, &err);
+    g_assert(!err);
+
+    cr_checkpoint_add_pkg(cp, id, &res, &err);
+    g_assert(!err);
+
+    g_free(res.primary);
+    g_free(res.filelists);
+    g_free(res.filelists_ext);
+    g_free(res.other);
+    cr_package_free(pkg);
+}
+
+
+static void
+test_cr_checkpoint_resume_empty(TestFixtures *fixtures,
+                                G_GNUC_UNUSED gconstpointer test_data)
+{
+    int ret;
+    GError *err = NULL;
+    cr_Checkpoint *cp;
+    cr_Metadata *md;
+
+    cp = cr_checkpoint_new(fixtures->tmpdir, FALSE, 10, &err);
+    g_assert(cp);
+    g_assert(!err);
+
+    md = cr_metadata_new(CR_HT_KEY_HREF, 0, NULL);
+    ret = cr_checkpoint_resume(cp, md, &err);
+    g_assert_cmpint(ret, ==, CRE_OK);
+    g_assert(!err);
+    g_assert_cmpint(cp->resumed, ==, 0);
+    g_assert_cmpint(g_hash_table_size(cr_metadata_hashtable(md)), ==, 0);
+
+    cr_metadata_free(md);
+    cr_checkpoint_free(cp, FALSE);
+}
+
+
+static void
+test_cr_checkpoint_resume(TestFixtures *fixtures,
+                          G_GNUC_UNUSED gconstpointer test_data)
+{
+    int ret;
+    GError *err = NULL;
+    cr_Checkpoint *cp;
+    cr_Metadata *md;
+
+    cr_package_parser_init();
+
+    // Interrupted run - two packages written, only the first committed
+
+    cp = cr_checkpoint_new(fixtures->tmpdir, FALSE, 1, &err);
+    g_assert(cp);
+    cr_checkpoint_add_task(cp, PKG_01);
+    cr_checkpoint_add_task(cp, PKG_02);
+    g_assert_cmpint(cp->task_count, ==, 2);
+
+    ret = cr_checkpoint_start(cp, &err);
+    g_assert_cmpint(ret, ==, CRE_OK);
+    g_assert(!err);
+
+    add_pkg(cp, 0, PKG_01);
+    g_assert_cmpint(cp->committed, ==, 1);
+
+    cp->interval = 10;
+    add_pkg(cp, 1, PKG_02);
+    g_assert_cmpint(cp->committed, ==, 1);
+    cr_checkpoint_free(cp, FALSE);
+
+    // Resumed run - only the committed package is loaded
+
+    cp = cr_checkpoint_new(fixtures->tmpdir, FALSE, 10, &err);
+    g_assert(cp);
+    cr_checkpoint_add_task(cp, PKG_01);
+    cr_checkpoint_add_task(cp, PKG_02);
+
+    md = cr_metadata_new(CR_HT_KEY_HREF, 0, NULL);
+    ret = cr_checkpoint_resume(cp, md, &err);
+    g_assert_cmpint(ret, ==, CRE_OK);
+    g_assert(!err);
+    g_assert_cmpint(cp->resumed, ==, 1);
+    g_assert_cmpint(g_hash_table_size(cr_metadata_hashtable(md)), ==, 1);
+    g_assert(g_hash_table_lookup(cr_metadata_hashtable(md),
+                                 "Archer-3.4.5-6.x86_64.rpm"));
+    cr_metadata_free(md);
+
+    // Resume is idempotent
+
+    md = cr_metadata_new(CR_HT_KEY_HREF, 0, NULL);
+    ret = cr_checkpoint_resume(cp, md, &err);
+    g_assert_cmpint(ret, ==, CRE_OK);
+    g_assert_cmpint(g_hash_table_size(cr_metadata_hashtable(md)), ==, 1);
+    cr_metadata_free(md);
+
+    // The resumed run is interrupted before its first commit
+
+    ret = cr_checkpoint_start(cp, &err);
+    g_assert_cmpint(ret, ==, CRE_OK);
+    g_assert(!err);
+    cr_checkpoint_free(cp, FALSE);
+
+    // The previous checkpoint is still there
+
+    cp = cr_checkpoint_new(fixtures->tmpdir, FALSE, 1, &err);
+    g_assert(cp);
+    cr_checkpoint_add_task(cp, PKG_01);
+    cr_checkpoint_add_task(cp, PKG_02);
+
+    md = cr_metadata_new(CR_HT_KEY_HREF, 0, NULL);
+    ret = cr_checkpoint_resume(cp, md, &err);
+    g_assert_cmpint(ret, ==, CRE_OK);
+    g_assert(!err);
+    g_assert_cmpint(cp->resumed, ==, 1);
+    cr_metadata_free(md);
+
+    // The first commit replaces it
+
+    ret = cr_checkpoint_start(cp, &err);
+    g_assert_cmpint(ret, ==, CRE_OK);
+    add_pkg(cp, 0, PKG_01);
+    add_pkg(cp, 1, PKG_02);
+    g_assert_cmpint(cp->committed, ==, 2);
+    cr_checkpoint_free(cp, FALSE);
+
+    cp = cr_checkpoint_new(fixtures->tmpdir, FALSE, 10, &err);
+    g_assert(cp);
+    md = cr_metadata_new(CR_HT_KEY_HREF, 0, NULL);
+    ret = cr_checkpoint_resume(cp, md, &err);
+    g_assert_cmpint(ret, ==, CRE_OK);
+    g_assert(!err);
+    g_assert_cmpint(cp->resumed, ==, 2);
+    cr_metadata_free(md);
+
+    // Finished run removes the checkpoint
+
+    ret = cr_checkpoint_start(cp, &err);
+    g_assert_cmpint(ret, ==, CRE_OK);
+    cr_checkpoint_free(cp, TRUE);
+    g_assert(!g_file_test(fixtures->tmpdir, G_FILE_TEST_EXISTS));
+
+    cr_package_parser_cleanup();
+}
+
+
+int
+main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add("/checkpoint/test_cr_checkpoint_resume_empty", TestFixtures,
+               NULL, fixtures_setup, test_cr_checkpoint_resume_empty,
+               fixtures_teardown);
+    g_test_add("/checkpoint/test_cr_checkpoint_resume", TestFixtures,
+               NULL, fixtures_setup, test_cr_checkpoint_resume,
+               fixtures_teardown);
+
+    return g_test_run();
+}
@@ -21,7 +21,9 @@
 #include <glib/gstdio.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
+#include <sys/stat.h>
 #include "fixtures.h"
 #include "createrepo/error.h"
 #include "createrepo/misc.h"
@@ -858,6 +860,310 @@ test_contentstating_multiwrite(Outputtest *outputtest,
     g_assert(!tmp_err);
 }
 
+static void
+test_contentstating_compressed_checksum(Outputtest *outputtest,
+                                        G_GNUC_UNUSED gconstpointer test_data)
+{
+    const char *content = "sdlkjowykjnhsadyhfsoaf\nasoiuyseahlndsf\n";
+    const int content_len = 39;
+    cr_CompressionType types[] = {
+        CR_CW_NO_COMPRESSION,
+        CR_CW_GZ_COMPRESSION,
+        CR_CW_BZ2_COMPRESSION,
+        CR_CW_XZ_COMPRESSION,
+        CR_CW_ZSTD_COMPRESSION,
+    };
+
+    for (size_t x = 0; x < G_N_ELEMENTS(types); x++) {
+        CR_FILE *f;
+        int ret;
+        cr_ContentStat *stat;
+        GError *tmp_err = NULL;
+
+        stat = cr_contentstat_new(CR_CHECKSUM_SHA256, &tmp_err);
+        g_assert(stat);
+        g_assert(!tmp_err);
+
+        f = cr_sopen(outputtest->tmp_filename,
+                     CR_CW_MODE_WRITE,
+                     types[x],
+                     stat,
+                     &tmp_err);
+        g_assert(f);
+        g_assert(!tmp_err);
+
+        ret = cr_write(f, content, content_len, &tmp_err);
+        g_assert_cmpint(ret, ==, content_len);
+        g_assert(!tmp_err);
+
+        ret = cr_close(f, &tmp_err);
+        g_assert_cmpint(ret, ==, CRE_OK);
+        g_assert(!tmp_err);
+
+        // Computing of the checksum while writing is optional
+        // (not supported for gz or if the platform doesn't have fopencookie)
+        if (stat->compressed_checksum) {
+            struct stat st;
+            gchar *checksum = cr_checksum_file(outputtest->tmp_filename,
+                                               CR_CHECKSUM_SHA256,
+                                               &tmp_err);
+            g_assert(checksum);
+            g_assert(!tmp_err);
+            g_assert_cmpstr(stat->compressed_checksum, ==, checksum);
+            g_free(checksum);
+
+            g_assert_cmpint(g_stat(outputtest->tmp_filename, &st), ==, 0);
+            g_assert_cmpint(stat->compressed_size, ==, st.st_size);
+        }
+
+        if (types[x] == CR_CW_GZ_COMPRESSION)
+            g_assert(!stat->compressed_checksum);
+
+        cr_contentstat_free(stat, &tmp_err);
+        g_assert(!tmp_err);
+    }
+}
+
+static void
+test_cr_compression_options_map(void)
+{
+    GError *tmp_err = NULL;
+    cr_CompressionOptions opts;
+    cr_CompressionOptionsMap *map;
+
+    // NULL map gives defaults
+    opts = cr_compression_options_map_get(NULL, "primary");
+    g_assert_cmpint(opts.profile, ==, CR_CW_PROFILE_DEFAULT);
+    g_assert_cmpint(opts.level, ==, CR_CW_LEVEL_DEFAULT);
+
+    map = cr_compression_options_map_new();
+    g_assert(cr_compression_options_map_parse(map, "fast", CR_CW_OPTION_PROFILE, &tmp_err));
+    g_assert(cr_compression_options_map_parse(map, "primary=best", CR_CW_OPTION_PROFILE, &tmp_err));
+    g_assert(cr_compression_options_map_parse(map, "primary=7", CR_CW_OPTION_LEVEL, &tmp_err));
+    g_assert(cr_compression_options_map_parse(map, "primary_db=3", CR_CW_OPTION_LEVEL, &tmp_err));
+    g_assert(!tmp_err);
+
+    opts = cr_compression_options_map_get(map, "other");
+    g_assert_cmpint(opts.profile, ==, CR_CW_PROFILE_FAST);
+    g_assert_cmpint(opts.level, ==, CR_CW_LEVEL_DEFAULT);
+
+    opts = cr_compression_options_map_get(map, "primary");
+    g_assert_cmpint(opts.profile, ==, CR_CW_PROFILE_BEST);
+    g_assert_cmpint(opts.level, ==, 7);
+
+    // Suffixed types fall back to their base type
+    opts = cr_compression_options_map_get(map, "primary_zck");
+    g_assert_cmpint(opts.profile, ==, CR_CW_PROFILE_BEST);
+    g_assert_cmpint(opts.level, ==, 7);
+
+    opts = cr_compression_options_map_get(map, "primary_db");
+    g_assert_cmpint(opts.profile, ==, CR_CW_PROFILE_BEST);
+    g_assert_cmpint(opts.level, ==, 3);
+
+    // Bad values
+    g_assert(!cr_compression_options_map_parse(map, "primary=x", CR_CW_OPTION_LEVEL, &tmp_err));
+    g_assert_cmpint(tmp_err->code, ==, CRE_BADARG);
+    g_clear_error(&tmp_err);
+    g_assert(!cr_compression_options_map_parse(map, "slow", CR_CW_OPTION_PROFILE, &tmp_err));
+    g_assert_cmpint(tmp_err->code, ==, CRE_BADARG);
+    g_clear_error(&tmp_err);
+    g_assert(!cr_compression_options_map_parse(map, "=5", CR_CW_OPTION_LEVEL, &tmp_err));
+    g_assert_cmpint(tmp_err->code, ==, CRE_BADARG);
+    g_clear_error(&tmp_err);
+
+    cr_compression_options_map_free(map);
+}
+
+static void
+test_cr_compression_options_map_strategy(void)
+{
+    GError *tmp_err = NULL;
+    cr_CompressionOptions opts;
+    cr_CompressionOptionsMap *map;
+
+    g_assert_cmpint(cr_compression_strategy("RLE"), ==, CR_CW_STRATEGY_GZ_RLE);
+    g_assert_cmpint(cr_compression_strategy("btultra2"), ==,
+                    CR_CW_STRATEGY_ZSTD_BTULTRA2);
+    g_assert_cmpint(cr_compression_strategy("foo"), ==,
+                    CR_CW_STRATEGY_SENTINEL);
+
+    opts = cr_compression_options_map_get(NULL, "primary");
+    g_assert_cmpint(opts.strategy, ==, CR_CW_STRATEGY_DEFAULT);
+    g_assert_cmpuint(opts.buffer_size, ==, 0);
+
+    map = cr_compression_options_map_new();
+    g_assert(cr_compression_options_map_parse(map, "filtered",
+                                              CR_CW_OPTION_STRATEGY, &tmp_err));
+    g_assert(cr_compression_options_map_parse(map, "filelists=btopt",
+                                              CR_CW_OPTION_STRATEGY, &tmp_err));
+    g_assert(cr_compression_options_map_parse(map, "filelists=1048576",
+                                              CR_CW_OPTION_BUFFER_SIZE, &tmp_err));
+    g_assert(!tmp_err);
+
+    opts = cr_compression_options_map_get(map, "other");
+    g_assert_cmpint(opts.strategy, ==, CR_CW_STRATEGY_GZ_FILTERED);
+    g_assert_cmpuint(opts.buffer_size, ==, 0);
+
+    opts = cr_compression_options_map_get(map, "filelists_db");
+    g_assert_cmpint(opts.strategy, ==, CR_CW_STRATEGY_ZSTD_BTOPT);
+    g_assert_cmpuint(opts.buffer_size, ==, 1048576);
+
+    // Bad values
+    g_assert(!cr_compression_options_map_parse(map, "slow",
+                                               CR_CW_OPTION_STRATEGY, &tmp_err));
+    g_assert_cmpint(tmp_err->code, ==, CRE_BADARG);
+    g_clear_error(&tmp_err);
+    g_assert(!cr_compression_options_map_parse(map, "16",
+                                               CR_CW_OPTION_BUFFER_SIZE, &tmp_err));
+    g_assert_cmpint(tmp_err->code, ==, CRE_BADARG);
+    g_clear_error(&tmp_err);
+    g_assert(!cr_compression_options_map_parse(map, "-8192",
+                                               CR_CW_OPTION_BUFFER_SIZE, &tmp_err));
+    g_assert_cmpint(tmp_err->code, ==, CRE_BADARG);
+    g_clear_error(&tmp_err);
+
+    cr_compression_options_map_free(map);
+}
+
+static void
+outputtest_compression_levels(Outputtest *outputtest,
+                              G_GNUC_UNUSED gconstpointer test_data)
+{
+    int ret;
+    CR_FILE *f;
+    GError *tmp_err = NULL;
+    const char *content = "Compression levels test content\n";
+    int len = strlen(content);
+    cr_CompressionOptions opts = { .profile = CR_CW_PROFILE_BEST,
+                                   .level = 100 };
+    cr_CompressionType types[] = {
+        CR_CW_GZ_COMPRESSION,
+        CR_CW_BZ2_COMPRESSION,
+        CR_CW_XZ_COMPRESSION,
+        CR_CW_ZSTD_COMPRESSION,
+    };
+
+    // Out of range levels are clamped, the output has to be readable
+    for (size_t x = 0; x < sizeof(types) / sizeof(types[0]); x++) {
+        f = cr_sopen_with_options(outputtest->tmp_filename, CR_CW_MODE_WRITE,
+                                  types[x], NULL, &opts, &tmp_err);
+        g_assert(f);
+        g_assert(!tmp_err);
+        ret = cr_puts(f, content, &tmp_err);
+        g_assert_cmpint(ret, ==, len);
+        ret = cr_close(f, &tmp_err);
+        g_assert_cmpint(ret, ==, CRE_OK);
+        g_assert(!tmp_err);
+
+        test_helper_cw_input(outputtest->tmp_filename, types[x], content, len);
+    }
+}
+
+static void
+outputtest_compression_strategies(Outputtest *outputtest,
+                                  G_GNUC_UNUSED gconstpointer test_data)
+{
+    int ret;
+    CR_FILE *f;
+    GError *tmp_err = NULL;
+    GString *content = g_string_new(NULL);
+    cr_CompressionType types[] = {
+        CR_CW_GZ_COMPRESSION,
+        CR_CW_BZ2_COMPRESSION,
+        CR_CW_XZ_COMPRESSION,
+        CR_CW_ZSTD_COMPRESSION,
+    };
+
+    // More than a few minimal buffers of data
+    for (int x = 0; content->len < 8 * CR_CW_MIN_BUFFER_SIZE; x++)
+        g_string_append_printf(content, "<file>/usr/share/doc/pkg%d</file>\n", x);
+
+    // Every strategy with the smallest buffer, strategies of the other
+    // compression types are ignored
+    for (size_t x = 0; x < sizeof(types) / sizeof(types[0]); x++) {
+        for (int strategy = 0; strategy < CR_CW_STRATEGY_SENTINEL; strategy++) {
+            cr_CompressionOptions opts = {
+                .profile = CR_CW_PROFILE_DEFAULT,
+                .level = CR_CW_LEVEL_DEFAULT,
+                .strategy = strategy,
+                .buffer_size = CR_CW_MIN_BUFFER_SIZE,
+            };
+
+            f = cr_sopen_with_options(outputtest->tmp_filename,
+                                      CR_CW_MODE_WRITE, types[x], NULL,
+                                      &opts, &tmp_err);
+            g_assert(f);
+            g_assert(!tmp_err);
+            ret = cr_write(f, content->str, content->len, &tmp_err);
+            g_assert_cmpint(ret, ==, content->len);
+            ret = cr_close(f, &tmp_err);
+            g_assert_cmpint(ret, ==, CRE_OK);
+            g_assert(!tmp_err);
+
+            // Read it back with the default buffer
+            GString *read = g_string_new(NULL);
+            char buf[4096];
+            f = cr_open(outputtest->tmp_filename, CR_CW_MODE_READ,
+                        CR_CW_AUTO_DETECT_COMPRESSION, &tmp_err);
+            g_assert(f);
+            while ((ret = cr_read(f, buf, sizeof(buf), &tmp_err)) > 0)
+                g_string_append_len(read, buf, ret);
+            g_assert_cmpint(ret, ==, 0);
+            g_assert(!tmp_err);
+            ret = cr_close(f, &tmp_err);
+            g_assert_cmpint(ret, ==, CRE_OK);
+            g_assert_cmpstr(read->str, ==, content->str);
+            g_string_free(read, TRUE);
+        }
+    }
+
+    g_string_free(content, TRUE);
+}
+
+static void
+outputtest_zstd_dict(Outputtest *outputtest,
+                     G_GNUC_UNUSED gconstpointer test_data)
+{
+    int ret;
+    CR_FILE *f;
+    GError *tmp_err = NULL;
+    char buf[128];
+    const char *content = "<package type=\"rpm\"><name>foo</name></package>\n";
+    const char *dict = "<package type=\"rpm\"><name></name><arch>noarch</arch>";
+    int len = strlen(content);
+    cr_CompressionOptions opts = { .profile = CR_CW_PROFILE_DEFAULT,
+                                   .level = CR_CW_LEVEL_DEFAULT,
+                                   .dict = dict,
+                                   .dict_size = strlen(dict) };
+
+    // Raw content dictionaries have no ID and cannot be registered
+    g_assert_cmpuint(cr_zstd_dict_register(dict, strlen(dict), &tmp_err), ==, 0);
+    g_assert_cmpint(tmp_err->code, ==, CRE_ZSTD);
+    g_clear_error(&tmp_err);
+
+    f = cr_sopen_with_options(outputtest->tmp_filename, CR_CW_MODE_WRITE,
+                              CR_CW_ZSTD_COMPRESSION, NULL, &opts, &tmp_err);
+    g_assert(f);
+    g_assert(!tmp_err);
+    ret = cr_puts(f, content, &tmp_err);
+    g_assert_cmpint(ret, ==, len);
+    ret = cr_close(f, &tmp_err);
+    g_assert_cmpint(ret, ==, CRE_OK);
+    g_assert(!tmp_err);
+
+    // The same dictionary has to be used for reading
+    f = cr_sopen_with_options(outputtest->tmp_filename, CR_CW_MODE_READ,
+                              CR_CW_ZSTD_COMPRESSION, NULL, &opts, &tmp_err);
+    g_assert(f);
+    g_assert(!tmp_err);
+    ret = cr_read(f, buf, sizeof(buf), &tmp_err);
+    g_assert_cmpint(ret, ==, len);
+    g_assert(!tmp_err);
+    g_assert(!strncmp(buf, content, len));
+    ret = cr_close(f, &tmp_err);
+    g_assert_cmpint(ret, ==, CRE_OK);
+}
+
 static void
 test_cr_get_zchunk_with_index(void)
 {
@@ -927,6 +1233,22 @@ main(int argc, char *argv[])
     g_test_add("/compression_wrapper/test_contentstating_multiwrite",
             Outputtest, NULL, outputtest_setup,
             test_contentstating_multiwrite, outputtest_teardown);
+    g_test_add("/compression_wrapper/test_contentstating_compressed_checksum",
+            Outputtest, NULL, outputtest_setup,
+            test_contentstating_compressed_checksum, outputtest_teardown);
+    g_test_add_func("/compression_wrapper/test_cr_compression_options_map",
+            test_cr_compression_options_map);
+    g_test_add_func("/compression_wrapper/test_cr_compression_options_map_strategy",
+            test_cr_compression_options_map_strategy);
+    g_test_add("/compression_wrapper/outputtest_compression_levels",
+            Outputtest, NULL, outputtest_setup,
+            outputtest_compression_levels, outputtest_teardown);
+    g_test_add("/compression_wrapper/outputtest_compression_strategies",
+            Outputtest, NULL, outputtest_setup,
+            outputtest_compression_strategies, outputtest_teardown);
+    g_test_add("/compression_wrapper/outputtest_zstd_dict",
+            Outputtest, NULL, outputtest_setup,
+            outputtest_zstd_dict, outputtest_teardown);
     g_test_add_func("/compression_wrapper/test_cr_get_zchunk_with_index",
             test_cr_get_zchunk_with_index);
 
@@ -0,0 +1,328 @@
+/* createrepo_c - Library of routines for manipulation with repodata
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "fixtures.h"
+#include "createrepo/error.h"
+#include "createrepo/misc.h"
+#include "createrepo/package.h"
+#include "createrepo/load_metadata.h"
+
+// Path to the tested binary is passed by the build system
+#ifndef CREATEREPO_C_PATH
+#define CREATEREPO_C_PATH   "createrepo_c"
+#endif
+
+#define TIMEOUT             20000   // ms
+#define WATCH_DELAY         "100"   // ms
+
+typedef struct {
+    gchar *tmpdir;
+} TestFixtures;
+
+
+static void
+fixtures_setup(TestFixtures *fixtures,
+               G_GNUC_UNUSED gconstpointer test_data)
+{
+    gchar *template = g_strdup(TMPDIR_TEMPLATE);
+    fixtures->tmpdir = mkdtemp(template);
+    g_assert(fixtures->tmpdir);
+}
+
+
+static void
+fixtures_teardown(TestFixtures *fixtures,
+                  G_GNUC_UNUSED gconstpointer test_data)
+{
+    if (!fixtures->tmpdir)
+        return;
+
+    cr_remove_dir(fixtures->tmpdir, NULL);
+    g_free(fixtures->tmpdir);
+}
+
+
+/** Copy a package from the testdata to the dst. The dst appears
+ * atomically (a hidden temporary file is renamed into place).
+ */
+static void
+copy_package(const char *filename, const char *dst)
+{
+    GError *err = NULL;
+    gchar *src = g_strconcat(TEST_PACKAGES_PATH, filename, NULL);
+    gchar *dir = g_path_get_dirname(dst);
+    gchar *base = g_path_get_basename(dst);
+    gchar *tmp_base = g_strconcat(".", base, ".tmp", NULL);
+    gchar *tmp = g_build_filename(dir, tmp_base, NULL);
+
+    g_assert(cr_copy_file(src, tmp, &err));
+    g_assert(!err);
+    g_assert_cmpint(g_rename(tmp, dst), ==, 0);
+
+    g_free(tmp);
+    g_free(tmp_base);
+    g_free(base);
+    g_free(dir);
+    g_free(src);
+}
+
+
+/** Copy a package from the testdata into dir/subdir.
+ */
+static void
+add_package(const char *dir, const char *subdir, const char *filename)
+{
+    gchar *dst_dir = g_build_filename(dir, subdir, NULL);
+    gchar *dst = g_build_filename(dst_dir, filename, NULL);
+
+    g_assert_cmpint(g_mkdir_with_parents(dst_dir, 0755), ==, 0);
+    copy_package(filename, dst);
+
+    g_free(dst);
+    g_free(dst_dir);
+}
+
+
+/** Run createrepo_c with the NULL terminated list of arguments.
+ */
+static void
+run_createrepo_c(const char *first_arg, ...)
+{
+    GError *err = NULL;
+    GPtrArray *args = g_ptr_array_new();
+    gchar *out = NULL, *errout = NULL;
+    gint status;
+    va_list ap;
+
+    g_ptr_array_add(args, CREATEREPO_C_PATH);
+    g_ptr_array_add(args, "--quiet");
+    g_ptr_array_add(args, "--no-database");
+    va_start(ap, first_arg);
+    for (const char *arg = first_arg; arg; arg = va_arg(ap, const char *))
+        g_ptr_array_add(args, (gpointer) arg);
+    va_end(ap);
+    g_ptr_array_add(args, NULL);
+
+    g_assert(g_spawn_sync(NULL, (gchar **) args->pdata, NULL,
+                          G_SPAWN_DEFAULT, NULL, NULL,
+                          &out, &errout, &status, &err));
+    g_assert(!err);
+    if (!g_spawn_check_exit_status(status, NULL))
+        g_error("createrepo_c failed: %s", errout);
+
+    g_free(out);
+    g_free(errout);
+    g_ptr_array_free(args, TRUE);
+}
+
+
+/** Load the repodata of the dir, keyed by location_href.
+ */
+static cr_Metadata *
+load_repo(const char *dir)
+{
+    GError *err = NULL;
+    cr_Metadata *md = cr_metadata_new(CR_HT_KEY_HREF, 0, NULL);
+
+    g_assert_cmpint(cr_metadata_locate_and_load_xml(md, dir, &err), ==, CRE_OK);
+    g_assert(!err);
+    return md;
+}
+
+
+static void
+assert_package(cr_Metadata *md, const char *href, const char *base)
+{
+    cr_Package *pkg = g_hash_table_lookup(cr_metadata_hashtable(md), href);
+
+    if (!pkg)
+        g_error("Package %s is missing", href);
+    g_assert_cmpstr(pkg->location_href, ==, href);
+    g_assert_cmpstr(pkg->location_base, ==, base);
+}
+
+
+static void
+test_createrepo_c_split_location_href(TestFixtures *fixtures,
+                                      G_GNUC_UNUSED gconstpointer test_data)
+{
+    gchar *disc1 = g_build_filename(fixtures->tmpdir, "disc1", NULL);
+    gchar *disc2 = g_build_filename(fixtures->tmpdir, "disc2", NULL);
+    cr_Metadata *md;
+
+    add_package(disc1, "", "Archer-3.4.5-6.x86_64.rpm");
+    add_package(disc2, "Packages", "fake_bash-1.1.1-1.x86_64.rpm");
+
+    // Hrefs are cut by the length of the first media dir, with media dirs
+    // of the same length they are relative to the package's own media,
+    // the media is in the location_base
+    run_createrepo_c("--split", disc1, disc2, NULL);
+    md = load_repo(disc1);
+    g_assert_cmpuint(g_hash_table_size(cr_metadata_hashtable(md)), ==, 2);
+    assert_package(md, "Archer-3.4.5-6.x86_64.rpm", "media:#1");
+    assert_package(md, "Packages/fake_bash-1.1.1-1.x86_64.rpm", "media:#2");
+    cr_metadata_free(md);
+
+    // The same with the packages reused from the old metadata
+    add_package(disc2, "", "super_kernel-6.0.1-2.x86_64.rpm");
+    run_createrepo_c("--split", "--update", disc1, disc2, NULL);
+    md = load_repo(disc1);
+    g_assert_cmpuint(g_hash_table_size(cr_metadata_hashtable(md)), ==, 3);
+    assert_package(md, "Archer-3.4.5-6.x86_64.rpm", "media:#1");
+    assert_package(md, "Packages/fake_bash-1.1.1-1.x86_64.rpm", "media:#2");
+    assert_package(md, "super_kernel-6.0.1-2.x86_64.rpm", "media:#2");
+    cr_metadata_free(md);
+
+    g_free(disc2);
+    g_free(disc1);
+}
+
+
+/** Check the package of the href in the repodata of the dir. If the name
+ * is NULL, the href must not be there.
+ */
+static gboolean
+repo_matches(const char *dir, const char *href, const char *name)
+{
+    gboolean ret = FALSE;
+    gchar *repomd = g_build_filename(dir, "repodata", "repomd.xml", NULL);
+    cr_Metadata *md = cr_metadata_new(CR_HT_KEY_HREF, 0, NULL);
+
+    // The repodata can be just being replaced, try again later then
+    if (g_file_test(repomd, G_FILE_TEST_IS_REGULAR)
+        && cr_metadata_locate_and_load_xml(md, dir, NULL) == CRE_OK) {
+        cr_Package *pkg = g_hash_table_lookup(cr_metadata_hashtable(md), href);
+        ret = name ? pkg && !g_strcmp0(pkg->name, name) : !pkg;
+    }
+
+    cr_metadata_free(md);
+    g_free(repomd);
+    return ret;
+}
+
+
+static void
+wait_for_repo(const char *dir, const char *href, const char *name)
+{
+    gint64 deadline = g_get_monotonic_time() + TIMEOUT * 1000;
+
+    while (!repo_matches(dir, href, name)) {
+        if (g_get_monotonic_time() > deadline)
+            g_error("Repodata weren't regenerated (%s: %s)",
+                    href, name ? name : "removed");
+        g_usleep(50000);
+    }
+}
+
+
+/** Inode of the repomd.xml, every regeneration writes a new one.
+ */
+static ino_t
+repomd_ino(const char *dir)
+{
+    GStatBuf st;
+    gchar *repomd = g_build_filename(dir, "repodata", "repomd.xml", NULL);
+
+    g_assert_cmpint(g_stat(repomd, &st), ==, 0);
+    g_free(repomd);
+    return st.st_ino;
+}
+
+
+static void
+test_createrepo_c_watch(TestFixtures *fixtures,
+                        G_GNUC_UNUSED gconstpointer test_data)
+{
+    GError *err = NULL;
+    GPid pid;
+    ino_t ino;
+    int status;
+    gchar *repo = g_build_filename(fixtures->tmpdir, "repo", NULL);
+    gchar *pkg_a = g_build_filename(repo, "a.rpm", NULL);
+    gchar *pkg_b = g_build_filename(repo, "b.rpm", NULL);
+
+    // Output dir given by an absolute path, input dir by a relative one,
+    // both are the same dir
+    gchar *args[] = { CREATEREPO_C_PATH, "--quiet", "--no-database",
+                      "--watch", "--watch-delay", WATCH_DELAY,
+                      "-o", repo, ".", NULL };
+
+    g_assert_cmpint(g_mkdir_with_parents(repo, 0755), ==, 0);
+    copy_package("Archer-3.4.5-6.x86_64.rpm", pkg_a);
+
+    g_assert(g_spawn_async(repo, args, NULL, G_SPAWN_DO_NOT_REAP_CHILD,
+                           NULL, NULL, &pid, &err));
+    g_assert(!err);
+
+    wait_for_repo(repo, "a.rpm", "Archer");
+
+    // Add
+    copy_package("fake_bash-1.1.1-1.x86_64.rpm", pkg_b);
+    wait_for_repo(repo, "b.rpm", "fake_bash");
+    g_assert(repo_matches(repo, "a.rpm", "Archer"));
+
+    // Remove
+    g_assert_cmpint(g_unlink(pkg_a), ==, 0);
+    wait_for_repo(repo, "a.rpm", NULL);
+    g_assert(repo_matches(repo, "b.rpm", "fake_bash"));
+
+    // Replace
+    copy_package("super_kernel-6.0.1-2.x86_64.rpm", pkg_b);
+    wait_for_repo(repo, "b.rpm", "super_kernel");
+
+    // The own output doesn't trigger another regeneration
+    ino = repomd_ino(repo);
+    g_usleep(2 * G_USEC_PER_SEC);
+    g_assert_cmpuint(repomd_ino(repo), ==, ino);
+
+    kill(pid, SIGTERM);
+    g_assert_cmpint(waitpid(pid, &status, 0), ==, pid);
+    g_spawn_close_pid(pid);
+
+    g_free(pkg_b);
+    g_free(pkg_a);
+    g_free(repo);
+}
+
+
+int
+main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add("/createrepo_c/test_createrepo_c_split_location_href",
+               TestFixtures, NULL, fixtures_setup,
+               test_createrepo_c_split_location_href, fixtures_teardown);
+    g_test_add("/createrepo_c/test_createrepo_c_watch",
+               TestFixtures, NULL, fixtures_setup,
+               test_createrepo_c_watch, fixtures_teardown);
+
+    return g_test_run();
+}
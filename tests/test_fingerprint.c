@@ -0,0 +1,189 @@
+/* createrepo_c - Library of routines for manipulation with repodata
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "fixtures.h"
+#include "createrepo/error.h"
+#include "createrepo/fingerprint.h"
+#include "createrepo/misc.h"
+
+typedef struct {
+    gchar *tmpdir;
+    gchar *input;               // Input file in the tmpdir
+    gchar *repomd;              // repomd.xml in the tmpdir
+} TestFixtures;
+
+
+static void
+fixtures_setup(TestFixtures *fixtures,
+               G_GNUC_UNUSED gconstpointer test_data)
+{
+    gchar *template = g_strdup(TMPDIR_TEMPLATE);
+    fixtures->tmpdir = mkdtemp(template);
+    g_assert(fixtures->tmpdir);
+
+    fixtures->input = g_build_filename(fixtures->tmpdir, "input.rpm", NULL);
+    g_assert(g_file_set_contents(fixtures->input, "rpm", -1, NULL));
+    fixtures->repomd = g_build_filename(fixtures->tmpdir, "repomd.xml", NULL);
+    g_assert(g_file_set_contents(fixtures->repomd, "<repomd/>", -1, NULL));
+}
+
+
+static void
+fixtures_teardown(TestFixtures *fixtures,
+                  G_GNUC_UNUSED gconstpointer test_data)
+{
+    g_free(fixtures->input);
+    g_free(fixtures->repomd);
+
+    if (!fixtures->tmpdir)
+        return;
+
+    cr_remove_dir(fixtures->tmpdir, NULL);
+    g_free(fixtures->tmpdir);
+}
+
+
+static cr_Fingerprint *
+new_fingerprint(TestFixtures *fixtures, const char *option)
+{
+    cr_Fingerprint *fp = cr_fingerprint_new();
+    cr_fingerprint_add_string(fp, "arg", option);
+    cr_fingerprint_add_file(fp, fixtures->input);
+    cr_fingerprint_finish(fp);
+    return fp;
+}
+
+
+static void
+write_fingerprint(TestFixtures *fixtures)
+{
+    GError *err = NULL;
+    cr_Fingerprint *fp;
+    int ret;
+
+    fp = new_fingerprint(fixtures, "--update");
+    ret = cr_fingerprint_write(fp, fixtures->tmpdir, &err);
+    g_assert_cmpint(ret, ==, CRE_OK);
+    g_assert(!err);
+    cr_fingerprint_free(fp);
+}
+
+
+static void
+test_cr_fingerprint_matches(TestFixtures *fixtures,
+                            G_GNUC_UNUSED gconstpointer test_data)
+{
+    cr_Fingerprint *fp;
+
+    // No fingerprint was stored yet
+    fp = new_fingerprint(fixtures, "--update");
+    g_assert(!cr_fingerprint_matches(fp, fixtures->tmpdir));
+    cr_fingerprint_free(fp);
+
+    write_fingerprint(fixtures);
+
+    fp = new_fingerprint(fixtures, "--update");
+    g_assert_cmpint(strlen(cr_fingerprint_finish(fp)), ==, 64);
+    g_assert(cr_fingerprint_matches(fp, fixtures->tmpdir));
+    cr_fingerprint_free(fp);
+
+    // Different options
+    fp = new_fingerprint(fixtures, "--simple-md-filenames");
+    g_assert(!cr_fingerprint_matches(fp, fixtures->tmpdir));
+    cr_fingerprint_free(fp);
+
+    fp = new_fingerprint(fixtures, NULL);
+    g_assert(!cr_fingerprint_matches(fp, fixtures->tmpdir));
+    cr_fingerprint_free(fp);
+}
+
+
+static void
+test_cr_fingerprint_changed_input(TestFixtures *fixtures,
+                                  G_GNUC_UNUSED gconstpointer test_data)
+{
+    cr_Fingerprint *fp;
+
+    write_fingerprint(fixtures);
+
+    // Different size
+    g_assert(g_file_set_contents(fixtures->input, "rpm2", -1, NULL));
+    fp = new_fingerprint(fixtures, "--update");
+    g_assert(!cr_fingerprint_matches(fp, fixtures->tmpdir));
+    cr_fingerprint_free(fp);
+
+    // Missing file
+    write_fingerprint(fixtures);
+    g_assert_cmpint(g_remove(fixtures->input), ==, 0);
+    fp = new_fingerprint(fixtures, "--update");
+    g_assert(!cr_fingerprint_matches(fp, fixtures->tmpdir));
+    cr_fingerprint_free(fp);
+}
+
+
+static void
+test_cr_fingerprint_changed_repomd(TestFixtures *fixtures,
+                                   G_GNUC_UNUSED gconstpointer test_data)
+{
+    GError *err = NULL;
+    cr_Fingerprint *fp;
+    int ret;
+
+    write_fingerprint(fixtures);
+
+    // Metadata were regenerated by someone else
+    g_assert(g_file_set_contents(fixtures->repomd, "<repomd></repomd>", -1, NULL));
+    fp = new_fingerprint(fixtures, "--update");
+    g_assert(!cr_fingerprint_matches(fp, fixtures->tmpdir));
+
+    // Without repomd.xml the fingerprint cannot be stored
+    g_assert_cmpint(g_remove(fixtures->repomd), ==, 0);
+    ret = cr_fingerprint_write(fp, fixtures->tmpdir, &err);
+    g_assert_cmpint(ret, ==, CRE_IO);
+    g_assert(err);
+    g_clear_error(&err);
+    cr_fingerprint_free(fp);
+}
+
+
+int
+main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add("/fingerprint/test_cr_fingerprint_matches", TestFixtures,
+               NULL, fixtures_setup, test_cr_fingerprint_matches,
+               fixtures_teardown);
+    g_test_add("/fingerprint/test_cr_fingerprint_changed_input", TestFixtures,
+               NULL, fixtures_setup, test_cr_fingerprint_changed_input,
+               fixtures_teardown);
+    g_test_add("/fingerprint/test_cr_fingerprint_changed_repomd", TestFixtures,
+               NULL, fixtures_setup, test_cr_fingerprint_changed_repomd,
+               fixtures_teardown);
+
+    return g_test_run();
+}
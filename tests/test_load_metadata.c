@@ -24,6 +24,7 @@
 #include "createrepo/error.h"
 #include "createrepo/package.h"
 #include "createrepo/misc.h"
+#include "createrepo/xml_dump.h"
 #include "createrepo/load_metadata.h"
 #include "createrepo/locate_metadata.h"
 #include "createrepo/metadata_internal.h"
@@ -167,6 +168,85 @@ static void test_cr_metadata_locate_and_load_xml_detailed(void)
 }
 
 
+static void test_cr_metadata_locate_and_load_xml_lazy(void)
+{
+    int ret;
+    cr_Metadata *eager, *lazy;
+    GHashTableIter iter;
+    gpointer key, value;
+
+    eager = cr_metadata_new(CR_HT_KEY_HASH, 0, NULL);
+    ret = cr_metadata_locate_and_load_xml(eager, TEST_REPO_02, NULL);
+    g_assert_cmpint(ret, ==, CRE_OK);
+
+    lazy = cr_metadata_new(CR_HT_KEY_HASH, 1, NULL);
+    g_assert(cr_metadata_set_lazy(lazy, TRUE));
+    ret = cr_metadata_locate_and_load_xml(lazy, TEST_REPO_02, NULL);
+    g_assert_cmpint(ret, ==, CRE_OK);
+    g_assert_cmpuint(g_hash_table_size(cr_metadata_hashtable(lazy)), ==,
+                     REPO_SIZE_02);
+
+    g_hash_table_iter_init(&iter, cr_metadata_hashtable(lazy));
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        cr_Package *pkg = value;
+        cr_Package *eager_pkg;
+        struct cr_XmlStruct xml, eager_xml;
+        GError *tmp_err = NULL;
+
+        eager_pkg = g_hash_table_lookup(cr_metadata_hashtable(eager), key);
+        g_assert(eager_pkg);
+
+        // Files and changelogs are not loaded yet
+        g_assert(pkg->lazydata);
+        g_assert(!pkg->files);
+        g_assert(!pkg->changelogs);
+        g_assert(eager_pkg->files);
+
+        // Dump loads them on demand
+        xml = cr_xml_dump(pkg, &tmp_err);
+        g_assert_no_error(tmp_err);
+        g_assert_cmpuint(g_slist_length(pkg->files), ==,
+                         g_slist_length(eager_pkg->files));
+        g_assert_cmpuint(g_slist_length(pkg->changelogs), ==,
+                         g_slist_length(eager_pkg->changelogs));
+
+        eager_xml = cr_xml_dump(eager_pkg, &tmp_err);
+        g_assert_no_error(tmp_err);
+        g_assert_cmpstr(xml.primary, ==, eager_xml.primary);
+        g_assert_cmpstr(xml.filelists, ==, eager_xml.filelists);
+        g_assert_cmpstr(xml.other, ==, eager_xml.other);
+
+        // Already loaded package is left alone
+        g_assert_cmpint(cr_package_load_lazy(pkg, NULL), ==, CRE_OK);
+        g_assert_cmpuint(g_slist_length(pkg->files), ==,
+                         g_slist_length(eager_pkg->files));
+
+        // Unloaded package is back in the shared chunk and can be loaded
+        // again
+        cr_package_unload_lazy(pkg);
+        g_assert(!pkg->files);
+        g_assert(!pkg->changelogs);
+        g_assert(pkg->loadingflags & CR_PACKAGE_SINGLE_CHUNK);
+        g_assert_cmpint(cr_package_load_lazy(pkg, NULL), ==, CRE_OK);
+        g_assert_cmpuint(g_slist_length(pkg->changelogs), ==,
+                         g_slist_length(eager_pkg->changelogs));
+        g_assert(!(pkg->loadingflags & CR_PACKAGE_SINGLE_CHUNK));
+
+        g_free(xml.primary);
+        g_free(xml.filelists);
+        g_free(xml.filelists_ext);
+        g_free(xml.other);
+        g_free(eager_xml.primary);
+        g_free(eager_xml.filelists);
+        g_free(eager_xml.filelists_ext);
+        g_free(eager_xml.other);
+    }
+
+    cr_metadata_free(eager);
+    cr_metadata_free(lazy);
+}
+
+
 #ifdef WITH_LIBMODULEMD
 static void test_cr_metadata_locate_and_load_modulemd(void)
 {
@@ -200,6 +280,7 @@ int main(int argc, char *argv[])
     g_test_add_func("/load_metadata/test_cr_metadata_new", test_cr_metadata_new);
     g_test_add_func("/load_metadata/test_cr_metadata_locate_and_load_xml", test_cr_metadata_locate_and_load_xml);
     g_test_add_func("/load_metadata/test_cr_metadata_locate_and_load_xml_detailed", test_cr_metadata_locate_and_load_xml_detailed);
+    g_test_add_func("/load_metadata/test_cr_metadata_locate_and_load_xml_lazy", test_cr_metadata_locate_and_load_xml_lazy);
 
 #ifdef WITH_LIBMODULEMD
     g_test_add_func("/load_metadata/test_cr_metadata_locate_and_load_modulemd", test_cr_metadata_locate_and_load_modulemd);
@@ -0,0 +1,98 @@
+/* createrepo_c - Library of routines for manipulation with repodata
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "fixtures.h"
+#include "createrepo/metrics.h"
+#include "createrepo/misc.h"
+
+
+static void
+test_cr_metrics_null(void)
+{
+    // All the instrumentation calls are no-ops without metrics
+    cr_metrics_observe(NULL, "stage", 10);
+    cr_metrics_observe_since(NULL, "stage", g_get_monotonic_time());
+    cr_metrics_add(NULL, "counter", 1);
+    cr_metrics_peak(NULL, "peak", 1);
+    cr_metrics_free(NULL);
+}
+
+
+static void
+test_cr_metrics_write(void)
+{
+    gboolean ret;
+    GError *err = NULL;
+    gchar *content = NULL;
+    gchar *tmpdir = g_strdup(TMPDIR_TEMPLATE);
+    gchar *path;
+    cr_Metrics *metrics;
+
+    g_assert(mkdtemp(tmpdir));
+    path = g_build_filename(tmpdir, "metrics.json", NULL);
+
+    metrics = cr_metrics_new();
+    cr_metrics_observe(metrics, "checksum", 3);
+    cr_metrics_observe(metrics, "checksum", 100);
+    cr_metrics_add(metrics, "rpm_bytes_read", 512);
+    cr_metrics_add(metrics, "rpm_bytes_read", 512);
+    cr_metrics_add(metrics, "checksum_cache_hits", 3);
+    cr_metrics_add(metrics, "checksum_cache_misses", 1);
+    cr_metrics_peak(metrics, "buffered_tasks", 7);
+    cr_metrics_peak(metrics, "buffered_tasks", 2);
+
+    ret = cr_metrics_write(metrics, path, &err);
+    g_assert(ret);
+    g_assert(!err);
+    cr_metrics_free(metrics);
+
+    g_assert(g_file_get_contents(path, &content, NULL, NULL));
+    g_assert(strstr(content, "\"wall_seconds\": "));
+    g_assert(strstr(content, "\"checksum\": {\"count\": 2, "));
+    g_assert(strstr(content, "\"min_us\": 3, \"max_us\": 100"));
+    g_assert(strstr(content, "\"histogram_us\": {\"4\": 1, \"128\": 1}"));
+    g_assert(strstr(content, "\"rpm_bytes_read\": 1024"));
+    g_assert(strstr(content, "\"buffered_tasks\": 7"));
+    g_assert(strstr(content, "\"checksum_cache_hit_rate\": 0.7500"));
+
+    g_free(content);
+    g_free(path);
+    cr_remove_dir(tmpdir, NULL);
+    g_free(tmpdir);
+}
+
+
+int
+main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/metrics/test_cr_metrics_null", test_cr_metrics_null);
+    g_test_add_func("/metrics/test_cr_metrics_write", test_cr_metrics_write);
+
+    return g_test_run();
+}
@@ -21,11 +21,17 @@
 #include <glib/gstdio.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <curl/curl.h>
 #include "fixtures.h"
 #include "createrepo/checksum.h"
 #include "createrepo/misc.h"
 #include "createrepo/error.h"
+#include "createrepo/locate_metadata.h"
 
 #define PACKAGE_01              TEST_PACKAGES_PATH"super_kernel-6.0.1-2.x86_64.rpm"
 #define PACKAGE_01_HEADER_START 280
@@ -748,6 +754,431 @@ test_cr_better_copy_file_local(Copyfiletest *copyfiletest,
 }
 
 
+static void
+test_cr_carry_over_file(Copyfiletest *copyfiletest,
+                        G_GNUC_UNUSED gconstpointer test_data)
+{
+    cr_CarryOverMethod method;
+    GStatBuf src_st, dst_st;
+    char *checksum;
+    GError *tmp_err = NULL;
+    gchar *src = g_strconcat(copyfiletest->tmp_dir, "/a", NULL);
+
+    // Streaming copy keeps the content, the mode and the mtime
+    method = cr_carry_over_file(TEST_BINARY_FILE, src, CR_CARRY_OVER_STREAM, &tmp_err);
+    g_assert(!tmp_err);
+    g_assert_cmpint(method, ==, CR_CARRY_OVER_STREAM);
+    checksum = cr_checksum_file(src, CR_CHECKSUM_SHA256, NULL);
+    g_assert_cmpstr(checksum, ==, "bf68e32ad78cea8287be0f35b74fa3fecd0eaa91770b48f1a7282b015d6d883e");
+    g_free(checksum);
+    g_assert_cmpint(g_stat(TEST_BINARY_FILE, &src_st), ==, 0);
+    g_assert_cmpint(g_stat(src, &dst_st), ==, 0);
+    g_assert_cmpint(src_st.st_mtime, ==, dst_st.st_mtime);
+    g_assert_cmpint(src_st.st_mode, ==, dst_st.st_mode);
+
+    // Within one filesystem the file is hardlinked
+    method = cr_carry_over_file(src, copyfiletest->dst_file, CR_CARRY_OVER_COPY, &tmp_err);
+    g_assert(!tmp_err);
+    g_assert_cmpint(method, ==, CR_CARRY_OVER_HARDLINK);
+    g_assert_cmpint(g_stat(src, &src_st), ==, 0);
+    g_assert_cmpint(g_stat(copyfiletest->dst_file, &dst_st), ==, 0);
+    g_assert_cmpint(src_st.st_ino, ==, dst_st.st_ino);
+
+    // Existing destination is never overwritten
+    method = cr_carry_over_file(src, copyfiletest->dst_file, CR_CARRY_OVER_COPY, &tmp_err);
+    g_assert(tmp_err);
+    g_assert_cmpint(method, ==, 0);
+    g_clear_error(&tmp_err);
+
+    // Rename moves the source
+    g_assert_cmpint(g_remove(copyfiletest->dst_file), ==, 0);
+    method = cr_carry_over_file(src, copyfiletest->dst_file,
+                                CR_CARRY_OVER_RENAME | CR_CARRY_OVER_COPY, &tmp_err);
+    g_assert(!tmp_err);
+    g_assert_cmpint(method, ==, CR_CARRY_OVER_RENAME);
+    g_assert(!g_file_test(src, G_FILE_TEST_EXISTS));
+    g_assert(g_file_test(copyfiletest->dst_file, G_FILE_TEST_IS_REGULAR));
+
+    // Missing source
+    method = cr_carry_over_file(NON_EXIST_FILE, src, CR_CARRY_OVER_COPY, &tmp_err);
+    g_assert(tmp_err);
+    g_assert_cmpint(method, ==, 0);
+    g_assert(!g_file_test(src, G_FILE_TEST_EXISTS));
+    g_clear_error(&tmp_err);
+
+    g_free(src);
+}
+
+
+static void
+test_cr_download_multi(void)
+{
+    int ret;
+    char *checksum;
+    gchar *tmp_dir, *bad_dir, *dst;
+    GError *tmp_err = NULL;
+    gchar *cwd = g_get_current_dir();
+    gchar *text_path = g_build_filename(cwd, TEST_TEXT_FILE, NULL);
+    gchar *binary_path = g_build_filename(cwd, TEST_BINARY_FILE, NULL);
+    gchar *text_url = g_filename_to_uri(text_path, NULL, NULL);
+    gchar *binary_url = g_filename_to_uri(binary_path, NULL, NULL);
+    gchar *missing_url = g_strconcat(text_url, "_missing", NULL);
+    const char *urls[] = { text_url, binary_url, NULL };
+    const char *bad_urls[] = { text_url, missing_url, NULL };
+    CURL *handle = curl_easy_init();
+
+    tmp_dir = g_strdup(TMPDIR_TEMPLATE);
+    g_assert(mkdtemp(tmp_dir));
+
+    // Nothing to download
+    ret = cr_download_multi(handle, NULL, NULL, tmp_dir, 2, &tmp_err);
+    g_assert_cmpint(ret, ==, CRE_OK);
+
+    ret = cr_download_multi(handle, urls, NULL, tmp_dir, 2, &tmp_err);
+    g_assert_cmpint(ret, ==, CRE_OK);
+    g_assert(!tmp_err);
+
+    dst = g_build_filename(tmp_dir, "text_file", NULL);
+    checksum = cr_checksum_file(dst, CR_CHECKSUM_SHA256, NULL);
+    g_assert_cmpstr(checksum, ==, TEST_TEXT_FILE_SHA256SUM);
+    g_free(checksum);
+    g_free(dst);
+
+    dst = g_build_filename(tmp_dir, "binary_file", NULL);
+    checksum = cr_checksum_file(dst, CR_CHECKSUM_SHA256, NULL);
+    g_assert_cmpstr(checksum, ==, "bf68e32ad78cea8287be0f35b74fa3fecd0eaa91770b48f1a7282b015d6d883e");
+    g_free(checksum);
+    g_free(dst);
+
+    // A failed download removes all the files
+    bad_dir = g_build_filename(tmp_dir, "bad", NULL);
+    g_assert_cmpint(g_mkdir(bad_dir, 0755), ==, 0);
+    ret = cr_download_multi(handle, bad_urls, NULL, bad_dir, 1, &tmp_err);
+    g_assert_cmpint(ret, ==, CRE_CURL);
+    g_assert(tmp_err);
+    g_clear_error(&tmp_err);
+    dst = g_build_filename(bad_dir, "text_file", NULL);
+    g_assert(!g_file_test(dst, G_FILE_TEST_EXISTS));
+    g_free(dst);
+    g_free(bad_dir);
+
+    cr_remove_dir(tmp_dir, NULL);
+    g_free(tmp_dir);
+    curl_easy_cleanup(handle);
+    g_free(cwd);
+    g_free(text_path);
+    g_free(binary_path);
+    g_free(text_url);
+    g_free(binary_url);
+    g_free(missing_url);
+}
+
+
+// Minimal HTTP/1.1 server serving files from a directory. Connections
+// are kept alive and every response is delayed, so parallel transfers
+// overlap and the connection reuse can be counted.
+
+#define HTTPSERVER_DELAY    50000   // Microseconds per response
+
+typedef struct {
+    gchar *root;            // Served directory
+    gchar *url;             // http://127.0.0.1:<port>/
+    int listen_fd;
+    GThread *thread;
+    GPtrArray *conn_threads;
+    GMutex lock;
+    gint connections;       // Accepted connections
+    gint requests;          // Received requests
+    gint active;            // Open connections
+    gint max_active;        // Max simultaneously open connections
+} Httpserver;
+
+typedef struct {
+    Httpserver *server;
+    int fd;
+} HttpserverConn;
+
+
+static gboolean
+httpserver_send(int fd, const char *data, gsize len)
+{
+    while (len) {
+        ssize_t sent = send(fd, data, len, MSG_NOSIGNAL);
+        if (sent <= 0)
+            return FALSE;
+        data += sent;
+        len -= sent;
+    }
+    return TRUE;
+}
+
+
+static gboolean
+httpserver_respond(Httpserver *server, int fd, const char *request)
+{
+    gchar *path = NULL, *content = NULL, *header;
+    gsize len = 0;
+    gboolean ret;
+    gchar **parts = g_strsplit(request, " ", 3);
+
+    g_atomic_int_inc(&server->requests);
+    g_usleep(HTTPSERVER_DELAY);
+
+    if (g_strv_length(parts) == 3 && !g_strcmp0(parts[0], "GET"))
+        path = g_build_filename(server->root, parts[1], NULL);
+
+    if (path && g_file_get_contents(path, &content, &len, NULL))
+        header = g_strdup_printf("HTTP/1.1 200 OK\r\n"
+                                 "Content-Length: %" G_GSIZE_FORMAT "\r\n"
+                                 "\r\n", len);
+    else
+        header = g_strdup("HTTP/1.1 404 Not Found\r\n"
+                          "Content-Length: 0\r\n"
+                          "\r\n");
+
+    ret = httpserver_send(fd, header, strlen(header))
+          && httpserver_send(fd, content, len);
+
+    g_free(header);
+    g_free(content);
+    g_free(path);
+    g_strfreev(parts);
+    return ret;
+}
+
+
+static gpointer
+httpserver_serve(gpointer data)
+{
+    HttpserverConn *conn = data;
+    Httpserver *server = conn->server;
+    GString *buf = g_string_new(NULL);
+    char chunk[4096];
+    ssize_t len;
+    gboolean ok = TRUE;
+
+    while (ok && (len = recv(conn->fd, chunk, sizeof(chunk), 0)) > 0) {
+        char *end;
+
+        g_string_append_len(buf, chunk, len);
+        while (ok && (end = strstr(buf->str, "\r\n\r\n"))) {
+            gchar *request = g_strndup(buf->str, strcspn(buf->str, "\r\n"));
+            ok = httpserver_respond(server, conn->fd, request);
+            g_free(request);
+            g_string_erase(buf, 0, end - buf->str + 4);
+        }
+    }
+
+    close(conn->fd);
+    g_mutex_lock(&server->lock);
+    server->active--;
+    g_mutex_unlock(&server->lock);
+
+    g_string_free(buf, TRUE);
+    g_free(conn);
+    return NULL;
+}
+
+
+static gpointer
+httpserver_accept(gpointer data)
+{
+    Httpserver *server = data;
+    int fd;
+
+    while ((fd = accept(server->listen_fd, NULL, NULL)) >= 0) {
+        HttpserverConn *conn = g_new0(HttpserverConn, 1);
+        conn->server = server;
+        conn->fd = fd;
+
+        g_mutex_lock(&server->lock);
+        server->connections++;
+        server->active++;
+        server->max_active = MAX(server->max_active, server->active);
+        g_ptr_array_add(server->conn_threads,
+                        g_thread_new("httpserver-conn", httpserver_serve, conn));
+        g_mutex_unlock(&server->lock);
+    }
+
+    return NULL;
+}
+
+
+static void
+httpserver_setup(Httpserver *server, G_GNUC_UNUSED gconstpointer test_data)
+{
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+
+    memset(server, 0, sizeof(*server));
+    server->root = g_strdup(TMPDIR_TEMPLATE);
+    g_assert(mkdtemp(server->root));
+    server->conn_threads = g_ptr_array_new();
+    g_mutex_init(&server->lock);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+
+    server->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    g_assert_cmpint(server->listen_fd, >=, 0);
+    g_assert_cmpint(bind(server->listen_fd, (struct sockaddr *) &addr, sizeof(addr)), ==, 0);
+    g_assert_cmpint(listen(server->listen_fd, 16), ==, 0);
+    g_assert_cmpint(getsockname(server->listen_fd, (struct sockaddr *) &addr, &addr_len), ==, 0);
+
+    server->url = g_strdup_printf("http://127.0.0.1:%d/", ntohs(addr.sin_port));
+    server->thread = g_thread_new("httpserver", httpserver_accept, server);
+}
+
+
+static void
+httpserver_teardown(Httpserver *server, G_GNUC_UNUSED gconstpointer test_data)
+{
+    // Wake up the accept(), clients have closed their connections already
+    shutdown(server->listen_fd, SHUT_RDWR);
+    close(server->listen_fd);
+    g_thread_join(server->thread);
+    for (guint x = 0; x < server->conn_threads->len; x++)
+        g_thread_join(g_ptr_array_index(server->conn_threads, x));
+    g_ptr_array_free(server->conn_threads, TRUE);
+    g_mutex_clear(&server->lock);
+
+    cr_remove_dir(server->root, NULL);
+    g_free(server->root);
+    g_free(server->url);
+}
+
+
+static void
+httpserver_add_file(Httpserver *server, const char *path, const char *content)
+{
+    gchar *full_path = g_build_filename(server->root, path, NULL);
+    gchar *dir = g_path_get_dirname(full_path);
+
+    g_assert_cmpint(g_mkdir_with_parents(dir, 0755), ==, 0);
+    g_assert(g_file_set_contents(full_path, content, -1, NULL));
+
+    g_free(dir);
+    g_free(full_path);
+}
+
+
+static void
+httpserver_test_download_multi(Httpserver *server,
+                               G_GNUC_UNUSED gconstpointer test_data)
+{
+    int ret;
+    gchar *tmp_dir;
+    GError *tmp_err = NULL;
+    CURL *handle = curl_easy_init();
+    const char *paths[] = { "a/same", "b/same", "c/1", "c/2", "c/3", "c/4", NULL };
+    gchar *urls[G_N_ELEMENTS(paths)] = { NULL };
+
+    for (guint x = 0; paths[x]; x++) {
+        httpserver_add_file(server, paths[x], paths[x]);
+        urls[x] = g_strconcat(server->url, paths[x], NULL);
+    }
+
+    tmp_dir = g_strdup(TMPDIR_TEMPLATE);
+    g_assert(mkdtemp(tmp_dir));
+
+    ret = cr_download_multi(handle, (const char * const *) urls, paths,
+                            tmp_dir, 2, &tmp_err);
+    g_assert_cmpint(ret, ==, CRE_OK);
+    g_assert(!tmp_err);
+    curl_easy_cleanup(handle);
+
+    // Files with the same basename don't collide
+    for (guint x = 0; paths[x]; x++) {
+        gchar *content = NULL;
+        gchar *dst = g_build_filename(tmp_dir, paths[x], NULL);
+        g_assert(g_file_get_contents(dst, &content, NULL, NULL));
+        g_assert_cmpstr(content, ==, paths[x]);
+        g_free(content);
+        g_free(dst);
+        g_free(urls[x]);
+    }
+
+    // Both connections were used in parallel and kept alive
+    g_assert_cmpint(g_atomic_int_get(&server->requests), ==, 6);
+    g_mutex_lock(&server->lock);
+    g_assert_cmpint(server->connections, ==, 2);
+    g_assert_cmpint(server->max_active, ==, 2);
+    g_mutex_unlock(&server->lock);
+
+    cr_remove_dir(tmp_dir, NULL);
+    g_free(tmp_dir);
+}
+
+
+#define HTTPSERVER_REPOMD \
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n" \
+    "<repomd xmlns=\"http://linux.duke.edu/metadata/repo\">\n" \
+    "  <data type=\"primary\"><location href=\"repodata/a/md.xml\"/></data>\n" \
+    "  <data type=\"filelists\"><location href=\"repodata/b/md.xml\"/></data>\n" \
+    "  <data type=\"other\"><location href=\"repodata/c/md.xml\"/></data>\n" \
+    "  <data type=\"group\"><location href=\"repodata/comps.xml\"/></data>\n" \
+    "</repomd>\n"
+
+static void
+httpserver_test_locate_metadata_mask(Httpserver *server,
+                                     G_GNUC_UNUSED gconstpointer test_data)
+{
+    gchar *content = NULL;
+    gchar *path;
+    GError *tmp_err = NULL;
+    struct cr_MetadataLocation *ml;
+
+    httpserver_add_file(server, "repodata/repomd.xml", HTTPSERVER_REPOMD);
+    httpserver_add_file(server, "repodata/a/md.xml", "primary");
+    httpserver_add_file(server, "repodata/b/md.xml", "filelists");
+    httpserver_add_file(server, "repodata/c/md.xml", "other");
+    httpserver_add_file(server, "repodata/comps.xml", "group");
+
+    ml = cr_locate_metadata_mask(server->url, TRUE,
+                                 CR_MD_PRIMARY | CR_MD_FILELISTS, &tmp_err);
+    g_assert(!tmp_err);
+    g_assert(ml);
+    g_assert(ml->tmp);
+
+    path = g_build_filename(ml->local_path, "repodata/a/md.xml", NULL);
+    g_assert_cmpstr(ml->pri_xml_href, ==, path);
+    g_assert(g_file_get_contents(ml->pri_xml_href, &content, NULL, NULL));
+    g_assert_cmpstr(content, ==, "primary");
+    g_free(content);
+    g_free(path);
+
+    g_assert(g_file_get_contents(ml->fil_xml_href, &content, NULL, NULL));
+    g_assert_cmpstr(content, ==, "filelists");
+    g_free(content);
+
+    // Types out of the mask are neither located nor downloaded
+    g_assert(!ml->oth_xml_href);
+    g_assert(!ml->additional_metadata);
+    g_assert_cmpint(g_atomic_int_get(&server->requests), ==, 3);
+
+    path = g_strdup(ml->local_path);
+    cr_metadatalocation_free(ml);
+    g_assert(!g_file_test(path, G_FILE_TEST_EXISTS));
+    g_free(path);
+
+    // Hrefs out of the repo are refused
+    httpserver_add_file(server, "repodata/repomd.xml",
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<repomd xmlns=\"http://linux.duke.edu/metadata/repo\">\n"
+        "  <data type=\"primary\"><location href=\"../md.xml\"/></data>\n"
+        "</repomd>\n");
+    g_test_expect_message("C_CREATEREPOLIB", G_LOG_LEVEL_CRITICAL,
+                          "*Unsupported location_href*");
+    ml = cr_locate_metadata_mask(server->url, TRUE, CR_MD_ALL, &tmp_err);
+    g_test_assert_expected_messages();
+    g_assert(!ml);
+    g_assert(tmp_err);
+    g_clear_error(&tmp_err);
+}
+
+
 static void
 test_cr_remove_dir(void)
 {
@@ -1361,8 +1792,19 @@ main(int argc, char *argv[])
     g_test_add("/misc/test_cr_better_copy_file_local",
             Copyfiletest, NULL, copyfiletest_setup,
             test_cr_better_copy_file_local, copyfiletest_teardown);
+    g_test_add("/misc/test_cr_carry_over_file",
+            Copyfiletest, NULL, copyfiletest_setup,
+            test_cr_carry_over_file, copyfiletest_teardown);
     g_test_add_func("/misc/test_cr_normalize_dir_path",
             test_cr_normalize_dir_path);
+    g_test_add_func("/misc/test_cr_download_multi",
+            test_cr_download_multi);
+    g_test_add("/misc/httpserver_test_download_multi",
+            Httpserver, NULL, httpserver_setup,
+            httpserver_test_download_multi, httpserver_teardown);
+    g_test_add("/misc/httpserver_test_locate_metadata_mask",
+            Httpserver, NULL, httpserver_setup,
+            httpserver_test_locate_metadata_mask, httpserver_teardown);
     g_test_add_func("/misc/test_cr_remove_dir",
             test_cr_remove_dir);
     g_test_add_func("/misc/test_cr_str_to_version",
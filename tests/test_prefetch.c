@@ -0,0 +1,248 @@
+/* createrepo_c - Library of routines for manipulation with repodata
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <glib.h>
+#include <stdlib.h>
+#include "fixtures.h"
+#include "createrepo/misc.h"
+#include "createrepo/prefetch.h"
+
+#define FILES       10
+
+typedef struct {
+    gchar *tmpdir;
+    GPtrArray *asked;       // basenames of paths passed to the needed func
+} TestFixtures;
+
+
+static void
+fixtures_setup(TestFixtures *fixtures,
+               G_GNUC_UNUSED gconstpointer test_data)
+{
+    gchar *template = g_strdup(TMPDIR_TEMPLATE);
+    fixtures->tmpdir = mkdtemp(template);
+    g_assert(fixtures->tmpdir);
+
+    // Packages 0.rpm - 8.rpm, 9.rpm doesn't exist
+    for (int i = 0; i < FILES - 1; i++) {
+        gchar *name = g_strdup_printf("%d.rpm", i);
+        gchar *path = g_build_filename(fixtures->tmpdir, name, NULL);
+        g_assert(g_file_set_contents(path, "package", -1, NULL));
+        g_free(path);
+        g_free(name);
+    }
+
+    fixtures->asked = g_ptr_array_new_with_free_func(g_free);
+}
+
+
+static void
+fixtures_teardown(TestFixtures *fixtures,
+                  G_GNUC_UNUSED gconstpointer test_data)
+{
+    g_ptr_array_free(fixtures->asked, TRUE);
+
+    if (!fixtures->tmpdir)
+        return;
+
+    cr_remove_dir(fixtures->tmpdir, NULL);
+    g_free(fixtures->tmpdir);
+}
+
+
+static cr_Prefetch *
+prefetch_new(TestFixtures *fixtures, guint min_depth, guint max_depth)
+{
+    cr_Prefetch *pf = cr_prefetch_new(min_depth, max_depth);
+
+    for (int i = 0; i < FILES; i++) {
+        gchar *name = g_strdup_printf("%d.rpm", i);
+        gchar *path = g_build_filename(fixtures->tmpdir, name, NULL);
+        cr_prefetch_add(pf, path, i);
+        g_free(path);
+        g_free(name);
+    }
+
+    return pf;
+}
+
+
+/** Record the package, odd packages (by the tag) are not needed.
+ */
+static gboolean
+needed_even(const char *path, long tag, void *data)
+{
+    TestFixtures *fixtures = data;
+    gchar *basename = g_path_get_basename(path);
+
+    g_assert_cmpint(atoi(basename), ==, tag);
+    g_ptr_array_add(fixtures->asked, basename);
+    return tag % 2 == 0;
+}
+
+
+static void
+assert_asked(TestFixtures *fixtures, const char **expected)
+{
+    guint i = 0;
+
+    for (; *expected; expected++, i++) {
+        g_assert_cmpuint(i, <, fixtures->asked->len);
+        g_assert_cmpstr(g_ptr_array_index(fixtures->asked, i), ==, *expected);
+    }
+    g_assert_cmpuint(i, ==, fixtures->asked->len);
+
+    g_ptr_array_set_size(fixtures->asked, 0);
+}
+
+
+static void
+test_cr_prefetch_window(TestFixtures *fixtures,
+                        G_GNUC_UNUSED gconstpointer test_data)
+{
+    cr_Prefetch *pf = prefetch_new(fixtures, 2, 4);
+    cr_prefetch_set_needed_func(pf, needed_even, fixtures);
+
+    g_assert_cmpuint(cr_prefetch_get_depth(pf), ==, 2);
+
+    // Two packages after the started one
+    cr_prefetch_advance(pf, 0);
+    assert_asked(fixtures, (const char *[]) { "1.rpm", "2.rpm", NULL });
+    g_assert_cmpuint(cr_prefetch_get_count(pf), ==, 1);
+
+    // Every package is prefetched only once
+    cr_prefetch_advance(pf, 1);
+    assert_asked(fixtures, (const char *[]) { "3.rpm", NULL });
+    cr_prefetch_advance(pf, 0);
+    assert_asked(fixtures, (const char *[]) { NULL });
+
+    // Workers overtook the prefetching
+    cr_prefetch_advance(pf, 5);
+    assert_asked(fixtures, (const char *[]) { "6.rpm", "7.rpm", NULL });
+    g_assert_cmpuint(cr_prefetch_get_count(pf), ==, 2);
+
+    // Nothing is after the last package
+    cr_prefetch_advance(pf, 7);
+    assert_asked(fixtures, (const char *[]) { "8.rpm", "9.rpm", NULL });
+    g_assert_cmpuint(cr_prefetch_get_count(pf), ==, 3);
+    cr_prefetch_advance(pf, 9);
+    assert_asked(fixtures, (const char *[]) { NULL });
+
+    cr_prefetch_free(pf);
+}
+
+
+static void
+test_cr_prefetch_all(TestFixtures *fixtures,
+                     G_GNUC_UNUSED gconstpointer test_data)
+{
+    cr_Prefetch *pf = prefetch_new(fixtures, 16, 16);
+
+    // Without the needed func everything is prefetched, except
+    // the missing package
+    cr_prefetch_advance(pf, 0);
+    g_assert_cmpuint(cr_prefetch_get_count(pf), ==, FILES - 2);
+    cr_prefetch_advance(pf, 1);
+    g_assert_cmpuint(cr_prefetch_get_count(pf), ==, FILES - 2);
+
+    cr_prefetch_free(pf);
+
+    // Functions are no-op without prefetcher
+    cr_prefetch_add(NULL, "foo.rpm", 0);
+    cr_prefetch_advance(NULL, 0);
+    cr_prefetch_observe(NULL, 0);
+    cr_prefetch_free(NULL);
+}
+
+
+static void
+test_cr_prefetch_depth(TestFixtures *fixtures,
+                       G_GNUC_UNUSED gconstpointer test_data)
+{
+    cr_Prefetch *pf = prefetch_new(fixtures, 2, 8);
+
+    // Fast reads don't need a bigger window
+    for (int i = 0; i < 64; i++)
+        cr_prefetch_observe(pf, 100);
+    g_assert_cmpuint(cr_prefetch_get_depth(pf), ==, 2);
+
+    // Slow reads double it up to the max
+    for (int i = 0; i < 16; i++)
+        cr_prefetch_observe(pf, 100000);
+    g_assert_cmpuint(cr_prefetch_get_depth(pf), ==, 4);
+    for (int i = 0; i < 32; i++)
+        cr_prefetch_observe(pf, 100000);
+    g_assert_cmpuint(cr_prefetch_get_depth(pf), ==, 8);
+
+    // Reads served from the cache halve it back to the min
+    for (int i = 0; i < 48; i++)
+        cr_prefetch_observe(pf, 100);
+    g_assert_cmpuint(cr_prefetch_get_depth(pf), ==, 4);
+    for (int i = 0; i < 16; i++)
+        cr_prefetch_observe(pf, 100);
+    g_assert_cmpuint(cr_prefetch_get_depth(pf), ==, 2);
+
+    cr_prefetch_free(pf);
+
+    // Out of the memory limit it's halved even if the reads are slow
+    pf = prefetch_new(fixtures, 2, 8);
+    for (int i = 0; i < 32; i++)
+        cr_prefetch_observe(pf, 100000);
+    g_assert_cmpuint(cr_prefetch_get_depth(pf), ==, 8);
+    cr_prefetch_set_max_bytes(pf, 1);
+    cr_prefetch_advance(pf, 0);
+    cr_prefetch_advance(pf, 1);
+    g_assert_cmpuint(cr_prefetch_get_count(pf), ==, 8);
+    for (int i = 0; i < 16; i++)
+        cr_prefetch_observe(pf, 100000);
+    g_assert_cmpuint(cr_prefetch_get_depth(pf), ==, 4);
+
+    // Slow reads double it again once it fits
+    for (int i = 0; i < 16; i++)
+        cr_prefetch_observe(pf, 100000);
+    g_assert_cmpuint(cr_prefetch_get_depth(pf), ==, 8);
+
+    cr_prefetch_free(pf);
+
+    // Initial depth is limited by the max depth
+    pf = cr_prefetch_new(10, 3);
+    g_assert_cmpuint(cr_prefetch_get_depth(pf), ==, 3);
+    cr_prefetch_free(pf);
+}
+
+
+int
+main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add("/prefetch/test_cr_prefetch_window", TestFixtures,
+               NULL, fixtures_setup, test_cr_prefetch_window,
+               fixtures_teardown);
+    g_test_add("/prefetch/test_cr_prefetch_all", TestFixtures,
+               NULL, fixtures_setup, test_cr_prefetch_all,
+               fixtures_teardown);
+    g_test_add("/prefetch/test_cr_prefetch_depth", TestFixtures,
+               NULL, fixtures_setup, test_cr_prefetch_depth,
+               fixtures_teardown);
+
+    return g_test_run();
+}
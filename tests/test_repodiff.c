@@ -0,0 +1,191 @@
+/* createrepo_c - Library of routines for manipulation with repodata
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "fixtures.h"
+#include "createrepo/error.h"
+#include "createrepo/repodiff.h"
+
+
+static cr_RepoDiffItem *
+item(cr_RepoDiff *diff, guint n)
+{
+    return g_slist_nth_data(diff->items, n);
+}
+
+
+static void
+test_cr_repodiff_same(void)
+{
+    GError *err = NULL;
+    cr_RepoDiff *diff;
+
+    diff = cr_repodiff(TEST_REPO_02_PRIMARY, TEST_REPO_02_PRIMARY,
+                       CR_HT_KEY_NAME, &err);
+    g_assert(diff);
+    g_assert(!err);
+    g_assert_cmpint(diff->unchanged, ==, 2);
+    g_assert(!diff->items);
+    cr_repodiff_free(diff);
+}
+
+
+static void
+test_cr_repodiff_name(void)
+{
+    GError *err = NULL;
+    cr_RepoDiff *diff;
+
+    // repo_02 adds fake_bash and has a different build of super_kernel
+    diff = cr_repodiff(TEST_REPO_01_PRIMARY, TEST_REPO_02_PRIMARY,
+                       CR_HT_KEY_NAME, &err);
+    g_assert(diff);
+    g_assert(!err);
+    g_assert_cmpint(diff->unchanged, ==, 0);
+    g_assert_cmpint(g_slist_length(diff->items), ==, 2);
+
+    g_assert_cmpint(item(diff, 0)->type, ==, CR_REPODIFF_ADDED);
+    g_assert(!item(diff, 0)->old_pkg);
+    g_assert_cmpstr(item(diff, 0)->new_pkg->name, ==, "fake_bash");
+
+    g_assert_cmpint(item(diff, 1)->type, ==, CR_REPODIFF_CHANGED);
+    g_assert_cmpstr(item(diff, 1)->old_pkg->pkgId, ==,
+        "152824bff2aa6d54f429d43e87a3ff3a0286505c6d93ec87692b5e3a9e3b97bf");
+    g_assert_cmpstr(item(diff, 1)->new_pkg->pkgId, ==,
+        "6d43a638af70ef899933b1fd86a866f18f65b0e0e17dcbf2e42bfd0cdd7c63c3");
+    g_assert_cmpstr(item(diff, 1)->new_pkg->location_href, ==,
+                    "super_kernel-6.0.1-2.x86_64.rpm");
+
+    gchar *json = cr_repodiff_to_json(diff);
+    g_assert(strstr(json, "\"unchanged\": 0"));
+    g_assert(strstr(json, "\"added\": [\n    {\"name\": \"fake_bash\""));
+    g_assert(strstr(json, "\"removed\": []"));
+    g_assert(strstr(json, "\"changed\": [\n    {\"old\": {\"name\": \"super_kernel\""));
+    g_free(json);
+
+    cr_repodiff_free(diff);
+}
+
+
+static void
+test_cr_repodiff_hash(void)
+{
+    GError *err = NULL;
+    cr_RepoDiff *diff;
+
+    // No pairing - the changed package is removed and added
+    diff = cr_repodiff(TEST_REPO_01_PRIMARY, TEST_REPO_02_PRIMARY,
+                       CR_HT_KEY_HASH, &err);
+    g_assert(diff);
+    g_assert(!err);
+    g_assert_cmpint(g_slist_length(diff->items), ==, 3);
+    g_assert_cmpint(item(diff, 0)->type, ==, CR_REPODIFF_ADDED);
+    g_assert_cmpint(item(diff, 1)->type, ==, CR_REPODIFF_ADDED);
+    g_assert_cmpint(item(diff, 2)->type, ==, CR_REPODIFF_REMOVED);
+    g_assert_cmpstr(item(diff, 2)->old_pkg->name, ==, "super_kernel");
+    cr_repodiff_free(diff);
+}
+
+
+static void
+test_cr_repodiff_nonexistent(void)
+{
+    GError *err = NULL;
+    cr_RepoDiff *diff;
+
+    diff = cr_repodiff(TEST_REPO_01_PRIMARY, "/nonexistent/primary.xml",
+                       CR_HT_KEY_NAME, &err);
+    g_assert(!diff);
+    g_assert(err);
+    g_clear_error(&err);
+}
+
+
+static void
+test_cr_repodiff_with_limit(void)
+{
+    GError *err = NULL;
+    cr_RepoDiff *diff;
+    gchar *tmpdir = g_dir_make_tmp("createrepo_c_test_XXXXXX", NULL);
+    const char *repos[][2] = {
+        { TEST_REPO_01_PRIMARY, TEST_REPO_02_PRIMARY },
+        { TEST_REPO_02_PRIMARY, TEST_REPO_01_PRIMARY },
+        { TEST_REPO_02_PRIMARY, TEST_REPO_02_PRIMARY },
+        { TEST_REPO_00_PRIMARY, TEST_REPO_02_PRIMARY },
+    };
+
+    // Packages sorted in temporary files give the same diff
+    for (size_t i = 0; i < G_N_ELEMENTS(repos); i++) {
+        diff = cr_repodiff(repos[i][0], repos[i][1], CR_HT_KEY_NAME, &err);
+        g_assert_no_error(err);
+        gchar *expected = cr_repodiff_to_json(diff);
+        cr_repodiff_free(diff);
+
+        for (long max = 1; max <= 3; max++) {
+            diff = cr_repodiff_with_limit(repos[i][0], repos[i][1],
+                                          CR_HT_KEY_NAME, max, tmpdir, &err);
+            g_assert_no_error(err);
+            gchar *json = cr_repodiff_to_json(diff);
+            g_assert_cmpstr(json, ==, expected);
+            g_free(json);
+            cr_repodiff_free(diff);
+        }
+
+        g_free(expected);
+    }
+
+    // The temporary files are removed
+    GDir *dir = g_dir_open(tmpdir, 0, NULL);
+    g_assert(dir);
+    g_assert(!g_dir_read_name(dir));
+    g_dir_close(dir);
+
+    diff = cr_repodiff_with_limit(TEST_REPO_01_PRIMARY, TEST_REPO_02_PRIMARY,
+                                  CR_HT_KEY_NAME, 0, tmpdir, &err);
+    g_assert(!diff);
+    g_assert_error(err, CREATEREPO_C_ERROR, CRE_BADARG);
+    g_clear_error(&err);
+
+    g_rmdir(tmpdir);
+    g_free(tmpdir);
+}
+
+
+int
+main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/repodiff/test_cr_repodiff_same",
+                    test_cr_repodiff_same);
+    g_test_add_func("/repodiff/test_cr_repodiff_name",
+                    test_cr_repodiff_name);
+    g_test_add_func("/repodiff/test_cr_repodiff_hash",
+                    test_cr_repodiff_hash);
+    g_test_add_func("/repodiff/test_cr_repodiff_nonexistent",
+                    test_cr_repodiff_nonexistent);
+    g_test_add_func("/repodiff/test_cr_repodiff_with_limit",
+                    test_cr_repodiff_with_limit);
+
+    return g_test_run();
+}
@@ -0,0 +1,361 @@
+/* createrepo_c - Library of routines for manipulation with repodata
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include "fixtures.h"
+#include "createrepo/error.h"
+#include "createrepo/load_metadata.h"
+#include "createrepo/locate_metadata.h"
+#include "createrepo/misc.h"
+#include "createrepo/repomd.h"
+#include "createrepo/snapshot.h"
+#include "createrepo/xml_dump.h"
+
+typedef struct {
+    gchar *tmpdir;
+    gchar *snapshot;            // Path to the snapshot in the tmpdir
+    cr_Repomd *repomd;          // Repomd of TEST_REPO_02
+    cr_Metadata *md;            // TEST_REPO_02 loaded from xml
+} TestFixtures;
+
+
+static void
+fixtures_setup(TestFixtures *fixtures,
+               G_GNUC_UNUSED gconstpointer test_data)
+{
+    GError *err = NULL;
+    struct cr_MetadataLocation *ml;
+    int ret;
+
+    gchar *template = g_strdup(TMPDIR_TEMPLATE);
+    fixtures->tmpdir = mkdtemp(template);
+    g_assert(fixtures->tmpdir);
+    fixtures->snapshot = g_build_filename(fixtures->tmpdir,
+                                          CR_SNAPSHOT_FILENAME, NULL);
+
+    ml = cr_locate_metadata(TEST_REPO_02, TRUE, &err);
+    g_assert(ml);
+    g_assert(!err);
+    g_assert(ml->repomd_data);
+    fixtures->repomd = cr_repomd_copy(ml->repomd_data);
+
+    fixtures->md = cr_metadata_new(CR_HT_KEY_HASH, 0, NULL);
+    ret = cr_metadata_load_xml(fixtures->md, ml, &err);
+    g_assert_cmpint(ret, ==, CRE_OK);
+    g_assert(!err);
+
+    cr_metadatalocation_free(ml);
+}
+
+
+static void
+fixtures_teardown(TestFixtures *fixtures,
+                  G_GNUC_UNUSED gconstpointer test_data)
+{
+    cr_metadata_free(fixtures->md);
+    cr_repomd_free(fixtures->repomd);
+    g_free(fixtures->snapshot);
+
+    if (!fixtures->tmpdir)
+        return;
+
+    cr_remove_dir(fixtures->tmpdir, NULL);
+    g_free(fixtures->tmpdir);
+}
+
+
+static void
+write_snapshot(TestFixtures *fixtures, const char *path)
+{
+    GError *err = NULL;
+    GHashTableIter iter;
+    gpointer value;
+    cr_SnapshotWriter *sw;
+    int ret;
+
+    sw = cr_snapshot_writer_new();
+    g_hash_table_iter_init(&iter, cr_metadata_hashtable(fixtures->md));
+    while (g_hash_table_iter_next(&iter, NULL, &value))
+        cr_snapshot_writer_add_pkg(sw, value);
+    g_assert_cmpint(cr_snapshot_writer_count(sw), ==, 2);
+
+    ret = cr_snapshot_writer_write(sw, path, fixtures->repomd, &err);
+    g_assert_cmpint(ret, ==, CRE_OK);
+    g_assert(!err);
+    cr_snapshot_writer_free(sw);
+}
+
+
+static int
+collect_pkgcb(cr_Package *pkg, void *cbdata, G_GNUC_UNUSED GError **err)
+{
+    GSList **pkgs = cbdata;
+    *pkgs = g_slist_prepend(*pkgs, pkg);
+    return CR_CB_RET_OK;
+}
+
+
+static void
+assert_same_package(cr_Package *pkg, cr_Package *orig)
+{
+    GError *err = NULL;
+    struct cr_XmlStruct res, orig_res;
+
+    res = cr_xml_dump(pkg, &err);
+    g_assert(!err);
+    orig_res = cr_xml_dump(orig, &err);
+    g_assert(!err);
+
+    g_assert_cmpstr(res.primary, ==, orig_res.primary);
+    g_assert_cmpstr(res.filelists, ==, orig_res.filelists);
+    g_assert_cmpstr(res.other, ==, orig_res.other);
+
+    g_free(res.primary);
+    g_free(res.filelists);
+    g_free(res.filelists_ext);
+    g_free(res.other);
+    g_free(orig_res.primary);
+    g_free(orig_res.filelists);
+    g_free(orig_res.filelists_ext);
+    g_free(orig_res.other);
+}
+
+
+static void
+test_cr_snapshot_roundtrip(TestFixtures *fixtures,
+                           G_GNUC_UNUSED gconstpointer test_data)
+{
+    GError *err = NULL;
+    GSList *pkgs = NULL;
+    int ret;
+
+    write_snapshot(fixtures, fixtures->snapshot);
+
+    ret = cr_snapshot_load(fixtures->snapshot, fixtures->repomd, NULL,
+                           NULL, NULL, collect_pkgcb, &pkgs, &err);
+    g_assert_cmpint(ret, ==, CRE_OK);
+    g_assert(!err);
+    g_assert_cmpint(g_slist_length(pkgs), ==, 2);
+
+    for (GSList *elem = pkgs; elem; elem = g_slist_next(elem)) {
+        cr_Package *pkg = elem->data;
+        cr_Package *orig = g_hash_table_lookup(
+                                cr_metadata_hashtable(fixtures->md),
+                                pkg->pkgId);
+        g_assert(orig);
+        assert_same_package(pkg, orig);
+    }
+
+    g_slist_free_full(pkgs, (GDestroyNotify) cr_package_free);
+}
+
+
+static void
+test_cr_snapshot_filter(TestFixtures *fixtures,
+                        G_GNUC_UNUSED gconstpointer test_data)
+{
+    GError *err = NULL;
+    GSList *pkgs = NULL;
+    cr_XmlFilter *filter;
+    int ret;
+
+    write_snapshot(fixtures, fixtures->snapshot);
+
+    filter = cr_xml_filter_new();
+    cr_xml_filter_add_name_glob(filter, "fake_*");
+    ret = cr_snapshot_load(fixtures->snapshot, fixtures->repomd, filter,
+                           NULL, NULL, collect_pkgcb, &pkgs, &err);
+    g_assert_cmpint(ret, ==, CRE_OK);
+    g_assert(!err);
+    g_assert_cmpint(g_slist_length(pkgs), ==, 1);
+    g_assert_cmpstr(((cr_Package *) pkgs->data)->name, ==, "fake_bash");
+
+    g_slist_free_full(pkgs, (GDestroyNotify) cr_package_free);
+    cr_xml_filter_free(filter);
+}
+
+
+static void
+test_cr_snapshot_stale(TestFixtures *fixtures,
+                       G_GNUC_UNUSED gconstpointer test_data)
+{
+    GError *err = NULL;
+    GSList *pkgs = NULL;
+    int ret;
+
+    write_snapshot(fixtures, fixtures->snapshot);
+
+    // Any of the primary, filelists and other changed
+    const char *types[] = { "primary", "filelists", "other", NULL };
+    for (const char **type = types; *type; type++) {
+        cr_Repomd *repomd = cr_repomd_copy(fixtures->repomd);
+        cr_RepomdRecord *rec = cr_repomd_get_record(repomd, *type);
+
+        g_assert(rec);
+        rec->checksum = g_string_chunk_insert(rec->chunk, "0123456789abcdef");
+        ret = cr_snapshot_load(fixtures->snapshot, repomd, NULL,
+                               NULL, NULL, collect_pkgcb, &pkgs, &err);
+        g_assert_cmpint(ret, ==, CRE_SNAPSHOT);
+        g_assert(err);
+        g_assert(!pkgs);
+        g_clear_error(&err);
+        cr_repomd_free(repomd);
+    }
+
+    // The filelists-ext takes precedence over the filelists
+    cr_Repomd *repomd = cr_repomd_copy(fixtures->repomd);
+    cr_RepomdRecord *rec = cr_repomd_record_copy(
+                                cr_repomd_get_record(repomd, "filelists"));
+    rec->type = g_string_chunk_insert(rec->chunk, "filelists-ext");
+    cr_repomd_set_record(repomd, rec);
+    ret = cr_snapshot_load(fixtures->snapshot, repomd, NULL,
+                           NULL, NULL, collect_pkgcb, &pkgs, &err);
+    g_assert_cmpint(ret, ==, CRE_OK);
+    g_assert(!err);
+    g_assert_cmpint(g_slist_length(pkgs), ==, 2);
+    g_slist_free_full(pkgs, (GDestroyNotify) cr_package_free);
+    pkgs = NULL;
+
+    rec->checksum = g_string_chunk_insert(rec->chunk, "0123456789abcdef");
+    ret = cr_snapshot_load(fixtures->snapshot, repomd, NULL,
+                           NULL, NULL, collect_pkgcb, &pkgs, &err);
+    g_assert_cmpint(ret, ==, CRE_SNAPSHOT);
+    g_assert(err);
+    g_assert(!pkgs);
+    g_clear_error(&err);
+    cr_repomd_free(repomd);
+
+    ret = cr_snapshot_load(TEST_REPO_02_REPOMD, fixtures->repomd, NULL,
+                           NULL, NULL, collect_pkgcb, &pkgs, &err);
+    g_assert_cmpint(ret, ==, CRE_SNAPSHOT);
+    g_assert(err);
+    g_assert(!pkgs);
+    g_clear_error(&err);
+}
+
+
+static void
+test_cr_snapshot_corrupted(TestFixtures *fixtures,
+                           G_GNUC_UNUSED gconstpointer test_data)
+{
+    GError *err = NULL;
+    GSList *pkgs = NULL;
+    gchar *content;
+    gsize length;
+    int ret;
+
+    write_snapshot(fixtures, fixtures->snapshot);
+
+    // Truncated snapshot
+    g_assert(g_file_get_contents(fixtures->snapshot, &content, &length, NULL));
+    g_assert(g_file_set_contents(fixtures->snapshot, content, length - 8, NULL));
+    g_free(content);
+
+    ret = cr_snapshot_load(fixtures->snapshot, fixtures->repomd, NULL,
+                           NULL, NULL, collect_pkgcb, &pkgs, &err);
+    g_assert_cmpint(ret, ==, CRE_SNAPSHOT);
+    g_assert(err);
+    g_assert(!pkgs);
+    g_clear_error(&err);
+}
+
+
+static void
+test_cr_metadata_load_snapshot(TestFixtures *fixtures,
+                               G_GNUC_UNUSED gconstpointer test_data)
+{
+    GError *err = NULL;
+    cr_Metadata *md;
+    gchar *content;
+    gsize length;
+    int ret;
+
+    // The repo contains only repomd.xml and the snapshot, so it can be
+    // loaded only from the snapshot
+    gchar *repodata = g_build_filename(fixtures->tmpdir, "repodata", NULL);
+    gchar *repomd = g_build_filename(repodata, "repomd.xml", NULL);
+    gchar *snapshot = g_build_filename(repodata, CR_SNAPSHOT_FILENAME, NULL);
+    g_assert_cmpint(g_mkdir(repodata, 0755), ==, 0);
+    g_assert(g_file_get_contents(TEST_REPO_02_REPOMD, &content, &length, NULL));
+    g_assert(g_file_set_contents(repomd, content, length, NULL));
+    g_free(content);
+
+    write_snapshot(fixtures, snapshot);
+
+    md = cr_metadata_new(CR_HT_KEY_HASH, 1, NULL);
+    ret = cr_metadata_locate_and_load_xml(md, fixtures->tmpdir, &err);
+    g_assert_cmpint(ret, ==, CRE_OK);
+    g_assert(!err);
+    g_assert_cmpint(g_hash_table_size(cr_metadata_hashtable(md)), ==, 2);
+
+    GHashTableIter iter;
+    gpointer key, value;
+    g_hash_table_iter_init(&iter, cr_metadata_hashtable(md));
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        cr_Package *orig = g_hash_table_lookup(
+                                cr_metadata_hashtable(fixtures->md), key);
+        g_assert(orig);
+        assert_same_package(value, orig);
+    }
+    cr_metadata_free(md);
+
+    // Lazy mode doesn't use the snapshot
+    md = cr_metadata_new(CR_HT_KEY_HASH, 0, NULL);
+    cr_metadata_set_lazy(md, TRUE);
+    ret = cr_metadata_locate_and_load_xml(md, fixtures->tmpdir, &err);
+    g_assert_cmpint(ret, !=, CRE_OK);
+    g_assert(err);
+    g_clear_error(&err);
+    cr_metadata_free(md);
+
+    g_free(repodata);
+    g_free(repomd);
+    g_free(snapshot);
+}
+
+
+int
+main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add("/snapshot/test_cr_snapshot_roundtrip", TestFixtures,
+               NULL, fixtures_setup, test_cr_snapshot_roundtrip,
+               fixtures_teardown);
+    g_test_add("/snapshot/test_cr_snapshot_filter", TestFixtures,
+               NULL, fixtures_setup, test_cr_snapshot_filter,
+               fixtures_teardown);
+    g_test_add("/snapshot/test_cr_snapshot_stale", TestFixtures,
+               NULL, fixtures_setup, test_cr_snapshot_stale,
+               fixtures_teardown);
+    g_test_add("/snapshot/test_cr_snapshot_corrupted", TestFixtures,
+               NULL, fixtures_setup, test_cr_snapshot_corrupted,
+               fixtures_teardown);
+    g_test_add("/snapshot/test_cr_metadata_load_snapshot", TestFixtures,
+               NULL, fixtures_setup, test_cr_metadata_load_snapshot,
+               fixtures_teardown);
+
+    return g_test_run();
+}
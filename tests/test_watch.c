@@ -0,0 +1,220 @@
+/* createrepo_c - Library of routines for manipulation with repodata
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#define _XOPEN_SOURCE 700
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include "fixtures.h"
+#include "createrepo/error.h"
+#include "createrepo/misc.h"
+#include "createrepo/watch.h"
+
+#define TIMEOUT     5000
+#define QUIET       100
+
+typedef struct {
+    gchar *tmpdir;
+    cr_Watch *watch;
+} TestFixtures;
+
+
+static void
+fixtures_setup(TestFixtures *fixtures,
+               G_GNUC_UNUSED gconstpointer test_data)
+{
+    GError *err = NULL;
+    gchar *repodata;
+    int ret;
+
+    gchar *template = g_strdup(TMPDIR_TEMPLATE);
+    fixtures->tmpdir = mkdtemp(template);
+    g_assert(fixtures->tmpdir);
+
+    fixtures->watch = cr_watch_new(&err);
+    g_assert(fixtures->watch);
+    g_assert(!err);
+
+    repodata = g_build_filename(fixtures->tmpdir, "repodata", NULL);
+    cr_watch_exclude(fixtures->watch, repodata);
+    g_free(repodata);
+
+    ret = cr_watch_add_dir(fixtures->watch, fixtures->tmpdir, &err);
+    g_assert_cmpint(ret, ==, CRE_OK);
+    g_assert(!err);
+}
+
+
+static void
+fixtures_teardown(TestFixtures *fixtures,
+                  G_GNUC_UNUSED gconstpointer test_data)
+{
+    cr_watch_free(fixtures->watch);
+
+    if (!fixtures->tmpdir)
+        return;
+
+    cr_remove_dir(fixtures->tmpdir, NULL);
+    g_free(fixtures->tmpdir);
+}
+
+
+static gchar *
+tmp_path(TestFixtures *fixtures, const char *name)
+{
+    return g_build_filename(fixtures->tmpdir, name, NULL);
+}
+
+
+/** Write the file in place (g_file_set_contents() would create
+ * a temporary file next to it).
+ */
+static void
+write_file(const char *path, const char *content)
+{
+    FILE *f = fopen(path, "w");
+    g_assert(f);
+    g_assert_cmpint(fputs(content, f), >=, 0);
+    g_assert_cmpint(fclose(f), ==, 0);
+}
+
+
+/** Wait for changes and compare them with the expected list of names
+ * (relative to the tmpdir).
+ */
+static void
+assert_changes(TestFixtures *fixtures, gint timeout, const char **expected)
+{
+    GError *err = NULL;
+    GSList *changed = NULL, *elem;
+    int ret;
+
+    ret = cr_watch_wait(fixtures->watch, timeout, QUIET, &changed, &err);
+    g_assert_cmpint(ret, ==, CRE_OK);
+    g_assert(!err);
+
+    elem = changed;
+    for (; *expected; expected++, elem = g_slist_next(elem)) {
+        gchar *path = tmp_path(fixtures, *expected);
+        g_assert(elem);
+        g_assert_cmpstr(elem->data, ==, path);
+        g_free(path);
+    }
+    g_assert(!elem);
+
+    g_slist_free_full(changed, g_free);
+}
+
+
+static void
+test_cr_watch_add_remove(TestFixtures *fixtures,
+                         G_GNUC_UNUSED gconstpointer test_data)
+{
+    gchar *a = tmp_path(fixtures, "a.rpm");
+    gchar *b = tmp_path(fixtures, "b.rpm");
+
+    // Nothing changed
+    assert_changes(fixtures, QUIET, (const char *[]) { NULL });
+
+    // A burst of changes is reported at once
+    write_file(a, "a");
+    write_file(b, "b");
+    write_file(a, "aa");
+    assert_changes(fixtures, TIMEOUT, (const char *[]) { "a.rpm", "b.rpm", NULL });
+
+    g_assert_cmpint(g_remove(b), ==, 0);
+    assert_changes(fixtures, TIMEOUT, (const char *[]) { "b.rpm", NULL });
+
+    g_free(a);
+    g_free(b);
+}
+
+
+static void
+test_cr_watch_replace(TestFixtures *fixtures,
+                      G_GNUC_UNUSED gconstpointer test_data)
+{
+    gchar *a = tmp_path(fixtures, "a.rpm");
+    gchar *tmp = tmp_path(fixtures, ".a.rpm.part");
+
+    write_file(a, "a");
+    assert_changes(fixtures, TIMEOUT, (const char *[]) { "a.rpm", NULL });
+
+    // Upload under a hidden name is reported only when it is renamed
+    write_file(tmp, "new a");
+    assert_changes(fixtures, QUIET, (const char *[]) { NULL });
+    g_assert_cmpint(g_rename(tmp, a), ==, 0);
+    assert_changes(fixtures, TIMEOUT, (const char *[]) { "a.rpm", NULL });
+
+    g_free(a);
+    g_free(tmp);
+}
+
+
+static void
+test_cr_watch_subdirs(TestFixtures *fixtures,
+                      G_GNUC_UNUSED gconstpointer test_data)
+{
+    gchar *sub = tmp_path(fixtures, "sub");
+    gchar *b = tmp_path(fixtures, "sub/b.rpm");
+    gchar *repodata = tmp_path(fixtures, "repodata");
+    gchar *repomd = tmp_path(fixtures, "repodata/repomd.xml");
+
+    // New directory is watched too
+    g_assert_cmpint(g_mkdir(sub, 0755), ==, 0);
+    assert_changes(fixtures, TIMEOUT, (const char *[]) { "sub", NULL });
+    write_file(b, "b");
+    assert_changes(fixtures, TIMEOUT, (const char *[]) { "sub/b.rpm", NULL });
+
+    g_assert_cmpint(g_remove(b), ==, 0);
+    g_assert_cmpint(g_rmdir(sub), ==, 0);
+    assert_changes(fixtures, TIMEOUT, (const char *[]) { "sub", "sub/b.rpm", NULL });
+
+    // Excluded directory
+    g_assert_cmpint(g_mkdir(repodata, 0755), ==, 0);
+    write_file(repomd, "<repomd/>");
+    assert_changes(fixtures, QUIET, (const char *[]) { NULL });
+
+    g_free(sub);
+    g_free(b);
+    g_free(repodata);
+    g_free(repomd);
+}
+
+
+int
+main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add("/watch/test_cr_watch_add_remove", TestFixtures,
+               NULL, fixtures_setup, test_cr_watch_add_remove,
+               fixtures_teardown);
+    g_test_add("/watch/test_cr_watch_replace", TestFixtures,
+               NULL, fixtures_setup, test_cr_watch_replace,
+               fixtures_teardown);
+    g_test_add("/watch/test_cr_watch_subdirs", TestFixtures,
+               NULL, fixtures_setup, test_cr_watch_subdirs,
+               fixtures_teardown);
+
+    return g_test_run();
+}
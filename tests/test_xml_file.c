@@ -25,8 +25,11 @@
 #include <stdio.h>
 #include <unistd.h>
 #include "fixtures.h"
+#include "createrepo/error.h"
 #include "createrepo/misc.h"
 #include "createrepo/xml_file.h"
+#include "createrepo/xml_parser.h"
+#include "createrepo/updateinfo.h"
 #include "createrepo/compression_wrapper.h"
 
 typedef struct {
@@ -139,12 +142,69 @@ test_rewrite_header_pacakge_count(TestFixtures *fixtures,
     g_free(path);
 }
 
+static void
+test_merge_updateinfo(TestFixtures *fixtures,
+                      G_GNUC_UNUSED gconstpointer test_data)
+{
+    cr_XmlFile *f;
+    cr_UpdateInfo *new, *merged;
+    cr_UpdateRecord *rec;
+    gchar *path;
+    int ret;
+    GError *err = NULL;
+
+    new = cr_updateinfo_new();
+    rec = cr_updaterecord_new();
+    rec->id = g_string_chunk_insert(rec->chunk, "RHEA-2012:0057");
+    rec->title = g_string_chunk_insert(rec->chunk, "Replaced");
+    cr_updateinfo_apped_record(new, rec);
+    rec = cr_updaterecord_new();
+    rec->id = g_string_chunk_insert(rec->chunk, "RHEA-2026:0001");
+    cr_updateinfo_apped_record(new, rec);
+
+    path = g_build_filename(fixtures->tmpdir, "updateinfo.xml", NULL);
+    f = cr_xmlfile_open_updateinfo(path, CR_CW_NO_COMPRESSION, &err);
+    g_assert(f);
+    ret = cr_xmlfile_merge_updateinfo(f, TEST_UPDATEINFO_03, new, &err);
+    g_assert_cmpint(ret, ==, CRE_OK);
+    g_assert(!err);
+    ret = cr_xmlfile_close(f, &err);
+    g_assert_cmpint(ret, ==, CRE_OK);
+
+    // Untouched advisories are kept, the changed one is replaced in place
+    // and the new one is appended
+
+    merged = cr_updateinfo_new();
+    ret = cr_xml_parse_updateinfo(path, merged, NULL, NULL, &err);
+    g_assert_cmpint(ret, ==, CRE_OK);
+    g_assert(!err);
+    g_assert_cmpint(g_slist_length(merged->updates), ==, 7);
+
+    rec = g_slist_nth_data(merged->updates, 0);
+    g_assert_cmpstr(rec->id, ==, "RHEA-2012:0055");
+    rec = g_slist_nth_data(merged->updates, 2);
+    g_assert_cmpstr(rec->id, ==, "RHEA-2012:0057");
+    g_assert_cmpstr(rec->title, ==, "Replaced");
+    rec = g_slist_nth_data(merged->updates, 5);
+    g_assert_cmpstr(rec->id, ==, "RHEA-2012:0060");
+    g_assert_cmpstr(rec->updated_date, ==, "2018-07-29 06:00:01 UTC");
+    rec = g_slist_nth_data(merged->updates, 6);
+    g_assert_cmpstr(rec->id, ==, "RHEA-2026:0001");
+
+    cr_updateinfo_free(merged);
+    cr_updateinfo_free(new);
+    g_free(path);
+}
+
+
 int
 main(int argc, char *argv[])
 {
     g_test_init(&argc, &argv, NULL);
 
     g_test_add("/xml_file/test_no_packages", TestFixtures, NULL, fixtures_setup, test_no_packages, fixtures_teardown);
+    g_test_add("/xml_file/test_merge_updateinfo", TestFixtures, NULL,
+               fixtures_setup, test_merge_updateinfo, fixtures_teardown);
     g_test_add("/xml_file/test_write_modified_header", TestFixtures, NULL,
             fixtures_setup, test_rewrite_header_pacakge_count, fixtures_teardown);
 
@@ -0,0 +1,350 @@
+/* createrepo_c - Library of routines for manipulation with repodata
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#include <glib.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "fixtures.h"
+#include "createrepo/error.h"
+#include "createrepo/package.h"
+#include "createrepo/misc.h"
+#include "createrepo/xml_parser.h"
+#include "createrepo/xml_parser_internal.h"
+
+typedef int (*ParseFunc)(const char *, cr_XmlParserNewPkgCb, void *,
+                         cr_XmlParserPkgCb, void *,
+                         cr_XmlParserWarningCb, void *, GError **);
+
+/* Everything the callbacks saw, the fast parser has to produce
+ * exactly the same log as the sequential one.
+ */
+typedef struct {
+    GString *log;
+    gboolean skip_fake_bash;
+} Recorder;
+
+// Callbacks
+
+static int
+newpkgcb_record(cr_Package **pkg,
+                const char *pkgId,
+                const char *name,
+                const char *arch,
+                void *cbdata,
+                GError **err)
+{
+    Recorder *rec = cbdata;
+
+    g_assert(pkg != NULL);
+    g_assert(*pkg == NULL);
+    g_assert(pkgId != NULL);
+    g_assert(!err || *err == NULL);
+
+    g_string_append_printf(rec->log, "new %s %s %s\n", pkgId, name, arch);
+    if (rec->skip_fake_bash && !g_strcmp0(name, "fake_bash"))
+        return CR_CB_RET_OK;
+
+    *pkg = cr_package_new();
+    return CR_CB_RET_OK;
+}
+
+static int
+pkgcb_record(cr_Package *pkg, void *cbdata, GError **err)
+{
+    Recorder *rec = cbdata;
+
+    g_assert(pkg);
+    g_assert(!err || *err == NULL);
+
+    g_string_append_printf(rec->log, "pkg %s %s %s %s:%s-%s %s\n",
+                           pkg->pkgId, pkg->name, pkg->arch, pkg->epoch,
+                           pkg->version, pkg->release,
+                           pkg->files_checksum_type);
+    for (GSList *elem = pkg->files; elem; elem = g_slist_next(elem)) {
+        cr_PackageFile *file = elem->data;
+        g_string_append_printf(rec->log, "  file %s %s%s %s\n", file->type,
+                               file->path, file->name, file->digest);
+    }
+    for (GSList *elem = pkg->changelogs; elem; elem = g_slist_next(elem)) {
+        cr_ChangelogEntry *entry = elem->data;
+        g_string_append_printf(rec->log, "  changelog %s %" G_GINT64_FORMAT
+                               " %s\n", entry->author, entry->date,
+                               entry->changelog);
+    }
+
+    cr_package_free(pkg);
+    return CR_CB_RET_OK;
+}
+
+static int
+warningcb_record(cr_XmlParserWarningType type,
+                 char *msg,
+                 void *cbdata,
+                 GError **err)
+{
+    Recorder *rec = cbdata;
+
+    g_assert(!err || *err == NULL);
+
+    g_string_append_printf(rec->log, "warning %d %s\n", type, msg);
+    return CR_CB_RET_OK;
+}
+
+static gchar *
+parse_and_record(ParseFunc parse,
+                 const char *path,
+                 gboolean skip_fake_bash,
+                 gboolean xml_error)
+{
+    Recorder rec = { g_string_new(NULL), skip_fake_bash };
+    GError *tmp_err = NULL;
+
+    if (xml_error)
+        g_test_expect_message("C_CREATEREPOLIB", G_LOG_LEVEL_CRITICAL,
+                              "*parsing error*");
+    int ret = parse(path, newpkgcb_record, &rec, pkgcb_record, &rec,
+                    warningcb_record, &rec, &tmp_err);
+    if (xml_error)
+        g_test_assert_expected_messages();
+
+    g_string_append_printf(rec.log, "ret %d %s\n", ret,
+                           tmp_err ? tmp_err->message : "");
+    g_clear_error(&tmp_err);
+    return g_string_free(rec.log, FALSE);
+}
+
+static void
+assert_same_as_sequential(ParseFunc sequential,
+                          ParseFunc fast,
+                          const char *path,
+                          gboolean skip_fake_bash,
+                          gboolean xml_error)
+{
+    gchar *expected = parse_and_record(sequential, path, skip_fake_bash,
+                                       xml_error);
+    gchar *log = parse_and_record(fast, path, skip_fake_bash, xml_error);
+    g_assert_cmpstr(log, ==, expected);
+    g_free(expected);
+    g_free(log);
+}
+
+static void
+test_cr_xml_parse_filelists_fast_repos(void)
+{
+    const char *paths[] = {
+        TEST_REPO_00_FILELISTS,
+        TEST_REPO_01_FILELISTS,
+        TEST_REPO_02_FILELISTS,
+        TEST_REPO_03_FILELISTS,
+        TEST_REPO_04_FILELISTS,
+        TEST_REPO_04_FILELISTS_EXT,
+        TEST_REPO_01_OTHER,
+        NULL,
+    };
+
+    for (int i = 0; paths[i]; i++) {
+        assert_same_as_sequential(cr_xml_parse_filelists,
+                                  cr_xml_parse_filelists_fast,
+                                  paths[i], FALSE, FALSE);
+        assert_same_as_sequential(cr_xml_parse_filelists,
+                                  cr_xml_parse_filelists_fast,
+                                  paths[i], TRUE, FALSE);
+    }
+}
+
+static void
+test_cr_xml_parse_filelists_fast_modified(void)
+{
+    const char *paths[] = {
+        TEST_MRF_BAD_TYPE_FIL,
+        TEST_MRF_NO_PKGID_FIL,
+        TEST_MRF_UE_FIL_00,
+        TEST_MRF_UE_FIL_01,
+        TEST_MRF_UE_FIL_02,
+        TEST_DIFF_ORDER_FILELISTS,
+        TEST_FILELISTS_MULTI_WARN_00,
+        TEST_MODIFIED_REPO_FILES_PATH"error_00-filelists.xml",
+        TEST_MODIFIED_REPO_FILES_PATH"repo_01_ampersand-filelists.xml",
+        NULL,
+    };
+
+    for (int i = 0; paths[i]; i++) {
+        assert_same_as_sequential(cr_xml_parse_filelists,
+                                  cr_xml_parse_filelists_fast,
+                                  paths[i], FALSE, FALSE);
+        assert_same_as_sequential(cr_xml_parse_filelists,
+                                  cr_xml_parse_filelists_fast,
+                                  paths[i], TRUE, FALSE);
+    }
+}
+
+static void
+test_cr_xml_parse_other_fast_repos(void)
+{
+    const char *paths[] = {
+        TEST_REPO_00_OTHER,
+        TEST_REPO_01_OTHER,
+        TEST_REPO_02_OTHER,
+        TEST_REPO_03_OTHER,
+        TEST_REPO_04_OTHER,
+        TEST_REPO_01_FILELISTS,
+        NULL,
+    };
+
+    for (int i = 0; paths[i]; i++) {
+        assert_same_as_sequential(cr_xml_parse_other,
+                                  cr_xml_parse_other_fast,
+                                  paths[i], FALSE, FALSE);
+        assert_same_as_sequential(cr_xml_parse_other,
+                                  cr_xml_parse_other_fast,
+                                  paths[i], TRUE, FALSE);
+    }
+}
+
+static void
+test_cr_xml_parse_other_fast_modified(void)
+{
+    const char *paths[] = {
+        TEST_MRF_NO_PKGID_OTH,
+        TEST_MRF_UE_OTH_00,
+        TEST_MRF_UE_OTH_01,
+        TEST_MRF_UE_OTH_02,
+        TEST_OTHER_MULTI_WARN_00,
+        TEST_MODIFIED_REPO_FILES_PATH"error_00-other.xml",
+        TEST_MODIFIED_REPO_FILES_PATH"repo_01_ampersand-other.xml",
+        NULL,
+    };
+
+    for (int i = 0; paths[i]; i++) {
+        assert_same_as_sequential(cr_xml_parse_other,
+                                  cr_xml_parse_other_fast,
+                                  paths[i], FALSE, FALSE);
+        assert_same_as_sequential(cr_xml_parse_other,
+                                  cr_xml_parse_other_fast,
+                                  paths[i], TRUE, FALSE);
+    }
+}
+
+/* Write a filelists which is valid for the fast path up to the broken_pkg
+ * package. That one has an entity reference, a comment and a malformed end
+ * tag, so the rest of the file has to go through libxml2.
+ */
+static void
+write_fallback_filelists(const char *path, int packages, int broken_pkg)
+{
+    FILE *f = fopen(path, "w");
+    g_assert(f);
+
+    fprintf(f, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+               "<filelists xmlns=\"http://linux.duke.edu/metadata/filelists\" "
+               "packages=\"%d\">\n", packages);
+    for (int i = 0; i < packages; i++) {
+        fprintf(f, "<package pkgid=\"%064d\" name=\"pkg%06d\" arch=\"x86_64\">\n"
+                   "  <version epoch=\"0\" ver=\"1.0\" rel=\"1\"/>\n"
+                   "  <file>/usr/bin/pkg%06d</file>\n"
+                   "  <file type=\"dir\">/usr/share/doc/pkg%06d</file>\n",
+                i, i, i, i);
+        if (i == broken_pkg) {
+            fprintf(f, "  <!-- comment -->\n"
+                       "  <file>/usr/share/doc/a&amp;b&#x263A;</file>\n"
+                       "  <file>/broken</fil>\n");
+        }
+        fprintf(f, "</package>\n");
+    }
+    fprintf(f, "</filelists>\n");
+    fclose(f);
+}
+
+static void
+test_cr_xml_parse_filelists_fast_fallback(void)
+{
+    gchar *tmpdir = g_dir_make_tmp("createrepo_c_test_XXXXXX", NULL);
+    gchar *path = g_build_filename(tmpdir, "filelists.xml", NULL);
+
+    // The broken package is far enough to be in another read buffer
+    write_fallback_filelists(path, 5000, 3000);
+    assert_same_as_sequential(cr_xml_parse_filelists,
+                              cr_xml_parse_filelists_fast,
+                              path, FALSE, TRUE);
+
+    g_free(path);
+    cr_remove_dir(tmpdir, NULL);
+    g_free(tmpdir);
+}
+
+static void
+test_cr_xml_parse_fast_simd(void)
+{
+    cr_XmlFastSimd detected = cr_xml_parser_fast_get_simd();
+    const cr_XmlFastSimd levels[] = {
+        CR_XML_FAST_SIMD_NONE,
+        CR_XML_FAST_SIMD_SSE2,
+        CR_XML_FAST_SIMD_AVX2,
+    };
+
+    g_assert(cr_xml_parser_fast_set_simd(CR_XML_FAST_SIMD_NONE));
+
+    // Every level the CPU supports has to give the same results
+    for (size_t i = 0; i < G_N_ELEMENTS(levels); i++) {
+        if (!cr_xml_parser_fast_set_simd(levels[i])) {
+            g_assert_cmpint(levels[i], >, detected);
+            continue;
+        }
+        g_assert_cmpint(cr_xml_parser_fast_get_simd(), ==, levels[i]);
+
+        assert_same_as_sequential(cr_xml_parse_filelists,
+                                  cr_xml_parse_filelists_fast,
+                                  TEST_REPO_02_FILELISTS, FALSE, FALSE);
+        assert_same_as_sequential(cr_xml_parse_filelists,
+                                  cr_xml_parse_filelists_fast,
+                                  TEST_MODIFIED_REPO_FILES_PATH"repo_01_ampersand-filelists.xml",
+                                  FALSE, FALSE);
+        assert_same_as_sequential(cr_xml_parse_other,
+                                  cr_xml_parse_other_fast,
+                                  TEST_REPO_02_OTHER, FALSE, FALSE);
+        assert_same_as_sequential(cr_xml_parse_other,
+                                  cr_xml_parse_other_fast,
+                                  TEST_MODIFIED_REPO_FILES_PATH"repo_01_ampersand-other.xml",
+                                  FALSE, FALSE);
+    }
+
+    g_assert(cr_xml_parser_fast_set_simd(detected));
+}
+
+int
+main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/xml_parser_fast/test_cr_xml_parse_filelists_fast_repos",
+            test_cr_xml_parse_filelists_fast_repos);
+    g_test_add_func("/xml_parser_fast/test_cr_xml_parse_filelists_fast_modified",
+            test_cr_xml_parse_filelists_fast_modified);
+    g_test_add_func("/xml_parser_fast/test_cr_xml_parse_other_fast_repos",
+            test_cr_xml_parse_other_fast_repos);
+    g_test_add_func("/xml_parser_fast/test_cr_xml_parse_other_fast_modified",
+            test_cr_xml_parse_other_fast_modified);
+    g_test_add_func("/xml_parser_fast/test_cr_xml_parse_filelists_fast_fallback",
+            test_cr_xml_parse_filelists_fast_fallback);
+    g_test_add_func("/xml_parser_fast/test_cr_xml_parse_fast_simd",
+            test_cr_xml_parse_fast_simd);
+
+    return g_test_run();
+}
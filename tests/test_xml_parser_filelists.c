@@ -20,6 +20,7 @@
 #include <glib.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include "fixtures.h"
 #include "createrepo/error.h"
 #include "createrepo/package.h"
@@ -450,6 +451,190 @@ test_cr_xml_parse_filelists_ext_snippet_snippet_02(void)
     g_assert_cmpint(parsed, ==, 2);
 }
 
+static void
+test_cr_xml_parse_filelists_parallel_skip_fake_bash(void)
+{
+    int parsed = 0;
+    GError *tmp_err = NULL;
+    int ret = cr_xml_parse_filelists_parallel(TEST_MRF_UE_FIL_01,
+                                              newpkgcb_skip_fake_bash, NULL,
+                                              pkgcb, &parsed, NULL, NULL, 2,
+                                              &tmp_err);
+    g_assert(tmp_err == NULL);
+    g_assert_cmpint(ret, ==, CRE_OK);
+    g_assert_cmpint(parsed, ==, 2);
+}
+
+static void
+test_cr_xml_parse_filelists_parallel_warnings(void)
+{
+    char *warnmsgs;
+    int parsed = 0;
+    GString *warn_strings = g_string_new(0);
+    GError *tmp_err = NULL;
+    int ret = cr_xml_parse_filelists_parallel(TEST_MRF_BAD_TYPE_FIL, NULL, NULL,
+                                              pkgcb, &parsed, warningcb,
+                                              warn_strings, 2, &tmp_err);
+    g_assert(tmp_err == NULL);
+    g_assert_cmpint(ret, ==, CRE_OK);
+    g_assert_cmpint(parsed, ==, 2);
+    warnmsgs = g_string_free(warn_strings, FALSE);
+    g_assert_cmpstr(warnmsgs, ==, "Unknown file type \"foo\";");
+    g_free(warnmsgs);
+}
+
+static void
+test_cr_xml_parse_filelists_parallel_different_md_type(void)
+{
+    char *warnmsgs;
+    int parsed = 0;
+    GString *warn_strings = g_string_new(0);
+    GError *tmp_err = NULL;
+    int ret = cr_xml_parse_filelists_parallel(TEST_REPO_01_OTHER, NULL, NULL,
+                                              pkgcb, &parsed, warningcb,
+                                              warn_strings, 2, &tmp_err);
+    g_assert(tmp_err == NULL);
+    g_assert_cmpint(ret, ==, CRE_OK);
+    g_assert_cmpint(parsed, ==, 0);
+    warnmsgs = g_string_free(warn_strings, FALSE);
+    g_assert_cmpstr(warnmsgs, ==, "Unknown element \"otherdata\";"
+            "The target doesn't contain the expected element \"<filelists>\" - "
+            "The target probably isn't a valid filelists xml;");
+    g_free(warnmsgs);
+}
+
+static int
+pkgcb_check_order(cr_Package *pkg, void *cbdata, GError **err)
+{
+    g_assert(!err || *err == NULL);
+    gchar *expected = g_strdup_printf("pkg%06d", *((int *) cbdata));
+    g_assert_cmpstr(pkg->name, ==, expected);
+    g_assert_cmpint(g_slist_length(pkg->files), ==, 3);
+    g_free(expected);
+    *((int *) cbdata) += 1;
+    cr_package_free(pkg);
+    return CR_CB_RET_OK;
+}
+
+/* Filelists big enough to be split into several blocks, if broken_pkg
+ * is >= 0 the package has a malformed element on the returned line.
+ * With markup, every package has a "<package " in a CDATA section
+ * and in a comment.
+ */
+static int
+write_big_filelists(const char *path, int packages, int broken_pkg,
+                    gboolean markup)
+{
+    int line = 2, broken_line = 0;
+    FILE *f = fopen(path, "w");
+    g_assert(f);
+
+    fprintf(f, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+               "<filelists xmlns=\"http://linux.duke.edu/metadata/filelists\" "
+               "packages=\"%d\">\n", packages);
+    for (int i = 0; i < packages; i++) {
+        fprintf(f, "<package pkgid=\"%064d\" name=\"pkg%06d\" arch=\"x86_64\">\n"
+                   "  <version epoch=\"0\" ver=\"1.0\" rel=\"1\"/>\n",
+                i, i);
+        if (markup)
+            fprintf(f, "  <file><![CDATA[/usr/bin/<package name=\"%06d\">]]></file>\n"
+                       "  <!-- <package pkgid=\"%06d\"> -->\n",
+                    i, i);
+        else
+            fprintf(f, "  <file>/usr/bin/pkg%06d</file>\n"
+                       "\n",
+                    i);
+        fprintf(f, "  <file type=\"dir\">/usr/share/doc/pkg%06d</file>\n"
+                   "  <file>/usr/share/doc/pkg%06d/README</file>\n",
+                i, i);
+        line += 6;
+        if (i == broken_pkg) {
+            fprintf(f, "  <file>/broken</fil>\n");
+            broken_line = line + 1;
+            line++;
+        }
+        fprintf(f, "</package>\n");
+        line++;
+    }
+    fprintf(f, "</filelists>\n");
+    fclose(f);
+
+    return broken_line;
+}
+
+static void
+test_cr_xml_parse_filelists_parallel_big(void)
+{
+    int parsed = 0;
+    GError *tmp_err = NULL;
+    gchar *tmpdir = g_dir_make_tmp("createrepo_c_test_XXXXXX", NULL);
+    gchar *path = g_build_filename(tmpdir, "filelists.xml", NULL);
+
+    write_big_filelists(path, 40000, -1, FALSE);
+    int ret = cr_xml_parse_filelists_parallel(path, NULL, NULL,
+                                              pkgcb_check_order, &parsed,
+                                              NULL, NULL, 4, &tmp_err);
+    g_assert(tmp_err == NULL);
+    g_assert_cmpint(ret, ==, CRE_OK);
+    g_assert_cmpint(parsed, ==, 40000);
+
+    g_free(path);
+    cr_remove_dir(tmpdir, NULL);
+    g_free(tmpdir);
+}
+
+static void
+test_cr_xml_parse_filelists_parallel_markup(void)
+{
+    int parsed = 0;
+    GError *tmp_err = NULL;
+    gchar *tmpdir = g_dir_make_tmp("createrepo_c_test_XXXXXX", NULL);
+    gchar *path = g_build_filename(tmpdir, "filelists.xml", NULL);
+
+    // Blocks must not be cut at a "<package " in CDATA or in a comment
+    write_big_filelists(path, 60000, -1, TRUE);
+    int ret = cr_xml_parse_filelists_parallel(path, NULL, NULL,
+                                              pkgcb_check_order, &parsed,
+                                              NULL, NULL, 4, &tmp_err);
+    g_assert(tmp_err == NULL);
+    g_assert_cmpint(ret, ==, CRE_OK);
+    g_assert_cmpint(parsed, ==, 60000);
+
+    g_free(path);
+    cr_remove_dir(tmpdir, NULL);
+    g_free(tmpdir);
+}
+
+static void
+test_cr_xml_parse_filelists_parallel_big_broken(void)
+{
+    int parsed = 0;
+    GError *tmp_err = NULL;
+    gchar *tmpdir = g_dir_make_tmp("createrepo_c_test_XXXXXX", NULL);
+    gchar *path = g_build_filename(tmpdir, "filelists.xml", NULL);
+    gchar *expected;
+
+    int line = write_big_filelists(path, 40000, 35000, FALSE);
+    g_test_expect_message("C_CREATEREPOLIB", G_LOG_LEVEL_CRITICAL, "*parsing error*");
+    int ret = cr_xml_parse_filelists_parallel(path, NULL, NULL,
+                                              pkgcb_check_order, &parsed,
+                                              NULL, NULL, 4, &tmp_err);
+    g_test_assert_expected_messages();
+    g_assert_cmpint(ret, ==, CRE_XMLPARSER);
+    g_assert(tmp_err);
+    // All the packages before the broken one were passed in order
+    g_assert_cmpint(parsed, ==, 35000);
+    // Line is reported relative to the whole file
+    expected = g_strdup_printf("at line: %d ", line);
+    g_assert(strstr(tmp_err->message, expected));
+
+    g_free(expected);
+    g_clear_error(&tmp_err);
+    g_free(path);
+    cr_remove_dir(tmpdir, NULL);
+    g_free(tmpdir);
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -499,5 +684,17 @@ main(int argc, char *argv[])
                     test_cr_xml_parse_filelists_ext_snippet_snippet_01);
     g_test_add_func("/xml_parser_filelists/test_cr_xml_parse_filelists_ext_snippet_snippet_02",
                     test_cr_xml_parse_filelists_ext_snippet_snippet_02);
+    g_test_add_func("/xml_parser_filelists/test_cr_xml_parse_filelists_parallel_skip_fake_bash",
+                    test_cr_xml_parse_filelists_parallel_skip_fake_bash);
+    g_test_add_func("/xml_parser_filelists/test_cr_xml_parse_filelists_parallel_warnings",
+                    test_cr_xml_parse_filelists_parallel_warnings);
+    g_test_add_func("/xml_parser_filelists/test_cr_xml_parse_filelists_parallel_different_md_type",
+                    test_cr_xml_parse_filelists_parallel_different_md_type);
+    g_test_add_func("/xml_parser_filelists/test_cr_xml_parse_filelists_parallel_big",
+                    test_cr_xml_parse_filelists_parallel_big);
+    g_test_add_func("/xml_parser_filelists/test_cr_xml_parse_filelists_parallel_markup",
+                    test_cr_xml_parse_filelists_parallel_markup);
+    g_test_add_func("/xml_parser_filelists/test_cr_xml_parse_filelists_parallel_big_broken",
+                    test_cr_xml_parse_filelists_parallel_big_broken);
     return g_test_run();
 }
@@ -0,0 +1,300 @@
+/* createrepo_c - Library of routines for manipulation with repodata
+ * Copyright (C) 2026 Red Hat, Inc.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301,
+ * USA.
+ */
+
+#include <glib.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "fixtures.h"
+#include "createrepo/error.h"
+#include "createrepo/package.h"
+#include "createrepo/misc.h"
+#include "createrepo/xml_dump.h"
+#include "createrepo/xml_parser.h"
+
+typedef int (*FilteredParseFunc)(const char *, const cr_XmlFilter *,
+                                 cr_XmlParserNewPkgCb, void *,
+                                 cr_XmlParserPkgCb, void *,
+                                 cr_XmlParserWarningCb, void *, GError **);
+
+// Callbacks
+
+static int
+newpkgcb_names(cr_Package **pkg,
+               G_GNUC_UNUSED const char *pkgId,
+               const char *name,
+               const char *arch,
+               G_GNUC_UNUSED void *cbdata,
+               G_GNUC_UNUSED GError **err)
+{
+    // Filtered primary parser knows the name and the arch already
+    g_assert(name);
+    g_assert(arch);
+
+    *pkg = cr_package_new();
+    return CR_CB_RET_OK;
+}
+
+static int
+pkgcb_names(cr_Package *pkg, void *cbdata, G_GNUC_UNUSED GError **err)
+{
+    GString *names = cbdata;
+
+    g_string_append_printf(names, "%s%s", names->len ? " " : "", pkg->name);
+    cr_package_free(pkg);
+    return CR_CB_RET_OK;
+}
+
+static int
+pkgcb_dump(cr_Package *pkg, void *cbdata, G_GNUC_UNUSED GError **err)
+{
+    GString *dump = cbdata;
+    gchar *xml = cr_xml_dump_primary(pkg, NULL);
+
+    g_string_append(dump, xml);
+    g_free(xml);
+    cr_package_free(pkg);
+    return CR_CB_RET_OK;
+}
+
+static gchar *
+parse_names(FilteredParseFunc parse,
+            const char *path,
+            const cr_XmlFilter *filter)
+{
+    GString *names = g_string_new(NULL);
+    GError *tmp_err = NULL;
+
+    int ret = parse(path, filter, newpkgcb_names, NULL, pkgcb_names, names,
+                    NULL, NULL, &tmp_err);
+    g_assert_no_error(tmp_err);
+    g_assert_cmpint(ret, ==, CRE_OK);
+
+    return g_string_free(names, FALSE);
+}
+
+static gchar *
+parse_primary_names(const char *path, const cr_XmlFilter *filter)
+{
+    GString *names = g_string_new(NULL);
+    GError *tmp_err = NULL;
+
+    int ret = cr_xml_parse_primary_filtered(path, filter, newpkgcb_names,
+                                            NULL, pkgcb_names, names,
+                                            NULL, NULL, 1, &tmp_err);
+    g_assert_no_error(tmp_err);
+    g_assert_cmpint(ret, ==, CRE_OK);
+
+    return g_string_free(names, FALSE);
+}
+
+// Tests
+
+static void
+test_cr_xml_filter_match(void)
+{
+    cr_XmlFilter *filter = cr_xml_filter_new();
+
+    // Empty filter (and no filter) matches everything
+    g_assert(cr_xml_filter_match(NULL, "foo", "x86_64", "foo.rpm", NULL));
+    g_assert(cr_xml_filter_match(filter, "foo", "x86_64", "foo.rpm", NULL));
+
+    cr_xml_filter_add_arch(filter, "x86_64");
+    cr_xml_filter_add_arch(filter, "noarch");
+    cr_xml_filter_add_name_glob(filter, "foo*");
+    cr_xml_filter_add_href(filter, "Packages/f/foo-1-1.x86_64.rpm");
+    cr_xml_filter_add_blocked_srpm(filter, "blocked");
+
+    g_assert(cr_xml_filter_match(filter, "foo", "x86_64",
+                                 "foo-1-1.x86_64.rpm", "foo-1-1.src.rpm"));
+    g_assert(!cr_xml_filter_match(filter, "foo", "i686", NULL, NULL));
+    g_assert(!cr_xml_filter_match(filter, "bar", "noarch", NULL, NULL));
+    g_assert(!cr_xml_filter_match(filter, NULL, NULL, "foo-2-1.x86_64.rpm",
+                                  NULL));
+    g_assert(!cr_xml_filter_match(filter, NULL, NULL, NULL,
+                                  "blocked-1-1.src.rpm"));
+    // Invalid srpms are not evaluated
+    g_assert(cr_xml_filter_match(filter, NULL, NULL, NULL, "blocked"));
+    // Missing values are not evaluated
+    g_assert(cr_xml_filter_match(filter, "foobar", NULL, NULL, NULL));
+
+    cr_xml_filter_free(filter);
+}
+
+static void
+test_cr_xml_parse_primary_filtered(void)
+{
+    cr_XmlFilter *filter;
+    gchar *names;
+
+    names = parse_primary_names(TEST_REPO_02_PRIMARY, NULL);
+    g_assert_cmpstr(names, ==, "fake_bash super_kernel");
+    g_free(names);
+
+    filter = cr_xml_filter_new();
+    cr_xml_filter_add_arch(filter, "noarch");
+    names = parse_primary_names(TEST_REPO_02_PRIMARY, filter);
+    g_assert_cmpstr(names, ==, "");
+    g_free(names);
+    cr_xml_filter_add_arch(filter, "x86_64");
+    names = parse_primary_names(TEST_REPO_02_PRIMARY, filter);
+    g_assert_cmpstr(names, ==, "fake_bash super_kernel");
+    g_free(names);
+    cr_xml_filter_free(filter);
+
+    filter = cr_xml_filter_new();
+    cr_xml_filter_add_name_glob(filter, "fake_*");
+    names = parse_primary_names(TEST_REPO_02_PRIMARY, filter);
+    g_assert_cmpstr(names, ==, "fake_bash");
+    g_free(names);
+    cr_xml_filter_free(filter);
+
+    filter = cr_xml_filter_new();
+    cr_xml_filter_add_href(filter, "super_kernel-6.0.1-2.x86_64.rpm");
+    names = parse_primary_names(TEST_REPO_02_PRIMARY, filter);
+    g_assert_cmpstr(names, ==, "super_kernel");
+    g_free(names);
+    cr_xml_filter_free(filter);
+
+    filter = cr_xml_filter_new();
+    cr_xml_filter_add_blocked_srpm(filter, "fake_bash");
+    names = parse_primary_names(TEST_REPO_02_PRIMARY, filter);
+    g_assert_cmpstr(names, ==, "super_kernel");
+    g_free(names);
+    cr_xml_filter_free(filter);
+}
+
+static void
+test_cr_xml_parse_primary_filtered_same_packages(void)
+{
+    const char *paths[] = {
+        TEST_REPO_01_PRIMARY,
+        TEST_REPO_02_PRIMARY,
+        TEST_REPO_04_PRIMARY,
+        TEST_LONG_PRIMARY,
+        NULL,
+    };
+    cr_XmlFilter *filter = cr_xml_filter_new();
+
+    // Packages accepted by the filter have to be the same as without it
+    cr_xml_filter_add_arch(filter, "x86_64");
+    cr_xml_filter_add_blocked_srpm(filter, "nonexistent");
+
+    for (int i = 0; paths[i]; i++) {
+        GString *expected = g_string_new(NULL);
+        GString *dump = g_string_new(NULL);
+        GError *tmp_err = NULL;
+
+        cr_xml_parse_primary(paths[i], NULL, NULL, pkgcb_dump, expected,
+                             NULL, NULL, 1, &tmp_err);
+        g_assert_no_error(tmp_err);
+        cr_xml_parse_primary_filtered(paths[i], filter, NULL, NULL,
+                                      pkgcb_dump, dump, NULL, NULL, 1,
+                                      &tmp_err);
+        g_assert_no_error(tmp_err);
+
+        g_assert_cmpuint(expected->len, >, 0);
+        g_assert_cmpstr(dump->str, ==, expected->str);
+        g_string_free(expected, TRUE);
+        g_string_free(dump, TRUE);
+    }
+
+    cr_xml_filter_free(filter);
+}
+
+static void
+test_cr_xml_parse_filelists_other_filtered(void)
+{
+    cr_XmlFilter *filter = cr_xml_filter_new();
+    gchar *names;
+
+    cr_xml_filter_add_name_glob(filter, "super_*");
+    // Not evaluated by filelists and other parsers
+    cr_xml_filter_add_href(filter, "fake_bash-1.1.1-1.x86_64.rpm");
+
+    names = parse_names(cr_xml_parse_filelists_filtered,
+                        TEST_REPO_02_FILELISTS, filter);
+    g_assert_cmpstr(names, ==, "super_kernel");
+    g_free(names);
+    names = parse_names(cr_xml_parse_other_filtered,
+                        TEST_REPO_02_OTHER, filter);
+    g_assert_cmpstr(names, ==, "super_kernel");
+    g_free(names);
+
+    cr_xml_filter_free(filter);
+}
+
+static void
+test_cr_xml_parse_filelists_filtered_skip(void)
+{
+    gchar *tmpdir = g_dir_make_tmp("createrepo_c_test_XXXXXX", NULL);
+    gchar *path = g_build_filename(tmpdir, "filelists.xml", NULL);
+    cr_XmlFilter *filter = cr_xml_filter_new();
+    GString *expected = g_string_new(NULL);
+    FILE *f = fopen(path, "w");
+    gchar *names;
+
+    // Enough packages to span several read buffers
+    g_assert(f);
+    fprintf(f, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+               "<filelists xmlns=\"http://linux.duke.edu/metadata/filelists\" "
+               "packages=\"5000\">\n");
+    for (int i = 0; i < 5000; i++) {
+        const char *arch = (i % 3) ? "i686" : "x86_64";
+        fprintf(f, "<package pkgid=\"%064d\" name=\"pkg%06d\" arch=\"%s\">\n"
+                   "  <version epoch=\"0\" ver=\"1.0\" rel=\"1\"/>\n"
+                   "  <file>/usr/bin/pkg%06d</file>\n"
+                   "</package>\n", i, i, arch, i);
+        if (!(i % 3))
+            g_string_append_printf(expected, "%spkg%06d",
+                                   expected->len ? " " : "", i);
+    }
+    fprintf(f, "</filelists>\n");
+    fclose(f);
+
+    cr_xml_filter_add_arch(filter, "x86_64");
+    names = parse_names(cr_xml_parse_filelists_filtered, path, filter);
+    g_assert_cmpstr(names, ==, expected->str);
+    g_free(names);
+
+    cr_xml_filter_free(filter);
+    g_string_free(expected, TRUE);
+    g_free(path);
+    cr_remove_dir(tmpdir, NULL);
+    g_free(tmpdir);
+}
+
+int
+main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/xml_parser_filter/test_cr_xml_filter_match",
+            test_cr_xml_filter_match);
+    g_test_add_func("/xml_parser_filter/test_cr_xml_parse_primary_filtered",
+            test_cr_xml_parse_primary_filtered);
+    g_test_add_func("/xml_parser_filter/test_cr_xml_parse_primary_filtered_same_packages",
+            test_cr_xml_parse_primary_filtered_same_packages);
+    g_test_add_func("/xml_parser_filter/test_cr_xml_parse_filelists_other_filtered",
+            test_cr_xml_parse_filelists_other_filtered);
+    g_test_add_func("/xml_parser_filter/test_cr_xml_parse_filelists_filtered_skip",
+            test_cr_xml_parse_filelists_filtered_skip);
+
+    return g_test_run();
+}
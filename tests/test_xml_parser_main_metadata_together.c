@@ -356,6 +356,84 @@ test_cr_xml_package_iterator_08_multiple_warningscb(void)
     cr_PkgIterator_free(pkg_iterator, &tmp_err);
 }
 
+static void
+test_cr_xml_package_iterator_09_joined_packages(void)
+{
+    GError *tmp_err = NULL;
+    cr_Package *package = NULL;
+
+    cr_PkgIterator *pkg_iterator = cr_PkgIterator_new(
+        TEST_REPO_02_PRIMARY, TEST_REPO_02_FILELISTS, TEST_REPO_02_OTHER, NULL, NULL, NULL, NULL, &tmp_err);
+
+    package = cr_PkgIterator_parse_next(pkg_iterator, &tmp_err);
+    g_assert(package);
+    g_assert_cmpstr(package->name, ==, "fake_bash");
+    g_assert_cmpstr(package->location_href, ==, "fake_bash-1.1.1-1.x86_64.rpm");
+    g_assert_cmpint(g_slist_length(package->files), ==, 1);
+    g_assert_cmpstr(((cr_PackageFile *) package->files->data)->name, ==, "fake_bash");
+    g_assert_cmpint(g_slist_length(package->changelogs), ==, 1);
+    g_assert((package->loadingflags & CR_PACKAGE_LOADED_PRI) && (package->loadingflags & CR_PACKAGE_LOADED_FIL)
+             && (package->loadingflags & CR_PACKAGE_LOADED_OTH));
+    cr_package_free(package);
+
+    package = cr_PkgIterator_parse_next(pkg_iterator, &tmp_err);
+    g_assert(package);
+    g_assert_cmpstr(package->name, ==, "super_kernel");
+    g_assert_cmpint(g_slist_length(package->files), ==, 2);
+    g_assert_cmpstr(((cr_PackageFile *) package->files->data)->path, ==, "/usr/bin/");
+    g_assert_cmpint(g_slist_length(package->changelogs), ==, 2);
+    g_assert_cmpstr(((cr_ChangelogEntry *) package->changelogs->data)->changelog, ==, "- First release");
+    cr_package_free(package);
+
+    g_assert(!cr_PkgIterator_parse_next(pkg_iterator, &tmp_err));
+    g_assert(cr_PkgIterator_is_finished(pkg_iterator));
+    cr_PkgIterator_free(pkg_iterator, &tmp_err);
+    g_assert(tmp_err == NULL);
+}
+
+static void
+test_cr_xml_package_iterator_10_free_unfinished(void)
+{
+    GError *tmp_err = NULL;
+    cr_Package *package = NULL;
+
+    cr_PkgIterator *pkg_iterator = cr_PkgIterator_new(
+        TEST_REPO_02_PRIMARY, TEST_REPO_02_FILELISTS, TEST_REPO_02_OTHER, NULL, NULL, NULL, NULL, &tmp_err);
+
+    package = cr_PkgIterator_parse_next(pkg_iterator, &tmp_err);
+    g_assert(package);
+    cr_package_free(package);
+
+    g_assert(!cr_PkgIterator_is_finished(pkg_iterator));
+    cr_PkgIterator_free(pkg_iterator, &tmp_err);
+    g_assert(tmp_err == NULL);
+}
+
+static void
+test_cr_xml_package_iterator_11_short_filelists(void)
+{
+    GError *tmp_err = NULL;
+    cr_Package *package = NULL;
+
+    cr_PkgIterator *pkg_iterator = cr_PkgIterator_new(
+        TEST_REPO_02_PRIMARY, TEST_SHORT_FILELISTS, TEST_REPO_02_OTHER, NULL, NULL, NULL, NULL, &tmp_err);
+
+    package = cr_PkgIterator_parse_next(pkg_iterator, &tmp_err);
+    g_assert(package);
+    g_assert_cmpstr(package->name, ==, "fake_bash");
+    cr_package_free(package);
+
+    // super_kernel is in primary and other, but not in filelists
+    package = cr_PkgIterator_parse_next(pkg_iterator, &tmp_err);
+    g_assert(package == NULL);
+    g_assert(tmp_err != NULL);
+    g_assert_cmpint(tmp_err->code, ==, CRE_XMLPARSER);
+    g_assert(!cr_PkgIterator_is_finished(pkg_iterator));
+    g_clear_error(&tmp_err);
+
+    cr_PkgIterator_free(pkg_iterator, &tmp_err);
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -397,5 +475,14 @@ main(int argc, char *argv[])
     g_test_add_func("/xml_parser_main_metadata/test_cr_xml_package_iterator_08_multiple_warningscb",
                     test_cr_xml_package_iterator_08_multiple_warningscb);
 
+    g_test_add_func("/xml_parser_main_metadata/test_cr_xml_package_iterator_09_joined_packages",
+                    test_cr_xml_package_iterator_09_joined_packages);
+
+    g_test_add_func("/xml_parser_main_metadata/test_cr_xml_package_iterator_10_free_unfinished",
+                    test_cr_xml_package_iterator_10_free_unfinished);
+
+    g_test_add_func("/xml_parser_main_metadata/test_cr_xml_package_iterator_11_short_filelists",
+                    test_cr_xml_package_iterator_11_short_filelists);
+
     return g_test_run();
 }
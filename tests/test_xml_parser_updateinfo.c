@@ -269,6 +269,34 @@ test_cr_xml_parse_updateinfo_03(void)
     cr_updateinfo_free(ui);
 }
 
+static int
+updaterecord_cb(cr_UpdateRecord *rec, void *cbdata, G_GNUC_UNUSED GError **err)
+{
+    GSList **ids = cbdata;
+    *ids = g_slist_append(*ids, g_strdup(rec->id));
+    cr_updaterecord_free(rec);
+    return CR_CB_RET_OK;
+}
+
+static void
+test_cr_xml_parse_updateinfo_with_cb_03(void)
+{
+    GError *tmp_err = NULL;
+    GSList *ids = NULL;
+
+    int ret = cr_xml_parse_updateinfo_with_cb(TEST_UPDATEINFO_03,
+                                              updaterecord_cb, &ids,
+                                              NULL, NULL, &tmp_err);
+
+    g_assert(tmp_err == NULL);
+    g_assert_cmpint(ret, ==, CRE_OK);
+    g_assert_cmpint(g_slist_length(ids), ==, 6);
+    g_assert_cmpstr(g_slist_nth_data(ids, 0), ==, "RHEA-2012:0055");
+    g_assert_cmpstr(g_slist_nth_data(ids, 5), ==, "RHEA-2012:0060");
+
+    g_slist_free_full(ids, g_free);
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -282,6 +310,8 @@ main(int argc, char *argv[])
                     test_cr_xml_parse_updateinfo_02);
     g_test_add_func("/xml_parser_updateinfo/test_cr_xml_parse_updateinfo_03",
                     test_cr_xml_parse_updateinfo_03);
+    g_test_add_func("/xml_parser_updateinfo/test_cr_xml_parse_updateinfo_with_cb_03",
+                    test_cr_xml_parse_updateinfo_with_cb_03);
 
     return g_test_run();
 }